@@ -0,0 +1,217 @@
+﻿#include "Aggregate.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace
+{
+    // 部分集計の単位
+    const size_t kAggregateBlockRows = 65536;
+}
+
+void GroupAggregator::Accumulator::Add(std::string_view value, bool trackText)
+{
+    ++rows;
+    if (value.empty())
+    {
+        return;
+    }
+    ++valueCount;
+
+    double number;
+    if (ParseDouble(value, number))
+    {
+        if (numericCount == 0)
+        {
+            minimum = number;
+            maximum = number;
+        }
+        else
+        {
+            minimum = std::min(minimum, number);
+            maximum = std::max(maximum, number);
+        }
+        sum += number;
+        ++numericCount;
+    }
+    else if (trackText)
+    {
+        if (!hasText || value < textMinimum)
+        {
+            textMinimum.assign(value.data(), value.size());
+        }
+        if (!hasText || value > textMaximum)
+        {
+            textMaximum.assign(value.data(), value.size());
+        }
+        hasText = true;
+    }
+}
+
+void GroupAggregator::Accumulator::Merge(const Accumulator& other)
+{
+    if (other.numericCount > 0)
+    {
+        minimum = numericCount > 0 ? std::min(minimum, other.minimum) : other.minimum;
+        maximum = numericCount > 0 ? std::max(maximum, other.maximum) : other.maximum;
+    }
+    if (other.hasText)
+    {
+        if (!hasText || other.textMinimum < textMinimum)
+        {
+            textMinimum = other.textMinimum;
+        }
+        if (!hasText || other.textMaximum > textMaximum)
+        {
+            textMaximum = other.textMaximum;
+        }
+        hasText = true;
+    }
+    rows += other.rows;
+    valueCount += other.valueCount;
+    numericCount += other.numericCount;
+    sum += other.sum;
+}
+
+GroupAggregator::GroupAggregator()
+    : groupIndex(-1)
+    , valueIndex(-1)
+    , ready(false)
+    , trackText(false)
+    , rowCount(0)
+{
+}
+
+bool GroupAggregator::Reset(const AggregateSpec& newSpec, const std::vector<std::string>& headers)
+{
+    spec = newSpec;
+    groupLookup.clear();
+    groupKeys.clear();
+    accumulators.clear();
+    rowCount = 0;
+    trackText = spec.function == "min" || spec.function == "max";
+
+    auto find = [&headers](const std::string& column) {
+        auto it = std::find(headers.begin(), headers.end(), column);
+        return it != headers.end() ? static_cast<int>(it - headers.begin()) : -1;
+    };
+    groupIndex = find(spec.groupColumn);
+    valueIndex = find(spec.valueColumn);
+    ready = (groupIndex >= 0 || spec.groupColumn.empty()) && (valueIndex >= 0 || spec.function == "count");
+    return ready;
+}
+
+void GroupAggregator::Add(const CSVData& data, size_t beginRow, size_t endRow)
+{
+    if (!ready || beginRow >= endRow)
+    {
+        return;
+    }
+
+    // ブロックごとの部分集計（キーは入力表の文字列を参照する）
+    struct Partial
+    {
+        std::unordered_map<std::string_view, size_t> lookup;
+        std::vector<std::string_view> keys;
+        std::vector<Accumulator> accumulators;
+    };
+
+    // グループ列が無ければすべての行を空のキーの 1 グループに畳み込む
+    const size_t group = groupIndex >= 0 ? static_cast<size_t>(groupIndex) : SIZE_MAX;
+    const auto rows = data.GetRows();
+    const size_t blockCount = (endRow - beginRow + kAggregateBlockRows - 1) / kAggregateBlockRows;
+    std::vector<Partial> partials(blockCount);
+    ParallelFor(blockCount, [&](size_t b) {
+        Partial& partial = partials[b];
+        const size_t first = beginRow + b * kAggregateBlockRows;
+        const size_t last = std::min(endRow, first + kAggregateBlockRows);
+        for (size_t r = first; r < last; ++r)
+        {
+            const CSVRow row = rows[r];
+            const std::string_view key = group < row.size() ? row[group] : std::string_view();
+            auto inserted = partial.lookup.emplace(key, partial.keys.size());
+            if (inserted.second)
+            {
+                partial.keys.push_back(key);
+                partial.accumulators.emplace_back();
+            }
+            const std::string_view value = valueIndex >= 0 && static_cast<size_t>(valueIndex) < row.size()
+                ? row[static_cast<size_t>(valueIndex)] : std::string_view();
+            partial.accumulators[inserted.first->second].Add(value, trackText);
+        }
+    });
+
+    std::string key;
+    for (const auto& partial : partials)
+    {
+        for (size_t i = 0; i < partial.keys.size(); ++i)
+        {
+            key.assign(partial.keys[i].data(), partial.keys[i].size());
+            auto inserted = groupLookup.emplace(key, groupKeys.size());
+            if (inserted.second)
+            {
+                groupKeys.push_back(key);
+                accumulators.push_back(partial.accumulators[i]);
+            }
+            else
+            {
+                accumulators[inserted.first->second].Merge(partial.accumulators[i]);
+            }
+        }
+    }
+    rowCount += endRow - beginRow;
+}
+
+void GroupAggregator::FormatValue(const Accumulator& accumulator, std::string& text) const
+{
+    text.clear();
+    if (spec.function == "count")
+    {
+        FormatCanonical(static_cast<int64_t>(accumulator.rows), text);
+    }
+    else if (spec.function == "count_values")
+    {
+        FormatCanonical(static_cast<int64_t>(accumulator.valueCount), text);
+    }
+    else if (spec.function == "sum")
+    {
+        FormatCanonical(accumulator.sum, text);
+    }
+    else if (spec.function == "average")
+    {
+        if (accumulator.numericCount > 0)
+        {
+            FormatCanonical(accumulator.sum / static_cast<double>(accumulator.numericCount), text);
+        }
+    }
+    else if (spec.function == "min" || spec.function == "max")
+    {
+        const bool minimum = spec.function == "min";
+        if (accumulator.numericCount > 0)
+        {
+            FormatCanonical(minimum ? accumulator.minimum : accumulator.maximum, text);
+        }
+        else if (accumulator.hasText)
+        {
+            text = minimum ? accumulator.textMinimum : accumulator.textMaximum;
+        }
+    }
+}
+
+void GroupAggregator::WriteTo(CSVData& output) const
+{
+    output.Clear();
+    const std::string valueName = spec.valueColumn.empty() ? spec.function : spec.function + "(" + spec.valueColumn + ")";
+    output.SetHeaders({ spec.groupColumn, valueName });
+
+    std::vector<std::string_view> row(2);
+    std::string text;
+    for (size_t g = 0; g < groupKeys.size(); ++g)
+    {
+        FormatValue(accumulators[g], text);
+        row[0] = groupKeys[g];
+        row[1] = text;
+        output.AddRow(row);
+    }
+}
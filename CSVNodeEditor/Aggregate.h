@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// 集計の設定
+struct AggregateSpec
+{
+    std::string groupColumn;       // 空の場合は表全体を 1 つのグループとして集計する
+    std::string valueColumn;       // count では省略できる
+    std::string function = "sum";  // "sum", "average", "count", "count_values"（空でない値の数）, "min", "max"
+};
+
+// グループごとの集計値を保持し、行が追加されるたびに差分だけを畳み込む
+// 各グループの行数・数値の件数・合計・最小・最大を持つため、どの集計関数も追加された行だけで更新できる。
+// 数値として解釈できないセルは sum / average では無視し、min / max では数値が 1 つも無いグループに限り文字列で比べる。
+class GroupAggregator
+{
+public:
+    GroupAggregator();
+
+    // 集計をやり直す（列が見つからなければ false）
+    bool Reset(const AggregateSpec& spec, const std::vector<std::string>& headers);
+
+    // 集計できる状態か（Reset が成功したか）
+    bool IsReady() const { return ready; }
+
+    // data の [beginRow, endRow) の行を集計に加える
+    // 行をブロックに分けて並列に部分集計し、グループの初出順を保つようにブロック順に併合する。
+    void Add(const CSVData& data, size_t beginRow, size_t endRow);
+
+    // グループ列と集計値の 2 列の表を書き出す（グループは初出順）
+    void WriteTo(CSVData& output) const;
+
+    size_t GetGroupCount() const { return groupKeys.size(); }
+    size_t GetRowCount() const { return rowCount; }
+
+private:
+    struct Accumulator
+    {
+        size_t rows = 0;
+        size_t valueCount = 0;      // 空でない値の数
+        size_t numericCount = 0;
+        double sum = 0.0;
+        double minimum = 0.0;
+        double maximum = 0.0;
+        std::string textMinimum;
+        std::string textMaximum;
+        bool hasText = false;
+
+        void Add(std::string_view value, bool trackText);
+        void Merge(const Accumulator& other);
+    };
+
+    AggregateSpec spec;
+    int groupIndex;
+    int valueIndex;
+    bool ready;
+    bool trackText;
+    size_t rowCount;
+    std::unordered_map<std::string, size_t> groupLookup;
+    std::vector<std::string> groupKeys;
+    std::vector<Accumulator> accumulators;
+
+    void FormatValue(const Accumulator& accumulator, std::string& text) const;
+};
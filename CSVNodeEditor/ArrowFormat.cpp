@@ -0,0 +1,198 @@
+﻿#include "ArrowFormat.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    ArrowType DetectType(const CSVRowRange& rows, size_t column)
+    {
+        bool allInt = true;
+        bool allDouble = true;
+        for (const auto& row : rows)
+        {
+            std::string_view cell = row[column];
+            if (cell.empty())
+            {
+                continue;
+            }
+            int64_t intValue = 0;
+            double doubleValue = 0.0;
+            allInt = allInt && ParseCanonicalInt(cell, intValue);
+            allDouble = allDouble && ParseCanonicalDouble(cell, doubleValue);
+            if (!allInt && !allDouble)
+            {
+                return ArrowType::Utf8;
+            }
+        }
+        return allInt ? ArrowType::Int64 : ArrowType::Float64;
+    }
+
+    template <typename T>
+    void AppendValue(std::string& buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    ArrowArray BuildArray(const CSVRowRange& rows, size_t begin, size_t end, size_t column, ArrowType type)
+    {
+        ArrowArray array;
+        array.length = static_cast<int64_t>(end - begin);
+        std::string validity((end - begin + 7) / 8, '\0');
+
+        if (type == ArrowType::Utf8)
+        {
+            array.offsets.reserve((end - begin + 1) * sizeof(int32_t));
+            AppendValue(array.offsets, int32_t(0));
+        }
+        else
+        {
+            array.values.reserve((end - begin) * sizeof(int64_t));
+        }
+
+        for (size_t r = begin; r < end; ++r)
+        {
+            std::string_view cell = rows[r][column];
+            const size_t i = r - begin;
+            if (cell.empty())
+            {
+                ++array.nullCount;
+            }
+            else
+            {
+                validity[i / 8] |= static_cast<char>(1 << (i % 8));
+            }
+
+            switch (type)
+            {
+            case ArrowType::Int64:
+            {
+                int64_t value = 0;
+                ParseCanonicalInt(cell, value);
+                AppendValue(array.values, value);
+                break;
+            }
+            case ArrowType::Float64:
+            {
+                double value = 0.0;
+                ParseCanonicalDouble(cell, value);
+                AppendValue(array.values, value);
+                break;
+            }
+            case ArrowType::Utf8:
+                array.values.append(cell);
+                AppendValue(array.offsets, static_cast<int32_t>(array.values.size()));
+                break;
+            }
+        }
+
+        if (array.nullCount > 0)
+        {
+            array.validity = std::move(validity);
+        }
+        return array;
+    }
+}
+
+bool ArrowArray::IsValid(int64_t index) const
+{
+    return validity.empty() || (validity[static_cast<size_t>(index / 8)] & (1 << (index % 8))) != 0;
+}
+
+int64_t ArrowTable::GetRowCount() const
+{
+    int64_t rowCount = 0;
+    for (const auto& batch : batches)
+    {
+        rowCount += batch.length;
+    }
+    return rowCount;
+}
+
+void BuildArrowTable(const CSVData& data, ArrowTable& table, size_t batchRows)
+{
+    const auto& headers = data.GetHeaders();
+    const auto& rows = data.GetRows();
+    batchRows = std::max<size_t>(1, batchRows);
+
+    table.schema.assign(headers.size(), ArrowField());
+    ParallelFor(headers.size(), [&](size_t column) {
+        table.schema[column].name = headers[column];
+        table.schema[column].type = DetectType(rows, column);
+    });
+
+    table.batches.assign((rows.size() + batchRows - 1) / batchRows, ArrowRecordBatch());
+    ParallelFor(table.batches.size(), [&](size_t b) {
+        size_t begin = b * batchRows;
+        size_t end = std::min(rows.size(), begin + batchRows);
+        ArrowRecordBatch& batch = table.batches[b];
+        batch.length = static_cast<int64_t>(end - begin);
+        batch.columns.reserve(headers.size());
+        for (size_t c = 0; c < headers.size(); ++c)
+        {
+            batch.columns.push_back(BuildArray(rows, begin, end, c, table.schema[c].type));
+        }
+    });
+}
+
+void ArrowTableToCSVData(const ArrowTable& table, CSVData& data)
+{
+    std::vector<std::string> headers;
+    for (const auto& field : table.schema)
+    {
+        headers.push_back(field.name);
+    }
+
+    // バッチごとにアリーナを持たせて並列に復元し、最後に連結する
+    const size_t columnCount = headers.size();
+    std::vector<CellBlock> blocks(table.batches.size());
+    ParallelFor(table.batches.size(), [&](size_t b) {
+        const ArrowRecordBatch& batch = table.batches[b];
+        CellBlock& block = blocks[b];
+        block.cells.resize(static_cast<size_t>(batch.length) * columnCount);
+        std::string formatted;
+        for (size_t c = 0; c < batch.columns.size() && c < columnCount; ++c)
+        {
+            const ArrowArray& array = batch.columns[c];
+            for (int64_t i = 0; i < array.length && i < batch.length; ++i)
+            {
+                if (!array.IsValid(i))
+                {
+                    continue;
+                }
+                CellRef& cell = block.cells[static_cast<size_t>(i) * columnCount + c];
+                switch (table.schema[c].type)
+                {
+                case ArrowType::Int64:
+                {
+                    int64_t value;
+                    std::memcpy(&value, array.values.data() + i * sizeof(int64_t), sizeof(int64_t));
+                    FormatCanonical(value, formatted);
+                    cell = block.Store(c, formatted);
+                    break;
+                }
+                case ArrowType::Float64:
+                {
+                    double value;
+                    std::memcpy(&value, array.values.data() + i * sizeof(double), sizeof(double));
+                    FormatCanonical(value, formatted);
+                    cell = block.Store(c, formatted);
+                    break;
+                }
+                case ArrowType::Utf8:
+                {
+                    int32_t range[2];
+                    std::memcpy(range, array.offsets.data() + i * sizeof(int32_t), sizeof(range));
+                    cell = block.Store(c, std::string_view(array.values.data() + range[0], static_cast<size_t>(range[1] - range[0])));
+                    break;
+                }
+                }
+            }
+        }
+    });
+
+    data.Clear();
+    data.SetHeaders(headers);
+    data.SetCellBlocks(std::move(blocks), columnCount);
+}
@@ -0,0 +1,54 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Arrow の列の型（読み込んだ他の型はこのいずれかに変換する）
+enum class ArrowType
+{
+    Int64,
+    Float64,
+    Utf8
+};
+
+struct ArrowField
+{
+    std::string name;
+    ArrowType type = ArrowType::Utf8;
+};
+
+// 1列分の配列（Arrow の列指向メモリレイアウト）
+// 空セルは欠損として扱い、検証ビットマップの該当ビットを 0 にする。
+struct ArrowArray
+{
+    int64_t length = 0;
+    int64_t nullCount = 0;
+    std::string validity; // LSB 順のビットマップ（欠損が無ければ空）
+    std::string offsets;  // Utf8: int32 のオフセット（length + 1 個）
+    std::string values;   // Int64 / Float64: 値の配列、Utf8: 連結したバイト列
+
+    bool IsValid(int64_t index) const;
+};
+
+struct ArrowRecordBatch
+{
+    int64_t length = 0;
+    std::vector<ArrowArray> columns;
+};
+
+struct ArrowTable
+{
+    std::vector<ArrowField> schema;
+    std::vector<ArrowRecordBatch> batches;
+
+    int64_t GetRowCount() const;
+};
+
+// テーブルを Arrow レイアウトへ変換する（レコードバッチ単位で並列に構築）
+// 全セルが往復可能な整数・小数の列は Int64 / Float64、それ以外は Utf8 にする。
+void BuildArrowTable(const CSVData& data, ArrowTable& table, size_t batchRows = 65536);
+
+// Arrow レイアウトからテーブルを復元する
+void ArrowTableToCSVData(const ArrowTable& table, CSVData& data);
@@ -0,0 +1,719 @@
+﻿#include "ArrowIpc.h"
+#include "FlatBuffer.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    using Offset = FlatBufferBuilder::Offset;
+
+    const char fileMagic[6] = { 'A', 'R', 'R', 'O', 'W', '1' };
+    const uint32_t continuationMarker = 0xFFFFFFFF;
+    const int16_t metadataVersionV4 = 3;
+    const int16_t metadataVersionV5 = 4;
+
+    // MessageHeader 共用体の型番号
+    const uint8_t headerSchema = 1;
+    const uint8_t headerRecordBatch = 3;
+
+    // Type 共用体の型番号
+    const uint8_t typeInt = 2;
+    const uint8_t typeFloatingPoint = 3;
+    const uint8_t typeUtf8 = 5;
+    const uint8_t typeBool = 6;
+    const uint8_t typeLargeUtf8 = 20;
+
+    const int16_t precisionSingle = 1;
+    const int16_t precisionDouble = 2;
+
+    // Message.fbs / File.fbs の構造体
+    struct FieldNode
+    {
+        int64_t length;
+        int64_t nullCount;
+    };
+
+    struct BufferRegion
+    {
+        int64_t offset;
+        int64_t length;
+    };
+
+    struct Block
+    {
+        int64_t offset;
+        int32_t metaDataLength;
+        int32_t padding;
+        int64_t bodyLength;
+    };
+
+    static_assert(sizeof(FieldNode) == 16 && sizeof(BufferRegion) == 16 && sizeof(Block) == 24, "unexpected struct padding");
+
+    size_t PaddedSize(size_t size)
+    {
+        return (size + 7) / 8 * 8;
+    }
+
+    // 書き出し位置を追跡する出力ストリーム
+    class IpcOutput
+    {
+    public:
+        explicit IpcOutput(const std::string& path)
+            : file(path, std::ios::binary | std::ios::trunc)
+            , position(0)
+        {
+        }
+
+        bool IsOpen() const { return file.is_open(); }
+        bool IsGood() const { return file.good(); }
+        int64_t GetPosition() const { return position; }
+
+        void Write(const void* data, size_t size)
+        {
+            file.write(static_cast<const char*>(data), size);
+            position += static_cast<int64_t>(size);
+        }
+
+        // 8 バイト境界まで 0 で埋める
+        void Pad()
+        {
+            static const char zeros[8] = {};
+            Write(zeros, PaddedSize(static_cast<size_t>(position)) - static_cast<size_t>(position));
+        }
+
+        // カプセル化メッセージのメタデータ部を書き出し、先頭 8 バイトを含む長さを返す
+        int32_t WriteMetadata(const std::string& metadata)
+        {
+            const int32_t length = static_cast<int32_t>(PaddedSize(metadata.size()));
+            Write(&continuationMarker, sizeof(uint32_t));
+            Write(&length, sizeof(int32_t));
+            Write(metadata.data(), metadata.size());
+            Pad();
+            return length + 8;
+        }
+
+    private:
+        std::ofstream file;
+        int64_t position;
+    };
+
+    Offset BuildSchema(FlatBufferBuilder& builder, const std::vector<ArrowField>& schema)
+    {
+        std::vector<Offset> fields;
+        for (const auto& field : schema)
+        {
+            Offset name = builder.CreateString(field.name);
+            Offset children = builder.CreateOffsetVector({});
+
+            uint8_t typeType = typeUtf8;
+            builder.StartTable();
+            if (field.type == ArrowType::Int64)
+            {
+                typeType = typeInt;
+                builder.AddField<int32_t>(0, 64);
+                builder.AddField<uint8_t>(1, 1);
+            }
+            else if (field.type == ArrowType::Float64)
+            {
+                typeType = typeFloatingPoint;
+                builder.AddField<int16_t>(0, precisionDouble);
+            }
+            Offset type = builder.EndTable();
+
+            builder.StartTable();
+            builder.AddOffsetField(0, name);
+            builder.AddField<uint8_t>(1, 1);
+            builder.AddField<uint8_t>(2, typeType);
+            builder.AddOffsetField(3, type);
+            builder.AddOffsetField(5, children);
+            fields.push_back(builder.EndTable());
+        }
+        Offset fieldVector = builder.CreateOffsetVector(fields);
+
+        builder.StartTable();
+        builder.AddField<int16_t>(0, 0); // リトルエンディアン
+        builder.AddOffsetField(1, fieldVector);
+        return builder.EndTable();
+    }
+
+    std::string FinishMessage(FlatBufferBuilder& builder, uint8_t headerType, Offset header, int64_t bodyLength)
+    {
+        builder.StartTable();
+        builder.AddField<int16_t>(0, metadataVersionV5);
+        builder.AddField<uint8_t>(1, headerType);
+        builder.AddOffsetField(2, header);
+        builder.AddField<int64_t>(3, bodyLength);
+        return builder.Finish(builder.EndTable());
+    }
+
+    Block WriteRecordBatch(IpcOutput& output, const std::vector<ArrowField>& schema, const ArrowRecordBatch& batch)
+    {
+        std::vector<FieldNode> nodes;
+        std::vector<BufferRegion> regions;
+        std::vector<const std::string*> buffers;
+        int64_t bodyLength = 0;
+        auto addBuffer = [&](const std::string& buffer) {
+            regions.push_back({ bodyLength, static_cast<int64_t>(buffer.size()) });
+            buffers.push_back(&buffer);
+            bodyLength += static_cast<int64_t>(PaddedSize(buffer.size()));
+        };
+        for (size_t c = 0; c < schema.size(); ++c)
+        {
+            const ArrowArray& array = batch.columns[c];
+            nodes.push_back({ array.length, array.nullCount });
+            addBuffer(array.validity);
+            if (schema[c].type == ArrowType::Utf8)
+            {
+                addBuffer(array.offsets);
+            }
+            addBuffer(array.values);
+        }
+
+        FlatBufferBuilder builder;
+        Offset nodeVector = builder.CreateStructVector(nodes);
+        Offset bufferVector = builder.CreateStructVector(regions);
+        builder.StartTable();
+        builder.AddField<int64_t>(0, batch.length);
+        builder.AddOffsetField(1, nodeVector);
+        builder.AddOffsetField(2, bufferVector);
+        Offset header = builder.EndTable();
+
+        Block block = {};
+        block.offset = output.GetPosition();
+        block.metaDataLength = output.WriteMetadata(FinishMessage(builder, headerRecordBatch, header, bodyLength));
+        block.bodyLength = bodyLength;
+
+        // 本体はバッファをそのまま 8 バイト境界に揃えて並べる
+        for (const std::string* buffer : buffers)
+        {
+            output.Write(buffer->data(), buffer->size());
+            output.Pad();
+        }
+        return block;
+    }
+
+    bool WriteIpc(const std::string& path, const ArrowTable& table, bool fileFormat)
+    {
+        for (const auto& batch : table.batches)
+        {
+            if (batch.columns.size() != table.schema.size())
+            {
+                return false;
+            }
+        }
+
+        IpcOutput output(path);
+        if (!output.IsOpen())
+        {
+            return false;
+        }
+        if (fileFormat)
+        {
+            output.Write(fileMagic, sizeof(fileMagic));
+            output.Pad();
+        }
+
+        {
+            FlatBufferBuilder builder;
+            Offset schema = BuildSchema(builder, table.schema);
+            output.WriteMetadata(FinishMessage(builder, headerSchema, schema, 0));
+        }
+
+        std::vector<Block> blocks;
+        for (const auto& batch : table.batches)
+        {
+            blocks.push_back(WriteRecordBatch(output, table.schema, batch));
+        }
+
+        // ストリーム終端
+        const int32_t endOfStream = 0;
+        output.Write(&continuationMarker, sizeof(uint32_t));
+        output.Write(&endOfStream, sizeof(int32_t));
+
+        if (fileFormat)
+        {
+            FlatBufferBuilder builder;
+            Offset schema = BuildSchema(builder, table.schema);
+            Offset dictionaries = builder.CreateStructVector(std::vector<Block>());
+            Offset recordBatches = builder.CreateStructVector(blocks);
+            builder.StartTable();
+            builder.AddField<int16_t>(0, metadataVersionV5);
+            builder.AddOffsetField(1, schema);
+            builder.AddOffsetField(2, dictionaries);
+            builder.AddOffsetField(3, recordBatches);
+            std::string footer = builder.Finish(builder.EndTable());
+
+            const int32_t footerLength = static_cast<int32_t>(footer.size());
+            output.Write(footer.data(), footer.size());
+            output.Write(&footerLength, sizeof(int32_t));
+            output.Write(fileMagic, sizeof(fileMagic));
+        }
+        return output.IsGood();
+    }
+
+    // IPC 上の列の型（読み込み時にこのプログラムの型へ変換する）
+    struct SourceField
+    {
+        uint8_t typeType = 0;
+        int32_t bitWidth = 0;
+        bool isSigned = true;
+        int16_t precision = precisionDouble;
+    };
+
+    bool ParseSchema(const FlatBufferTable& schema, std::vector<ArrowField>& fields, std::vector<SourceField>& sources)
+    {
+        if (!schema.IsValid() || schema.GetField<int16_t>(0, 0) != 0)
+        {
+            return false;
+        }
+        size_t count = 0;
+        size_t elements = 0;
+        if (!schema.GetVector(1, sizeof(uint32_t), count, elements))
+        {
+            return false;
+        }
+
+        fields.assign(count, ArrowField());
+        sources.assign(count, SourceField());
+        for (size_t i = 0; i < count; ++i)
+        {
+            FlatBufferTable field = schema.GetVectorTable(elements, i);
+            if (!field.IsValid() || field.GetTable(4).IsValid())
+            {
+                return false; // 辞書符号化は未対応
+            }
+            field.GetString(0, fields[i].name);
+
+            SourceField& source = sources[i];
+            source.typeType = field.GetField<uint8_t>(2, 0);
+            FlatBufferTable type = field.GetTable(3);
+            switch (source.typeType)
+            {
+            case typeInt:
+                source.bitWidth = type.GetField<int32_t>(0, 0);
+                source.isSigned = type.GetField<uint8_t>(1, 0) != 0;
+                if (source.bitWidth != 8 && source.bitWidth != 16 && source.bitWidth != 32 && source.bitWidth != 64)
+                {
+                    return false;
+                }
+                // 符号なし 64 ビット整数は Int64 に収まらないため文字列として扱う
+                fields[i].type = (source.isSigned || source.bitWidth < 64) ? ArrowType::Int64 : ArrowType::Utf8;
+                break;
+            case typeFloatingPoint:
+                source.precision = type.GetField<int16_t>(0, 0);
+                if (source.precision != precisionSingle && source.precision != precisionDouble)
+                {
+                    return false;
+                }
+                fields[i].type = ArrowType::Float64;
+                break;
+            case typeBool:
+            case typeUtf8:
+            case typeLargeUtf8:
+                fields[i].type = ArrowType::Utf8;
+                break;
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // カプセル化メッセージ
+    struct MessageView
+    {
+        FlatBufferTable message;
+        uint8_t headerType = 0;
+        const char* body = nullptr;
+        int64_t bodyLength = 0;
+        size_t next = 0;
+        bool endOfStream = false;
+    };
+
+    bool ReadMessage(const char* data, size_t size, size_t at, MessageView& view)
+    {
+        uint32_t marker = 0;
+        int32_t metadataLength = 0;
+        size_t metadataStart = at + sizeof(uint32_t);
+        if (at > size || size - at < sizeof(uint32_t))
+        {
+            return false;
+        }
+        std::memcpy(&marker, data + at, sizeof(uint32_t));
+        if (marker == continuationMarker)
+        {
+            if (size - metadataStart < sizeof(int32_t))
+            {
+                return false;
+            }
+            std::memcpy(&metadataLength, data + metadataStart, sizeof(int32_t));
+            metadataStart += sizeof(int32_t);
+        }
+        else
+        {
+            // 旧形式（継続マーカーなし）
+            metadataLength = static_cast<int32_t>(marker);
+        }
+
+        if (metadataLength == 0)
+        {
+            view.endOfStream = true;
+            return true;
+        }
+        if (metadataLength < 0 || static_cast<size_t>(metadataLength) > size - metadataStart)
+        {
+            return false;
+        }
+
+        view.message = FlatBufferTable::Root(data + metadataStart, static_cast<size_t>(metadataLength));
+        if (!view.message.IsValid() || view.message.GetField<int16_t>(0, 0) < metadataVersionV4)
+        {
+            return false;
+        }
+        view.headerType = view.message.GetField<uint8_t>(1, 0);
+        view.bodyLength = view.message.GetField<int64_t>(3, 0);
+
+        const size_t bodyStart = metadataStart + static_cast<size_t>(metadataLength);
+        if (view.bodyLength < 0 || static_cast<uint64_t>(view.bodyLength) > size - bodyStart)
+        {
+            return false;
+        }
+        view.body = data + bodyStart;
+        view.next = bodyStart + static_cast<size_t>(view.bodyLength);
+        view.endOfStream = false;
+        return true;
+    }
+
+    template <typename T>
+    T LoadValue(const char* data, int64_t index)
+    {
+        T value;
+        std::memcpy(&value, data + index * static_cast<int64_t>(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    void AppendValue(std::string& buffer, T value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    bool ReadIntegers(const SourceField& source, const char* values, int64_t length, std::string& output)
+    {
+        output.reserve(static_cast<size_t>(length) * sizeof(int64_t));
+        for (int64_t i = 0; i < length; ++i)
+        {
+            int64_t value = 0;
+            switch (source.bitWidth)
+            {
+            case 8: value = source.isSigned ? LoadValue<int8_t>(values, i) : LoadValue<uint8_t>(values, i); break;
+            case 16: value = source.isSigned ? LoadValue<int16_t>(values, i) : LoadValue<uint16_t>(values, i); break;
+            case 32: value = source.isSigned ? LoadValue<int32_t>(values, i) : LoadValue<uint32_t>(values, i); break;
+            default: value = LoadValue<int64_t>(values, i); break;
+            }
+            AppendValue(output, value);
+        }
+        return true;
+    }
+
+    // 文字列以外の列を文字列配列として組み立てる（真偽値・符号なし 64 ビット整数）
+    template <typename Format>
+    void BuildTextArray(int64_t length, const ArrowArray& array, std::string& offsets, std::string& values, Format format)
+    {
+        std::string cell;
+        AppendValue(offsets, int32_t(0));
+        for (int64_t i = 0; i < length; ++i)
+        {
+            if (array.IsValid(i))
+            {
+                format(i, cell);
+                values.append(cell);
+            }
+            AppendValue(offsets, static_cast<int32_t>(values.size()));
+        }
+    }
+
+    template <typename OffsetType>
+    bool ReadStrings(const char* offsets, int64_t offsetsSize, const char* data, int64_t dataSize, int64_t length, ArrowArray& array)
+    {
+        if (offsetsSize < (length + 1) * static_cast<int64_t>(sizeof(OffsetType)))
+        {
+            return false;
+        }
+        const int64_t first = static_cast<int64_t>(LoadValue<OffsetType>(offsets, 0));
+        const int64_t last = static_cast<int64_t>(LoadValue<OffsetType>(offsets, length));
+        if (first < 0 || last < first || last > dataSize || last - first > INT32_MAX)
+        {
+            return false;
+        }
+
+        // 切り出された配列でも先頭が 0 になるようオフセットを振り直す
+        array.offsets.reserve(static_cast<size_t>(length + 1) * sizeof(int32_t));
+        int64_t previous = first;
+        for (int64_t i = 0; i <= length; ++i)
+        {
+            int64_t offset = static_cast<int64_t>(LoadValue<OffsetType>(offsets, i));
+            if (offset < previous || offset > last)
+            {
+                return false;
+            }
+            AppendValue(array.offsets, static_cast<int32_t>(offset - first));
+            previous = offset;
+        }
+        array.values.assign(data + first, static_cast<size_t>(last - first));
+        return true;
+    }
+
+    bool ReadArray(const SourceField& source, const FieldNode& node, const char* const* buffers, const int64_t* sizes, ArrowArray& array)
+    {
+        const int64_t length = node.length;
+        array.length = length;
+        array.nullCount = node.nullCount;
+        if (length < 0 || node.nullCount < 0 || node.nullCount > length)
+        {
+            return false;
+        }
+        if (node.nullCount > 0)
+        {
+            const int64_t bitmapSize = (length + 7) / 8;
+            if (sizes[0] < bitmapSize)
+            {
+                return false;
+            }
+            array.validity.assign(buffers[0], static_cast<size_t>(bitmapSize));
+        }
+
+        switch (source.typeType)
+        {
+        case typeInt:
+            if (sizes[1] < length * (source.bitWidth / 8))
+            {
+                return false;
+            }
+            if (!source.isSigned && source.bitWidth == 64)
+            {
+                BuildTextArray(length, array, array.offsets, array.values, [&](int64_t i, std::string& cell) {
+                    cell = std::to_string(LoadValue<uint64_t>(buffers[1], i));
+                });
+                return true;
+            }
+            if (source.isSigned && source.bitWidth == 64)
+            {
+                array.values.assign(buffers[1], static_cast<size_t>(length) * sizeof(int64_t));
+                return true;
+            }
+            return ReadIntegers(source, buffers[1], length, array.values);
+        case typeFloatingPoint:
+            if (source.precision == precisionDouble)
+            {
+                if (sizes[1] < length * static_cast<int64_t>(sizeof(double)))
+                {
+                    return false;
+                }
+                array.values.assign(buffers[1], static_cast<size_t>(length) * sizeof(double));
+                return true;
+            }
+            if (sizes[1] < length * static_cast<int64_t>(sizeof(float)))
+            {
+                return false;
+            }
+            array.values.reserve(static_cast<size_t>(length) * sizeof(double));
+            for (int64_t i = 0; i < length; ++i)
+            {
+                AppendValue(array.values, static_cast<double>(LoadValue<float>(buffers[1], i)));
+            }
+            return true;
+        case typeBool:
+            if (sizes[1] < (length + 7) / 8)
+            {
+                return false;
+            }
+            BuildTextArray(length, array, array.offsets, array.values, [&](int64_t i, std::string& cell) {
+                cell = (buffers[1][i / 8] & (1 << (i % 8))) ? "true" : "false";
+            });
+            return true;
+        case typeUtf8:
+            return ReadStrings<int32_t>(buffers[1], sizes[1], buffers[2], sizes[2], length, array);
+        case typeLargeUtf8:
+            return ReadStrings<int64_t>(buffers[1], sizes[1], buffers[2], sizes[2], length, array);
+        }
+        return false;
+    }
+
+    bool ParseRecordBatch(const MessageView& view, const std::vector<SourceField>& sources, ArrowRecordBatch& batch)
+    {
+        if (view.headerType != headerRecordBatch)
+        {
+            return false;
+        }
+        FlatBufferTable header = view.message.GetTable(2);
+        if (!header.IsValid() || header.GetTable(3).IsValid())
+        {
+            return false; // 本体圧縮は未対応
+        }
+        batch.length = header.GetField<int64_t>(0, 0);
+        if (sources.empty())
+        {
+            batch.length = 0; // 列の無いバッチは行数を検証できないため空として扱う
+        }
+
+        size_t nodeCount = 0, nodeElements = 0, bufferCount = 0, bufferElements = 0;
+        if (!header.GetVector(1, sizeof(FieldNode), nodeCount, nodeElements)
+            || !header.GetVector(2, sizeof(BufferRegion), bufferCount, bufferElements)
+            || nodeCount != sources.size())
+        {
+            return false;
+        }
+
+        batch.columns.assign(sources.size(), ArrowArray());
+        size_t bufferIndex = 0;
+        for (size_t c = 0; c < sources.size(); ++c)
+        {
+            FieldNode node;
+            if (!header.ReadAt(nodeElements + c * sizeof(FieldNode), node) || node.length != batch.length)
+            {
+                return false;
+            }
+
+            const size_t bufferUsed = (sources[c].typeType == typeUtf8 || sources[c].typeType == typeLargeUtf8) ? 3 : 2;
+            const char* buffers[3] = {};
+            int64_t sizes[3] = {};
+            for (size_t b = 0; b < bufferUsed; ++b, ++bufferIndex)
+            {
+                BufferRegion region;
+                if (bufferIndex >= bufferCount || !header.ReadAt(bufferElements + bufferIndex * sizeof(BufferRegion), region)
+                    || region.offset < 0 || region.length < 0 || region.offset > view.bodyLength
+                    || region.length > view.bodyLength - region.offset)
+                {
+                    return false;
+                }
+                buffers[b] = view.body + region.offset;
+                sizes[b] = region.length;
+            }
+            if (!ReadArray(sources[c], node, buffers, sizes, batch.columns[c]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool ReadIpcFile(const char* data, size_t size, ArrowTable& table)
+    {
+        const size_t trailerSize = sizeof(int32_t) + sizeof(fileMagic);
+        if (size < 8 + trailerSize || std::memcmp(data + size - sizeof(fileMagic), fileMagic, sizeof(fileMagic)) != 0)
+        {
+            return false;
+        }
+        int32_t footerLength = 0;
+        std::memcpy(&footerLength, data + size - trailerSize, sizeof(int32_t));
+        if (footerLength <= 0 || static_cast<size_t>(footerLength) > size - 8 - trailerSize)
+        {
+            return false;
+        }
+
+        FlatBufferTable footer = FlatBufferTable::Root(data + size - trailerSize - footerLength, static_cast<size_t>(footerLength));
+        std::vector<SourceField> sources;
+        if (!footer.IsValid() || !ParseSchema(footer.GetTable(1), table.schema, sources))
+        {
+            return false;
+        }
+
+        size_t dictionaryCount = 0, blockCount = 0, dictionaryElements = 0, blockElements = 0;
+        if (!footer.GetVector(2, sizeof(Block), dictionaryCount, dictionaryElements) || dictionaryCount != 0
+            || !footer.GetVector(3, sizeof(Block), blockCount, blockElements))
+        {
+            return false;
+        }
+
+        // フッターのブロック一覧から各レコードバッチを独立に、並列に読み込む
+        table.batches.assign(blockCount, ArrowRecordBatch());
+        std::vector<char> succeeded(blockCount, 0);
+        ParallelFor(blockCount, [&](size_t b) {
+            Block block;
+            MessageView view;
+            if (footer.ReadAt(blockElements + b * sizeof(Block), block) && block.offset >= 0
+                && ReadMessage(data, size, static_cast<size_t>(block.offset), view) && !view.endOfStream)
+            {
+                succeeded[b] = ParseRecordBatch(view, sources, table.batches[b]) ? 1 : 0;
+            }
+        });
+        return std::find(succeeded.begin(), succeeded.end(), 0) == succeeded.end();
+    }
+
+    bool ReadIpcStream(const char* data, size_t size, ArrowTable& table)
+    {
+        MessageView view;
+        std::vector<SourceField> sources;
+        if (!ReadMessage(data, size, 0, view) || view.endOfStream || view.headerType != headerSchema
+            || !ParseSchema(view.message.GetTable(2), table.schema, sources))
+        {
+            return false;
+        }
+
+        table.batches.clear();
+        size_t position = view.next;
+        while (position < size)
+        {
+            if (!ReadMessage(data, size, position, view))
+            {
+                return false;
+            }
+            if (view.endOfStream)
+            {
+                break;
+            }
+            table.batches.emplace_back();
+            if (!ParseRecordBatch(view, sources, table.batches.back()))
+            {
+                return false;
+            }
+            position = view.next;
+        }
+        return true;
+    }
+}
+
+bool IsArrowFilePath(const std::string& path)
+{
+    for (const std::string extension : { ".arrow", ".arrows", ".feather" })
+    {
+        if (path.size() >= extension.size()
+            && path.compare(path.size() - extension.size(), extension.size(), extension) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool WriteArrowIpcFile(const std::string& path, const ArrowTable& table)
+{
+    return WriteIpc(path, table, true);
+}
+
+bool WriteArrowIpcStream(const std::string& path, const ArrowTable& table)
+{
+    return WriteIpc(path, table, false);
+}
+
+bool ReadArrowIpc(const std::string& path, ArrowTable& table)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    table = ArrowTable();
+    if (file.GetSize() >= sizeof(fileMagic) && std::memcmp(file.GetData(), fileMagic, sizeof(fileMagic)) == 0)
+    {
+        return ReadIpcFile(file.GetData(), file.GetSize(), table);
+    }
+    return ReadIpcStream(file.GetData(), file.GetSize(), table);
+}
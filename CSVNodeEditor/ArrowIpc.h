@@ -0,0 +1,17 @@
+﻿#pragma once
+
+#include "ArrowFormat.h"
+#include <string>
+
+// Arrow IPC ファイル形式（.arrow / .feather）で書き出す
+bool WriteArrowIpcFile(const std::string& path, const ArrowTable& table);
+
+// Arrow IPC ストリーム形式（.arrows）で書き出す
+bool WriteArrowIpcStream(const std::string& path, const ArrowTable& table);
+
+// Arrow IPC のファイル形式・ストリーム形式を先頭のマジックで判別して読み込む
+// 整数・小数・真偽値・文字列の列に対応し、辞書符号化・圧縮・入れ子の型は失敗として扱う。
+bool ReadArrowIpc(const std::string& path, ArrowTable& table);
+
+// パスが Arrow IPC の拡張子を持つか
+bool IsArrowFilePath(const std::string& path);
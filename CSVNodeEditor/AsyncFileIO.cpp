@@ -0,0 +1,930 @@
+﻿#include "AsyncFileIO.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <new>
+#include <thread>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define NSYS_HAS_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+// 位置指定で読み書きできるファイル
+class NativeFile
+{
+public:
+    NativeFile();
+    ~NativeFile();
+
+    bool OpenRead(const std::string& filename);
+    bool OpenWrite(const std::string& filename);
+    bool Close();
+
+    uint64_t GetSize() const { return size; }
+
+    // 読み書きしたバイト数を返す（失敗時は負の値）
+    int64_t ReadAt(char* buffer, size_t count, uint64_t offset);
+    int64_t WriteAt(const char* buffer, size_t count, uint64_t offset);
+
+#ifndef _WIN32
+    int GetDescriptor() const { return descriptor; }
+#endif
+
+private:
+    uint64_t size;
+#ifdef _WIN32
+    void* handle;
+#else
+    int descriptor;
+#endif
+};
+
+// 読み書き要求のキュー
+// tag は呼び出し側のブロック番号で、同時に発行する要求の数（queueDepth）未満とする。
+struct AsyncIoRequest
+{
+    size_t tag;
+    bool write;
+    char* buffer;
+    size_t size;
+    uint64_t offset;
+};
+
+class AsyncIoQueue
+{
+public:
+    virtual ~AsyncIoQueue() = default;
+    virtual AsyncIoBackend GetBackend() const = 0;
+    virtual bool Submit(const AsyncIoRequest& request) = 0;
+
+    // いずれか 1 つの要求の完了を待つ（result は転送したバイト数、失敗時は負の値）
+    virtual bool WaitCompletion(size_t& tag, int64_t& result) = 0;
+};
+
+namespace
+{
+    // O_DIRECT やセクター境界に合わせられるよう、ブロックはページ境界に置く
+    const size_t blockAlignment = 4096;
+
+    size_t AlignBlockSize(size_t size)
+    {
+        size = std::max(size, blockAlignment);
+        return (size + blockAlignment - 1) / blockAlignment * blockAlignment;
+    }
+
+    char* AllocateBlock(size_t size)
+    {
+        return static_cast<char*>(::operator new(size, std::align_val_t(blockAlignment)));
+    }
+
+    void FreeBlock(char* block)
+    {
+        ::operator delete(block, std::align_val_t(blockAlignment));
+    }
+
+    // 短い読み込みを繰り返して count バイトまたは終端まで読む
+    int64_t ReadFully(NativeFile& file, char* buffer, size_t count, uint64_t offset)
+    {
+        size_t total = 0;
+        while (total < count)
+        {
+            int64_t read = file.ReadAt(buffer + total, count - total, offset + total);
+            if (read < 0)
+            {
+                return -1;
+            }
+            if (read == 0)
+            {
+                break;
+            }
+            total += static_cast<size_t>(read);
+        }
+        return static_cast<int64_t>(total);
+    }
+
+    int64_t WriteFully(NativeFile& file, const char* buffer, size_t count, uint64_t offset)
+    {
+        size_t total = 0;
+        while (total < count)
+        {
+            int64_t written = file.WriteAt(buffer + total, count - total, offset + total);
+            if (written <= 0)
+            {
+                return -1;
+            }
+            total += static_cast<size_t>(written);
+        }
+        return static_cast<int64_t>(total);
+    }
+
+    // ワーカースレッドで位置指定の読み書きを行うキュー
+    class ThreadPoolQueue : public AsyncIoQueue
+    {
+    public:
+        ThreadPoolQueue(NativeFile& file, size_t threadCount)
+            : file(file)
+            , stopping(false)
+        {
+            for (size_t i = 0; i < threadCount; ++i)
+            {
+                threads.emplace_back([this]() { Run(); });
+            }
+        }
+
+        ~ThreadPoolQueue() override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            requestReady.notify_all();
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        AsyncIoBackend GetBackend() const override
+        {
+            return AsyncIoBackend::ThreadPool;
+        }
+
+        bool Submit(const AsyncIoRequest& request) override
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                requests.push_back(request);
+            }
+            requestReady.notify_one();
+            return true;
+        }
+
+        bool WaitCompletion(size_t& tag, int64_t& result) override
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            completionReady.wait(lock, [this]() { return !completions.empty(); });
+            tag = completions.front().first;
+            result = completions.front().second;
+            completions.pop_front();
+            return true;
+        }
+
+    private:
+        NativeFile& file;
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable requestReady;
+        std::condition_variable completionReady;
+        std::deque<AsyncIoRequest> requests;
+        std::deque<std::pair<size_t, int64_t>> completions;
+        bool stopping;
+
+        void Run()
+        {
+            while (true)
+            {
+                AsyncIoRequest request;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    requestReady.wait(lock, [this]() { return stopping || !requests.empty(); });
+                    if (requests.empty())
+                    {
+                        return;
+                    }
+                    request = requests.front();
+                    requests.pop_front();
+                }
+
+                int64_t result = request.write
+                    ? WriteFully(file, request.buffer, request.size, request.offset)
+                    : ReadFully(file, request.buffer, request.size, request.offset);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    completions.emplace_back(request.tag, result);
+                }
+                completionReady.notify_one();
+            }
+        }
+    };
+
+#ifdef NSYS_HAS_IO_URING
+
+    // io_uring の送信・完了リングを直接操作するキュー
+    // 送信と完了の刈り取りは所有者のスレッドだけが行うため、リングのロックは不要。
+    class IoUringQueue : public AsyncIoQueue
+    {
+    public:
+        IoUringQueue()
+            : ringDescriptor(-1)
+            , fileDescriptor(-1)
+            , sqRing(nullptr)
+            , sqRingSize(0)
+            , cqRing(nullptr)
+            , cqRingSize(0)
+            , sqes(nullptr)
+            , sqesSize(0)
+            , sqTail(nullptr)
+            , sqMask(nullptr)
+            , sqArray(nullptr)
+            , cqHead(nullptr)
+            , cqTail(nullptr)
+            , cqMask(nullptr)
+            , cqes(nullptr)
+        {
+        }
+
+        ~IoUringQueue() override
+        {
+            if (sqes)
+            {
+                ::munmap(sqes, sqesSize);
+            }
+            if (cqRing && cqRing != sqRing)
+            {
+                ::munmap(cqRing, cqRingSize);
+            }
+            if (sqRing)
+            {
+                ::munmap(sqRing, sqRingSize);
+            }
+            if (ringDescriptor >= 0)
+            {
+                ::close(ringDescriptor);
+            }
+        }
+
+        // カーネルが io_uring に対応していない（またはコンテナで禁止されている）場合は false
+        bool Initialize(int descriptor, size_t depth)
+        {
+            io_uring_params params;
+            std::memset(&params, 0, sizeof(params));
+            unsigned entries = 1;
+            while (entries < depth)
+            {
+                entries <<= 1;
+            }
+            int ring = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+            if (ring < 0)
+            {
+                return false;
+            }
+            ringDescriptor = ring;
+            fileDescriptor = descriptor;
+
+            sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+            if (singleMap)
+            {
+                sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+            }
+
+            sqRing = MapRing(sqRingSize, IORING_OFF_SQ_RING);
+            if (!sqRing)
+            {
+                return false;
+            }
+            cqRing = singleMap ? sqRing : MapRing(cqRingSize, IORING_OFF_CQ_RING);
+            if (!cqRing)
+            {
+                return false;
+            }
+            sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+            sqes = static_cast<io_uring_sqe*>(MapRing(sqesSize, IORING_OFF_SQES));
+            if (!sqes)
+            {
+                return false;
+            }
+
+            char* sq = static_cast<char*>(sqRing);
+            char* cq = static_cast<char*>(cqRing);
+            sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            vectors.resize(depth);
+            return true;
+        }
+
+        AsyncIoBackend GetBackend() const override
+        {
+            return AsyncIoBackend::IoUring;
+        }
+
+        bool Submit(const AsyncIoRequest& request) override
+        {
+            // iovec は完了まで参照されるため、ブロック番号ごとに保持しておく
+            iovec& vector = vectors[request.tag];
+            vector.iov_base = request.buffer;
+            vector.iov_len = request.size;
+
+            const unsigned tail = *sqTail;
+            const unsigned index = tail & *sqMask;
+            io_uring_sqe& sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = request.write ? IORING_OP_WRITEV : IORING_OP_READV;
+            sqe.fd = fileDescriptor;
+            sqe.addr = reinterpret_cast<uint64_t>(&vector);
+            sqe.len = 1;
+            sqe.off = request.offset;
+            sqe.user_data = request.tag;
+            sqArray[index] = index;
+            __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+            while (true)
+            {
+                int submitted = static_cast<int>(::syscall(__NR_io_uring_enter, ringDescriptor, 1, 0, 0, nullptr, 0));
+                if (submitted >= 0)
+                {
+                    return submitted == 1;
+                }
+                if (errno != EINTR)
+                {
+                    return false;
+                }
+            }
+        }
+
+        bool WaitCompletion(size_t& tag, int64_t& result) override
+        {
+            while (true)
+            {
+                const unsigned head = *cqHead;
+                const unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+                if (head != tail)
+                {
+                    const io_uring_cqe& cqe = cqes[head & *cqMask];
+                    tag = static_cast<size_t>(cqe.user_data);
+                    result = cqe.res;
+                    __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+                    return true;
+                }
+                int waited = static_cast<int>(::syscall(__NR_io_uring_enter, ringDescriptor, 0, 1,
+                    IORING_ENTER_GETEVENTS, nullptr, 0));
+                if (waited < 0 && errno != EINTR)
+                {
+                    return false;
+                }
+            }
+        }
+
+    private:
+        int ringDescriptor;
+        int fileDescriptor;
+        void* sqRing;
+        size_t sqRingSize;
+        void* cqRing;
+        size_t cqRingSize;
+        io_uring_sqe* sqes;
+        size_t sqesSize;
+        unsigned* sqTail;
+        unsigned* sqMask;
+        unsigned* sqArray;
+        unsigned* cqHead;
+        unsigned* cqTail;
+        unsigned* cqMask;
+        io_uring_cqe* cqes;
+        std::vector<iovec> vectors;
+
+        void* MapRing(size_t size, off_t offset)
+        {
+            void* mapped = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringDescriptor, offset);
+            return mapped == MAP_FAILED ? nullptr : mapped;
+        }
+    };
+
+#endif
+
+    std::unique_ptr<AsyncIoQueue> CreateQueue(NativeFile& file, const AsyncIoOptions& options, size_t depth)
+    {
+#ifdef NSYS_HAS_IO_URING
+        if (options.useIoUring)
+        {
+            auto ring = std::make_unique<IoUringQueue>();
+            if (ring->Initialize(file.GetDescriptor(), depth))
+            {
+                return ring;
+            }
+        }
+#else
+        (void)options;
+#endif
+        return std::make_unique<ThreadPoolQueue>(file, depth);
+    }
+}
+
+// ==================== NativeFile ====================
+
+#ifdef _WIN32
+
+NativeFile::NativeFile()
+    : size(0)
+    , handle(nullptr)
+{
+}
+
+bool NativeFile::OpenRead(const std::string& filename)
+{
+    std::filesystem::path path(filename);
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+    handle = file;
+    size = static_cast<uint64_t>(fileSize.QuadPart);
+    return true;
+}
+
+bool NativeFile::OpenWrite(const std::string& filename)
+{
+    std::filesystem::path path(filename);
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+    handle = file;
+    size = 0;
+    return true;
+}
+
+bool NativeFile::Close()
+{
+    bool closed = true;
+    if (handle)
+    {
+        closed = CloseHandle(handle) != 0;
+    }
+    handle = nullptr;
+    size = 0;
+    return closed;
+}
+
+int64_t NativeFile::ReadAt(char* buffer, size_t count, uint64_t offset)
+{
+    // 同期ハンドルでも OVERLAPPED に位置を渡せば、スレッド間で共有できる位置指定読み込みになる
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD request = static_cast<DWORD>(std::min<size_t>(count, 1u << 30));
+    DWORD transferred = 0;
+    if (!ReadFile(handle, buffer, request, &transferred, &overlapped))
+    {
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+    return transferred;
+}
+
+int64_t NativeFile::WriteAt(const char* buffer, size_t count, uint64_t offset)
+{
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+    DWORD request = static_cast<DWORD>(std::min<size_t>(count, 1u << 30));
+    DWORD transferred = 0;
+    if (!WriteFile(handle, buffer, request, &transferred, &overlapped))
+    {
+        return -1;
+    }
+    return transferred;
+}
+
+#else
+
+NativeFile::NativeFile()
+    : size(0)
+    , descriptor(-1)
+{
+}
+
+bool NativeFile::OpenRead(const std::string& filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    descriptor = fd;
+    size = static_cast<uint64_t>(status.st_size);
+#ifdef POSIX_FADV_SEQUENTIAL
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return true;
+}
+
+bool NativeFile::OpenWrite(const std::string& filename)
+{
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+    {
+        return false;
+    }
+    descriptor = fd;
+    size = 0;
+    return true;
+}
+
+bool NativeFile::Close()
+{
+    bool closed = true;
+    if (descriptor >= 0)
+    {
+        closed = ::close(descriptor) == 0;
+    }
+    descriptor = -1;
+    size = 0;
+    return closed;
+}
+
+int64_t NativeFile::ReadAt(char* buffer, size_t count, uint64_t offset)
+{
+    while (true)
+    {
+        ssize_t read = ::pread(descriptor, buffer, count, static_cast<off_t>(offset));
+        if (read >= 0 || errno != EINTR)
+        {
+            return read;
+        }
+    }
+}
+
+int64_t NativeFile::WriteAt(const char* buffer, size_t count, uint64_t offset)
+{
+    while (true)
+    {
+        ssize_t written = ::pwrite(descriptor, buffer, count, static_cast<off_t>(offset));
+        if (written >= 0 || errno != EINTR)
+        {
+            return written;
+        }
+    }
+}
+
+#endif
+
+NativeFile::~NativeFile()
+{
+    Close();
+}
+
+// ==================== AsyncFileReader ====================
+
+AsyncFileReader::AsyncFileReader()
+    : blockSize(0)
+    , fileSize(0)
+    , nextOffset(0)
+    , nextSlot(0)
+    , recycleNeeded(false)
+    , failed(false)
+{
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    Close();
+}
+
+bool AsyncFileReader::Open(const std::string& filename, const AsyncIoOptions& options)
+{
+    Close();
+    failed = false;
+
+    auto opened = std::make_unique<NativeFile>();
+    if (!opened->OpenRead(filename))
+    {
+        return false;
+    }
+    file = std::move(opened);
+    fileSize = file->GetSize();
+    blockSize = AlignBlockSize(options.blockSize);
+
+    const size_t depth = std::max<size_t>(1, options.queueDepth);
+    queue = CreateQueue(*file, options, depth);
+    slots.resize(depth);
+    for (auto& slot : slots)
+    {
+        slot.buffer = AllocateBlock(blockSize);
+    }
+
+    // 先頭から queueDepth ブロック分の読み込みを発行しておく
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        Issue(i);
+    }
+    return true;
+}
+
+void AsyncFileReader::Close()
+{
+    // 発行済みの読み込みが終わるまではバッファを解放できない
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        WaitFor(i);
+    }
+    queue.reset();
+    for (auto& slot : slots)
+    {
+        FreeBlock(slot.buffer);
+    }
+    slots.clear();
+    file.reset();
+    fileSize = 0;
+    nextOffset = 0;
+    nextSlot = 0;
+    recycleNeeded = false;
+}
+
+AsyncIoBackend AsyncFileReader::GetBackend() const
+{
+    return queue ? queue->GetBackend() : AsyncIoBackend::ThreadPool;
+}
+
+void AsyncFileReader::Issue(size_t slotIndex)
+{
+    Slot& slot = slots[slotIndex];
+    slot.pending = false;
+    slot.completed = false;
+    if (failed || nextOffset >= fileSize)
+    {
+        return;
+    }
+
+    slot.offset = nextOffset;
+    slot.size = static_cast<size_t>(std::min<uint64_t>(blockSize, fileSize - nextOffset));
+    nextOffset += slot.size;
+    if (!queue->Submit(AsyncIoRequest{ slotIndex, false, slot.buffer, slot.size, slot.offset }))
+    {
+        failed = true;
+        return;
+    }
+    slot.pending = true;
+}
+
+void AsyncFileReader::WaitFor(size_t slotIndex)
+{
+    while (slots[slotIndex].pending && !slots[slotIndex].completed)
+    {
+        size_t tag = 0;
+        int64_t result = 0;
+        if (!queue->WaitCompletion(tag, result))
+        {
+            failed = true;
+            slots[slotIndex].pending = false;
+            return;
+        }
+        slots[tag].completed = true;
+        slots[tag].result = result;
+    }
+}
+
+bool AsyncFileReader::ReadBlock(const char*& data, size_t& size)
+{
+    if (!file || failed)
+    {
+        return false;
+    }
+
+    // 前回渡したブロックのバッファを、次の先読みに使い回す
+    if (recycleNeeded)
+    {
+        Issue((nextSlot + slots.size() - 1) % slots.size());
+        recycleNeeded = false;
+    }
+
+    Slot& slot = slots[nextSlot];
+    if (!slot.pending)
+    {
+        return false;
+    }
+    WaitFor(nextSlot);
+    if (failed)
+    {
+        return false;
+    }
+    slot.pending = false;
+    if (slot.result < 0)
+    {
+        failed = true;
+        return false;
+    }
+
+    // 途中までしか読めなかった場合は残りを同期的に読む
+    size_t received = static_cast<size_t>(slot.result);
+    if (received < slot.size)
+    {
+        int64_t rest = ReadFully(*file, slot.buffer + received, slot.size - received, slot.offset + received);
+        if (rest < 0 || received + static_cast<size_t>(rest) < slot.size)
+        {
+            // 読み込み中にファイルが短くなった
+            failed = true;
+            return false;
+        }
+    }
+
+    data = slot.buffer;
+    size = slot.size;
+    nextSlot = (nextSlot + 1) % slots.size();
+    recycleNeeded = true;
+    return true;
+}
+
+// ==================== AsyncFileWriter ====================
+
+AsyncFileWriter::AsyncFileWriter()
+    : blockSize(0)
+    , currentSlot(0)
+    , nextOffset(0)
+    , failed(false)
+{
+}
+
+AsyncFileWriter::~AsyncFileWriter()
+{
+    if (file)
+    {
+        Close();
+    }
+}
+
+bool AsyncFileWriter::Open(const std::string& filename, const AsyncIoOptions& options)
+{
+    if (file)
+    {
+        Close();
+    }
+    failed = false;
+
+    auto opened = std::make_unique<NativeFile>();
+    if (!opened->OpenWrite(filename))
+    {
+        return false;
+    }
+    file = std::move(opened);
+    blockSize = AlignBlockSize(options.blockSize);
+
+    const size_t depth = std::max<size_t>(1, options.queueDepth);
+    queue = CreateQueue(*file, options, depth);
+    slots.resize(depth);
+    for (auto& slot : slots)
+    {
+        slot.buffer = AllocateBlock(blockSize);
+    }
+    currentSlot = 0;
+    nextOffset = 0;
+    return true;
+}
+
+bool AsyncFileWriter::Write(const char* data, size_t size)
+{
+    if (!file)
+    {
+        return false;
+    }
+    while (size > 0 && !failed)
+    {
+        Slot& slot = slots[currentSlot];
+        size_t count = std::min(size, blockSize - slot.size);
+        std::memcpy(slot.buffer + slot.size, data, count);
+        slot.size += count;
+        data += count;
+        size -= count;
+        if (slot.size == blockSize)
+        {
+            Flush();
+        }
+    }
+    return !failed;
+}
+
+bool AsyncFileWriter::Close()
+{
+    if (!file)
+    {
+        return false;
+    }
+    Flush();
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        WaitFor(i);
+    }
+    queue.reset();
+    if (!file->Close())
+    {
+        failed = true;
+    }
+    Release();
+    return !failed;
+}
+
+AsyncIoBackend AsyncFileWriter::GetBackend() const
+{
+    return queue ? queue->GetBackend() : AsyncIoBackend::ThreadPool;
+}
+
+bool AsyncFileWriter::Flush()
+{
+    Slot& slot = slots[currentSlot];
+    if (slot.size == 0 || failed)
+    {
+        return !failed;
+    }
+
+    slot.offset = nextOffset;
+    slot.completed = false;
+    nextOffset += slot.size;
+    if (!queue->Submit(AsyncIoRequest{ currentSlot, true, slot.buffer, slot.size, slot.offset }))
+    {
+        failed = true;
+        return false;
+    }
+    slot.pending = true;
+
+    // 次に詰めるブロックの書き込みが終わっていなければ待つ
+    currentSlot = (currentSlot + 1) % slots.size();
+    WaitFor(currentSlot);
+    return !failed;
+}
+
+void AsyncFileWriter::WaitFor(size_t slotIndex)
+{
+    while (slots[slotIndex].pending && !slots[slotIndex].completed)
+    {
+        size_t tag = 0;
+        int64_t result = 0;
+        if (!queue->WaitCompletion(tag, result))
+        {
+            failed = true;
+            slots[slotIndex].pending = false;
+            return;
+        }
+        slots[tag].completed = true;
+        slots[tag].result = result;
+    }
+
+    Slot& slot = slots[slotIndex];
+    if (!slot.pending)
+    {
+        return;
+    }
+    slot.pending = false;
+    if (slot.result < 0)
+    {
+        failed = true;
+    }
+    else if (static_cast<size_t>(slot.result) < slot.size)
+    {
+        // 途中までしか書けなかった場合は残りを同期的に書く
+        size_t written = static_cast<size_t>(slot.result);
+        if (WriteFully(*file, slot.buffer + written, slot.size - written, slot.offset + written) < 0)
+        {
+            failed = true;
+        }
+    }
+    slot.size = 0;
+}
+
+void AsyncFileWriter::Release()
+{
+    queue.reset();
+    for (auto& slot : slots)
+    {
+        FreeBlock(slot.buffer);
+    }
+    slots.clear();
+    file.reset();
+}
@@ -0,0 +1,118 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 非同期ファイル I/O のバックエンド
+enum class AsyncIoBackend
+{
+    IoUring,        // Linux の io_uring
+    ThreadPool      // ワーカースレッドで位置指定の読み書きを行う（io_uring が使えない環境・Windows）
+};
+
+// 非同期ファイル I/O の設定
+struct AsyncIoOptions
+{
+    size_t blockSize = 4 << 20;     // 1 回の読み書きの大きさ（4KiB 単位に切り上げる）
+    size_t queueDepth = 4;          // 同時に発行しておく読み書きの数
+    bool useIoUring = true;         // false ならスレッドプールを使う
+};
+
+class NativeFile;
+class AsyncIoQueue;
+
+// ファイルを先頭から順にブロック単位で読む
+// 常に queueDepth 個の読み込みを発行しておき、呼び出し側が 1 ブロックを処理している間に後続のブロックを読む。
+class AsyncFileReader
+{
+public:
+    AsyncFileReader();
+    ~AsyncFileReader();
+
+    AsyncFileReader(const AsyncFileReader&) = delete;
+    AsyncFileReader& operator=(const AsyncFileReader&) = delete;
+
+    bool Open(const std::string& filename, const AsyncIoOptions& options = AsyncIoOptions());
+    void Close();
+
+    // 次のブロックを受け取る（終端または失敗なら false）
+    // data は次に ReadBlock か Close を呼ぶまで有効
+    bool ReadBlock(const char*& data, size_t& size);
+
+    bool IsOpen() const { return file != nullptr; }
+    bool HasError() const { return failed; }
+    uint64_t GetFileSize() const { return fileSize; }
+    AsyncIoBackend GetBackend() const;
+
+private:
+    struct Slot
+    {
+        char* buffer = nullptr;
+        uint64_t offset = 0;
+        size_t size = 0;
+        int64_t result = 0;
+        bool pending = false;
+        bool completed = false;
+    };
+
+    std::unique_ptr<NativeFile> file;
+    std::unique_ptr<AsyncIoQueue> queue;
+    std::vector<Slot> slots;
+    size_t blockSize;
+    uint64_t fileSize;
+    uint64_t nextOffset;
+    size_t nextSlot;
+    bool recycleNeeded;
+    bool failed;
+
+    void Issue(size_t slotIndex);
+    void WaitFor(size_t slotIndex);
+};
+
+// ファイルへ順に書き出す
+// 書き込みを固定長のブロックに貯め、満杯になったブロックを非同期に発行して呼び出し側の処理と重ねる（write-behind）。
+class AsyncFileWriter
+{
+public:
+    AsyncFileWriter();
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    // ファイルを作成する（既存のファイルは切り詰める）
+    bool Open(const std::string& filename, const AsyncIoOptions& options = AsyncIoOptions());
+    bool Write(const char* data, size_t size);
+
+    // 残りを書き出し、すべての書き込みの完了を待って閉じる
+    bool Close();
+
+    bool HasError() const { return failed; }
+    AsyncIoBackend GetBackend() const;
+
+private:
+    struct Slot
+    {
+        char* buffer = nullptr;
+        size_t size = 0;
+        uint64_t offset = 0;
+        int64_t result = 0;
+        bool pending = false;
+        bool completed = false;
+    };
+
+    std::unique_ptr<NativeFile> file;
+    std::unique_ptr<AsyncIoQueue> queue;
+    std::vector<Slot> slots;
+    size_t blockSize;
+    size_t currentSlot;
+    uint64_t nextOffset;
+    bool failed;
+
+    bool Flush();
+    void WaitFor(size_t slotIndex);
+    void Release();
+};
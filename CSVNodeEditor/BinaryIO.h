@@ -0,0 +1,102 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// バイナリ形式の書き込みヘルパー（リトルエンディアン環境を前提とする）
+class BinaryWriter
+{
+public:
+    explicit BinaryWriter(std::string& buffer)
+        : buffer(buffer)
+    {
+    }
+
+    template <typename T>
+    void Write(const T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryWriter::Write requires a trivially copyable type");
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void WriteBytes(const void* data, size_t size)
+    {
+        buffer.append(static_cast<const char*>(data), size);
+    }
+
+    void WriteString(std::string_view value)
+    {
+        Write(static_cast<uint32_t>(value.size()));
+        WriteBytes(value.data(), value.size());
+    }
+
+    size_t GetSize() const { return buffer.size(); }
+
+private:
+    std::string& buffer;
+};
+
+// バイナリ形式の読み込みヘルパー
+// 範囲外の読み込みは失敗として扱い、壊れたファイルでも未定義動作にならないようにする。
+class BinaryReader
+{
+public:
+    BinaryReader(const char* data, size_t size)
+        : data(data)
+        , size(size)
+        , position(0)
+    {
+    }
+
+    template <typename T>
+    bool Read(T& value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "BinaryReader::Read requires a trivially copyable type");
+        const char* bytes = Skip(sizeof(T));
+        if (!bytes)
+        {
+            return false;
+        }
+        std::memcpy(&value, bytes, sizeof(T));
+        return true;
+    }
+
+    bool ReadString(std::string& value)
+    {
+        uint32_t length = 0;
+        if (!Read(length))
+        {
+            return false;
+        }
+        const char* bytes = Skip(length);
+        if (!bytes)
+        {
+            return false;
+        }
+        value.assign(bytes, length);
+        return true;
+    }
+
+    // size バイト進め、進める前の位置へのポインタを返す（範囲外なら nullptr）
+    const char* Skip(size_t count)
+    {
+        if (count > size - position)
+        {
+            return nullptr;
+        }
+        const char* current = data + position;
+        position += count;
+        return current;
+    }
+
+    size_t GetPosition() const { return position; }
+    size_t GetRemaining() const { return size - position; }
+
+private:
+    const char* data;
+    size_t size;
+    size_t position;
+};
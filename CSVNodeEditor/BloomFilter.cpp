@@ -0,0 +1,24 @@
+﻿#include "BloomFilter.h"
+
+BloomFilter::BloomFilter(size_t expectedKeys)
+{
+    // キーあたり約 12 ビット（ブロック化による偏りを見込んで通常の 10 ビットより多めに取る）
+    size_t blockCount = 1;
+    while (blockCount * wordsPerBlock * 64 < expectedKeys * 12)
+    {
+        blockCount *= 2;
+    }
+    words.assign(blockCount * wordsPerBlock, 0);
+    blockMask = blockCount - 1;
+}
+
+void BloomFilter::Insert(uint64_t hash)
+{
+    uint64_t* block = words.data() + (static_cast<size_t>(hash >> 32) & blockMask) * wordsPerBlock;
+    const uint64_t bits = BitSource(hash);
+    for (int i = 0; i < bitsPerKey; ++i)
+    {
+        const uint32_t bit = static_cast<uint32_t>(bits >> (10 + i * 9)) & 511;
+        block[bit >> 6] |= uint64_t(1) << (bit & 63);
+    }
+}
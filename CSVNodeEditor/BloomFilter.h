@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// ブロック化 Bloom フィルター
+// 1 つのキーのビットをすべて 512 ビット（キャッシュライン 1 本）のブロック内に置き、
+// 判定 1 回あたりのメモリアクセスを 1 回に抑える。キーは呼び出し側で計算した 64 ビットハッシュで与える。
+class BloomFilter
+{
+public:
+    BloomFilter() = default;
+
+    // expectedKeys 個のキーを登録したときの偽陽性率が 1% 前後になる大きさで確保する
+    explicit BloomFilter(size_t expectedKeys);
+
+    void Insert(uint64_t hash);
+
+    // false なら登録されていないことが確実
+    bool MayContain(uint64_t hash) const
+    {
+        const uint64_t* block = words.data() + (static_cast<size_t>(hash >> 32) & blockMask) * wordsPerBlock;
+        const uint64_t bits = BitSource(hash);
+        for (int i = 0; i < bitsPerKey; ++i)
+        {
+            const uint32_t bit = static_cast<uint32_t>(bits >> (10 + i * 9)) & 511;
+            if ((block[bit >> 6] & (uint64_t(1) << (bit & 63))) == 0)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool IsEmpty() const { return words.empty(); }
+    size_t GetMemoryUsage() const { return words.capacity() * sizeof(uint64_t); }
+
+private:
+    static constexpr size_t wordsPerBlock = 8;
+    static constexpr int bitsPerKey = 6;
+
+    std::vector<uint64_t> words;
+    size_t blockMask = 0;
+
+    // ブロックの選択（上位 32 ビット）と相関しないよう、ブロック内のビット位置は全ビットを混ぜた値から取る
+    static uint64_t BitSource(uint64_t hash) { return hash * 0x9E3779B97F4A7C15ull; }
+};
@@ -1,10 +1,54 @@
 ﻿#include "CSVData.h"
-#include <fstream>
-#include <sstream>
+#include "ColumnIndex.h"
+#include "ColumnProfiler.h"
+#include "CompressedInput.h"
+#include "CSVWriter.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include "ZoneMap.h"
 #include <algorithm>
-#include <stdexcept>
+#include <atomic>
+
+namespace
+{
+    // 表の識別番号（0 は未割り当てを表す）
+    std::atomic<uint64_t> nextTableId(1);
+
+    std::string_view TrimField(std::string_view field)
+    {
+        const char* whitespace = " \t\r\n";
+        size_t begin = field.find_first_not_of(whitespace);
+        if (begin == std::string_view::npos)
+        {
+            return std::string_view();
+        }
+        size_t end = field.find_last_not_of(whitespace);
+        return field.substr(begin, end + 1 - begin);
+    }
+}
+
+std::vector<std::string> CSVRow::ToStrings() const
+{
+    std::vector<std::string> result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        result.emplace_back(arena->Get(cells[i]));
+    }
+    return result;
+}
 
 CSVData::CSVData()
+    : tableId(nextTableId.fetch_add(1, std::memory_order_relaxed))
+    , version(0)
+    , rewriteVersion(0)
+    , statisticsVersion(static_cast<uint64_t>(-1))
+    , zoneMapVersion(static_cast<uint64_t>(-1))
+    , indexVersion(0)
+    , historyEnabled(false)
+    , historyLimit(0)
+    , undoBytes(0)
+    , redoBytes(0)
 {
 }
 
@@ -12,84 +56,680 @@ CSVData::~CSVData()
 {
 }
 
+CSVData::CSVData(const CSVData& other)
+    : CSVData()
+{
+    *this = other;
+}
+
+CSVData& CSVData::operator=(const CSVData& other)
+{
+    if (this != &other)
+    {
+        // セル文字列・セル参照・行の位置はチャンクを共有したまま複製する
+        BeginEdit(true);
+        headers = other.headers;
+        sharedHeaders.reset();
+        arena = other.arena;
+        cells = other.cells;
+        rowSpans = other.rowSpans;
+        internPolicies = other.internPolicies;
+
+        // 版数は自身の以前の値と重ならないよう進め、複製元で有効だったキャッシュは引き継ぐ
+        const uint64_t newVersion = std::max(version, other.version) + 1;
+        statistics = other.statistics;
+        statisticsVersion = other.statisticsVersion == other.version ? newVersion : static_cast<uint64_t>(-1);
+        zoneMap = other.zoneMap;
+        zoneMapVersion = other.zoneMapVersion == other.version ? newVersion : static_cast<uint64_t>(-1);
+        indexes.clear();
+        if (other.indexVersion == other.version)
+        {
+            indexes = other.indexes;
+        }
+        indexVersion = newVersion;
+        version = newVersion;
+        rewriteVersion = std::max(rewriteVersion, other.rewriteVersion) + 1;
+    }
+    return *this;
+}
+
 bool CSVData::LoadFromFile(const std::string& filename)
 {
-    std::ifstream file(filename);
-    if (!file.is_open())
+    // gzip / zstd で圧縮されたファイルは伸長しながら読み込む
+    LineReader file;
+    if (!file.Open(filename))
     {
         return false;
     }
 
     Clear();
     std::string line;
+    std::vector<std::string_view> fields;
+    std::string unescaped;
     
-    // ヘッダー行を読み込み
-    if (std::getline(file, line))
+    // ヘッダー行を読み込み（引用符で囲まれた改行を含む行は 1 行として読む）
+    if (file.ReadRecord(line))
     {
         headers = ParseCSVLine(line);
     }
 
-    // データ行を読み込み
-    while (std::getline(file, line))
+    // データ行を読み込み（フィールドは行バッファから直接アリーナへ複写する）
+    while (file.ReadRecord(line))
     {
         if (!line.empty())
         {
-            rows.push_back(ParseCSVLine(line));
+            SplitCSVLine(line, fields, unescaped);
+            AppendCells(fields);
         }
     }
 
-    file.close();
+    ++version;
+    ++rewriteVersion;
+    if (file.HasError())
+    {
+        return false;
+    }
+
+    // 読み込み直後に統計情報を計算しておき、プロパティ表示を即座に行えるようにする
+    GetStatistics();
+    BuildZoneMap();
     return true;
 }
 
 bool CSVData::SaveToFile(const std::string& filename)
 {
-    std::ofstream file(filename);
-    if (!file.is_open())
+    // 引用符付けと並列整形は CSVWriter に任せる
+    return WriteCSVFile(filename, headers, GetRows());
+}
+
+std::string_view CSVData::GetCell(size_t row, size_t column) const
+{
+    return row < rowSpans.size() ? RowAt(row)[column] : std::string_view();
+}
+
+CellRef CSVData::StoreCell(size_t column, std::string_view value)
+{
+    if (value.empty())
     {
-        return false;
+        return CellRef();
+    }
+    if (column >= internPolicies.size())
+    {
+        internPolicies.resize(column + 1);
     }
+    return internPolicies[column].Store(arena, value);
+}
 
-    // ヘッダーを書き込み
-    for (size_t i = 0; i < headers.size(); ++i)
+template <typename Row>
+void CSVData::AppendCells(const Row& row)
+{
+    RowSpan span;
+    span.cellCount = static_cast<uint32_t>(row.size());
+    CellRef* refs = cells.Allocate(row.size());
+    for (size_t i = 0; i < row.size(); ++i)
     {
-        if (i > 0) file << ",";
-        file << headers[i];
+        refs[i] = StoreCell(i, row[i]);
     }
-    file << std::endl;
+    span.cells = refs;
+    rowSpans.push_back(span);
+}
+
+void CSVData::SetHeaders(const std::vector<std::string>& newHeaders)
+{
+    BeginEdit(false);
+    headers = newHeaders;
+    sharedHeaders.reset();
+    ++version;
+    ++rewriteVersion;
+}
+
+void CSVData::AddRow(const std::vector<std::string>& row)
+{
+    BeginEdit(false);
+    AppendCells(row);
+    ++version;
+}
+
+void CSVData::AddRow(const std::vector<std::string_view>& row)
+{
+    BeginEdit(false);
+    AppendCells(row);
+    ++version;
+}
+
+void CSVData::AddRow(std::initializer_list<std::string_view> row)
+{
+    AddRow(std::vector<std::string_view>(row));
+}
+
+void CSVData::AddRow(const CSVRow& row)
+{
+    BeginEdit(false);
+    if (row.arena == &arena)
+    {
+        // 同じ表の行なら参照だけを複写する（確保済みのセル参照は移動しない）
+        CellRef* refs = cells.Allocate(row.count);
+        std::copy(row.cells, row.cells + row.count, refs);
+        rowSpans.push_back(RowSpan{ refs, static_cast<uint32_t>(row.count) });
+    }
+    else
+    {
+        AppendCells(row);
+    }
+    ++version;
+}
+
+void CSVData::InsertRow(size_t index, const std::vector<std::string>& row)
+{
+    // 末尾への挿入は追加と同じく既存の行を変えない
+    const bool append = index >= rowSpans.size();
+    BeginEdit(false);
+    RowSpan span;
+    span.cellCount = static_cast<uint32_t>(row.size());
+    CellRef* refs = cells.Allocate(row.size());
+    for (size_t i = 0; i < row.size(); ++i)
+    {
+        refs[i] = StoreCell(i, row[i]);
+    }
+    span.cells = refs;
+    rowSpans.insert(index, span);
+    ++version;
+    if (!append)
+    {
+        ++rewriteVersion;
+    }
+}
+
+void CSVData::SetRows(std::vector<std::vector<std::string>>&& newRows)
+{
+    // 旧来の行形式から取り込む。文字列はアリーナへ複写し、受け取った行はここで解放する
+    std::vector<std::vector<std::string>> source = std::move(newRows);
+    BeginEdit(true);
+    rowSpans.clear();
+    for (const auto& row : source)
+    {
+        AppendCells(row);
+    }
+    ++version;
+    ++rewriteVersion;
+}
+
+void CSVData::SetCells(CellArena&& newArena, std::vector<CellRef>&& newCells, size_t columnCount,
+    const std::vector<uint32_t>& rowCellCounts)
+{
+    BeginEdit(true);
+    arena = std::move(newArena);
+
+    // 組み立て済みのセル参照は複写せずに 1 チャンクとして引き取る
+    const size_t rowCount = columnCount > 0 ? newCells.size() / columnCount : 0;
+    const CellRef* base = cells.Adopt(std::move(newCells));
+    const uint32_t width = static_cast<uint32_t>(columnCount);
+    const uint32_t* counts = rowCellCounts.size() == rowCount && rowCount > 0 ? rowCellCounts.data() : nullptr;
+    rowSpans.Generate(rowCount, [base, counts, columnCount, width](size_t r) {
+        return RowSpan{ base + r * columnCount, counts ? std::min(counts[r], width) : width };
+    });
+    ++version;
+    ++rewriteVersion;
+}
 
-    // データ行を書き込み
-    for (const auto& row : rows)
+void CSVData::AttachCells(CellArena&& newArena, const CellRef* newCells, const uint32_t* rowCellCounts,
+    size_t rowCount, size_t columnCount, std::shared_ptr<const void> owner)
+{
+    BeginEdit(true);
+    arena = std::move(newArena);
+    const CellRef* base = cells.Attach(newCells, std::move(owner));
+    const uint32_t width = static_cast<uint32_t>(columnCount);
+    rowSpans.Generate(rowCount, [base, rowCellCounts, columnCount, width](size_t r) {
+        return RowSpan{ base + r * columnCount, rowCellCounts ? std::min(rowCellCounts[r], width) : width };
+    });
+    ++version;
+    ++rewriteVersion;
+}
+
+void CSVData::SetCellBlocks(std::vector<CellBlock>&& blocks, size_t columnCount)
+{
+    // アリーナを順に引き取り、各ブロックの参照をその場で新しい位置にずらす
+    BeginEdit(true);
+    std::vector<uint64_t> deltas(blocks.size());
+    for (size_t b = 0; b < blocks.size(); ++b)
     {
-        for (size_t i = 0; i < row.size(); ++i)
+        deltas[b] = arena.Absorb(std::move(blocks[b].arena));
+    }
+    ParallelFor(blocks.size(), [&](size_t b) {
+        if (deltas[b] == 0)
+        {
+            return;
+        }
+        for (CellRef& ref : blocks[b].cells)
         {
-            if (i > 0) file << ",";
-            file << row[i];
+            ref = ref.Rebased(deltas[b]);
         }
-        file << std::endl;
+    });
+
+    // ブロックのセル参照はそれぞれ 1 チャンクとして引き取り、連結のための複写は行わない
+    std::vector<const CellRef*> bases(blocks.size());
+    std::vector<size_t> rowCounts(blocks.size());
+    size_t totalRows = 0;
+    for (size_t b = 0; b < blocks.size(); ++b)
+    {
+        rowCounts[b] = columnCount > 0 ? blocks[b].cells.size() / columnCount : 0;
+        bases[b] = cells.Adopt(std::move(blocks[b].cells));
+        totalRows += rowCounts[b];
     }
 
-    file.close();
-    return true;
+    size_t block = 0;
+    size_t blockStart = 0;
+    rowSpans.Generate(totalRows, [&](size_t r) {
+        while (r - blockStart >= rowCounts[block])
+        {
+            blockStart += rowCounts[block];
+            ++block;
+        }
+        return RowSpan{ bases[block] + (r - blockStart) * columnCount, static_cast<uint32_t>(columnCount) };
+    });
+    ++version;
+    ++rewriteVersion;
 }
 
-void CSVData::AddRow(const std::vector<std::string>& row)
+void CSVData::RemoveRow(size_t index)
 {
-    rows.push_back(row);
+    if (index < rowSpans.size())
+    {
+        // セル参照は残し、行の位置だけを取り除く（複製されるのは行を含むチャンクだけ）
+        BeginEdit(false);
+        rowSpans.erase(index);
+        CompactRowsIfFragmented();
+        ++version;
+        ++rewriteVersion;
+    }
 }
 
-void CSVData::RemoveRow(size_t index)
+void CSVData::RemoveRows(const std::vector<uint32_t>& rowIndices)
 {
-    if (index < rows.size())
+    const size_t rowCount = rowSpans.size();
+    std::vector<uint64_t> mask((rowCount + 63) / 64, 0);
+    bool marked = false;
+    for (uint32_t row : rowIndices)
     {
-        rows.erase(rows.begin() + index);
+        if (row < rowCount)
+        {
+            mask[row >> 6] |= uint64_t(1) << (row & 63);
+            marked = true;
+        }
+    }
+    if (!marked)
+    {
+        return;
+    }
+
+    // セル参照は残し、行の位置だけを取り除く（削除を含まないチャンクは履歴と共有したまま）
+    BeginEdit(false);
+    rowSpans.EraseMarked(mask);
+    CompactRowsIfFragmented();
+    ++version;
+    ++rewriteVersion;
+}
+
+void CSVData::CompactRowsIfFragmented()
+{
+    // 削除のたびには詰め直さず、満杯でないチャンクが増えて行の位置の計算が遅くなってから 1 回の走査で詰め直す
+    if (rowSpans.IsFragmented())
+    {
+        rowSpans.Compact();
     }
 }
 
 void CSVData::Clear()
 {
+    // セルはアリーナのチャンク単位でまとめて解放するため、行数に比例した破棄処理は起きない
+    BeginEdit(true);
     headers.clear();
-    rows.clear();
+    sharedHeaders.reset();
+    rowSpans.clear();
+    zoneMap.reset();
+    indexes.clear();
+    ++version;
+    ++rewriteVersion;
+}
+
+size_t CSVData::GetCellMemoryUsage() const
+{
+    return arena.GetReservedBytes() + cells.GetReservedBytes() + rowSpans.GetReservedBytes();
+}
+
+void CSVData::SetCell(size_t row, size_t column, std::string_view value)
+{
+    if (row >= rowSpans.size())
+    {
+        return;
+    }
+
+    // 変更前の行のセル参照は履歴から参照されるため、行を新しい位置に複写してから書き換える
+    BeginEdit(false);
+    const RowSpan old = rowSpans[row];
+    const size_t count = std::max<size_t>(old.cellCount, column + 1);
+    CellRef* refs = cells.Allocate(count);
+    std::copy(old.cells, old.cells + old.cellCount, refs);
+    std::fill(refs + old.cellCount, refs + count, CellRef());
+    refs[column] = StoreCell(column, value);
+    rowSpans.set(row, RowSpan{ refs, static_cast<uint32_t>(count) });
+    ++version;
+    ++rewriteVersion;
+}
+
+void CSVData::EnableHistory(size_t memoryLimit)
+{
+    historyEnabled = true;
+    historyLimit = memoryLimit;
+}
+
+void CSVData::DisableHistory()
+{
+    historyEnabled = false;
+    undoSteps.clear();
+    redoSteps.clear();
+    undoBytes = 0;
+    redoBytes = 0;
+    sharedHeaders.reset();
+}
+
+std::unique_ptr<CSVData::CellStorage> CSVData::TakeStorage()
+{
+    auto storage = std::make_unique<CellStorage>();
+    storage->arena = std::move(arena);
+    storage->cells = std::move(cells);
+    storage->internPolicies.swap(internPolicies);
+    return storage;
+}
+
+void CSVData::BeginEdit(bool replacesStorage)
+{
+    if (!historyEnabled)
+    {
+        if (replacesStorage)
+        {
+            arena.Clear();
+            cells.Clear();
+            internPolicies.clear();
+        }
+        return;
+    }
+
+    // 変更前の状態を記録する。行の位置のチャンクは現在の表と共有し、以後の編集で複製された分だけが履歴の使用量になる
+    HistoryStep step;
+    step.headers = ShareHeaders();
+    step.rows = rowSpans;
+    if (replacesStorage)
+    {
+        step.storage = TakeStorage();
+    }
+
+    // 直前のステップの使用量は、ここまでの編集で現在の表と共有しなくなったチャンクの分で確定する
+    if (!undoSteps.empty())
+    {
+        HistoryStep& previous = undoSteps.back();
+        undoBytes -= previous.bytes;
+        previous.bytes = GetStepBytes(previous, rowSpans, sharedHeaders);
+        undoBytes += previous.bytes;
+    }
+    step.bytes = GetStepBytes(step, rowSpans, sharedHeaders);
+    undoBytes += step.bytes;
+    undoSteps.push_back(std::move(step));
+    redoSteps.clear();
+    redoBytes = 0;
+
+    // 上限を超えたら古いステップから破棄する
+    while (undoBytes > historyLimit && !undoSteps.empty())
+    {
+        undoBytes -= undoSteps.front().bytes;
+        undoSteps.pop_front();
+    }
+}
+
+const std::shared_ptr<const std::vector<std::string>>& CSVData::ShareHeaders()
+{
+    if (!sharedHeaders)
+    {
+        sharedHeaders = std::make_shared<const std::vector<std::string>>(headers);
+    }
+    return sharedHeaders;
+}
+
+size_t CSVData::GetStepBytes(const HistoryStep& step, const RowSpanList& newerRows,
+    const std::shared_ptr<const std::vector<std::string>>& newerHeaders) const
+{
+    size_t bytes = sizeof(HistoryStep) + step.rows.GetBytesNotSharedWith(newerRows);
+    if (step.headers && step.headers != newerHeaders)
+    {
+        for (const auto& header : *step.headers)
+        {
+            bytes += sizeof(std::string) + header.capacity();
+        }
+    }
+    if (step.storage)
+    {
+        bytes += step.storage->arena.GetReservedBytes() + step.storage->cells.GetReservedBytes();
+    }
+    return bytes;
+}
+
+bool CSVData::MoveHistoryStep(std::deque<HistoryStep>& from, size_t& fromBytes, std::deque<HistoryStep>& to, size_t& toBytes)
+{
+    if (from.empty())
+    {
+        return false;
+    }
+
+    // 現在の状態を反対側の履歴に移し、記録されていた状態に戻す
+    HistoryStep target = std::move(from.back());
+    from.pop_back();
+    fromBytes -= target.bytes;
+    HistoryStep current;
+    current.headers = ShareHeaders();
+    current.rows = std::move(rowSpans);
+    if (target.storage)
+    {
+        current.storage = TakeStorage();
+        arena = std::move(target.storage->arena);
+        cells = std::move(target.storage->cells);
+        internPolicies.swap(target.storage->internPolicies);
+    }
+    if (target.headers != sharedHeaders)
+    {
+        headers = *target.headers;
+        sharedHeaders = std::move(target.headers);
+    }
+    rowSpans = std::move(target.rows);
+    current.bytes = GetStepBytes(current, rowSpans, sharedHeaders);
+    toBytes += current.bytes;
+    to.push_back(std::move(current));
+
+    // 行番号が変わり得るため、統計・ゾーンマップ・索引は版数の更新で無効にする
+    ++version;
+    ++rewriteVersion;
+    return true;
+}
+
+bool CSVData::Undo()
+{
+    return MoveHistoryStep(undoSteps, undoBytes, redoSteps, redoBytes);
+}
+
+bool CSVData::Redo()
+{
+    return MoveHistoryStep(redoSteps, redoBytes, undoSteps, undoBytes);
+}
+
+size_t CSVData::GetHistoryMemoryUsage() const
+{
+    // 最新のステップは記録後の編集で複製されたチャンクの分を数え直す
+    if (undoSteps.empty())
+    {
+        return redoBytes;
+    }
+    return undoBytes - undoSteps.back().bytes + GetStepBytes(undoSteps.back(), rowSpans, sharedHeaders) + redoBytes;
+}
+
+std::shared_ptr<const ZoneMap> CSVData::GetZoneMap() const
+{
+    return zoneMapVersion == version ? zoneMap : nullptr;
+}
+
+void CSVData::BuildZoneMap()
+{
+    zoneMap = std::make_shared<const ZoneMap>(ComputeZoneMap(*this));
+    zoneMapVersion = version;
+}
+
+void CSVData::SetZoneMap(ZoneMap&& newZoneMap)
+{
+    // 現在の内容に対する要約として保持する（キャッシュから復元した場合など）
+    zoneMap = std::make_shared<const ZoneMap>(std::move(newZoneMap));
+    zoneMapVersion = version;
+}
+
+std::shared_ptr<const HashColumnIndex> CSVData::BuildHashIndex(size_t column) const
+{
+    if (column >= headers.size())
+    {
+        return nullptr;
+    }
+    ColumnIndexes* entry = FindIndexes(column);
+    if (entry && entry->hash)
+    {
+        return entry->hash;
+    }
+
+    auto index = HashColumnIndex::Build(*this, column);
+    indexes.resize(std::max(indexes.size(), column + 1));
+    indexes[column].hash = index;
+    return index;
+}
+
+std::shared_ptr<const SortedColumnIndex> CSVData::BuildSortedIndex(size_t column) const
+{
+    if (column >= headers.size())
+    {
+        return nullptr;
+    }
+    ColumnIndexes* entry = FindIndexes(column);
+    if (entry && entry->sorted)
+    {
+        return entry->sorted;
+    }
+
+    auto index = SortedColumnIndex::Build(*this, column);
+    indexes.resize(std::max(indexes.size(), column + 1));
+    indexes[column].sorted = index;
+    return index;
+}
+
+std::shared_ptr<const HashColumnIndex> CSVData::GetHashIndex(size_t column) const
+{
+    ColumnIndexes* entry = FindIndexes(column);
+    return entry ? entry->hash : nullptr;
+}
+
+std::shared_ptr<const SortedColumnIndex> CSVData::GetSortedIndex(size_t column) const
+{
+    ColumnIndexes* entry = FindIndexes(column);
+    return entry ? entry->sorted : nullptr;
+}
+
+void CSVData::DropIndexes()
+{
+    indexes.clear();
+}
+
+size_t CSVData::GetIndexMemoryUsage() const
+{
+    size_t total = 0;
+    FindIndexes(0);     // 古い索引は数えない
+    for (const auto& entry : indexes)
+    {
+        total += entry.hash ? entry.hash->GetMemoryUsage() : 0;
+        total += entry.sorted ? entry.sorted->GetMemoryUsage() : 0;
+    }
+    return total;
+}
+
+CSVData::ColumnIndexes* CSVData::FindIndexes(size_t column) const
+{
+    // 作成後に表が変更されていれば、行番号が変わっている可能性があるためすべて破棄する
+    if (indexVersion != version)
+    {
+        indexes.clear();
+        indexVersion = version;
+    }
+    return column < indexes.size() ? &indexes[column] : nullptr;
+}
+
+void CSVData::SetSelectedRows(const CSVData& source, const std::vector<uint32_t>& rowIndices)
+{
+    // 行の位置だけを組み立て、セル参照も source と共有する（source が自身の場合に備えて先に組み立てる）
+    RowSpanList newSpans;
+    newSpans.Generate(rowIndices.size(), [&source, &rowIndices](size_t i) {
+        return source.rowSpans[rowIndices[i]];
+    });
+
+    if (&source != this)
+    {
+        BeginEdit(true);
+        headers = source.headers;
+        sharedHeaders.reset();
+        arena = source.arena;
+        cells = source.cells;
+        internPolicies = source.internPolicies;
+    }
+    else
+    {
+        BeginEdit(false);
+    }
+    rowSpans = std::move(newSpans);
+    ++version;
+    ++rewriteVersion;
+}
+
+void CSVData::SetProjectedColumns(const CSVData& source, const std::vector<size_t>& columns)
+{
+    // 選んだ列のセル参照を行優先に並べ直す（source が自身の場合に備えて先に組み立てる）
+    const size_t rowCount = source.rowSpans.size();
+    const size_t width = columns.size();
+    std::vector<CellRef> projected(rowCount * width);
+    const size_t blockRows = 65536;
+    ParallelFor((rowCount + blockRows - 1) / blockRows, [&](size_t block) {
+        const size_t begin = block * blockRows;
+        const size_t end = std::min(rowCount, begin + blockRows);
+        for (size_t r = begin; r < end; ++r)
+        {
+            const RowSpan& span = source.rowSpans[r];
+            CellRef* row = projected.data() + r * width;
+            for (size_t c = 0; c < width; ++c)
+            {
+                row[c] = columns[c] < span.cellCount ? span.cells[columns[c]] : CellRef();
+            }
+        }
+    });
+    std::vector<std::string> newHeaders(width);
+    for (size_t c = 0; c < width; ++c)
+    {
+        newHeaders[c] = columns[c] < source.headers.size() ? source.headers[columns[c]] : std::string();
+    }
+
+    // セル文字列は source と共有する
+    CellArena sharedArena = source.arena;
+    CellRefStore sharedCells = source.cells;
+    BeginEdit(true);
+    arena = std::move(sharedArena);
+    cells = std::move(sharedCells);
+    headers = std::move(newHeaders);
+    sharedHeaders.reset();
+    const CellRef* base = cells.Adopt(std::move(projected));
+    rowSpans.Generate(rowCount, [base, width](size_t r) {
+        return RowSpan{ base + r * width, static_cast<uint32_t>(width) };
+    });
+    ++version;
+    ++rewriteVersion;
 }
 
 std::vector<std::vector<std::string>> CSVData::FilterRows(const std::string& column, const std::string& value)
@@ -99,11 +739,25 @@ std::vector<std::vector<std::string>> CSVData::FilterRows(const std::string& col
     
     if (columnIndex >= 0)
     {
-        for (const auto& row : rows)
+        // ハッシュ索引があれば値が等しくなり得る行だけを調べる（索引は "1" と "1.0" を同じキーとして扱う）
+        auto hashIndex = GetHashIndex(static_cast<size_t>(columnIndex));
+        if (hashIndex)
+        {
+            for (uint32_t row : hashIndex->Find(*this, CellKey::From(value)))
+            {
+                if (GetCell(row, static_cast<size_t>(columnIndex)) == value)
+                {
+                    filteredRows.push_back(RowAt(row).ToStrings());
+                }
+            }
+            return filteredRows;
+        }
+
+        for (const auto& row : GetRows())
         {
             if (columnIndex < static_cast<int>(row.size()) && row[columnIndex] == value)
             {
-                filteredRows.push_back(row);
+                filteredRows.push_back(row.ToStrings());
             }
         }
     }
@@ -116,16 +770,41 @@ void CSVData::SortByColumn(const std::string& column, bool ascending)
     int columnIndex = GetColumnIndex(column);
     if (columnIndex >= 0)
     {
-        std::sort(rows.begin(), rows.end(),
-            [columnIndex, ascending](const std::vector<std::string>& a, const std::vector<std::string>& b) {
-                if (columnIndex >= static_cast<int>(a.size()) || columnIndex >= static_cast<int>(b.size()))
+        // 整列済み索引があれば、その順列で行の位置を並べ替えるだけで済む
+        auto sortedIndex = GetSortedIndex(static_cast<size_t>(columnIndex));
+        if (sortedIndex)
+        {
+            const auto& order = sortedIndex->GetTextOrder();
+            BeginEdit(false);
+            RowSpanList sorted;
+            sorted.Generate(order.size(), [this, &order, ascending](size_t i) {
+                return rowSpans[order[ascending ? i : order.size() - 1 - i]];
+            });
+            rowSpans = std::move(sorted);
+            ++version;
+            ++rewriteVersion;
+            return;
+        }
+
+        // 並べ替えるのは行の位置だけで、セルは移動しない
+        const size_t index = static_cast<size_t>(columnIndex);
+        std::vector<RowSpan> spans = rowSpans.ToVector();
+        std::sort(spans.begin(), spans.end(),
+            [this, index, ascending](const RowSpan& a, const RowSpan& b) {
+                if (index >= a.cellCount || index >= b.cellCount)
                     return false;
                 
+                std::string_view left = arena.Get(a.cells[index]);
+                std::string_view right = arena.Get(b.cells[index]);
                 if (ascending)
-                    return a[columnIndex] < b[columnIndex];
+                    return left < right;
                 else
-                    return a[columnIndex] > b[columnIndex];
+                    return left > right;
             });
+        BeginEdit(false);
+        rowSpans.Generate(spans.size(), [&spans](size_t i) { return spans[i]; });
+        ++version;
+        ++rewriteVersion;
     }
 }
 
@@ -136,11 +815,12 @@ double CSVData::GetColumnSum(const std::string& column)
     
     if (columnIndex >= 0)
     {
-        for (const auto& row : rows)
+        for (const auto& row : GetRows())
         {
-            if (columnIndex < static_cast<int>(row.size()) && IsNumeric(row[columnIndex]))
+            double value = 0.0;
+            if (ParseDouble(row[columnIndex], value))
             {
-                sum += StringToDouble(row[columnIndex]);
+                sum += value;
             }
         }
     }
@@ -156,11 +836,12 @@ double CSVData::GetColumnAverage(const std::string& column)
     
     if (columnIndex >= 0)
     {
-        for (const auto& row : rows)
+        for (const auto& row : GetRows())
         {
-            if (columnIndex < static_cast<int>(row.size()) && IsNumeric(row[columnIndex]))
+            double value = 0.0;
+            if (ParseDouble(row[columnIndex], value))
             {
-                sum += StringToDouble(row[columnIndex]);
+                sum += value;
                 count++;
             }
         }
@@ -168,99 +849,164 @@ double CSVData::GetColumnAverage(const std::string& column)
     
     return count > 0 ? sum / count : 0.0;
 }
-
 std::string CSVData::GetColumnMin(const std::string& column)
 {
     int columnIndex = GetColumnIndex(column);
-    std::string minValue;
-    
-    if (columnIndex >= 0 && !rows.empty())
+    if (columnIndex < 0)
     {
-        minValue = rows[0][columnIndex];
-        for (const auto& row : rows)
-        {
-            if (columnIndex < static_cast<int>(row.size()) && row[columnIndex] < minValue)
-            {
-                minValue = row[columnIndex];
-            }
-        }
+        return std::string();
     }
-    
-    return minValue;
+    return GetStatistics()[columnIndex].minValue;
 }
 
 std::string CSVData::GetColumnMax(const std::string& column)
 {
     int columnIndex = GetColumnIndex(column);
-    std::string maxValue;
-    
-    if (columnIndex >= 0 && !rows.empty())
+    if (columnIndex < 0)
     {
-        maxValue = rows[0][columnIndex];
-        for (const auto& row : rows)
-        {
-            if (columnIndex < static_cast<int>(row.size()) && row[columnIndex] > maxValue)
-            {
-                maxValue = row[columnIndex];
-            }
-        }
+        return std::string();
     }
-    
-    return maxValue;
+    return GetStatistics()[columnIndex].maxValue;
 }
 
-std::vector<std::string> CSVData::ParseCSVLine(const std::string& line)
+const std::vector<DataStatistics>& CSVData::GetStatistics() const
 {
-    std::vector<std::string> result;
-    std::stringstream ss(line);
-    std::string field;
-    
-    while (std::getline(ss, field, ','))
+    if (statisticsVersion != version)
     {
-        // 前後の空白を削除
-        field.erase(0, field.find_first_not_of(" \t\r\n"));
-        field.erase(field.find_last_not_of(" \t\r\n") + 1);
-        result.push_back(field);
+        statistics = ProfileColumns(*this);
+        statisticsVersion = version;
     }
-    
-    return result;
+    return statistics;
 }
 
-int CSVData::GetColumnIndex(const std::string& column) const
+void CSVData::SetStatistics(std::vector<DataStatistics>&& newStatistics)
 {
-    for (size_t i = 0; i < headers.size(); ++i)
+    // 現在の内容に対する統計として保持する（キャッシュから復元した場合など）
+    statistics = std::move(newStatistics);
+    statisticsVersion = version;
+}
+
+std::vector<std::string> CSVData::ParseCSVLine(const std::string& line)
+{
+    std::vector<std::string_view> fields;
+    std::string unescaped;
+    SplitCSVLine(line, fields, unescaped);
+    return std::vector<std::string>(fields.begin(), fields.end());
+}
+
+void CSVData::SplitCSVLine(std::string_view line, std::vector<std::string_view>& fields, std::string& unescaped)
+{
+    // std::getline で ',' ごとに取り出していた従来の解析と同じく、行末の ',' の後ろは列として数えない
+    fields.clear();
+    if (line.find('"') == std::string_view::npos)
     {
-        if (headers[i] == column)
+        size_t start = 0;
+        while (start < line.size())
         {
-            return static_cast<int>(i);
+            size_t end = line.find(',', start);
+            if (end == std::string_view::npos)
+            {
+                end = line.size();
+            }
+            fields.push_back(TrimField(line.substr(start, end - start)));
+            start = end + 1;
         }
+        return;
+    }
+
+    // 囲みを外した値は行より長くならないため、先に行の長さだけ確保して fields の参照先を動かさない
+    unescaped.clear();
+    unescaped.reserve(line.size());
+    size_t start = 0;
+    while (start < line.size())
+    {
+        const size_t begin = line.find_first_not_of(" \t", start);
+        if (begin == std::string_view::npos || line[begin] != '"')
+        {
+            size_t end = line.find(',', start);
+            if (end == std::string_view::npos)
+            {
+                end = line.size();
+            }
+            fields.push_back(TrimField(line.substr(start, end - start)));
+            start = end + 1;
+            continue;
+        }
+
+        // 閉じる '"' まで値を組み立てる（閉じていなければ行末まで）
+        const size_t valueBegin = unescaped.size();
+        size_t position = begin + 1;
+        while (position < line.size())
+        {
+            const size_t quote = line.find('"', position);
+            if (quote == std::string_view::npos)
+            {
+                unescaped.append(line.data() + position, line.size() - position);
+                position = line.size();
+                break;
+            }
+            unescaped.append(line.data() + position, quote - position);
+            position = quote + 1;
+            if (position < line.size() && line[position] == '"')
+            {
+                unescaped.push_back('"');
+                ++position;
+                continue;
+            }
+            break;
+        }
+
+        // 閉じた後ろから次の ',' までに空白以外があれば値に続ける
+        size_t end = line.find(',', position);
+        if (end == std::string_view::npos)
+        {
+            end = line.size();
+        }
+        const std::string_view rest = TrimField(line.substr(position, end - position));
+        unescaped.append(rest.data(), rest.size());
+        fields.emplace_back(unescaped.data() + valueBegin, unescaped.size() - valueBegin);
+        start = end + 1;
     }
-    return -1;
 }
 
-bool CSVData::IsNumeric(const std::string& value) const
+std::string CSVData::ParseCSVField(const std::string& line, size_t index)
 {
-    if (value.empty()) return false;
-    try
+    // 引用符を含む行は囲みの中の ',' を区切りと見なさないよう全体を分割する
+    if (line.find('"') != std::string::npos)
     {
-        size_t pos;
-        std::stod(value, &pos);
-        return pos == value.size(); // 全部が数値ならtrue
+        std::vector<std::string_view> fields;
+        std::string unescaped;
+        SplitCSVLine(line, fields, unescaped);
+        return index < fields.size() ? std::string(fields[index]) : std::string();
     }
-    catch (const std::exception&)
+
+    // 対象列までの区切り文字だけを走査し、他の列は切り出さない
+    size_t start = 0;
+    for (size_t i = 0; i < index; ++i)
     {
-        return false;
+        start = line.find(',', start);
+        if (start == std::string::npos)
+        {
+            return std::string();
+        }
+        ++start;
     }
+
+    size_t end = line.find(',', start);
+    std::string field = line.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    field.erase(0, field.find_first_not_of(" \t\r\n"));
+    field.erase(field.find_last_not_of(" \t\r\n") + 1);
+    return field;
 }
 
-double CSVData::StringToDouble(const std::string& value) const
+int CSVData::GetColumnIndex(const std::string& column) const
 {
-    try
-    {
-        return std::stod(value);
-    }
-    catch (const std::exception&)
+    for (size_t i = 0; i < headers.size(); ++i)
     {
-        return 0.0;
+        if (headers[i] == column)
+        {
+            return static_cast<int>(i);
+        }
     }
+    return -1;
 }
@@ -2,52 +2,392 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
+#include <iterator>
 #include <memory>
-#include <fstream>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include "CellArena.h"
+#include "DataStatistics.h"
+#include "RowStorage.h"
+
+class CSVData;
+class HashColumnIndex;
+class SortedColumnIndex;
+struct ZoneMap;
+
+// 1 行分のセルの参照（参照元の表を変更するまで有効）
+// 範囲外の列は空文字列として返す。
+class CSVRow
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::string_view;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const std::string_view*;
+        using reference = std::string_view;
+
+        Iterator(const CellArena* arena, const CellRef* cell) : arena(arena), cell(cell) {}
+        std::string_view operator*() const { return arena->Get(*cell); }
+        Iterator& operator++() { ++cell; return *this; }
+        Iterator operator++(int) { Iterator previous = *this; ++cell; return previous; }
+        bool operator==(const Iterator& other) const { return cell == other.cell; }
+        bool operator!=(const Iterator& other) const { return cell != other.cell; }
+
+    private:
+        const CellArena* arena;
+        const CellRef* cell;
+    };
+
+    CSVRow(const CellArena* arena, const CellRef* cells, size_t count)
+        : arena(arena)
+        , cells(cells)
+        , count(count)
+    {
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::string_view operator[](size_t column) const { return column < count ? arena->Get(cells[column]) : std::string_view(); }
+
+    Iterator begin() const { return Iterator(arena, cells); }
+    Iterator end() const { return Iterator(arena, cells + count); }
+
+    std::vector<std::string> ToStrings() const;
+
+    // セル参照の並び（アリーナの位置のまま書き出すときに使う）
+    const CellRef* GetRefs() const { return cells; }
+
+private:
+    friend class CSVData;
+
+    const CellArena* arena;
+    const CellRef* cells;
+    size_t count;
+};
+
+// 表の全行への参照（GetRows の戻り値）
+class CSVRowRange
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = CSVRow;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const CSVRow*;
+        using reference = CSVRow;
+
+        Iterator(const CSVRowRange* range, size_t index) : range(range), index(index), span(nullptr), runEnd(nullptr) {}
+        CSVRow operator*() const;
+        Iterator& operator++() { Advance(); return *this; }
+        Iterator operator++(int) { Iterator previous = *this; Advance(); return previous; }
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+
+    private:
+        // 同じチャンクの中は行の位置を順に進め、チャンクの終わりで次の位置を木から求める
+        const CSVRowRange* range;
+        size_t index;
+        mutable const RowSpan* span;
+        mutable const RowSpan* runEnd;
+
+        void Advance()
+        {
+            ++index;
+            if (span != runEnd)
+            {
+                ++span;
+            }
+        }
+    };
+
+    explicit CSVRowRange(const CSVData* data) : data(data) {}
+
+    size_t size() const;
+    bool empty() const { return size() == 0; }
+    CSVRow operator[](size_t row) const;
+
+    Iterator begin() const { return Iterator(this, 0); }
+    Iterator end() const { return Iterator(this, size()); }
+
+private:
+    const CSVData* data;
+};
 
 // CSVデータを格納するクラス
+// セルの文字列は表ごとの CellArena にまとめて格納し、行はセル参照（位置と長さ）の並びとして持つ。
+// 同じ値が繰り返される列は読み込み時に重複を排除する。
 class CSVData
 {
 public:
     CSVData();
     ~CSVData();
 
+    // 複製は表の内容だけを写し、編集履歴は引き継がない（代入は複製先の編集として履歴に記録する）
+    CSVData(const CSVData& other);
+    CSVData& operator=(const CSVData& other);
+
     // ファイル操作
     bool LoadFromFile(const std::string& filename);
     bool SaveToFile(const std::string& filename);
 
     // データアクセス
     const std::vector<std::string>& GetHeaders() const { return headers; }
-    const std::vector<std::vector<std::string>>& GetRows() const { return rows; }
+    CSVRowRange GetRows() const { return CSVRowRange(this); }
+    std::string_view GetCell(size_t row, size_t column) const;
     
     // データ操作
+    void SetHeaders(const std::vector<std::string>& newHeaders);
     void AddRow(const std::vector<std::string>& row);
+    void AddRow(const std::vector<std::string_view>& row);
+    void AddRow(const CSVRow& row);
+    // AddRow({ "a", "b" }) のような波括弧の呼び出しを、上の 2 つの vector の間で曖昧にしないための受け口
+    void AddRow(std::initializer_list<std::string_view> row);
+    void SetRows(std::vector<std::vector<std::string>>&& newRows);
+
+    // index 行目の前に行を挿入する（行の位置の木で O(log n)。index が行数以上なら末尾に追加する）
+    void InsertRow(size_t index, const std::vector<std::string>& row);
     void RemoveRow(size_t index);
+
+    // 指定した行をまとめて削除する（順序・重複は問わず、範囲外の番号は無視する）
+    // 削除する行を行数分のビット列に記録し、行の位置の並びを 1 回の走査で作り直すため、削除数によらず O(行数) で済む。
+    void RemoveRows(const std::vector<uint32_t>& rowIndices);
     void Clear();
 
+    // セルの値を変更する（行のセル参照を複製してから書き換え、変更前の行はそのまま残す）
+    void SetCell(size_t row, size_t column, std::string_view value);
+
+    // 編集履歴（元に戻す・やり直し）
+    // 有効にすると、編集のたびに変更前の見出しと行の位置を 1 ステップとして記録する。
+    // 行の位置は共有する木に持ち、セル参照と文字列は追記専用のため、1 ステップの記録は編集で複製された
+    // 経路上のノードとチャンクの分だけで済む。表全体を置き換える編集（読み込み・Clear など）は変更前の格納領域を履歴に移す。
+    // 使用量が上限を超えたら古いステップから破棄する。
+    void EnableHistory(size_t memoryLimit = size_t(256) << 20);
+    void DisableHistory();
+    bool IsHistoryEnabled() const { return historyEnabled; }
+    bool Undo();
+    bool Redo();
+    bool CanUndo() const { return !undoSteps.empty(); }
+    bool CanRedo() const { return !redoSteps.empty(); }
+    size_t GetUndoCount() const { return undoSteps.size(); }
+    size_t GetRedoCount() const { return redoSteps.size(); }
+
+    // 履歴だけが保持しているバイト数（現在の表と共有しているチャンクは含まない）
+    size_t GetHistoryMemoryUsage() const;
+    size_t GetHistoryMemoryLimit() const { return historyLimit; }
+
+    // 組み立て済みのアリーナとセル参照（行優先で 1 行あたり columnCount 個）を引き取る
+    // rowCellCounts が空でなければ行ごとのセル数（columnCount 以下）を表す。
+    void SetCells(CellArena&& newArena, std::vector<CellRef>&& newCells, size_t columnCount,
+        const std::vector<uint32_t>& rowCellCounts = std::vector<uint32_t>());
+
+    // 並列に組み立てた部分表をまとめて行にする（各ブロックのセル数は columnCount の倍数）
+    // ブロックのアリーナは位置をずらして引き取り、セル参照はその場で補正してチャンクとして引き取るため、複写は行わない。
+    void SetCellBlocks(std::vector<CellBlock>&& blocks, size_t columnCount);
+
+    // メモリマップしたスナップショットのアリーナとセル参照（行優先で 1 行あたり columnCount 個）を複写せずに使う
+    // rowCellCounts が nullptr でなければ行ごとのセル数（columnCount 以下）を表す。セルの内容は参照したときに初めて読まれる。
+    // owner はマップを保持し、表と履歴がセルを参照する間は解放されない。
+    void AttachCells(CellArena&& newArena, const CellRef* newCells, const uint32_t* rowCellCounts,
+        size_t rowCount, size_t columnCount, std::shared_ptr<const void> owner);
+
+    // セル文字列のアリーナ（表のセル参照はすべてこの位置空間を指す）
+    const CellArena& GetArena() const { return arena; }
+
     // 統計情報
-    size_t GetRowCount() const { return rows.size(); }
+    size_t GetRowCount() const { return rowSpans.size(); }
     size_t GetColumnCount() const { return headers.size(); }
 
+    // 列名から列番号を求める（見つからなければ -1）
+    int GetColumnIndex(const std::string& column) const;
+
+    // セル文字列・セル参照・行の位置が占めるバイト数
+    size_t GetCellMemoryUsage() const;
+
+    // 変更のたびに増加する版数（キャッシュの無効化判定に使用）
+    uint64_t GetVersion() const { return version; }
+
+    // 行の追加（AddRow）以外の変更で増加する版数
+    // 前回から変わっていなければ、既存の行はそのままで末尾に行が追加されただけと分かる。
+    uint64_t GetRewriteVersion() const { return rewriteVersion; }
+
+    // 表ごとに一意な識別番号（破棄された表と同じアドレスに作られた表とも重ならない。代入では変わらない）
+    uint64_t GetTableId() const { return tableId; }
+
+    // ブロック単位の列の要約（読み込み時に作成し、テーブルが変更されるまで保持する。無効なら nullptr）
+    std::shared_ptr<const ZoneMap> GetZoneMap() const;
+    void BuildZoneMap();
+    void SetZoneMap(ZoneMap&& newZoneMap);
+
+    // 列索引（明示的に作成し、テーブルが変更されるまで保持する）
+    // 有効な索引は FilterRows・SortByColumn・SelectRows・結合ノードが自動的に使う。コピーした表とは索引を共有する。
+    std::shared_ptr<const HashColumnIndex> BuildHashIndex(size_t column) const;
+    std::shared_ptr<const SortedColumnIndex> BuildSortedIndex(size_t column) const;
+    std::shared_ptr<const HashColumnIndex> GetHashIndex(size_t column) const;
+    std::shared_ptr<const SortedColumnIndex> GetSortedIndex(size_t column) const;
+    void DropIndexes();
+    size_t GetIndexMemoryUsage() const;
+
+    // source の指定した行だけを持つ表にする（セル文字列はアリーナを共有し複写しない）
+    void SetSelectedRows(const CSVData& source, const std::vector<uint32_t>& rowIndices);
+
+    // source の指定した列だけを（指定した順に）持つ表にする（セル参照の並びだけを組み立て、セル文字列はアリーナを共有する）
+    // 行に無い列は空のセルになる。
+    void SetProjectedColumns(const CSVData& source, const std::vector<size_t>& columns);
+
     // データフィルタリング
     std::vector<std::vector<std::string>> FilterRows(const std::string& column, const std::string& value);
     
     // データソート
     void SortByColumn(const std::string& column, bool ascending = true);
 
+    // 列統計（読み込み時に計算し、テーブルが変更されるまで保持する）
+    const std::vector<DataStatistics>& GetStatistics() const;
+    void SetStatistics(std::vector<DataStatistics>&& newStatistics);
+
     // データ集計
     double GetColumnSum(const std::string& column);
     double GetColumnAverage(const std::string& column);
     std::string GetColumnMin(const std::string& column);
     std::string GetColumnMax(const std::string& column);
 
+    // CSV行の解析
+    static std::vector<std::string> ParseCSVLine(const std::string& line);
+    static std::string ParseCSVField(const std::string& line, size_t index);
+
+    // 行を区切り文字で分割し、前後の空白を除いたフィールドを fields に設定する
+    // 先頭が '"' のフィールドは囲みを外して "" を " に戻し（RFC 4180）、囲みの中の ',' と改行は値の一部とする。
+    // 引用符を含まない行は複写せずに line を指し、囲みを外した値は unescaped に置く（どちらも次の呼び出しまで有効）。
+    static void SplitCSVLine(std::string_view line, std::vector<std::string_view>& fields, std::string& unescaped);
+
 private:
+    friend class CSVRowRange;
+
     std::vector<std::string> headers;
-    std::vector<std::vector<std::string>> rows;
+    CellArena arena;
+    CellRefStore cells;
+    RowSpanList rowSpans;
+    std::vector<CellInternPolicy> internPolicies;     // 列ごとの重複排除の判定
+    uint64_t tableId;
+    uint64_t version;
+    uint64_t rewriteVersion;
+
+    // 統計情報キャッシュ
+    mutable std::vector<DataStatistics> statistics;
+    mutable uint64_t statisticsVersion;
+
+    // ゾーンマップ（zoneMapVersion と version が異なれば無効）
+    std::shared_ptr<const ZoneMap> zoneMap;
+    uint64_t zoneMapVersion;
+
+    // 列索引キャッシュ（indexVersion と version が異なれば破棄する）
+    struct ColumnIndexes
+    {
+        std::shared_ptr<const HashColumnIndex> hash;
+        std::shared_ptr<const SortedColumnIndex> sorted;
+    };
+    mutable std::vector<ColumnIndexes> indexes;
+    mutable uint64_t indexVersion;
+
+    // セル文字列とセル参照の格納領域（表全体を置き換える編集で履歴に移す）
+    struct CellStorage
+    {
+        CellArena arena;
+        CellRefStore cells;
+        std::vector<CellInternPolicy> internPolicies;
+    };
+
+    // 編集履歴の 1 ステップ
+    // 見出しは変更されるまで現在の表・他のステップと同じ複製を共有する。
+    struct HistoryStep
+    {
+        std::shared_ptr<const std::vector<std::string>> headers;
+        RowSpanList rows;
+        std::unique_ptr<CellStorage> storage;   // 格納領域を置き換えた編集のみ
+        size_t bytes = 0;                       // このステップだけが保持しているバイト数
+    };
+
+    bool historyEnabled;
+    size_t historyLimit;
+    std::deque<HistoryStep> undoSteps;
+    std::deque<HistoryStep> redoSteps;
+    size_t undoBytes;                           // undoSteps の bytes の合計
+    size_t redoBytes;                           // redoSteps の bytes の合計
+    std::shared_ptr<const std::vector<std::string>> sharedHeaders;  // 履歴と共有している現在の見出し（見出しを変更したら破棄する）
 
     // ヘルパー関数
-    std::vector<std::string> ParseCSVLine(const std::string& line);
-    int GetColumnIndex(const std::string& column) const;
-    bool IsNumeric(const std::string& value) const;
-    double StringToDouble(const std::string& value) const;
+    void BeginEdit(bool replacesStorage);
+    bool MoveHistoryStep(std::deque<HistoryStep>& from, size_t& fromBytes, std::deque<HistoryStep>& to, size_t& toBytes);
+    size_t GetStepBytes(const HistoryStep& step, const RowSpanList& newerRows,
+        const std::shared_ptr<const std::vector<std::string>>& newerHeaders) const;
+    const std::shared_ptr<const std::vector<std::string>>& ShareHeaders();
+    std::unique_ptr<CellStorage> TakeStorage();
+    void CompactRowsIfFragmented();
+    ColumnIndexes* FindIndexes(size_t column) const;
+    CellRef StoreCell(size_t column, std::string_view value);
+    template <typename Row>
+    void AppendCells(const Row& row);
+    CSVRow RowAt(size_t row) const
+    {
+        const RowSpan& span = rowSpans[row];
+        return CSVRow(&arena, span.cells, span.cellCount);
+    }
 };
+
+// 下流のノードが入力表のどこまでを処理したかを覚えておく
+// 前回から入力表への変更が行の追加だけで処理条件も同じなら、追加された行だけを処理すればよい。
+// 入力表はアドレスではなく識別番号で見分ける（同じアドレスに別の表が作られても差分を適用しない）。
+struct TableDeltaCursor
+{
+    uint64_t tableId = 0;
+    uint64_t rewriteVersion = 0;
+    size_t processedRows = 0;
+    std::string settings;
+
+    bool CanApplyDelta(const CSVData& input, const std::string& currentSettings) const
+    {
+        return tableId == input.GetTableId() && rewriteVersion == input.GetRewriteVersion()
+            && processedRows <= input.GetRowCount() && settings == currentSettings;
+    }
+
+    // 差分の処理で追いつける未処理の行があるか
+    bool HasPendingRows(const CSVData& input, const std::string& currentSettings) const
+    {
+        return CanApplyDelta(input, currentSettings) && processedRows < input.GetRowCount();
+    }
+
+    void MarkProcessed(const CSVData& input, const std::string& currentSettings)
+    {
+        tableId = input.GetTableId();
+        rewriteVersion = input.GetRewriteVersion();
+        processedRows = input.GetRowCount();
+        settings = currentSettings;
+    }
+
+    void Reset() { tableId = 0; }
+};
+
+inline size_t CSVRowRange::size() const
+{
+    return data->rowSpans.size();
+}
+
+inline CSVRow CSVRowRange::operator[](size_t row) const
+{
+    return data->RowAt(row);
+}
+
+inline CSVRow CSVRowRange::Iterator::operator*() const
+{
+    if (span == runEnd)
+    {
+        span = range->data->rowSpans.Locate(index, runEnd);
+    }
+    return CSVRow(&range->data->arena, span->cells, span->cellCount);
+}
@@ -2,24 +2,43 @@
 #include "NodeEditor.h"
 #include "CSVData.h"
 #include "NodeTypes.h"
+#include "DataPreview.h"
+#include "WorkspaceSnapshot.h"
+#include "BinaryIO.h"
 #include <imgui.h>
 #include <imnodes.h>
 #include <implot.h>
+#include <chrono>
 #include <filesystem>
 
+namespace
+{
+    // ワークスペースのスナップショットを交互に書き出す 2 つのファイル
+    const char* const workspaceSlotPaths[2] = { "CSVNodeEditor.nsws", "CSVNodeEditor.2.nsws" };
+}
+
 CSVNodeEditor::CSVNodeEditor()
     : currentTab(0)
     , showNodePalette(true)
     , showProperties(true)
     , showDataPreview(true)
     , showLog(true)
+    , dataPreview(std::make_unique<DataPreview>())
+    , workspaceSequence(0)
+    , workspaceSlot(-1)
+    , restoredSlot(-1)
 {
-    // 初期タブを作成
-    NewTab();
+    // 前回のワークスペースを復元し、無ければ初期タブを作成
+    if (!RestoreWorkspace())
+    {
+        NewTab();
+    }
 }
 
 CSVNodeEditor::~CSVNodeEditor()
 {
+    // 次回の起動で復元できるようにワークスペースを保存する
+    SaveWorkspace();
 }
 
 void CSVNodeEditor::Render()
@@ -116,6 +135,35 @@ void CSVNodeEditor::RenderMenuBar()
             {
                 NewTab();
             }
+            ImGui::Separator();
+            if (ImGui::MenuItem("ワークスペースを保存"))
+            {
+                SaveWorkspace();
+            }
+            if (ImGui::MenuItem("ワークスペースを開く"))
+            {
+                RestoreWorkspace();
+            }
+            ImGui::EndMenu();
+        }
+
+        if (ImGui::BeginMenu("編集"))
+        {
+            CSVData* data = currentTab >= 0 && currentTab < tabs.size() ? tabs[currentTab].csvData.get() : nullptr;
+            if (ImGui::MenuItem("元に戻す", "Ctrl+Z", false, data && data->CanUndo()))
+            {
+                data->Undo();
+            }
+            if (ImGui::MenuItem("やり直し", "Ctrl+Y", false, data && data->CanRedo()))
+            {
+                data->Redo();
+            }
+            if (data && data->IsHistoryEnabled())
+            {
+                ImGui::Separator();
+                ImGui::Text("履歴: %zu / %zu ステップ, %.1f / %.0f MiB", data->GetUndoCount(), data->GetUndoCount() + data->GetRedoCount(),
+                    data->GetHistoryMemoryUsage() / (1024.0 * 1024.0), data->GetHistoryMemoryLimit() / (1024.0 * 1024.0));
+            }
             ImGui::EndMenu();
         }
 
@@ -181,6 +229,22 @@ void CSVNodeEditor::RenderNodePalette()
         {
             // 結合ノードを追加
         }
+        if (ImGui::Button("ウィンドウ関数"))
+        {
+            // ウィンドウ関数ノードを追加
+        }
+        if (ImGui::Button("ピボット"))
+        {
+            // ピボットノードを追加
+        }
+        if (ImGui::Button("アンピボット"))
+        {
+            // アンピボットノードを追加
+        }
+        if (ImGui::Button("サンプル"))
+        {
+            // サンプルノードを追加
+        }
         ImGui::TreePop();
     }
 
@@ -190,6 +254,10 @@ void CSVNodeEditor::RenderNodePalette()
         {
             // 出力ノードを追加
         }
+        if (ImGui::Button("チャート"))
+        {
+            // チャートノードを追加
+        }
         ImGui::TreePop();
     }
 }
@@ -204,6 +272,38 @@ void CSVNodeEditor::RenderProperties()
         // 選択されたノードのプロパティを表示
         ImGui::Text("選択されたノードのプロパティ");
         // ここにプロパティ編集UIを実装
+        
+        // 列統計（読み込み時に計算済みのものを表示）
+        const auto& data = tabs[currentTab].csvData;
+        if (data && data->GetColumnCount() > 0 && ImGui::TreeNode("列統計"))
+        {
+            const auto& headers = data->GetHeaders();
+            const auto& statistics = data->GetStatistics();
+            for (size_t i = 0; i < statistics.size(); ++i)
+            {
+                const auto& stats = statistics[i];
+                if (!ImGui::TreeNode(headers[i].c_str()))
+                {
+                    continue;
+                }
+                
+                ImGui::Text("型: %s", stats.isNumeric ? "数値" : "文字列");
+                ImGui::Text("欠損: %zu / %zu", stats.nullCount, stats.totalRows);
+                ImGui::Text("最小: %s", stats.minValue.c_str());
+                ImGui::Text("最大: %s", stats.maxValue.c_str());
+                ImGui::Text("異なり数(推定): %zu", stats.distinctEstimate);
+                if (stats.numericCount > 0)
+                {
+                    ImGui::Text("平均: %g", stats.average);
+                    ImGui::Text("標準偏差: %g", stats.standardDeviation);
+                    
+                    std::vector<float> bins(stats.histogram.begin(), stats.histogram.end());
+                    ImGui::PlotHistogram("##Histogram", bins.data(), static_cast<int>(bins.size()), 0, nullptr, 0.0f, 3.4e38f, ImVec2(0, 60));
+                }
+                ImGui::TreePop();
+            }
+            ImGui::TreePop();
+        }
     }
 }
 
@@ -217,34 +317,8 @@ void CSVNodeEditor::RenderDataPreview()
         
         ImGui::Separator();
         
-        // ヘッダーを表示
-        const auto& headers = data->GetHeaders();
-        if (!headers.empty())
-        {
-            ImGui::Text("ヘッダー:");
-            for (size_t i = 0; i < headers.size(); ++i)
-            {
-                ImGui::SameLine();
-                ImGui::Text("%s", headers[i].c_str());
-                if (i < headers.size() - 1) ImGui::SameLine();
-            }
-        }
-        
-        // 最初の数行を表示
-        const auto& rows = data->GetRows();
-        if (!rows.empty())
-        {
-            ImGui::Text("データ (最初の10行):");
-            for (size_t i = 0; i < std::min(rows.size(), size_t(10)); ++i)
-            {
-                ImGui::Text("行 %zu:", i + 1);
-                for (size_t j = 0; j < rows[i].size(); ++j)
-                {
-                    ImGui::SameLine();
-                    ImGui::Text("%s", rows[i][j].c_str());
-                }
-            }
-        }
+        // 表示範囲のセルのみを描画する
+        dataPreview->Render(*data);
     }
     else
     {
@@ -265,6 +339,10 @@ void CSVNodeEditor::RenderLog()
     {
         ImGui::Text("タブ名: %s", tabs[currentTab].name.c_str());
     }
+    if (!workspaceStatus.empty())
+    {
+        ImGui::TextUnformatted(workspaceStatus.c_str());
+    }
 }
 
 void CSVNodeEditor::OpenCSVFile()
@@ -295,10 +373,133 @@ void CSVNodeEditor::NewTab()
     newTab.nodeEditor = std::make_unique<NodeEditor>();
     newTab.csvData = std::make_unique<CSVData>();
     
+    // タブで開いた表の編集は元に戻せるようにする
+    newTab.csvData->EnableHistory();
+    
     tabs.push_back(std::move(newTab));
     currentTab = tabs.size() - 1;
 }
 
+bool CSVNodeEditor::SaveWorkspace()
+{
+    std::vector<WorkspaceTab> workspaceTabs;
+    for (const auto& tab : tabs)
+    {
+        WorkspaceTab workspaceTab;
+        workspaceTab.name = tab.name;
+        workspaceTab.data = tab.csvData.get();
+        if (tab.nodeEditor)
+        {
+            for (const auto& node : tab.nodeEditor->GetNodes())
+            {
+                WorkspaceNode record;
+                record.id = node->GetID();
+                record.type = node->GetName();
+                record.x = node->GetPosition().x;
+                record.y = node->GetPosition().y;
+                BinaryWriter writer(record.settings);
+                node->SaveState(writer);
+                workspaceTab.nodes.push_back(std::move(record));
+            }
+        }
+        workspaceTabs.push_back(std::move(workspaceTab));
+    }
+
+    // 前回と別のファイルに書く。ただし復元元のファイルがまだマップされていれば、そちらは避ける
+    int target = workspaceSlot < 0 ? 0 : 1 - workspaceSlot;
+    if (target == restoredSlot && !restoredMapping.expired())
+    {
+        target = 1 - target;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (!WriteWorkspaceSnapshot(workspaceSlotPaths[target], workspaceSequence + 1, workspaceTabs))
+    {
+        workspaceStatus = std::string("ワークスペースを保存できませんでした: ") + workspaceSlotPaths[target];
+        return false;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    ++workspaceSequence;
+    workspaceSlot = target;
+    workspaceStatus = std::string("ワークスペースを保存しました: ") + workspaceSlotPaths[target]
+        + "（" + std::to_string(elapsed.count()) + " ms）";
+    return true;
+}
+
+bool CSVNodeEditor::RestoreWorkspace()
+{
+    // 書き出しが完了している新しい方から試す
+    uint64_t sequences[2] = { 0, 0 };
+    bool valid[2] = { false, false };
+    for (int slot = 0; slot < 2; ++slot)
+    {
+        valid[slot] = PeekWorkspaceSnapshot(workspaceSlotPaths[slot], sequences[slot]);
+    }
+    const int newest = valid[1] && (!valid[0] || sequences[1] > sequences[0]) ? 1 : 0;
+
+    auto start = std::chrono::steady_clock::now();
+    RestoredWorkspace workspace;
+    int slot = -1;
+    for (int candidate : { newest, 1 - newest })
+    {
+        if (valid[candidate] && LoadWorkspaceSnapshot(workspaceSlotPaths[candidate], workspace) == WorkspaceLoadResult::Loaded)
+        {
+            slot = candidate;
+            break;
+        }
+    }
+    if (slot < 0)
+    {
+        if (valid[0] || valid[1])
+        {
+            workspaceStatus = "ワークスペースのスナップショットが壊れているため復元しませんでした";
+        }
+        return false;
+    }
+
+    std::vector<TabData> restoredTabs;
+    for (auto& restoredTab : workspace.tabs)
+    {
+        TabData tab;
+        tab.name = restoredTab.name;
+        tab.isOpen = true;
+        tab.nodeEditor = std::make_unique<NodeEditor>();
+        tab.csvData = std::move(restoredTab.data);
+        for (const auto& record : restoredTab.nodes)
+        {
+            // 未知の種類のノードは読み飛ばし、設定が読めないノードは既定の設定のまま残す
+            auto node = CreateNodeByName(record.type, record.id);
+            if (!node)
+            {
+                continue;
+            }
+            BinaryReader reader(record.settings.data(), record.settings.size());
+            node->LoadState(reader);
+            node->SetPosition(ImVec2(record.x, record.y));
+            tab.nodeEditor->RestoreNode(std::move(node));
+        }
+
+        // 復元した内容を起点に編集を元に戻せるようにする
+        tab.csvData->EnableHistory();
+        restoredTabs.push_back(std::move(tab));
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    tabs = std::move(restoredTabs);
+    currentTab = 0;
+    if (tabs.empty())
+    {
+        NewTab();
+    }
+    workspaceSequence = std::max(sequences[0], sequences[1]);
+    workspaceSlot = slot;
+    restoredSlot = slot;
+    restoredMapping = workspace.mapping;
+    workspaceStatus = std::string("ワークスペースを復元しました: ") + workspaceSlotPaths[slot]
+        + "（" + std::to_string(tabs.size()) + " タブ, " + std::to_string(elapsed.count()) + " ms）";
+    return true;
+}
+
 void CSVNodeEditor::CloseTab(int index)
 {
     if (index >= 0 && index < tabs.size())
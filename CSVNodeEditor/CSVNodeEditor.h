@@ -7,6 +7,7 @@
 #include <string>
 #include <memory>
 #include <unordered_map>
+#include <cstdint>
 
 // プラグインのメインクラス
 class CSVNodeEditor
@@ -37,11 +38,24 @@ private:
     bool showDataPreview;
     bool showLog;
 
+    // データプレビュー（仮想化テーブル）
+    std::unique_ptr<class DataPreview> dataPreview;
+
+    // ワークスペースのスナップショット（起動時に復元し、終了時に保存する）
+    // 復元した表はファイルをマップしたまま参照し、マップ中のファイルは置き換えられないため、2 つのファイルに交互に書き出す。
+    uint64_t workspaceSequence;
+    int workspaceSlot;                          // 最後に読み書きしたファイル（-1 なら無し）
+    int restoredSlot;                           // 復元元のファイル（-1 なら無し）
+    std::weak_ptr<const void> restoredMapping;  // 復元元のマップ（表と履歴が参照している間は有効）
+    std::string workspaceStatus;
+
     // ファイル操作
     void OpenCSVFile();
     void SaveCSVFile();
     void NewTab();
     void CloseTab(int index);
+    bool SaveWorkspace();
+    bool RestoreWorkspace();
 
     // ノードパレット
     void RenderNodePalette();
@@ -0,0 +1,106 @@
+﻿#include "CSVWriter.h"
+#include "AsyncFileIO.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+    bool NeedsQuoting(std::string_view field)
+    {
+        // 読み込み時は囲まれていないフィールドの前後の空白を除くため、前後に空白がある値も囲む
+        if (!field.empty() && (field.front() == ' ' || field.front() == '\t' || field.back() == ' ' || field.back() == '\t'))
+        {
+            return true;
+        }
+        for (char c : field)
+        {
+            if (c == ',' || c == '"' || c == '\n' || c == '\r')
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    template <typename Row>
+    void AppendRow(std::string& output, const Row& row, std::string_view newline)
+    {
+        for (size_t i = 0; i < row.size(); ++i)
+        {
+            if (i > 0)
+            {
+                output.push_back(',');
+            }
+            AppendCSVField(output, row[i]);
+        }
+        output.append(newline.data(), newline.size());
+    }
+}
+
+void AppendCSVField(std::string& output, std::string_view field)
+{
+    if (!NeedsQuoting(field))
+    {
+        output.append(field.data(), field.size());
+        return;
+    }
+
+    output.push_back('"');
+    size_t begin = 0;
+    for (size_t quote = field.find('"'); quote != std::string_view::npos; quote = field.find('"', quote + 1))
+    {
+        output.append(field.data() + begin, quote + 1 - begin);
+        output.push_back('"');
+        begin = quote + 1;
+    }
+    output.append(field.data() + begin, field.size() - begin);
+    output.push_back('"');
+}
+
+bool WriteCSVFile(const std::string& path, const std::vector<std::string>& headers,
+    const CSVRowRange& rows, const CSVWriteOptions& options)
+{
+    AsyncFileWriter file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    const std::string_view newline = options.crlfLineEnding ? "\r\n" : "\n";
+    const size_t rowsPerBlock = std::max<size_t>(1, options.rowsPerBlock);
+    const size_t blockCount = (rows.size() + rowsPerBlock - 1) / rowsPerBlock;
+    const size_t batchSize = std::max<size_t>(1, std::thread::hardware_concurrency());
+
+    std::string header;
+    AppendRow(header, headers, newline);
+    file.Write(header.data(), header.size());
+
+    // 整形済みのブロックは AsyncFileWriter が非同期に書き出すため、書き込み中に次のバッチを整形できる
+    std::vector<std::string> blocks(batchSize);
+    for (size_t batchBegin = 0; batchBegin < blockCount; batchBegin += batchSize)
+    {
+        size_t batchEnd = std::min(blockCount, batchBegin + batchSize);
+        ParallelFor(batchEnd - batchBegin, [&](size_t i) {
+            size_t begin = (batchBegin + i) * rowsPerBlock;
+            size_t end = std::min(rows.size(), begin + rowsPerBlock);
+            std::string& block = blocks[i];
+            block.clear();
+            for (size_t r = begin; r < end; ++r)
+            {
+                AppendRow(block, rows[r], newline);
+            }
+        });
+
+        for (size_t i = 0; i < batchEnd - batchBegin; ++i)
+        {
+            if (!file.Write(blocks[i].data(), blocks[i].size()))
+            {
+                file.Close();
+                return false;
+            }
+        }
+    }
+
+    return file.Close();
+}
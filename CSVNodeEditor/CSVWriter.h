@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <string>
+#include <string_view>
+#include <vector>
+
+// CSV 書き出し設定
+struct CSVWriteOptions
+{
+    size_t rowsPerBlock = 16384;    // 1 タスクが整形する行数
+    bool crlfLineEnding = true;     // RFC 4180 の CRLF 改行で書き出す（false なら LF）
+};
+
+// フィールドを 1 つ追記する
+// 区切り文字・二重引用符・改行を含む場合と前後に空白がある場合のみ二重引用符で囲み、内部の '"' は "" にする（RFC 4180）
+void AppendCSVField(std::string& output, std::string_view field);
+
+// 行ブロックを並列に整形し、順番どおりに大きな単位でファイルへ書き出す
+// 書き出しは AsyncFileWriter の write-behind で行い、ディスクへの書き込みと次のバッチの整形を重ねる。
+bool WriteCSVFile(const std::string& path, const std::vector<std::string>& headers,
+    const CSVRowRange& rows, const CSVWriteOptions& options = CSVWriteOptions());
@@ -0,0 +1,352 @@
+﻿#include "CellArena.h"
+#include <algorithm>
+
+namespace
+{
+    // 最初に確保するチャンクの大きさ
+    const size_t minChunkSize = 16 << 10;
+
+    // 重複排除を続けるか判定するまでの標本数と、続けるのに必要な重複の割合（1/internMinHitRatio）
+    const uint32_t internSampleSize = 4096;
+    const uint32_t internMinHitRatio = 4;
+
+    uint32_t HashCell(std::string_view value)
+    {
+        // 8 バイトずつ乗算で混ぜ、最後に splitmix64 の最終化で散らす
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ value.size();
+        const char* p = value.data();
+        size_t remaining = value.size();
+        while (remaining >= 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, p, sizeof(word));
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+            hash ^= hash >> 31;
+            p += 8;
+            remaining -= 8;
+        }
+        if (remaining > 0)
+        {
+            uint64_t word = 0;
+            std::memcpy(&word, p, remaining);
+            hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+        }
+        hash ^= hash >> 30;
+        hash *= 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 27;
+        hash *= 0x94D049BB133111EBull;
+        hash ^= hash >> 31;
+        return static_cast<uint32_t>(hash);
+    }
+}
+
+CellArena::CellArena()
+    : writeData(nullptr)
+    , writeSlot(0)
+    , writeUsed(0)
+    , writeCapacity(0)
+    , nextChunkSize(minChunkSize)
+    , reservedBytes(0)
+    , internCount(0)
+{
+}
+
+CellArena::CellArena(const CellArena& other)
+    : bases(other.bases)
+    , owners(other.owners)
+    , sizes(other.sizes)
+    , writeData(nullptr)
+    , writeSlot(0)
+    , writeUsed(0)
+    , writeCapacity(0)
+    , nextChunkSize(other.nextChunkSize)
+    , reservedBytes(other.reservedBytes)
+    , internRefs(other.internRefs)
+    , internHashes(other.internHashes)
+    , internCount(other.internCount)
+{
+    // 共有したチャンクには書き込まない。複製元は自分の書き込み位置より後ろにだけ追記するため、
+    // 複製が参照している範囲は変更されない。
+    if (other.writeData)
+    {
+        sizes[other.writeSlot] = other.writeUsed;
+    }
+}
+
+CellArena::CellArena(CellArena&& other) noexcept
+    : CellArena()
+{
+    Swap(other);
+}
+
+CellArena& CellArena::operator=(const CellArena& other)
+{
+    if (this != &other)
+    {
+        CellArena copy(other);
+        Swap(copy);
+    }
+    return *this;
+}
+
+CellArena& CellArena::operator=(CellArena&& other) noexcept
+{
+    if (this != &other)
+    {
+        Clear();
+        Swap(other);
+    }
+    return *this;
+}
+
+void CellArena::Swap(CellArena& other) noexcept
+{
+    bases.swap(other.bases);
+    owners.swap(other.owners);
+    sizes.swap(other.sizes);
+    std::swap(writeData, other.writeData);
+    std::swap(writeSlot, other.writeSlot);
+    std::swap(writeUsed, other.writeUsed);
+    std::swap(writeCapacity, other.writeCapacity);
+    std::swap(nextChunkSize, other.nextChunkSize);
+    std::swap(reservedBytes, other.reservedBytes);
+    internRefs.swap(other.internRefs);
+    internHashes.swap(other.internHashes);
+    std::swap(internCount, other.internCount);
+}
+
+char* CellArena::AllocateSlots(size_t size, uint64_t& offset)
+{
+    // チャンクは先頭のスロットに登録し、1MiB を超える分は後続のスロットを欠番にして位置空間だけ確保する
+    std::shared_ptr<char[]> chunk(new char[size]);
+    const size_t slot = bases.size();
+    const size_t slotCount = (size + chunkSize - 1) / chunkSize;
+    bases.push_back(chunk.get());
+    owners.push_back(std::move(chunk));
+    sizes.push_back(size);
+    bases.resize(slot + slotCount, nullptr);
+    owners.resize(slot + slotCount);
+    sizes.resize(slot + slotCount, 0);
+    reservedBytes += size;
+    offset = static_cast<uint64_t>(slot) << chunkBits;
+    return const_cast<char*>(bases[slot]);
+}
+
+CellRef CellArena::Append(std::string_view value)
+{
+    if (value.empty())
+    {
+        return CellRef();
+    }
+
+    const bool escaped = value.size() >= CellRef::lengthEscape;
+    const size_t size = value.size() + (escaped ? sizeof(uint64_t) : 0);
+    char* destination = nullptr;
+    uint64_t offset = 0;
+
+    if (size <= writeCapacity - writeUsed)
+    {
+        destination = writeData + writeUsed;
+        offset = (static_cast<uint64_t>(writeSlot) << chunkBits) + writeUsed;
+        writeUsed += size;
+    }
+    else if (size > chunkSize / 4)
+    {
+        // 大きな値は専用の領域に置き、追記中のチャンクはそのまま使い続ける
+        destination = AllocateSlots(size, offset);
+    }
+    else
+    {
+        if (writeData)
+        {
+            sizes[writeSlot] = writeUsed;
+        }
+        const size_t capacity = std::max(nextChunkSize, size);
+        nextChunkSize = std::min(chunkSize, nextChunkSize * 2);
+        writeData = AllocateSlots(capacity, offset);
+        writeSlot = static_cast<size_t>(offset >> chunkBits);
+        writeCapacity = capacity;
+        writeUsed = size;
+        destination = writeData;
+    }
+
+    CellRef ref;
+    if (escaped)
+    {
+        uint64_t length = value.size();
+        std::memcpy(destination, &length, sizeof(length));
+        std::memcpy(destination + sizeof(length), value.data(), value.size());
+        ref.bits = (CellRef::lengthEscape << CellRef::offsetBits) | offset;
+    }
+    else
+    {
+        std::memcpy(destination, value.data(), value.size());
+        ref.bits = (static_cast<uint64_t>(value.size()) << CellRef::offsetBits) | offset;
+    }
+    return ref;
+}
+
+CellRef CellArena::Intern(std::string_view value, bool* reused)
+{
+    if (reused)
+    {
+        *reused = false;
+    }
+    if (value.empty() || value.size() > maxInternLength)
+    {
+        return Append(value);
+    }
+
+    if ((internCount + 1) * 2 > internRefs.size())
+    {
+        GrowInternTable();
+    }
+
+    const uint32_t hash = HashCell(value);
+    const size_t mask = internRefs.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        if (internRefs[i] == 0)
+        {
+            CellRef ref = Append(value);
+            internRefs[i] = ref.bits;
+            internHashes[i] = hash;
+            ++internCount;
+            return ref;
+        }
+        if (internHashes[i] == hash && Get(CellRef{ internRefs[i] }) == value)
+        {
+            if (reused)
+            {
+                *reused = true;
+            }
+            return CellRef{ internRefs[i] };
+        }
+    }
+}
+
+void CellArena::GrowInternTable()
+{
+    const size_t capacity = std::max<size_t>(1024, internRefs.size() * 2);
+    std::vector<uint64_t> refs(capacity, 0);
+    std::vector<uint32_t> hashes(capacity, 0);
+    const size_t mask = capacity - 1;
+    for (size_t i = 0; i < internRefs.size(); ++i)
+    {
+        if (internRefs[i] == 0)
+        {
+            continue;
+        }
+        size_t slot = internHashes[i] & mask;
+        while (refs[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        refs[slot] = internRefs[i];
+        hashes[slot] = internHashes[i];
+    }
+    internRefs.swap(refs);
+    internHashes.swap(hashes);
+}
+
+uint64_t CellArena::Absorb(CellArena&& other)
+{
+    if (bases.empty())
+    {
+        // 空なら辞書ごと引き取る（位置はそのまま）
+        *this = std::move(other);
+        return 0;
+    }
+
+    // other の辞書は引き取らない（以後の重複排除は自分の辞書だけで行う）
+    const uint64_t delta = static_cast<uint64_t>(bases.size()) << chunkBits;
+    if (other.writeData)
+    {
+        other.sizes[other.writeSlot] = other.writeUsed;
+    }
+    bases.insert(bases.end(), other.bases.begin(), other.bases.end());
+    owners.insert(owners.end(), std::make_move_iterator(other.owners.begin()), std::make_move_iterator(other.owners.end()));
+    sizes.insert(sizes.end(), other.sizes.begin(), other.sizes.end());
+    reservedBytes += other.reservedBytes;
+    other.Clear();
+    return delta;
+}
+
+std::vector<CellArena::ChunkView> CellArena::GetChunks() const
+{
+    std::vector<ChunkView> chunks;
+    for (size_t slot = 0; slot < bases.size(); ++slot)
+    {
+        if (bases[slot])
+        {
+            const size_t size = writeData && slot == writeSlot ? writeUsed : sizes[slot];
+            chunks.push_back(ChunkView{ slot, bases[slot], size });
+        }
+    }
+    return chunks;
+}
+
+void CellArena::AttachChunk(size_t slot, const char* data, size_t size, const std::shared_ptr<const void>& owner)
+{
+    const size_t slotCount = std::max<size_t>(1, (size + chunkSize - 1) / chunkSize);
+    if (bases.size() < slot + slotCount)
+    {
+        bases.resize(slot + slotCount, nullptr);
+        owners.resize(slot + slotCount);
+        sizes.resize(slot + slotCount, 0);
+    }
+
+    // 所有は owner と共有し、チャンクの先頭だけを指す
+    bases[slot] = data;
+    owners[slot] = std::shared_ptr<char[]>(owner, const_cast<char*>(data));
+    sizes[slot] = size;
+
+    // 以後の追記は登録したスロットより後ろに置く
+    writeData = nullptr;
+    writeUsed = 0;
+    writeCapacity = 0;
+}
+
+void CellArena::Clear()
+{
+    std::vector<const char*>().swap(bases);
+    std::vector<std::shared_ptr<char[]>>().swap(owners);
+    std::vector<size_t>().swap(sizes);
+    writeData = nullptr;
+    writeSlot = 0;
+    writeUsed = 0;
+    writeCapacity = 0;
+    nextChunkSize = minChunkSize;
+    reservedBytes = 0;
+    std::vector<uint64_t>().swap(internRefs);
+    std::vector<uint32_t>().swap(internHashes);
+    internCount = 0;
+}
+
+size_t CellArena::GetReservedBytes() const
+{
+    return reservedBytes + bases.capacity() * sizeof(const char*) + owners.capacity() * sizeof(std::shared_ptr<char[]>)
+        + sizes.capacity() * sizeof(size_t)
+        + internRefs.capacity() * sizeof(uint64_t) + internHashes.capacity() * sizeof(uint32_t);
+}
+
+CellRef CellInternPolicy::Store(CellArena& arena, std::string_view value)
+{
+    if (!enabled)
+    {
+        return arena.Append(value);
+    }
+
+    bool reused = false;
+    CellRef ref = arena.Intern(value, &reused);
+    if (probes < internSampleSize && !value.empty() && value.size() <= CellArena::maxInternLength)
+    {
+        ++probes;
+        hits += reused ? 1 : 0;
+        if (probes == internSampleSize)
+        {
+            enabled = hits * internMinHitRatio >= probes;
+        }
+    }
+    return ref;
+}
@@ -0,0 +1,153 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+// アリーナ内のセル文字列への参照
+// 位置（下位 40 ビット）と長さ（上位 24 ビット）を 64 ビットに詰める。空文字列は 0。
+// 長さが lengthEscape 以上の値は、格納位置の先頭 8 バイトに実際の長さを置く。
+struct CellRef
+{
+    static constexpr int offsetBits = 40;
+    static constexpr uint64_t offsetMask = (uint64_t(1) << offsetBits) - 1;
+    static constexpr uint64_t lengthEscape = (uint64_t(1) << (64 - offsetBits)) - 1;
+
+    uint64_t bits = 0;
+
+    bool IsEmpty() const { return (bits >> offsetBits) == 0; }
+
+    // 別のアリーナへ引き取られた参照の位置をずらす
+    CellRef Rebased(uint64_t delta) const { return IsEmpty() ? *this : CellRef{ bits + delta }; }
+
+    bool operator==(const CellRef& other) const { return bits == other.bits; }
+    bool operator!=(const CellRef& other) const { return bits != other.bits; }
+};
+
+// セル文字列を格納するスラブ領域
+// 値は固定の位置空間（1 スロット 1MiB）に割り当てたチャンクへ追記し、個別には解放しない。
+// 破棄はチャンク単位で行うため、セル数に関係なくチャンク数回の解放で済む。
+// チャンクは参照カウントで共有し、複製時はバイト列を複写せずに共有したまま以後の追記先だけを分ける。
+class CellArena
+{
+public:
+    static constexpr int chunkBits = 20;
+    static constexpr size_t chunkSize = size_t(1) << chunkBits;
+
+    // 重複排除の対象にする値の最大長（長い値は重複しにくく、ハッシュの計算が無駄になりやすい）
+    static constexpr size_t maxInternLength = 64;
+
+    CellArena();
+    CellArena(const CellArena& other);
+    CellArena(CellArena&& other) noexcept;
+    CellArena& operator=(const CellArena& other);
+    CellArena& operator=(CellArena&& other) noexcept;
+
+    // 値を複写して参照を返す
+    CellRef Append(std::string_view value);
+
+    // 同じ値が格納済みなら既存の参照を返し、なければ追記して辞書に登録する
+    // reused には既存の参照を返したかどうかを設定する。
+    CellRef Intern(std::string_view value, bool* reused = nullptr);
+
+    std::string_view Get(CellRef ref) const
+    {
+        const uint64_t length = ref.bits >> CellRef::offsetBits;
+        if (length == 0)
+        {
+            return std::string_view();
+        }
+        const uint64_t offset = ref.bits & CellRef::offsetMask;
+        const char* data = bases[static_cast<size_t>(offset >> chunkBits)] + (offset & (chunkSize - 1));
+        if (length == CellRef::lengthEscape)
+        {
+            uint64_t actual;
+            std::memcpy(&actual, data, sizeof(actual));
+            return std::string_view(data + sizeof(actual), static_cast<size_t>(actual));
+        }
+        return std::string_view(data, static_cast<size_t>(length));
+    }
+
+    // other のチャンクを末尾のスロットに引き取る
+    // 戻り値は other で作った参照に加える位置の差分（CellRef::Rebased に渡す）。
+    uint64_t Absorb(CellArena&& other);
+
+    // 格納済みのチャンク（先頭のスロット番号・先頭・書き込み済みのバイト数）
+    // ワークスペースのスナップショットはチャンクをこの位置空間のまま書き出すため、セル参照を書き換えずに済む。
+    struct ChunkView
+    {
+        size_t slot;
+        const char* data;
+        size_t size;
+    };
+    std::vector<ChunkView> GetChunks() const;
+    size_t GetSlotCount() const { return bases.size(); }
+
+    // 外部のバイト列（メモリマップしたファイルなど）を slot から始まるチャンクとして登録する
+    // owner はチャンクを参照する間保持する。登録したチャンクには追記せず、以後の値は新しいスロットに置く。
+    void AttachChunk(size_t slot, const char* data, size_t size, const std::shared_ptr<const void>& owner);
+
+    // すべてのチャンクと辞書を解放する
+    void Clear();
+
+    // 確保済みのバイト数（チャンクと辞書）
+    size_t GetReservedBytes() const;
+
+    size_t GetInternedCount() const { return internCount; }
+
+    void Swap(CellArena& other) noexcept;
+
+private:
+    std::vector<const char*> bases;                 // スロットごとのチャンク先頭（大きな値の後続スロットは nullptr）
+    std::vector<std::shared_ptr<char[]>> owners;
+    std::vector<size_t> sizes;                      // スロットごとのチャンクの書き込み済みバイト数（追記中のチャンクは切り替え時に確定する）
+    char* writeData;                                // 追記中のチャンク（複製直後は無し）
+    size_t writeSlot;
+    size_t writeUsed;
+    size_t writeCapacity;
+    size_t nextChunkSize;                           // 小さな表で 1MiB を確保しないよう、チャンクは倍々に大きくする
+    size_t reservedBytes;
+
+    // 重複排除の辞書（開番地法。参照 0 は空きを表す）
+    std::vector<uint64_t> internRefs;
+    std::vector<uint32_t> internHashes;
+    size_t internCount;
+
+    char* AllocateSlots(size_t size, uint64_t& offset);
+    void GrowInternTable();
+};
+
+// 1 列分の重複排除の判定
+// 先頭の標本で重複がほとんど無い列（ID など）は、以後は辞書を引かずに追記する。
+class CellInternPolicy
+{
+public:
+    CellRef Store(CellArena& arena, std::string_view value);
+
+private:
+    uint32_t probes = 0;
+    uint32_t hits = 0;
+    bool enabled = true;
+};
+
+// 並列に組み立てる部分表（行優先で 1 行あたり列数分のセル）
+// 作業単位ごとにアリーナを持たせ、最後に CSVData::SetCellBlocks でまとめる。
+struct CellBlock
+{
+    CellArena arena;
+    std::vector<CellRef> cells;
+    std::vector<CellInternPolicy> policies;
+
+    // column 列の値として（列ごとの重複排除の判定に従って）格納し、参照を返す
+    CellRef Store(size_t column, std::string_view value)
+    {
+        if (column >= policies.size())
+        {
+            policies.resize(column + 1);
+        }
+        return policies[column].Store(arena, value);
+    }
+};
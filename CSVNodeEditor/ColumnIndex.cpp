@@ -0,0 +1,504 @@
+﻿#include "ColumnIndex.h"
+#include "CSVData.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include "ZoneMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <limits>
+
+namespace
+{
+    // 1回の並列処理で受け持つ行数
+    const size_t indexBlockRows = 65536;
+
+    // ハッシュ索引の区画数（ハッシュの上位ビットで選ぶ）
+    const int partitionBits = 6;
+    const size_t partitionCount = size_t(1) << partitionBits;
+
+    uint64_t MixHash(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    bool KeyLess(const CellKey& a, const CellKey& b)
+    {
+        if (a.numeric != b.numeric)
+        {
+            return a.numeric;
+        }
+        return a.numeric ? a.number < b.number : a.text < b.text;
+    }
+
+    // 行番号を昇順に並べ直す（多い場合は行数分のビット表で数え直す方が速い）
+    void SortRowIds(std::vector<uint32_t>& rows, size_t rowCount)
+    {
+        if (rows.size() < rowCount / 8)
+        {
+            std::sort(rows.begin(), rows.end());
+            return;
+        }
+        std::vector<uint8_t> selected(rowCount, 0);
+        for (uint32_t row : rows)
+        {
+            selected[row] = 1;
+        }
+        rows.clear();
+        for (size_t r = 0; r < rowCount; ++r)
+        {
+            if (selected[r])
+            {
+                rows.push_back(static_cast<uint32_t>(r));
+            }
+        }
+    }
+
+    // [lower, upper) が比較値と等しい範囲のとき、op を満たす範囲を rows に追加する
+    void AppendMatchingRange(const std::string& op, const uint32_t* order, size_t count, size_t lower, size_t upper, std::vector<uint32_t>& rows)
+    {
+        auto append = [&](size_t begin, size_t end) {
+            rows.insert(rows.end(), order + begin, order + end);
+        };
+        if (op == "==") append(lower, upper);
+        else if (op == "!=") { append(0, lower); append(upper, count); }
+        else if (op == "<") append(0, lower);
+        else if (op == "<=") append(0, upper);
+        else if (op == ">") append(upper, count);
+        else if (op == ">=") append(lower, count);
+    }
+
+    // 文字列順に並んだ order の中で value と等しい範囲を求めて追加する
+    void AppendTextRange(const CSVData& data, size_t column, const std::vector<uint32_t>& order, const CompiledPredicate& predicate, std::vector<uint32_t>& rows)
+    {
+        std::string_view value = predicate.value;
+        auto lower = std::lower_bound(order.begin(), order.end(), value,
+            [&](uint32_t row, std::string_view v) { return data.GetCell(row, column) < v; });
+        auto upper = std::upper_bound(lower, order.end(), value,
+            [&](std::string_view v, uint32_t row) { return v < data.GetCell(row, column); });
+        AppendMatchingRange(predicate.op, order.data(), order.size(), lower - order.begin(), upper - order.begin(), rows);
+    }
+}
+
+CellKey CellKey::From(std::string_view cell)
+{
+    CellKey key;
+    key.text = cell;
+    key.numeric = ParseDouble(cell, key.number);
+    if (key.numeric && key.number == 0.0)
+    {
+        key.number = 0.0;   // -0 と 0 を同じキーにする
+    }
+    return key;
+}
+
+uint64_t CellKey::Hash() const
+{
+    if (numeric)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        return MixHash(bits ^ 0x9e3779b97f4a7c15ULL);
+    }
+    return MixHash(std::hash<std::string_view>()(text));
+}
+
+bool CellKey::operator==(const CellKey& other) const
+{
+    if (numeric != other.numeric)
+    {
+        return false;
+    }
+    return numeric ? number == other.number : text == other.text;
+}
+
+std::shared_ptr<const HashColumnIndex> HashColumnIndex::Build(const CSVData& data, size_t column)
+{
+    const size_t rowCount = data.GetRowCount();
+    if (rowCount > std::numeric_limits<uint32_t>::max())
+    {
+        return nullptr;
+    }
+
+    auto index = std::make_shared<HashColumnIndex>();
+    index->column = column;
+
+    // キーのハッシュを求めながら、ブロックごとに各区画の行数を数える
+    std::vector<CellKey> keys(rowCount);
+    std::vector<uint64_t> hashes(rowCount);
+    const size_t blockCount = (rowCount + indexBlockRows - 1) / indexBlockRows;
+    std::vector<size_t> positions(blockCount * partitionCount, 0);
+    ParallelFor(blockCount, [&](size_t b) {
+        size_t begin = b * indexBlockRows;
+        size_t end = std::min(rowCount, begin + indexBlockRows);
+        size_t* counts = positions.data() + b * partitionCount;
+        for (size_t r = begin; r < end; ++r)
+        {
+            keys[r] = CellKey::From(data.GetCell(r, column));
+            hashes[r] = keys[r].Hash();
+            ++counts[hashes[r] >> (64 - partitionBits)];
+        }
+    });
+
+    // 区画ごとに連続するよう、各ブロックの書き込み位置を決めて行番号を振り分ける
+    std::vector<size_t> partitionStarts(partitionCount + 1);
+    size_t position = 0;
+    for (size_t p = 0; p < partitionCount; ++p)
+    {
+        partitionStarts[p] = position;
+        for (size_t b = 0; b < blockCount; ++b)
+        {
+            size_t count = positions[b * partitionCount + p];
+            positions[b * partitionCount + p] = position;
+            position += count;
+        }
+    }
+    partitionStarts[partitionCount] = position;
+
+    index->rows.resize(rowCount);
+    ParallelFor(blockCount, [&](size_t b) {
+        size_t begin = b * indexBlockRows;
+        size_t end = std::min(rowCount, begin + indexBlockRows);
+        size_t* next = positions.data() + b * partitionCount;
+        for (size_t r = begin; r < end; ++r)
+        {
+            index->rows[next[hashes[r] >> (64 - partitionBits)]++] = static_cast<uint32_t>(r);
+        }
+    });
+
+    // 区画内をハッシュ順に並べてキーごとの範囲に分ける
+    // 同じハッシュに異なるキーが混ざった場合（衝突）だけ、その範囲をキーの順に並べ直す。
+    std::vector<std::vector<Group>> partitionGroups(partitionCount);
+    ParallelFor(partitionCount, [&](size_t p) {
+        uint32_t* first = index->rows.data() + partitionStarts[p];
+        uint32_t* last = index->rows.data() + partitionStarts[p + 1];
+        std::sort(first, last, [&](uint32_t a, uint32_t b) {
+            return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : a < b;
+        });
+
+        auto& groups = partitionGroups[p];
+        for (uint32_t* run = first; run != last;)
+        {
+            const uint64_t hash = hashes[*run];
+            uint32_t* runEnd = run + 1;
+            bool collided = false;
+            while (runEnd != last && hashes[*runEnd] == hash)
+            {
+                collided = collided || keys[*runEnd] != keys[*run];
+                ++runEnd;
+            }
+            if (collided)
+            {
+                std::stable_sort(run, runEnd, [&](uint32_t a, uint32_t b) { return KeyLess(keys[a], keys[b]); });
+            }
+
+            for (uint32_t* group = run; group != runEnd;)
+            {
+                uint32_t* groupEnd = group + 1;
+                while (groupEnd != runEnd && keys[*groupEnd] == keys[*group])
+                {
+                    ++groupEnd;
+                }
+                Group entry;
+                entry.hash = hash;
+                entry.begin = static_cast<uint32_t>(group - index->rows.data());
+                entry.count = static_cast<uint32_t>(groupEnd - group);
+                groups.push_back(entry);
+                group = groupEnd;
+            }
+            run = runEnd;
+        }
+    });
+
+    // 区画ごとに要素数の 2 倍以上の 2 のべき乗の大きさの表に登録する
+    index->tableOffsets.resize(partitionCount + 1);
+    size_t tableSize = 0;
+    for (size_t p = 0; p < partitionCount; ++p)
+    {
+        index->tableOffsets[p] = tableSize;
+        size_t capacity = 0;
+        if (!partitionGroups[p].empty())
+        {
+            capacity = 4;
+            while (capacity < partitionGroups[p].size() * 2)
+            {
+                capacity *= 2;
+            }
+        }
+        tableSize += capacity;
+        index->groupCount += partitionGroups[p].size();
+    }
+    index->tableOffsets[partitionCount] = tableSize;
+
+    Group emptyGroup = {};
+    index->table.assign(tableSize, emptyGroup);
+    ParallelFor(partitionCount, [&](size_t p) {
+        Group* slots = index->table.data() + index->tableOffsets[p];
+        const size_t mask = index->tableOffsets[p + 1] - index->tableOffsets[p] - 1;
+        for (const Group& group : partitionGroups[p])
+        {
+            size_t slot = static_cast<size_t>(group.hash) & mask;
+            while (slots[slot].count != 0)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot] = group;
+        }
+        std::vector<Group>().swap(partitionGroups[p]);
+    });
+
+    return index;
+}
+
+RowIdRange HashColumnIndex::Find(const CSVData& data, const CellKey& key, uint64_t hash) const
+{
+    RowIdRange result;
+    if (tableOffsets.empty())
+    {
+        return result;
+    }
+
+    const size_t partition = static_cast<size_t>(hash >> (64 - partitionBits));
+    const size_t capacity = tableOffsets[partition + 1] - tableOffsets[partition];
+    if (capacity == 0)
+    {
+        return result;
+    }
+
+    const Group* slots = table.data() + tableOffsets[partition];
+    for (size_t slot = static_cast<size_t>(hash) & (capacity - 1);; slot = (slot + 1) & (capacity - 1))
+    {
+        const Group& group = slots[slot];
+        if (group.count == 0)
+        {
+            return result;
+        }
+        if (group.hash == hash && CellKey::From(data.GetCell(rows[group.begin], column)) == key)
+        {
+            result.first = rows.data() + group.begin;
+            result.count = group.count;
+            return result;
+        }
+    }
+}
+
+std::vector<uint64_t> HashColumnIndex::GetKeyHashes() const
+{
+    std::vector<uint64_t> hashes;
+    hashes.reserve(groupCount);
+    for (const Group& group : table)
+    {
+        if (group.count != 0)
+        {
+            hashes.push_back(group.hash);
+        }
+    }
+    return hashes;
+}
+
+size_t HashColumnIndex::GetMemoryUsage() const
+{
+    return rows.capacity() * sizeof(uint32_t) + table.capacity() * sizeof(Group) + tableOffsets.capacity() * sizeof(size_t);
+}
+
+std::shared_ptr<const SortedColumnIndex> SortedColumnIndex::Build(const CSVData& data, size_t column)
+{
+    const size_t rowCount = data.GetRowCount();
+    if (rowCount > std::numeric_limits<uint32_t>::max())
+    {
+        return nullptr;
+    }
+
+    auto index = std::make_shared<SortedColumnIndex>();
+    index->column = column;
+    index->rowCount = rowCount;
+
+    struct TextEntry
+    {
+        std::string_view text;
+        uint32_t row;
+    };
+    struct NumericEntry
+    {
+        double number;
+        uint32_t row;
+    };
+
+    // セル値を取り出して数値かどうかを判定する
+    std::vector<TextEntry> texts(rowCount);
+    std::vector<double> numbers(rowCount);
+    std::vector<uint8_t> isNumeric(rowCount);
+    const size_t blockCount = (rowCount + indexBlockRows - 1) / indexBlockRows;
+    ParallelFor(blockCount, [&](size_t b) {
+        size_t begin = b * indexBlockRows;
+        size_t end = std::min(rowCount, begin + indexBlockRows);
+        for (size_t r = begin; r < end; ++r)
+        {
+            texts[r].text = data.GetCell(r, column);
+            texts[r].row = static_cast<uint32_t>(r);
+            // 数値の区画には順序付けできる値だけを入れる（NaN があると比較が狭義の弱順序にならない）
+            isNumeric[r] = ParseDouble(texts[r].text, numbers[r]) && std::isfinite(numbers[r]) ? 1 : 0;
+        }
+    });
+
+    std::vector<NumericEntry> numericEntries;
+    for (size_t r = 0; r < rowCount; ++r)
+    {
+        if (isNumeric[r])
+        {
+            numericEntries.push_back({ numbers[r], static_cast<uint32_t>(r) });
+        }
+    }
+    std::vector<double>().swap(numbers);
+
+    ParallelSort(texts, [](const TextEntry& a, const TextEntry& b) {
+        int order = a.text.compare(b.text);
+        return order != 0 ? order < 0 : a.row < b.row;
+    });
+    ParallelSort(numericEntries, [](const NumericEntry& a, const NumericEntry& b) {
+        return a.number != b.number ? a.number < b.number : a.row < b.row;
+    });
+
+    index->textOrder.resize(rowCount);
+    index->otherOrder.reserve(rowCount - numericEntries.size());
+    for (size_t i = 0; i < rowCount; ++i)
+    {
+        const uint32_t row = texts[i].row;
+        index->textOrder[i] = row;
+        if (!isNumeric[row])
+        {
+            index->otherOrder.push_back(row);
+        }
+    }
+    index->numericOrder.resize(numericEntries.size());
+    index->numericKeys.resize(numericEntries.size());
+    for (size_t i = 0; i < numericEntries.size(); ++i)
+    {
+        index->numericOrder[i] = numericEntries[i].row;
+        index->numericKeys[i] = numericEntries[i].number;
+    }
+    return index;
+}
+
+bool SortedColumnIndex::Select(const CSVData& data, const CompiledPredicate& predicate, std::vector<uint32_t>& rows) const
+{
+    rows.clear();
+    if (predicate.op == "contains")
+    {
+        return false;
+    }
+
+    if (!predicate.valueIsNumeric)
+    {
+        // 比較値が数値でなければ、すべてのセルが文字列として比較される
+        AppendTextRange(data, column, textOrder, predicate, rows);
+    }
+    else
+    {
+        // 数値のセルは数値として、それ以外のセルは文字列として比較される
+        auto lower = std::lower_bound(numericKeys.begin(), numericKeys.end(), predicate.numericValue);
+        auto upper = std::upper_bound(lower, numericKeys.end(), predicate.numericValue);
+        AppendMatchingRange(predicate.op, numericOrder.data(), numericOrder.size(),
+            lower - numericKeys.begin(), upper - numericKeys.begin(), rows);
+        AppendTextRange(data, column, otherOrder, predicate, rows);
+    }
+
+    SortRowIds(rows, rowCount);
+    return true;
+}
+
+size_t SortedColumnIndex::GetMemoryUsage() const
+{
+    return (textOrder.capacity() + numericOrder.capacity() + otherOrder.capacity()) * sizeof(uint32_t)
+        + numericKeys.capacity() * sizeof(double);
+}
+
+std::vector<uint32_t> SelectRows(const CSVData& data, const CompiledPredicate& predicate, SelectStats* stats)
+{
+    std::vector<uint32_t> rows;
+    SelectStats localStats;
+    SelectStats& result = stats ? *stats : localStats;
+    result = SelectStats();
+    if (predicate.columnIndex < 0)
+    {
+        return rows;
+    }
+
+    const size_t column = static_cast<size_t>(predicate.columnIndex);
+    const size_t rowCount = data.GetRowCount();
+
+    // 等価・不等価はハッシュ索引で一致する行をまとめて引く
+    auto hashIndex = data.GetHashIndex(column);
+    if (hashIndex && (predicate.op == "==" || predicate.op == "!="))
+    {
+        CellKey key = CellKey::From(predicate.value);
+        RowIdRange matches = hashIndex->Find(data, key);
+        if (predicate.op == "==")
+        {
+            rows.assign(matches.begin(), matches.end());
+        }
+        else
+        {
+            // 一致する行は昇順に並んでいるため、それ以外の行を順に拾う
+            rows.reserve(rowCount - matches.count);
+            const uint32_t* skip = matches.begin();
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                if (skip != matches.end() && *skip == r)
+                {
+                    ++skip;
+                    continue;
+                }
+                rows.push_back(static_cast<uint32_t>(r));
+            }
+        }
+        result.usedIndex = true;
+        return rows;
+    }
+
+    auto sortedIndex = data.GetSortedIndex(column);
+    if (sortedIndex && sortedIndex->Select(data, predicate, rows))
+    {
+        result.usedIndex = true;
+        return rows;
+    }
+
+    // 索引が無ければブロックごとに並列に走査して連結する
+    // ゾーンマップがあればそのブロック分けに合わせ、要約から一致し得ないと分かるブロックは読まない。
+    auto zoneMap = data.GetZoneMap();
+    const std::vector<ColumnZone>* zones = zoneMap && column < zoneMap->columns.size() ? &zoneMap->columns[column] : nullptr;
+    const size_t blockRows = zones ? zoneMap->blockRows : indexBlockRows;
+    const size_t blockCount = (rowCount + blockRows - 1) / blockRows;
+    std::vector<std::vector<uint32_t>> blockRowIds(blockCount);
+    std::vector<uint8_t> skipped(blockCount, 0);
+    ParallelFor(blockCount, [&](size_t b) {
+        if (zones && !predicate.MayMatchZone((*zones)[b]))
+        {
+            skipped[b] = 1;
+            return;
+        }
+        size_t begin = b * blockRows;
+        size_t end = std::min(rowCount, begin + blockRows);
+        for (size_t r = begin; r < end; ++r)
+        {
+            if (predicate.Matches(data.GetCell(r, column)))
+            {
+                blockRowIds[b].push_back(static_cast<uint32_t>(r));
+            }
+        }
+    });
+    for (const auto& block : blockRowIds)
+    {
+        rows.insert(rows.end(), block.begin(), block.end());
+    }
+
+    result.blockCount = blockCount;
+    result.skippedBlocks = static_cast<size_t>(std::count(skipped.begin(), skipped.end(), 1));
+    return rows;
+}
@@ -0,0 +1,115 @@
+﻿#pragma once
+
+#include "Predicate.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+class CSVData;
+
+// 等価比較に使うセルのキー
+// CompiledPredicate と同じく、数値として解釈できるセルは数値（"1" と "1.0" は等しい）、それ以外は文字列として扱う。
+struct CellKey
+{
+    bool numeric = false;
+    double number = 0.0;
+    std::string_view text;
+
+    static CellKey From(std::string_view cell);
+
+    uint64_t Hash() const;
+    bool operator==(const CellKey& other) const;
+    bool operator!=(const CellKey& other) const { return !(*this == other); }
+};
+
+// 索引が返す行番号の並び（索引を破棄するまで有効）
+struct RowIdRange
+{
+    const uint32_t* first = nullptr;
+    size_t count = 0;
+
+    const uint32_t* begin() const { return first; }
+    const uint32_t* end() const { return first + count; }
+    bool empty() const { return count == 0; }
+};
+
+// 等価検索用のハッシュ索引
+// 行番号をキーごとにまとめて 1 本の配列に並べ、キーのハッシュから該当範囲を引く表を持つ。
+// 行番号はキーごとに昇順で、索引を作成したときの表の行順を指す。
+class HashColumnIndex
+{
+public:
+    // ハッシュの上位ビットで分けた区画ごとに並列に作成する（行数が 32 ビットを超える表は nullptr）
+    static std::shared_ptr<const HashColumnIndex> Build(const CSVData& data, size_t column);
+
+    // key と等しいセルを持つ行（data は作成元の表。ハッシュの衝突はセルの比較で判別する）
+    RowIdRange Find(const CSVData& data, const CellKey& key) const { return Find(data, key, key.Hash()); }
+    RowIdRange Find(const CSVData& data, const CellKey& key, uint64_t hash) const;
+
+    // 異なるキーごとのハッシュ値（Bloom フィルターの作成用）
+    std::vector<uint64_t> GetKeyHashes() const;
+
+    size_t GetColumn() const { return column; }
+    size_t GetDistinctCount() const { return groupCount; }
+    size_t GetMemoryUsage() const;
+
+private:
+    // 同じキーを持つ行の範囲（count が 0 なら空き）
+    struct Group
+    {
+        uint64_t hash;
+        uint32_t begin;
+        uint32_t count;
+    };
+
+    size_t column = 0;
+    size_t groupCount = 0;
+    std::vector<uint32_t> rows;
+    std::vector<Group> table;           // 区画ごとの開番地法の表を連結したもの
+    std::vector<size_t> tableOffsets;   // 区画の表の先頭（区画数 + 1 個）
+};
+
+// 範囲検索・ソート用の整列済み索引
+// 全行を文字列順に並べた順列に加え、数値として解釈できる行を数値順に並べた順列を持ち、
+// CompiledPredicate と同じ比較規則で一致する範囲を二分探索する。
+class SortedColumnIndex
+{
+public:
+    // 並列ソートで作成する（行数が 32 ビットを超える表は nullptr）
+    static std::shared_ptr<const SortedColumnIndex> Build(const CSVData& data, size_t column);
+
+    // 文字列の昇順（等しい値は行番号の昇順）に並べた全行
+    const std::vector<uint32_t>& GetTextOrder() const { return textOrder; }
+
+    // 条件に一致する行を行番号の昇順で rows に設定する（data は作成元の表）
+    // 範囲で表せない演算子（contains）は false を返す。
+    bool Select(const CSVData& data, const CompiledPredicate& predicate, std::vector<uint32_t>& rows) const;
+
+    size_t GetColumn() const { return column; }
+    size_t GetMemoryUsage() const;
+
+private:
+    size_t column = 0;
+    size_t rowCount = 0;
+    std::vector<uint32_t> textOrder;
+    std::vector<uint32_t> numericOrder;     // 数値として解釈できる行（数値の昇順）
+    std::vector<double> numericKeys;        // numericOrder と同じ順の数値
+    std::vector<uint32_t> otherOrder;       // 数値以外の行（文字列の昇順）
+};
+
+// SelectRows の実行結果
+struct SelectStats
+{
+    bool usedIndex = false;        // 索引で一致する行を引いたか
+    size_t blockCount = 0;         // 全行を走査した場合のブロック数
+    size_t skippedBlocks = 0;      // ゾーンマップで読み飛ばしたブロック数
+
+    double GetSkipRatio() const { return blockCount > 0 ? static_cast<double>(skippedBlocks) / blockCount : 0.0; }
+};
+
+// 条件に一致する行を行番号の昇順で返す
+// 対象列に有効な索引があればそれを使い（等価・不等価はハッシュ索引、範囲は整列済み索引）、
+// 無ければブロックごとに並列に走査する。ゾーンマップがあれば一致し得ないブロックは読み飛ばす。
+std::vector<uint32_t> SelectRows(const CSVData& data, const CompiledPredicate& predicate, SelectStats* stats = nullptr);
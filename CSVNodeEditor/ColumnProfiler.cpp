@@ -0,0 +1,279 @@
+﻿#include "ColumnProfiler.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include "Sampling.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <thread>
+
+namespace
+{
+    // 1タスクが担当する最小行数
+    const size_t minRowsPerTask = 65536;
+
+    // HyperLogLog のレジスタ数（2^hllBits 個、標準誤差は約 3%）
+    const int hllBits = 10;
+    const size_t hllRegisters = size_t(1) << hllBits;
+
+    // 度数分布の推定に使う標本数（タスク・列あたり）と階級数
+    const size_t histogramSampleSize = 4096;
+    const size_t histogramBins = 20;
+
+    uint64_t MixHash(uint64_t value)
+    {
+        // splitmix64 の最終化でハッシュのビットを均等に散らす
+        value ^= value >> 30;
+        value *= 0xBF58476D1CE4E5B9ull;
+        value ^= value >> 27;
+        value *= 0x94D049BB133111EBull;
+        value ^= value >> 31;
+        return value;
+    }
+
+    bool ParseNumber(std::string_view value, double& result)
+    {
+        return ParseDouble(value, result) && std::isfinite(result);
+    }
+
+    // 1タスク・1列分の部分集計
+    struct ColumnAccumulator
+    {
+        explicit ColumnAccumulator(uint64_t seed)
+            : sampler(histogramSampleSize, seed)
+            , registers(hllRegisters, 0)
+        {
+        }
+
+        size_t nullCount = 0;
+        size_t nonNullCount = 0;
+        size_t numericCount = 0;
+        double mean = 0.0;
+        double m2 = 0.0;
+        double numericMin = std::numeric_limits<double>::infinity();
+        double numericMax = -std::numeric_limits<double>::infinity();
+        // 最小・最大のセルは表のアリーナを指す（集計中は表が変更されない）
+        std::string_view numericMinText;
+        std::string_view numericMaxText;
+        std::string_view textMin;
+        std::string_view textMax;
+        ReservoirSampler sampler;
+        std::vector<double> sample;
+        std::vector<uint8_t> registers;
+
+        void Add(std::string_view cell)
+        {
+            if (cell.empty())
+            {
+                ++nullCount;
+                return;
+            }
+
+            ++nonNullCount;
+            if (textMin.empty() || cell < textMin) textMin = cell;
+            if (textMax.empty() || cell > textMax) textMax = cell;
+
+            uint64_t hash = MixHash(std::hash<std::string_view>()(cell));
+            size_t registerIndex = static_cast<size_t>(hash >> (64 - hllBits));
+            uint64_t rest = (hash << hllBits) | (uint64_t(1) << (hllBits - 1));
+            uint8_t rank = 1;
+            while ((rest & (uint64_t(1) << 63)) == 0)
+            {
+                ++rank;
+                rest <<= 1;
+            }
+            registers[registerIndex] = std::max(registers[registerIndex], rank);
+
+            double value = 0.0;
+            if (!ParseNumber(cell, value))
+            {
+                return;
+            }
+
+            ++numericCount;
+            double delta = value - mean;
+            mean += delta / static_cast<double>(numericCount);
+            m2 += delta * (value - mean);
+            if (value < numericMin)
+            {
+                numericMin = value;
+                numericMinText = cell;
+            }
+            if (value > numericMax)
+            {
+                numericMax = value;
+                numericMaxText = cell;
+            }
+
+            size_t slot = sampler.Offer();
+            if (slot != ReservoirSampler::npos)
+            {
+                if (slot >= sample.size())
+                {
+                    sample.resize(slot + 1);
+                }
+                sample[slot] = value;
+            }
+        }
+
+        void Merge(const ColumnAccumulator& other)
+        {
+            nullCount += other.nullCount;
+            nonNullCount += other.nonNullCount;
+            if (!other.textMin.empty() && (textMin.empty() || other.textMin < textMin)) textMin = other.textMin;
+            if (!other.textMax.empty() && (textMax.empty() || other.textMax > textMax)) textMax = other.textMax;
+            for (size_t i = 0; i < hllRegisters; ++i)
+            {
+                registers[i] = std::max(registers[i], other.registers[i]);
+            }
+
+            if (other.numericCount == 0)
+            {
+                return;
+            }
+
+            // Chan らの並列分散アルゴリズムで平均と二乗偏差和を合成する
+            size_t total = numericCount + other.numericCount;
+            double delta = other.mean - mean;
+            mean += delta * static_cast<double>(other.numericCount) / static_cast<double>(total);
+            m2 += other.m2 + delta * delta * static_cast<double>(numericCount) * static_cast<double>(other.numericCount) / static_cast<double>(total);
+            numericCount = total;
+
+            if (other.numericMin < numericMin)
+            {
+                numericMin = other.numericMin;
+                numericMinText = other.numericMinText;
+            }
+            if (other.numericMax > numericMax)
+            {
+                numericMax = other.numericMax;
+                numericMaxText = other.numericMaxText;
+            }
+        }
+
+        double EstimateDistinct() const
+        {
+            double sum = 0.0;
+            size_t zeros = 0;
+            for (uint8_t value : registers)
+            {
+                sum += std::ldexp(1.0, -static_cast<int>(value));
+                if (value == 0) ++zeros;
+            }
+
+            const double m = static_cast<double>(hllRegisters);
+            const double alpha = 0.7213 / (1.0 + 1.079 / m);
+            double estimate = alpha * m * m / sum;
+
+            // 小さな集合は線形計数で補正する
+            if (estimate <= 2.5 * m && zeros > 0)
+            {
+                estimate = m * std::log(m / static_cast<double>(zeros));
+            }
+            return estimate;
+        }
+    };
+}
+
+std::vector<DataStatistics> ProfileColumns(const CSVData& data)
+{
+    const auto& rows = data.GetRows();
+    const size_t columnCount = data.GetColumnCount();
+    const size_t rowCount = rows.size();
+
+    size_t taskCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    taskCount = std::max<size_t>(1, std::min(taskCount, (rowCount + minRowsPerTask - 1) / minRowsPerTask));
+    const size_t rowsPerTask = (rowCount + taskCount - 1) / std::max<size_t>(1, taskCount);
+
+    std::vector<std::vector<ColumnAccumulator>> partials(taskCount);
+    ParallelFor(taskCount, [&](size_t task) {
+        auto& accumulators = partials[task];
+        accumulators.reserve(columnCount);
+        for (size_t c = 0; c < columnCount; ++c)
+        {
+            accumulators.emplace_back(static_cast<uint64_t>(task) * 0x9E3779B97F4A7C15ull + c);
+        }
+
+        size_t begin = task * rowsPerTask;
+        size_t end = std::min(rowCount, begin + rowsPerTask);
+        for (size_t r = begin; r < end; ++r)
+        {
+            const CSVRow row = rows[r];
+            for (size_t c = 0; c < columnCount; ++c)
+            {
+                accumulators[c].Add(row[c]);
+            }
+        }
+    });
+
+    std::vector<DataStatistics> statistics(columnCount);
+    ParallelFor(columnCount, [&](size_t c) {
+        ColumnAccumulator& merged = partials[0][c];
+        for (size_t task = 1; task < taskCount; ++task)
+        {
+            merged.Merge(partials[task][c]);
+        }
+
+        DataStatistics& stats = statistics[c];
+        stats.totalRows = rowCount;
+        stats.nullCount = merged.nullCount;
+        stats.numericCount = merged.numericCount;
+        stats.isNumeric = merged.nonNullCount > 0 && merged.numericCount == merged.nonNullCount;
+        stats.distinctEstimate = std::min(merged.nonNullCount, static_cast<size_t>(std::llround(merged.EstimateDistinct())));
+
+        if (stats.isNumeric)
+        {
+            stats.minValue = std::string(merged.numericMinText);
+            stats.maxValue = std::string(merged.numericMaxText);
+        }
+        else if (!merged.textMin.empty())
+        {
+            stats.minValue = std::string(merged.textMin);
+            stats.maxValue = std::string(merged.textMax);
+        }
+
+        if (merged.numericCount == 0)
+        {
+            return;
+        }
+
+        stats.numericMin = merged.numericMin;
+        stats.numericMax = merged.numericMax;
+        stats.average = merged.mean;
+        stats.standardDeviation = merged.numericCount > 1
+            ? std::sqrt(merged.m2 / static_cast<double>(merged.numericCount - 1))
+            : 0.0;
+
+        // 各タスクの標本を、そのタスクの数値件数で重み付けして度数分布を推定する
+        std::vector<double> weighted(histogramBins, 0.0);
+        double range = stats.numericMax - stats.numericMin;
+        for (size_t task = 0; task < taskCount; ++task)
+        {
+            const ColumnAccumulator& partial = partials[task][c];
+            if (partial.sample.empty())
+            {
+                continue;
+            }
+            // 標本器はマージされないため、GetSeenCount はそのタスク内の数値件数を表す
+            double weight = static_cast<double>(partial.sampler.GetSeenCount()) / static_cast<double>(partial.sample.size());
+            for (double value : partial.sample)
+            {
+                size_t bin = range > 0.0
+                    ? std::min(histogramBins - 1, static_cast<size_t>((value - stats.numericMin) / range * histogramBins))
+                    : 0;
+                weighted[bin] += weight;
+            }
+        }
+
+        stats.histogram.resize(histogramBins);
+        for (size_t bin = 0; bin < histogramBins; ++bin)
+        {
+            stats.histogram[bin] = static_cast<size_t>(std::llround(weighted[bin]));
+        }
+    });
+
+    return statistics;
+}
@@ -0,0 +1,10 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include "DataStatistics.h"
+#include <vector>
+
+// 全列の統計情報を1回の並列走査で計算する
+// 行範囲ごとに部分集計（Welford の平均・分散、HyperLogLog、度数分布用の標本）を作り、
+// 最後にスレッド間でマージする。
+std::vector<DataStatistics> ProfileColumns(const CSVData& data);
@@ -0,0 +1,628 @@
+﻿#include "ColumnarCache.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include "ZoneMap.h"
+#include <algorithm>
+#include <charconv>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+
+namespace
+{
+    const char cacheMagic[8] = { 'N', 'S', 'C', 'A', 'C', 'H', 'E', '1' };
+    // 2: 読み込み時に UTF-8 へ変換した文字列を保存する（CP932 のファイルも変換後の内容を持つ）
+    // 3: 列ごとにゾーンマップ（ブロック単位の要約）を保存する
+    // 4: 行ごとのセル数が揃っていない表は、最も長い行までの列と行ごとのセル数を保存する
+    const uint32_t cacheFormatVersion = 4;
+
+    // 内容ハッシュの対象とする先頭・末尾のバイト数
+    const size_t fingerprintBlockSize = 1 << 20;
+
+    enum class SegmentType : uint8_t
+    {
+        Int64 = 0,
+        Float64 = 1,
+        Dictionary = 2,
+        String = 3
+    };
+
+    uint64_t HashBytes(const char* data, size_t size, uint64_t hash)
+    {
+        // FNV-1a
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    // 1列分のセグメントを符号化する
+    void EncodeColumn(const CSVRowRange& rows, size_t column, std::string& segment)
+    {
+        const size_t rowCount = rows.size();
+        BinaryWriter writer(segment);
+
+        // 整数・実数として往復できるか判定する（空セルは欠損として許容）
+        bool allInt = true;
+        bool allDouble = true;
+        for (size_t r = 0; r < rowCount && (allInt || allDouble); ++r)
+        {
+            std::string_view cell = rows[r][column];
+            if (cell.empty())
+            {
+                continue;
+            }
+            int64_t intValue = 0;
+            double doubleValue = 0.0;
+            allInt = allInt && ParseCanonicalInt(cell, intValue);
+            allDouble = allDouble && ParseCanonicalDouble(cell, doubleValue);
+        }
+
+        if (allInt || allDouble)
+        {
+            writer.Write(static_cast<uint8_t>(allInt ? SegmentType::Int64 : SegmentType::Float64));
+
+            // 欠損ビットマップ（1 = 値あり）
+            std::string validity((rowCount + 7) / 8, '\0');
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                if (!rows[r][column].empty())
+                {
+                    validity[r / 8] |= static_cast<char>(1 << (r % 8));
+                }
+            }
+            writer.WriteBytes(validity.data(), validity.size());
+
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                std::string_view cell = rows[r][column];
+                if (allInt)
+                {
+                    int64_t value = 0;
+                    if (!cell.empty()) ParseCanonicalInt(cell, value);
+                    writer.Write(value);
+                }
+                else
+                {
+                    double value = 0.0;
+                    if (!cell.empty()) ParseCanonicalDouble(cell, value);
+                    writer.Write(value);
+                }
+            }
+            return;
+        }
+
+        // 異なり値が行数の1/4以下なら辞書符号化する
+        const size_t maxDictionarySize = std::max<size_t>(1, rowCount / 4);
+        std::unordered_map<std::string_view, uint32_t> dictionary;
+        std::vector<std::string_view> entries;
+        std::vector<uint32_t> codes(rowCount);
+        bool useDictionary = true;
+        for (size_t r = 0; r < rowCount; ++r)
+        {
+            std::string_view cell = rows[r][column];
+            auto inserted = dictionary.emplace(cell, static_cast<uint32_t>(entries.size()));
+            if (inserted.second)
+            {
+                if (entries.size() >= maxDictionarySize)
+                {
+                    useDictionary = false;
+                    break;
+                }
+                entries.push_back(cell);
+            }
+            codes[r] = inserted.first->second;
+        }
+
+        if (useDictionary)
+        {
+            writer.Write(static_cast<uint8_t>(SegmentType::Dictionary));
+            writer.Write(static_cast<uint32_t>(entries.size()));
+            for (std::string_view entry : entries)
+            {
+                writer.WriteString(entry);
+            }
+            writer.WriteBytes(codes.data(), codes.size() * sizeof(uint32_t));
+            return;
+        }
+
+        // 文字列セグメント: 終端オフセット配列 + 連結バイト列
+        writer.Write(static_cast<uint8_t>(SegmentType::String));
+        uint64_t offset = 0;
+        for (size_t r = 0; r < rowCount; ++r)
+        {
+            offset += rows[r][column].size();
+            writer.Write(offset);
+        }
+        for (size_t r = 0; r < rowCount; ++r)
+        {
+            std::string_view cell = rows[r][column];
+            writer.WriteBytes(cell.data(), cell.size());
+        }
+    }
+
+    // 1列分のセグメントを列専用のアリーナへ復元し、各行の該当セルの参照を書き込む
+    bool DecodeColumn(const char* segment, size_t segmentSize, size_t column, size_t columnCount,
+        CellArena& arena, std::vector<CellRef>& cells)
+    {
+        const size_t rowCount = columnCount > 0 ? cells.size() / columnCount : 0;
+        BinaryReader reader(segment, segmentSize);
+        CellInternPolicy policy;
+        uint8_t type = 0;
+        if (!reader.Read(type))
+        {
+            return false;
+        }
+
+        switch (static_cast<SegmentType>(type))
+        {
+        case SegmentType::Int64:
+        case SegmentType::Float64:
+        {
+            const char* validity = reader.Skip((rowCount + 7) / 8);
+            const char* values = reader.Skip(rowCount * 8);
+            if (!validity || !values)
+            {
+                return false;
+            }
+            char buffer[32];
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                if ((validity[r / 8] & (1 << (r % 8))) == 0)
+                {
+                    continue;
+                }
+                std::to_chars_result formatted;
+                if (static_cast<SegmentType>(type) == SegmentType::Int64)
+                {
+                    int64_t value;
+                    std::memcpy(&value, values + r * 8, 8);
+                    formatted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                }
+                else
+                {
+                    double value;
+                    std::memcpy(&value, values + r * 8, 8);
+                    formatted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+                }
+                cells[r * columnCount + column] = policy.Store(arena, std::string_view(buffer, formatted.ptr - buffer));
+            }
+            return true;
+        }
+        case SegmentType::Dictionary:
+        {
+            uint32_t entryCount = 0;
+            if (!reader.Read(entryCount))
+            {
+                return false;
+            }
+            // 辞書の値は 1 度だけアリーナに置き、各セルは同じ参照を共有する
+            std::vector<CellRef> entries(entryCount);
+            for (auto& entry : entries)
+            {
+                uint32_t length = 0;
+                const char* bytes = nullptr;
+                if (!reader.Read(length) || !(bytes = reader.Skip(length)))
+                {
+                    return false;
+                }
+                entry = arena.Append(std::string_view(bytes, length));
+            }
+            const char* codes = reader.Skip(rowCount * sizeof(uint32_t));
+            if (!codes)
+            {
+                return false;
+            }
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                uint32_t code;
+                std::memcpy(&code, codes + r * sizeof(uint32_t), sizeof(uint32_t));
+                if (code >= entryCount)
+                {
+                    return false;
+                }
+                cells[r * columnCount + column] = entries[code];
+            }
+            return true;
+        }
+        case SegmentType::String:
+        {
+            const char* offsets = reader.Skip(rowCount * sizeof(uint64_t));
+            if (!offsets)
+            {
+                return false;
+            }
+            uint64_t totalBytes = 0;
+            if (rowCount > 0)
+            {
+                std::memcpy(&totalBytes, offsets + (rowCount - 1) * sizeof(uint64_t), sizeof(uint64_t));
+            }
+            const char* bytes = reader.Skip(static_cast<size_t>(totalBytes));
+            if (!bytes)
+            {
+                return false;
+            }
+            uint64_t begin = 0;
+            for (size_t r = 0; r < rowCount; ++r)
+            {
+                uint64_t end;
+                std::memcpy(&end, offsets + r * sizeof(uint64_t), sizeof(uint64_t));
+                if (end < begin || end > totalBytes)
+                {
+                    return false;
+                }
+                cells[r * columnCount + column] = policy.Store(arena, std::string_view(bytes + begin, static_cast<size_t>(end - begin)));
+                begin = end;
+            }
+            return true;
+        }
+        }
+        return false;
+    }
+}
+
+void WriteColumnStatistics(BinaryWriter& writer, const DataStatistics& stats)
+{
+    writer.Write(static_cast<uint64_t>(stats.totalRows));
+    writer.Write(static_cast<uint64_t>(stats.nullCount));
+    writer.Write(static_cast<uint64_t>(stats.numericCount));
+    writer.Write(static_cast<uint8_t>(stats.isNumeric ? 1 : 0));
+    writer.WriteString(stats.minValue);
+    writer.WriteString(stats.maxValue);
+    writer.Write(stats.numericMin);
+    writer.Write(stats.numericMax);
+    writer.Write(stats.average);
+    writer.Write(stats.standardDeviation);
+    writer.Write(static_cast<uint64_t>(stats.distinctEstimate));
+    writer.Write(static_cast<uint32_t>(stats.histogram.size()));
+    for (size_t count : stats.histogram)
+    {
+        writer.Write(static_cast<uint64_t>(count));
+    }
+}
+
+bool ReadColumnStatistics(BinaryReader& reader, DataStatistics& stats)
+{
+    uint64_t totalRows = 0, nullCount = 0, numericCount = 0, distinct = 0;
+    uint8_t isNumeric = 0;
+    uint32_t bins = 0;
+    if (!reader.Read(totalRows) || !reader.Read(nullCount) || !reader.Read(numericCount) || !reader.Read(isNumeric)
+        || !reader.ReadString(stats.minValue) || !reader.ReadString(stats.maxValue)
+        || !reader.Read(stats.numericMin) || !reader.Read(stats.numericMax)
+        || !reader.Read(stats.average) || !reader.Read(stats.standardDeviation)
+        || !reader.Read(distinct) || !reader.Read(bins) || bins > reader.GetRemaining() / sizeof(uint64_t))
+    {
+        return false;
+    }
+    stats.totalRows = static_cast<size_t>(totalRows);
+    stats.nullCount = static_cast<size_t>(nullCount);
+    stats.numericCount = static_cast<size_t>(numericCount);
+    stats.isNumeric = isNumeric != 0;
+    stats.distinctEstimate = static_cast<size_t>(distinct);
+    stats.histogram.resize(bins);
+    for (uint32_t i = 0; i < bins; ++i)
+    {
+        uint64_t count = 0;
+        if (!reader.Read(count))
+        {
+            return false;
+        }
+        stats.histogram[i] = static_cast<size_t>(count);
+    }
+    return true;
+}
+
+void WriteColumnZones(BinaryWriter& writer, const std::vector<ColumnZone>* zones)
+{
+    writer.Write(static_cast<uint32_t>(zones ? zones->size() : 0));
+    if (!zones)
+    {
+        return;
+    }
+    for (const ColumnZone& zone : *zones)
+    {
+        writer.Write(zone.rowCount);
+        writer.Write(zone.nullCount);
+        writer.Write(zone.numericCount);
+        writer.Write(zone.numericMin);
+        writer.Write(zone.numericMax);
+        writer.WriteString(zone.textMin);
+        writer.WriteString(zone.textMax);
+    }
+}
+
+bool ReadColumnZones(BinaryReader& reader, std::vector<ColumnZone>& zones)
+{
+    uint32_t count = 0;
+    if (!reader.Read(count) || count > reader.GetRemaining() / (3 * sizeof(uint32_t) + 2 * sizeof(double) + 2 * sizeof(uint32_t)))
+    {
+        return false;
+    }
+    zones.resize(count);
+    for (ColumnZone& zone : zones)
+    {
+        if (!reader.Read(zone.rowCount) || !reader.Read(zone.nullCount) || !reader.Read(zone.numericCount)
+            || !reader.Read(zone.numericMin) || !reader.Read(zone.numericMax)
+            || !reader.ReadString(zone.textMin) || !reader.ReadString(zone.textMax))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string GetColumnarCachePath(const std::string& csvPath)
+{
+    return csvPath + ".nscache";
+}
+
+bool ComputeSourceFingerprint(const std::string& csvPath, SourceFingerprint& fingerprint)
+{
+    std::error_code error;
+    std::filesystem::path path(csvPath);
+    uint64_t size = std::filesystem::file_size(path, error);
+    if (error)
+    {
+        return false;
+    }
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error)
+    {
+        return false;
+    }
+
+    std::ifstream file(csvPath, std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    // 先頭と末尾のブロックのみをハッシュし、巨大なファイルでも一定時間で検証する
+    std::string block(static_cast<size_t>(std::min<uint64_t>(size, fingerprintBlockSize)), '\0');
+    uint64_t hash = 0xCBF29CE484222325ull;
+    file.read(&block[0], block.size());
+    hash = HashBytes(block.data(), static_cast<size_t>(file.gcount()), hash);
+    if (size > fingerprintBlockSize)
+    {
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(size - block.size()));
+        file.read(&block[0], block.size());
+        hash = HashBytes(block.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+
+    fingerprint.size = size;
+    fingerprint.modifiedTime = static_cast<int64_t>(modified.time_since_epoch().count());
+    fingerprint.contentHash = hash;
+    return true;
+}
+
+CacheLoadResult LoadColumnarCache(const std::string& csvPath, const SourceFingerprint& fingerprint, CSVData& data)
+{
+    MappedFile file;
+    if (!file.Open(GetColumnarCachePath(csvPath)))
+    {
+        return CacheLoadResult::Missing;
+    }
+
+    BinaryReader reader(file.GetData(), file.GetSize());
+    const char* magic = reader.Skip(sizeof(cacheMagic));
+    uint32_t formatVersion = 0;
+    SourceFingerprint stored;
+    if (!magic || std::memcmp(magic, cacheMagic, sizeof(cacheMagic)) != 0 || !reader.Read(formatVersion)
+        || formatVersion != cacheFormatVersion
+        || !reader.Read(stored.size) || !reader.Read(stored.modifiedTime) || !reader.Read(stored.contentHash))
+    {
+        return CacheLoadResult::Invalid;
+    }
+    if (!(stored == fingerprint))
+    {
+        return CacheLoadResult::Stale;
+    }
+
+    // width は見出しの数以上（見出しより長い行があればその長さ）
+    uint64_t rowCount = 0;
+    uint32_t columnCount = 0;
+    uint64_t zoneBlockRows = 0;
+    uint32_t width = 0;
+    uint8_t hasRowCellCounts = 0;
+    if (!reader.Read(rowCount) || !reader.Read(columnCount) || !reader.Read(zoneBlockRows) || !reader.Read(width)
+        || !reader.Read(hasRowCellCounts) || width < columnCount || (width > 0 && rowCount > reader.GetRemaining() / width))
+    {
+        return CacheLoadResult::Invalid;
+    }
+
+    std::vector<std::string> headers(columnCount);
+    std::vector<DataStatistics> statistics(columnCount);
+    ZoneMap zoneMap;
+    zoneMap.blockRows = static_cast<size_t>(zoneBlockRows);
+    zoneMap.rowCount = static_cast<size_t>(rowCount);
+    zoneMap.columns.resize(columnCount);
+    std::vector<const char*> segments(width);
+    std::vector<size_t> segmentSizes(width);
+    for (uint32_t c = 0; c < width; ++c)
+    {
+        // 見出しより後ろの列はセルだけを持つ
+        uint64_t segmentSize = 0;
+        if (c < columnCount
+            && (!reader.ReadString(headers[c]) || !ReadColumnStatistics(reader, statistics[c])
+                || !ReadColumnZones(reader, zoneMap.columns[c]) || zoneMap.columns[c].size() != zoneMap.GetBlockCount()))
+        {
+            return CacheLoadResult::Invalid;
+        }
+        if (!reader.Read(segmentSize) || segmentSize > reader.GetRemaining())
+        {
+            return CacheLoadResult::Invalid;
+        }
+        segments[c] = reader.Skip(static_cast<size_t>(segmentSize));
+        segmentSizes[c] = static_cast<size_t>(segmentSize);
+        if (!segments[c])
+        {
+            return CacheLoadResult::Invalid;
+        }
+    }
+
+    std::vector<uint32_t> rowCellCounts;
+    if (hasRowCellCounts)
+    {
+        const char* counts = reader.Skip(static_cast<size_t>(rowCount) * sizeof(uint32_t));
+        if (!counts)
+        {
+            return CacheLoadResult::Invalid;
+        }
+        rowCellCounts.resize(static_cast<size_t>(rowCount));
+        std::memcpy(rowCellCounts.data(), counts, rowCellCounts.size() * sizeof(uint32_t));
+        if (std::any_of(rowCellCounts.begin(), rowCellCounts.end(), [width](uint32_t count) { return count > width; }))
+        {
+            return CacheLoadResult::Invalid;
+        }
+    }
+
+    // 字句解析を行わず、列ごとに専用のアリーナを持たせて並列で復元する
+    std::vector<CellRef> cells(static_cast<size_t>(rowCount) * width);
+    std::vector<CellArena> arenas(width);
+    std::vector<char> decoded(width, 0);
+    ParallelFor(width, [&](size_t c) {
+        decoded[c] = DecodeColumn(segments[c], segmentSizes[c], c, width, arenas[c], cells) ? 1 : 0;
+    });
+    if (std::find(decoded.begin(), decoded.end(), 0) != decoded.end())
+    {
+        return CacheLoadResult::Invalid;
+    }
+
+    // 列ごとのアリーナを 1 つにまとめ、各列の参照を引き取り後の位置にずらす
+    CellArena arena;
+    std::vector<uint64_t> deltas(width);
+    for (uint32_t c = 0; c < width; ++c)
+    {
+        deltas[c] = arena.Absorb(std::move(arenas[c]));
+    }
+    const size_t rebaseBlockRows = 65536;
+    ParallelFor((static_cast<size_t>(rowCount) + rebaseBlockRows - 1) / rebaseBlockRows, [&](size_t block) {
+        size_t begin = block * rebaseBlockRows;
+        size_t end = std::min(static_cast<size_t>(rowCount), begin + rebaseBlockRows);
+        for (size_t r = begin; r < end; ++r)
+        {
+            CellRef* row = cells.data() + r * width;
+            for (uint32_t c = 0; c < width; ++c)
+            {
+                row[c] = row[c].Rebased(deltas[c]);
+            }
+        }
+    });
+
+    data.Clear();
+    data.SetHeaders(headers);
+    data.SetCells(std::move(arena), std::move(cells), width, rowCellCounts);
+    data.SetStatistics(std::move(statistics));
+    if (zoneBlockRows > 0)
+    {
+        data.SetZoneMap(std::move(zoneMap));
+    }
+    else
+    {
+        data.BuildZoneMap();
+    }
+    return CacheLoadResult::Loaded;
+}
+
+bool WriteColumnarCache(const std::string& csvPath, const SourceFingerprint& fingerprint, const CSVData& data)
+{
+    const auto& headers = data.GetHeaders();
+    const auto& rows = data.GetRows();
+
+    // 統計情報とゾーンマップは読み込み時に計算済みのものを使う（バックグラウンドスレッドから再計算させない）
+    const auto& statistics = data.GetStatistics();
+    auto zoneMap = data.GetZoneMap();
+
+    // 行ごとのセル数が見出しの数と異なる行があれば、最も長い行までの列と行ごとのセル数も書く
+    size_t width = headers.size();
+    bool ragged = false;
+    for (const CSVRow& row : rows)
+    {
+        width = std::max(width, row.size());
+        ragged = ragged || row.size() != headers.size();
+    }
+
+    std::vector<std::string> segments(width);
+    ParallelFor(width, [&](size_t c) { EncodeColumn(rows, c, segments[c]); });
+
+    std::string header;
+    BinaryWriter writer(header);
+    writer.WriteBytes(cacheMagic, sizeof(cacheMagic));
+    writer.Write(cacheFormatVersion);
+    writer.Write(fingerprint.size);
+    writer.Write(fingerprint.modifiedTime);
+    writer.Write(fingerprint.contentHash);
+    writer.Write(static_cast<uint64_t>(rows.size()));
+    writer.Write(static_cast<uint32_t>(headers.size()));
+    writer.Write(static_cast<uint64_t>(zoneMap ? zoneMap->blockRows : 0));
+    writer.Write(static_cast<uint32_t>(width));
+    writer.Write(static_cast<uint8_t>(ragged ? 1 : 0));
+
+    std::string cachePath = GetColumnarCachePath(csvPath);
+    std::string temporaryPath = cachePath + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            return false;
+        }
+        file.write(header.data(), header.size());
+
+        for (size_t c = 0; c < width; ++c)
+        {
+            std::string columnHeader;
+            BinaryWriter columnWriter(columnHeader);
+            if (c < headers.size())
+            {
+                columnWriter.WriteString(headers[c]);
+                WriteColumnStatistics(columnWriter, statistics[c]);
+                WriteColumnZones(columnWriter, zoneMap && c < zoneMap->columns.size() ? &zoneMap->columns[c] : nullptr);
+            }
+            columnWriter.Write(static_cast<uint64_t>(segments[c].size()));
+            file.write(columnHeader.data(), columnHeader.size());
+            file.write(segments[c].data(), segments[c].size());
+            std::string().swap(segments[c]);
+        }
+
+        if (ragged)
+        {
+            std::vector<uint32_t> counts;
+            counts.reserve(rows.size());
+            for (const CSVRow& row : rows)
+            {
+                counts.push_back(static_cast<uint32_t>(row.size()));
+            }
+            file.write(reinterpret_cast<const char*>(counts.data()), counts.size() * sizeof(uint32_t));
+        }
+
+        if (!file.good())
+        {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(temporaryPath, error);
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, cachePath, error);
+    if (error)
+    {
+        std::filesystem::remove(temporaryPath, error);
+        return false;
+    }
+    return true;
+}
+
+std::future<bool> WriteColumnarCacheAsync(const std::string& csvPath, const SourceFingerprint& fingerprint,
+    std::shared_ptr<const CSVData> data)
+{
+    return std::async(std::launch::async, [csvPath, fingerprint, data]() {
+        return WriteColumnarCache(csvPath, fingerprint, *data);
+    });
+}
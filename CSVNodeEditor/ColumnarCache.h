@@ -0,0 +1,56 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+class BinaryWriter;
+class BinaryReader;
+struct ColumnZone;
+
+// 元CSVファイルの識別情報（サイズ・更新時刻・先頭と末尾のハッシュ）
+struct SourceFingerprint
+{
+    uint64_t size = 0;
+    int64_t modifiedTime = 0;
+    uint64_t contentHash = 0;
+
+    bool operator==(const SourceFingerprint& other) const
+    {
+        return size == other.size && modifiedTime == other.modifiedTime && contentHash == other.contentHash;
+    }
+};
+
+// キャッシュ読み込み結果
+enum class CacheLoadResult
+{
+    Loaded,  // キャッシュから復元した
+    Missing, // キャッシュが存在しない
+    Stale,   // 元ファイルが変更されている
+    Invalid  // 形式が不正、または壊れている
+};
+
+// CSVファイルに対応するキャッシュファイルのパス（"<csv>.nscache"）
+std::string GetColumnarCachePath(const std::string& csvPath);
+
+bool ComputeSourceFingerprint(const std::string& csvPath, SourceFingerprint& fingerprint);
+
+// 列指向バイナリキャッシュをメモリマップして復元する
+// 各列は型付きセグメント（整数・実数・辞書・文字列）として格納され、列統計と行数も含む。
+CacheLoadResult LoadColumnarCache(const std::string& csvPath, const SourceFingerprint& fingerprint, CSVData& data);
+
+// キャッシュを書き出す（一時ファイルに書いてから置き換える）
+bool WriteColumnarCache(const std::string& csvPath, const SourceFingerprint& fingerprint, const CSVData& data);
+
+// キャッシュの書き出しをバックグラウンドで行う
+std::future<bool> WriteColumnarCacheAsync(const std::string& csvPath, const SourceFingerprint& fingerprint,
+    std::shared_ptr<const CSVData> data);
+
+// 列統計・列のゾーン（ブロック単位の要約）の直列化（キャッシュとワークスペースのスナップショットで共用する）
+void WriteColumnStatistics(BinaryWriter& writer, const DataStatistics& stats);
+bool ReadColumnStatistics(BinaryReader& reader, DataStatistics& stats);
+void WriteColumnZones(BinaryWriter& writer, const std::vector<ColumnZone>* zones);
+bool ReadColumnZones(BinaryReader& reader, std::vector<ColumnZone>& zones);
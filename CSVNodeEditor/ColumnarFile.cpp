@@ -0,0 +1,851 @@
+﻿#include "ColumnarFile.h"
+#include "BinaryIO.h"
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <unordered_map>
+
+namespace
+{
+    const char fileMagic[8] = { 'N', 'S', 'C', 'O', 'L', '0', '0', '1' };
+
+    enum class ChunkKind : uint8_t
+    {
+        Int64 = 0,
+        Float64 = 1,
+        Text = 2
+    };
+
+    enum class ChunkEncoding : uint8_t
+    {
+        Plain = 0,              // Float64: 値の配列 / Text: 長さ配列 + 連結バイト列
+        FrameOfReference = 1,   // Int64: 基準値 + ビットパックした差分
+        RunLength = 2,          // Int64 / Float64: (値, 連続数) の列
+        Dictionary = 3,         // Text: 辞書 + ビットパックした辞書番号
+        DictionaryRunLength = 4 // Text: 辞書 + (辞書番号, 連続数) の列
+    };
+
+    // 圧縮コーデック（現状は無圧縮のみ。形式上の予約）
+    const uint8_t codecNone = 0;
+
+    // 列チャンクのメタデータ（フッターに格納）
+    struct ChunkMeta
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        ChunkKind kind = ChunkKind::Text;
+        ChunkEncoding encoding = ChunkEncoding::Plain;
+        uint8_t codec = codecNone;
+        uint32_t nullCount = 0;
+        bool hasStats = false;
+        double numericMin = 0.0;
+        double numericMax = 0.0;
+        std::string textMin;
+        std::string textMax;
+    };
+
+    struct EncodedChunk
+    {
+        ChunkMeta meta;
+        std::string payload;
+    };
+
+    struct RowGroupMeta
+    {
+        uint64_t rowCount = 0;
+        std::vector<ChunkMeta> chunks;
+    };
+
+    uint8_t BitWidth(uint64_t maxValue)
+    {
+        uint8_t width = 0;
+        while (maxValue != 0)
+        {
+            ++width;
+            maxValue >>= 1;
+        }
+        return width;
+    }
+
+    size_t PackedWordCount(size_t count, uint8_t bitWidth)
+    {
+        return (count * bitWidth + 63) / 64;
+    }
+
+    // 下位ビットから順に bitWidth ビットずつ詰める
+    void PackBits(const std::vector<uint64_t>& values, uint8_t bitWidth, BinaryWriter& writer)
+    {
+        std::vector<uint64_t> words(PackedWordCount(values.size(), bitWidth), 0);
+        for (size_t i = 0; i < values.size() && bitWidth > 0; ++i)
+        {
+            size_t bit = i * bitWidth;
+            size_t word = bit / 64;
+            size_t shift = bit % 64;
+            words[word] |= values[i] << shift;
+            if (shift + bitWidth > 64)
+            {
+                words[word + 1] |= values[i] >> (64 - shift);
+            }
+        }
+        writer.WriteBytes(words.data(), words.size() * sizeof(uint64_t));
+    }
+
+    bool UnpackBits(BinaryReader& reader, size_t count, uint8_t bitWidth, std::vector<uint64_t>& values)
+    {
+        if (bitWidth > 64)
+        {
+            return false;
+        }
+        size_t wordCount = PackedWordCount(count, bitWidth);
+        const char* bytes = reader.Skip(wordCount * sizeof(uint64_t));
+        if (!bytes)
+        {
+            return false;
+        }
+        std::vector<uint64_t> words(wordCount);
+        if (wordCount > 0)
+        {
+            std::memcpy(words.data(), bytes, wordCount * sizeof(uint64_t));
+        }
+
+        const uint64_t mask = bitWidth == 64 ? ~uint64_t(0) : ((uint64_t(1) << bitWidth) - 1);
+        values.assign(count, 0);
+        for (size_t i = 0; i < count && bitWidth > 0; ++i)
+        {
+            size_t bit = i * bitWidth;
+            size_t word = bit / 64;
+            size_t shift = bit % 64;
+            uint64_t value = words[word] >> shift;
+            if (shift + bitWidth > 64)
+            {
+                value |= words[word + 1] << (64 - shift);
+            }
+            values[i] = value & mask;
+        }
+        return true;
+    }
+
+    template <typename T>
+    size_t CountRuns(const std::vector<T>& values)
+    {
+        size_t runs = values.empty() ? 0 : 1;
+        for (size_t i = 1; i < values.size(); ++i)
+        {
+            if (!(values[i] == values[i - 1]))
+            {
+                ++runs;
+            }
+        }
+        return runs;
+    }
+
+    template <typename T>
+    void WriteRuns(const std::vector<T>& values, BinaryWriter& writer)
+    {
+        writer.Write(static_cast<uint32_t>(CountRuns(values)));
+        size_t i = 0;
+        while (i < values.size())
+        {
+            size_t j = i + 1;
+            while (j < values.size() && values[j] == values[i])
+            {
+                ++j;
+            }
+            writer.Write(values[i]);
+            writer.Write(static_cast<uint32_t>(j - i));
+            i = j;
+        }
+    }
+
+    template <typename T>
+    bool ReadRuns(BinaryReader& reader, size_t count, std::vector<T>& values)
+    {
+        uint32_t runs = 0;
+        if (!reader.Read(runs))
+        {
+            return false;
+        }
+        values.clear();
+        values.reserve(count);
+        for (uint32_t r = 0; r < runs; ++r)
+        {
+            T value;
+            uint32_t length = 0;
+            if (!reader.Read(value) || !reader.Read(length) || length > count - values.size())
+            {
+                return false;
+            }
+            values.insert(values.end(), length, value);
+        }
+        return values.size() == count;
+    }
+
+    // 1つの行グループ内の1列を符号化する
+    EncodedChunk EncodeChunk(const CSVRowRange& rows, size_t begin, size_t end, size_t column)
+    {
+        EncodedChunk chunk;
+        ChunkMeta& meta = chunk.meta;
+        BinaryWriter writer(chunk.payload);
+        const size_t count = end - begin;
+
+        // 欠損ビットマップと数値判定
+        std::string validity((count + 7) / 8, '\0');
+        bool allInt = true;
+        bool allDouble = true;
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string_view cell = rows[begin + i][column];
+            if (cell.empty())
+            {
+                ++meta.nullCount;
+                continue;
+            }
+            validity[i / 8] |= static_cast<char>(1 << (i % 8));
+            int64_t intValue = 0;
+            double doubleValue = 0.0;
+            allInt = allInt && ParseCanonicalInt(cell, intValue);
+            allDouble = allDouble && ParseCanonicalDouble(cell, doubleValue);
+        }
+        if (meta.nullCount > 0)
+        {
+            writer.WriteBytes(validity.data(), validity.size());
+        }
+        meta.hasStats = meta.nullCount < count;
+
+        if (allInt)
+        {
+            meta.kind = ChunkKind::Int64;
+            std::vector<int64_t> values;
+            values.reserve(count - meta.nullCount);
+            for (size_t i = 0; i < count; ++i)
+            {
+                std::string_view cell = rows[begin + i][column];
+                int64_t value = 0;
+                if (!cell.empty() && ParseCanonicalInt(cell, value))
+                {
+                    values.push_back(value);
+                }
+            }
+            if (values.empty())
+            {
+                meta.encoding = ChunkEncoding::FrameOfReference;
+                writer.Write(int64_t(0));
+                writer.Write(uint8_t(0));
+                return chunk;
+            }
+
+            auto range = std::minmax_element(values.begin(), values.end());
+            int64_t base = *range.first;
+            meta.numericMin = static_cast<double>(*range.first);
+            meta.numericMax = static_cast<double>(*range.second);
+
+            uint8_t bitWidth = BitWidth(static_cast<uint64_t>(*range.second) - static_cast<uint64_t>(base));
+            size_t forSize = PackedWordCount(values.size(), bitWidth) * sizeof(uint64_t);
+            size_t rleSize = CountRuns(values) * (sizeof(int64_t) + sizeof(uint32_t));
+            if (rleSize < forSize)
+            {
+                meta.encoding = ChunkEncoding::RunLength;
+                WriteRuns(values, writer);
+            }
+            else
+            {
+                meta.encoding = ChunkEncoding::FrameOfReference;
+                std::vector<uint64_t> deltas(values.size());
+                for (size_t i = 0; i < values.size(); ++i)
+                {
+                    deltas[i] = static_cast<uint64_t>(values[i]) - static_cast<uint64_t>(base);
+                }
+                writer.Write(base);
+                writer.Write(bitWidth);
+                PackBits(deltas, bitWidth, writer);
+            }
+            return chunk;
+        }
+
+        if (allDouble)
+        {
+            meta.kind = ChunkKind::Float64;
+            std::vector<double> values;
+            values.reserve(count - meta.nullCount);
+            for (size_t i = 0; i < count; ++i)
+            {
+                std::string_view cell = rows[begin + i][column];
+                double value = 0.0;
+                if (!cell.empty() && ParseCanonicalDouble(cell, value))
+                {
+                    values.push_back(value);
+                }
+            }
+            if (!values.empty())
+            {
+                auto range = std::minmax_element(values.begin(), values.end());
+                meta.numericMin = *range.first;
+                meta.numericMax = *range.second;
+            }
+
+            if (CountRuns(values) * (sizeof(double) + sizeof(uint32_t)) < values.size() * sizeof(double))
+            {
+                meta.encoding = ChunkEncoding::RunLength;
+                WriteRuns(values, writer);
+            }
+            else
+            {
+                meta.encoding = ChunkEncoding::Plain;
+                writer.WriteBytes(values.data(), values.size() * sizeof(double));
+            }
+            return chunk;
+        }
+
+        // 文字列: 異なり値が非欠損セル数の半分以下なら辞書符号化する
+        meta.kind = ChunkKind::Text;
+        const size_t nonNull = count - meta.nullCount;
+        const size_t maxDictionarySize = std::max<size_t>(1, nonNull / 2);
+        std::unordered_map<std::string_view, uint32_t> dictionary;
+        std::vector<std::string_view> entries;
+        std::vector<uint32_t> codes;
+        codes.reserve(nonNull);
+        bool useDictionary = true;
+        for (size_t i = 0; i < count && useDictionary; ++i)
+        {
+            std::string_view cell = rows[begin + i][column];
+            if (cell.empty())
+            {
+                continue;
+            }
+            if (meta.textMin.empty() || cell < meta.textMin) meta.textMin = cell;
+            if (cell > meta.textMax) meta.textMax = cell;
+
+            auto inserted = dictionary.emplace(cell, static_cast<uint32_t>(entries.size()));
+            if (inserted.second)
+            {
+                if (entries.size() >= maxDictionarySize)
+                {
+                    useDictionary = false;
+                    break;
+                }
+                entries.push_back(cell);
+            }
+            codes.push_back(inserted.first->second);
+        }
+
+        if (useDictionary)
+        {
+            writer.Write(static_cast<uint32_t>(entries.size()));
+            for (std::string_view entry : entries)
+            {
+                writer.WriteString(entry);
+            }
+
+            uint8_t bitWidth = BitWidth(entries.empty() ? 0 : entries.size() - 1);
+            size_t packedSize = PackedWordCount(codes.size(), bitWidth) * sizeof(uint64_t);
+            if (CountRuns(codes) * (sizeof(uint32_t) * 2) < packedSize)
+            {
+                meta.encoding = ChunkEncoding::DictionaryRunLength;
+                WriteRuns(codes, writer);
+            }
+            else
+            {
+                meta.encoding = ChunkEncoding::Dictionary;
+                std::vector<uint64_t> packed(codes.begin(), codes.end());
+                writer.Write(bitWidth);
+                PackBits(packed, bitWidth, writer);
+            }
+            return chunk;
+        }
+
+        // 辞書に向かない列は長さ配列 + 連結バイト列で格納する
+        meta.encoding = ChunkEncoding::Plain;
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string_view cell = rows[begin + i][column];
+            if (!cell.empty())
+            {
+                if (meta.textMin.empty() || cell < meta.textMin) meta.textMin = cell;
+                if (cell > meta.textMax) meta.textMax = cell;
+                writer.Write(static_cast<uint32_t>(cell.size()));
+            }
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::string_view cell = rows[begin + i][column];
+            writer.WriteBytes(cell.data(), cell.size());
+        }
+        return chunk;
+    }
+
+    // 列チャンクを復号し、行グループ内の各行の該当セルの参照を書き込む
+    bool DecodeChunk(const char* data, const ChunkMeta& meta, size_t count, size_t column, size_t columnCount,
+        CellBlock& block)
+    {
+        BinaryReader reader(data, static_cast<size_t>(meta.size));
+        std::string formatted;
+        auto cellAt = [&](size_t row) -> CellRef& { return block.cells[row * columnCount + column]; };
+
+        // 値は非欠損セルにのみ格納されているため、欠損ビットマップから書き込み先の行を求める
+        std::vector<size_t> targets;
+        targets.reserve(count - meta.nullCount);
+        if (meta.nullCount > 0)
+        {
+            const char* validity = reader.Skip((count + 7) / 8);
+            if (!validity)
+            {
+                return false;
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (validity[i / 8] & (1 << (i % 8)))
+                {
+                    targets.push_back(i);
+                }
+            }
+        }
+        else
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                targets.push_back(i);
+            }
+        }
+        const size_t valueCount = targets.size();
+
+        switch (meta.kind)
+        {
+        case ChunkKind::Int64:
+        {
+            std::vector<int64_t> values;
+            if (meta.encoding == ChunkEncoding::RunLength)
+            {
+                if (!ReadRuns(reader, valueCount, values))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                int64_t base = 0;
+                uint8_t bitWidth = 0;
+                std::vector<uint64_t> deltas;
+                if (!reader.Read(base) || !reader.Read(bitWidth) || !UnpackBits(reader, valueCount, bitWidth, deltas))
+                {
+                    return false;
+                }
+                values.resize(valueCount);
+                for (size_t i = 0; i < valueCount; ++i)
+                {
+                    values[i] = static_cast<int64_t>(static_cast<uint64_t>(base) + deltas[i]);
+                }
+            }
+            for (size_t i = 0; i < valueCount; ++i)
+            {
+                FormatCanonical(values[i], formatted);
+                cellAt(targets[i]) = block.Store(column, formatted);
+            }
+            return true;
+        }
+        case ChunkKind::Float64:
+        {
+            std::vector<double> values;
+            if (meta.encoding == ChunkEncoding::RunLength)
+            {
+                if (!ReadRuns(reader, valueCount, values))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                const char* bytes = reader.Skip(valueCount * sizeof(double));
+                if (!bytes)
+                {
+                    return false;
+                }
+                values.resize(valueCount);
+                if (valueCount > 0)
+                {
+                    std::memcpy(values.data(), bytes, valueCount * sizeof(double));
+                }
+            }
+            for (size_t i = 0; i < valueCount; ++i)
+            {
+                FormatCanonical(values[i], formatted);
+                cellAt(targets[i]) = block.Store(column, formatted);
+            }
+            return true;
+        }
+        case ChunkKind::Text:
+        {
+            if (meta.encoding == ChunkEncoding::Plain)
+            {
+                const char* lengths = reader.Skip(valueCount * sizeof(uint32_t));
+                if (!lengths)
+                {
+                    return false;
+                }
+                for (size_t i = 0; i < valueCount; ++i)
+                {
+                    uint32_t length;
+                    std::memcpy(&length, lengths + i * sizeof(uint32_t), sizeof(uint32_t));
+                    const char* bytes = reader.Skip(length);
+                    if (!bytes)
+                    {
+                        return false;
+                    }
+                    cellAt(targets[i]) = block.Store(column, std::string_view(bytes, length));
+                }
+                return true;
+            }
+
+            uint32_t entryCount = 0;
+            if (!reader.Read(entryCount))
+            {
+                return false;
+            }
+            // 辞書の値は 1 度だけアリーナに置き、各セルは同じ参照を共有する
+            std::vector<CellRef> entries(entryCount);
+            for (auto& entry : entries)
+            {
+                uint32_t length = 0;
+                const char* bytes = nullptr;
+                if (!reader.Read(length) || !(bytes = reader.Skip(length)))
+                {
+                    return false;
+                }
+                entry = block.arena.Append(std::string_view(bytes, length));
+            }
+
+            std::vector<uint64_t> codes;
+            if (meta.encoding == ChunkEncoding::DictionaryRunLength)
+            {
+                std::vector<uint32_t> runCodes;
+                if (!ReadRuns(reader, valueCount, runCodes))
+                {
+                    return false;
+                }
+                codes.assign(runCodes.begin(), runCodes.end());
+            }
+            else
+            {
+                uint8_t bitWidth = 0;
+                if (!reader.Read(bitWidth) || !UnpackBits(reader, valueCount, bitWidth, codes))
+                {
+                    return false;
+                }
+            }
+            for (size_t i = 0; i < valueCount; ++i)
+            {
+                if (codes[i] >= entryCount)
+                {
+                    return false;
+                }
+                cellAt(targets[i]) = entries[static_cast<size_t>(codes[i])];
+            }
+            return true;
+        }
+        }
+        return false;
+    }
+
+    void WriteChunkMeta(BinaryWriter& writer, const ChunkMeta& meta)
+    {
+        writer.Write(meta.offset);
+        writer.Write(meta.size);
+        writer.Write(static_cast<uint8_t>(meta.kind));
+        writer.Write(static_cast<uint8_t>(meta.encoding));
+        writer.Write(meta.codec);
+        writer.Write(meta.nullCount);
+        writer.Write(static_cast<uint8_t>(meta.hasStats ? 1 : 0));
+        if (meta.kind == ChunkKind::Text)
+        {
+            writer.WriteString(meta.textMin);
+            writer.WriteString(meta.textMax);
+        }
+        else
+        {
+            writer.Write(meta.numericMin);
+            writer.Write(meta.numericMax);
+        }
+    }
+
+    bool ReadChunkMeta(BinaryReader& reader, ChunkMeta& meta)
+    {
+        uint8_t kind = 0, encoding = 0, hasStats = 0;
+        if (!reader.Read(meta.offset) || !reader.Read(meta.size) || !reader.Read(kind) || !reader.Read(encoding)
+            || !reader.Read(meta.codec) || !reader.Read(meta.nullCount) || !reader.Read(hasStats))
+        {
+            return false;
+        }
+        if (kind > static_cast<uint8_t>(ChunkKind::Text) || encoding > static_cast<uint8_t>(ChunkEncoding::DictionaryRunLength)
+            || meta.codec != codecNone)
+        {
+            return false;
+        }
+        meta.kind = static_cast<ChunkKind>(kind);
+        meta.encoding = static_cast<ChunkEncoding>(encoding);
+        meta.hasStats = hasStats != 0;
+        if (meta.kind == ChunkKind::Text)
+        {
+            return reader.ReadString(meta.textMin) && reader.ReadString(meta.textMax);
+        }
+        return reader.Read(meta.numericMin) && reader.Read(meta.numericMax);
+    }
+
+    // 行グループの統計から、すべての条件に一致し得るかを判定する
+    bool RowGroupMayMatch(const RowGroupMeta& group, const std::vector<CompiledPredicate>& predicates)
+    {
+        for (const auto& predicate : predicates)
+        {
+            const ChunkMeta& meta = group.chunks[predicate.columnIndex];
+            bool hasNulls = meta.nullCount > 0;
+            bool mayMatch = true;
+            if (!meta.hasStats)
+            {
+                mayMatch = predicate.Matches(std::string());
+            }
+            else if (meta.kind == ChunkKind::Text)
+            {
+                mayMatch = predicate.MayMatchTextRange(meta.textMin, meta.textMax, hasNulls);
+            }
+            else
+            {
+                mayMatch = predicate.MayMatchNumericRange(meta.numericMin, meta.numericMax, hasNulls);
+            }
+            if (!mayMatch)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool IsColumnarFilePath(const std::string& path)
+{
+    const std::string extension = ".nscol";
+    return path.size() >= extension.size()
+        && path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool WriteColumnarFile(const std::string& path, const CSVData& data, const ColumnarWriteOptions& options)
+{
+    const auto& headers = data.GetHeaders();
+    const auto& rows = data.GetRows();
+    const size_t rowGroupSize = std::max<size_t>(1, options.rowGroupSize);
+    const size_t rowGroupCount = (rows.size() + rowGroupSize - 1) / rowGroupSize;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write(fileMagic, sizeof(fileMagic));
+    uint64_t offset = sizeof(fileMagic);
+
+    // 行グループはワーカー数ずつまとめて並列に符号化し、順番に書き出す
+    const size_t batchSize = std::max<size_t>(1, std::thread::hardware_concurrency());
+    std::vector<RowGroupMeta> groups(rowGroupCount);
+    for (size_t batchBegin = 0; batchBegin < rowGroupCount; batchBegin += batchSize)
+    {
+        size_t batchEnd = std::min(rowGroupCount, batchBegin + batchSize);
+        std::vector<std::vector<EncodedChunk>> encoded(batchEnd - batchBegin);
+        ParallelFor(encoded.size(), [&](size_t i) {
+            size_t group = batchBegin + i;
+            size_t begin = group * rowGroupSize;
+            size_t end = std::min(rows.size(), begin + rowGroupSize);
+            encoded[i].reserve(headers.size());
+            for (size_t c = 0; c < headers.size(); ++c)
+            {
+                encoded[i].push_back(EncodeChunk(rows, begin, end, c));
+            }
+        });
+
+        for (size_t i = 0; i < encoded.size(); ++i)
+        {
+            size_t group = batchBegin + i;
+            groups[group].rowCount = std::min(rows.size(), (group + 1) * rowGroupSize) - group * rowGroupSize;
+            for (auto& chunk : encoded[i])
+            {
+                chunk.meta.offset = offset;
+                chunk.meta.size = chunk.payload.size();
+                file.write(chunk.payload.data(), chunk.payload.size());
+                offset += chunk.payload.size();
+                groups[group].chunks.push_back(std::move(chunk.meta));
+            }
+        }
+    }
+
+    // フッター: スキーマと行グループ・列チャンクのメタデータ
+    std::string footer;
+    BinaryWriter writer(footer);
+    writer.Write(static_cast<uint32_t>(headers.size()));
+    for (const auto& header : headers)
+    {
+        writer.WriteString(header);
+    }
+    writer.Write(static_cast<uint32_t>(groups.size()));
+    for (const auto& group : groups)
+    {
+        writer.Write(group.rowCount);
+        for (const auto& meta : group.chunks)
+        {
+            WriteChunkMeta(writer, meta);
+        }
+    }
+    writer.Write(static_cast<uint64_t>(footer.size()));
+    writer.WriteBytes(fileMagic, sizeof(fileMagic));
+    file.write(footer.data(), footer.size());
+
+    return file.good();
+}
+
+bool ReadColumnarFile(const std::string& path, const std::vector<ScanPredicate>& predicates, CSVData& output,
+    ColumnarScanStats* scanStats)
+{
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return false;
+    }
+
+    const size_t trailerSize = sizeof(uint64_t) + sizeof(fileMagic);
+    if (file.GetSize() < sizeof(fileMagic) + trailerSize
+        || std::memcmp(file.GetData(), fileMagic, sizeof(fileMagic)) != 0
+        || std::memcmp(file.GetData() + file.GetSize() - sizeof(fileMagic), fileMagic, sizeof(fileMagic)) != 0)
+    {
+        return false;
+    }
+
+    uint64_t footerSize = 0;
+    std::memcpy(&footerSize, file.GetData() + file.GetSize() - trailerSize, sizeof(uint64_t));
+    if (footerSize > file.GetSize() - sizeof(fileMagic) - trailerSize)
+    {
+        return false;
+    }
+
+    BinaryReader reader(file.GetData() + file.GetSize() - trailerSize - footerSize, static_cast<size_t>(footerSize));
+    uint32_t columnCount = 0;
+    if (!reader.Read(columnCount))
+    {
+        return false;
+    }
+    std::vector<std::string> headers(columnCount);
+    for (auto& header : headers)
+    {
+        if (!reader.ReadString(header))
+        {
+            return false;
+        }
+    }
+
+    uint32_t groupCount = 0;
+    if (!reader.Read(groupCount))
+    {
+        return false;
+    }
+    std::vector<RowGroupMeta> groups(groupCount);
+    for (auto& group : groups)
+    {
+        if (!reader.Read(group.rowCount))
+        {
+            return false;
+        }
+        group.chunks.resize(columnCount);
+        for (auto& meta : group.chunks)
+        {
+            if (!ReadChunkMeta(reader, meta) || meta.offset + meta.size > file.GetSize())
+            {
+                return false;
+            }
+        }
+    }
+
+    std::vector<CompiledPredicate> compiled(predicates.size());
+    for (size_t i = 0; i < predicates.size(); ++i)
+    {
+        if (!CompilePredicate(predicates[i], headers, compiled[i]))
+        {
+            return false;
+        }
+    }
+
+    // 統計で除外できない行グループのみを復号対象にする
+    std::vector<size_t> selected;
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        if (RowGroupMayMatch(groups[g], compiled))
+        {
+            selected.push_back(g);
+        }
+    }
+
+    // 行グループごとにアリーナを持たせて並列に復号し、最後に連結する
+    std::vector<CellBlock> decodedGroups(selected.size());
+    std::vector<char> succeeded(selected.size(), 0);
+    ParallelFor(selected.size(), [&](size_t i) {
+        const RowGroupMeta& group = groups[selected[i]];
+        const size_t count = static_cast<size_t>(group.rowCount);
+        CellBlock& block = decodedGroups[i];
+        block.cells.assign(count * columnCount, CellRef());
+        for (size_t c = 0; c < columnCount; ++c)
+        {
+            const ChunkMeta& meta = group.chunks[c];
+            if (!DecodeChunk(file.GetData() + meta.offset, meta, count, c, columnCount, block))
+            {
+                return;
+            }
+        }
+
+        // 読み込んだ行にも条件を適用し、一致した行のセル参照を前に詰める
+        if (!compiled.empty())
+        {
+            size_t kept = 0;
+            for (size_t r = 0; r < count; ++r)
+            {
+                const CellRef* row = block.cells.data() + r * columnCount;
+                bool matches = true;
+                for (const auto& predicate : compiled)
+                {
+                    if (!predicate.Matches(block.arena.Get(row[predicate.columnIndex])))
+                    {
+                        matches = false;
+                        break;
+                    }
+                }
+                if (matches)
+                {
+                    if (kept != r)
+                    {
+                        std::copy(row, row + columnCount, block.cells.begin() + kept * columnCount);
+                    }
+                    ++kept;
+                }
+            }
+            block.cells.resize(kept * columnCount);
+        }
+
+        succeeded[i] = 1;
+    });
+    if (std::find(succeeded.begin(), succeeded.end(), 0) != succeeded.end())
+    {
+        return false;
+    }
+
+    if (scanStats)
+    {
+        scanStats->rowGroupCount = groups.size();
+        scanStats->skippedRowGroups = groups.size() - selected.size();
+        scanStats->rowsRead = 0;
+        for (size_t g : selected)
+        {
+            scanStats->rowsRead += static_cast<size_t>(groups[g].rowCount);
+        }
+    }
+
+    output.Clear();
+    output.SetHeaders(headers);
+    output.SetCellBlocks(std::move(decodedGroups), columnCount);
+    return true;
+}
@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include "Predicate.h"
+#include <string>
+#include <vector>
+
+// 列指向エクスポート形式（.nscol）の書き出し設定
+struct ColumnarWriteOptions
+{
+    size_t rowGroupSize = 65536;
+};
+
+// 読み込み時の行グループ読み飛ばし結果
+struct ColumnarScanStats
+{
+    size_t rowGroupCount = 0;
+    size_t skippedRowGroups = 0;
+    size_t rowsRead = 0;
+};
+
+// 行グループ単位の列指向ファイルを書き出す
+// 各列チャンクは辞書・ランレングス・ビットパック（FOR）から最も小さい符号化を選び、
+// フッターに行グループごとの最小値・最大値・欠損数を記録する。
+bool WriteColumnarFile(const std::string& path, const CSVData& data, const ColumnarWriteOptions& options = ColumnarWriteOptions());
+
+// 列指向ファイルを読み込む
+// フッターの統計から条件に一致し得ない行グループを復号せずに読み飛ばし、残りの行にも条件を適用する。
+bool ReadColumnarFile(const std::string& path, const std::vector<ScanPredicate>& predicates, CSVData& output,
+    ColumnarScanStats* scanStats = nullptr);
+
+// パスが列指向ファイルの拡張子を持つか
+bool IsColumnarFilePath(const std::string& path);
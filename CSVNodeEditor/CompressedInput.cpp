@@ -0,0 +1,432 @@
+﻿#include "CompressedInput.h"
+#include "GzipDecoder.h"
+#include "Parallel.h"
+#include "ZstdDecoder.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    // 解析側へ渡す伸長済みチャンクの目安サイズ
+    const size_t decompressedChunkSize = 4 * 1024 * 1024;
+
+    // 並列伸長で 1 回にまとめる圧縮データ量（ワーカー 1 つあたり）
+    const size_t compressedBytesPerWorker = 1024 * 1024;
+
+    // 先行して用意する伸長済みチャンクの数
+    const size_t readyChunkLimit = 2;
+
+    template <typename Decoder>
+    bool DecodeWhole(const char* data, size_t size, std::string& output)
+    {
+        Decoder decoder(data, size);
+        while (decoder.Decode(output, decompressedChunkSize))
+        {
+        }
+        return !decoder.HasError();
+    }
+}
+
+CompressionFormat DetectCompressionFormat(const char* data, size_t size)
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    if (size >= 2 && bytes[0] == 0x1F && bytes[1] == 0x8B)
+    {
+        return CompressionFormat::Gzip;
+    }
+    if (size >= 4 && bytes[0] == 0x28 && bytes[1] == 0xB5 && bytes[2] == 0x2F && bytes[3] == 0xFD)
+    {
+        return CompressionFormat::Zstd;
+    }
+    return CompressionFormat::None;
+}
+
+DecompressingInput::DecompressingInput()
+    : format(CompressionFormat::None)
+    , finished(false)
+    , failed(false)
+    , stopping(false)
+{
+}
+
+DecompressingInput::~DecompressingInput()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    if (worker.joinable())
+    {
+        worker.join();
+    }
+}
+
+bool DecompressingInput::Open(const std::string& filename)
+{
+    if (!file.Open(filename))
+    {
+        return false;
+    }
+    format = DetectCompressionFormat(file.GetData(), file.GetSize());
+    if (format == CompressionFormat::None)
+    {
+        file.Close();
+        return false;
+    }
+    worker = std::thread(&DecompressingInput::Run, this);
+    return true;
+}
+
+bool DecompressingInput::ReadChunk(std::string& chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return !ready.empty() || finished; });
+    if (ready.empty())
+    {
+        return false;
+    }
+    chunk = std::move(ready.front());
+    ready.pop_front();
+    condition.notify_all();
+    return true;
+}
+
+bool DecompressingInput::HasError() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+bool DecompressingInput::Push(std::string&& chunk)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return ready.size() < readyChunkLimit || stopping; });
+    if (stopping)
+    {
+        return false;
+    }
+    ready.push_back(std::move(chunk));
+    condition.notify_all();
+    return true;
+}
+
+void DecompressingInput::Run()
+{
+    // 独立した単位が複数あれば並列に、そうでなければ先頭から順に伸長する
+    std::vector<std::pair<size_t, size_t>> units;
+    bool found = format == CompressionFormat::Zstd
+        ? ZstdDecoder::FindFrames(file.GetData(), file.GetSize(), units)
+        : GzipDecoder::FindBgzfMembers(file.GetData(), file.GetSize(), units);
+    bool succeeded = (found && units.size() >= 2) ? DecodeIndependentUnits(units) : DecodeStream();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        failed = !succeeded && !stopping;
+        finished = true;
+    }
+    condition.notify_all();
+}
+
+bool DecompressingInput::DecodeIndependentUnits(const std::vector<std::pair<size_t, size_t>>& units)
+{
+    // 圧縮データ量がワーカー数分たまるまで単位をまとめ、まとめて並列に伸長する
+    const size_t workerCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    size_t begin = 0;
+    while (begin < units.size())
+    {
+        size_t end = begin;
+        size_t compressedBytes = 0;
+        while (end < units.size() && (end == begin || compressedBytes < workerCount * compressedBytesPerWorker))
+        {
+            compressedBytes += units[end].second;
+            ++end;
+        }
+
+        std::vector<std::string> outputs(end - begin);
+        std::vector<char> succeeded(end - begin, 0);
+        ParallelFor(outputs.size(), [&](size_t i) {
+            const auto& unit = units[begin + i];
+            const char* data = file.GetData() + unit.first;
+            succeeded[i] = (format == CompressionFormat::Zstd
+                ? DecodeWhole<ZstdDecoder>(data, unit.second, outputs[i])
+                : DecodeWhole<GzipDecoder>(data, unit.second, outputs[i])) ? 1 : 0;
+        });
+        if (std::find(succeeded.begin(), succeeded.end(), 0) != succeeded.end())
+        {
+            return false;
+        }
+
+        std::string chunk;
+        for (auto& output : outputs)
+        {
+            if (chunk.empty())
+            {
+                chunk = std::move(output);
+            }
+            else
+            {
+                chunk.append(output);
+            }
+            if (chunk.size() >= decompressedChunkSize)
+            {
+                if (!Push(std::move(chunk)))
+                {
+                    return true;
+                }
+                chunk.clear();
+            }
+        }
+        if (!chunk.empty() && !Push(std::move(chunk)))
+        {
+            return true;
+        }
+        begin = end;
+    }
+    return true;
+}
+
+bool DecompressingInput::DecodeStream()
+{
+    auto stream = [this](auto& decoder) {
+        std::string chunk;
+        while (decoder.Decode(chunk, decompressedChunkSize))
+        {
+            if (!Push(std::move(chunk)))
+            {
+                return true;
+            }
+            chunk.clear();
+        }
+        return !decoder.HasError();
+    };
+
+    if (format == CompressionFormat::Zstd)
+    {
+        ZstdDecoder decoder(file.GetData(), file.GetSize());
+        return stream(decoder);
+    }
+    GzipDecoder decoder(file.GetData(), file.GetSize());
+    return stream(decoder);
+}
+
+LineReader::LineReader()
+    : bufferPosition(0)
+    , encoding(TextEncoding::Utf8)
+    , encodingDetected(false)
+    , validatedEnd(0)
+    , validatedOk(true)
+    , scanPosition(0)
+    , scanState(RecordScan::FieldStart)
+{
+}
+
+bool LineReader::Open(const std::string& filename)
+{
+    auto input = std::make_unique<DecompressingInput>();
+    if (input->Open(filename))
+    {
+        decompressing = std::move(input);
+        return true;
+    }
+
+    // 行の切り出しがキャッシュ上で済むよう小さめのブロックを深く先読みする
+    AsyncIoOptions options;
+    options.blockSize = 256 << 10;
+    options.queueDepth = 8;
+    return file.Open(filename, options);
+}
+
+bool LineReader::ReadLine(std::string& line)
+{
+    return ReadDelimited(line, false);
+}
+
+bool LineReader::ReadRecord(std::string& record)
+{
+    return ReadDelimited(record, true);
+}
+
+bool LineReader::ReadDelimited(std::string& line, bool quoted)
+{
+    while (true)
+    {
+        const size_t newline = quoted ? FindRecordEnd() : buffer.find('\n', bufferPosition);
+        if (newline != std::string::npos)
+        {
+            // テキストモードのファイル入力と同様に CRLF の CR を取り除く
+            size_t end = newline;
+            if (end > bufferPosition && buffer[end - 1] == '\r')
+            {
+                --end;
+            }
+            AssignLine(line, bufferPosition, end, newline + 1);
+            bufferPosition = newline + 1;
+            scanPosition = bufferPosition;
+            scanState = RecordScan::FieldStart;
+            return true;
+        }
+
+        // 行がチャンクをまたぐ場合は残りを次のチャンクの先頭につなげる（走査済みの位置も合わせてずらす）
+        buffer.erase(0, bufferPosition);
+        scanPosition -= std::min(scanPosition, bufferPosition);
+        bufferPosition = 0;
+        validatedEnd = 0;
+        if (!AppendChunk())
+        {
+            scanPosition = 0;
+            scanState = RecordScan::FieldStart;
+            if (buffer.empty())
+            {
+                return false;
+            }
+            size_t end = buffer.size();
+            if (buffer[end - 1] == '\r')
+            {
+                --end;
+            }
+            AssignLine(line, 0, end, buffer.size());
+            buffer.clear();
+            return true;
+        }
+    }
+}
+
+size_t LineReader::FindRecordEnd()
+{
+    // 引用符を含まない行は改行を探すだけで済む
+    // （CP932 の 2 バイト目は 0x40 以上のため、'"'・','・改行と取り違えることはない）
+    if (scanPosition == bufferPosition && scanState == RecordScan::FieldStart)
+    {
+        const size_t newline = buffer.find('\n', bufferPosition);
+        if (newline != std::string::npos && std::memchr(buffer.data() + bufferPosition, '"', newline - bufferPosition) == nullptr)
+        {
+            return newline;
+        }
+    }
+
+    const char* data = buffer.data();
+    for (size_t i = std::max(scanPosition, bufferPosition); i < buffer.size(); ++i)
+    {
+        const char c = data[i];
+        switch (scanState)
+        {
+        case RecordScan::FieldStart:
+        case RecordScan::Unquoted:
+            if (c == '\n')
+            {
+                return i;
+            }
+            if (c == ',')
+            {
+                scanState = RecordScan::FieldStart;
+            }
+            else if (scanState == RecordScan::FieldStart && c == '"')
+            {
+                scanState = RecordScan::Quoted;
+            }
+            else if (scanState == RecordScan::FieldStart && c != ' ' && c != '\t')
+            {
+                scanState = RecordScan::Unquoted;
+            }
+            break;
+        case RecordScan::Quoted:
+        {
+            // 囲みの中は次の '"' まで読み飛ばす
+            const void* quote = std::memchr(data + i, '"', buffer.size() - i);
+            if (!quote)
+            {
+                i = buffer.size() - 1;
+                break;
+            }
+            i = static_cast<size_t>(static_cast<const char*>(quote) - data);
+            scanState = RecordScan::QuotedQuote;
+            break;
+        }
+        case RecordScan::QuotedQuote:
+            if (c == '\n')
+            {
+                return i;
+            }
+            scanState = c == '"' ? RecordScan::Quoted : c == ',' ? RecordScan::FieldStart : RecordScan::Unquoted;
+            break;
+        }
+    }
+    scanPosition = buffer.size();
+    return std::string::npos;
+}
+
+bool LineReader::HasError() const
+{
+    return decompressing ? decompressing->HasError() : file.HasError();
+}
+
+bool LineReader::AppendChunk()
+{
+    if (decompressing)
+    {
+        std::string chunk;
+        if (!decompressing->ReadChunk(chunk))
+        {
+            return false;
+        }
+        if (buffer.empty())
+        {
+            buffer.swap(chunk);
+        }
+        else
+        {
+            buffer.append(chunk);
+        }
+        return true;
+    }
+
+    const char* data = nullptr;
+    size_t size = 0;
+    if (!file.ReadBlock(data, size))
+    {
+        return false;
+    }
+    buffer.append(data, size);
+    return true;
+}
+
+void LineReader::AssignLine(std::string& line, size_t begin, size_t end, size_t next)
+{
+    // 最初の行を切り出す前に、先頭のチャンクから文字コードを推定して BOM を読み飛ばす
+    if (!encodingDetected)
+    {
+        encodingDetected = true;
+        size_t bomLength = 0;
+        encoding = DetectTextEncoding(buffer.data() + begin, buffer.size() - begin, bomLength);
+        begin = std::min(begin + bomLength, end);
+    }
+
+    const char* data = buffer.data() + begin;
+    const size_t size = end - begin;
+    if (encoding == TextEncoding::Cp932)
+    {
+        line.clear();
+        AppendCp932AsUtf8(line, data, size);
+        return;
+    }
+
+    // UTF-8 はバッファ内の最後の改行までを 1 回で検証し、不正な場合だけ行ごとに置き換える
+    if (next > validatedEnd)
+    {
+        size_t lastNewline = buffer.rfind('\n');
+        size_t checkEnd = (lastNewline == std::string::npos || lastNewline + 1 < next) ? next : lastNewline + 1;
+        validatedOk = IsValidUtf8(data, checkEnd - begin);
+        validatedEnd = checkEnd;
+    }
+    if (validatedOk)
+    {
+        line.assign(data, size);
+    }
+    else
+    {
+        line.clear();
+        AppendSanitizedUtf8(line, data, size);
+    }
+}
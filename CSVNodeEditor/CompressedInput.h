@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "AsyncFileIO.h"
+#include "MappedFile.h"
+#include "TextEncoding.h"
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class CompressionFormat
+{
+    None,
+    Gzip,
+    Zstd
+};
+
+// 先頭のマジックバイトから圧縮形式を判定する
+CompressionFormat DetectCompressionFormat(const char* data, size_t size);
+
+// 圧縮ファイルをバックグラウンドで伸長し、伸長済みのチャンクを順に渡す入力
+// 伸長済みチャンクは最大 2 つまで先行して用意し（ダブルバッファ）、伸長と解析を重ねる。
+// 独立に伸長できる単位（zstd の複数フレーム、BGZF のメンバー）があれば並列に伸長する。
+class DecompressingInput
+{
+public:
+    DecompressingInput();
+    ~DecompressingInput();
+
+    DecompressingInput(const DecompressingInput&) = delete;
+    DecompressingInput& operator=(const DecompressingInput&) = delete;
+
+    // 圧縮ファイルでない場合も false を返す
+    bool Open(const std::string& filename);
+
+    // 次の伸長済みチャンクを受け取る（終端または失敗なら false）
+    bool ReadChunk(std::string& chunk);
+    bool HasError() const;
+
+private:
+    MappedFile file;
+    CompressionFormat format;
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<std::string> ready;
+    bool finished;
+    bool failed;
+    bool stopping;
+
+    void Run();
+    bool DecodeIndependentUnits(const std::vector<std::pair<size_t, size_t>>& units);
+    bool DecodeStream();
+    bool Push(std::string&& chunk);
+};
+
+// 1 行ずつ読む入力
+// 通常のファイルは大きなブロックを先読みしながら、gzip / zstd は伸長しながら読む。
+// 先頭のチャンクで文字コードを推定し、行を切り出す際に UTF-8 へ変換する（CP932 の変換・UTF-8 の検証）。
+class LineReader
+{
+public:
+    LineReader();
+
+    bool Open(const std::string& filename);
+    bool ReadLine(std::string& line);
+
+    // CSV の 1 レコードを読む（CSVData::SplitCSVLine と同じ規則で、引用符で囲まれた改行はレコードの区切りにしない）
+    bool ReadRecord(std::string& record);
+
+    // 読み込みに失敗した場合や圧縮データが壊れていた場合に true
+    bool HasError() const;
+
+    // 推定した入力の文字コード（最初の ReadLine 以降に有効）
+    TextEncoding GetEncoding() const { return encoding; }
+
+private:
+    AsyncFileReader file;
+    std::unique_ptr<DecompressingInput> decompressing;
+    std::string buffer;
+    size_t bufferPosition;
+    TextEncoding encoding;
+    bool encodingDetected;
+
+    // buffer の [bufferPosition, validatedEnd) を UTF-8 として検証済みで、その結果が validatedOk
+    size_t validatedEnd;
+    bool validatedOk;
+
+    // 次のレコードの区切りを探した状態（buffer の [bufferPosition, scanPosition) を走査済みで、その終わりの状態が scanState）
+    enum class RecordScan
+    {
+        FieldStart,     // フィールドの先頭（空白だけを読んだ）
+        Unquoted,       // 囲まれていないフィールドの中
+        Quoted,         // 囲まれたフィールドの中
+        QuotedQuote     // 囲まれたフィールドの中で '"' を読んだ直後（"" か囲みの終わり）
+    };
+    size_t scanPosition;
+    RecordScan scanState;
+
+    bool ReadDelimited(std::string& line, bool quoted);
+
+    // 引用符の外にある次の改行の位置（まだ読み込んでいなければ npos）
+    size_t FindRecordEnd();
+
+    // 次のチャンクを buffer の末尾に追加する
+    bool AppendChunk();
+
+    // buffer の [begin, end) を UTF-8 に変換して line に入れる（next は次の行の先頭）
+    void AssignLine(std::string& line, size_t begin, size_t end, size_t next);
+};
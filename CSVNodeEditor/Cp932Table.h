@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// CP932 の 2 バイト文字の範囲
+const size_t cp932LeadCount = 60;       // 0x81〜0x9F, 0xE0〜0xFC
+const size_t cp932TrailCount = 189;     // 0x40〜0xFC
+
+// 先頭バイトの行番号（2 バイト文字の先頭でなければ -1）
+inline int Cp932LeadIndex(uint8_t lead)
+{
+    if (lead >= 0x81 && lead <= 0x9F)
+    {
+        return lead - 0x81;
+    }
+    if (lead >= 0xE0 && lead <= 0xFC)
+    {
+        return lead - 0xE0 + 31;
+    }
+    return -1;
+}
+
+// [Cp932LeadIndex(先頭) * cp932TrailCount + (後続 - 0x40)] に Unicode のコードポイント（未定義は 0）
+extern const uint16_t cp932DoubleByteTable[cp932LeadCount * cp932TrailCount];
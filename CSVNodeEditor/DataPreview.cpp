@@ -0,0 +1,317 @@
+﻿#include "DataPreview.h"
+#include "imgui.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+
+namespace
+{
+    // 同時に表示する最大列数（横に広い表は列ウィンドウを移動して閲覧する）
+    const int maxVisibleColumns = 64;
+
+    // 1セルあたりの最大表示文字数
+    const size_t maxCellLength = 128;
+
+    // キャッシュの上限。超えた場合は現在のフレームで使われなかったセルを破棄する
+    const size_t maxCachedCells = 8192;
+
+    const float columnWidth = 120.0f;
+
+    // 編集中のセルに元の値より長く書き足せる文字数
+    const size_t editMargin = 1024;
+}
+
+DataPreview::DataPreview()
+    : cachedData(nullptr)
+    , cachedVersion(0)
+    , firstColumn(0)
+    , editMode(false)
+    , editRow(-1)
+    , editColumn(-1)
+    , focusEditor(false)
+    , pendingAction(RowAction::None)
+    , pendingRow(-1)
+{
+}
+
+void DataPreview::Render(CSVData& data)
+{
+    // 表示対象のデータが変わった場合はキャッシュを破棄する（行の番号がずれるため、編集中のセルと行の選択も解く）
+    if (cachedData != &data || cachedVersion != data.GetVersion())
+    {
+        cellCache.clear();
+        cachedData = &data;
+        cachedVersion = data.GetVersion();
+        editRow = -1;
+        selectedRows.clear();
+    }
+
+    if (ImGui::Checkbox("編集", &editMode) && !editMode)
+    {
+        editRow = -1;
+        selectedRows.clear();
+    }
+    if (editMode && !selectedRows.empty())
+    {
+        ImGui::SameLine();
+        ImGui::Text("%zu 行を選択", selectedRows.size());
+        ImGui::SameLine();
+        if (ImGui::SmallButton("選択した行を削除"))
+        {
+            pendingAction = RowAction::RemoveSelected;
+        }
+    }
+
+    const auto& headers = data.GetHeaders();
+    const int columnCount = static_cast<int>(headers.size());
+    if (columnCount == 0)
+    {
+        return;
+    }
+
+    // 列ウィンドウの選択
+    if (columnCount > maxVisibleColumns)
+    {
+        int lastFirstColumn = columnCount - maxVisibleColumns;
+        ImGui::SliderInt("表示開始列", &firstColumn, 0, lastFirstColumn);
+    }
+    firstColumn = std::max(0, std::min(firstColumn, std::max(0, columnCount - maxVisibleColumns)));
+    const int visibleColumns = std::min(columnCount - firstColumn, maxVisibleColumns);
+
+    // ImGuiListClipper は int で行数を扱うため上限を丸める
+    const int rowCount = static_cast<int>(std::min(data.GetRowCount(), static_cast<size_t>(INT_MAX)));
+    const int frame = ImGui::GetFrameCount();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollX
+        | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("DataPreviewTable", visibleColumns + 1, flags))
+    {
+        // 行番号列とヘッダー行を固定する
+        ImGui::TableSetupScrollFreeze(1, 1);
+        ImGui::TableSetupColumn("#", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+        for (int c = 0; c < visibleColumns; ++c)
+        {
+            ImGui::TableSetupColumn(headers[firstColumn + c].c_str(), ImGuiTableColumnFlags_WidthFixed, columnWidth);
+        }
+        ImGui::TableHeadersRow();
+
+        ImGuiListClipper clipper;
+        clipper.Begin(rowCount);
+        while (clipper.Step())
+        {
+            for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; ++row)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                if (editMode)
+                {
+                    RenderRowHeader(row);
+                }
+                else
+                {
+                    ImGui::Text("%d", row + 1);
+                }
+
+                for (int c = 0; c < visibleColumns; ++c)
+                {
+                    // 横スクロールで隠れている列は整形しない
+                    if (!ImGui::TableSetColumnIndex(c + 1))
+                    {
+                        continue;
+                    }
+                    const std::string& text = GetCellText(data, static_cast<size_t>(row), static_cast<size_t>(firstColumn + c), frame);
+                    if (editMode)
+                    {
+                        RenderEditableCell(data, row, firstColumn + c, text);
+                    }
+                    else
+                    {
+                        ImGui::TextUnformatted(text.c_str(), text.c_str() + text.size());
+                    }
+                }
+            }
+        }
+        clipper.End();
+
+        ImGui::EndTable();
+    }
+
+    ApplyRowAction(data);
+    EvictStaleCells(frame);
+}
+
+void DataPreview::RenderRowHeader(int row)
+{
+    char label[32];
+    std::snprintf(label, sizeof(label), "%d", row + 1);
+
+    // クリックで行を選択に加え（もう一度で外す）、右クリックで行の操作を開く
+    ImGui::PushID(row);
+    if (ImGui::Selectable(label, IsRowSelected(static_cast<uint32_t>(row))))
+    {
+        ToggleRowSelection(static_cast<uint32_t>(row));
+    }
+    if (ImGui::BeginPopupContextItem("RowMenu"))
+    {
+        if (ImGui::MenuItem("上に行を挿入"))
+        {
+            pendingAction = RowAction::InsertAbove;
+            pendingRow = row;
+        }
+        if (ImGui::MenuItem("下に行を挿入"))
+        {
+            pendingAction = RowAction::InsertBelow;
+            pendingRow = row;
+        }
+        if (ImGui::MenuItem("行を削除"))
+        {
+            pendingAction = RowAction::Remove;
+            pendingRow = row;
+        }
+        if (!selectedRows.empty())
+        {
+            char selectedLabel[64];
+            std::snprintf(selectedLabel, sizeof(selectedLabel), "選択した %zu 行を削除", selectedRows.size());
+            if (ImGui::MenuItem(selectedLabel))
+            {
+                pendingAction = RowAction::RemoveSelected;
+            }
+        }
+        ImGui::EndPopup();
+    }
+    ImGui::PopID();
+}
+
+void DataPreview::RenderEditableCell(CSVData& data, int row, int column, const std::string& text)
+{
+    if (row != editRow || column != editColumn)
+    {
+        ImGui::TextUnformatted(text.c_str(), text.c_str() + text.size());
+        if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0))
+        {
+            BeginCellEdit(data, row, column);
+        }
+        return;
+    }
+
+    // Enter で確定し、Esc や他の場所のクリックで入力欄を離れたら取り消す
+    ImGui::PushID(row);
+    ImGui::PushID(column);
+    if (focusEditor)
+    {
+        ImGui::SetKeyboardFocusHere();
+        focusEditor = false;
+    }
+    ImGui::SetNextItemWidth(-1.0f);
+    if (ImGui::InputText("##Edit", editBuffer.data(), editBuffer.size(),
+        ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_AutoSelectAll))
+    {
+        data.SetCell(static_cast<size_t>(row), static_cast<size_t>(column), std::string_view(editBuffer.data()));
+        editRow = -1;
+    }
+    else if (ImGui::IsItemDeactivated())
+    {
+        editRow = -1;
+    }
+    ImGui::PopID();
+    ImGui::PopID();
+}
+
+void DataPreview::BeginCellEdit(const CSVData& data, int row, int column)
+{
+    // 表示は切り詰めているため、元の値全体を入力欄に写す
+    std::string_view value = data.GetCell(static_cast<size_t>(row), static_cast<size_t>(column));
+    editBuffer.assign(value.begin(), value.end());
+    editBuffer.resize(value.size() + editMargin, '\0');
+    editRow = row;
+    editColumn = column;
+    focusEditor = true;
+}
+
+void DataPreview::ApplyRowAction(CSVData& data)
+{
+    const size_t row = static_cast<size_t>(std::max(pendingRow, 0));
+    switch (pendingAction)
+    {
+    case RowAction::None:
+        return;
+    case RowAction::InsertAbove:
+        data.InsertRow(row, std::vector<std::string>(data.GetColumnCount()));
+        break;
+    case RowAction::InsertBelow:
+        data.InsertRow(row + 1, std::vector<std::string>(data.GetColumnCount()));
+        break;
+    case RowAction::Remove:
+        data.RemoveRow(row);
+        break;
+    case RowAction::RemoveSelected:
+        data.RemoveRows(selectedRows);
+        break;
+    }
+    pendingAction = RowAction::None;
+    pendingRow = -1;
+    editRow = -1;
+    selectedRows.clear();
+}
+
+bool DataPreview::IsRowSelected(uint32_t row) const
+{
+    return std::binary_search(selectedRows.begin(), selectedRows.end(), row);
+}
+
+void DataPreview::ToggleRowSelection(uint32_t row)
+{
+    auto it = std::lower_bound(selectedRows.begin(), selectedRows.end(), row);
+    if (it != selectedRows.end() && *it == row)
+    {
+        selectedRows.erase(it);
+    }
+    else
+    {
+        selectedRows.insert(it, row);
+    }
+}
+
+const std::string& DataPreview::GetCellText(const CSVData& data, size_t row, size_t column, int frame)
+{
+    uint64_t key = static_cast<uint64_t>(row) * data.GetColumnCount() + column;
+    auto it = cellCache.find(key);
+    if (it == cellCache.end())
+    {
+        CachedCell cell;
+        std::string_view value = data.GetCell(row, column);
+        if (value.size() > maxCellLength)
+        {
+            cell.text.assign(value.data(), maxCellLength);
+            cell.text += "...";
+        }
+        else
+        {
+            cell.text.assign(value.data(), value.size());
+        }
+        it = cellCache.emplace(key, std::move(cell)).first;
+    }
+
+    it->second.lastUsedFrame = frame;
+    return it->second.text;
+}
+
+void DataPreview::EvictStaleCells(int frame)
+{
+    if (cellCache.size() <= maxCachedCells)
+    {
+        return;
+    }
+
+    for (auto it = cellCache.begin(); it != cellCache.end();)
+    {
+        if (it->second.lastUsedFrame != frame)
+        {
+            it = cellCache.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
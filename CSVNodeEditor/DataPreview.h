@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 仮想化されたデータプレビューテーブル
+// 行は ImGuiListClipper で、列は表示列ウィンドウと列の可視判定で間引き、
+// 画面に見えているセルだけを整形・描画する。1フレームのコストは表の大きさに依存しない。
+// 編集モードではセルのダブルクリックで値を書き換え、行番号の右クリックで行を挿入・削除する。
+// 行の位置は CSVData の木で持つため、大きな表の途中への挿入・削除も O(log n) で済む。
+class DataPreview
+{
+public:
+    DataPreview();
+
+    void Render(CSVData& data);
+
+private:
+    // 整形済みセル文字列のキャッシュ（表示中の範囲のみ保持）
+    struct CachedCell
+    {
+        std::string text;
+        int lastUsedFrame;
+    };
+
+    std::unordered_map<uint64_t, CachedCell> cellCache;
+    const CSVData* cachedData;
+    uint64_t cachedVersion;
+    int firstColumn;
+
+    // 編集
+    bool editMode;
+    int editRow;                            // 値を書き換えているセル（無ければ -1）
+    int editColumn;
+    bool focusEditor;                       // 次のフレームで入力欄に入力を移す
+    std::vector<char> editBuffer;
+    std::vector<uint32_t> selectedRows;     // 昇順
+
+    // 行の挿入・削除は表を描き終えてから行う（描画中の行番号をずらさない）
+    enum class RowAction
+    {
+        None,
+        InsertAbove,
+        InsertBelow,
+        Remove,
+        RemoveSelected
+    };
+    RowAction pendingAction;
+    int pendingRow;
+
+    void RenderRowHeader(int row);
+    void RenderEditableCell(CSVData& data, int row, int column, const std::string& text);
+    void BeginCellEdit(const CSVData& data, int row, int column);
+    void ApplyRowAction(CSVData& data);
+    bool IsRowSelected(uint32_t row) const;
+    void ToggleRowSelection(uint32_t row);
+
+    const std::string& GetCellText(const CSVData& data, size_t row, size_t column, int frame);
+    void EvictStaleCells(int frame);
+};
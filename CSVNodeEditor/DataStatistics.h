@@ -0,0 +1,22 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// 列ごとの統計情報
+struct DataStatistics
+{
+    size_t totalRows = 0;
+    size_t nullCount = 0;          // 空セル・欠損セルの数
+    size_t numericCount = 0;       // 数値として解釈できたセルの数
+    bool isNumeric = false;        // 空でないセルがすべて数値の場合 true
+    std::string minValue;          // 数値列は数値順、それ以外は辞書順
+    std::string maxValue;
+    double numericMin = 0.0;
+    double numericMax = 0.0;
+    double average = 0.0;
+    double standardDeviation = 0.0;
+    size_t distinctEstimate = 0;   // HyperLogLog による異なり数の推定値
+    std::vector<size_t> histogram; // numericMin〜numericMax を等幅に分割した度数（推定）
+};
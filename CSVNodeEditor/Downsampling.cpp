@@ -0,0 +1,255 @@
+﻿#include "Downsampling.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // ピラミッド最下層のバケットサイズと、レベル間の縮小率
+    const size_t baseBucketSize = 16;
+    const size_t levelFactor = 4;
+
+    // 最下層を構築する際に1タスクで処理するバケット数
+    const size_t bucketsPerTask = 65536;
+}
+
+void DownsampleLTTB(const double* x, const double* y, size_t count, size_t threshold,
+    std::vector<double>& outX, std::vector<double>& outY)
+{
+    outX.clear();
+    outY.clear();
+    if (threshold >= count || threshold < 3)
+    {
+        outX.assign(x, x + count);
+        outY.assign(y, y + count);
+        return;
+    }
+
+    outX.reserve(threshold);
+    outY.reserve(threshold);
+
+    // 先頭と末尾は常に残し、間を threshold - 2 個のバケットに分ける
+    const double bucketWidth = static_cast<double>(count - 2) / static_cast<double>(threshold - 2);
+    size_t selected = 0;
+    outX.push_back(x[0]);
+    outY.push_back(y[0]);
+
+    for (size_t bucket = 0; bucket < threshold - 2; ++bucket)
+    {
+        size_t begin = static_cast<size_t>(std::floor(bucket * bucketWidth)) + 1;
+        size_t end = std::min(static_cast<size_t>(std::floor((bucket + 1) * bucketWidth)) + 1, count - 1);
+
+        // 次のバケットの平均点
+        size_t nextBegin = end;
+        size_t nextEnd = std::min(static_cast<size_t>(std::floor((bucket + 2) * bucketWidth)) + 1, count);
+        double averageX = 0.0;
+        double averageY = 0.0;
+        for (size_t i = nextBegin; i < nextEnd; ++i)
+        {
+            averageX += x[i];
+            averageY += y[i];
+        }
+        size_t nextCount = std::max<size_t>(1, nextEnd - nextBegin);
+        averageX /= static_cast<double>(nextCount);
+        averageY /= static_cast<double>(nextCount);
+
+        // 直前に選んだ点・次バケット平均と作る三角形の面積が最大の点を選ぶ
+        double maxArea = -1.0;
+        size_t best = begin;
+        for (size_t i = begin; i < end; ++i)
+        {
+            double area = std::fabs((x[selected] - averageX) * (y[i] - y[selected])
+                - (x[selected] - x[i]) * (averageY - y[selected]));
+            if (area > maxArea)
+            {
+                maxArea = area;
+                best = i;
+            }
+        }
+
+        outX.push_back(x[best]);
+        outY.push_back(y[best]);
+        selected = best;
+    }
+
+    outX.push_back(x[count - 1]);
+    outY.push_back(y[count - 1]);
+}
+
+void DownsampledSeries::Build(std::vector<double> x, std::vector<double> y)
+{
+    Clear();
+    xs = std::move(x);
+    ys = std::move(y);
+    ys.resize(xs.size());
+    if (!ys.empty())
+    {
+        auto range = std::minmax_element(ys.begin(), ys.end());
+        yMin = *range.first;
+        yMax = *range.second;
+    }
+
+    if (xs.size() <= baseBucketSize)
+    {
+        return;
+    }
+
+    // 最下層は元データから並列に構築する
+    Level base;
+    base.bucketSize = baseBucketSize;
+    size_t bucketCount = (xs.size() + baseBucketSize - 1) / baseBucketSize;
+    base.minIndex.resize(bucketCount);
+    base.maxIndex.resize(bucketCount);
+    ParallelFor((bucketCount + bucketsPerTask - 1) / bucketsPerTask, [&](size_t task) {
+        size_t firstBucket = task * bucketsPerTask;
+        size_t lastBucket = std::min(bucketCount, firstBucket + bucketsPerTask);
+        for (size_t b = firstBucket; b < lastBucket; ++b)
+        {
+            size_t begin = b * baseBucketSize;
+            size_t end = std::min(xs.size(), begin + baseBucketSize);
+            size_t minIndex = begin;
+            size_t maxIndex = begin;
+            for (size_t i = begin + 1; i < end; ++i)
+            {
+                if (ys[i] < ys[minIndex]) minIndex = i;
+                if (ys[i] > ys[maxIndex]) maxIndex = i;
+            }
+            base.minIndex[b] = static_cast<uint32_t>(minIndex);
+            base.maxIndex[b] = static_cast<uint32_t>(maxIndex);
+        }
+    });
+    levels.push_back(std::move(base));
+
+    // 上位レベルは直下のレベルのバケットを levelFactor 個ずつまとめる
+    while (levels.back().minIndex.size() > 1)
+    {
+        const Level& lower = levels.back();
+        Level upper;
+        upper.bucketSize = lower.bucketSize * levelFactor;
+        size_t upperCount = (lower.minIndex.size() + levelFactor - 1) / levelFactor;
+        upper.minIndex.resize(upperCount);
+        upper.maxIndex.resize(upperCount);
+        for (size_t b = 0; b < upperCount; ++b)
+        {
+            size_t begin = b * levelFactor;
+            size_t end = std::min(lower.minIndex.size(), begin + levelFactor);
+            uint32_t minIndex = lower.minIndex[begin];
+            uint32_t maxIndex = lower.maxIndex[begin];
+            for (size_t i = begin + 1; i < end; ++i)
+            {
+                if (ys[lower.minIndex[i]] < ys[minIndex]) minIndex = lower.minIndex[i];
+                if (ys[lower.maxIndex[i]] > ys[maxIndex]) maxIndex = lower.maxIndex[i];
+            }
+            upper.minIndex[b] = minIndex;
+            upper.maxIndex[b] = maxIndex;
+        }
+        levels.push_back(std::move(upper));
+    }
+}
+
+void DownsampledSeries::Clear()
+{
+    xs.clear();
+    ys.clear();
+    levels.clear();
+    yMin = 0.0;
+    yMax = 0.0;
+}
+
+void DownsampledSeries::AppendBucket(size_t minIndex, size_t maxIndex, std::vector<double>& outX, std::vector<double>& outY) const
+{
+    // 線が正しく描かれるよう、元の並び順で出力する
+    size_t first = std::min(minIndex, maxIndex);
+    size_t second = std::max(minIndex, maxIndex);
+    outX.push_back(xs[first]);
+    outY.push_back(ys[first]);
+    if (second != first)
+    {
+        outX.push_back(xs[second]);
+        outY.push_back(ys[second]);
+    }
+}
+
+void DownsampledSeries::Query(double xMin, double xMax, int pixelWidth, DownsampleMode mode,
+    std::vector<double>& outX, std::vector<double>& outY) const
+{
+    outX.clear();
+    outY.clear();
+    if (xs.empty())
+    {
+        return;
+    }
+
+    // 表示範囲の両端の外側1点まで含め、線が画面端で途切れないようにする
+    size_t begin = static_cast<size_t>(std::lower_bound(xs.begin(), xs.end(), xMin) - xs.begin());
+    size_t end = static_cast<size_t>(std::upper_bound(xs.begin(), xs.end(), xMax) - xs.begin());
+    begin = begin > 0 ? begin - 1 : 0;
+    end = std::min(xs.size(), end + 1);
+    if (begin >= end)
+    {
+        return;
+    }
+
+    const size_t pixels = static_cast<size_t>(std::max(1, pixelWidth));
+    const size_t visible = end - begin;
+
+    if (visible <= pixels * 2)
+    {
+        outX.assign(xs.begin() + begin, xs.begin() + end);
+        outY.assign(ys.begin() + begin, ys.begin() + end);
+        return;
+    }
+
+    // 1バケットが1ピクセル以下に収まる最も粗いレベルを選ぶ
+    const Level* level = nullptr;
+    for (const auto& candidate : levels)
+    {
+        if (visible / candidate.bucketSize >= pixels)
+        {
+            level = &candidate;
+        }
+    }
+
+    outX.reserve(pixels * 2);
+    outY.reserve(pixels * 2);
+    if (level)
+    {
+        size_t firstBucket = begin / level->bucketSize;
+        size_t lastBucket = (end - 1) / level->bucketSize;
+        for (size_t b = firstBucket; b <= lastBucket; ++b)
+        {
+            AppendBucket(level->minIndex[b], level->maxIndex[b], outX, outY);
+        }
+    }
+    else
+    {
+        // 最下層より細かい範囲は元データから直接バケット化する（最大 baseBucketSize × pixels 点）
+        for (size_t p = 0; p < pixels; ++p)
+        {
+            size_t bucketBegin = begin + visible * p / pixels;
+            size_t bucketEnd = begin + visible * (p + 1) / pixels;
+            if (bucketBegin >= bucketEnd)
+            {
+                continue;
+            }
+            size_t minIndex = bucketBegin;
+            size_t maxIndex = bucketBegin;
+            for (size_t i = bucketBegin + 1; i < bucketEnd; ++i)
+            {
+                if (ys[i] < ys[minIndex]) minIndex = i;
+                if (ys[i] > ys[maxIndex]) maxIndex = i;
+            }
+            AppendBucket(minIndex, maxIndex, outX, outY);
+        }
+    }
+
+    if (mode == DownsampleMode::LTTB)
+    {
+        // 最小・最大の候補点からさらにピクセル数まで LTTB で絞り込む
+        std::vector<double> candidatesX;
+        std::vector<double> candidatesY;
+        candidatesX.swap(outX);
+        candidatesY.swap(outY);
+        DownsampleLTTB(candidatesX.data(), candidatesY.data(), candidatesX.size(), pixels, outX, outY);
+    }
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 間引き方式
+enum class DownsampleMode
+{
+    MinMax, // ピクセル幅のバケットごとに最小・最大を残す
+    LTTB    // Largest-Triangle-Three-Buckets で形状を保つ点を選ぶ
+};
+
+// LTTB による間引き（threshold 点に削減）
+void DownsampleLTTB(const double* x, const double* y, size_t count, size_t threshold,
+    std::vector<double>& outX, std::vector<double>& outY);
+
+// 多重解像度ピラミッドを持つ描画用系列
+// 各レベルはバケット（16, 64, 256, ... 点）ごとの最小・最大位置を保持し、
+// 表示範囲の問い合わせはバケット数（≒ピクセル数）に比例するコストで答える。
+class DownsampledSeries
+{
+public:
+    // x は昇順に並んでいること
+    void Build(std::vector<double> x, std::vector<double> y);
+    void Clear();
+
+    // [xMin, xMax] の範囲を pixelWidth 程度の点数に間引いて返す
+    void Query(double xMin, double xMax, int pixelWidth, DownsampleMode mode,
+        std::vector<double>& outX, std::vector<double>& outY) const;
+
+    size_t GetPointCount() const { return xs.size(); }
+    bool IsEmpty() const { return xs.empty(); }
+    double GetMinX() const { return xs.empty() ? 0.0 : xs.front(); }
+    double GetMaxX() const { return xs.empty() ? 0.0 : xs.back(); }
+    double GetMinY() const { return yMin; }
+    double GetMaxY() const { return yMax; }
+
+private:
+    // 位置は32ビットで保持する（1系列あたり約42億点まで）
+    struct Level
+    {
+        size_t bucketSize;
+        std::vector<uint32_t> minIndex;
+        std::vector<uint32_t> maxIndex;
+    };
+
+    std::vector<double> xs;
+    std::vector<double> ys;
+    std::vector<Level> levels;
+    double yMin = 0.0;
+    double yMax = 0.0;
+
+    void AppendBucket(size_t minIndex, size_t maxIndex, std::vector<double>& outX, std::vector<double>& outY) const;
+};
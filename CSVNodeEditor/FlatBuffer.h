@@ -0,0 +1,341 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Arrow IPC のメタデータ用の最小限の FlatBuffers 書き込みヘルパー
+// 公式の FlatBufferBuilder と同様にバッファを末尾から先頭へ向けて構築する。
+// オフセットは「その時点でのバッファ末尾からの距離」で表す。
+class FlatBufferBuilder
+{
+public:
+    using Offset = uint32_t;
+
+    FlatBufferBuilder()
+        : minAlign(1)
+        , tableStart(0)
+    {
+    }
+
+    template <typename T>
+    void Push(T value)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "FlatBufferBuilder::Push requires a trivially copyable type");
+        Align(sizeof(T));
+        Prepend(&value, sizeof(T));
+    }
+
+    Offset CreateString(const std::string& value)
+    {
+        PreAlign(value.size() + 1, sizeof(uint32_t));
+        Prepend("", 1);
+        Prepend(value.data(), value.size());
+        Push(static_cast<uint32_t>(value.size()));
+        return GetSize();
+    }
+
+    // テーブル・文字列へのオフセットのベクター
+    Offset CreateOffsetVector(const std::vector<Offset>& offsets)
+    {
+        PreAlign(offsets.size() * sizeof(uint32_t), sizeof(uint32_t));
+        for (size_t i = offsets.size(); i > 0; --i)
+        {
+            PushOffset(offsets[i - 1]);
+        }
+        Push(static_cast<uint32_t>(offsets.size()));
+        return GetSize();
+    }
+
+    // 構造体のベクター（各要素は 8 バイト境界に揃った固定長のバイト列）
+    template <typename T>
+    Offset CreateStructVector(const std::vector<T>& values)
+    {
+        static_assert(std::is_trivially_copyable<T>::value, "FlatBufferBuilder::CreateStructVector requires a trivially copyable type");
+        PreAlign(values.size() * sizeof(T), sizeof(uint64_t));
+        for (size_t i = values.size(); i > 0; --i)
+        {
+            Prepend(&values[i - 1], sizeof(T));
+        }
+        Push(static_cast<uint32_t>(values.size()));
+        return GetSize();
+    }
+
+    void StartTable()
+    {
+        fields.clear();
+        tableStart = GetSize();
+    }
+
+    template <typename T>
+    void AddField(uint16_t id, T value)
+    {
+        Push(value);
+        fields.emplace_back(id, GetSize());
+    }
+
+    void AddOffsetField(uint16_t id, Offset offset)
+    {
+        PushOffset(offset);
+        fields.emplace_back(id, GetSize());
+    }
+
+    Offset EndTable()
+    {
+        Push(int32_t(0));
+        const Offset table = GetSize();
+
+        uint16_t fieldCount = 0;
+        for (const auto& field : fields)
+        {
+            fieldCount = std::max<uint16_t>(fieldCount, static_cast<uint16_t>(field.first + 1));
+        }
+        std::vector<uint16_t> vtable(2 + fieldCount, 0);
+        vtable[0] = static_cast<uint16_t>(vtable.size() * sizeof(uint16_t));
+        vtable[1] = static_cast<uint16_t>(table - tableStart);
+        for (const auto& field : fields)
+        {
+            vtable[2 + field.first] = static_cast<uint16_t>(table - field.second);
+        }
+        for (size_t i = vtable.size(); i > 0; --i)
+        {
+            Push(vtable[i - 1]);
+        }
+
+        // テーブル先頭の soffset は「テーブル位置 - vtable 位置」
+        // （逆順に保持しているため、table - 4 から table - 1 の位置へ逆向きに書き込む）
+        const int32_t vtableDistance = static_cast<int32_t>(GetSize() - table);
+        const char* bytes = reinterpret_cast<const char*>(&vtableDistance);
+        for (size_t i = 0; i < sizeof(int32_t); ++i)
+        {
+            buffer[table - 1 - i] = bytes[i];
+        }
+        fields.clear();
+        return table;
+    }
+
+    // ルートテーブルを設定し、先頭から読める完成したバッファを返す
+    std::string Finish(Offset root)
+    {
+        PreAlign(sizeof(uint32_t), minAlign);
+        PushOffset(root);
+        return std::string(buffer.rbegin(), buffer.rend());
+    }
+
+    Offset GetSize() const { return static_cast<Offset>(buffer.size()); }
+
+private:
+    // 逆順に保持し、Finish で反転する
+    std::string buffer;
+    size_t minAlign;
+    Offset tableStart;
+    std::vector<std::pair<uint16_t, Offset>> fields;
+
+    void Prepend(const void* data, size_t size)
+    {
+        const char* bytes = static_cast<const char*>(data);
+        for (size_t i = size; i > 0; --i)
+        {
+            buffer.push_back(bytes[i - 1]);
+        }
+    }
+
+    void Align(size_t alignment)
+    {
+        PreAlign(0, alignment);
+    }
+
+    // additional バイト書き込んだ後に alignment 境界になるよう詰め物を入れる
+    void PreAlign(size_t additional, size_t alignment)
+    {
+        minAlign = std::max(minAlign, alignment);
+        while ((buffer.size() + additional) % alignment != 0)
+        {
+            buffer.push_back('\0');
+        }
+    }
+
+    void PushOffset(Offset offset)
+    {
+        Align(sizeof(uint32_t));
+        Push(static_cast<uint32_t>(GetSize() + sizeof(uint32_t) - offset));
+    }
+};
+
+// FlatBuffers のテーブル読み込みヘルパー
+// すべての参照先をバッファ範囲内か検査し、壊れたメタデータでは無効なテーブルを返す。
+class FlatBufferTable
+{
+public:
+    FlatBufferTable()
+        : data(nullptr)
+        , size(0)
+        , position(0)
+        , vtable(0)
+        , vtableSize(0)
+    {
+    }
+
+    // バッファ先頭のルートオフセットからテーブルを開く
+    static FlatBufferTable Root(const char* data, size_t size)
+    {
+        uint32_t offset = 0;
+        if (!ReadScalar(data, size, 0, offset))
+        {
+            return FlatBufferTable();
+        }
+        return FlatBufferTable(data, size, offset);
+    }
+
+    bool IsValid() const { return data != nullptr; }
+
+    template <typename T>
+    T GetField(uint16_t id, T defaultValue) const
+    {
+        size_t fieldPosition = 0;
+        T value = defaultValue;
+        if (FieldPosition(id, fieldPosition))
+        {
+            ReadScalar(data, size, fieldPosition, value);
+        }
+        return value;
+    }
+
+    FlatBufferTable GetTable(uint16_t id) const
+    {
+        size_t target = 0;
+        if (!Dereference(id, target))
+        {
+            return FlatBufferTable();
+        }
+        return FlatBufferTable(data, size, target);
+    }
+
+    bool GetString(uint16_t id, std::string& value) const
+    {
+        size_t target = 0;
+        uint32_t length = 0;
+        if (!Dereference(id, target) || !ReadScalar(data, size, target, length) || length > size - target - sizeof(uint32_t))
+        {
+            return false;
+        }
+        value.assign(data + target + sizeof(uint32_t), length);
+        return true;
+    }
+
+    // ベクターの要素数と先頭位置を返す（フィールドが無ければ要素数 0）
+    bool GetVector(uint16_t id, size_t elementSize, size_t& count, size_t& elements) const
+    {
+        count = 0;
+        elements = 0;
+        size_t target = 0;
+        if (!HasField(id))
+        {
+            return true;
+        }
+        uint32_t length = 0;
+        if (!Dereference(id, target) || !ReadScalar(data, size, target, length))
+        {
+            return false;
+        }
+        elements = target + sizeof(uint32_t);
+        if (elementSize != 0 && length > (size - elements) / elementSize)
+        {
+            return false;
+        }
+        count = length;
+        return true;
+    }
+
+    // テーブルのベクターの index 番目の要素
+    FlatBufferTable GetVectorTable(size_t elements, size_t index) const
+    {
+        size_t slot = elements + index * sizeof(uint32_t);
+        uint32_t offset = 0;
+        if (!ReadScalar(data, size, slot, offset))
+        {
+            return FlatBufferTable();
+        }
+        return FlatBufferTable(data, size, slot + offset);
+    }
+
+    template <typename T>
+    bool ReadAt(size_t at, T& value) const
+    {
+        return ReadScalar(data, size, at, value);
+    }
+
+private:
+    const char* data;
+    size_t size;
+    size_t position;
+    size_t vtable;
+    uint16_t vtableSize;
+
+    FlatBufferTable(const char* data, size_t size, size_t position)
+        : FlatBufferTable()
+    {
+        int32_t vtableDistance = 0;
+        uint16_t length = 0;
+        if (!ReadScalar(data, size, position, vtableDistance))
+        {
+            return;
+        }
+        int64_t vtablePosition = static_cast<int64_t>(position) - vtableDistance;
+        if (vtablePosition < 0 || !ReadScalar(data, size, static_cast<size_t>(vtablePosition), length) || length < 4
+            || static_cast<size_t>(vtablePosition) + length > size)
+        {
+            return;
+        }
+        this->data = data;
+        this->size = size;
+        this->position = position;
+        this->vtable = static_cast<size_t>(vtablePosition);
+        this->vtableSize = length;
+    }
+
+    template <typename T>
+    static bool ReadScalar(const char* data, size_t size, size_t at, T& value)
+    {
+        if (!data || at > size || sizeof(T) > size - at)
+        {
+            return false;
+        }
+        std::memcpy(&value, data + at, sizeof(T));
+        return true;
+    }
+
+    bool HasField(uint16_t id) const
+    {
+        size_t fieldPosition = 0;
+        return FieldPosition(id, fieldPosition);
+    }
+
+    bool FieldPosition(uint16_t id, size_t& fieldPosition) const
+    {
+        size_t slot = 4 + static_cast<size_t>(id) * sizeof(uint16_t);
+        uint16_t fieldOffset = 0;
+        if (!data || slot + sizeof(uint16_t) > vtableSize || !ReadScalar(data, size, vtable + slot, fieldOffset) || fieldOffset == 0)
+        {
+            return false;
+        }
+        fieldPosition = position + fieldOffset;
+        return true;
+    }
+
+    bool Dereference(uint16_t id, size_t& target) const
+    {
+        size_t fieldPosition = 0;
+        uint32_t offset = 0;
+        if (!FieldPosition(id, fieldPosition) || !ReadScalar(data, size, fieldPosition, offset))
+        {
+            return false;
+        }
+        target = fieldPosition + offset;
+        return target < size;
+    }
+};
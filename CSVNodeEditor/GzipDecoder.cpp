@@ -0,0 +1,522 @@
+﻿#include "GzipDecoder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const size_t windowSize = 32768;
+
+    const uint8_t flagHeaderCrc = 0x02;
+    const uint8_t flagExtra = 0x04;
+    const uint8_t flagName = 0x08;
+    const uint8_t flagComment = 0x10;
+
+    const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+    // 符号長を表す符号の符号長が並ぶ順序
+    const uint8_t codeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    struct Crc32Table
+    {
+        uint32_t values[256];
+
+        Crc32Table()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                {
+                    crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                }
+                values[i] = crc;
+            }
+        }
+    };
+
+    uint32_t UpdateCrc32(uint32_t crc, const char* data, size_t size)
+    {
+        static const Crc32Table table;
+        crc = ~crc;
+        for (size_t i = 0; i < size; ++i)
+        {
+            crc = table.values[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    bool IsGzipMagic(const uint8_t* data, size_t size)
+    {
+        return size >= 3 && data[0] == 0x1F && data[1] == 0x8B && data[2] == 8;
+    }
+}
+
+void GzipDecoder::BitInput::Refill()
+{
+    while (count <= 56)
+    {
+        uint64_t byte = position < size ? data[position] : 0;
+        buffer |= byte << count;
+        count += 8;
+        ++position;
+    }
+}
+
+uint32_t GzipDecoder::BitInput::Peek(int bits)
+{
+    if (count < bits)
+    {
+        Refill();
+    }
+    return static_cast<uint32_t>(buffer & ((uint64_t(1) << bits) - 1));
+}
+
+void GzipDecoder::BitInput::Consume(int bits)
+{
+    buffer >>= bits;
+    count -= bits;
+}
+
+uint32_t GzipDecoder::BitInput::Read(int bits)
+{
+    uint32_t value = Peek(bits);
+    Consume(bits);
+    return value;
+}
+
+void GzipDecoder::BitInput::AlignToByte()
+{
+    Consume(count % 8);
+}
+
+size_t GzipDecoder::BitInput::GetBytePosition() const
+{
+    return position - static_cast<size_t>(count / 8);
+}
+
+void GzipDecoder::BitInput::SeekByte(size_t bytePosition)
+{
+    position = bytePosition;
+    buffer = 0;
+    count = 0;
+}
+
+bool GzipDecoder::BitInput::IsOverrun() const
+{
+    return position * 8 - static_cast<size_t>(count) > size * 8;
+}
+
+bool GzipDecoder::HuffmanTable::Build(const uint8_t* lengths, size_t count)
+{
+    int lengthCount[16] = {};
+    maxLength = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ++lengthCount[lengths[i]];
+        maxLength = std::max<int>(maxLength, lengths[i]);
+    }
+
+    // 過剰に割り当てられた符号は不正（不完全な符号は使われない限り許容する）
+    int left = 1;
+    for (int length = 1; length <= 15; ++length)
+    {
+        left = (left << 1) - lengthCount[length];
+        if (left < 0)
+        {
+            return false;
+        }
+    }
+
+    maxLength = std::max(maxLength, 1);
+    entries.assign(size_t(1) << maxLength, 0);
+
+    uint32_t nextCode[16] = {};
+    uint32_t code = 0;
+    lengthCount[0] = 0;
+    for (int length = 1; length <= 15; ++length)
+    {
+        code = (code + lengthCount[length - 1]) << 1;
+        nextCode[length] = code;
+    }
+
+    for (size_t symbol = 0; symbol < count; ++symbol)
+    {
+        int length = lengths[symbol];
+        if (length == 0)
+        {
+            continue;
+        }
+        // ビットは符号の上位から届くため、LSB 順の入力で引けるよう反転して登録する
+        uint32_t value = nextCode[length]++;
+        uint32_t reversed = 0;
+        for (int bit = 0; bit < length; ++bit)
+        {
+            reversed = (reversed << 1) | ((value >> bit) & 1);
+        }
+        for (size_t index = reversed; index < entries.size(); index += size_t(1) << length)
+        {
+            entries[index] = static_cast<uint16_t>((symbol << 4) | length);
+        }
+    }
+    return true;
+}
+
+int GzipDecoder::HuffmanTable::Decode(BitInput& input) const
+{
+    uint16_t entry = entries[input.Peek(maxLength)];
+    if (entry == 0)
+    {
+        return -1;
+    }
+    input.Consume(entry & 0xF);
+    return entry >> 4;
+}
+
+GzipDecoder::GzipDecoder(const char* data, size_t size)
+    : state(State::Header)
+    , failed(false)
+    , emitted(0)
+    , memberCrc(0)
+    , memberSize(0)
+{
+    input.data = reinterpret_cast<const uint8_t*>(data);
+    input.size = size;
+}
+
+bool GzipDecoder::FindBgzfMembers(const char* data, size_t size, std::vector<std::pair<size_t, size_t>>& members)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    members.clear();
+    size_t position = 0;
+    while (position < size)
+    {
+        // BGZF は FEXTRA に 'B' 'C' サブフィールド（BSIZE = メンバー全体のサイズ - 1）を持つ
+        const uint8_t* member = bytes + position;
+        if (size - position < 18 || !IsGzipMagic(member, size - position) || !(member[3] & flagExtra))
+        {
+            return false;
+        }
+        uint16_t extraLength = static_cast<uint16_t>(member[10] | (member[11] << 8));
+        if (extraLength < 6 || size - position < 12u + extraLength)
+        {
+            return false;
+        }
+
+        size_t memberSize = 0;
+        for (size_t field = 12; field + 4 <= 12u + extraLength;)
+        {
+            uint16_t fieldLength = static_cast<uint16_t>(member[field + 2] | (member[field + 3] << 8));
+            if (member[field] == 'B' && member[field + 1] == 'C' && fieldLength == 2 && field + 6 <= 12u + extraLength)
+            {
+                memberSize = static_cast<size_t>(member[field + 4] | (member[field + 5] << 8)) + 1;
+                break;
+            }
+            field += 4 + fieldLength;
+        }
+        if (memberSize == 0 || memberSize > size - position)
+        {
+            return false;
+        }
+        members.emplace_back(position, memberSize);
+        position += memberSize;
+    }
+    return !members.empty();
+}
+
+bool GzipDecoder::Decode(std::string& output, size_t minimumBytes)
+{
+    while (!failed && state != State::Done && window.size() - emitted < minimumBytes)
+    {
+        Step();
+    }
+    if (failed || window.size() == emitted)
+    {
+        return false;
+    }
+
+    output.append(window, emitted, std::string::npos);
+
+    // 以降の一致参照に必要な直近 32KB だけを残す
+    if (window.size() > windowSize)
+    {
+        window.erase(0, window.size() - windowSize);
+    }
+    emitted = window.size();
+    return true;
+}
+
+void GzipDecoder::Step()
+{
+    switch (state)
+    {
+    case State::Header:
+        failed = !ReadHeader();
+        memberCrc = 0;
+        memberSize = 0;
+        state = State::Blocks;
+        break;
+    case State::Blocks:
+    {
+        size_t before = window.size();
+        bool finalBlock = false;
+        failed = !InflateBlock(finalBlock) || input.IsOverrun();
+        memberCrc = UpdateCrc32(memberCrc, window.data() + before, window.size() - before);
+        memberSize += static_cast<uint32_t>(window.size() - before);
+        if (finalBlock)
+        {
+            state = State::Trailer;
+        }
+        break;
+    }
+    case State::Trailer:
+        failed = !ReadTrailer();
+        break;
+    case State::Done:
+        break;
+    }
+}
+
+bool GzipDecoder::ReadHeader()
+{
+    size_t position = input.GetBytePosition();
+    const uint8_t* bytes = input.data;
+    if (input.size - position < 10 || !IsGzipMagic(bytes + position, input.size - position))
+    {
+        return false;
+    }
+    const uint8_t flags = bytes[position + 3];
+    position += 10;
+
+    if (flags & flagExtra)
+    {
+        if (input.size - position < 2)
+        {
+            return false;
+        }
+        size_t extraLength = static_cast<size_t>(bytes[position] | (bytes[position + 1] << 8));
+        position += 2 + extraLength;
+    }
+    for (uint8_t flag : { flagName, flagComment })
+    {
+        if (flags & flag)
+        {
+            while (position < input.size && bytes[position] != 0)
+            {
+                ++position;
+            }
+            ++position;
+        }
+    }
+    if (flags & flagHeaderCrc)
+    {
+        position += 2;
+    }
+    if (position > input.size)
+    {
+        return false;
+    }
+    input.SeekByte(position);
+    return true;
+}
+
+bool GzipDecoder::ReadTrailer()
+{
+    input.AlignToByte();
+    size_t position = input.GetBytePosition();
+    if (input.size - position < 8)
+    {
+        return false;
+    }
+    uint32_t crc = 0;
+    uint32_t size = 0;
+    std::memcpy(&crc, input.data + position, sizeof(uint32_t));
+    std::memcpy(&size, input.data + position + 4, sizeof(uint32_t));
+    if (crc != memberCrc || size != memberSize)
+    {
+        return false;
+    }
+    position += 8;
+    input.SeekByte(position);
+
+    // 連結された次のメンバーがあれば続けて伸長する（末尾の 0 埋めなどは無視する）
+    state = IsGzipMagic(input.data + position, input.size - position) ? State::Header : State::Done;
+    return true;
+}
+
+bool GzipDecoder::InflateBlock(bool& finalBlock)
+{
+    finalBlock = input.Read(1) != 0;
+    const uint32_t type = input.Read(2);
+
+    if (type == 0)
+    {
+        // 非圧縮ブロック
+        input.AlignToByte();
+        size_t position = input.GetBytePosition();
+        if (input.size - position < 4)
+        {
+            return false;
+        }
+        uint16_t length = static_cast<uint16_t>(input.data[position] | (input.data[position + 1] << 8));
+        uint16_t complement = static_cast<uint16_t>(input.data[position + 2] | (input.data[position + 3] << 8));
+        position += 4;
+        if (length != static_cast<uint16_t>(~complement) || input.size - position < length)
+        {
+            return false;
+        }
+        window.append(reinterpret_cast<const char*>(input.data + position), length);
+        input.SeekByte(position + length);
+        return true;
+    }
+
+    if (type == 1)
+    {
+        // 固定ハフマン符号
+        static const struct FixedTables
+        {
+            HuffmanTable literals;
+            HuffmanTable distances;
+
+            FixedTables()
+            {
+                uint8_t lengths[288];
+                std::memset(lengths, 8, 144);
+                std::memset(lengths + 144, 9, 112);
+                std::memset(lengths + 256, 7, 24);
+                std::memset(lengths + 280, 8, 8);
+                literals.Build(lengths, 288);
+                std::memset(lengths, 5, 30);
+                distances.Build(lengths, 30);
+            }
+        } fixed;
+        return InflateCodes(fixed.literals, fixed.distances);
+    }
+
+    if (type == 2)
+    {
+        HuffmanTable literals;
+        HuffmanTable distances;
+        return ReadDynamicTables(literals, distances) && InflateCodes(literals, distances);
+    }
+    return false;
+}
+
+bool GzipDecoder::ReadDynamicTables(HuffmanTable& literals, HuffmanTable& distances)
+{
+    const size_t literalCount = input.Read(5) + 257;
+    const size_t distanceCount = input.Read(5) + 1;
+    const size_t codeLengthCount = input.Read(4) + 4;
+    if (literalCount > 286 || distanceCount > 30)
+    {
+        return false;
+    }
+
+    uint8_t codeLengthLengths[19] = {};
+    for (size_t i = 0; i < codeLengthCount; ++i)
+    {
+        codeLengthLengths[codeLengthOrder[i]] = static_cast<uint8_t>(input.Read(3));
+    }
+    HuffmanTable codeLengths;
+    if (!codeLengths.Build(codeLengthLengths, 19))
+    {
+        return false;
+    }
+
+    uint8_t lengths[286 + 30] = {};
+    size_t index = 0;
+    while (index < literalCount + distanceCount)
+    {
+        int symbol = codeLengths.Decode(input);
+        if (symbol < 0)
+        {
+            return false;
+        }
+        if (symbol < 16)
+        {
+            lengths[index++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t value = 0;
+        size_t repeat = 0;
+        if (symbol == 16)
+        {
+            if (index == 0)
+            {
+                return false;
+            }
+            value = lengths[index - 1];
+            repeat = 3 + input.Read(2);
+        }
+        else if (symbol == 17)
+        {
+            repeat = 3 + input.Read(3);
+        }
+        else
+        {
+            repeat = 11 + input.Read(7);
+        }
+        if (index + repeat > literalCount + distanceCount)
+        {
+            return false;
+        }
+        std::memset(lengths + index, value, repeat);
+        index += repeat;
+    }
+
+    // ブロック終端記号（256）の符号が無いブロックは不正
+    return lengths[256] != 0 && literals.Build(lengths, literalCount) && distances.Build(lengths + literalCount, distanceCount);
+}
+
+bool GzipDecoder::InflateCodes(const HuffmanTable& literals, const HuffmanTable& distances)
+{
+    while (true)
+    {
+        int symbol = literals.Decode(input);
+        if (symbol < 0 || input.IsOverrun())
+        {
+            return false;
+        }
+        if (symbol < 256)
+        {
+            window.push_back(static_cast<char>(symbol));
+            continue;
+        }
+        if (symbol == 256)
+        {
+            return true;
+        }
+
+        symbol -= 257;
+        if (symbol >= 29)
+        {
+            return false;
+        }
+        const size_t length = lengthBase[symbol] + input.Read(lengthExtra[symbol]);
+
+        int distanceSymbol = distances.Decode(input);
+        if (distanceSymbol < 0 || distanceSymbol >= 30)
+        {
+            return false;
+        }
+        const size_t distance = distanceBase[distanceSymbol] + input.Read(distanceExtra[distanceSymbol]);
+        if (distance > window.size() || input.IsOverrun())
+        {
+            return false;
+        }
+
+        // 参照範囲と出力が重なる場合があるため 1 バイトずつ複写する
+        size_t from = window.size() - distance;
+        for (size_t i = 0; i < length; ++i)
+        {
+            window.push_back(window[from + i]);
+        }
+    }
+}
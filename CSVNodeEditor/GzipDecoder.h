@@ -0,0 +1,78 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// gzip（DEFLATE）形式の伸長器
+// 入力全体を受け取り、伸長結果を呼び出しごとに少しずつ取り出す。複数メンバーの連結にも対応し、
+// 各メンバーの CRC32 と伸長後サイズを検証する。
+class GzipDecoder
+{
+public:
+    GzipDecoder(const char* data, size_t size);
+
+    // 伸長結果を output に追記する（minimumBytes 以上たまるか入力の終端で戻る）
+    // 何も追記できなかった場合は false を返す。終端と失敗は HasError で区別する。
+    bool Decode(std::string& output, size_t minimumBytes);
+    bool HasError() const { return failed; }
+
+    // BGZF（各メンバーが自身の圧縮サイズを持つ gzip）のメンバー範囲を列挙する
+    // 通常の gzip のように伸長せずに境界が分からない場合は false を返す。
+    static bool FindBgzfMembers(const char* data, size_t size, std::vector<std::pair<size_t, size_t>>& members);
+
+private:
+    enum class State
+    {
+        Header,
+        Blocks,
+        Trailer,
+        Done
+    };
+
+    // LSB から順に読むビット入力（終端を越えた分は 0 として読み、超過を記録する）
+    struct BitInput
+    {
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        size_t position = 0;
+        uint64_t buffer = 0;
+        int count = 0;
+
+        void Refill();
+        uint32_t Peek(int bits);
+        void Consume(int bits);
+        uint32_t Read(int bits);
+        void AlignToByte();
+        size_t GetBytePosition() const;
+        void SeekByte(size_t bytePosition);
+        bool IsOverrun() const;
+    };
+
+    // 符号長から作る直接参照テーブル（要素は 記号 << 4 | 符号長、0 は無効）
+    struct HuffmanTable
+    {
+        std::vector<uint16_t> entries;
+        int maxLength = 0;
+
+        bool Build(const uint8_t* lengths, size_t count);
+        int Decode(BitInput& input) const;
+    };
+
+    BitInput input;
+    State state;
+    bool failed;
+    std::string window;
+    size_t emitted;
+    uint32_t memberCrc;
+    uint32_t memberSize;
+
+    bool ReadHeader();
+    bool InflateBlock(bool& finalBlock);
+    bool InflateCodes(const HuffmanTable& literals, const HuffmanTable& distances);
+    bool ReadDynamicTables(HuffmanTable& literals, HuffmanTable& distances);
+    bool ReadTrailer();
+    void Step();
+};
@@ -0,0 +1,197 @@
+﻿#include "HashJoin.h"
+#include "BloomFilter.h"
+#include "ColumnIndex.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    // 1回の並列処理で受け持つ走査側の行数
+    const size_t joinBlockRows = 16384;
+
+    const size_t noRow = static_cast<size_t>(-1);
+
+    // Bloom フィルターを使うかどうかの見積もりに使う走査側の標本数
+    const size_t bloomSampleRows = 1024;
+
+    // 走査側がこの行数未満、または見積もった一致率がこれを超える場合は Bloom フィルターを使わない
+    const size_t bloomMinProbeRows = 65536;
+    const double bloomMaxMatchRate = 0.25;
+
+    // 走査側の行を等間隔に抜き出して索引を引き、空でないキーのうち一致したものの割合を返す
+    double EstimateMatchRate(const CSVData& probe, size_t probeColumn, const CSVData& build, const HashColumnIndex& index)
+    {
+        const size_t probeRows = probe.GetRowCount();
+        const size_t sampleCount = std::min(probeRows, bloomSampleRows);
+        size_t keys = 0;
+        size_t hits = 0;
+        for (size_t i = 0; i < sampleCount; ++i)
+        {
+            std::string_view cell = probe.GetCell(i * probeRows / sampleCount, probeColumn);
+            if (cell.empty())
+            {
+                continue;
+            }
+            ++keys;
+            hits += index.Find(build, CellKey::From(cell)).empty() ? 0 : 1;
+        }
+        return keys > 0 ? static_cast<double>(hits) / keys : 1.0;
+    }
+}
+
+bool JoinTables(const CSVData& left, const CSVData& right, const JoinSpec& spec, CSVData& output, JoinStats* stats)
+{
+    const bool keepLeft = spec.type == "left" || spec.type == "outer";
+    const bool keepRight = spec.type == "right" || spec.type == "outer";
+    if (!keepLeft && !keepRight && spec.type != "inner")
+    {
+        return false;
+    }
+
+    const int leftColumn = left.GetColumnIndex(spec.leftColumn);
+    const int rightColumn = right.GetColumnIndex(spec.rightColumn);
+    if (leftColumn < 0 || rightColumn < 0)
+    {
+        return false;
+    }
+
+    // 索引を引く側（build）と行を走査する側（probe）を決める
+    auto rightIndex = right.GetHashIndex(static_cast<size_t>(rightColumn));
+    auto leftIndex = left.GetHashIndex(static_cast<size_t>(leftColumn));
+    const bool buildIsRight = rightIndex || !leftIndex;
+    const CSVData& build = buildIsRight ? right : left;
+    const CSVData& probe = buildIsRight ? left : right;
+    const size_t buildColumn = static_cast<size_t>(buildIsRight ? rightColumn : leftColumn);
+    const size_t probeColumn = static_cast<size_t>(buildIsRight ? leftColumn : rightColumn);
+    const bool keepProbe = buildIsRight ? keepLeft : keepRight;
+    const bool keepBuild = buildIsRight ? keepRight : keepLeft;
+
+    std::shared_ptr<const HashColumnIndex> index = buildIsRight ? rightIndex : leftIndex;
+    const bool usedIndex = index != nullptr;
+    if (!index)
+    {
+        index = HashColumnIndex::Build(build, buildColumn);
+        if (!index)
+        {
+            return false;
+        }
+    }
+
+    const size_t leftWidth = left.GetColumnCount();
+    const size_t rightWidth = right.GetColumnCount();
+    const size_t outputWidth = leftWidth + rightWidth;
+
+    // 左右の行（noRow は欠損）を 1 行としてブロックに追加する
+    auto appendRow = [&](CellBlock& block, size_t probeRow, size_t buildRow) {
+        const size_t leftRow = buildIsRight ? probeRow : buildRow;
+        const size_t rightRow = buildIsRight ? buildRow : probeRow;
+        for (size_t c = 0; c < leftWidth; ++c)
+        {
+            block.cells.push_back(leftRow == noRow ? CellRef() : block.Store(c, left.GetCell(leftRow, c)));
+        }
+        for (size_t c = 0; c < rightWidth; ++c)
+        {
+            block.cells.push_back(rightRow == noRow ? CellRef() : block.Store(leftWidth + c, right.GetCell(rightRow, c)));
+        }
+    };
+
+    const size_t probeRows = probe.GetRowCount();
+    const size_t buildRows = build.GetRowCount();
+
+    // 一致しない走査側の行が大半なら、build 側の異なるキーから Bloom フィルターを作る
+    const double matchRate = EstimateMatchRate(probe, probeColumn, build, *index);
+    const bool useBloom = spec.bloomFilter == "always"
+        || (spec.bloomFilter == "auto" && probeRows >= bloomMinProbeRows && matchRate <= bloomMaxMatchRate);
+    BloomFilter bloom;
+    if (useBloom)
+    {
+        std::vector<uint64_t> keyHashes = index->GetKeyHashes();
+        bloom = BloomFilter(keyHashes.size());
+        for (uint64_t hash : keyHashes)
+        {
+            bloom.Insert(hash);
+        }
+    }
+    std::unique_ptr<std::atomic<uint8_t>[]> matched(keepBuild ? new std::atomic<uint8_t>[buildRows]() : nullptr);
+
+    const size_t probeBlockCount = (probeRows + joinBlockRows - 1) / joinBlockRows;
+    const size_t buildBlockCount = keepBuild ? (buildRows + joinBlockRows - 1) / joinBlockRows : 0;
+    std::vector<CellBlock> blocks(probeBlockCount + buildBlockCount);
+    std::vector<size_t> rejected(probeBlockCount, 0);
+    ParallelFor(probeBlockCount, [&](size_t b) {
+        size_t begin = b * joinBlockRows;
+        size_t end = std::min(probeRows, begin + joinBlockRows);
+        CellBlock& block = blocks[b];
+        for (size_t r = begin; r < end; ++r)
+        {
+            std::string_view cell = probe.GetCell(r, probeColumn);
+            RowIdRange matches;
+            if (!cell.empty())
+            {
+                const CellKey key = CellKey::From(cell);
+                const uint64_t hash = key.Hash();
+                if (useBloom && !bloom.MayContain(hash))
+                {
+                    ++rejected[b];
+                }
+                else
+                {
+                    matches = index->Find(build, key, hash);
+                }
+            }
+            for (uint32_t buildRow : matches)
+            {
+                appendRow(block, r, buildRow);
+                if (matched)
+                {
+                    matched[buildRow].store(1, std::memory_order_relaxed);
+                }
+            }
+            if (matches.empty() && keepProbe)
+            {
+                appendRow(block, r, noRow);
+            }
+        }
+    });
+
+    // 外部結合では、どの行とも一致しなかった build 側の行を末尾に加える
+    ParallelFor(buildBlockCount, [&](size_t b) {
+        size_t begin = b * joinBlockRows;
+        size_t end = std::min(buildRows, begin + joinBlockRows);
+        CellBlock& block = blocks[probeBlockCount + b];
+        for (size_t r = begin; r < end; ++r)
+        {
+            if (!matched[r].load(std::memory_order_relaxed))
+            {
+                appendRow(block, noRow, r);
+            }
+        }
+    });
+
+    // 右表の列名が左表と重複する場合は区別できるよう名前を変える
+    std::vector<std::string> headers = left.GetHeaders();
+    for (const auto& name : right.GetHeaders())
+    {
+        bool duplicate = std::find(headers.begin(), headers.end(), name) != headers.end();
+        headers.push_back(duplicate ? name + "_右" : name);
+    }
+
+    output.Clear();
+    output.SetHeaders(headers);
+    output.SetCellBlocks(std::move(blocks), outputWidth);
+
+    if (stats)
+    {
+        stats->usedIndex = usedIndex;
+        stats->usedBloomFilter = useBloom;
+        stats->estimatedMatchRate = matchRate;
+        stats->bloomRejectedRows = 0;
+        for (size_t count : rejected)
+        {
+            stats->bloomRejectedRows += count;
+        }
+        stats->outputRows = output.GetRowCount();
+    }
+    return true;
+}
@@ -0,0 +1,30 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <string>
+
+// 結合の設定
+struct JoinSpec
+{
+    std::string leftColumn;
+    std::string rightColumn;
+    std::string type = "inner";    // "inner", "left", "right", "outer"
+    std::string bloomFilter = "auto"; // "auto"（見積もった一致率が低い場合のみ）, "always", "never"
+};
+
+// 結合の実行結果
+struct JoinStats
+{
+    bool usedIndex = false;        // 入力に作成済みのハッシュ索引を使ったか
+    bool usedBloomFilter = false;
+    double estimatedMatchRate = 0.0; // 走査側の標本のうち build 側に一致した割合
+    size_t bloomRejectedRows = 0;  // Bloom フィルターで索引を引かずに捨てた走査側の行数
+    size_t outputRows = 0;
+};
+
+// ハッシュ結合を行い、左表の列・右表の列の順に並べた表を output に書き込む
+// 右表（索引が左表にだけあれば左表）のハッシュ索引を引きながら、もう一方の表の行をブロックごとに並列に照合する。
+// 作成済みの索引が無ければ右表に一時的な索引を作る。キーは CellKey として比較し、空のセルはどの行とも一致しない。
+// 走査側の標本から一致率が低いと見積もった場合は、build 側のキーから Bloom フィルターを作り、
+// 一致し得ない行を索引の参照と出力行の組み立ての前に捨てる（準結合による削減）。
+bool JoinTables(const CSVData& left, const CSVData& right, const JoinSpec& spec, CSVData& output, JoinStats* stats = nullptr);
@@ -0,0 +1,343 @@
+﻿#include "LogFollower.h"
+#include "CSVData.h"
+#include "CompressedInput.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // 1 回に読む大きさ（起動時に既存の内容を読む間も UI へ少しずつ行を渡せるようにする）
+    const size_t kReadBlockSize = 4 << 20;
+
+    // 変更通知を待つ時間の上限（停止要求に応じる間隔）
+    const int kWaitMilliseconds = 200;
+    const int kPollingMilliseconds = 100;
+}
+
+LogFollower::LogFollower()
+    : stopping(false)
+    , truncated(false)
+    , parsedOffset(0)
+    , watchMethod(FollowWatchMethod::Polling)
+    , headersReady(false)
+    , headersDelivered(false)
+    , batchOffset(0)
+    , batchFieldOffset(0)
+    , readOffset(0)
+    , encoding(TextEncoding::Utf8)
+    , encodingDetected(false)
+    , headerParsed(false)
+{
+}
+
+LogFollower::~LogFollower()
+{
+    Stop();
+}
+
+bool LogFollower::Start(const std::string& newFilename)
+{
+    Stop();
+
+    // 圧縮ファイルは追記されたバイトを単独で伸長できないため扱わない
+    std::ifstream file(std::filesystem::path(newFilename), std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    char magic[4] = {};
+    file.read(magic, sizeof(magic));
+    if (DetectCompressionFormat(magic, static_cast<size_t>(file.gcount())) != CompressionFormat::None)
+    {
+        return false;
+    }
+
+    filename = newFilename;
+    truncated = false;
+    parsedOffset = 0;
+    headers.clear();
+    headersReady = false;
+    headersDelivered = false;
+    batches.clear();
+    batchOffset = 0;
+    batchFieldOffset = 0;
+    readOffset = 0;
+    pendingLine.clear();
+    encoding = TextEncoding::Utf8;
+    encodingDetected = false;
+    headerParsed = false;
+
+    worker = std::thread(&LogFollower::Run, this);
+    return true;
+}
+
+void LogFollower::Stop()
+{
+    if (worker.joinable())
+    {
+        stopping = true;
+        worker.join();
+        stopping = false;
+    }
+}
+
+size_t LogFollower::TakeRows(CSVData& data, size_t maxRows)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!headersDelivered)
+    {
+        if (!headersReady)
+        {
+            return 0;
+        }
+        data.SetHeaders(headers);
+        headersDelivered = true;
+    }
+
+    size_t taken = 0;
+    std::vector<std::string_view> row;
+    while (taken < maxRows && !batches.empty())
+    {
+        const RowBatch& batch = batches.front();
+        while (taken < maxRows && batchOffset < batch.fieldCounts.size())
+        {
+            row.clear();
+            for (uint32_t i = 0; i < batch.fieldCounts[batchOffset]; ++i, ++batchFieldOffset)
+            {
+                const uint32_t begin = batchFieldOffset > 0 ? batch.fieldEnds[batchFieldOffset - 1] : 0;
+                row.emplace_back(batch.bytes.data() + begin, batch.fieldEnds[batchFieldOffset] - begin);
+            }
+            data.AddRow(row);
+            ++batchOffset;
+            ++taken;
+        }
+        if (batchOffset == batch.fieldCounts.size())
+        {
+            batches.pop_front();
+            batchOffset = 0;
+            batchFieldOffset = 0;
+        }
+    }
+    return taken;
+}
+
+void LogFollower::Run()
+{
+#if defined(_WIN32)
+    // ReadDirectoryChangesW ほどの詳細は要らないため、ディレクトリ単位の変更通知で起こされたら大きさを調べる
+    const std::wstring directory = std::filesystem::absolute(std::filesystem::path(filename)).parent_path().wstring();
+    HANDLE change = FindFirstChangeNotificationW(directory.c_str(), FALSE,
+        FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME);
+    watchMethod = change != INVALID_HANDLE_VALUE ? FollowWatchMethod::ChangeNotification : FollowWatchMethod::Polling;
+#elif defined(__linux__)
+    const int notifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    const int watch = notifyFd >= 0
+        ? inotify_add_watch(notifyFd, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+        : -1;
+    watchMethod = watch >= 0 ? FollowWatchMethod::Inotify : FollowWatchMethod::Polling;
+#else
+    watchMethod = FollowWatchMethod::Polling;
+#endif
+
+    while (!stopping)
+    {
+        if (!ReadAppended())
+        {
+            truncated = true;
+            break;
+        }
+
+        // 次の変更を待つ。変更が続いている間は通知をまとめて受け取り、1 回の読み込みで追記分をすべて解析する
+#if defined(_WIN32)
+        if (change != INVALID_HANDLE_VALUE)
+        {
+            if (WaitForSingleObject(change, kWaitMilliseconds) == WAIT_OBJECT_0)
+            {
+                FindNextChangeNotification(change);
+            }
+            continue;
+        }
+#elif defined(__linux__)
+        if (watch >= 0)
+        {
+            pollfd descriptor = { notifyFd, POLLIN, 0 };
+            bool replaced = false;
+            if (poll(&descriptor, 1, kWaitMilliseconds) > 0)
+            {
+                alignas(inotify_event) char events[4096];
+                ssize_t length;
+                while ((length = read(notifyFd, events, sizeof(events))) > 0)
+                {
+                    for (ssize_t offset = 0; offset < length; )
+                    {
+                        const auto* event = reinterpret_cast<const inotify_event*>(events + offset);
+                        if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF))
+                        {
+                            replaced = true;
+                        }
+                        offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+                    }
+                }
+            }
+            if (replaced)
+            {
+                // ログのローテーションなどで別のファイルになった
+                truncated = true;
+                break;
+            }
+            continue;
+        }
+#endif
+        std::this_thread::sleep_for(std::chrono::milliseconds(kPollingMilliseconds));
+    }
+
+#if defined(_WIN32)
+    if (change != INVALID_HANDLE_VALUE)
+    {
+        FindCloseChangeNotification(change);
+    }
+#elif defined(__linux__)
+    if (notifyFd >= 0)
+    {
+        close(notifyFd);
+    }
+#endif
+}
+
+bool LogFollower::ReadAppended()
+{
+    std::error_code error;
+    const std::filesystem::path path(filename);
+    const uint64_t size = std::filesystem::file_size(path, error);
+    if (error || size < readOffset)
+    {
+        // 削除された、または切り詰められた
+        return false;
+    }
+    if (size == readOffset)
+    {
+        return true;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        return false;
+    }
+    file.seekg(static_cast<std::streamoff>(readOffset));
+
+    std::string buffer;
+    while (readOffset < size && !stopping)
+    {
+        // 前回の不完全な行の続きに追記分を読み足す
+        buffer.swap(pendingLine);
+        pendingLine.clear();
+        const size_t previous = buffer.size();
+        const size_t length = static_cast<size_t>(std::min<uint64_t>(kReadBlockSize, size - readOffset));
+        buffer.resize(previous + length);
+        file.read(&buffer[previous], static_cast<std::streamsize>(length));
+        const size_t received = static_cast<size_t>(file.gcount());
+        buffer.resize(previous + received);
+        readOffset += received;
+
+        const size_t lastNewline = buffer.rfind('\n');
+        if (!encodingDetected && lastNewline != std::string::npos)
+        {
+            // 最初の完全な行が揃った時点で文字コードを推定する
+            size_t bomLength = 0;
+            encoding = DetectTextEncoding(buffer.data(), buffer.size(), bomLength);
+            encodingDetected = true;
+            buffer.erase(0, bomLength);
+        }
+
+        if (lastNewline == std::string::npos)
+        {
+            pendingLine.swap(buffer);
+        }
+        else
+        {
+            const size_t complete = buffer.rfind('\n') + 1;
+            RowBatch batch;
+            ParseLines(buffer.data(), complete, batch);
+            pendingLine.assign(buffer, complete, std::string::npos);
+            if (!batch.fieldCounts.empty())
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                batches.push_back(std::move(batch));
+            }
+        }
+        parsedOffset = readOffset - pendingLine.size();
+
+        if (received < length)
+        {
+            break;
+        }
+    }
+    return true;
+}
+
+void LogFollower::ParseLines(const char* data, size_t size, RowBatch& batch)
+{
+    // 改行は CP932 の 2 バイト目にも現れないため、完全な行の塊をまとめて UTF-8 に変換できる
+    if (encoding == TextEncoding::Cp932)
+    {
+        converted.clear();
+        AppendCp932AsUtf8(converted, data, size);
+        data = converted.data();
+        size = converted.size();
+    }
+    else if (!IsValidUtf8(data, size))
+    {
+        converted.clear();
+        AppendSanitizedUtf8(converted, data, size);
+        data = converted.data();
+        size = converted.size();
+    }
+
+    batch.bytes.reserve(size);
+    const char* end = data + size;
+    for (const char* line = data; line < end; )
+    {
+        const char* newline = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+        const char* lineEnd = newline ? newline : end;
+        std::string_view text(line, static_cast<size_t>(lineEnd - line));
+        line = newline ? newline + 1 : end;
+        if (!text.empty() && text.back() == '\r')
+        {
+            text.remove_suffix(1);
+        }
+        if (text.empty())
+        {
+            continue;
+        }
+
+        CSVData::SplitCSVLine(text, fields, unescaped);
+        if (!headerParsed)
+        {
+            headerParsed = true;
+            std::lock_guard<std::mutex> lock(mutex);
+            headers.assign(fields.begin(), fields.end());
+            headersReady = true;
+            continue;
+        }
+
+        for (const auto& field : fields)
+        {
+            batch.bytes.append(field.data(), field.size());
+            batch.fieldEnds.push_back(static_cast<uint32_t>(batch.bytes.size()));
+        }
+        batch.fieldCounts.push_back(static_cast<uint32_t>(fields.size()));
+    }
+}
@@ -0,0 +1,92 @@
+﻿#pragma once
+
+#include "TextEncoding.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+class CSVData;
+
+// ファイルの変更を待つ方法
+enum class FollowWatchMethod
+{
+    Inotify,            // Linux の inotify
+    ChangeNotification, // Windows のディレクトリ変更通知
+    Polling             // 一定間隔でファイルの大きさを調べる
+};
+
+// 追記され続ける CSV ファイル（ログなど）を追いかけて読む
+// ワーカースレッドが変更を待ち、前回解析したバイト位置から末尾までの追記分だけを解析する。
+// 末尾の改行で終わっていない行は次の追記まで保留する。解析済みの行は TakeRows で UI スレッドの表へ移す。
+class LogFollower
+{
+public:
+    LogFollower();
+    ~LogFollower();
+
+    LogFollower(const LogFollower&) = delete;
+    LogFollower& operator=(const LogFollower&) = delete;
+
+    // ファイルの先頭から解析を始め、以後は追記を待つ（圧縮ファイルは扱わない）
+    bool Start(const std::string& filename);
+    void Stop();
+
+    // 解析済みの行を data の末尾に追加し、追加した行数を返す（最初の呼び出しではヘッダーも設定する）
+    // 1 回に移す行数は maxRows までに抑え、残りは次の呼び出しに回す。
+    size_t TakeRows(CSVData& data, size_t maxRows = 262144);
+
+    bool IsRunning() const { return worker.joinable(); }
+
+    // 解析済みのバイト数（保留中の不完全な行は含まない）
+    uint64_t GetParsedOffset() const { return parsedOffset.load(); }
+
+    // ファイルが切り詰められた・置き換えられた（読み直しが必要）
+    bool WasTruncated() const { return truncated.load(); }
+
+    FollowWatchMethod GetWatchMethod() const { return watchMethod.load(); }
+
+private:
+    // 1 回の読み込みで解析した行（フィールドを連結した文字列と各フィールドの終端位置）
+    struct RowBatch
+    {
+        std::string bytes;
+        std::vector<uint32_t> fieldEnds;
+        std::vector<uint32_t> fieldCounts;
+    };
+
+    std::string filename;
+    std::thread worker;
+    std::atomic<bool> stopping;
+    std::atomic<bool> truncated;
+    std::atomic<uint64_t> parsedOffset;
+    std::atomic<FollowWatchMethod> watchMethod;
+
+    // ワーカーから UI スレッドへの受け渡し
+    std::mutex mutex;
+    std::vector<std::string> headers;
+    bool headersReady;
+    bool headersDelivered;
+    std::deque<RowBatch> batches;
+    size_t batchOffset;                 // batches.front() のうち移し終えた行数
+    size_t batchFieldOffset;
+
+    // ワーカー専用の状態
+    uint64_t readOffset;
+    std::string pendingLine;            // 改行で終わっていない末尾（元の文字コードのまま）
+    std::string converted;
+    std::vector<std::string_view> fields;
+    std::string unescaped;
+    TextEncoding encoding;
+    bool encodingDetected;
+    bool headerParsed;
+
+    void Run();
+    bool ReadAppended();
+    void ParseLines(const char* data, size_t size, RowBatch& batch);
+};
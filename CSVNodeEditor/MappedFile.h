@@ -0,0 +1,33 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+
+// 読み取り専用のメモリマップトファイル
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    const char* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+    bool IsOpen() const { return opened; }
+
+private:
+    const char* data;
+    size_t size;
+    bool opened;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#else
+    int fileDescriptor;
+#endif
+};
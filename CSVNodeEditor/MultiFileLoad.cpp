@@ -0,0 +1,410 @@
+﻿#include "MultiFileLoad.h"
+#include "CompressedInput.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <unordered_map>
+
+namespace
+{
+    // 解析中の列の型（値の無い状態から広げていく）
+    enum ColumnKind : uint8_t
+    {
+        kindEmpty,
+        kindInteger,
+        kindReal,
+        kindText
+    };
+
+    // 1 ファイル分の解析結果
+    struct ParsedFile
+    {
+        std::vector<std::string> headers;
+        std::vector<uint8_t> kinds;
+        CellBlock block;
+        size_t rowCount = 0;
+        bool loaded = false;
+    };
+
+    bool HasWildcard(std::string_view text)
+    {
+        return text.find_first_of("*?") != std::string_view::npos;
+    }
+
+    bool IsCsvFileName(const std::string& name)
+    {
+        for (const char* extension : { ".csv", ".csv.gz", ".csv.zst" })
+        {
+            const size_t length = std::char_traits<char>::length(extension);
+            if (name.size() > length && name.compare(name.size() - length, length, extension) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    std::string StripCsvExtension(const std::string& name)
+    {
+        for (const char* extension : { ".csv.gz", ".csv.zst", ".csv" })
+        {
+            const size_t length = std::char_traits<char>::length(extension);
+            if (name.size() > length && name.compare(name.size() - length, length, extension) == 0)
+            {
+                return name.substr(0, name.size() - length);
+            }
+        }
+        return name;
+    }
+
+    // ワイルドカードで照合し、* と ? に一致した部分を captures に設定する（* はなるべく短く一致させる）
+    bool MatchWildcard(std::string_view pattern, std::string_view text, std::vector<std::string_view>& captures)
+    {
+        if (pattern.empty())
+        {
+            return text.empty();
+        }
+        if (pattern[0] == '*')
+        {
+            for (size_t length = 0; length <= text.size(); ++length)
+            {
+                captures.push_back(text.substr(0, length));
+                if (MatchWildcard(pattern.substr(1), text.substr(length), captures))
+                {
+                    return true;
+                }
+                captures.pop_back();
+            }
+            return false;
+        }
+        if (pattern[0] == '?')
+        {
+            // 連続する ? はまとめて 1 つの部分として取り出す
+            const size_t length = std::min(pattern.find_first_not_of('?'), pattern.size());
+            if (text.size() < length)
+            {
+                return false;
+            }
+            captures.push_back(text.substr(0, length));
+            if (MatchWildcard(pattern.substr(length), text.substr(length), captures))
+            {
+                return true;
+            }
+            captures.pop_back();
+            return false;
+        }
+        return !text.empty() && pattern[0] == text[0] && MatchWildcard(pattern.substr(1), text.substr(1), captures);
+    }
+
+    void WidenKind(uint8_t& kind, std::string_view value)
+    {
+        if (kind == kindText || value.empty())
+        {
+            return;
+        }
+        int64_t integer;
+        double number;
+        switch (ClassifyNumber(value, integer, number))
+        {
+        case NumberKind::Integer:
+            kind = std::max<uint8_t>(kind, kindInteger);
+            break;
+        case NumberKind::Real:
+            kind = std::max<uint8_t>(kind, kindReal);
+            break;
+        case NumberKind::NotNumber:
+            kind = kindText;
+            break;
+        }
+    }
+
+    // 1 ファイルを自身のアリーナに解析する（仮想列があれば各行の末尾に置く）
+    bool ParseFile(const std::string& filename, const std::string* virtualValue, ParsedFile& parsed)
+    {
+        LineReader file;
+        if (!file.Open(filename))
+        {
+            return false;
+        }
+
+        std::string line;
+        if (file.ReadRecord(line))
+        {
+            parsed.headers = CSVData::ParseCSVLine(line);
+        }
+        const size_t columnCount = parsed.headers.size();
+        parsed.kinds.assign(columnCount, kindEmpty);
+
+        // 仮想列の値はファイルごとに 1 度だけ格納し、全行で同じ参照を使う
+        const CellRef virtualRef = virtualValue ? parsed.block.arena.Append(*virtualValue) : CellRef();
+        std::vector<std::string_view> fields;
+        std::string unescaped;
+        while (file.ReadRecord(line))
+        {
+            if (line.empty())
+            {
+                continue;
+            }
+            CSVData::SplitCSVLine(line, fields, unescaped);
+            for (size_t c = 0; c < columnCount; ++c)
+            {
+                const std::string_view value = c < fields.size() ? fields[c] : std::string_view();
+                parsed.block.cells.push_back(parsed.block.Store(c, value));
+                WidenKind(parsed.kinds[c], value);
+            }
+            if (virtualValue)
+            {
+                parsed.block.cells.push_back(virtualRef);
+            }
+            ++parsed.rowCount;
+        }
+        return !file.HasError();
+    }
+}
+
+bool IsMultiFilePattern(const std::string& path)
+{
+    const std::filesystem::path filePath(path);
+    if (HasWildcard(filePath.filename().string()))
+    {
+        return true;
+    }
+    std::error_code error;
+    return !path.empty() && std::filesystem::is_directory(filePath, error);
+}
+
+bool ExpandFilePattern(const std::string& pattern, std::vector<std::string>& files, std::vector<std::string>* partitionValues)
+{
+    files.clear();
+    if (partitionValues)
+    {
+        partitionValues->clear();
+    }
+
+    const std::filesystem::path patternPath(pattern);
+    std::error_code error;
+    const bool isDirectory = !HasWildcard(patternPath.filename().string()) && std::filesystem::is_directory(patternPath, error);
+    const std::filesystem::path directory = isDirectory ? patternPath
+        : patternPath.has_parent_path() ? patternPath.parent_path() : std::filesystem::path(".");
+    const std::string namePattern = isDirectory ? std::string() : patternPath.filename().string();
+
+    std::vector<std::pair<std::string, std::string>> matches;
+    std::vector<std::string_view> captures;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (!it->is_regular_file(error))
+        {
+            continue;
+        }
+        const std::string name = it->path().filename().string();
+        std::string value;
+        if (isDirectory)
+        {
+            if (!IsCsvFileName(name))
+            {
+                continue;
+            }
+            value = StripCsvExtension(name);
+        }
+        else
+        {
+            captures.clear();
+            if (!MatchWildcard(namePattern, name, captures))
+            {
+                continue;
+            }
+            // ワイルドカードが複数あれば一致した部分を '-' でつなぐ
+            for (size_t i = 0; i < captures.size(); ++i)
+            {
+                value.append(i > 0 ? "-" : "").append(captures[i]);
+            }
+        }
+        matches.emplace_back(it->path().string(), std::move(value));
+    }
+    if (error)
+    {
+        return false;
+    }
+
+    std::sort(matches.begin(), matches.end());
+    for (auto& match : matches)
+    {
+        files.push_back(std::move(match.first));
+        if (partitionValues)
+        {
+            partitionValues->push_back(std::move(match.second));
+        }
+    }
+    return true;
+}
+
+bool LoadMultipleFiles(const std::string& pattern, const MultiFileOptions& options, CSVData& output, MultiFileLoadResult* result)
+{
+    MultiFileLoadResult localResult;
+    MultiFileLoadResult& stats = result ? *result : localResult;
+    stats = MultiFileLoadResult();
+
+    std::vector<std::string> files;
+    std::vector<std::string> partitionValues;
+    if (!ExpandFilePattern(pattern, files, &partitionValues) || files.empty())
+    {
+        return false;
+    }
+    stats.matchedFiles = files.size();
+
+    // 仮想列の値を決め、条件に一致しないファイルは解析する前に除外する
+    const bool hasVirtualColumn = options.virtualSource != VirtualColumnSource::None;
+    std::vector<std::string> virtualValues(files.size());
+    std::vector<CompiledPredicate> filters;
+    for (size_t i = 0; hasVirtualColumn && i < files.size(); ++i)
+    {
+        virtualValues[i] = options.virtualSource == VirtualColumnSource::FileName
+            ? std::filesystem::path(files[i]).filename().string() : partitionValues[i];
+    }
+    if (hasVirtualColumn)
+    {
+        const std::vector<std::string> virtualHeaders = { options.virtualColumn };
+        for (const auto& predicate : options.partitionFilters)
+        {
+            CompiledPredicate compiled;
+            if (predicate.column == options.virtualColumn && CompilePredicate(predicate, virtualHeaders, compiled))
+            {
+                filters.push_back(std::move(compiled));
+            }
+        }
+    }
+    std::vector<size_t> selected;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        bool keep = true;
+        for (const auto& filter : filters)
+        {
+            keep = keep && filter.Matches(virtualValues[i]);
+        }
+        if (keep)
+        {
+            selected.push_back(i);
+        }
+    }
+    stats.prunedFiles = files.size() - selected.size();
+
+    // ファイル単位で並列に解析する
+    std::vector<ParsedFile> parsed(selected.size());
+    ParallelFor(selected.size(), [&](size_t i) {
+        const size_t file = selected[i];
+        parsed[i].loaded = ParseFile(files[file], hasVirtualColumn ? &virtualValues[file] : nullptr, parsed[i]);
+    });
+
+    // 列名の和集合を初出順に作る（同じファイルに同名の列が複数あれば、出現順に別の列として扱う）
+    std::vector<std::string> headers;
+    std::vector<uint8_t> kinds;
+    std::unordered_map<std::string, std::vector<size_t>> columnsByName;
+    std::vector<std::vector<size_t>> mappings(parsed.size());
+    for (size_t i = 0; i < parsed.size(); ++i)
+    {
+        if (!parsed[i].loaded)
+        {
+            stats.failedFiles.push_back(files[selected[i]]);
+            continue;
+        }
+        stats.loadedFiles.push_back(files[selected[i]]);
+
+        std::unordered_map<std::string, size_t> occurrences;
+        for (size_t c = 0; c < parsed[i].headers.size(); ++c)
+        {
+            const std::string& name = parsed[i].headers[c];
+            auto& indices = columnsByName[name];
+            const size_t occurrence = occurrences[name]++;
+            if (occurrence == indices.size())
+            {
+                indices.push_back(headers.size());
+                headers.push_back(name);
+                kinds.push_back(kindEmpty);
+                stats.columns.emplace_back();
+                stats.columns.back().name = name;
+            }
+            const size_t column = indices[occurrence];
+            mappings[i].push_back(column);
+            kinds[column] = std::max(kinds[column], parsed[i].kinds[c]);
+            ++stats.columns[column].fileCount;
+        }
+    }
+    if (stats.loadedFiles.empty())
+    {
+        return false;
+    }
+    for (size_t c = 0; c < headers.size(); ++c)
+    {
+        stats.columns[c].type = kinds[c] == kindInteger ? ReconciledType::Integer
+            : kinds[c] == kindReal ? ReconciledType::Real : ReconciledType::Text;
+    }
+
+    const size_t virtualIndex = headers.size();
+    if (hasVirtualColumn)
+    {
+        headers.push_back(options.virtualColumn);
+        ReconciledColumn column;
+        column.name = options.virtualColumn;
+        column.fileCount = stats.loadedFiles.size();
+        stats.columns.push_back(column);
+    }
+    const size_t width = headers.size();
+
+    // 列の並びが統合後と同じファイルはそのまま、異なるファイルはセル参照を統合後の並びに置き直す
+    std::vector<uint8_t> remapped(parsed.size(), 0);
+    ParallelFor(parsed.size(), [&](size_t i) {
+        ParsedFile& file = parsed[i];
+        if (!file.loaded)
+        {
+            return;
+        }
+        const auto& mapping = mappings[i];
+        const size_t fileWidth = mapping.size() + (hasVirtualColumn ? 1 : 0);
+        bool identity = fileWidth == width;
+        for (size_t c = 0; identity && c < mapping.size(); ++c)
+        {
+            identity = mapping[c] == c;
+        }
+        if (identity)
+        {
+            return;
+        }
+
+        std::vector<CellRef> cells(file.rowCount * width);
+        for (size_t r = 0; r < file.rowCount; ++r)
+        {
+            const CellRef* source = file.block.cells.data() + r * fileWidth;
+            CellRef* destination = cells.data() + r * width;
+            for (size_t c = 0; c < mapping.size(); ++c)
+            {
+                destination[mapping[c]] = source[c];
+            }
+            if (hasVirtualColumn)
+            {
+                destination[virtualIndex] = source[mapping.size()];
+            }
+        }
+        file.block.cells.swap(cells);
+        remapped[i] = 1;
+    });
+    stats.remappedFiles = static_cast<size_t>(std::count(remapped.begin(), remapped.end(), 1));
+
+    std::vector<CellBlock> blocks;
+    blocks.reserve(parsed.size());
+    for (auto& file : parsed)
+    {
+        if (file.loaded)
+        {
+            blocks.push_back(std::move(file.block));
+        }
+    }
+
+    output.Clear();
+    output.SetHeaders(headers);
+    output.SetCellBlocks(std::move(blocks), width);
+    output.GetStatistics();
+    output.BuildZoneMap();
+    return true;
+}
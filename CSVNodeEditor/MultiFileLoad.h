@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include "Predicate.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// ファイルごとに付ける仮想列の値
+enum class VirtualColumnSource
+{
+    None,
+    FileName,           // ディレクトリを除いたファイル名
+    PartitionValue      // パターンのワイルドカードに一致した部分（ディレクトリ指定ならファイル名から拡張子を除いたもの）
+};
+
+// 複数ファイル読み込みの設定
+struct MultiFileOptions
+{
+    VirtualColumnSource virtualSource = VirtualColumnSource::None;
+    std::string virtualColumn = "_partition";
+    std::vector<ScanPredicate> partitionFilters;    // 仮想列に対する条件（一致しないファイルは解析しない）
+};
+
+// 統合した列の型（ファイルごとの型を 整数 → 実数 → 文字列 の順に広げる）
+enum class ReconciledType
+{
+    Integer,
+    Real,
+    Text
+};
+
+struct ReconciledColumn
+{
+    std::string name;
+    ReconciledType type = ReconciledType::Text;     // 値が 1 つも無い列は文字列とする
+    size_t fileCount = 0;                           // この列を持つファイルの数（他のファイルの行では空）
+};
+
+// 複数ファイル読み込みの結果
+struct MultiFileLoadResult
+{
+    size_t matchedFiles = 0;                        // パターンに一致したファイル数
+    size_t prunedFiles = 0;                         // 仮想列の条件で解析しなかったファイル数
+    size_t remappedFiles = 0;                       // 列の並びが統合後と異なり、セル参照を並べ替えたファイル数
+    std::vector<std::string> loadedFiles;
+    std::vector<std::string> failedFiles;
+    std::vector<ReconciledColumn> columns;
+};
+
+// ファイル名にワイルドカード（* ?）を含むか、ディレクトリを指すか
+bool IsMultiFilePattern(const std::string& path);
+
+// パターンに一致するファイルを名前順に列挙する
+// ワイルドカードは最後の要素（ファイル名）にだけ使える。ディレクトリを指定した場合は直下の
+// .csv / .csv.gz / .csv.zst をすべて対象にする。partitionValues にはファイルごとの仮想列の値（PartitionValue）を設定する。
+bool ExpandFilePattern(const std::string& pattern, std::vector<std::string>& files, std::vector<std::string>* partitionValues = nullptr);
+
+// パターンに一致する CSV ファイルを並列に解析し、列名で統合した 1 つの表にする
+// ファイルごとにアリーナを持たせて並列に解析し、列の和集合（初出順）に合わせて連結する。
+// 列の並びが統合後と同じファイルはセル参照をそのまま引き取り、文字列もセル参照も複写しない。
+// 各行はそのファイルの見出しの列数に揃える（足りない列は空、余分なフィールドは捨てる）。
+bool LoadMultipleFiles(const std::string& pattern, const MultiFileOptions& options, CSVData& output, MultiFileLoadResult* result = nullptr);
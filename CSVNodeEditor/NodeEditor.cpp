@@ -44,11 +44,21 @@ void NodeEditor::AddNode(std::unique_ptr<BaseNode> node)
 {
     if (node)
     {
+        nextNodeId = std::max(nextNodeId, node->GetID() + 1);
         nodeMap[node->GetID()] = node.get();
         nodes.push_back(std::move(node));
     }
 }
 
+void NodeEditor::RestoreNode(std::unique_ptr<BaseNode> node)
+{
+    if (node)
+    {
+        pendingPlacements.push_back(node->GetID());
+        AddNode(std::move(node));
+    }
+}
+
 void NodeEditor::RemoveNode(int nodeId)
 {
     auto it = std::find_if(nodes.begin(), nodes.end(),
@@ -67,10 +77,22 @@ void NodeEditor::Clear()
 {
     nodes.clear();
     nodeMap.clear();
+    pendingPlacements.clear();
 }
 
 void NodeEditor::RenderNodes()
 {
+    // 復元したノードをスナップショットの位置に置く
+    for (int nodeId : pendingPlacements)
+    {
+        auto it = nodeMap.find(nodeId);
+        if (it != nodeMap.end())
+        {
+            ImNodes::SetNodeGridSpacePos(nodeId, it->second->GetPosition());
+        }
+    }
+    pendingPlacements.clear();
+
     for (const auto& node : nodes)
     {
         // ノードの開始
@@ -86,6 +108,9 @@ void NodeEditor::RenderNodes()
 
         // ノードの終了
         ImNodes::EndNode();
+
+        // 保存用にキャンバス上の位置を控える
+        node->SetPosition(ImNodes::GetNodeGridSpacePos(node->GetID()));
     }
 }
 
@@ -120,6 +145,30 @@ void NodeEditor::HandleNodeCreation()
         {
             // 結合ノードを作成
         }
+        if (ImGui::MenuItem("SQL"))
+        {
+            // SQL ノードを作成
+        }
+        if (ImGui::MenuItem("ウィンドウ関数"))
+        {
+            // ウィンドウ関数ノードを作成
+        }
+        if (ImGui::MenuItem("ピボット"))
+        {
+            // ピボットノードを作成
+        }
+        if (ImGui::MenuItem("アンピボット"))
+        {
+            // アンピボットノードを作成
+        }
+        if (ImGui::MenuItem("サンプル"))
+        {
+            // サンプルノードを作成
+        }
+        if (ImGui::MenuItem("チャート"))
+        {
+            // チャートノードを作成
+        }
         if (ImGui::MenuItem("CSV出力"))
         {
             // 出力ノードを作成
@@ -8,6 +8,9 @@
 #include <unordered_map>
 #include <string>
 
+class BinaryWriter;
+class BinaryReader;
+
 // ノードの基本クラス
 class BaseNode
 {
@@ -17,11 +20,16 @@ public:
 
     virtual void Render() = 0;
     virtual void Process() = 0;
-    virtual void SaveState() = 0;
-    virtual void LoadState() = 0;
+
+    // ノードの設定を書き出す・読み戻す（ワークスペースのスナップショットに使う）
+    // 処理結果のデータは含めない。LoadState は形式が不正なら false を返す。
+    virtual void SaveState(BinaryWriter& writer) const = 0;
+    virtual bool LoadState(BinaryReader& reader) = 0;
 
     int GetID() const { return nodeId; }
     const std::string& GetName() const { return nodeName; }
+    const ImVec2& GetPosition() const { return position; }
+    void SetPosition(const ImVec2& newPosition) { position = newPosition; }
 
 protected:
     int nodeId;
@@ -42,9 +50,15 @@ public:
     void RemoveNode(int nodeId);
     void Clear();
 
+    const std::vector<std::unique_ptr<BaseNode>>& GetNodes() const { return nodes; }
+
+    // 復元したノードを追加し、次の描画でキャンバス上の位置を反映する
+    void RestoreNode(std::unique_ptr<BaseNode> node);
+
 private:
     std::vector<std::unique_ptr<BaseNode>> nodes;
     std::unordered_map<int, BaseNode*> nodeMap;
+    std::vector<int> pendingPlacements;
     int nextNodeId;
 
     void RenderNodes();
@@ -1,18 +1,103 @@
 ﻿#include "NodeTypes.h"
 #include "imgui.h"
 #include "imnodes.h"
+#include "implot.h"
+#include "NumberParser.h"
+#include "BinaryIO.h"
 #include <imgui.h>
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+namespace
+{
+    // ノード設定の直列化ヘルパー
+    void WriteFlag(BinaryWriter& writer, bool value)
+    {
+        writer.Write(static_cast<uint8_t>(value ? 1 : 0));
+    }
+
+    bool ReadFlag(BinaryReader& reader, bool& value)
+    {
+        uint8_t stored = 0;
+        if (!reader.Read(stored))
+        {
+            return false;
+        }
+        value = stored != 0;
+        return true;
+    }
+
+    bool ReadSize(BinaryReader& reader, size_t& value)
+    {
+        uint64_t stored = 0;
+        if (!reader.Read(stored))
+        {
+            return false;
+        }
+        value = static_cast<size_t>(stored);
+        return true;
+    }
+
+    void WriteStringList(BinaryWriter& writer, const std::vector<std::string>& values)
+    {
+        writer.Write(static_cast<uint32_t>(values.size()));
+        for (const auto& value : values)
+        {
+            writer.WriteString(value);
+        }
+    }
+
+    bool ReadStringList(BinaryReader& reader, std::vector<std::string>& values)
+    {
+        uint32_t count = 0;
+        if (!reader.Read(count) || count > reader.GetRemaining() / sizeof(uint32_t))
+        {
+            return false;
+        }
+        values.resize(count);
+        for (auto& value : values)
+        {
+            if (!reader.ReadString(value))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void WriteSampleSpec(BinaryWriter& writer, const SampleSpec& spec)
+    {
+        writer.Write(static_cast<uint64_t>(spec.sampleSize));
+        writer.Write(spec.seed);
+        writer.WriteString(spec.stratifyColumn);
+        WriteFlag(writer, spec.perStratum);
+    }
+
+    bool ReadSampleSpec(BinaryReader& reader, SampleSpec& spec)
+    {
+        return ReadSize(reader, spec.sampleSize) && reader.Read(spec.seed)
+            && reader.ReadString(spec.stratifyColumn) && ReadFlag(reader, spec.perStratum);
+    }
+}
 
 // CSV読み込みノード
 CSVLoadNode::CSVLoadNode(int id)
     : BaseNode(id, "CSV読み込み")
     , fileLoaded(false)
+    , sampleOnLoad(false)
+    , useCache(true)
+    , lastCacheResult(CacheLoadResult::Missing)
+    , followMode(false)
 {
     outputData = std::make_shared<CSVData>();
 }
 
 void CSVLoadNode::Render()
 {
+    // 追従中なら解析済みの追記分を取り込む
+    PollFollower();
+    
     // 入力ピン（なし）
     
     // 出力ピン
@@ -28,10 +113,63 @@ void CSVLoadNode::Render()
         filePath = filePathBuffer;
     }
     
+    // 複数ファイル（ワイルドカード・ディレクトリ指定）の仮想列設定
+    if (IsMultiFilePattern(filePath))
+    {
+        const char* sources[] = { "なし", "ファイル名", "パーティション値" };
+        const int current = static_cast<int>(multiFileOptions.virtualSource);
+        if (ImGui::BeginCombo("仮想列", sources[current]))
+        {
+            for (int i = 0; i < 3; ++i)
+            {
+                if (ImGui::Selectable(sources[i], current == i))
+                {
+                    multiFileOptions.virtualSource = static_cast<VirtualColumnSource>(i);
+                }
+            }
+            ImGui::EndCombo();
+        }
+        if (multiFileOptions.virtualSource != VirtualColumnSource::None)
+        {
+            static char virtualColumnBuffer[128] = "_partition";
+            if (ImGui::InputText("仮想列名", virtualColumnBuffer, sizeof(virtualColumnBuffer)))
+            {
+                multiFileOptions.virtualColumn = virtualColumnBuffer;
+            }
+        }
+    }
+    
+    // バイナリキャッシュ設定
+    ImGui::Checkbox("バイナリキャッシュを使用", &useCache);
+    
+    // 追従モード設定（ログのように追記され続けるファイルを読み込み後も監視する）
+    ImGui::Checkbox("追記を追従", &followMode);
+    
+    // サンプリング読み込み設定
+    ImGui::Checkbox("サンプリング読み込み", &sampleOnLoad);
+    if (sampleOnLoad)
+    {
+        int sampleSize = static_cast<int>(sampleSpec.sampleSize);
+        if (ImGui::InputInt("標本サイズ", &sampleSize) && sampleSize > 0)
+        {
+            sampleSpec.sampleSize = static_cast<size_t>(sampleSize);
+        }
+        int seed = static_cast<int>(sampleSpec.seed);
+        if (ImGui::InputInt("シード", &seed))
+        {
+            sampleSpec.seed = static_cast<uint64_t>(seed);
+        }
+        static char stratifyColumnBuffer[128] = "";
+        if (ImGui::InputText("層別列", stratifyColumnBuffer, sizeof(stratifyColumnBuffer)))
+        {
+            sampleSpec.stratifyColumn = stratifyColumnBuffer;
+        }
+    }
+    
     // ファイル読み込みボタン
     if (ImGui::Button("ファイルを読み込み"))
     {
-        if (outputData->LoadFromFile(filePath))
+        if (LoadData())
         {
             fileLoaded = true;
         }
@@ -43,6 +181,48 @@ void CSVLoadNode::Render()
         ImGui::TextColored(ImVec4(0, 1, 0, 1), "? 読み込み完了");
         ImGui::Text("行数: %zu", outputData->GetRowCount());
         ImGui::Text("列数: %zu", outputData->GetColumnCount());
+        if (follower)
+        {
+            const char* method = follower->GetWatchMethod() == FollowWatchMethod::Inotify ? "inotify"
+                : follower->GetWatchMethod() == FollowWatchMethod::ChangeNotification ? "変更通知" : "ポーリング";
+            ImGui::Text("追従中: %llu バイトまで解析（%s）", static_cast<unsigned long long>(follower->GetParsedOffset()), method);
+        }
+        else if (IsMultiFilePattern(filePath))
+        {
+            ImGui::Text("ファイル: %zu 件を読み込み（%zu 件を条件で除外）",
+                lastMultiFileResult.loadedFiles.size(), lastMultiFileResult.prunedFiles);
+            if (!lastMultiFileResult.failedFiles.empty())
+            {
+                ImGui::TextColored(ImVec4(1, 0.5f, 0, 1), "読み込めないファイル: %zu 件", lastMultiFileResult.failedFiles.size());
+            }
+            if (ImGui::TreeNode("統合した列"))
+            {
+                const char* typeNames[] = { "整数", "実数", "文字列" };
+                for (const auto& column : lastMultiFileResult.columns)
+                {
+                    ImGui::Text("%s: %s（%zu / %zu ファイル）", column.name.c_str(), typeNames[static_cast<int>(column.type)],
+                        column.fileCount, lastMultiFileResult.loadedFiles.size());
+                }
+                ImGui::TreePop();
+            }
+        }
+        else if (IsColumnarFilePath(filePath))
+        {
+            ImGui::Text("行グループ: %zu 中 %zu を読み飛ばし", lastScanStats.rowGroupCount, lastScanStats.skippedRowGroups);
+        }
+        else if (useCache && !sampleOnLoad)
+        {
+            bool writing = cacheWriteTask.valid()
+                && cacheWriteTask.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+            if (lastCacheResult == CacheLoadResult::Loaded)
+            {
+                ImGui::Text("キャッシュから読み込み");
+            }
+            else if (writing)
+            {
+                ImGui::Text("キャッシュを作成中...");
+            }
+        }
     }
     else
     {
@@ -55,18 +235,195 @@ void CSVLoadNode::Process()
     // ファイルが読み込まれていない場合は読み込みを実行
     if (!fileLoaded && !filePath.empty())
     {
-        fileLoaded = outputData->LoadFromFile(filePath);
+        fileLoaded = LoadData();
+    }
+}
+
+void CSVLoadNode::SetSamplePushdown(const SampleSpec& spec)
+{
+    sampleSpec = spec;
+    sampleOnLoad = true;
+    fileLoaded = false;
+}
+
+void CSVLoadNode::SetFilterPushdown(const ScanPredicate& predicate)
+{
+    pushedPredicates.assign(1, predicate);
+    fileLoaded = false;
+}
+
+bool CSVLoadNode::LoadData()
+{
+    // 追従モードでは追記を待つワーカーが先頭から解析し、以後は追記分だけを解析する
+    const bool multipleFiles = IsMultiFilePattern(filePath);
+    if (followMode && !multipleFiles && !IsColumnarFilePath(filePath) && !IsArrowFilePath(filePath))
+    {
+        return StartFollowing();
+    }
+    follower.reset();
+    
+    // ワイルドカード・ディレクトリ指定は一致するファイルを並列に解析して 1 つの表にする
+    if (multipleFiles)
+    {
+        return LoadMultipleFiles();
+    }
+    
+    // 列指向ファイルは統計で除外できる行グループを復号せずに読み込む
+    if (IsColumnarFilePath(filePath))
+    {
+        return ReadColumnarFile(filePath, pushedPredicates, *outputData, &lastScanStats);
+    }
+    
+    // Arrow IPC は列バッファをそのまま取り込み、テキスト解析を行わない
+    if (IsArrowFilePath(filePath))
+    {
+        ArrowTable table;
+        if (!ReadArrowIpc(filePath, table))
+        {
+            return false;
+        }
+        ArrowTableToCSVData(table, *outputData);
+        return true;
+    }
+    
+    // サンプリング時は採用されない行の解析を省略する
+    if (sampleOnLoad)
+    {
+        return LoadSampledFile(filePath, sampleSpec, *outputData);
+    }
+    
+    if (!useCache)
+    {
+        return outputData->LoadFromFile(filePath);
+    }
+    
+    // 有効なキャッシュがあれば解析せずに復元する
+    SourceFingerprint fingerprint;
+    if (!ComputeSourceFingerprint(filePath, fingerprint))
+    {
+        return false;
+    }
+    
+    // バックグラウンドで書き出し中のテーブルは変更しないよう、新しいテーブルに読み込む
+    auto loaded = std::make_shared<CSVData>();
+    lastCacheResult = LoadColumnarCache(filePath, fingerprint, *loaded);
+    if (lastCacheResult != CacheLoadResult::Loaded)
+    {
+        if (!loaded->LoadFromFile(filePath))
+        {
+            return false;
+        }
+        
+        // キャッシュが無い・古い場合はバックグラウンドで作り直す
+        cacheWriteTask = WriteColumnarCacheAsync(filePath, fingerprint, loaded);
+    }
+    
+    outputData = loaded;
+    return true;
+}
+
+bool CSVLoadNode::LoadMultipleFiles()
+{
+    // 仮想列に対する押し下げ条件は、該当しないファイルを解析せずに除外するために使う
+    MultiFileOptions options = multiFileOptions;
+    for (const auto& predicate : pushedPredicates)
+    {
+        if (predicate.column == options.virtualColumn)
+        {
+            options.partitionFilters.push_back(predicate);
+        }
+    }
+    
+    // バックグラウンドで書き出し中のテーブルは変更しないよう、新しいテーブルに読み込む
+    auto loaded = std::make_shared<CSVData>();
+    if (!::LoadMultipleFiles(filePath, options, *loaded, &lastMultiFileResult))
+    {
+        return false;
+    }
+    outputData = loaded;
+    return true;
+}
+
+bool CSVLoadNode::StartFollowing()
+{
+    auto newFollower = std::make_unique<LogFollower>();
+    if (!newFollower->Start(filePath))
+    {
+        return false;
+    }
+    
+    // 下流が前回の表の行数を基準に差分を処理しないよう、新しいテーブルに読み込む
+    follower = std::move(newFollower);
+    outputData = std::make_shared<CSVData>();
+    return true;
+}
+
+void CSVLoadNode::PollFollower()
+{
+    if (!follower)
+    {
+        return;
+    }
+    if (!followMode)
+    {
+        follower.reset();
+        return;
     }
+    
+    // 切り詰められた・置き換えられたファイルは先頭から読み直す（開けなければ次のフレームで再試行する）
+    if (follower->WasTruncated())
+    {
+        StartFollowing();
+        return;
+    }
+    
+    // 1 フレームで取り込む行数には上限があり、残りは次のフレームに回るため UI は止まらない
+    follower->TakeRows(*outputData);
 }
 
-void CSVLoadNode::SaveState()
+void CSVLoadNode::SaveState(BinaryWriter& writer) const
 {
-    // 状態保存処理をここに実装
+    writer.WriteString(filePath);
+    WriteFlag(writer, useCache);
+    WriteFlag(writer, followMode);
+    WriteFlag(writer, sampleOnLoad);
+    WriteSampleSpec(writer, sampleSpec);
+    writer.Write(static_cast<uint8_t>(multiFileOptions.virtualSource));
+    writer.WriteString(multiFileOptions.virtualColumn);
+    writer.Write(static_cast<uint32_t>(multiFileOptions.partitionFilters.size()));
+    for (const auto& filter : multiFileOptions.partitionFilters)
+    {
+        writer.WriteString(filter.column);
+        writer.WriteString(filter.op);
+        writer.WriteString(filter.value);
+    }
 }
 
-void CSVLoadNode::LoadState()
+bool CSVLoadNode::LoadState(BinaryReader& reader)
 {
-    // 状態読み込み処理をここに実装
+    uint8_t virtualSource = 0;
+    uint32_t filterCount = 0;
+    if (!reader.ReadString(filePath) || !ReadFlag(reader, useCache) || !ReadFlag(reader, followMode)
+        || !ReadFlag(reader, sampleOnLoad) || !ReadSampleSpec(reader, sampleSpec)
+        || !reader.Read(virtualSource) || virtualSource > static_cast<uint8_t>(VirtualColumnSource::PartitionValue)
+        || !reader.ReadString(multiFileOptions.virtualColumn) || !reader.Read(filterCount)
+        || filterCount > reader.GetRemaining() / (3 * sizeof(uint32_t)))
+    {
+        return false;
+    }
+    multiFileOptions.virtualSource = static_cast<VirtualColumnSource>(virtualSource);
+    multiFileOptions.partitionFilters.resize(filterCount);
+    for (auto& filter : multiFileOptions.partitionFilters)
+    {
+        if (!reader.ReadString(filter.column) || !reader.ReadString(filter.op) || !reader.ReadString(filter.value))
+        {
+            return false;
+        }
+    }
+
+    // 読み込み結果は保存しない（ファイルの読み込みは利用者の操作で行う）
+    fileLoaded = false;
+    return true;
 }
 
 // フィルターノード
@@ -78,8 +435,20 @@ FilterNode::FilterNode(int id)
     outputData = std::make_shared<CSVData>();
 }
 
+void FilterNode::SetInputData(std::shared_ptr<CSVData> data)
+{
+    // 別の表に差し替えた場合は識別番号が変わるため、次の Process で全行を処理し直す
+    inputData = std::move(data);
+}
+
 void FilterNode::Render()
 {
+    // 入力の末尾に行が追加されただけなら、追加分を自動的に反映する
+    if (inputData && cursor.HasPendingRows(*inputData, GetSettingsKey()))
+    {
+        Process();
+    }
+    
     // 入力ピン
     ImNodes::BeginInputAttribute(nodeId * 100 + 1);
     ImGui::Text("入力");
@@ -127,10 +496,27 @@ void FilterNode::Render()
         Process();
     }
     
+    // 同じ列を繰り返し絞り込む場合は索引を作成しておく（入力が変更されるまで再利用される）
+    ImGui::SameLine();
+    if (ImGui::Button("索引作成"))
+    {
+        int column = inputData->GetColumnIndex(filterColumn);
+        if (column >= 0)
+        {
+            inputData->BuildHashIndex(static_cast<size_t>(column));
+            inputData->BuildSortedIndex(static_cast<size_t>(column));
+        }
+    }
+    
     // 結果表示
     if (!outputData->GetRows().empty())
     {
-        ImGui::Text("フィルター結果: %zu 行", outputData->GetRowCount());
+        ImGui::Text("フィルター結果: %zu 行%s", outputData->GetRowCount(), lastSelectStats.usedIndex ? "（索引を使用）" : "");
+    }
+    if (lastSelectStats.blockCount > 0)
+    {
+        ImGui::Text("ブロック読み飛ばし: %zu / %zu（%.1f%%）", lastSelectStats.skippedBlocks, lastSelectStats.blockCount,
+            lastSelectStats.GetSkipRatio() * 100.0);
     }
 }
 
@@ -138,27 +524,60 @@ void FilterNode::Process()
 {
     if (inputData && !filterColumn.empty() && !filterValue.empty())
     {
-        // フィルター処理を実装
-        auto filteredRows = inputData->FilterRows(filterColumn, filterValue);
+        ScanPredicate predicate;
+        predicate.column = filterColumn;
+        predicate.op = filterOperator;
+        predicate.value = filterValue;
+        
+        CompiledPredicate compiled;
+        if (!CompilePredicate(predicate, inputData->GetHeaders(), compiled))
+        {
+            outputData->Clear();
+            cursor.Reset();
+            return;
+        }
         
-        // 結果を出力データに設定
-        outputData->Clear();
-        outputData->AddRow(inputData->GetHeaders()); // ヘッダーを追加
-        for (const auto& row : filteredRows)
+        const std::string settings = GetSettingsKey();
+        if (cursor.CanApplyDelta(*inputData, settings))
+        {
+            // 前回以降に追加された行だけを評価し、一致した行を出力の末尾に加える
+            // 出力への変更も行の追加だけになるため、下流のノードも差分だけを処理できる
+            const size_t column = static_cast<size_t>(compiled.columnIndex);
+            const auto rows = inputData->GetRows();
+            for (size_t r = cursor.processedRows; r < rows.size(); ++r)
+            {
+                if (compiled.Matches(inputData->GetCell(r, column)))
+                {
+                    outputData->AddRow(rows[r]);
+                }
+            }
+        }
+        else
         {
-            outputData->AddRow(row);
+            // 索引があれば一致する行だけを引き、無ければゾーンマップで絞ったブロックだけを走査する
+            // セル文字列は入力と共有したまま出力する
+            auto rows = SelectRows(*inputData, compiled, &lastSelectStats);
+            outputData->SetSelectedRows(*inputData, rows);
         }
+        cursor.MarkProcessed(*inputData, settings);
     }
 }
 
-void FilterNode::SaveState()
+std::string FilterNode::GetSettingsKey() const
+{
+    return filterColumn + '\x1f' + filterOperator + '\x1f' + filterValue;
+}
+
+void FilterNode::SaveState(BinaryWriter& writer) const
 {
-    // 状態保存処理をここに実装
+    writer.WriteString(filterColumn);
+    writer.WriteString(filterOperator);
+    writer.WriteString(filterValue);
 }
 
-void FilterNode::LoadState()
+bool FilterNode::LoadState(BinaryReader& reader)
 {
-    // 状態読み込み処理をここに実装
+    return reader.ReadString(filterColumn) && reader.ReadString(filterOperator) && reader.ReadString(filterValue);
 }
 
 // ソートノード
@@ -200,6 +619,17 @@ void SortNode::Render()
     {
         Process();
     }
+    
+    // 整列済み索引があれば、ソートは索引の順列で行を並べ替えるだけになる
+    ImGui::SameLine();
+    if (ImGui::Button("索引作成"))
+    {
+        int column = inputData->GetColumnIndex(sortColumn);
+        if (column >= 0)
+        {
+            inputData->BuildSortedIndex(static_cast<size_t>(column));
+        }
+    }
 }
 
 void SortNode::Process()
@@ -212,14 +642,15 @@ void SortNode::Process()
     }
 }
 
-void SortNode::SaveState()
+void SortNode::SaveState(BinaryWriter& writer) const
 {
-    // 状態保存処理をここに実装
+    writer.WriteString(sortColumn);
+    WriteFlag(writer, ascending);
 }
 
-void SortNode::LoadState()
+bool SortNode::LoadState(BinaryReader& reader)
 {
-    // 状態読み込み処理をここに実装
+    return reader.ReadString(sortColumn) && ReadFlag(reader, ascending);
 }
 
 // 集計ノード
@@ -231,8 +662,20 @@ AggregateNode::AggregateNode(int id)
     outputData = std::make_shared<CSVData>();
 }
 
+void AggregateNode::SetInputData(std::shared_ptr<CSVData> data)
+{
+    // 別の表に差し替えた場合は識別番号が変わるため、次の Process で集計をやり直す
+    inputData = std::move(data);
+}
+
 void AggregateNode::Render()
 {
+    // 入力の末尾に行が追加されただけなら、追加分を集計に畳み込む
+    if (inputData && cursor.HasPendingRows(*inputData, GetSettingsKey()))
+    {
+        Process();
+    }
+    
     // 入力ピン
     ImNodes::BeginInputAttribute(nodeId * 100 + 1);
     ImGui::Text("入力");
@@ -279,35 +722,61 @@ void AggregateNode::Render()
     {
         Process();
     }
+    
+    // 結果表示
+    if (aggregator.GetGroupCount() > 0)
+    {
+        ImGui::Text("集計結果: %zu グループ（%zu 行を集計）", aggregator.GetGroupCount(), aggregator.GetRowCount());
+    }
 }
 
 void AggregateNode::Process()
 {
-    if (inputData && !groupColumn.empty() && !aggregateColumn.empty())
+    if (inputData && !groupColumn.empty() && (!aggregateColumn.empty() || aggregateFunction == "count"))
     {
-        // 集計処理を実装
-        // 簡易実装のため、基本的な集計のみ
-        if (aggregateFunction == "sum")
+        const std::string settings = GetSettingsKey();
+        const size_t rowCount = inputData->GetRowCount();
+        if (cursor.CanApplyDelta(*inputData, settings))
         {
-            double sum = inputData->GetColumnSum(aggregateColumn);
-            // 結果を出力データに設定
+            // 前回以降に追加された行だけを畳み込む
+            aggregator.Add(*inputData, cursor.processedRows, rowCount);
         }
-        else if (aggregateFunction == "average")
+        else
         {
-            double avg = inputData->GetColumnAverage(aggregateColumn);
-            // 結果を出力データに設定
+            AggregateSpec spec;
+            spec.groupColumn = groupColumn;
+            spec.valueColumn = aggregateColumn;
+            spec.function = aggregateFunction;
+            if (!aggregator.Reset(spec, inputData->GetHeaders()))
+            {
+                outputData->Clear();
+                cursor.Reset();
+                return;
+            }
+            aggregator.Add(*inputData, 0, rowCount);
         }
+        
+        // 出力はグループ数の行だけなので、毎回書き直す
+        aggregator.WriteTo(*outputData);
+        cursor.MarkProcessed(*inputData, settings);
     }
 }
 
-void AggregateNode::SaveState()
+std::string AggregateNode::GetSettingsKey() const
 {
-    // 状態保存処理をここに実装
+    return groupColumn + '\x1f' + aggregateColumn + '\x1f' + aggregateFunction;
 }
 
-void AggregateNode::LoadState()
+void AggregateNode::SaveState(BinaryWriter& writer) const
 {
-    // 状態読み込み処理をここに実装
+    writer.WriteString(groupColumn);
+    writer.WriteString(aggregateColumn);
+    writer.WriteString(aggregateFunction);
+}
+
+bool AggregateNode::LoadState(BinaryReader& reader)
+{
+    return reader.ReadString(groupColumn) && reader.ReadString(aggregateColumn) && reader.ReadString(aggregateFunction);
 }
 
 // 結合ノード
@@ -373,78 +842,827 @@ void JoinNode::Render()
     {
         Process();
     }
+    
+    // 右表の結合列にハッシュ索引を作成しておくと、結合のたびに作り直さずに済む
+    ImGui::SameLine();
+    if (ImGui::Button("索引作成"))
+    {
+        int column = rightInputData->GetColumnIndex(rightJoinColumn);
+        if (column >= 0)
+        {
+            rightInputData->BuildHashIndex(static_cast<size_t>(column));
+        }
+    }
+    
+    // 結果表示
+    if (!outputData->GetRows().empty())
+    {
+        ImGui::Text("結合結果: %zu 行%s", lastJoinStats.outputRows, lastJoinStats.usedIndex ? "（索引を使用）" : "");
+    }
+    if (lastJoinStats.usedBloomFilter)
+    {
+        ImGui::Text("Bloom フィルター: %zu 行を除外（推定一致率 %.1f%%）", lastJoinStats.bloomRejectedRows,
+            lastJoinStats.estimatedMatchRate * 100.0);
+    }
 }
 
 void JoinNode::Process()
 {
     if (leftInputData && rightInputData && !leftJoinColumn.empty() && !rightJoinColumn.empty())
     {
-        // 結合処理を実装
-        // 簡易実装のため、基本的な結合のみ
+        JoinSpec spec;
+        spec.leftColumn = leftJoinColumn;
+        spec.rightColumn = rightJoinColumn;
+        spec.type = joinType;
+        JoinTables(*leftInputData, *rightInputData, spec, *outputData, &lastJoinStats);
     }
 }
 
-void JoinNode::SaveState()
+void JoinNode::SaveState(BinaryWriter& writer) const
 {
-    // 状態保存処理をここに実装
+    writer.WriteString(leftJoinColumn);
+    writer.WriteString(rightJoinColumn);
+    writer.WriteString(joinType);
 }
 
-void JoinNode::LoadState()
+bool JoinNode::LoadState(BinaryReader& reader)
 {
-    // 状態読み込み処理をここに実装
+    return reader.ReadString(leftJoinColumn) && reader.ReadString(rightJoinColumn) && reader.ReadString(joinType);
 }
 
-// 出力ノード
-OutputNode::OutputNode(int id)
-    : BaseNode(id, "CSV出力")
+// SQL ノード
+SqlNode::SqlNode(int id)
+    : BaseNode(id, "SQL")
+    , query("SELECT * FROM t1")
 {
-    inputData = std::make_shared<CSVData>();
+    inputTables.emplace_back("t1", std::make_shared<CSVData>());
+    outputData = std::make_shared<CSVData>();
 }
 
-void OutputNode::Render()
+void SqlNode::SetInputTable(const std::string& name, std::shared_ptr<CSVData> data)
 {
-    // 入力ピン
-    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
-    ImGui::Text("入力");
-    ImNodes::EndInputAttribute();
+    for (auto& table : inputTables)
+    {
+        if (table.first == name)
+        {
+            table.second = std::move(data);
+            return;
+        }
+    }
+    inputTables.emplace_back(name, std::move(data));
+}
+
+void SqlNode::Render()
+{
+    // 入力ピン（表ごと）
+    for (size_t i = 0; i < inputTables.size(); ++i)
+    {
+        ImNodes::BeginInputAttribute(nodeId * 100 + 2 + static_cast<int>(i));
+        ImGui::Text("入力: %s", inputTables[i].first.c_str());
+        ImNodes::EndInputAttribute();
+    }
     
-    // 出力設定
-    ImGui::Text("出力設定:");
+    // 出力ピン
+    ImNodes::BeginOutputAttribute(nodeId * 100 + 1);
+    ImGui::Text("出力");
+    ImNodes::EndOutputAttribute();
     
-    // 出力パス
-    static char outputPathBuffer[256] = "";
-    if (ImGui::InputText("出力パス", outputPathBuffer, sizeof(outputPathBuffer)))
+    // 問い合わせ
+    static char queryBuffer[4096] = "";
+    if (ImGui::InputTextMultiline("SQL", queryBuffer, sizeof(queryBuffer), ImVec2(320, 96)))
     {
-        outputPath = outputPathBuffer;
+        query = queryBuffer;
     }
     
-    // 保存ボタン
-    if (ImGui::Button("CSV保存"))
+    if (ImGui::Button("実行"))
     {
         Process();
     }
     
-    // 状態表示
-    if (!inputData->GetRows().empty())
+    // 結果表示
+    if (!lastError.empty())
     {
-        ImGui::Text("保存対象: %zu 行", inputData->GetRowCount());
+        ImGui::TextColored(ImVec4(1, 0, 0, 1), "%s", lastError.c_str());
+    }
+    else if (!lastStats.plan.empty())
+    {
+        ImGui::Text("結果: %zu 行", lastStats.outputRows);
+        if (ImGui::TreeNode("実行計画"))
+        {
+            for (const std::string& line : lastStats.plan)
+            {
+                ImGui::TextUnformatted(line.c_str());
+            }
+            ImGui::TreePop();
+        }
     }
 }
 
-void OutputNode::Process()
+void SqlNode::Process()
 {
-    if (inputData && !outputPath.empty())
+    std::vector<SqlTable> tables;
+    for (const auto& table : inputTables)
+    {
+        if (table.second)
+        {
+            tables.push_back({ table.first, table.second.get() });
+        }
+    }
+    lastStats = SqlQueryStats();
+    if (!ExecuteSqlQuery(query, tables, *outputData, lastError, &lastStats))
     {
-        inputData->SaveToFile(outputPath);
+        lastStats = SqlQueryStats();
+        return;
     }
+    lastError.clear();
+}
+
+void SqlNode::SaveState(BinaryWriter& writer) const
+{
+    std::vector<std::string> names;
+    for (const auto& table : inputTables)
+    {
+        names.push_back(table.first);
+    }
+    writer.WriteString(query);
+    WriteStringList(writer, names);
+}
+
+bool SqlNode::LoadState(BinaryReader& reader)
+{
+    // 表の内容は復元しない（名前だけを戻し、入力は接続し直すまで空の表にする）
+    std::vector<std::string> names;
+    if (!reader.ReadString(query) || !ReadStringList(reader, names))
+    {
+        return false;
+    }
+    inputTables.clear();
+    for (const auto& name : names)
+    {
+        inputTables.emplace_back(name, std::make_shared<CSVData>());
+    }
+    return true;
+}
+
+// ウィンドウ関数ノード
+WindowNode::WindowNode(int id)
+    : BaseNode(id, "ウィンドウ関数")
+{
+    inputData = std::make_shared<CSVData>();
+    outputData = std::make_shared<CSVData>();
+}
+
+void WindowNode::Render()
+{
+    // 入力ピン
+    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
+    ImGui::Text("入力");
+    ImNodes::EndInputAttribute();
+    
+    // 出力ピン
+    ImNodes::BeginOutputAttribute(nodeId * 100 + 2);
+    ImGui::Text("出力");
+    ImNodes::EndOutputAttribute();
+    
+    // ウィンドウ設定
+    ImGui::Text("ウィンドウ設定:");
+    
+    // パーティション列
+    static char partitionColumnBuffer[128] = "";
+    if (ImGui::InputText("パーティション列", partitionColumnBuffer, sizeof(partitionColumnBuffer)))
+    {
+        spec.partitionColumn = partitionColumnBuffer;
+    }
+    
+    // 並べ替え列
+    static char orderColumnBuffer[128] = "";
+    if (ImGui::InputText("並べ替え列", orderColumnBuffer, sizeof(orderColumnBuffer)))
+    {
+        spec.orderColumn = orderColumnBuffer;
+    }
+    ImGui::Checkbox("昇順", &spec.ascending);
+    
+    // 関数選択
+    const char* functions[] = { "row_number", "rank", "running_sum", "rolling_sum", "rolling_mean", "rolling_min", "rolling_max", "lag", "lead" };
+    if (ImGui::BeginCombo("関数", spec.function.c_str()))
+    {
+        for (const char* func : functions)
+        {
+            if (ImGui::Selectable(func, spec.function == func))
+            {
+                spec.function = func;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    
+    // 対象列
+    static char valueColumnBuffer[128] = "";
+    if (ImGui::InputText("対象列", valueColumnBuffer, sizeof(valueColumnBuffer)))
+    {
+        spec.valueColumn = valueColumnBuffer;
+    }
+    
+    // フレーム幅 / オフセット
+    if (spec.function.compare(0, 8, "rolling_") == 0)
+    {
+        int windowSize = static_cast<int>(spec.windowSize);
+        if (ImGui::InputInt("フレーム幅", &windowSize) && windowSize > 0)
+        {
+            spec.windowSize = static_cast<size_t>(windowSize);
+        }
+    }
+    else if (spec.function == "lag" || spec.function == "lead")
+    {
+        int offset = static_cast<int>(spec.offset);
+        if (ImGui::InputInt("オフセット", &offset) && offset >= 0)
+        {
+            spec.offset = static_cast<size_t>(offset);
+        }
+    }
+    
+    // 出力列名
+    static char outputColumnBuffer[128] = "";
+    if (ImGui::InputText("出力列名", outputColumnBuffer, sizeof(outputColumnBuffer)))
+    {
+        spec.outputColumn = outputColumnBuffer;
+    }
+    
+    // 実行ボタン
+    if (ImGui::Button("ウィンドウ関数実行"))
+    {
+        Process();
+    }
+    
+    // 結果表示
+    if (!outputData->GetRows().empty())
+    {
+        ImGui::Text("計算結果: %zu 行", outputData->GetRowCount());
+    }
+}
+
+void WindowNode::Process()
+{
+    if (inputData && !inputData->GetHeaders().empty())
+    {
+        ComputeWindow(*inputData, spec, *outputData);
+    }
+}
+
+void WindowNode::SaveState(BinaryWriter& writer) const
+{
+    writer.WriteString(spec.partitionColumn);
+    writer.WriteString(spec.orderColumn);
+    WriteFlag(writer, spec.ascending);
+    writer.WriteString(spec.function);
+    writer.WriteString(spec.valueColumn);
+    writer.Write(static_cast<uint64_t>(spec.windowSize));
+    writer.Write(static_cast<uint64_t>(spec.offset));
+    writer.WriteString(spec.outputColumn);
+}
+
+bool WindowNode::LoadState(BinaryReader& reader)
+{
+    return reader.ReadString(spec.partitionColumn) && reader.ReadString(spec.orderColumn) && ReadFlag(reader, spec.ascending)
+        && reader.ReadString(spec.function) && reader.ReadString(spec.valueColumn)
+        && ReadSize(reader, spec.windowSize) && ReadSize(reader, spec.offset) && reader.ReadString(spec.outputColumn);
+}
+
+// ピボットノード
+PivotNode::PivotNode(int id)
+    : BaseNode(id, "ピボット")
+{
+    inputData = std::make_shared<CSVData>();
+    outputData = std::make_shared<CSVData>();
+}
+
+void PivotNode::Render()
+{
+    // 入力ピン
+    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
+    ImGui::Text("入力");
+    ImNodes::EndInputAttribute();
+    
+    // 出力ピン
+    ImNodes::BeginOutputAttribute(nodeId * 100 + 2);
+    ImGui::Text("出力");
+    ImNodes::EndOutputAttribute();
+    
+    // ピボット設定
+    ImGui::Text("ピボット設定:");
+    
+    // 行キー列（カンマ区切り）
+    static char indexColumnsBuffer[256] = "";
+    if (ImGui::InputText("行キー列", indexColumnsBuffer, sizeof(indexColumnsBuffer)))
+    {
+        spec.indexColumns = SplitColumnList(indexColumnsBuffer);
+    }
+    
+    // ピボット列
+    static char pivotColumnBuffer[128] = "";
+    if (ImGui::InputText("ピボット列", pivotColumnBuffer, sizeof(pivotColumnBuffer)))
+    {
+        spec.pivotColumn = pivotColumnBuffer;
+    }
+    
+    // 値列
+    static char valueColumnBuffer[128] = "";
+    if (ImGui::InputText("値列", valueColumnBuffer, sizeof(valueColumnBuffer)))
+    {
+        spec.valueColumn = valueColumnBuffer;
+    }
+    
+    // 集計関数選択
+    const char* aggregates[] = { "first", "sum", "count", "mean" };
+    if (ImGui::BeginCombo("集計関数", spec.aggregate.c_str()))
+    {
+        for (const char* aggregate : aggregates)
+        {
+            if (ImGui::Selectable(aggregate, spec.aggregate == aggregate))
+            {
+                spec.aggregate = aggregate;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    
+    // 実行ボタン
+    if (ImGui::Button("ピボット実行"))
+    {
+        Process();
+    }
+    
+    // 結果表示
+    if (!outputData->GetHeaders().empty())
+    {
+        ImGui::Text("ピボット結果: %zu 行, %zu 列", outputData->GetRowCount(), outputData->GetColumnCount());
+    }
+}
+
+void PivotNode::Process()
+{
+    if (inputData && !spec.pivotColumn.empty())
+    {
+        ComputePivot(*inputData, spec, *outputData);
+    }
+}
+
+void PivotNode::SaveState(BinaryWriter& writer) const
+{
+    WriteStringList(writer, spec.indexColumns);
+    writer.WriteString(spec.pivotColumn);
+    writer.WriteString(spec.valueColumn);
+    writer.WriteString(spec.aggregate);
+}
+
+bool PivotNode::LoadState(BinaryReader& reader)
+{
+    return ReadStringList(reader, spec.indexColumns) && reader.ReadString(spec.pivotColumn)
+        && reader.ReadString(spec.valueColumn) && reader.ReadString(spec.aggregate);
+}
+
+// アンピボットノード
+UnpivotNode::UnpivotNode(int id)
+    : BaseNode(id, "アンピボット")
+{
+    inputData = std::make_shared<CSVData>();
+    outputData = std::make_shared<CSVData>();
+}
+
+void UnpivotNode::Render()
+{
+    // 入力ピン
+    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
+    ImGui::Text("入力");
+    ImNodes::EndInputAttribute();
+    
+    // 出力ピン
+    ImNodes::BeginOutputAttribute(nodeId * 100 + 2);
+    ImGui::Text("出力");
+    ImNodes::EndOutputAttribute();
+    
+    // アンピボット設定
+    ImGui::Text("アンピボット設定:");
+    
+    // ID列（カンマ区切り）
+    static char idColumnsBuffer[256] = "";
+    if (ImGui::InputText("ID列", idColumnsBuffer, sizeof(idColumnsBuffer)))
+    {
+        spec.idColumns = SplitColumnList(idColumnsBuffer);
+    }
+    
+    // 値列（カンマ区切り、空の場合はID列以外すべて）
+    static char valueColumnsBuffer[256] = "";
+    if (ImGui::InputText("値列", valueColumnsBuffer, sizeof(valueColumnsBuffer)))
+    {
+        spec.valueColumns = SplitColumnList(valueColumnsBuffer);
+    }
+    
+    // 実行ボタン
+    if (ImGui::Button("アンピボット実行"))
+    {
+        Process();
+    }
+    
+    // 結果表示
+    if (!outputData->GetRows().empty())
+    {
+        ImGui::Text("アンピボット結果: %zu 行", outputData->GetRowCount());
+    }
+}
+
+void UnpivotNode::Process()
+{
+    if (inputData && !inputData->GetHeaders().empty())
+    {
+        ComputeUnpivot(*inputData, spec, *outputData);
+    }
+}
+
+void UnpivotNode::SaveState(BinaryWriter& writer) const
+{
+    WriteStringList(writer, spec.idColumns);
+    WriteStringList(writer, spec.valueColumns);
+    writer.WriteString(spec.variableColumn);
+    writer.WriteString(spec.valueColumn);
+}
+
+bool UnpivotNode::LoadState(BinaryReader& reader)
+{
+    return ReadStringList(reader, spec.idColumns) && ReadStringList(reader, spec.valueColumns)
+        && reader.ReadString(spec.variableColumn) && reader.ReadString(spec.valueColumn);
+}
+
+// サンプルノード
+SampleNode::SampleNode(int id)
+    : BaseNode(id, "サンプル")
+{
+    inputData = std::make_shared<CSVData>();
+    outputData = std::make_shared<CSVData>();
+}
+
+void SampleNode::Render()
+{
+    // 入力ピン
+    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
+    ImGui::Text("入力");
+    ImNodes::EndInputAttribute();
+    
+    // 出力ピン
+    ImNodes::BeginOutputAttribute(nodeId * 100 + 2);
+    ImGui::Text("出力");
+    ImNodes::EndOutputAttribute();
+    
+    // サンプル設定
+    ImGui::Text("サンプル設定:");
+    
+    int sampleSize = static_cast<int>(spec.sampleSize);
+    if (ImGui::InputInt("標本サイズ", &sampleSize) && sampleSize > 0)
+    {
+        spec.sampleSize = static_cast<size_t>(sampleSize);
+    }
+    
+    int seed = static_cast<int>(spec.seed);
+    if (ImGui::InputInt("シード", &seed))
+    {
+        spec.seed = static_cast<uint64_t>(seed);
+    }
+    
+    // 層別列
+    static char stratifyColumnBuffer[128] = "";
+    if (ImGui::InputText("層別列", stratifyColumnBuffer, sizeof(stratifyColumnBuffer)))
+    {
+        spec.stratifyColumn = stratifyColumnBuffer;
+    }
+    if (!spec.stratifyColumn.empty())
+    {
+        ImGui::Checkbox("各層から標本サイズ分を抽出", &spec.perStratum);
+        if (spec.perStratum)
+        {
+            // 各層に標本サイズ分の貯水池を持つため、層が多いと保持する行が増える
+            ImGui::TextColored(ImVec4(1, 0.5f, 0, 1), "注意: 層の数 × 標本サイズ 行まで保持します");
+        }
+    }
+    
+    // 実行ボタン
+    if (ImGui::Button("サンプル実行"))
+    {
+        Process();
+    }
+    
+    // 結果表示
+    if (!outputData->GetRows().empty())
+    {
+        ImGui::Text("標本: %zu 行", outputData->GetRowCount());
+    }
+}
+
+void SampleNode::Process()
+{
+    if (inputData && !inputData->GetHeaders().empty())
+    {
+        SampleRows(*inputData, spec, *outputData);
+    }
+}
+
+void SampleNode::SaveState(BinaryWriter& writer) const
+{
+    WriteSampleSpec(writer, spec);
+}
+
+bool SampleNode::LoadState(BinaryReader& reader)
+{
+    return ReadSampleSpec(reader, spec);
+}
+
+// チャートノード
+ChartNode::ChartNode(int id)
+    : BaseNode(id, "チャート")
+    , downsampleMode("minmax")
+    , lastXMin(0.0)
+    , lastXMax(0.0)
+    , lastPixelWidth(0)
+    , fitAxes(true)
+{
+    inputData = std::make_shared<CSVData>();
+}
+
+void ChartNode::Render()
+{
+    // 入力ピン
+    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
+    ImGui::Text("入力");
+    ImNodes::EndInputAttribute();
+    
+    // チャート設定
+    ImGui::Text("チャート設定:");
+    
+    // X列
+    static char xColumnBuffer[128] = "";
+    if (ImGui::InputText("X列", xColumnBuffer, sizeof(xColumnBuffer)))
+    {
+        xColumn = xColumnBuffer;
+    }
+    
+    // Y列
+    static char yColumnBuffer[128] = "";
+    if (ImGui::InputText("Y列", yColumnBuffer, sizeof(yColumnBuffer)))
+    {
+        yColumn = yColumnBuffer;
+    }
+    
+    // 間引き方式選択
+    const char* modes[] = { "minmax", "lttb" };
+    if (ImGui::BeginCombo("間引き方式", downsampleMode.c_str()))
+    {
+        for (const char* mode : modes)
+        {
+            if (ImGui::Selectable(mode, downsampleMode == mode))
+            {
+                downsampleMode = mode;
+                lastPixelWidth = 0;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    
+    // 系列作成ボタン
+    if (ImGui::Button("チャート作成"))
+    {
+        Process();
+    }
+    
+    if (series.IsEmpty())
+    {
+        return;
+    }
+    
+    ImGui::Text("データ点数: %zu", series.GetPointCount());
+    
+    if (ImPlot::BeginPlot("##Chart", ImVec2(480, 280)))
+    {
+        ImPlot::SetupAxes(xColumn.empty() ? "行" : xColumn.c_str(), yColumn.c_str());
+
+        // 既定の表示範囲（[0, 1]）のまま問い合わせると時刻や大きな値の X 列では点がほとんど返らないため、
+        // 系列を作り直した直後は系列全体の範囲を表示する（以後は利用者の拡大・移動に任せる）
+        double xMin = series.GetMinX();
+        double xMax = series.GetMaxX();
+        double yMin = series.GetMinY();
+        double yMax = series.GetMaxY();
+        if (xMax <= xMin)
+        {
+            xMin -= 0.5;
+            xMax += 0.5;
+        }
+        if (yMax <= yMin)
+        {
+            yMin -= 0.5;
+            yMax += 0.5;
+        }
+        ImPlot::SetupAxesLimits(xMin, xMax, yMin, yMax, fitAxes ? ImPlotCond_Always : ImPlotCond_Once);
+        fitAxes = false;
+        
+        // 表示範囲とピクセル幅が変わった場合のみ間引きをやり直す
+        ImPlotRect limits = ImPlot::GetPlotLimits();
+        int pixelWidth = static_cast<int>(ImPlot::GetPlotSize().x);
+        if (limits.X.Min != lastXMin || limits.X.Max != lastXMax || pixelWidth != lastPixelWidth)
+        {
+            DownsampleMode mode = downsampleMode == "lttb" ? DownsampleMode::LTTB : DownsampleMode::MinMax;
+            series.Query(limits.X.Min, limits.X.Max, pixelWidth, mode, plotX, plotY);
+            lastXMin = limits.X.Min;
+            lastXMax = limits.X.Max;
+            lastPixelWidth = pixelWidth;
+        }
+        
+        ImPlot::PlotLine(yColumn.c_str(), plotX.data(), plotY.data(), static_cast<int>(plotX.size()));
+        ImPlot::EndPlot();
+    }
+}
+
+void ChartNode::Process()
+{
+    if (!inputData || yColumn.empty())
+    {
+        return;
+    }
+    
+    const auto& headers = inputData->GetHeaders();
+    auto xIt = std::find(headers.begin(), headers.end(), xColumn);
+    auto yIt = std::find(headers.begin(), headers.end(), yColumn);
+    if (yIt == headers.end() || (!xColumn.empty() && xIt == headers.end()))
+    {
+        return;
+    }
+    size_t xIndex = xColumn.empty() ? 0 : static_cast<size_t>(xIt - headers.begin());
+    size_t yIndex = static_cast<size_t>(yIt - headers.begin());
+    
+    // 数値として解釈できる行だけを系列にする
+    std::vector<double> xs;
+    std::vector<double> ys;
+    const auto& rows = inputData->GetRows();
+    xs.reserve(rows.size());
+    ys.reserve(rows.size());
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+        const auto& row = rows[r];
+        if (yIndex >= row.size() || (!xColumn.empty() && xIndex >= row.size()))
+        {
+            continue;
+        }
+        
+        double y = 0.0;
+        if (!ParseDouble(row[yIndex], y))
+        {
+            continue;
+        }
+        
+        double x = static_cast<double>(r);
+        if (!xColumn.empty() && !ParseDouble(row[xIndex], x))
+        {
+            continue;
+        }
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+    
+    // ピラミッドは X 昇順を前提とするため、必要な場合のみ並べ替える
+    if (!std::is_sorted(xs.begin(), xs.end()))
+    {
+        std::vector<size_t> order(xs.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return xs[a] < xs[b]; });
+        std::vector<double> sortedX(xs.size());
+        std::vector<double> sortedY(ys.size());
+        for (size_t i = 0; i < order.size(); ++i)
+        {
+            sortedX[i] = xs[order[i]];
+            sortedY[i] = ys[order[i]];
+        }
+        xs.swap(sortedX);
+        ys.swap(sortedY);
+    }
+    
+    series.Build(std::move(xs), std::move(ys));
+    lastPixelWidth = 0;
+    fitAxes = true;
+}
+
+void ChartNode::SaveState(BinaryWriter& writer) const
+{
+    writer.WriteString(xColumn);
+    writer.WriteString(yColumn);
+    writer.WriteString(downsampleMode);
+}
+
+bool ChartNode::LoadState(BinaryReader& reader)
+{
+    return reader.ReadString(xColumn) && reader.ReadString(yColumn) && reader.ReadString(downsampleMode);
+}
+
+// 出力ノード
+OutputNode::OutputNode(int id)
+    : BaseNode(id, "CSV出力")
+    , outputFormat("csv")
+{
+    inputData = std::make_shared<CSVData>();
+}
+
+void OutputNode::Render()
+{
+    // 入力ピン
+    ImNodes::BeginInputAttribute(nodeId * 100 + 1);
+    ImGui::Text("入力");
+    ImNodes::EndInputAttribute();
+    
+    // 出力設定
+    ImGui::Text("出力設定:");
+    
+    // 出力パス
+    static char outputPathBuffer[256] = "";
+    if (ImGui::InputText("出力パス", outputPathBuffer, sizeof(outputPathBuffer)))
+    {
+        outputPath = outputPathBuffer;
+    }
+    
+    // 出力形式選択（nscol は行グループ単位の列指向形式、arrow / arrows は Arrow IPC のファイル / ストリーム形式）
+    const char* formats[] = { "csv", "nscol", "arrow", "arrows" };
+    if (ImGui::BeginCombo("出力形式", outputFormat.c_str()))
+    {
+        for (const char* format : formats)
+        {
+            if (ImGui::Selectable(format, outputFormat == format))
+            {
+                outputFormat = format;
+            }
+        }
+        ImGui::EndCombo();
+    }
+    
+    // 保存ボタン
+    if (ImGui::Button("CSV保存"))
+    {
+        Process();
+    }
+    
+    // 状態表示
+    if (!inputData->GetRows().empty())
+    {
+        ImGui::Text("保存対象: %zu 行", inputData->GetRowCount());
+    }
+}
+
+void OutputNode::Process()
+{
+    if (inputData && !outputPath.empty())
+    {
+        if (outputFormat == "nscol")
+        {
+            WriteColumnarFile(outputPath, *inputData);
+        }
+        else if (outputFormat == "arrow" || outputFormat == "arrows")
+        {
+            ArrowTable table;
+            BuildArrowTable(*inputData, table);
+            if (outputFormat == "arrow")
+            {
+                WriteArrowIpcFile(outputPath, table);
+            }
+            else
+            {
+                WriteArrowIpcStream(outputPath, table);
+            }
+        }
+        else
+        {
+            inputData->SaveToFile(outputPath);
+        }
+    }
+}
+
+void OutputNode::SaveState(BinaryWriter& writer) const
+{
+    writer.WriteString(outputPath);
+    writer.WriteString(outputFormat);
 }
 
-void OutputNode::SaveState()
+bool OutputNode::LoadState(BinaryReader& reader)
 {
-    // 状態保存処理をここに実装
+    return reader.ReadString(outputPath) && reader.ReadString(outputFormat);
 }
 
-void OutputNode::LoadState()
+std::unique_ptr<BaseNode> CreateNodeByName(const std::string& name, int id)
 {
-    // 状態読み込み処理をここに実装
+    if (name == "CSV読み込み") return std::make_unique<CSVLoadNode>(id);
+    if (name == "フィルター") return std::make_unique<FilterNode>(id);
+    if (name == "ソート") return std::make_unique<SortNode>(id);
+    if (name == "集計") return std::make_unique<AggregateNode>(id);
+    if (name == "結合") return std::make_unique<JoinNode>(id);
+    if (name == "SQL") return std::make_unique<SqlNode>(id);
+    if (name == "ウィンドウ関数") return std::make_unique<WindowNode>(id);
+    if (name == "ピボット") return std::make_unique<PivotNode>(id);
+    if (name == "アンピボット") return std::make_unique<UnpivotNode>(id);
+    if (name == "サンプル") return std::make_unique<SampleNode>(id);
+    if (name == "チャート") return std::make_unique<ChartNode>(id);
+    if (name == "CSV出力") return std::make_unique<OutputNode>(id);
+    return nullptr;
 }
@@ -2,6 +2,21 @@
 
 #include "NodeEditor.h"
 #include "CSVData.h"
+#include "WindowFunction.h"
+#include "Reshape.h"
+#include "Sampling.h"
+#include "Downsampling.h"
+#include "ColumnarCache.h"
+#include "ColumnarFile.h"
+#include "ArrowIpc.h"
+#include "HashJoin.h"
+#include "ColumnIndex.h"
+#include "LogFollower.h"
+#include "Aggregate.h"
+#include "MultiFileLoad.h"
+#include "SqlQuery.h"
+#include <memory>
+#include <future>
 #include <string>
 
 // CSV読み込みノード
@@ -11,13 +26,38 @@ public:
     CSVLoadNode(int id);
     void Render() override;
     void Process() override;
-    void SaveState() override;
-    void LoadState() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+    // 下流のサンプルノードから標本抽出を読み込み処理へ押し下げる
+    void SetSamplePushdown(const SampleSpec& spec);
+    
+    // 下流のフィルター条件を列指向ファイルの行グループ読み飛ばしへ押し下げる
+    void SetFilterPushdown(const ScanPredicate& predicate);
+
+    // 読み込み結果の表（読み込み・追従の開始のたびに新しい表になるため、下流は取り直して設定する）
+    std::shared_ptr<CSVData> GetOutputData() const { return outputData; }
 
 private:
     std::string filePath;
     bool fileLoaded;
+    bool sampleOnLoad;
+    SampleSpec sampleSpec;
+    std::vector<ScanPredicate> pushedPredicates;
+    ColumnarScanStats lastScanStats;
+    MultiFileOptions multiFileOptions;
+    MultiFileLoadResult lastMultiFileResult;
+    bool useCache;
+    CacheLoadResult lastCacheResult;
+    std::future<bool> cacheWriteTask;
+    bool followMode;
+    std::unique_ptr<LogFollower> follower;
     std::shared_ptr<CSVData> outputData;
+
+    bool LoadData();
+    bool LoadMultipleFiles();
+    bool StartFollowing();
+    void PollFollower();
 };
 
 // フィルターノード
@@ -27,15 +67,22 @@ public:
     FilterNode(int id);
     void Render() override;
     void Process() override;
-    void SaveState() override;
-    void LoadState() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+    // 入力の表を設定する（追従中の CSVLoadNode の出力なら、追加された行だけを描画のたびに反映する）
+    void SetInputData(std::shared_ptr<CSVData> data);
 
 private:
     std::string filterColumn;
     std::string filterValue;
     std::string filterOperator; // "==", "!=", ">", "<", ">=", "<=", "contains"
+    SelectStats lastSelectStats;
+    TableDeltaCursor cursor;
     std::shared_ptr<CSVData> inputData;
     std::shared_ptr<CSVData> outputData;
+
+    std::string GetSettingsKey() const;
 };
 
 // ソートノード
@@ -45,8 +92,8 @@ public:
     SortNode(int id);
     void Render() override;
     void Process() override;
-    void SaveState() override;
-    void LoadState() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
 
 private:
     std::string sortColumn;
@@ -62,15 +109,22 @@ public:
     AggregateNode(int id);
     void Render() override;
     void Process() override;
-    void SaveState() override;
-    void LoadState() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+    // 入力の表を設定する（追従中の CSVLoadNode の出力なら、追加された行だけを描画のたびに集計に加える）
+    void SetInputData(std::shared_ptr<CSVData> data);
 
 private:
     std::string groupColumn;
     std::string aggregateColumn;
     std::string aggregateFunction; // "sum", "average", "count", "min", "max"
+    GroupAggregator aggregator;
+    TableDeltaCursor cursor;
     std::shared_ptr<CSVData> inputData;
     std::shared_ptr<CSVData> outputData;
+
+    std::string GetSettingsKey() const;
 };
 
 // 結合ノード
@@ -80,18 +134,133 @@ public:
     JoinNode(int id);
     void Render() override;
     void Process() override;
-    void SaveState() override;
-    void LoadState() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
 
 private:
     std::string leftJoinColumn;
     std::string rightJoinColumn;
     std::string joinType; // "inner", "left", "right", "outer"
+    JoinStats lastJoinStats;
     std::shared_ptr<CSVData> leftInputData;
     std::shared_ptr<CSVData> rightInputData;
     std::shared_ptr<CSVData> outputData;
 };
 
+// SQL ノード
+// 入力ごとに表名を付け、SELECT 文で複数の入力をまとめて問い合わせる
+class SqlNode : public BaseNode
+{
+public:
+    SqlNode(int id);
+    void Render() override;
+    void Process() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+    // 問い合わせから name で参照する入力を設定する（同じ名前があれば置き換える）
+    void SetInputTable(const std::string& name, std::shared_ptr<CSVData> data);
+
+private:
+    std::string query;
+    std::vector<std::pair<std::string, std::shared_ptr<CSVData>>> inputTables;
+    std::string lastError;
+    SqlQueryStats lastStats;
+    std::shared_ptr<CSVData> outputData;
+};
+
+// ウィンドウ関数ノード
+class WindowNode : public BaseNode
+{
+public:
+    WindowNode(int id);
+    void Render() override;
+    void Process() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+private:
+    WindowSpec spec;
+    std::shared_ptr<CSVData> inputData;
+    std::shared_ptr<CSVData> outputData;
+};
+
+// ピボットノード
+class PivotNode : public BaseNode
+{
+public:
+    PivotNode(int id);
+    void Render() override;
+    void Process() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+private:
+    PivotSpec spec;
+    std::shared_ptr<CSVData> inputData;
+    std::shared_ptr<CSVData> outputData;
+};
+
+// アンピボットノード
+class UnpivotNode : public BaseNode
+{
+public:
+    UnpivotNode(int id);
+    void Render() override;
+    void Process() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+private:
+    UnpivotSpec spec;
+    std::shared_ptr<CSVData> inputData;
+    std::shared_ptr<CSVData> outputData;
+};
+
+// サンプルノード
+class SampleNode : public BaseNode
+{
+public:
+    SampleNode(int id);
+    void Render() override;
+    void Process() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+    const SampleSpec& GetSpec() const { return spec; }
+
+private:
+    SampleSpec spec;
+    std::shared_ptr<CSVData> inputData;
+    std::shared_ptr<CSVData> outputData;
+};
+
+// チャートノード
+class ChartNode : public BaseNode
+{
+public:
+    ChartNode(int id);
+    void Render() override;
+    void Process() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
+
+private:
+    std::string xColumn; // 空の場合は行番号を使用
+    std::string yColumn;
+    std::string downsampleMode; // "minmax", "lttb"
+    std::shared_ptr<CSVData> inputData;
+    DownsampledSeries series;
+
+    // 直前の問い合わせ結果（表示範囲が変わらない間は再利用する）
+    std::vector<double> plotX;
+    std::vector<double> plotY;
+    double lastXMin;
+    double lastXMax;
+    int lastPixelWidth;
+    bool fitAxes;   // 次の描画で表示範囲を系列全体に合わせる（系列を作り直したとき）
+};
+
 // 出力ノード
 class OutputNode : public BaseNode
 {
@@ -99,10 +268,15 @@ public:
     OutputNode(int id);
     void Render() override;
     void Process() override;
-    void SaveState() override;
-    void LoadState() override;
+    void SaveState(BinaryWriter& writer) const override;
+    bool LoadState(BinaryReader& reader) override;
 
 private:
     std::string outputPath;
+    std::string outputFormat; // "csv", "nscol", "arrow", "arrows"
     std::shared_ptr<CSVData> inputData;
 };
+
+// ノード名（タイトルバーの表示名）からノードを作成する（未知の名前なら nullptr）
+// ワークスペースのスナップショットからグラフを復元するときに使う。
+std::unique_ptr<BaseNode> CreateNodeByName(const std::string& name, int id);
@@ -0,0 +1,149 @@
+﻿#include "NumberParser.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // int64 の桁あふれを起こさずに SWAR で読める最大桁数
+    const size_t maxIntegerDigits = 19;
+
+    // リトルエンディアンで読み込んだ 8 文字が全て '0'〜'9' か判定する
+    bool IsEightDigits(uint64_t chunk)
+    {
+        return (((chunk & 0xF0F0F0F0F0F0F0F0ull) |
+                 (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) ==
+                0x3333333333333333ull);
+    }
+
+    // 8 桁の 10 進数字を 3 回の乗算でまとめて数値に変換する
+    uint32_t ParseEightDigits(uint64_t chunk)
+    {
+        const uint64_t mask = 0x000000FF000000FFull;
+        const uint64_t mul1 = 0x000F424000000064ull; // 100 + (1000000 << 32)
+        const uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+        chunk -= 0x3030303030303030ull;
+        chunk = (chunk * 10) + (chunk >> 8);
+        chunk = (((chunk & mask) * mul1) + (((chunk >> 16) & mask) * mul2)) >> 32;
+        return static_cast<uint32_t>(chunk);
+    }
+
+    bool IsDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+}
+
+NumberKind ClassifyNumber(std::string_view text, int64_t& integer, double& value)
+{
+    if (text.empty())
+    {
+        return NumberKind::NotNumber;
+    }
+
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    const char* p = begin;
+    bool negative = false;
+    if (*p == '-' || *p == '+')
+    {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // 整数の高速経路: 8 桁ずつ SWAR で読み、残りを 1 桁ずつ読む
+    const char* digits = p;
+    uint64_t magnitude = 0;
+    while (end - p >= 8 && static_cast<size_t>(p - digits) + 8 <= maxIntegerDigits)
+    {
+        uint64_t chunk;
+        std::memcpy(&chunk, p, sizeof(chunk));
+        if (!IsEightDigits(chunk))
+        {
+            break;
+        }
+        magnitude = magnitude * 100000000ull + ParseEightDigits(chunk);
+        p += 8;
+    }
+    while (p < end && IsDigit(*p) && static_cast<size_t>(p - digits) < maxIntegerDigits)
+    {
+        magnitude = magnitude * 10 + static_cast<uint64_t>(*p - '0');
+        ++p;
+    }
+
+    const uint64_t limit = negative ? (uint64_t(1) << 63) : static_cast<uint64_t>(INT64_MAX);
+    if (p == end && p != digits && magnitude <= limit)
+    {
+        integer = negative ? static_cast<int64_t>(0 - magnitude) : static_cast<int64_t>(magnitude);
+        value = negative ? -static_cast<double>(magnitude) : static_cast<double>(magnitude);
+        return NumberKind::Integer;
+    }
+
+    // 小数・指数表記・長い整数は from_chars に任せる（正しく丸められる）
+    // from_chars は先頭の '+' を受け付けないため読み飛ばすが、"+-1" は数値としない
+    const char* start = begin;
+    if (*start == '+')
+    {
+        ++start;
+        if (start == end || *start == '-' || *start == '+')
+        {
+            return NumberKind::NotNumber;
+        }
+    }
+    // from_chars は "nan" / "inf" も受け付けるが、順序付けできない値は比較・整列・統計を壊すため数値としない
+    auto parsed = std::from_chars(start, end, value);
+    if (parsed.ec != std::errc() || parsed.ptr != end || !std::isfinite(value))
+    {
+        return NumberKind::NotNumber;
+    }
+    return NumberKind::Real;
+}
+
+bool ParseDouble(std::string_view text, double& value)
+{
+    int64_t integer = 0;
+    return ClassifyNumber(text, integer, value) != NumberKind::NotNumber;
+}
+
+bool ParseCanonicalInt(std::string_view text, int64_t& value)
+{
+    double real = 0.0;
+    if (ClassifyNumber(text, value, real) != NumberKind::Integer || text[0] == '+')
+    {
+        return false;
+    }
+    // 先頭の 0 や "-0" は書き出すと表記が変わる
+    size_t first = text[0] == '-' ? 1 : 0;
+    return text[first] != '0' || text.size() == 1;
+}
+
+bool ParseCanonicalDouble(std::string_view text, double& value)
+{
+    if (text.empty())
+    {
+        return false;
+    }
+    const char* end = text.data() + text.size();
+    auto parsed = std::from_chars(text.data(), end, value);
+    if (parsed.ec != std::errc() || parsed.ptr != end || !std::isfinite(value))
+    {
+        return false;
+    }
+    char buffer[32];
+    auto formatted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    return text == std::string_view(buffer, formatted.ptr - buffer);
+}
+
+void FormatCanonical(int64_t value, std::string& text)
+{
+    char buffer[32];
+    auto formatted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    text.assign(buffer, formatted.ptr);
+}
+
+void FormatCanonical(double value, std::string& text)
+{
+    char buffer[32];
+    auto formatted = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    text.assign(buffer, formatted.ptr);
+}
@@ -0,0 +1,29 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// セルの数値分類
+enum class NumberKind
+{
+    NotNumber,  // 空文字・数値以外
+    Integer,    // 符号付き 64bit に収まる 10 進整数
+    Real        // 小数・指数表記・64bit に収まらない整数
+};
+
+// 1 回の走査で分類と変換を行う（例外は投げない）
+// Integer の場合は integer と value の両方、Real の場合は value のみを設定する
+// "nan" / "inf" などの有限でない値は NotNumber とする（数値はすべて順序付けできる）
+NumberKind ClassifyNumber(std::string_view text, int64_t& integer, double& value);
+
+// 文字列全体が有限の数値の場合のみ true を返す
+bool ParseDouble(std::string_view text, double& value);
+
+// 書式を変えずに往復できる場合のみ数値として扱う（"007" や "1.50" は false）
+bool ParseCanonicalInt(std::string_view text, int64_t& value);
+bool ParseCanonicalDouble(std::string_view text, double& value);
+
+// ParseCanonical* と往復できる最短表記で書き出す
+void FormatCanonical(int64_t value, std::string& text);
+void FormatCanonical(double value, std::string& text);
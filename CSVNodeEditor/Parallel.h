@@ -0,0 +1,99 @@
+﻿#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+// 並列処理ヘルパー
+// [0, count) の各インデックスに対して func(index) をワーカースレッドで実行する。
+// インデックスは共有カウンタから1つずつ取り出すため、処理量に偏りがあっても負荷が均等になる。
+template <typename Func>
+void ParallelFor(size_t count, Func&& func)
+{
+    size_t workerCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    workerCount = std::min(workerCount, count);
+
+    if (workerCount <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1))
+        {
+            func(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workerCount - 1);
+    for (size_t t = 1; t < workerCount; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// values を comp の順に並べ替える（安定ではない）
+// 要素をワーカー数のブロックに分けて並列にソートし、隣り合うブロックを並列に併合していく。
+template <typename T, typename Compare>
+void ParallelSort(std::vector<T>& values, Compare comp)
+{
+    const size_t minBlockSize = 65536;
+    size_t blockCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    blockCount = std::min(blockCount, values.size() / minBlockSize);
+    if (blockCount <= 1)
+    {
+        std::sort(values.begin(), values.end(), comp);
+        return;
+    }
+
+    std::vector<size_t> bounds(blockCount + 1);
+    for (size_t b = 0; b <= blockCount; ++b)
+    {
+        bounds[b] = values.size() * b / blockCount;
+    }
+    ParallelFor(blockCount, [&](size_t b) {
+        std::sort(values.begin() + bounds[b], values.begin() + bounds[b + 1], comp);
+    });
+
+    // 併合のたびにブロック数が半分になる（奇数個の場合は最後のブロックをそのまま移す）
+    std::vector<T> buffer(values.size());
+    while (bounds.size() > 2)
+    {
+        const size_t pairCount = bounds.size() / 2;
+        ParallelFor(pairCount, [&](size_t p) {
+            size_t begin = bounds[p * 2];
+            size_t middle = bounds[std::min(p * 2 + 1, bounds.size() - 1)];
+            size_t end = bounds[std::min(p * 2 + 2, bounds.size() - 1)];
+            std::merge(std::make_move_iterator(values.begin() + begin), std::make_move_iterator(values.begin() + middle),
+                std::make_move_iterator(values.begin() + middle), std::make_move_iterator(values.begin() + end),
+                buffer.begin() + begin, comp);
+        });
+        values.swap(buffer);
+
+        std::vector<size_t> merged;
+        for (size_t b = 0; b < bounds.size(); b += 2)
+        {
+            merged.push_back(bounds[b]);
+        }
+        if (merged.back() != bounds.back())
+        {
+            merged.push_back(bounds.back());
+        }
+        bounds.swap(merged);
+    }
+}
@@ -0,0 +1,144 @@
+﻿#include "Predicate.h"
+#include "NumberParser.h"
+#include "ZoneMap.h"
+#include <cmath>
+
+namespace
+{
+    template <typename T>
+    bool Compare(const std::string& op, const T& left, const T& right)
+    {
+        if (op == "==") return left == right;
+        if (op == "!=") return !(left == right);
+        if (op == ">") return right < left;
+        if (op == "<") return left < right;
+        if (op == ">=") return !(left < right);
+        if (op == "<=") return !(right < left);
+        return false;
+    }
+
+    // [min, max] の中に op value を満たす値が存在し得るか
+    template <typename T>
+    bool RangeMayMatch(const std::string& op, const T& min, const T& max, const T& value)
+    {
+        if (op == "==") return !(value < min) && !(max < value);
+        if (op == "!=") return !(min == value && max == value);
+        if (op == ">") return value < max;
+        if (op == ">=") return !(max < value);
+        if (op == "<") return min < value;
+        if (op == "<=") return !(value < min);
+        return true;
+    }
+}
+
+bool CompilePredicate(const ScanPredicate& predicate, const std::vector<std::string>& headers, CompiledPredicate& compiled)
+{
+    const char* operators[] = { "==", "!=", ">", "<", ">=", "<=", "contains" };
+    bool knownOperator = false;
+    for (const char* op : operators)
+    {
+        knownOperator = knownOperator || predicate.op == op;
+    }
+    if (!knownOperator)
+    {
+        return false;
+    }
+
+    compiled.columnIndex = -1;
+    for (size_t i = 0; i < headers.size(); ++i)
+    {
+        if (headers[i] == predicate.column)
+        {
+            compiled.columnIndex = static_cast<int>(i);
+            break;
+        }
+    }
+    if (compiled.columnIndex < 0)
+    {
+        return false;
+    }
+
+    compiled.op = predicate.op;
+    compiled.value = predicate.value;
+    compiled.valueIsNumeric = ParseDouble(predicate.value, compiled.numericValue);
+    return true;
+}
+
+bool CompiledPredicate::Matches(std::string_view cell) const
+{
+    if (op == "contains")
+    {
+        return cell.find(value) != std::string_view::npos;
+    }
+
+    double cellValue = 0.0;
+    if (valueIsNumeric && ParseDouble(cell, cellValue))
+    {
+        return Compare(op, cellValue, numericValue);
+    }
+    return Compare(op, cell, std::string_view(value));
+}
+
+bool CompiledPredicate::MayMatchNumericRange(double min, double max, bool hasNulls) const
+{
+    if (hasNulls && Matches(std::string_view()))
+    {
+        return true;
+    }
+    // ファイルから読んだ統計に NaN が残っていれば範囲では判定できない
+    if (!valueIsNumeric || op == "contains" || std::isnan(min) || std::isnan(max))
+    {
+        return true;
+    }
+    return RangeMayMatch(op, min, max, numericValue);
+}
+
+bool CompiledPredicate::MayMatchTextRange(const std::string& min, const std::string& max, bool hasNulls) const
+{
+    if (hasNulls && Matches(std::string_view()))
+    {
+        return true;
+    }
+
+    // 数値として比較されるセルが混在し得るため、比較値が数値なら文字列範囲では判定しない
+    if (valueIsNumeric || op == "contains")
+    {
+        return true;
+    }
+    return RangeMayMatch(op, min, max, value);
+}
+
+bool CompiledPredicate::MayMatchZone(const ColumnZone& zone) const
+{
+    if (zone.nullCount > 0 && Matches(std::string_view()))
+    {
+        return true;
+    }
+    const uint32_t nonNullCount = zone.rowCount - zone.nullCount;
+    if (nonNullCount == 0)
+    {
+        return false;
+    }
+    if (op == "contains")
+    {
+        return true;
+    }
+
+    // 比較値が数値でなければ、すべてのセルが文字列として比較される
+    if (!valueIsNumeric)
+    {
+        return RangeMayMatch(op, zone.textMin, zone.textMax, value);
+    }
+
+    // 数値のセルは数値の範囲で判定する。文字列の範囲は数値のセルも含むため、それ以外のセルの判定は保守的になる
+    // 以前の版で書き出したキャッシュの要約には NaN を含む範囲があり得るため、その場合は読み飛ばさない
+    if (zone.numericCount > 0 && (std::isnan(zone.numericMin) || std::isnan(zone.numericMax)))
+    {
+        return true;
+    }
+    if (zone.numericCount > 0 && RangeMayMatch(op, zone.numericMin, zone.numericMax, numericValue))
+    {
+        return true;
+    }
+    return zone.numericCount < nonNullCount && RangeMayMatch(op, zone.textMin, zone.textMax, value);
+}
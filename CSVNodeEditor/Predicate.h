@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct ColumnZone;
+
+// 列に対する比較条件
+struct ScanPredicate
+{
+    std::string column;
+    std::string op = "=="; // "==", "!=", ">", "<", ">=", "<=", "contains"
+    std::string value;
+};
+
+// 比較値を事前に解析した条件
+// セルと比較値がともに数値なら数値として、それ以外は文字列として比較する。
+struct CompiledPredicate
+{
+    int columnIndex = -1;
+    std::string op;
+    std::string value;
+    bool valueIsNumeric = false;
+    double numericValue = 0.0;
+
+    bool Matches(std::string_view cell) const;
+
+    // 最小値・最大値の範囲に一致するセルが存在し得るか（統計によるブロック読み飛ばし用）
+    // false を返すのは一致しないことが確実な場合のみ。
+    bool MayMatchNumericRange(double min, double max, bool hasNulls) const;
+    bool MayMatchTextRange(const std::string& min, const std::string& max, bool hasNulls) const;
+
+    // 数値・文字列が混在し得る行ブロックの要約（ゾーンマップ）に一致するセルが存在し得るか
+    bool MayMatchZone(const ColumnZone& zone) const;
+};
+
+bool CompilePredicate(const ScanPredicate& predicate, const std::vector<std::string>& headers, CompiledPredicate& compiled);
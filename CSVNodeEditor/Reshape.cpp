@@ -0,0 +1,341 @@
+﻿#include "Reshape.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+namespace
+{
+    std::string_view CellAt(const CSVRow& row, int columnIndex)
+    {
+        return columnIndex < 0 ? std::string_view() : row[static_cast<size_t>(columnIndex)];
+    }
+
+    // 行に無い列は空のセルの参照を返す
+    CellRef RefAt(const CSVRow& row, int columnIndex)
+    {
+        return static_cast<size_t>(columnIndex) < row.size() ? row.GetRefs()[columnIndex] : CellRef();
+    }
+
+    int FindColumn(const std::vector<std::string>& headers, const std::string& column)
+    {
+        for (size_t i = 0; i < headers.size(); ++i)
+        {
+            if (headers[i] == column)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    std::string FormatNumber(double value)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+        return buffer;
+    }
+
+    // 1回の並列処理で受け持つ入力行数
+    const size_t reshapeBlockRows = 16384;
+}
+
+std::vector<std::string> SplitColumnList(const std::string& text)
+{
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (start <= text.size())
+    {
+        size_t end = text.find(',', start);
+        if (end == std::string::npos)
+        {
+            end = text.size();
+        }
+        std::string name = text.substr(start, end - start);
+        name.erase(0, name.find_first_not_of(" \t"));
+        name.erase(name.find_last_not_of(" \t") + 1);
+        if (!name.empty())
+        {
+            result.push_back(name);
+        }
+        start = end + 1;
+    }
+    return result;
+}
+
+bool ComputePivot(const CSVData& input, const PivotSpec& spec, CSVData& output)
+{
+    const auto& headers = input.GetHeaders();
+    const auto& rows = input.GetRows();
+
+    std::vector<int> indexColumns;
+    for (const auto& column : spec.indexColumns)
+    {
+        int index = FindColumn(headers, column);
+        if (index < 0)
+        {
+            return false;
+        }
+        indexColumns.push_back(index);
+    }
+
+    int pivotIndex = FindColumn(headers, spec.pivotColumn);
+    int valueIndex = FindColumn(headers, spec.valueColumn);
+    bool takeFirst = spec.aggregate == "first";
+    bool knownAggregate = takeFirst || spec.aggregate == "sum" || spec.aggregate == "count" || spec.aggregate == "mean";
+    if (pivotIndex < 0 || (valueIndex < 0 && spec.aggregate != "count") || !knownAggregate)
+    {
+        return false;
+    }
+
+    // 出力行とピボット値（出力列）を出現順に割り当てる
+    std::unordered_map<std::string, size_t> rowLookup;
+    std::unordered_map<std::string_view, size_t> columnLookup;
+    std::vector<size_t> rowSources;          // 出力行ごとの代表入力行（インデックス列の値の取得元）
+    std::vector<std::string> pivotValues;
+
+    // 出力セル。first は入力セルの参照と設定済みかどうかを、それ以外は合計と件数を保持する
+    // （空の値も最初の値として残すため、設定済みかどうかはセルの値とは別に持つ）
+    std::vector<std::vector<std::string_view>> firstCells;
+    std::vector<std::vector<bool>> firstPresent;
+    std::vector<std::vector<double>> sums;
+    std::vector<std::vector<size_t>> counts;
+
+    std::string key;
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+        const CSVRow row = rows[r];
+
+        key.clear();
+        for (int index : indexColumns)
+        {
+            key += CellAt(row, index);
+            key += '\x1f';
+        }
+
+        auto rowInserted = rowLookup.emplace(key, rowSources.size());
+        if (rowInserted.second)
+        {
+            rowSources.push_back(r);
+            if (takeFirst)
+            {
+                firstCells.emplace_back();
+                firstPresent.emplace_back();
+            }
+            else
+            {
+                sums.emplace_back();
+                counts.emplace_back();
+            }
+        }
+        size_t outRow = rowInserted.first->second;
+
+        std::string_view pivotValue = CellAt(row, pivotIndex);
+        auto columnInserted = columnLookup.emplace(pivotValue, pivotValues.size());
+        if (columnInserted.second)
+        {
+            pivotValues.emplace_back(pivotValue);
+        }
+        size_t outColumn = columnInserted.first->second;
+
+        // 行ごとのセル配列は必要になった列まで伸ばす
+        if (takeFirst)
+        {
+            auto& cells = firstCells[outRow];
+            auto& present = firstPresent[outRow];
+            if (cells.size() <= outColumn)
+            {
+                cells.resize(outColumn + 1);
+                present.resize(outColumn + 1, false);
+            }
+            if (!present[outColumn])
+            {
+                cells[outColumn] = CellAt(row, valueIndex);
+                present[outColumn] = true;
+            }
+        }
+        else
+        {
+            auto& rowSums = sums[outRow];
+            auto& rowCounts = counts[outRow];
+            if (rowCounts.size() <= outColumn)
+            {
+                rowSums.resize(outColumn + 1, 0.0);
+                rowCounts.resize(outColumn + 1, 0);
+            }
+
+            double value = 0.0;
+            if (spec.aggregate == "count")
+            {
+                rowCounts[outColumn]++;
+            }
+            else if (ParseDouble(CellAt(row, valueIndex), value))
+            {
+                rowSums[outColumn] += value;
+                rowCounts[outColumn]++;
+            }
+        }
+    }
+
+    // ピボット値がインデックス列名（または改名後の別のピボット値）と重なる場合は、ピボット列名を付けて区別する
+    std::vector<std::string> outputHeaders = spec.indexColumns;
+    for (const auto& value : pivotValues)
+    {
+        std::string name = value;
+        while (std::find(outputHeaders.begin(), outputHeaders.end(), name) != outputHeaders.end()
+            || (name != value && std::find(pivotValues.begin(), pivotValues.end(), name) != pivotValues.end()))
+        {
+            name += "_" + spec.pivotColumn;
+        }
+        outputHeaders.push_back(name);
+    }
+
+    // 出力はブロックごとのアリーナに組み立て、最後に連結する
+    const size_t outputWidth = outputHeaders.size();
+    const size_t outputRowCount = rowSources.size();
+    std::vector<CellBlock> blocks((outputRowCount + reshapeBlockRows - 1) / reshapeBlockRows);
+    ParallelFor(blocks.size(), [&](size_t b) {
+        size_t begin = b * reshapeBlockRows;
+        size_t end = std::min(outputRowCount, begin + reshapeBlockRows);
+        CellBlock& block = blocks[b];
+        block.cells.reserve((end - begin) * outputWidth);
+        for (size_t outRow = begin; outRow < end; ++outRow)
+        {
+            size_t column = 0;
+            auto store = [&](std::string_view value) { block.cells.push_back(block.Store(column++, value)); };
+
+            const CSVRow source = rows[rowSources[outRow]];
+            for (int index : indexColumns)
+            {
+                store(CellAt(source, index));
+            }
+
+            if (takeFirst)
+            {
+                auto& cells = firstCells[outRow];
+                cells.resize(pivotValues.size());
+                for (std::string_view cell : cells)
+                {
+                    store(cell);
+                }
+                continue;
+            }
+
+            const auto& rowSums = sums[outRow];
+            const auto& rowCounts = counts[outRow];
+            for (size_t c = 0; c < pivotValues.size(); ++c)
+            {
+                size_t count = c < rowCounts.size() ? rowCounts[c] : 0;
+                if (count == 0)
+                {
+                    store(spec.aggregate == "count" ? "0" : "");
+                }
+                else if (spec.aggregate == "count")
+                {
+                    store(std::to_string(count));
+                }
+                else if (spec.aggregate == "mean")
+                {
+                    store(FormatNumber(rowSums[c] / static_cast<double>(count)));
+                }
+                else
+                {
+                    store(FormatNumber(rowSums[c]));
+                }
+            }
+        }
+    });
+
+    output.Clear();
+    output.SetHeaders(outputHeaders);
+    output.SetCellBlocks(std::move(blocks), outputWidth);
+    return true;
+}
+
+bool ComputeUnpivot(const CSVData& input, const UnpivotSpec& spec, CSVData& output)
+{
+    const auto& headers = input.GetHeaders();
+    const auto& rows = input.GetRows();
+
+    std::vector<int> idColumns;
+    for (const auto& column : spec.idColumns)
+    {
+        int index = FindColumn(headers, column);
+        if (index < 0)
+        {
+            return false;
+        }
+        idColumns.push_back(index);
+    }
+
+    std::vector<int> valueColumns;
+    if (spec.valueColumns.empty())
+    {
+        for (size_t i = 0; i < headers.size(); ++i)
+        {
+            if (std::find(idColumns.begin(), idColumns.end(), static_cast<int>(i)) == idColumns.end())
+            {
+                valueColumns.push_back(static_cast<int>(i));
+            }
+        }
+    }
+    else
+    {
+        for (const auto& column : spec.valueColumns)
+        {
+            int index = FindColumn(headers, column);
+            if (index < 0)
+            {
+                return false;
+            }
+            valueColumns.push_back(index);
+        }
+    }
+
+    if (valueColumns.empty())
+    {
+        return false;
+    }
+
+    // 出力行数は入力行数 × 値列数で確定するため、各ブロックが書き込み先を直接持てる
+    // セル文字列は入力のアリーナを共有し、ID 列と値の列には入力のセル参照をそのまま並べる。
+    // 新たに格納するのは変数名（値列の列名）だけで済む。
+    const size_t width = valueColumns.size();
+    const size_t outputWidth = idColumns.size() + 2;
+    CellArena arena = input.GetArena();
+    std::vector<CellRef> variableNames;
+    for (int index : valueColumns)
+    {
+        variableNames.push_back(arena.Append(headers[index]));
+    }
+
+    std::vector<CellRef> cells(rows.size() * width * outputWidth);
+    ParallelFor((rows.size() + reshapeBlockRows - 1) / reshapeBlockRows, [&](size_t b) {
+        size_t begin = b * reshapeBlockRows;
+        size_t end = std::min(rows.size(), begin + reshapeBlockRows);
+        CellRef* out = cells.data() + begin * width * outputWidth;
+        for (size_t r = begin; r < end; ++r)
+        {
+            const CSVRow source = rows[r];
+            for (size_t v = 0; v < width; ++v)
+            {
+                for (int index : idColumns)
+                {
+                    *out++ = RefAt(source, index);
+                }
+                *out++ = variableNames[v];
+                *out++ = RefAt(source, valueColumns[v]);
+            }
+        }
+    });
+
+    std::vector<std::string> outputHeaders = spec.idColumns;
+    outputHeaders.push_back(spec.variableColumn);
+    outputHeaders.push_back(spec.valueColumn);
+
+    output.Clear();
+    output.SetHeaders(outputHeaders);
+    output.SetCells(std::move(arena), std::move(cells), outputWidth);
+    return true;
+}
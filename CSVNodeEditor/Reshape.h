@@ -0,0 +1,34 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <string>
+#include <vector>
+
+// ピボット（縦持ち→横持ち）の設定
+struct PivotSpec
+{
+    std::vector<std::string> indexColumns; // 出力行を識別する列
+    std::string pivotColumn;               // 値が出力列名になる列
+    std::string valueColumn;               // セルに配置する値の列
+    std::string aggregate = "first";       // "first", "sum", "count", "mean"
+};
+
+// アンピボット（横持ち→縦持ち）の設定
+struct UnpivotSpec
+{
+    std::vector<std::string> idColumns;    // そのまま残す列
+    std::vector<std::string> valueColumns; // 縦持ちにする列（空の場合は idColumns 以外のすべて）
+    std::string variableColumn = "variable";
+    std::string valueColumn = "value";
+};
+
+// ピボット値と出力行をハッシュで発見しながら1パスで出力セルを埋める
+// first は空の値も最初の値として扱う。インデックス列名と重なるピボット値の列名には "_ピボット列名" を付ける。
+bool ComputePivot(const CSVData& input, const PivotSpec& spec, CSVData& output);
+
+// 出力サイズを事前に確定し、入力行ブロックごとに並列で出力行を生成する
+// 出力は入力のアリーナを共有し、ID 列と値の列は入力のセル参照をそのまま使う（複写するのは変数名だけ）。
+bool ComputeUnpivot(const CSVData& input, const UnpivotSpec& spec, CSVData& output);
+
+// "a, b, c" 形式の列名リストを分解する
+std::vector<std::string> SplitColumnList(const std::string& text);
@@ -0,0 +1,985 @@
+﻿#include "RowStorage.h"
+#include <bitset>
+#include <cstring>
+#include <unordered_set>
+
+CellRefStore::CellRefStore()
+    : writeData(nullptr)
+    , writeUsed(0)
+    , writeCapacity(0)
+    , nextChunkCells(minChunkCells)
+    , reservedBytes(0)
+{
+}
+
+CellRefStore::CellRefStore(const CellRefStore& other)
+    : owners(other.owners)
+    , writeData(nullptr)
+    , writeUsed(0)
+    , writeCapacity(0)
+    , nextChunkCells(other.nextChunkCells)
+    , reservedBytes(other.reservedBytes)
+{
+    // 共有したチャンクには書き込まない（複製元は自分の書き込み位置より後ろにだけ追記する）
+}
+
+CellRefStore::CellRefStore(CellRefStore&& other) noexcept
+    : CellRefStore()
+{
+    Swap(other);
+}
+
+CellRefStore& CellRefStore::operator=(const CellRefStore& other)
+{
+    if (this != &other)
+    {
+        CellRefStore copy(other);
+        Swap(copy);
+    }
+    return *this;
+}
+
+CellRefStore& CellRefStore::operator=(CellRefStore&& other) noexcept
+{
+    if (this != &other)
+    {
+        Clear();
+        Swap(other);
+    }
+    return *this;
+}
+
+void CellRefStore::Swap(CellRefStore& other) noexcept
+{
+    owners.swap(other.owners);
+    std::swap(writeData, other.writeData);
+    std::swap(writeUsed, other.writeUsed);
+    std::swap(writeCapacity, other.writeCapacity);
+    std::swap(nextChunkCells, other.nextChunkCells);
+    std::swap(reservedBytes, other.reservedBytes);
+}
+
+CellRef* CellRefStore::Allocate(size_t count)
+{
+    if (writeData == nullptr || writeCapacity - writeUsed < count)
+    {
+        // 行はチャンクをまたがないため、残りに収まらなければ新しいチャンクに移る
+        const size_t capacity = std::max(nextChunkCells, count);
+        std::shared_ptr<CellRef[]> chunk(new CellRef[capacity]);
+        writeData = chunk.get();
+        writeUsed = 0;
+        writeCapacity = capacity;
+        reservedBytes += capacity * sizeof(CellRef);
+        owners.push_back(std::move(chunk));
+        nextChunkCells = std::min(chunkCells, nextChunkCells * 2);
+    }
+    CellRef* result = writeData + writeUsed;
+    writeUsed += count;
+    return result;
+}
+
+const CellRef* CellRefStore::Adopt(std::vector<CellRef>&& refs)
+{
+    auto holder = std::make_shared<std::vector<CellRef>>(std::move(refs));
+    reservedBytes += holder->capacity() * sizeof(CellRef);
+    const CellRef* data = holder->data();
+    owners.push_back(std::move(holder));
+    return data;
+}
+
+const CellRef* CellRefStore::Attach(const CellRef* refs, std::shared_ptr<const void> owner)
+{
+    owners.push_back(std::move(owner));
+    return refs;
+}
+
+void CellRefStore::Clear()
+{
+    std::vector<std::shared_ptr<const void>>().swap(owners);
+    writeData = nullptr;
+    writeUsed = 0;
+    writeCapacity = 0;
+    nextChunkCells = minChunkCells;
+    reservedBytes = 0;
+}
+
+RowSpanList::RowSpanList()
+    : height(0)
+    , rowCount(0)
+    , chunkCount(0)
+    , uniform(true)
+    , leafTable(nullptr)
+    , leafCapacity(0)
+{
+}
+
+namespace
+{
+    // 木のチャンクを順にたどる
+    template <typename Node, typename Visit>
+    void VisitChunks(const Node& node, size_t level, Visit& visit)
+    {
+        for (size_t i = 0; i < node.count; ++i)
+        {
+            if (level == 1)
+            {
+                visit(node.chunks[i]);
+            }
+            else
+            {
+                VisitChunks(*node.children[i], level - 1, visit);
+            }
+        }
+    }
+
+    // 木のノードを行きがけ順にたどる（visit が false を返したノードの子はたどらない）
+    template <typename Node, typename Visit>
+    void VisitNodes(const Node& node, size_t level, Visit& visit)
+    {
+        if (!visit(node, level) || level == 1)
+        {
+            return;
+        }
+        for (size_t i = 0; i < node.count; ++i)
+        {
+            VisitNodes(*node.children[i], level - 1, visit);
+        }
+    }
+}
+
+std::shared_ptr<RowSpanList::Chunk> RowSpanList::NewChunk(size_t capacity)
+{
+    auto chunk = std::make_shared<Chunk>();
+    chunk->spans.reset(new RowSpan[capacity]);
+    chunk->capacity = static_cast<uint32_t>(capacity);
+    return chunk;
+}
+
+RowSpanList::ChunkRef RowSpanList::MakeRef(std::shared_ptr<Chunk>&& chunk, size_t count)
+{
+    ChunkRef ref;
+    ref.spans = chunk->spans.get();
+    ref.chunk = std::move(chunk);
+    ref.count = static_cast<uint32_t>(count);
+    return ref;
+}
+
+bool RowSpanList::IsFragmented(size_t chunks, size_t rows)
+{
+    // 最小のチャンク数より 1/8（少なくとも maxChunkSkew 個）以上多ければ断片化しているとみなす
+    const size_t minimum = (rows + chunkRows - 1) / chunkRows;
+    return chunks > minimum + std::max(maxChunkSkew, minimum / 8);
+}
+
+void RowSpanList::UpdateEnds(Node& node, size_t level, size_t firstIndex)
+{
+    size_t end = firstIndex > 0 ? node.ends[firstIndex - 1] : 0;
+    for (size_t i = firstIndex; i < node.count; ++i)
+    {
+        end += level == 1 ? node.chunks[i].count : NodeRows(*node.children[i]);
+        node.ends[i] = end;
+    }
+}
+
+RowSpanList::Node* RowSpanList::Writable(std::shared_ptr<Node>& node)
+{
+    if (node.use_count() > 1)
+    {
+        auto copy = std::make_shared<Node>();
+        copy->count = node->count;
+        std::copy(node->ends, node->ends + node->count, copy->ends);
+        std::copy(node->children, node->children + node->count, copy->children);
+        std::copy(node->chunks, node->chunks + node->count, copy->chunks);
+        node = std::move(copy);
+    }
+    return node.get();
+}
+
+RowSpanList::Chunk& RowSpanList::MakeWritable(ChunkRef& ref, size_t capacity)
+{
+    // 共有しているチャンクと容量の足りないチャンクは複製する
+    if (ref.chunk.use_count() > 1 || ref.chunk->capacity < capacity)
+    {
+        auto copy = NewChunk(std::max<size_t>(ref.chunk->capacity, capacity));
+        std::memcpy(copy->spans.get(), ref.spans, ref.count * sizeof(RowSpan));
+        ref.spans = copy->spans.get();
+        ref.chunk = std::move(copy);
+    }
+    ref.chunk->used.store(ref.count);
+    return *ref.chunk;
+}
+
+const RowSpan** RowSpanList::WritableLeafSpans(size_t count)
+{
+    if (!leafSpans || leafSpans.use_count() > 1 || leafCapacity < count)
+    {
+        const size_t capacity = leafCapacity >= count ? leafCapacity : std::max<size_t>({ count, leafCapacity * 2, 16 });
+        std::shared_ptr<const RowSpan*[]> table(new const RowSpan*[capacity]);
+        if (leafSpans)
+        {
+            std::copy(leafSpans.get(), leafSpans.get() + chunkCount, table.get());
+        }
+        leafSpans = std::move(table);
+        leafCapacity = capacity;
+        leafTable = leafSpans.get();
+    }
+    return leafSpans.get();
+}
+
+void RowSpanList::SetLeafSpans(size_t chunk, const RowSpan* spans)
+{
+    if (leafTable[chunk] != spans)
+    {
+        WritableLeafSpans(chunkCount)[chunk] = spans;
+    }
+}
+
+void RowSpanList::ReleaseLeafSpans()
+{
+    leafSpans.reset();
+    leafTable = nullptr;
+    leafCapacity = 0;
+}
+
+void RowSpanList::Build(std::vector<ChunkRef>&& leaves)
+{
+    clear();
+    if (leaves.empty())
+    {
+        return;
+    }
+
+    chunkCount = leaves.size();
+    for (size_t i = 0; i + 1 < leaves.size(); ++i)
+    {
+        if (leaves[i].count != chunkRows)
+        {
+            uniform = false;
+            break;
+        }
+    }
+    if (uniform)
+    {
+        const RowSpan** table = WritableLeafSpans(leaves.size());
+        for (size_t i = 0; i < leaves.size(); ++i)
+        {
+            table[i] = leaves[i].spans;
+        }
+    }
+
+    // nodeFanout 個ずつ左から詰めて下の段から作る
+    std::vector<std::shared_ptr<Node>> nodes;
+    for (size_t begin = 0; begin < leaves.size(); begin += nodeFanout)
+    {
+        auto node = std::make_shared<Node>();
+        node->count = static_cast<uint32_t>(std::min(nodeFanout, leaves.size() - begin));
+        std::move(leaves.begin() + begin, leaves.begin() + begin + node->count, node->chunks);
+        UpdateEnds(*node, 1, 0);
+        nodes.push_back(std::move(node));
+    }
+    height = 1;
+    while (nodes.size() > 1)
+    {
+        ++height;
+        std::vector<std::shared_ptr<Node>> parents;
+        for (size_t begin = 0; begin < nodes.size(); begin += nodeFanout)
+        {
+            auto parent = std::make_shared<Node>();
+            parent->count = static_cast<uint32_t>(std::min(nodeFanout, nodes.size() - begin));
+            std::move(nodes.begin() + begin, nodes.begin() + begin + parent->count, parent->children);
+            UpdateEnds(*parent, height, 0);
+            parents.push_back(std::move(parent));
+        }
+        nodes.swap(parents);
+    }
+    root = std::move(nodes[0]);
+    rowCount = NodeRows(*root);
+}
+
+std::vector<RowSpanList::ChunkRef> RowSpanList::TakeChunks()
+{
+    // 木を手放してから返すため、他の並びと共有していないチャンクはその場で書き換えられる
+    std::vector<ChunkRef> leaves;
+    leaves.reserve(chunkCount);
+    if (root)
+    {
+        auto collect = [&](const ChunkRef& ref) { leaves.push_back(ref); };
+        VisitChunks(*root, height, collect);
+    }
+    clear();
+    return leaves;
+}
+
+const RowSpan* RowSpanList::Locate(size_t row, const RowSpan*& runEnd) const
+{
+    if (leafTable)
+    {
+        const size_t chunk = row / chunkRows;
+        runEnd = leafTable[chunk] + std::min(chunkRows, rowCount - chunk * chunkRows);
+        return leafTable[chunk] + row % chunkRows;
+    }
+    const Node* node = root.get();
+    for (size_t level = height; level > 1; --level)
+    {
+        const size_t index = FindChild(*node, row, level);
+        row -= index > 0 ? node->ends[index - 1] : 0;
+        node = node->children[index].get();
+    }
+    const size_t index = FindChild(*node, row, 1);
+    const ChunkRef& chunk = node->chunks[index];
+    runEnd = chunk.spans + chunk.count;
+    return chunk.spans + (row - (index > 0 ? node->ends[index - 1] : 0));
+}
+
+void RowSpanList::AppendChunk(std::shared_ptr<Chunk>&& chunk, size_t count)
+{
+    ChunkRef ref = MakeRef(std::move(chunk), count);
+    const RowSpan* spans = ref.spans;
+    if (!root)
+    {
+        WritableLeafSpans(1)[0] = spans;
+        root = std::make_shared<Node>();
+        root->count = 1;
+        root->ends[0] = count;
+        root->chunks[0] = std::move(ref);
+        height = 1;
+        rowCount = count;
+        chunkCount = 1;
+        uniform = true;
+        return;
+    }
+
+    // 右端の経路を書き込めるようにして下る
+    Node* path[maxHeight + 2];
+    Node* node = Writable(root);
+    path[height] = node;
+    for (size_t level = height; level > 1; --level)
+    {
+        node = Writable(node->children[node->count - 1]);
+        path[level - 1] = node;
+    }
+    uniform = uniform && node->chunks[node->count - 1].count == chunkRows;
+    if (uniform)
+    {
+        WritableLeafSpans(chunkCount + 1)[chunkCount] = spans;
+    }
+    else
+    {
+        ReleaseLeafSpans();
+    }
+
+    // 子に空きのある最も深いノードに新しいチャンクへ至る枝を足す（無ければ根を 1 段増やす）
+    size_t level = 1;
+    while (level <= height && path[level]->count == nodeFanout)
+    {
+        ++level;
+    }
+    if (level > height)
+    {
+        auto newRoot = std::make_shared<Node>();
+        newRoot->count = 1;
+        newRoot->ends[0] = rowCount;
+        newRoot->children[0] = std::move(root);
+        root = std::move(newRoot);
+        ++height;
+        path[height] = root.get();
+    }
+
+    std::shared_ptr<Node> branch;
+    if (level > 1)
+    {
+        branch = std::make_shared<Node>();
+        branch->count = 1;
+        branch->ends[0] = count;
+        branch->chunks[0] = std::move(ref);
+        for (size_t l = 2; l < level; ++l)
+        {
+            auto parent = std::make_shared<Node>();
+            parent->count = 1;
+            parent->ends[0] = count;
+            parent->children[0] = std::move(branch);
+            branch = std::move(parent);
+        }
+    }
+    Node& target = *path[level];
+    if (level == 1)
+    {
+        target.chunks[target.count] = std::move(ref);
+    }
+    else
+    {
+        target.children[target.count] = std::move(branch);
+    }
+    target.ends[target.count] = NodeRows(target) + count;
+    ++target.count;
+    for (size_t l = level + 1; l <= height; ++l)
+    {
+        path[l]->ends[path[l]->count - 1] += count;
+    }
+    rowCount += count;
+    ++chunkCount;
+}
+
+void RowSpanList::push_back(const RowSpan& span)
+{
+    if (root)
+    {
+        // 右端の経路を書き込めるようにして、最後のチャンクに空きがあれば追記する
+        Node* path[maxHeight + 1];
+        Node* node = Writable(root);
+        path[height] = node;
+        for (size_t level = height; level > 1; --level)
+        {
+            node = Writable(node->children[node->count - 1]);
+            path[level - 1] = node;
+        }
+
+        ChunkRef& last = node->chunks[node->count - 1];
+        if (last.count < chunkRows)
+        {
+            Chunk& chunk = *last.chunk;
+
+            // 共有しているチャンクでも、まだ誰も書き込んでいない位置なら追記できる
+            uint32_t expected = last.count;
+            if (last.count < chunk.capacity && chunk.used.compare_exchange_strong(expected, last.count + 1))
+            {
+                chunk.spans[last.count] = span;
+            }
+            else
+            {
+                // 容量が足りない、または他の共有元が先に追記していれば、倍の容量のチャンクに複写して差し替える
+                const size_t capacity = std::min<size_t>(chunkRows, std::max<size_t>(16, last.count * 2));
+                auto grown = NewChunk(capacity);
+                std::memcpy(grown->spans.get(), last.spans, last.count * sizeof(RowSpan));
+                grown->spans[last.count] = span;
+                grown->used.store(last.count + 1);
+                last.spans = grown->spans.get();
+                last.chunk = std::move(grown);
+                if (uniform)
+                {
+                    SetLeafSpans(chunkCount - 1, last.spans);
+                }
+            }
+            ++last.count;
+            for (size_t level = 1; level <= height; ++level)
+            {
+                ++path[level]->ends[path[level]->count - 1];
+            }
+            ++rowCount;
+            return;
+        }
+    }
+
+    // 最初のチャンクは小さく始め、2 つ目以降は大きな表なので最初から chunkRows 行分を確保する
+    auto chunk = NewChunk(root ? chunkRows : 16);
+    chunk->spans[0] = span;
+    chunk->used.store(1);
+    AppendChunk(std::move(chunk), 1);
+}
+
+void RowSpanList::insert(size_t row, const RowSpan& span)
+{
+    if (row >= rowCount)
+    {
+        push_back(span);
+        return;
+    }
+
+    // 根が分かれたら 1 段増やす
+    auto sibling = InsertAt(root, height, row, span);
+    if (sibling)
+    {
+        auto newRoot = std::make_shared<Node>();
+        newRoot->count = 2;
+        newRoot->children[0] = std::move(root);
+        newRoot->children[1] = std::move(sibling);
+        ++height;
+        UpdateEnds(*newRoot, height, 0);
+        root = std::move(newRoot);
+    }
+    ++rowCount;
+    uniform = false;
+    ReleaseLeafSpans();
+}
+
+std::shared_ptr<RowSpanList::Node> RowSpanList::InsertAt(std::shared_ptr<Node>& nodeRef, size_t level, size_t row, const RowSpan& span)
+{
+    Node* node = Writable(nodeRef);
+    const size_t index = FindChild(*node, row, level);
+    const size_t offset = row - (index > 0 ? node->ends[index - 1] : 0);
+    if (level > 1)
+    {
+        auto split = InsertAt(node->children[index], level - 1, offset, span);
+        if (split)
+        {
+            return InsertChild(*node, level, index + 1, std::move(split), ChunkRef());
+        }
+        for (size_t i = index; i < node->count; ++i)
+        {
+            ++node->ends[i];
+        }
+        return nullptr;
+    }
+
+    ChunkRef& leaf = node->chunks[index];
+    if (leaf.count < chunkRows)
+    {
+        const size_t capacity = leaf.count < leaf.chunk->capacity ? leaf.chunk->capacity
+            : std::min<size_t>(chunkRows, std::max<size_t>(16, leaf.count * 2));
+        Chunk& chunk = MakeWritable(leaf, capacity);
+        std::memmove(&chunk.spans[offset + 1], &chunk.spans[offset], (leaf.count - offset) * sizeof(RowSpan));
+        chunk.spans[offset] = span;
+        ++leaf.count;
+        chunk.used.store(leaf.count);
+        for (size_t i = index; i < node->count; ++i)
+        {
+            ++node->ends[i];
+        }
+        return nullptr;
+    }
+
+    // 満杯のチャンクは半分ずつの 2 つに分け、挿入する側に行を加える
+    const size_t half = chunkRows / 2;
+    const RowSpan* source = leaf.spans;
+    auto left = NewChunk(chunkRows);
+    auto right = NewChunk(chunkRows);
+    size_t leftCount = half;
+    size_t rightCount = chunkRows - half;
+    if (offset <= half)
+    {
+        std::memcpy(&left->spans[0], source, offset * sizeof(RowSpan));
+        left->spans[offset] = span;
+        std::memcpy(&left->spans[offset + 1], source + offset, (half - offset) * sizeof(RowSpan));
+        std::memcpy(&right->spans[0], source + half, rightCount * sizeof(RowSpan));
+        ++leftCount;
+    }
+    else
+    {
+        std::memcpy(&left->spans[0], source, half * sizeof(RowSpan));
+        std::memcpy(&right->spans[0], source + half, (offset - half) * sizeof(RowSpan));
+        right->spans[offset - half] = span;
+        std::memcpy(&right->spans[offset - half + 1], source + offset, (chunkRows - offset) * sizeof(RowSpan));
+        ++rightCount;
+    }
+    left->used.store(static_cast<uint32_t>(leftCount));
+    right->used.store(static_cast<uint32_t>(rightCount));
+    leaf = MakeRef(std::move(left), leftCount);
+    ++chunkCount;
+    return InsertChild(*node, 1, index + 1, nullptr, MakeRef(std::move(right), rightCount));
+}
+
+std::shared_ptr<RowSpanList::Node> RowSpanList::InsertChild(Node& node, size_t level, size_t position, std::shared_ptr<Node>&& child, ChunkRef&& chunk)
+{
+    // 満杯のノードは半分ずつに分け、分けた右側を親に返す
+    std::shared_ptr<Node> sibling;
+    Node* target = &node;
+    if (node.count == nodeFanout)
+    {
+        const size_t half = nodeFanout / 2;
+        sibling = std::make_shared<Node>();
+        sibling->count = static_cast<uint32_t>(nodeFanout - half);
+        std::move(node.children + half, node.children + nodeFanout, sibling->children);
+        std::move(node.chunks + half, node.chunks + nodeFanout, sibling->chunks);
+        node.count = static_cast<uint32_t>(half);
+        if (position > half)
+        {
+            target = sibling.get();
+            position -= half;
+        }
+    }
+
+    std::move_backward(target->children + position, target->children + target->count, target->children + target->count + 1);
+    std::move_backward(target->chunks + position, target->chunks + target->count, target->chunks + target->count + 1);
+    if (level == 1)
+    {
+        target->chunks[position] = std::move(chunk);
+    }
+    else
+    {
+        target->children[position] = std::move(child);
+    }
+    ++target->count;
+
+    if (sibling)
+    {
+        UpdateEnds(node, level, 0);
+        UpdateEnds(*sibling, level, 0);
+    }
+    else
+    {
+        UpdateEnds(node, level, position - 1);
+    }
+    return sibling;
+}
+
+void RowSpanList::erase(size_t row)
+{
+    if (row >= rowCount)
+    {
+        return;
+    }
+
+    // 最後のチャンクの行を除くだけなら木は左に詰まったまま
+    const Node* last = root.get();
+    for (size_t level = height; level > 1; --level)
+    {
+        last = last->children[last->count - 1].get();
+    }
+    const bool inLastChunk = row >= rowCount - last->chunks[last->count - 1].count;
+
+    EraseAt(root, height, row);
+    --rowCount;
+    uniform = uniform && inLastChunk;
+
+    // 空になった根と、子が 1 つだけの根を取り除く
+    if (root->count == 0)
+    {
+        clear();
+        return;
+    }
+    while (height > 1 && root->count == 1)
+    {
+        std::shared_ptr<Node> child = root->children[0];
+        root = std::move(child);
+        --height;
+    }
+
+    // 最後のチャンクは複製されていることがある
+    if (uniform)
+    {
+        last = root.get();
+        for (size_t level = height; level > 1; --level)
+        {
+            last = last->children[last->count - 1].get();
+        }
+        SetLeafSpans(chunkCount - 1, last->chunks[last->count - 1].spans);
+    }
+    else
+    {
+        ReleaseLeafSpans();
+    }
+}
+
+bool RowSpanList::EraseAt(std::shared_ptr<Node>& nodeRef, size_t level, size_t row)
+{
+    Node* node = Writable(nodeRef);
+    const size_t index = FindChild(*node, row, level);
+    const size_t offset = row - (index > 0 ? node->ends[index - 1] : 0);
+
+    bool removeChild = false;
+    if (level > 1)
+    {
+        removeChild = EraseAt(node->children[index], level - 1, offset);
+    }
+    else if (node->chunks[index].count == 1)
+    {
+        removeChild = true;
+        --chunkCount;
+    }
+    else
+    {
+        ChunkRef& leaf = node->chunks[index];
+        Chunk& chunk = MakeWritable(leaf, leaf.chunk->capacity);
+        std::memmove(&chunk.spans[offset], &chunk.spans[offset + 1], (leaf.count - offset - 1) * sizeof(RowSpan));
+        --leaf.count;
+        chunk.used.store(leaf.count);
+    }
+
+    if (removeChild)
+    {
+        std::move(node->children + index + 1, node->children + node->count, node->children + index);
+        std::move(node->chunks + index + 1, node->chunks + node->count, node->chunks + index);
+        --node->count;
+        node->children[node->count].reset();
+        node->chunks[node->count] = ChunkRef();
+        UpdateEnds(*node, level, index);
+    }
+    else
+    {
+        for (size_t i = index; i < node->count; ++i)
+        {
+            --node->ends[i];
+        }
+    }
+    return node->count == 0;
+}
+
+void RowSpanList::EraseMarked(const std::vector<uint64_t>& mask)
+{
+    auto isMarked = [&](size_t row) { return (mask[row >> 6] >> (row & 63) & 1) != 0; };
+    std::vector<ChunkRef> leaves = TakeChunks();
+
+    // チャンクごとの削除数を数える（削除の無い語は読み飛ばす）
+    std::vector<uint32_t> removedCounts(leaves.size(), 0);
+    size_t totalRows = 0;
+    size_t totalRemoved = 0;
+    size_t remainingChunks = 0;
+    for (size_t i = 0; i < leaves.size(); ++i)
+    {
+        const size_t start = totalRows;
+        const size_t end = start + leaves[i].count;
+        size_t removed = 0;
+        for (size_t word = start >> 6; word <= (end - 1) >> 6; ++word)
+        {
+            uint64_t bits = mask[word];
+            if (bits == 0)
+            {
+                continue;
+            }
+            if (word == start >> 6)
+            {
+                bits &= ~uint64_t(0) << (start & 63);
+            }
+            if (word == (end - 1) >> 6 && (end & 63) != 0)
+            {
+                bits &= ~(~uint64_t(0) << (end & 63));
+            }
+            removed += static_cast<size_t>(std::bitset<64>(bits).count());
+        }
+        removedCounts[i] = static_cast<uint32_t>(removed);
+        totalRows = end;
+        totalRemoved += removed;
+        remainingChunks += removed < leaves[i].count ? 1 : 0;
+    }
+
+    std::vector<ChunkRef> result;
+    result.reserve(remainingChunks);
+    if (IsFragmented(remainingChunks, totalRows - totalRemoved))
+    {
+        // その場で詰めると断片化する大量の削除は、残す行を満杯のチャンクに詰め直して 1 回の走査で済ませる
+        std::shared_ptr<Chunk> pending;
+        size_t pendingCount = 0;
+        size_t start = 0;
+        for (size_t i = 0; i < leaves.size(); ++i)
+        {
+            ChunkRef& ref = leaves[i];
+            if (removedCounts[i] == 0 && pendingCount == 0 && ref.count == chunkRows)
+            {
+                result.push_back(std::move(ref));
+            }
+            else
+            {
+                for (size_t offset = 0; offset < ref.count; ++offset)
+                {
+                    if (removedCounts[i] > 0 && isMarked(start + offset))
+                    {
+                        continue;
+                    }
+                    if (!pending)
+                    {
+                        pending = NewChunk(chunkRows);
+                    }
+                    pending->spans[pendingCount++] = ref.spans[offset];
+                    if (pendingCount == chunkRows)
+                    {
+                        pending->used.store(static_cast<uint32_t>(pendingCount));
+                        result.push_back(MakeRef(std::move(pending), pendingCount));
+                        pendingCount = 0;
+                    }
+                }
+            }
+            start += leaves[i].count;
+        }
+        if (pendingCount > 0)
+        {
+            pending->used.store(static_cast<uint32_t>(pendingCount));
+            result.push_back(MakeRef(std::move(pending), pendingCount));
+        }
+    }
+    else
+    {
+        // 削除を含むチャンクだけを（共有していれば複製して）その場で詰め、空になったチャンクは取り除く
+        size_t start = 0;
+        for (size_t i = 0; i < leaves.size(); ++i)
+        {
+            ChunkRef& ref = leaves[i];
+            const size_t count = ref.count;
+            if (removedCounts[i] > 0 && removedCounts[i] < count)
+            {
+                Chunk& chunk = MakeWritable(ref, ref.chunk->capacity);
+                size_t write = 0;
+                for (size_t offset = 0; offset < count; ++offset)
+                {
+                    if (!isMarked(start + offset))
+                    {
+                        chunk.spans[write++] = chunk.spans[offset];
+                    }
+                }
+                ref.count = static_cast<uint32_t>(write);
+                chunk.used.store(static_cast<uint32_t>(write));
+            }
+            if (removedCounts[i] < count)
+            {
+                result.push_back(std::move(ref));
+            }
+            start += count;
+        }
+    }
+    Build(std::move(result));
+}
+
+void RowSpanList::Compact()
+{
+    if (uniform)
+    {
+        return;
+    }
+
+    // 揃った位置にある満杯のチャンクは共有したまま残し、それ以外は書き込み中のチャンクに詰める
+    std::vector<ChunkRef> leaves = TakeChunks();
+    std::vector<ChunkRef> result;
+    result.reserve(leaves.size());
+    std::shared_ptr<Chunk> pending;
+    size_t pendingCount = 0;
+    for (auto& ref : leaves)
+    {
+        if (pendingCount == 0 && ref.count == chunkRows)
+        {
+            result.push_back(std::move(ref));
+            continue;
+        }
+        for (size_t offset = 0; offset < ref.count; )
+        {
+            if (!pending)
+            {
+                pending = NewChunk(chunkRows);
+            }
+            const size_t length = std::min<size_t>(ref.count - offset, chunkRows - pendingCount);
+            std::memcpy(&pending->spans[pendingCount], ref.spans + offset, length * sizeof(RowSpan));
+            pendingCount += length;
+            offset += length;
+            if (pendingCount == chunkRows)
+            {
+                pending->used.store(static_cast<uint32_t>(pendingCount));
+                result.push_back(MakeRef(std::move(pending), pendingCount));
+                pendingCount = 0;
+            }
+        }
+    }
+    if (pendingCount > 0)
+    {
+        pending->used.store(static_cast<uint32_t>(pendingCount));
+        result.push_back(MakeRef(std::move(pending), pendingCount));
+    }
+    Build(std::move(result));
+}
+
+void RowSpanList::set(size_t row, const RowSpan& span)
+{
+    if (row >= rowCount)
+    {
+        return;
+    }
+
+    const size_t chunkIndex = row / chunkRows;
+    Node* node = Writable(root);
+    for (size_t level = height; level > 1; --level)
+    {
+        const size_t index = FindChild(*node, row, level);
+        row -= index > 0 ? node->ends[index - 1] : 0;
+        node = Writable(node->children[index]);
+    }
+    const size_t index = FindChild(*node, row, 1);
+    ChunkRef& leaf = node->chunks[index];
+    MakeWritable(leaf, leaf.chunk->capacity).spans[row - (index > 0 ? node->ends[index - 1] : 0)] = span;
+    if (uniform)
+    {
+        SetLeafSpans(chunkIndex, leaf.spans);
+    }
+}
+
+void RowSpanList::clear()
+{
+    root.reset();
+    height = 0;
+    rowCount = 0;
+    chunkCount = 0;
+    uniform = true;
+    ReleaseLeafSpans();
+}
+
+std::vector<RowSpan> RowSpanList::ToVector() const
+{
+    std::vector<RowSpan> spans;
+    spans.reserve(rowCount);
+    if (root)
+    {
+        auto append = [&](const ChunkRef& ref) { spans.insert(spans.end(), ref.spans, ref.spans + ref.count); };
+        VisitChunks(*root, height, append);
+    }
+    return spans;
+}
+
+size_t RowSpanList::GetReservedBytes() const
+{
+    size_t bytes = 0;
+    if (root)
+    {
+        auto add = [&](const Node& node, size_t level) {
+            bytes += sizeof(Node);
+            for (size_t i = 0; level == 1 && i < node.count; ++i)
+            {
+                bytes += node.chunks[i].chunk->capacity * sizeof(RowSpan);
+            }
+            return true;
+        };
+        VisitNodes(*root, height, add);
+    }
+    return bytes + leafCapacity * sizeof(const RowSpan*);
+}
+
+size_t RowSpanList::GetBytesNotSharedWith(const RowSpanList& other) const
+{
+    if (!root)
+    {
+        return 0;
+    }
+
+    // 共有している部分木は根のノードが同じなので、other 側は共有していないノードの下だけを調べればよい
+    std::unordered_set<const Node*> ownNodes;
+    std::unordered_set<const Node*> otherNodes;
+    auto collectOwn = [&](const Node& node, size_t) { ownNodes.insert(&node); return true; };
+    VisitNodes(*root, height, collectOwn);
+
+    // other 側で共有していない最下段のノードが持つチャンク
+    std::unordered_set<const Chunk*> otherChunks;
+    if (other.root)
+    {
+        auto collectChunks = [&](const Node& node, size_t level) {
+            otherNodes.insert(&node);
+            if (ownNodes.count(&node) != 0)
+            {
+                return false;
+            }
+            for (size_t i = 0; level == 1 && i < node.count; ++i)
+            {
+                otherChunks.insert(node.chunks[i].chunk.get());
+            }
+            return true;
+        };
+        VisitNodes(*other.root, other.height, collectChunks);
+    }
+
+    size_t bytes = 0;
+    auto count = [&](const Node& node, size_t level) {
+        if (otherNodes.count(&node) != 0)
+        {
+            return false;
+        }
+        bytes += sizeof(Node);
+        for (size_t i = 0; level == 1 && i < node.count; ++i)
+        {
+            if (otherChunks.count(node.chunks[i].chunk.get()) == 0)
+            {
+                bytes += node.chunks[i].chunk->capacity * sizeof(RowSpan);
+            }
+        }
+        return true;
+    };
+    VisitNodes(*root, height, count);
+    if (leafSpans && leafSpans != other.leafSpans)
+    {
+        bytes += leafCapacity * sizeof(const RowSpan*);
+    }
+    return bytes;
+}
@@ -0,0 +1,220 @@
+﻿#pragma once
+
+#include "CellArena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// 1 行分のセル参照の位置
+struct RowSpan
+{
+    const CellRef* cells;
+    uint32_t cellCount;
+};
+
+// セル参照の追記専用の格納領域
+// 参照はチャンクに追記し、チャンクは再確保しないため、返した位置は表を置き換えるまで有効なままになる。
+// 複製はチャンクを共有し、以後の追記先だけを分ける（CellArena と同じ）。
+class CellRefStore
+{
+public:
+    static constexpr size_t minChunkCells = 256;
+    static constexpr size_t chunkCells = 65536;
+
+    CellRefStore();
+    CellRefStore(const CellRefStore& other);
+    CellRefStore(CellRefStore&& other) noexcept;
+    CellRefStore& operator=(const CellRefStore& other);
+    CellRefStore& operator=(CellRefStore&& other) noexcept;
+
+    // count 個の連続した参照の領域を確保する（書き込めるのは次に Allocate を呼ぶまで）
+    CellRef* Allocate(size_t count);
+
+    // 組み立て済みの参照の並びをそのまま 1 チャンクとして引き取り、先頭を返す
+    const CellRef* Adopt(std::vector<CellRef>&& refs);
+
+    // 外部の参照の並び（メモリマップしたファイルなど）を複写せずに使う（owner を参照する間保持する）
+    const CellRef* Attach(const CellRef* refs, std::shared_ptr<const void> owner);
+
+    void Clear();
+    size_t GetReservedBytes() const { return reservedBytes; }
+
+    void Swap(CellRefStore& other) noexcept;
+
+private:
+    std::vector<std::shared_ptr<const void>> owners;
+    CellRef* writeData;
+    size_t writeUsed;
+    size_t writeCapacity;
+    size_t nextChunkCells;                  // 小さな表で大きなチャンクを確保しないよう、倍々に大きくする
+    size_t reservedBytes;
+};
+
+// 行の位置の永続的な並び（チャンクを葉とする B+ 木）
+// 行は最大 chunkRows 行のチャンクに持ち、内部ノードは最大 nodeFanout 個の子と子ごとの累積行数を持つ。
+// 行の位置の参照・挿入・削除・置き換えは木の高さに比例する O(log n) で済み、変更する経路上のノードとチャンクだけを
+// 複製する（copy-on-write）。複製は根の共有だけで済むため、編集履歴の 1 ステップは変更した経路とチャンクの大きさになる。
+// 読み込みや末尾への追加で作った木は最後以外のチャンクが満杯で左に詰まっているため、チャンクの先頭の表も持ち、
+// 行の位置を表引き 2 回で求める（表は複製と共有し、共有中に書き換えるときだけ複写する）。
+class RowSpanList
+{
+public:
+    static constexpr size_t chunkBits = 12;
+    static constexpr size_t chunkRows = size_t(1) << chunkBits;
+    static constexpr size_t fanoutBits = 6;
+    static constexpr size_t nodeFanout = size_t(1) << fanoutBits;
+    static constexpr size_t maxChunkSkew = 4;       // 子を探すとき推定位置から先へたどる数（超えたら二分探索）
+    static constexpr size_t maxHeight = 8;
+
+    RowSpanList();
+
+    size_t size() const { return rowCount; }
+    bool empty() const { return rowCount == 0; }
+
+    const RowSpan& operator[](size_t row) const
+    {
+        if (leafTable)
+        {
+            return leafTable[row / chunkRows][row % chunkRows];
+        }
+        const Node* node = root.get();
+        for (size_t level = height; level > 1; --level)
+        {
+            const size_t index = FindChild(*node, row, level);
+            row -= index > 0 ? node->ends[index - 1] : 0;
+            node = node->children[index].get();
+        }
+        const size_t index = FindChild(*node, row, 1);
+        return node->chunks[index].spans[row - (index > 0 ? node->ends[index - 1] : 0)];
+    }
+
+    // row の位置を返し、同じチャンクで続く行の位置の終端を runEnd に設定する（順に走査するときに使う）
+    const RowSpan* Locate(size_t row, const RowSpan*& runEnd) const;
+
+    void push_back(const RowSpan& span);
+    void insert(size_t row, const RowSpan& span);
+    void erase(size_t row);
+    void set(size_t row, const RowSpan& span);
+    void clear();
+
+    // count 行を make(i) で作り直す
+    template <typename Make>
+    void Generate(size_t count, Make make)
+    {
+        clear();
+        std::vector<ChunkRef> leaves;
+        leaves.reserve((count + chunkRows - 1) / chunkRows);
+        for (size_t begin = 0; begin < count; begin += chunkRows)
+        {
+            const size_t length = std::min(chunkRows, count - begin);
+            auto chunk = NewChunk(length);
+            for (size_t i = 0; i < length; ++i)
+            {
+                chunk->spans[i] = make(begin + i);
+            }
+            chunk->used.store(static_cast<uint32_t>(length));
+            leaves.push_back(MakeRef(std::move(chunk), length));
+        }
+        Build(std::move(leaves));
+    }
+
+    // mask のビットが立っている行をまとめて取り除く（mask は size() ビット以上）
+    // 削除を含むチャンクだけをその場で詰め（共有しているチャンクは複製する）、その結果が断片化する大量の削除なら
+    // 残す行を満杯のチャンクに詰め直す。どちらも 1 回の走査で済む。
+    void EraseMarked(const std::vector<uint64_t>& mask);
+
+    // 満杯でないチャンクが増え、割り算で行の位置を求められない部分が広がったか
+    bool IsFragmented() const { return IsFragmented(chunkCount, rowCount); }
+
+    // 行を chunkRows 行ずつのチャンクに詰め直す（先頭から揃っている満杯のチャンクは共有したまま残す）
+    void Compact();
+
+    std::vector<RowSpan> ToVector() const;
+
+    // ノード・チャンク・チャンクの先頭の表が占めるバイト数
+    size_t GetReservedBytes() const;
+
+    // other と共有していないノード・チャンク・表のバイト数（編集履歴の使用量の計算に使う）
+    size_t GetBytesNotSharedWith(const RowSpanList& other) const;
+
+private:
+    struct Chunk
+    {
+        std::unique_ptr<RowSpan[]> spans;
+        uint32_t capacity = 0;
+        std::atomic<uint32_t> used{ 0 };    // いずれかの共有元が書き込んだ行数（これより後ろにだけ追記できる）
+    };
+
+    struct ChunkRef
+    {
+        std::shared_ptr<Chunk> chunk;
+        const RowSpan* spans = nullptr;     // chunk->spans（参照時の間接参照を 1 段減らす）
+        uint32_t count = 0;                 // この並びから見える行数
+    };
+
+    struct Node
+    {
+        uint32_t count = 0;                             // 子の数
+        size_t ends[nodeFanout];                        // 子ごとの累積行数
+        std::shared_ptr<Node> children[nodeFanout];     // 最下段以外の子
+        ChunkRef chunks[nodeFanout];                    // 最下段の子
+    };
+
+    std::shared_ptr<Node> root;
+    size_t height;                          // 内部ノードの段数（最下段が 1、空なら 0）
+    size_t rowCount;
+    size_t chunkCount;
+    bool uniform;                           // 最後以外のチャンクがすべて満杯で、木が左に詰まっている
+    std::shared_ptr<const RowSpan*[]> leafSpans;    // uniform の間だけ持つ、チャンクごとの先頭の位置
+    const RowSpan* const* leafTable;        // leafSpans.get()（uniform でなければ nullptr）
+    size_t leafCapacity;
+
+    static std::shared_ptr<Chunk> NewChunk(size_t capacity);
+    static ChunkRef MakeRef(std::shared_ptr<Chunk>&& chunk, size_t count);
+    static bool IsFragmented(size_t chunks, size_t rows);
+
+    // level 段のノードで row を含む子の番号
+    // 子は 1 段下の容量（chunkRows * nodeFanout^(level - 1) 行）以下しか持たないため、row / 容量 以降にあり、
+    // 満杯でない子が少なければ数個先で見つかる。
+    static size_t FindChild(const Node& node, size_t row, size_t level)
+    {
+        size_t index = std::min<size_t>(row >> (chunkBits + fanoutBits * (level - 1)), node.count - 1);
+        for (size_t step = 0; step < maxChunkSkew; ++step, ++index)
+        {
+            if (node.ends[index] > row)
+            {
+                return index;
+            }
+        }
+
+        // 残りは分岐の無い二分探索（挿入で分かれた子の多いノードでは推定が外れやすく、分岐の予測も外れる）
+        const size_t* base = node.ends + index;
+        for (size_t length = node.count - index; length > 1; )
+        {
+            const size_t half = length / 2;
+            base = base[half - 1] <= row ? base + half : base;
+            length -= half;
+        }
+        return static_cast<size_t>(base - node.ends) + (*base <= row ? 1 : 0);
+    }
+
+    static size_t NodeRows(const Node& node) { return node.count > 0 ? node.ends[node.count - 1] : 0; }
+    static void UpdateEnds(Node& node, size_t level, size_t firstIndex);
+    static Node* Writable(std::shared_ptr<Node>& node);
+    static Chunk& MakeWritable(ChunkRef& ref, size_t capacity);
+
+    // チャンクの先頭の表を count 個以上書き込めるようにする（共有していれば複写する）
+    const RowSpan** WritableLeafSpans(size_t count);
+    void SetLeafSpans(size_t chunk, const RowSpan* spans);
+    void ReleaseLeafSpans();
+
+    void Build(std::vector<ChunkRef>&& leaves);
+    std::vector<ChunkRef> TakeChunks();
+    void AppendChunk(std::shared_ptr<Chunk>&& chunk, size_t count);
+    std::shared_ptr<Node> InsertAt(std::shared_ptr<Node>& node, size_t level, size_t row, const RowSpan& span);
+    std::shared_ptr<Node> InsertChild(Node& node, size_t level, size_t position, std::shared_ptr<Node>&& child, ChunkRef&& chunk);
+    bool EraseAt(std::shared_ptr<Node>& node, size_t level, size_t row);
+};
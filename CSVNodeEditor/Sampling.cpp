@@ -0,0 +1,443 @@
+﻿#include "Sampling.h"
+#include "CompressedInput.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+ReservoirSampler::ReservoirSampler(size_t capacity, uint64_t seed)
+    : capacity(capacity)
+    , seen(0)
+    , nextAccept(0)
+    , weight(1.0)
+    , random(seed)
+{
+}
+
+double ReservoirSampler::NextUniform()
+{
+    // log(0) を避けるため (0, 1) の範囲で生成する
+    std::uniform_real_distribution<double> distribution(std::nextafter(0.0, 1.0), 1.0);
+    return distribution(random);
+}
+
+void ReservoirSampler::AdvanceSkip()
+{
+    double skip = std::floor(std::log(NextUniform()) / std::log1p(-weight));
+    if (!(skip < static_cast<double>(std::numeric_limits<size_t>::max() - seen)))
+    {
+        nextAccept = std::numeric_limits<size_t>::max();
+        return;
+    }
+    nextAccept = seen + static_cast<size_t>(skip);
+}
+
+size_t ReservoirSampler::Offer()
+{
+    if (capacity == 0)
+    {
+        return npos;
+    }
+
+    size_t index = seen++;
+    if (index < capacity)
+    {
+        // 貯水池が埋まった時点で最初の読み飛ばし量を決める
+        if (seen == capacity)
+        {
+            weight = std::exp(std::log(NextUniform()) / static_cast<double>(capacity));
+            AdvanceSkip();
+        }
+        return index;
+    }
+
+    if (index != nextAccept)
+    {
+        return npos;
+    }
+
+    size_t slot = static_cast<size_t>(random() % capacity);
+    weight *= std::exp(std::log(NextUniform()) / static_cast<double>(capacity));
+    AdvanceSkip();
+    return slot;
+}
+
+namespace
+{
+    // 比例割り当てで保持する行数は標本サイズのこの倍数まで（層ごとの取り分の揺らぎを吸収する）
+    const size_t proportionalOversampling = 2;
+
+    struct SampledRow
+    {
+        size_t sourceIndex = 0;
+        size_t stratum = 0;             // 層の出現順の番号
+        std::vector<std::string> cells;
+    };
+
+    // 1つの層（層別しない場合は全体）
+    struct Stratum
+    {
+        Stratum(size_t capacity, uint64_t seed)
+            : sampler(capacity, seed)
+            , seen(0)
+        {
+        }
+
+        // 各層抽出では層の標本、比例割り当てでは層から 1 行を保証するための予備（容量 1）
+        ReservoirSampler sampler;
+        std::vector<SampledRow> rows;
+        size_t seen;
+    };
+
+    // 最大剰余法で合計がちょうど total になるよう重みに比例して割り当てる（各層の上限は limits）
+    // 同じ剰余の層は出現順に優先する。上限で割り当てきれなかった分は残りの層に配り直す。
+    std::vector<size_t> AllocateLargestRemainder(const std::vector<double>& weights, const std::vector<size_t>& limits, size_t total)
+    {
+        const size_t count = weights.size();
+        std::vector<size_t> quotas(count, 0);
+        size_t capacity = 0;
+        for (size_t limit : limits)
+        {
+            capacity += limit;
+        }
+        size_t remaining = std::min(total, capacity);
+        while (remaining > 0)
+        {
+            double weightSum = 0.0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (quotas[i] < limits[i])
+                {
+                    weightSum += weights[i];
+                }
+            }
+
+            std::vector<std::pair<double, size_t>> remainders;
+            size_t given = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (quotas[i] >= limits[i])
+                {
+                    continue;
+                }
+                // 重みが残っていなければ空きのある層に均等に配る
+                const double exact = weightSum > 0.0
+                    ? static_cast<double>(remaining) * weights[i] / weightSum
+                    : 0.0;
+                const size_t whole = std::min(static_cast<size_t>(exact), limits[i] - quotas[i]);
+                quotas[i] += whole;
+                given += whole;
+                if (quotas[i] < limits[i])
+                {
+                    remainders.emplace_back(weightSum > 0.0 ? exact - std::floor(exact) : 0.0, i);
+                }
+            }
+            std::stable_sort(remainders.begin(), remainders.end(),
+                [](const std::pair<double, size_t>& a, const std::pair<double, size_t>& b) { return a.first > b.first; });
+
+            remaining -= given;
+            for (const auto& remainder : remainders)
+            {
+                if (remaining == 0)
+                {
+                    break;
+                }
+                ++quotas[remainder.second];
+                --remaining;
+            }
+        }
+        return quotas;
+    }
+
+    // 層ごとの貯水池を管理し、最後に元の行順で標本を取り出す
+    // 比例割り当てでは、全体から標本サイズの 2 倍の一様標本を保持し、各層の取り分をその中の層内の行から取る。
+    // 層ごとに貯水池を持たないため、層が多くても解析して保持する行は標本サイズに比例する量に収まる。
+    class StratifiedReservoir
+    {
+    public:
+        explicit StratifiedReservoir(const SampleSpec& spec)
+            : spec(spec)
+            , proportional(!spec.stratifyColumn.empty() && !spec.perStratum)
+            , global(proportional ? spec.sampleSize * proportionalOversampling : 0, spec.seed)
+            , keepBackups(proportional)
+            , acceptedCount(0)
+        {
+        }
+
+        // 行を採用する場合は true を返す。続けて StoreCells で行のセルを渡す
+        bool Offer(std::string_view key, size_t sourceIndex)
+        {
+            acceptedCount = 0;
+
+            // 検索用のキーはバッファを使い回し、行ごとに文字列を確保しない
+            lookupKey.assign(key.data(), key.size());
+            auto it = lookup.find(lookupKey);
+            size_t index = 0;
+            if (it == lookup.end())
+            {
+                // 層ごとのシードは層の出現順から決め、結果を決定的にする
+                index = strata.size();
+                uint64_t stratumSeed = spec.seed + 0x9E3779B97F4A7C15ull * (index + 1);
+                size_t capacity = proportional ? (keepBackups ? 1 : 0) : spec.sampleSize;
+                strata.push_back(std::make_unique<Stratum>(capacity, stratumSeed));
+                lookup.emplace(lookupKey, index);
+
+                if (keepBackups && strata.size() > spec.sampleSize)
+                {
+                    // 層が標本サイズより多ければ各層 1 行の保証はできないため、予備を捨てて保持する行を抑える
+                    keepBackups = false;
+                    for (auto& stratum : strata)
+                    {
+                        std::vector<SampledRow>().swap(stratum->rows);
+                    }
+                }
+            }
+            else
+            {
+                index = it->second;
+            }
+
+            Stratum& stratum = *strata[index];
+            ++stratum.seen;
+            if (proportional)
+            {
+                Accept(global.Offer(), globalRows, sourceIndex, index);
+            }
+            if (!proportional || keepBackups)
+            {
+                Accept(stratum.sampler.Offer(), stratum.rows, sourceIndex, index);
+            }
+            return acceptedCount > 0;
+        }
+
+        // 直前に採用した行のセルを格納する
+        void StoreCells(std::vector<std::string>&& cells)
+        {
+            if (acceptedCount == 2)
+            {
+                accepted[1]->cells = cells;
+            }
+            if (acceptedCount > 0)
+            {
+                accepted[0]->cells = std::move(cells);
+            }
+        }
+
+        std::vector<SampledRow> Take()
+        {
+            std::vector<SampledRow> result;
+            if (!proportional)
+            {
+                for (auto& stratum : strata)
+                {
+                    for (auto& row : stratum->rows)
+                    {
+                        result.push_back(std::move(row));
+                    }
+                }
+            }
+            else
+            {
+                TakeProportional(result);
+            }
+
+            std::sort(result.begin(), result.end(),
+                [](const SampledRow& a, const SampledRow& b) { return a.sourceIndex < b.sourceIndex; });
+            return result;
+        }
+
+    private:
+        const SampleSpec& spec;
+        const bool proportional;
+        ReservoirSampler global;
+        std::vector<SampledRow> globalRows;
+        bool keepBackups;
+        std::vector<std::unique_ptr<Stratum>> strata;
+        std::unordered_map<std::string, size_t> lookup;
+        std::string lookupKey;
+        SampledRow* accepted[2];
+        size_t acceptedCount;
+
+        void Accept(size_t slot, std::vector<SampledRow>& rows, size_t sourceIndex, size_t stratum)
+        {
+            if (slot == ReservoirSampler::npos)
+            {
+                return;
+            }
+            if (slot >= rows.size())
+            {
+                rows.resize(slot + 1);
+            }
+            rows[slot].sourceIndex = sourceIndex;
+            rows[slot].stratum = stratum;
+            rows[slot].cells.clear();
+            accepted[acceptedCount++] = &rows[slot];
+        }
+
+        void TakeProportional(std::vector<SampledRow>& result)
+        {
+            // 全体の一様標本を層ごとに分ける（各層の行はその層の一様標本になる）
+            const size_t count = strata.size();
+            std::vector<std::vector<SampledRow>> candidates(count);
+            size_t totalSeen = 0;
+            for (auto& row : globalRows)
+            {
+                candidates[row.stratum].push_back(std::move(row));
+            }
+            for (size_t i = 0; i < count; ++i)
+            {
+                totalSeen += strata[i]->seen;
+                if (candidates[i].empty() && keepBackups && !strata[i]->rows.empty())
+                {
+                    candidates[i].push_back(std::move(strata[i]->rows[0]));
+                }
+            }
+
+            // 合計がちょうど標本サイズになるよう最大剰余法で割り当てる
+            const size_t target = std::min(spec.sampleSize, totalSeen);
+            std::vector<double> weights(count);
+            std::vector<size_t> limits(count);
+            for (size_t i = 0; i < count; ++i)
+            {
+                weights[i] = static_cast<double>(strata[i]->seen);
+                limits[i] = candidates[i].size();
+            }
+            std::vector<size_t> quotas = AllocateLargestRemainder(weights, limits, target);
+
+            // 層の数が標本サイズ以下なら、割り当てのない層には最も多く割り当てた層から 1 行を回す
+            if (count <= target)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (quotas[i] > 0)
+                    {
+                        continue;
+                    }
+                    auto largest = std::max_element(quotas.begin(), quotas.end());
+                    --*largest;
+                    quotas[i] = 1;
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                std::vector<SampledRow>& rows = candidates[i];
+                const size_t quota = std::min(rows.size(), quotas[i]);
+                std::mt19937_64 shuffle(spec.seed ^ (0x9E3779B97F4A7C15ull * (i + 1)));
+                std::shuffle(rows.begin(), rows.end(), shuffle);
+                for (size_t j = 0; j < quota; ++j)
+                {
+                    result.push_back(std::move(rows[j]));
+                }
+            }
+        }
+    };
+
+    int FindColumn(const std::vector<std::string>& headers, const std::string& column)
+    {
+        for (size_t i = 0; i < headers.size(); ++i)
+        {
+            if (headers[i] == column)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // 標本の行（ファイルから解析したセル）を出力する
+    void StoreSample(StratifiedReservoir& reservoir, const std::vector<std::string>& headers, CSVData& output)
+    {
+        std::vector<SampledRow> sampled = reservoir.Take();
+        std::vector<std::vector<std::string>> rows;
+        rows.reserve(sampled.size());
+        for (auto& row : sampled)
+        {
+            rows.push_back(std::move(row.cells));
+        }
+
+        output.Clear();
+        output.SetHeaders(headers);
+        output.SetRows(std::move(rows));
+    }
+}
+
+bool SampleRows(const CSVData& input, const SampleSpec& spec, CSVData& output)
+{
+    const auto& headers = input.GetHeaders();
+    const auto& rows = input.GetRows();
+
+    int stratifyIndex = spec.stratifyColumn.empty() ? -1 : FindColumn(headers, spec.stratifyColumn);
+    if (!spec.stratifyColumn.empty() && stratifyIndex < 0)
+    {
+        return false;
+    }
+
+    // 入力表の行は採用されても位置だけを記録し、最後に出力表へ直接複写する
+    StratifiedReservoir reservoir(spec);
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+        std::string_view key = stratifyIndex >= 0 ? rows[r][static_cast<size_t>(stratifyIndex)] : std::string_view();
+        reservoir.Offer(key, r);
+    }
+
+    std::vector<SampledRow> sampled = reservoir.Take();
+    output.Clear();
+    output.SetHeaders(headers);
+    for (const auto& row : sampled)
+    {
+        output.AddRow(rows[row.sourceIndex]);
+    }
+    return true;
+}
+
+bool LoadSampledFile(const std::string& filename, const SampleSpec& spec, CSVData& output)
+{
+    LineReader file;
+    if (!file.Open(filename))
+    {
+        return false;
+    }
+
+    std::string line;
+    std::vector<std::string> headers;
+    if (file.ReadRecord(line))
+    {
+        headers = CSVData::ParseCSVLine(line);
+    }
+
+    int stratifyIndex = spec.stratifyColumn.empty() ? -1 : FindColumn(headers, spec.stratifyColumn);
+    if (!spec.stratifyColumn.empty() && stratifyIndex < 0)
+    {
+        return false;
+    }
+
+    const std::string noKey;
+    StratifiedReservoir reservoir(spec);
+    size_t rowIndex = 0;
+    while (file.ReadRecord(line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+
+        // 層別する場合もキー列だけを取り出し、行全体の解析は採用時のみ行う
+        const bool accepted = stratifyIndex >= 0
+            ? reservoir.Offer(CSVData::ParseCSVField(line, static_cast<size_t>(stratifyIndex)), rowIndex)
+            : reservoir.Offer(noKey, rowIndex);
+        if (accepted)
+        {
+            reservoir.StoreCells(CSVData::ParseCSVLine(line));
+        }
+        ++rowIndex;
+    }
+    if (file.HasError())
+    {
+        return false;
+    }
+
+    StoreSample(reservoir, headers, output);
+    return true;
+}
@@ -0,0 +1,55 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// サンプリングの設定
+struct SampleSpec
+{
+    size_t sampleSize = 100000;
+    uint64_t seed = 42;            // 同じシードと入力からは常に同じ標本を得る
+    std::string stratifyColumn;    // 空でなければこの列の値ごとに層別抽出する
+    bool perStratum = false;       // true: 各層から sampleSize 行, false: 層の大きさに比例して合計 sampleSize 行
+};
+
+// 抽出中に保持する行数の上限
+// 比例割り当てでは合計 sampleSize 行を最大剰余法で割り当て、層の数が sampleSize 以下なら各層に 1 行を保証する。
+// 保持するのは 2 × sampleSize 行（と 1 行保証のための層ごとに 1 行）まで。
+// 各層抽出では層ごとに sampleSize 行を保持するため、層の数 × sampleSize 行まで増える。
+
+// ストリーミング貯水池サンプリング（Algorithm L）
+// 次に採用される要素の位置を事前に決めるため、呼び出し側は
+// 不採用の要素を解析せずに読み飛ばすことができる。
+class ReservoirSampler
+{
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    ReservoirSampler(size_t capacity, uint64_t seed);
+
+    // 次の要素を提示する。採用する場合は格納先スロットを、不採用なら npos を返す
+    size_t Offer();
+
+    size_t GetCapacity() const { return capacity; }
+    size_t GetSeenCount() const { return seen; }
+
+private:
+    size_t capacity;
+    size_t seen;
+    size_t nextAccept;
+    double weight;
+    std::mt19937_64 random;
+
+    double NextUniform();
+    void AdvanceSkip();
+};
+
+// メモリ上のテーブルから標本を抽出する（元の行順を維持）
+bool SampleRows(const CSVData& input, const SampleSpec& spec, CSVData& output);
+
+// CSVファイルを読み込みながら標本を抽出する
+// 採用されない行は行区切りの検出のみ行い、列の解析を省略する。
+bool LoadSampledFile(const std::string& filename, const SampleSpec& spec, CSVData& output);
@@ -0,0 +1,2254 @@
+﻿#include "SqlQuery.h"
+#include "Aggregate.h"
+#include "ColumnIndex.h"
+#include "HashJoin.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include "Predicate.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <string_view>
+
+namespace
+{
+    // 行ごとに条件を評価するときの 1 ブロックの行数
+    constexpr size_t matchBlockRows = 65536;
+
+    // 複数の列でまとめるときに値をつなぐ区切り文字（セルに現れにくい制御文字）
+    constexpr char keySeparator = '\x1f';
+
+    std::string PositionPrefix(size_t position)
+    {
+        return "位置 " + std::to_string(position + 1) + ": ";
+    }
+
+    bool EqualsIgnoreCase(std::string_view text, std::string_view other)
+    {
+        if (text.size() != other.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < text.size(); ++i)
+        {
+            if (std::toupper(static_cast<unsigned char>(text[i])) != std::toupper(static_cast<unsigned char>(other[i])))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::string ToUpper(std::string text)
+    {
+        for (char& c : text)
+        {
+            c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+        }
+        return text;
+    }
+
+    // ---------------------------------------------------------------- 字句解析
+
+    enum class TokenType
+    {
+        Identifier,         // 引用符なしの識別子・キーワード
+        QuotedIdentifier,   // "列名" / `列名` / [列名]
+        String,             // '文字列'
+        Number,
+        Symbol,
+        End
+    };
+
+    struct Token
+    {
+        TokenType type = TokenType::End;
+        std::string text;
+        size_t position = 0;    // 問い合わせの先頭からのバイト位置
+    };
+
+    bool IsIdentifierStart(unsigned char c)
+    {
+        return std::isalpha(c) || c == '_' || c >= 0x80;
+    }
+
+    bool IsIdentifierChar(unsigned char c)
+    {
+        return std::isalnum(c) || c == '_' || c >= 0x80;
+    }
+
+    bool IsDigit(const std::string& text, size_t position)
+    {
+        return position < text.size() && std::isdigit(static_cast<unsigned char>(text[position]));
+    }
+
+    bool Tokenize(const std::string& query, std::vector<Token>& tokens, std::string& error)
+    {
+        static const char* const symbols[] = { "<=", ">=", "<>", "!=", "==", ",", "(", ")", ".", "*", "=", "<", ">", ";", "-" };
+
+        const size_t size = query.size();
+        size_t i = 0;
+        while (i < size)
+        {
+            const unsigned char c = static_cast<unsigned char>(query[i]);
+            if (std::isspace(c))
+            {
+                ++i;
+                continue;
+            }
+            if (c == '-' && i + 1 < size && query[i + 1] == '-')
+            {
+                // 行末までのコメント
+                while (i < size && query[i] != '\n')
+                {
+                    ++i;
+                }
+                continue;
+            }
+
+            Token token;
+            token.position = i;
+            if (IsIdentifierStart(c))
+            {
+                size_t end = i + 1;
+                while (end < size && IsIdentifierChar(static_cast<unsigned char>(query[end])))
+                {
+                    ++end;
+                }
+                token.type = TokenType::Identifier;
+                token.text = query.substr(i, end - i);
+                i = end;
+            }
+            else if (c == '\'' || c == '"' || c == '`' || c == '[')
+            {
+                // 閉じ引用符を 2 つ重ねると引用符そのものを表す（[...] を除く）
+                const char close = c == '[' ? ']' : static_cast<char>(c);
+                token.type = c == '\'' ? TokenType::String : TokenType::QuotedIdentifier;
+                size_t end = i + 1;
+                bool closed = false;
+                while (end < size)
+                {
+                    if (query[end] == close)
+                    {
+                        if (close != ']' && end + 1 < size && query[end + 1] == close)
+                        {
+                            token.text.push_back(close);
+                            end += 2;
+                            continue;
+                        }
+                        closed = true;
+                        ++end;
+                        break;
+                    }
+                    token.text.push_back(query[end++]);
+                }
+                if (!closed)
+                {
+                    error = PositionPrefix(i) + "引用符が閉じられていません";
+                    return false;
+                }
+                i = end;
+            }
+            else if (std::isdigit(c) || (c == '.' && IsDigit(query, i + 1)))
+            {
+                size_t end = i;
+                while (IsDigit(query, end) || (end < size && query[end] == '.'))
+                {
+                    ++end;
+                }
+                if (end < size && (query[end] == 'e' || query[end] == 'E'))
+                {
+                    size_t exponent = end + 1;
+                    if (exponent < size && (query[exponent] == '+' || query[exponent] == '-'))
+                    {
+                        ++exponent;
+                    }
+                    if (IsDigit(query, exponent))
+                    {
+                        end = exponent;
+                        while (IsDigit(query, end))
+                        {
+                            ++end;
+                        }
+                    }
+                }
+                token.type = TokenType::Number;
+                token.text = query.substr(i, end - i);
+                i = end;
+            }
+            else
+            {
+                for (const char* symbol : symbols)
+                {
+                    if (query.compare(i, std::strlen(symbol), symbol) == 0)
+                    {
+                        token.type = TokenType::Symbol;
+                        token.text = symbol;
+                        break;
+                    }
+                }
+                if (token.type != TokenType::Symbol)
+                {
+                    error = PositionPrefix(i) + "解釈できない文字 '" + query.substr(i, 1) + "' があります";
+                    return false;
+                }
+                i += token.text.size();
+            }
+            tokens.push_back(std::move(token));
+        }
+
+        Token end;
+        end.position = size;
+        tokens.push_back(end);
+        return true;
+    }
+
+    // ---------------------------------------------------------------- 構文木
+
+    // 列の参照（表の指定は省略できる）
+    struct ColumnName
+    {
+        std::string table;
+        std::string column;
+        size_t position = 0;
+
+        std::string ToString() const { return table.empty() ? column : table + "." + column; }
+    };
+
+    // 集計関数の呼び出し
+    struct AggregateCall
+    {
+        std::string function;       // GroupAggregator の関数名
+        bool allRows = false;       // COUNT(*)
+        ColumnName column;
+        std::string text;           // 出力列名の既定値（"SUM(金額)" など）
+    };
+
+    struct SelectItem
+    {
+        enum class Kind
+        {
+            AllColumns,             // * または 表.*
+            Column,
+            Aggregate
+        };
+
+        Kind kind = Kind::Column;
+        std::string table;          // 表.* の表
+        ColumnName column;
+        AggregateCall aggregate;
+        std::string alias;
+        size_t position = 0;
+    };
+
+    // 比較条件（左辺は常に列。値が左辺に書かれていれば比較の向きを反転して入れ替える）
+    struct Condition
+    {
+        ColumnName left;
+        std::string op;             // CompiledPredicate の演算子
+        bool rightIsColumn = false;
+        ColumnName right;
+        std::string value;
+        size_t position = 0;
+    };
+
+    struct TableReference
+    {
+        std::string name;
+        std::string alias;
+        size_t position = 0;
+    };
+
+    struct JoinClause
+    {
+        TableReference table;
+        std::string type;           // "inner", "left", "right", "outer"、カンマ区切り・CROSS JOIN は "cross"
+        std::vector<Condition> conditions;
+    };
+
+    struct OrderItem
+    {
+        size_t ordinal = 0;         // SELECT 項目の位置（1 始まり。0 なら列・集計関数で指定）
+        bool isAggregate = false;
+        AggregateCall aggregate;
+        ColumnName column;
+        bool ascending = true;
+        size_t position = 0;
+    };
+
+    struct SelectStatement
+    {
+        bool distinct = false;
+        std::vector<SelectItem> items;
+        TableReference from;
+        std::vector<JoinClause> joins;
+        std::vector<Condition> where;
+        std::vector<ColumnName> groupBy;
+        std::vector<OrderItem> orderBy;
+        bool hasLimit = false;
+        size_t limit = 0;
+        size_t offset = 0;
+    };
+
+    // ---------------------------------------------------------------- 構文解析
+
+    const char* const reservedWords[] = {
+        "SELECT", "DISTINCT", "FROM", "WHERE", "GROUP", "BY", "HAVING", "ORDER", "LIMIT", "OFFSET",
+        "JOIN", "INNER", "LEFT", "RIGHT", "FULL", "OUTER", "CROSS", "ON", "AND", "OR", "NOT",
+        "AS", "ASC", "DESC", "LIKE", "IS", "NULL", "UNION"
+    };
+
+    // 値を左右入れ替えたときの比較演算子
+    std::string FlipComparison(const std::string& op)
+    {
+        if (op == ">")
+        {
+            return "<";
+        }
+        if (op == "<")
+        {
+            return ">";
+        }
+        if (op == ">=")
+        {
+            return "<=";
+        }
+        if (op == "<=")
+        {
+            return ">=";
+        }
+        return op;
+    }
+
+    class Parser
+    {
+    public:
+        explicit Parser(const std::vector<Token>& tokens) : tokens(tokens), current(0) {}
+
+        bool ParseStatement(SelectStatement& statement, std::string& error)
+        {
+            if (!ParseSelect(statement))
+            {
+                error = message;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        const std::vector<Token>& tokens;
+        size_t current;
+        std::string message;
+
+        const Token& Peek(size_t ahead = 0) const
+        {
+            return tokens[std::min(current + ahead, tokens.size() - 1)];
+        }
+
+        bool IsKeyword(const char* keyword, size_t ahead = 0) const
+        {
+            const Token& token = Peek(ahead);
+            return token.type == TokenType::Identifier && EqualsIgnoreCase(token.text, keyword);
+        }
+
+        bool IsSymbol(const char* symbol, size_t ahead = 0) const
+        {
+            const Token& token = Peek(ahead);
+            return token.type == TokenType::Symbol && token.text == symbol;
+        }
+
+        bool AcceptKeyword(const char* keyword)
+        {
+            if (!IsKeyword(keyword))
+            {
+                return false;
+            }
+            ++current;
+            return true;
+        }
+
+        bool AcceptSymbol(const char* symbol)
+        {
+            if (!IsSymbol(symbol))
+            {
+                return false;
+            }
+            ++current;
+            return true;
+        }
+
+        bool Fail(const std::string& text)
+        {
+            message = PositionPrefix(Peek().position) + text;
+            return false;
+        }
+
+        bool ExpectKeyword(const char* keyword)
+        {
+            return AcceptKeyword(keyword) || Fail(std::string(keyword) + " が必要です");
+        }
+
+        bool ExpectSymbol(const char* symbol)
+        {
+            return AcceptSymbol(symbol) || Fail(std::string("'") + symbol + "' が必要です");
+        }
+
+        bool IsNameToken(size_t ahead = 0) const
+        {
+            const Token& token = Peek(ahead);
+            if (token.type == TokenType::QuotedIdentifier)
+            {
+                return true;
+            }
+            if (token.type != TokenType::Identifier)
+            {
+                return false;
+            }
+            for (const char* word : reservedWords)
+            {
+                if (EqualsIgnoreCase(token.text, word))
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        bool ParseName(std::string& name, const char* what)
+        {
+            if (!IsNameToken())
+            {
+                return Fail(std::string(what) + " が必要です");
+            }
+            name = Peek().text;
+            ++current;
+            return true;
+        }
+
+        bool ParseColumnName(ColumnName& column)
+        {
+            column.position = Peek().position;
+            std::string first;
+            if (!ParseName(first, "列名"))
+            {
+                return false;
+            }
+            if (AcceptSymbol("."))
+            {
+                column.table = first;
+                return ParseName(column.column, "列名");
+            }
+            column.column = first;
+            return true;
+        }
+
+        bool ParseAlias(std::string& alias)
+        {
+            if (AcceptKeyword("AS"))
+            {
+                return ParseName(alias, "別名");
+            }
+            if (IsNameToken())
+            {
+                alias = Peek().text;
+                ++current;
+            }
+            return true;
+        }
+
+        bool IsAggregateStart() const
+        {
+            static const char* const functions[] = { "COUNT", "SUM", "AVG", "MIN", "MAX" };
+            if (Peek().type != TokenType::Identifier || !IsSymbol("(", 1))
+            {
+                return false;
+            }
+            for (const char* function : functions)
+            {
+                if (EqualsIgnoreCase(Peek().text, function))
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool ParseAggregate(AggregateCall& call)
+        {
+            const std::string name = ToUpper(Peek().text);
+            current += 2;
+            if (name == "COUNT" && AcceptSymbol("*"))
+            {
+                call.function = "count";
+                call.allRows = true;
+            }
+            else
+            {
+                if (IsKeyword("DISTINCT"))
+                {
+                    return Fail("集計関数の DISTINCT には対応していません");
+                }
+                if (!ParseColumnName(call.column))
+                {
+                    return false;
+                }
+                call.function = name == "COUNT" ? "count_values"
+                    : name == "SUM" ? "sum"
+                    : name == "AVG" ? "average"
+                    : name == "MIN" ? "min" : "max";
+            }
+            call.text = name + "(" + (call.allRows ? std::string("*") : call.column.ToString()) + ")";
+            return ExpectSymbol(")");
+        }
+
+        bool ParseSelectItem(SelectItem& item)
+        {
+            item.position = Peek().position;
+            if (AcceptSymbol("*"))
+            {
+                item.kind = SelectItem::Kind::AllColumns;
+                return true;
+            }
+            if (IsNameToken() && IsSymbol(".", 1) && IsSymbol("*", 2))
+            {
+                item.kind = SelectItem::Kind::AllColumns;
+                item.table = Peek().text;
+                current += 3;
+                return true;
+            }
+            if (IsAggregateStart())
+            {
+                item.kind = SelectItem::Kind::Aggregate;
+                if (!ParseAggregate(item.aggregate))
+                {
+                    return false;
+                }
+            }
+            else if (!ParseColumnName(item.column))
+            {
+                return false;
+            }
+            return ParseAlias(item.alias);
+        }
+
+        bool ParseTableReference(TableReference& table)
+        {
+            table.position = Peek().position;
+            return ParseName(table.name, "表名") && ParseAlias(table.alias);
+        }
+
+        bool ParseLiteral(std::string& value)
+        {
+            const Token& token = Peek();
+            if (token.type == TokenType::String || token.type == TokenType::Number)
+            {
+                value = token.text;
+                ++current;
+                return true;
+            }
+            if (IsSymbol("-") && Peek(1).type == TokenType::Number)
+            {
+                value = "-" + Peek(1).text;
+                current += 2;
+                return true;
+            }
+            return Fail("値が必要です");
+        }
+
+        bool IsLiteralStart() const
+        {
+            const Token& token = Peek();
+            return token.type == TokenType::String || token.type == TokenType::Number || IsSymbol("-");
+        }
+
+        bool ParseCount(size_t& value)
+        {
+            const Token& token = Peek();
+            if (token.type != TokenType::Number || token.text.find_first_not_of("0123456789") != std::string::npos
+                || token.text.size() > 18)
+            {
+                return Fail("0 以上の整数が必要です");
+            }
+            value = static_cast<size_t>(std::stoull(token.text));
+            ++current;
+            return true;
+        }
+
+        bool ParseComparison(std::string& op)
+        {
+            static const char* const comparisons[][2] = {
+                { "=", "==" }, { "==", "==" }, { "<>", "!=" }, { "!=", "!=" },
+                { "<", "<" }, { ">", ">" }, { "<=", "<=" }, { ">=", ">=" }
+            };
+            for (const auto& comparison : comparisons)
+            {
+                if (AcceptSymbol(comparison[0]))
+                {
+                    op = comparison[1];
+                    return true;
+                }
+            }
+            return Fail("比較演算子が必要です");
+        }
+
+        bool ParseCondition(Condition& condition)
+        {
+            condition.position = Peek().position;
+            std::string leftValue;
+            const bool leftIsLiteral = IsLiteralStart();
+            if (leftIsLiteral ? !ParseLiteral(leftValue) : !ParseColumnName(condition.left))
+            {
+                return false;
+            }
+
+            if (!leftIsLiteral && AcceptKeyword("IS"))
+            {
+                // 空のセルを NULL とみなす
+                const bool negate = AcceptKeyword("NOT");
+                if (!ExpectKeyword("NULL"))
+                {
+                    return false;
+                }
+                condition.op = negate ? "!=" : "==";
+                return true;
+            }
+            if (!leftIsLiteral && (IsKeyword("LIKE") || (IsKeyword("NOT") && IsKeyword("LIKE", 1))))
+            {
+                const bool negate = AcceptKeyword("NOT");
+                ++current;
+                const size_t patternPosition = Peek().position;
+                std::string pattern;
+                if (Peek().type != TokenType::String)
+                {
+                    return Fail("LIKE には文字列のパターンが必要です");
+                }
+                ParseLiteral(pattern);
+                const size_t wildcard = pattern.find_first_of("%_");
+                if (wildcard == std::string::npos)
+                {
+                    condition.op = negate ? "!=" : "==";
+                    condition.value = pattern;
+                    return true;
+                }
+                if (!negate && pattern.size() >= 2 && pattern.front() == '%' && pattern.back() == '%'
+                    && pattern.find_first_of("%_", 1) == pattern.size() - 1)
+                {
+                    condition.op = "contains";
+                    condition.value = pattern.substr(1, pattern.size() - 2);
+                    return true;
+                }
+                message = PositionPrefix(patternPosition) + "LIKE のパターンは '%文字列%' か完全一致の形だけに対応しています";
+                return false;
+            }
+
+            if (!ParseComparison(condition.op))
+            {
+                return false;
+            }
+            if (IsLiteralStart())
+            {
+                if (leftIsLiteral)
+                {
+                    return Fail("列を含まない条件には対応していません");
+                }
+                return ParseLiteral(condition.value);
+            }
+            ColumnName right;
+            if (!ParseColumnName(right))
+            {
+                return false;
+            }
+            if (leftIsLiteral)
+            {
+                condition.left = right;
+                condition.value = leftValue;
+                condition.op = FlipComparison(condition.op);
+            }
+            else
+            {
+                condition.rightIsColumn = true;
+                condition.right = right;
+            }
+            return true;
+        }
+
+        // AND でつないだ条件（括弧は平坦にする）
+        bool ParseConditions(std::vector<Condition>& conditions)
+        {
+            do
+            {
+                if (AcceptSymbol("("))
+                {
+                    if (!ParseConditions(conditions) || !ExpectSymbol(")"))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    Condition condition;
+                    if (!ParseCondition(condition))
+                    {
+                        return false;
+                    }
+                    conditions.push_back(std::move(condition));
+                }
+                if (IsKeyword("OR"))
+                {
+                    return Fail("OR には対応していません（条件は AND でつないでください）");
+                }
+            } while (AcceptKeyword("AND"));
+            return true;
+        }
+
+        bool ParseJoins(SelectStatement& statement)
+        {
+            for (;;)
+            {
+                JoinClause join;
+                if (AcceptSymbol(","))
+                {
+                    join.type = "cross";
+                    if (!ParseTableReference(join.table))
+                    {
+                        return false;
+                    }
+                    statement.joins.push_back(std::move(join));
+                    continue;
+                }
+
+                if (AcceptKeyword("INNER"))
+                {
+                    join.type = "inner";
+                }
+                else if (AcceptKeyword("CROSS"))
+                {
+                    join.type = "cross";
+                }
+                else if (AcceptKeyword("LEFT"))
+                {
+                    join.type = "left";
+                }
+                else if (AcceptKeyword("RIGHT"))
+                {
+                    join.type = "right";
+                }
+                else if (AcceptKeyword("FULL"))
+                {
+                    join.type = "outer";
+                }
+                else if (IsKeyword("JOIN"))
+                {
+                    join.type = "inner";
+                }
+                else
+                {
+                    return true;
+                }
+                if (join.type != "inner" && join.type != "cross")
+                {
+                    AcceptKeyword("OUTER");
+                }
+                if (!ExpectKeyword("JOIN") || !ParseTableReference(join.table))
+                {
+                    return false;
+                }
+                if (join.type != "cross" && (!ExpectKeyword("ON") || !ParseConditions(join.conditions)))
+                {
+                    return false;
+                }
+                statement.joins.push_back(std::move(join));
+            }
+        }
+
+        bool ParseOrderItem(OrderItem& item)
+        {
+            item.position = Peek().position;
+            if (Peek().type == TokenType::Number)
+            {
+                if (!ParseCount(item.ordinal))
+                {
+                    return false;
+                }
+                if (item.ordinal == 0)
+                {
+                    message = PositionPrefix(item.position) + "ORDER BY の位置は 1 から数えます";
+                    return false;
+                }
+            }
+            else if (IsAggregateStart())
+            {
+                item.isAggregate = true;
+                if (!ParseAggregate(item.aggregate))
+                {
+                    return false;
+                }
+            }
+            else if (!ParseColumnName(item.column))
+            {
+                return false;
+            }
+            if (AcceptKeyword("DESC"))
+            {
+                item.ascending = false;
+            }
+            else
+            {
+                AcceptKeyword("ASC");
+            }
+            return true;
+        }
+
+        bool ParseSelect(SelectStatement& statement)
+        {
+            if (!ExpectKeyword("SELECT"))
+            {
+                return false;
+            }
+            statement.distinct = AcceptKeyword("DISTINCT");
+            do
+            {
+                SelectItem item;
+                if (!ParseSelectItem(item))
+                {
+                    return false;
+                }
+                statement.items.push_back(std::move(item));
+            } while (AcceptSymbol(","));
+
+            if (!ExpectKeyword("FROM") || !ParseTableReference(statement.from) || !ParseJoins(statement))
+            {
+                return false;
+            }
+            if (AcceptKeyword("WHERE") && !ParseConditions(statement.where))
+            {
+                return false;
+            }
+            if (AcceptKeyword("GROUP"))
+            {
+                if (!ExpectKeyword("BY"))
+                {
+                    return false;
+                }
+                do
+                {
+                    ColumnName column;
+                    if (!ParseColumnName(column))
+                    {
+                        return false;
+                    }
+                    statement.groupBy.push_back(std::move(column));
+                } while (AcceptSymbol(","));
+            }
+            if (IsKeyword("HAVING"))
+            {
+                return Fail("HAVING には対応していません");
+            }
+            if (AcceptKeyword("ORDER"))
+            {
+                if (!ExpectKeyword("BY"))
+                {
+                    return false;
+                }
+                do
+                {
+                    OrderItem item;
+                    if (!ParseOrderItem(item))
+                    {
+                        return false;
+                    }
+                    statement.orderBy.push_back(std::move(item));
+                } while (AcceptSymbol(","));
+            }
+            if (AcceptKeyword("LIMIT"))
+            {
+                statement.hasLimit = true;
+                if (!ParseCount(statement.limit))
+                {
+                    return false;
+                }
+                if (AcceptKeyword("OFFSET") && !ParseCount(statement.offset))
+                {
+                    return false;
+                }
+            }
+            AcceptSymbol(";");
+            if (Peek().type != TokenType::End)
+            {
+                return Fail("解釈できない語句 '" + Peek().text + "' があります");
+            }
+            return true;
+        }
+    };
+
+    // ---------------------------------------------------------------- 実行
+
+    // 列の出所（FROM 句の何番目の表の何列目か）
+    struct BoundColumn
+    {
+        size_t relation = 0;
+        size_t column = 0;
+
+        bool operator==(const BoundColumn& other) const { return relation == other.relation && column == other.column; }
+        bool operator!=(const BoundColumn& other) const { return !(*this == other); }
+    };
+
+    struct BoundCondition
+    {
+        BoundColumn left;
+        std::string op;
+        bool rightIsColumn = false;
+        BoundColumn right;
+        std::string value;
+
+        // 列どうしの比較で、別々の表の列を比べるか
+        bool IsJoinCondition() const { return rightIsColumn && left.relation != right.relation; }
+        bool IsEquiJoin() const { return IsJoinCondition() && op == "=="; }
+    };
+
+    struct BoundAggregate
+    {
+        std::string function;
+        bool allRows = false;
+        BoundColumn column;
+        std::string text;
+
+        bool SameAs(const BoundAggregate& other) const
+        {
+            return function == other.function && allRows == other.allRows && (allRows || column == other.column);
+        }
+    };
+
+    // 出力列（集計する問い合わせではグループ列か集計値）
+    struct OutputColumn
+    {
+        bool isAggregate = false;
+        BoundColumn column;
+        size_t aggregate = 0;       // BoundAggregate の番号
+        std::string name;
+        std::string alias;
+        size_t position = 0;
+    };
+
+    // 並べ替えのキー（集計する問い合わせではグループ列・集計値、それ以外は列を指す）
+    struct OrderTarget
+    {
+        bool isAggregate = false;
+        BoundColumn column;
+        size_t aggregate = 0;
+        bool ascending = true;
+    };
+
+    // 演算の途中結果
+    struct Intermediate
+    {
+        std::unique_ptr<CSVData> data;
+        std::vector<BoundColumn> columns;       // 各列の出所
+        std::vector<size_t> relations;          // 含まれる表
+        std::vector<std::string> plan;
+
+        size_t IndexOf(const BoundColumn& column) const
+        {
+            return static_cast<size_t>(std::find(columns.begin(), columns.end(), column) - columns.begin());
+        }
+
+        bool Contains(size_t relation) const
+        {
+            return std::find(relations.begin(), relations.end(), relation) != relations.end();
+        }
+    };
+
+    // 子の計画を字下げして演算の下に並べる
+    std::vector<std::string> Nest(const std::string& label, const std::vector<std::string>& first,
+        const std::vector<std::string>* second = nullptr)
+    {
+        std::vector<std::string> plan = { label };
+        for (const std::string& line : first)
+        {
+            plan.push_back("  " + line);
+        }
+        if (second)
+        {
+            for (const std::string& line : *second)
+            {
+                plan.push_back("  " + line);
+            }
+        }
+        return plan;
+    }
+
+    // 列どうしの比較（どちらかが空なら一致しない）
+    bool CompareCells(std::string_view left, std::string_view right, const std::string& op)
+    {
+        if (left.empty() || right.empty())
+        {
+            return false;
+        }
+        int order = 0;
+        double leftNumber = 0.0;
+        double rightNumber = 0.0;
+        if (ParseDouble(left, leftNumber) && ParseDouble(right, rightNumber))
+        {
+            order = leftNumber < rightNumber ? -1 : (rightNumber < leftNumber ? 1 : 0);
+        }
+        else
+        {
+            const int compared = left.compare(right);
+            order = compared < 0 ? -1 : (compared > 0 ? 1 : 0);
+        }
+        if (op == "==")
+        {
+            return order == 0;
+        }
+        if (op == "!=")
+        {
+            return order != 0;
+        }
+        if (op == "<")
+        {
+            return order < 0;
+        }
+        if (op == ">")
+        {
+            return order > 0;
+        }
+        if (op == "<=")
+        {
+            return order <= 0;
+        }
+        return order >= 0;
+    }
+
+    // 行ごとに条件を評価し、一致した行番号を昇順で返す（candidates が nullptr なら全行が対象）
+    // rightColumn が SIZE_MAX なら predicate で値と比べ、それ以外は 2 つの列を比べる。
+    std::vector<uint32_t> MatchRows(const CSVData& data, const std::vector<uint32_t>* candidates,
+        const CompiledPredicate& predicate, size_t leftColumn, size_t rightColumn)
+    {
+        const CSVRowRange rows = data.GetRows();
+        const size_t count = candidates ? candidates->size() : rows.size();
+        const size_t blockCount = (count + matchBlockRows - 1) / matchBlockRows;
+        std::vector<std::vector<uint32_t>> partial(blockCount);
+        ParallelFor(blockCount, [&](size_t block) {
+            const size_t begin = block * matchBlockRows;
+            const size_t end = std::min(count, begin + matchBlockRows);
+            for (size_t i = begin; i < end; ++i)
+            {
+                const uint32_t row = candidates ? (*candidates)[i] : static_cast<uint32_t>(i);
+                const CSVRow cells = rows[row];
+                const bool matched = rightColumn == SIZE_MAX ? predicate.Matches(cells[leftColumn])
+                    : CompareCells(cells[leftColumn], cells[rightColumn], predicate.op);
+                if (matched)
+                {
+                    partial[block].push_back(row);
+                }
+            }
+        });
+
+        std::vector<uint32_t> result;
+        for (const auto& block : partial)
+        {
+            result.insert(result.end(), block.begin(), block.end());
+        }
+        return result;
+    }
+
+    // 並べ替えた行の順序を求める（先頭 limit 行だけ必要なら部分整列する）
+    // 空のセルを最小、次に数値、文字列の順とし、数値どうしは数値として比べる。同順位は元の行順を保つ。
+    std::vector<uint32_t> SortRowOrder(const CSVData& data, const std::vector<std::pair<size_t, bool>>& keys, size_t limit)
+    {
+        struct KeyValues
+        {
+            std::vector<uint8_t> kinds;     // 0: 空, 1: 数値, 2: 文字列
+            std::vector<double> numbers;
+            std::vector<std::string_view> texts;
+            bool ascending = true;
+        };
+
+        const CSVRowRange rows = data.GetRows();
+        const size_t rowCount = rows.size();
+        std::vector<KeyValues> values(keys.size());
+        for (size_t k = 0; k < keys.size(); ++k)
+        {
+            KeyValues& key = values[k];
+            key.kinds.resize(rowCount);
+            key.numbers.resize(rowCount);
+            key.texts.resize(rowCount);
+            key.ascending = keys[k].second;
+            const size_t column = keys[k].first;
+            ParallelFor((rowCount + matchBlockRows - 1) / matchBlockRows, [&](size_t block) {
+                const size_t end = std::min(rowCount, (block + 1) * matchBlockRows);
+                for (size_t row = block * matchBlockRows; row < end; ++row)
+                {
+                    const std::string_view cell = rows[row][column];
+                    if (cell.empty())
+                    {
+                        key.kinds[row] = 0;
+                    }
+                    else if (ParseDouble(cell, key.numbers[row]))
+                    {
+                        key.kinds[row] = 1;
+                    }
+                    else
+                    {
+                        key.kinds[row] = 2;
+                        key.texts[row] = cell;
+                    }
+                }
+            });
+        }
+
+        auto less = [&](uint32_t a, uint32_t b) {
+            for (const KeyValues& key : values)
+            {
+                int order = 0;
+                if (key.kinds[a] != key.kinds[b])
+                {
+                    order = key.kinds[a] < key.kinds[b] ? -1 : 1;
+                }
+                else if (key.kinds[a] == 1)
+                {
+                    order = key.numbers[a] < key.numbers[b] ? -1 : (key.numbers[b] < key.numbers[a] ? 1 : 0);
+                }
+                else if (key.kinds[a] == 2)
+                {
+                    const int compared = key.texts[a].compare(key.texts[b]);
+                    order = compared < 0 ? -1 : (compared > 0 ? 1 : 0);
+                }
+                if (order != 0)
+                {
+                    return key.ascending ? order < 0 : order > 0;
+                }
+            }
+            return a < b;
+        };
+
+        std::vector<uint32_t> order(rowCount);
+        std::iota(order.begin(), order.end(), 0u);
+        if (limit < rowCount)
+        {
+            std::partial_sort(order.begin(), order.begin() + limit, order.end(), less);
+            order.resize(limit);
+        }
+        else
+        {
+            std::sort(order.begin(), order.end(), less);
+        }
+        return order;
+    }
+
+    class QueryExecutor
+    {
+    public:
+        QueryExecutor(const SelectStatement& statement, const std::vector<SqlTable>& tables)
+            : statement(statement), tables(tables), aggregateQuery(false)
+        {
+        }
+
+        bool Execute(CSVData& output, std::vector<std::string>& plan, std::string& error)
+        {
+            if (!Run(output, plan))
+            {
+                error = message;
+                return false;
+            }
+            return true;
+        }
+
+    private:
+        struct Relation
+        {
+            std::string name;
+            std::string alias;
+            const CSVData* data = nullptr;
+        };
+
+        const SelectStatement& statement;
+        const std::vector<SqlTable>& tables;
+        std::string message;
+
+        std::vector<Relation> relations;
+        bool aggregateQuery;
+        std::vector<OutputColumn> outputs;
+        std::vector<BoundColumn> groups;
+        std::vector<BoundAggregate> aggregates;
+        std::vector<OrderTarget> orderTargets;
+
+        bool Fail(size_t position, const std::string& text)
+        {
+            message = PositionPrefix(position) + text;
+            return false;
+        }
+
+        const std::string& HeaderOf(const BoundColumn& column) const
+        {
+            return relations[column.relation].data->GetHeaders()[column.column];
+        }
+
+        // 途中結果の表で使う列名（元の列名が重複していても区別できるようにする）
+        static std::string InternalName(const BoundColumn& column)
+        {
+            return "\x1f" + std::to_string(column.relation) + "." + std::to_string(column.column);
+        }
+
+        std::string DisplayName(const BoundColumn& column) const
+        {
+            return relations.size() > 1 ? relations[column.relation].alias + "." + HeaderOf(column) : HeaderOf(column);
+        }
+
+        std::string Describe(const BoundCondition& condition) const
+        {
+            if (condition.rightIsColumn)
+            {
+                return DisplayName(condition.left) + " " + condition.op + " " + DisplayName(condition.right);
+            }
+            return DisplayName(condition.left) + " " + condition.op + " '" + condition.value + "'";
+        }
+
+        bool BindRelations()
+        {
+            std::vector<const TableReference*> references = { &statement.from };
+            for (const JoinClause& join : statement.joins)
+            {
+                references.push_back(&join.table);
+            }
+            for (const TableReference* reference : references)
+            {
+                const SqlTable* found = nullptr;
+                for (const SqlTable& table : tables)
+                {
+                    if (table.data && table.name == reference->name)
+                    {
+                        found = &table;
+                        break;
+                    }
+                }
+                if (!found)
+                {
+                    return Fail(reference->position, "表 '" + reference->name + "' がありません");
+                }
+                Relation relation;
+                relation.name = reference->name;
+                relation.alias = reference->alias.empty() ? reference->name : reference->alias;
+                relation.data = found->data;
+                for (const Relation& other : relations)
+                {
+                    if (other.alias == relation.alias)
+                    {
+                        return Fail(reference->position, "表の別名 '" + relation.alias + "' が重複しています");
+                    }
+                }
+                relations.push_back(relation);
+            }
+            return true;
+        }
+
+        static int FindHeader(const std::vector<std::string>& headers, const std::string& name)
+        {
+            for (size_t i = 0; i < headers.size(); ++i)
+            {
+                if (headers[i] == name)
+                {
+                    return static_cast<int>(i);
+                }
+            }
+            // 完全に一致する列が無ければ英字の大文字・小文字を区別せずに探す
+            for (size_t i = 0; i < headers.size(); ++i)
+            {
+                if (EqualsIgnoreCase(headers[i], name))
+                {
+                    return static_cast<int>(i);
+                }
+            }
+            return -1;
+        }
+
+        bool Resolve(const ColumnName& name, BoundColumn& bound)
+        {
+            if (!name.table.empty())
+            {
+                for (size_t r = 0; r < relations.size(); ++r)
+                {
+                    if (relations[r].alias == name.table)
+                    {
+                        const int column = FindHeader(relations[r].data->GetHeaders(), name.column);
+                        if (column < 0)
+                        {
+                            return Fail(name.position, "列 '" + name.ToString() + "' がありません");
+                        }
+                        bound.relation = r;
+                        bound.column = static_cast<size_t>(column);
+                        return true;
+                    }
+                }
+                return Fail(name.position, "表 '" + name.table + "' は FROM 句にありません");
+            }
+
+            bool found = false;
+            for (size_t r = 0; r < relations.size(); ++r)
+            {
+                const int column = FindHeader(relations[r].data->GetHeaders(), name.column);
+                if (column < 0)
+                {
+                    continue;
+                }
+                if (found)
+                {
+                    return Fail(name.position, "列 '" + name.column + "' は複数の表にあります（表名を付けてください）");
+                }
+                found = true;
+                bound.relation = r;
+                bound.column = static_cast<size_t>(column);
+            }
+            return found || Fail(name.position, "列 '" + name.column + "' がありません");
+        }
+
+        bool Bind(const Condition& condition, BoundCondition& bound)
+        {
+            bound.op = condition.op;
+            bound.rightIsColumn = condition.rightIsColumn;
+            bound.value = condition.value;
+            return Resolve(condition.left, bound.left) && (!condition.rightIsColumn || Resolve(condition.right, bound.right));
+        }
+
+        bool BindAggregate(const AggregateCall& call, size_t& index)
+        {
+            BoundAggregate aggregate;
+            aggregate.function = call.function;
+            aggregate.allRows = call.allRows;
+            aggregate.text = call.text;
+            if (!call.allRows && !Resolve(call.column, aggregate.column))
+            {
+                return false;
+            }
+            for (size_t i = 0; i < aggregates.size(); ++i)
+            {
+                if (aggregates[i].SameAs(aggregate))
+                {
+                    index = i;
+                    return true;
+                }
+            }
+            index = aggregates.size();
+            aggregates.push_back(aggregate);
+            return true;
+        }
+
+        // SELECT 項目・GROUP BY・ORDER BY を列と集計値に解決する
+        bool BindOutputs()
+        {
+            for (const SelectItem& item : statement.items)
+            {
+                if (item.kind == SelectItem::Kind::Aggregate)
+                {
+                    aggregateQuery = true;
+                }
+            }
+            aggregateQuery = aggregateQuery || !statement.groupBy.empty() || statement.distinct;
+            if (statement.distinct && !statement.groupBy.empty())
+            {
+                return Fail(statement.groupBy[0].position, "DISTINCT と GROUP BY の併用には対応していません");
+            }
+
+            for (const SelectItem& item : statement.items)
+            {
+                if (item.kind == SelectItem::Kind::AllColumns)
+                {
+                    bool matched = false;
+                    for (size_t r = 0; r < relations.size(); ++r)
+                    {
+                        if (!item.table.empty() && relations[r].alias != item.table)
+                        {
+                            continue;
+                        }
+                        matched = true;
+                        const auto& headers = relations[r].data->GetHeaders();
+                        for (size_t c = 0; c < headers.size(); ++c)
+                        {
+                            OutputColumn output;
+                            output.column = { r, c };
+                            output.name = headers[c];
+                            output.position = item.position;
+                            outputs.push_back(output);
+                        }
+                    }
+                    if (!matched)
+                    {
+                        return Fail(item.position, "表 '" + item.table + "' は FROM 句にありません");
+                    }
+                    continue;
+                }
+
+                OutputColumn output;
+                output.alias = item.alias;
+                output.position = item.position;
+                if (item.kind == SelectItem::Kind::Aggregate)
+                {
+                    if (statement.distinct)
+                    {
+                        return Fail(item.position, "DISTINCT と集計関数の併用には対応していません");
+                    }
+                    output.isAggregate = true;
+                    if (!BindAggregate(item.aggregate, output.aggregate))
+                    {
+                        return false;
+                    }
+                    output.name = item.alias.empty() ? item.aggregate.text : item.alias;
+                }
+                else
+                {
+                    if (!Resolve(item.column, output.column))
+                    {
+                        return false;
+                    }
+                    output.name = item.alias.empty() ? HeaderOf(output.column) : item.alias;
+                }
+                outputs.push_back(output);
+            }
+
+            for (const ColumnName& name : statement.groupBy)
+            {
+                BoundColumn column;
+                if (!Resolve(name, column))
+                {
+                    return false;
+                }
+                if (std::find(groups.begin(), groups.end(), column) == groups.end())
+                {
+                    groups.push_back(column);
+                }
+            }
+            if (statement.distinct)
+            {
+                // DISTINCT は選択した列によるグループ化と同じ
+                for (const OutputColumn& output : outputs)
+                {
+                    if (std::find(groups.begin(), groups.end(), output.column) == groups.end())
+                    {
+                        groups.push_back(output.column);
+                    }
+                }
+            }
+            if (aggregateQuery)
+            {
+                for (size_t i = 0; i < statement.items.size(); ++i)
+                {
+                    if (statement.items[i].kind == SelectItem::Kind::AllColumns && !statement.distinct)
+                    {
+                        return Fail(statement.items[i].position, "集計する問い合わせでは * を使えません");
+                    }
+                }
+                for (const OutputColumn& output : outputs)
+                {
+                    if (!output.isAggregate && std::find(groups.begin(), groups.end(), output.column) == groups.end())
+                    {
+                        return Fail(output.position, "列 '" + HeaderOf(output.column) + "' は GROUP BY に含まれていません");
+                    }
+                }
+            }
+            return BindOrder();
+        }
+
+        bool BindOrder()
+        {
+            for (const OrderItem& item : statement.orderBy)
+            {
+                OrderTarget target;
+                target.ascending = item.ascending;
+                const OutputColumn* output = nullptr;
+                if (item.ordinal > 0)
+                {
+                    if (item.ordinal > outputs.size())
+                    {
+                        return Fail(item.position, "ORDER BY の位置 " + std::to_string(item.ordinal) + " は SELECT 項目の数を超えています");
+                    }
+                    output = &outputs[item.ordinal - 1];
+                }
+                else if (!item.isAggregate && item.column.table.empty())
+                {
+                    // 表名の無い名前は SELECT 項目の別名を優先する
+                    for (const OutputColumn& candidate : outputs)
+                    {
+                        if (!candidate.alias.empty() && candidate.alias == item.column.column)
+                        {
+                            output = &candidate;
+                            break;
+                        }
+                    }
+                }
+
+                if (output)
+                {
+                    target.isAggregate = output->isAggregate;
+                    target.column = output->column;
+                    target.aggregate = output->aggregate;
+                }
+                else if (item.isAggregate)
+                {
+                    if (!aggregateQuery || statement.distinct)
+                    {
+                        return Fail(item.position, "集計関数による並べ替えは集計する問い合わせでのみ使えます");
+                    }
+                    target.isAggregate = true;
+                    if (!BindAggregate(item.aggregate, target.aggregate))
+                    {
+                        return false;
+                    }
+                }
+                else
+                {
+                    if (!Resolve(item.column, target.column))
+                    {
+                        return false;
+                    }
+                    if (aggregateQuery && std::find(groups.begin(), groups.end(), target.column) == groups.end())
+                    {
+                        return Fail(item.position, "列 '" + item.column.ToString() + "' は GROUP BY に含まれていません");
+                    }
+                }
+                orderTargets.push_back(target);
+            }
+            return true;
+        }
+
+        // 表を走査し、押し下げた条件で行を選び、以後使わない列を落とす
+        bool Scan(size_t relationIndex, std::vector<BoundCondition> filters, const std::vector<bool>& needed,
+            bool prune, Intermediate& result)
+        {
+            const Relation& relation = relations[relationIndex];
+            const CSVData& source = *relation.data;
+            const auto& headers = source.GetHeaders();
+
+            // 索引・ゾーンマップで絞り込める値との比較を先に、そのうち等価条件を範囲条件より先に評価する
+            auto rank = [](const BoundCondition& condition) {
+                if (condition.rightIsColumn)
+                {
+                    return 3;
+                }
+                if (condition.op == "==")
+                {
+                    return 0;
+                }
+                return condition.op == "!=" || condition.op == "contains" ? 2 : 1;
+            };
+            std::stable_sort(filters.begin(), filters.end(), [&](const BoundCondition& a, const BoundCondition& b) {
+                return rank(a) < rank(b);
+            });
+
+            std::string label = "走査 " + relation.name;
+            if (relation.alias != relation.name)
+            {
+                label += " " + relation.alias;
+            }
+            result.plan = { label + "（" + std::to_string(source.GetRowCount()) + " 行）" };
+
+            std::vector<uint32_t> rows;
+            bool filtered = false;
+            for (const BoundCondition& condition : filters)
+            {
+                ScanPredicate predicate;
+                predicate.column = headers[condition.left.column];
+                predicate.op = condition.rightIsColumn ? "==" : condition.op;
+                predicate.value = condition.value;
+                CompiledPredicate compiled;
+                CompilePredicate(predicate, headers, compiled);
+                compiled.columnIndex = static_cast<int>(condition.left.column);
+                compiled.op = condition.op;
+
+                std::string detail;
+                if (!filtered && !condition.rightIsColumn)
+                {
+                    SelectStats selectStats;
+                    rows = SelectRows(source, compiled, &selectStats);
+                    if (selectStats.usedIndex)
+                    {
+                        detail = "（索引）";
+                    }
+                    else if (selectStats.skippedBlocks > 0)
+                    {
+                        detail = "（ゾーンマップで " + std::to_string(selectStats.skippedBlocks) + "/"
+                            + std::to_string(selectStats.blockCount) + " ブロックを読み飛ばし）";
+                    }
+                }
+                else
+                {
+                    rows = MatchRows(source, filtered ? &rows : nullptr, compiled, condition.left.column,
+                        condition.rightIsColumn ? condition.right.column : SIZE_MAX);
+                }
+                filtered = true;
+                result.plan = Nest("選択 " + Describe(condition) + detail + " → " + std::to_string(rows.size()) + " 行", result.plan);
+            }
+
+            std::vector<size_t> kept;
+            for (size_t c = 0; c < headers.size(); ++c)
+            {
+                if (!prune || needed[c])
+                {
+                    kept.push_back(c);
+                }
+            }
+
+            result.data = std::make_unique<CSVData>();
+            if (kept.size() < headers.size())
+            {
+                if (filtered)
+                {
+                    CSVData selected;
+                    selected.SetSelectedRows(source, rows);
+                    result.data->SetProjectedColumns(selected, kept);
+                }
+                else
+                {
+                    result.data->SetProjectedColumns(source, kept);
+                }
+                result.plan = Nest("列の刈り込み " + std::to_string(headers.size()) + " → " + std::to_string(kept.size()) + " 列", result.plan);
+            }
+            else if (filtered)
+            {
+                result.data->SetSelectedRows(source, rows);
+            }
+            else
+            {
+                *result.data = source;
+            }
+
+            std::vector<std::string> names;
+            for (size_t c : kept)
+            {
+                result.columns.push_back({ relationIndex, c });
+                names.push_back(InternalName({ relationIndex, c }));
+            }
+            result.data->SetHeaders(names);
+            result.relations = { relationIndex };
+            return true;
+        }
+
+        // 途中結果を条件で絞り込む
+        void Filter(Intermediate& input, const BoundCondition& condition)
+        {
+            const size_t leftColumn = input.IndexOf(condition.left);
+            ScanPredicate predicate;
+            predicate.column = InternalName(condition.left);
+            predicate.op = condition.rightIsColumn ? "==" : condition.op;
+            predicate.value = condition.value;
+            CompiledPredicate compiled;
+            CompilePredicate(predicate, input.data->GetHeaders(), compiled);
+            compiled.columnIndex = static_cast<int>(leftColumn);
+            compiled.op = condition.op;
+
+            const std::vector<uint32_t> rows = condition.rightIsColumn
+                ? MatchRows(*input.data, nullptr, compiled, leftColumn, input.IndexOf(condition.right))
+                : SelectRows(*input.data, compiled);
+            input.data->SetSelectedRows(*input.data, rows);
+            input.plan = Nest("選択 " + Describe(condition) + " → " + std::to_string(rows.size()) + " 行", input.plan);
+        }
+
+        // ハッシュ結合（ハッシュ表は行数の少ない側に作る）
+        bool Join(Intermediate& left, Intermediate& right, BoundColumn leftKey, BoundColumn rightKey, std::string type,
+            Intermediate& result)
+        {
+            Intermediate* probe = &left;
+            Intermediate* build = &right;
+            if (left.data->GetRowCount() < right.data->GetRowCount())
+            {
+                std::swap(probe, build);
+                std::swap(leftKey, rightKey);
+                if (type == "left")
+                {
+                    type = "right";
+                }
+                else if (type == "right")
+                {
+                    type = "left";
+                }
+            }
+
+            JoinSpec spec;
+            spec.leftColumn = InternalName(leftKey);
+            spec.rightColumn = InternalName(rightKey);
+            spec.type = type;
+            JoinStats joinStats;
+            result.data = std::make_unique<CSVData>();
+            if (!JoinTables(*probe->data, *build->data, spec, *result.data, &joinStats))
+            {
+                message = "結合 " + DisplayName(leftKey) + " = " + DisplayName(rightKey) + " を実行できません";
+                return false;
+            }
+
+            result.columns = probe->columns;
+            result.columns.insert(result.columns.end(), build->columns.begin(), build->columns.end());
+            result.relations = probe->relations;
+            result.relations.insert(result.relations.end(), build->relations.begin(), build->relations.end());
+
+            std::string label = "ハッシュ結合 " + type + " " + DisplayName(leftKey) + " = " + DisplayName(rightKey)
+                + "（ハッシュ表: " + std::to_string(build->data->GetRowCount()) + " 行";
+            if (joinStats.usedBloomFilter)
+            {
+                label += "、Bloom フィルターで " + std::to_string(joinStats.bloomRejectedRows) + " 行を除外";
+            }
+            label += "）→ " + std::to_string(result.data->GetRowCount()) + " 行";
+            result.plan = Nest(label, probe->plan, &build->plan);
+            return true;
+        }
+
+        // 結合キーの向きを、left 側の途中結果に含まれる列が先になるよう揃える
+        static void OrientKey(const Intermediate& left, const BoundCondition& condition, BoundColumn& leftKey, BoundColumn& rightKey)
+        {
+            leftKey = condition.left;
+            rightKey = condition.right;
+            if (!left.Contains(leftKey.relation))
+            {
+                std::swap(leftKey, rightKey);
+            }
+        }
+
+        // 含まれる表がそろった条件を評価する
+        void ApplyReadyFilters(Intermediate& current, std::vector<BoundCondition>& filters)
+        {
+            for (size_t i = 0; i < filters.size();)
+            {
+                const BoundCondition& condition = filters[i];
+                if (current.Contains(condition.left.relation) && (!condition.rightIsColumn || current.Contains(condition.right.relation)))
+                {
+                    Filter(current, condition);
+                    filters.erase(filters.begin() + static_cast<std::ptrdiff_t>(i));
+                }
+                else
+                {
+                    ++i;
+                }
+            }
+        }
+
+        // グループごとの集計値を、グループ列・集計値の順に並べた表にする
+        void Aggregate(Intermediate& input, CSVData& table, std::vector<std::string>& plan)
+        {
+            const CSVData* source = input.data.get();
+            std::string groupName;
+            CSVData keyed;
+            if (groups.size() == 1)
+            {
+                groupName = InternalName(groups[0]);
+            }
+            else if (groups.size() > 1)
+            {
+                // 複数の列でまとめるときは、値を区切り文字でつないだ 1 列をキーにした表を作る
+                std::vector<BoundColumn> valueColumns;
+                for (const BoundAggregate& aggregate : aggregates)
+                {
+                    if (!aggregate.allRows && std::find(valueColumns.begin(), valueColumns.end(), aggregate.column) == valueColumns.end())
+                    {
+                        valueColumns.push_back(aggregate.column);
+                    }
+                }
+                groupName = "\x1fkey";
+                std::vector<std::string> headers = { groupName };
+                std::vector<size_t> valueIndices;
+                for (const BoundColumn& column : valueColumns)
+                {
+                    headers.push_back(InternalName(column));
+                    valueIndices.push_back(input.IndexOf(column));
+                }
+                std::vector<size_t> groupIndices;
+                for (const BoundColumn& column : groups)
+                {
+                    groupIndices.push_back(input.IndexOf(column));
+                }
+                keyed.SetHeaders(headers);
+                std::string key;
+                std::vector<std::string_view> cells(headers.size());
+                for (const CSVRow& row : input.data->GetRows())
+                {
+                    key.clear();
+                    for (size_t g = 0; g < groupIndices.size(); ++g)
+                    {
+                        if (g > 0)
+                        {
+                            key.push_back(keySeparator);
+                        }
+                        key.append(row[groupIndices[g]]);
+                    }
+                    cells[0] = key;
+                    for (size_t v = 0; v < valueIndices.size(); ++v)
+                    {
+                        cells[v + 1] = row[valueIndices[v]];
+                    }
+                    keyed.AddRow(cells);
+                }
+                source = &keyed;
+            }
+
+            // 集計関数ごとに集計する（グループ列だけなら行数を数えてグループを求める）
+            std::vector<CSVData> results(std::max<size_t>(1, aggregates.size()));
+            for (size_t i = 0; i < results.size(); ++i)
+            {
+                AggregateSpec spec;
+                spec.groupColumn = groupName;
+                spec.function = "count";
+                if (i < aggregates.size())
+                {
+                    spec.function = aggregates[i].function;
+                    if (!aggregates[i].allRows)
+                    {
+                        spec.valueColumn = InternalName(aggregates[i].column);
+                    }
+                }
+                GroupAggregator aggregator;
+                aggregator.Reset(spec, source->GetHeaders());
+                aggregator.Add(*source, 0, source->GetRowCount());
+                aggregator.WriteTo(results[i]);
+            }
+
+            std::vector<std::string> headers;
+            for (size_t i = 0; i < groups.size() + aggregates.size(); ++i)
+            {
+                headers.push_back("\x1f" + std::to_string(i));
+            }
+            table.SetHeaders(headers);
+
+            const size_t groupCount = results[0].GetRowCount();
+            std::vector<std::string> row(headers.size());
+            if (groups.empty() && groupCount == 0)
+            {
+                // 行の無い表全体の集計は 1 行になる（件数は 0、それ以外は空）
+                for (size_t i = 0; i < aggregates.size(); ++i)
+                {
+                    const bool counts = aggregates[i].function == "count" || aggregates[i].function == "count_values";
+                    row[i] = counts ? "0" : "";
+                }
+                table.AddRow(row);
+            }
+            for (size_t g = 0; g < groupCount; ++g)
+            {
+                const std::string_view key = results[0].GetCell(g, 0);
+                if (groups.size() > 1)
+                {
+                    size_t begin = 0;
+                    for (size_t i = 0; i < groups.size(); ++i)
+                    {
+                        const size_t end = i + 1 < groups.size() ? key.find(keySeparator, begin) : key.size();
+                        row[i].assign(key.substr(begin, end - begin));
+                        begin = end + 1;
+                    }
+                }
+                else if (groups.size() == 1)
+                {
+                    row[0].assign(key);
+                }
+                for (size_t i = 0; i < aggregates.size(); ++i)
+                {
+                    row[groups.size() + i].assign(results[i].GetCell(g, 1));
+                }
+                table.AddRow(row);
+            }
+
+            std::string label = statement.distinct ? "重複の除去" : "集計";
+            if (!statement.distinct)
+            {
+                for (size_t i = 0; i < aggregates.size(); ++i)
+                {
+                    label += (i == 0 ? " " : ", ") + aggregates[i].text;
+                }
+            }
+            if (!groups.empty())
+            {
+                label += statement.distinct ? " " : " GROUP BY ";
+                for (size_t i = 0; i < groups.size(); ++i)
+                {
+                    label += (i == 0 ? "" : ", ") + DisplayName(groups[i]);
+                }
+            }
+            label += " → " + std::to_string(table.GetRowCount()) + " 行";
+            plan = Nest(label, input.plan);
+        }
+
+        bool Run(CSVData& output, std::vector<std::string>& plan)
+        {
+            if (!BindRelations() || !BindOutputs())
+            {
+                return false;
+            }
+
+            // 外部結合で NULL が補われ得る表
+            const size_t relationCount = relations.size();
+            std::vector<bool> nullSupplied(relationCount, false);
+            bool innerOnly = true;
+            for (size_t i = 0; i < statement.joins.size(); ++i)
+            {
+                const std::string& type = statement.joins[i].type;
+                if (type == "left" || type == "outer")
+                {
+                    nullSupplied[i + 1] = true;
+                }
+                if (type == "right" || type == "outer")
+                {
+                    std::fill(nullSupplied.begin(), nullSupplied.begin() + static_cast<std::ptrdiff_t>(i + 1), true);
+                }
+                if (type != "inner" && type != "cross")
+                {
+                    innerOnly = false;
+                }
+            }
+
+            // 条件を、走査時に評価するもの・結合キー・結合後に評価するものに振り分ける
+            std::vector<std::vector<BoundCondition>> scanFilters(relationCount);
+            std::vector<BoundCondition> edges;
+            std::vector<BoundCondition> postFilters;
+            std::vector<BoundCondition> joinKeys(statement.joins.size());
+            std::vector<bool> hasJoinKey(statement.joins.size(), false);
+            for (size_t i = 0; i < statement.joins.size(); ++i)
+            {
+                const JoinClause& join = statement.joins[i];
+                const size_t joined = i + 1;
+                for (const Condition& condition : join.conditions)
+                {
+                    BoundCondition bound;
+                    if (!Bind(condition, bound))
+                    {
+                        return false;
+                    }
+                    if (innerOnly)
+                    {
+                        if (bound.IsEquiJoin())
+                        {
+                            edges.push_back(bound);
+                        }
+                        else if (bound.IsJoinCondition())
+                        {
+                            postFilters.push_back(bound);
+                        }
+                        else
+                        {
+                            scanFilters[bound.left.relation].push_back(bound);
+                        }
+                        continue;
+                    }
+
+                    const bool spansJoin = bound.IsEquiJoin() && bound.left.relation <= joined && bound.right.relation <= joined
+                        && (bound.left.relation == joined || bound.right.relation == joined);
+                    if (spansJoin && !hasJoinKey[i])
+                    {
+                        joinKeys[i] = bound;
+                        hasJoinKey[i] = true;
+                    }
+                    else if (!bound.IsJoinCondition() && join.type == "left" && bound.left.relation == joined)
+                    {
+                        // LEFT JOIN の ON 条件は右表の行を選ぶだけなので、右表の走査時に評価できる
+                        scanFilters[joined].push_back(bound);
+                    }
+                    else if (!bound.IsJoinCondition() && join.type == "right" && joined == 1 && bound.left.relation == 0)
+                    {
+                        scanFilters[0].push_back(bound);
+                    }
+                    else if (join.type == "inner" && (!bound.IsJoinCondition() ? !nullSupplied[bound.left.relation] : true))
+                    {
+                        if (bound.IsJoinCondition())
+                        {
+                            postFilters.push_back(bound);
+                        }
+                        else
+                        {
+                            scanFilters[bound.left.relation].push_back(bound);
+                        }
+                    }
+                    else
+                    {
+                        return Fail(condition.position, "外部結合の ON 句では、1 つの等価条件と結合される側の表の条件だけに対応しています");
+                    }
+                }
+                if (join.type == "cross" && !innerOnly)
+                {
+                    return Fail(join.table.position, "外部結合と直積を同じ問い合わせで使うことには対応していません");
+                }
+                if (!innerOnly && !hasJoinKey[i])
+                {
+                    return Fail(join.table.position, "表 '" + relations[joined].alias + "' との結合に等価条件が必要です");
+                }
+            }
+            for (const Condition& condition : statement.where)
+            {
+                BoundCondition bound;
+                if (!Bind(condition, bound))
+                {
+                    return false;
+                }
+                if (bound.IsJoinCondition())
+                {
+                    if (innerOnly && bound.IsEquiJoin())
+                    {
+                        edges.push_back(bound);
+                    }
+                    else
+                    {
+                        postFilters.push_back(bound);
+                    }
+                }
+                else if (!nullSupplied[bound.left.relation])
+                {
+                    scanFilters[bound.left.relation].push_back(bound);
+                }
+                else
+                {
+                    // NULL が補われる側の WHERE 条件は補われた行にも適用するため結合後に評価する
+                    postFilters.push_back(bound);
+                }
+            }
+
+            // 以後の演算で参照する列
+            std::vector<std::vector<bool>> needed(relationCount);
+            for (size_t r = 0; r < relationCount; ++r)
+            {
+                needed[r].assign(relations[r].data->GetColumnCount(), false);
+            }
+            auto use = [&](const BoundColumn& column) { needed[column.relation][column.column] = true; };
+            for (const OutputColumn& column : outputs)
+            {
+                if (!column.isAggregate)
+                {
+                    use(column.column);
+                }
+            }
+            for (const BoundColumn& column : groups)
+            {
+                use(column);
+            }
+            for (const BoundAggregate& aggregate : aggregates)
+            {
+                if (!aggregate.allRows)
+                {
+                    use(aggregate.column);
+                }
+            }
+            for (const OrderTarget& target : orderTargets)
+            {
+                if (!target.isAggregate)
+                {
+                    use(target.column);
+                }
+            }
+            for (const std::vector<BoundCondition>* list : { &edges, &postFilters })
+            {
+                for (const BoundCondition& condition : *list)
+                {
+                    use(condition.left);
+                    if (condition.rightIsColumn)
+                    {
+                        use(condition.right);
+                    }
+                }
+            }
+            for (size_t i = 0; i < joinKeys.size(); ++i)
+            {
+                if (hasJoinKey[i])
+                {
+                    use(joinKeys[i].left);
+                    use(joinKeys[i].right);
+                }
+            }
+
+            std::vector<Intermediate> scans(relationCount);
+            for (size_t r = 0; r < relationCount; ++r)
+            {
+                if (!Scan(r, scanFilters[r], needed[r], relationCount > 1, scans[r]))
+                {
+                    return false;
+                }
+            }
+
+            Intermediate current;
+            if (innerOnly)
+            {
+                // 絞り込み後に最も小さい表から始め、結合条件でつながる表のうち最も小さいものを順に結合する
+                size_t start = 0;
+                for (size_t r = 1; r < relationCount; ++r)
+                {
+                    if (scans[r].data->GetRowCount() < scans[start].data->GetRowCount())
+                    {
+                        start = r;
+                    }
+                }
+                current = std::move(scans[start]);
+                ApplyReadyFilters(current, postFilters);
+                for (size_t joinedCount = 1; joinedCount < relationCount; ++joinedCount)
+                {
+                    size_t best = SIZE_MAX;
+                    size_t bestEdge = 0;
+                    for (size_t e = 0; e < edges.size(); ++e)
+                    {
+                        const bool leftIn = current.Contains(edges[e].left.relation);
+                        const bool rightIn = current.Contains(edges[e].right.relation);
+                        if (leftIn == rightIn)
+                        {
+                            continue;
+                        }
+                        const size_t candidate = leftIn ? edges[e].right.relation : edges[e].left.relation;
+                        if (best == SIZE_MAX || scans[candidate].data->GetRowCount() < scans[best].data->GetRowCount())
+                        {
+                            best = candidate;
+                            bestEdge = e;
+                        }
+                    }
+                    if (best == SIZE_MAX)
+                    {
+                        for (size_t r = 0; r < relationCount; ++r)
+                        {
+                            if (!current.Contains(r))
+                            {
+                                const size_t position = r == 0 ? statement.from.position : statement.joins[r - 1].table.position;
+                                return Fail(position, "表 '" + relations[r].alias + "' は結合条件でつながっていません（直積には対応していません）");
+                            }
+                        }
+                    }
+
+                    BoundColumn leftKey;
+                    BoundColumn rightKey;
+                    OrientKey(current, edges[bestEdge], leftKey, rightKey);
+                    edges.erase(edges.begin() + static_cast<std::ptrdiff_t>(bestEdge));
+                    Intermediate next;
+                    if (!Join(current, scans[best], leftKey, rightKey, "inner", next))
+                    {
+                        return false;
+                    }
+                    current = std::move(next);
+                    // 結合キーに使わなかった等価条件は、両方の表がそろった時点で絞り込みとして評価する
+                    ApplyReadyFilters(current, edges);
+                    ApplyReadyFilters(current, postFilters);
+                }
+            }
+            else
+            {
+                // 外部結合は結合順序で結果が変わるため、書かれた順に結合する
+                current = std::move(scans[0]);
+                for (size_t i = 0; i < statement.joins.size(); ++i)
+                {
+                    BoundColumn leftKey;
+                    BoundColumn rightKey;
+                    OrientKey(current, joinKeys[i], leftKey, rightKey);
+                    Intermediate next;
+                    if (!Join(current, scans[i + 1], leftKey, rightKey, statement.joins[i].type, next))
+                    {
+                        return false;
+                    }
+                    current = std::move(next);
+                }
+                ApplyReadyFilters(current, postFilters);
+            }
+
+            // 集計・並べ替え・行数の制限・射影
+            std::unique_ptr<CSVData> table;
+            std::vector<std::string> tablePlan;
+            std::vector<size_t> outputIndices;
+            std::vector<std::pair<size_t, bool>> sortKeys;
+            if (aggregateQuery)
+            {
+                table = std::make_unique<CSVData>();
+                Aggregate(current, *table, tablePlan);
+                auto indexOf = [&](bool isAggregate, const BoundColumn& column, size_t aggregate) {
+                    return isAggregate ? groups.size() + aggregate
+                        : static_cast<size_t>(std::find(groups.begin(), groups.end(), column) - groups.begin());
+                };
+                for (const OutputColumn& column : outputs)
+                {
+                    outputIndices.push_back(indexOf(column.isAggregate, column.column, column.aggregate));
+                }
+                for (const OrderTarget& target : orderTargets)
+                {
+                    sortKeys.emplace_back(indexOf(target.isAggregate, target.column, target.aggregate), target.ascending);
+                }
+            }
+            else
+            {
+                table = std::move(current.data);
+                tablePlan = std::move(current.plan);
+                for (const OutputColumn& column : outputs)
+                {
+                    outputIndices.push_back(current.IndexOf(column.column));
+                }
+                for (const OrderTarget& target : orderTargets)
+                {
+                    sortKeys.emplace_back(current.IndexOf(target.column), target.ascending);
+                }
+            }
+
+            const size_t rowCount = table->GetRowCount();
+            const size_t offset = std::min(statement.offset, rowCount);
+            const size_t end = statement.hasLimit ? offset + std::min(statement.limit, rowCount - offset) : rowCount;
+            std::vector<uint32_t> rows;
+            bool reordered = false;
+            if (!sortKeys.empty())
+            {
+                rows = SortRowOrder(*table, sortKeys, end);
+                reordered = true;
+                std::string label = end < rowCount ? "並べ替え（上位 " + std::to_string(end) + " 行）" : "並べ替え";
+                tablePlan = Nest(label, tablePlan);
+            }
+            if (offset > 0 || end < rowCount)
+            {
+                if (!reordered)
+                {
+                    rows.resize(end);
+                    std::iota(rows.begin(), rows.end(), 0u);
+                    reordered = true;
+                }
+                rows.erase(rows.begin(), rows.begin() + static_cast<std::ptrdiff_t>(offset));
+                tablePlan = Nest("行数の制限 " + std::to_string(offset) + " 行目から " + std::to_string(rows.size()) + " 行", tablePlan);
+            }
+            if (reordered)
+            {
+                table->SetSelectedRows(*table, rows);
+            }
+
+            std::vector<std::string> names;
+            bool identity = outputIndices.size() == table->GetColumnCount();
+            for (size_t i = 0; i < outputs.size(); ++i)
+            {
+                names.push_back(outputs[i].name);
+                identity = identity && outputIndices[i] == i;
+            }
+            if (identity)
+            {
+                output = *table;
+            }
+            else
+            {
+                output.SetProjectedColumns(*table, outputIndices);
+            }
+            output.SetHeaders(names);
+            plan = Nest("射影 " + std::to_string(names.size()) + " 列 → " + std::to_string(output.GetRowCount()) + " 行", tablePlan);
+            return true;
+        }
+    };
+}
+
+bool ExecuteSqlQuery(const std::string& query, const std::vector<SqlTable>& tables, CSVData& output,
+    std::string& error, SqlQueryStats* stats)
+{
+    std::vector<Token> tokens;
+    if (!Tokenize(query, tokens, error))
+    {
+        return false;
+    }
+    SelectStatement statement;
+    Parser parser(tokens);
+    if (!parser.ParseStatement(statement, error))
+    {
+        return false;
+    }
+
+    CSVData result;
+    std::vector<std::string> plan;
+    QueryExecutor executor(statement, tables);
+    if (!executor.Execute(result, plan, error))
+    {
+        return false;
+    }
+    output = result;
+    if (stats)
+    {
+        stats->plan = std::move(plan);
+        stats->outputRows = output.GetRowCount();
+    }
+    return true;
+}
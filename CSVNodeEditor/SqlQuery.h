@@ -0,0 +1,38 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// SQL の問い合わせから参照する表
+struct SqlTable
+{
+    std::string name;
+    const CSVData* data = nullptr;
+};
+
+// 問い合わせの実行結果
+struct SqlQueryStats
+{
+    std::vector<std::string> plan;  // 実行した計画（1 行 1 演算。字下げした行がその入力）
+    size_t outputRows = 0;
+};
+
+// SELECT 文を解析し、ノードと同じ演算（条件による行の選択・ハッシュ結合・グループ集計）に組み立てて実行する
+// 対応する構文:
+//   SELECT [DISTINCT] 列 | 表.列 | * | 表.* | COUNT(*) | COUNT / SUM / AVG / MIN / MAX(列) [[AS] 別名], ...
+//   FROM 表 [[AS] 別名] { , 表 | [INNER | LEFT | RIGHT | FULL] [OUTER] JOIN 表 ON 条件 } ...
+//   [WHERE 条件] [GROUP BY 列, ...] [ORDER BY 列 | 別名 | 位置 [ASC | DESC], ...] [LIMIT n [OFFSET m]]
+// 条件は「列 比較 値」「列 比較 列」「列 LIKE '%文字列%'」「列 IS [NOT] NULL」を AND でつないだもの。
+// 比較はフィルターノードと同じく、セルと値がともに数値なら数値として、それ以外は文字列として行う。空のセルを NULL とみなす。
+// 規則による最適化:
+//   - 条件の押し下げ: 1 つの表だけを参照する条件は、結合の前にその表の索引・ゾーンマップを使って評価する
+//     （外部結合で NULL が補われる側の WHERE 条件は結合後に評価する）
+//   - 結合順序: 内部結合だけの問い合わせは、絞り込み後の行数が最も少ない表から始め、結合条件でつながる表のうち
+//     行数の少ないものから順に結合する。ハッシュ表はどの結合でも行数の少ない側に作る
+//   - 列の刈り込み: 結合の前に、以後の演算で参照しない列を落とす
+//   - ORDER BY と LIMIT があれば上位の行だけを部分整列する
+// 失敗した場合は error に理由を設定して false を返す（output は変更しない）。
+bool ExecuteSqlQuery(const std::string& query, const std::vector<SqlTable>& tables, CSVData& output,
+    std::string& error, SqlQueryStats* stats = nullptr);
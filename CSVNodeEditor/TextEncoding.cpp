@@ -0,0 +1,538 @@
+﻿#include "TextEncoding.h"
+#include "Cp932Table.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || (defined(__i386__) && defined(__SSE2__))
+#define NSYS_HAS_X86_SIMD 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#define NSYS_TARGET_SSSE3
+#else
+#include <cpuid.h>
+#define NSYS_TARGET_SSSE3 __attribute__((target("ssse3")))
+#endif
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#endif
+
+namespace
+{
+    // 文字コード推定に使う先頭部分の大きさ
+    const size_t detectionSampleSize = 64 << 10;
+
+    const uint32_t replacementCharacter = 0xFFFD;
+
+    // BMP のコードポイントを UTF-8 で書き込み、書き込んだ後の位置を返す
+    char* WriteCodePoint(char* output, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            *output++ = static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            *output++ = static_cast<char>(0xC0 | (codePoint >> 6));
+            *output++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            *output++ = static_cast<char>(0xE0 | (codePoint >> 12));
+            *output++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            *output++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return output;
+    }
+
+    void AppendCodePoint(std::string& output, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            output.push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800)
+        {
+            output.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            output.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            output.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            output.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    // 先頭から続く ASCII のバイト数
+    size_t AsciiPrefixLength(const uint8_t* data, size_t size)
+    {
+        size_t i = 0;
+#ifdef NSYS_HAS_X86_SIMD
+        for (; i + 16 <= size; i += 16)
+        {
+            int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+            if (mask != 0)
+            {
+                int offset = 0;
+                while ((mask & (1 << offset)) == 0)
+                {
+                    ++offset;
+                }
+                return i + offset;
+            }
+        }
+#else
+        for (; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            if ((word & 0x8080808080808080ull) != 0)
+            {
+                break;
+            }
+        }
+#endif
+        while (i < size && data[i] < 0x80)
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    // 先頭の UTF-8 シーケンスが正しければその長さ、不正または途中で切れていれば 0
+    size_t Utf8SequenceLength(const uint8_t* data, size_t size)
+    {
+        const uint8_t lead = data[0];
+        if (lead < 0x80)
+        {
+            return 1;
+        }
+        if (lead < 0xC2)
+        {
+            return 0;
+        }
+        if (lead < 0xE0)
+        {
+            return size >= 2 && (data[1] & 0xC0) == 0x80 ? 2 : 0;
+        }
+        if (lead < 0xF0)
+        {
+            // 冗長表現（E0 80..9F）とサロゲート（ED A0..BF）を除く
+            const uint8_t low = lead == 0xE0 ? 0xA0 : 0x80;
+            const uint8_t high = lead == 0xED ? 0x9F : 0xBF;
+            return size >= 3 && data[1] >= low && data[1] <= high && (data[2] & 0xC0) == 0x80 ? 3 : 0;
+        }
+        if (lead < 0xF5)
+        {
+            // 冗長表現（F0 80..8F）と U+10FFFF 超（F4 90..）を除く
+            const uint8_t low = lead == 0xF0 ? 0x90 : 0x80;
+            const uint8_t high = lead == 0xF4 ? 0x8F : 0xBF;
+            return size >= 4 && data[1] >= low && data[1] <= high
+                && (data[2] & 0xC0) == 0x80 && (data[3] & 0xC0) == 0x80 ? 4 : 0;
+        }
+        return 0;
+    }
+
+    bool IsValidUtf8Scalar(const uint8_t* data, size_t size)
+    {
+        size_t i = 0;
+        while (i < size)
+        {
+            i += AsciiPrefixLength(data + i, size - i);
+            if (i >= size)
+            {
+                break;
+            }
+            size_t length = Utf8SequenceLength(data + i, size - i);
+            if (length == 0)
+            {
+                return false;
+            }
+            i += length;
+        }
+        return true;
+    }
+
+    bool IsCp932Trail(uint8_t trail)
+    {
+        return trail >= 0x40 && trail <= 0xFC && trail != 0x7F;
+    }
+
+    // 1 バイトの CP932 文字（ASCII と半角カナ以外は Windows の対応に合わせる）
+    uint32_t Cp932SingleByte(uint8_t value)
+    {
+        if (value >= 0xA1 && value <= 0xDF)
+        {
+            return 0xFF61 + (value - 0xA1);
+        }
+        switch (value)
+        {
+        case 0x80: return 0x0080;
+        case 0xA0: return 0xF8F0;
+        case 0xFD: return 0xF8F1;
+        case 0xFE: return 0xF8F2;
+        case 0xFF: return 0xF8F3;
+        default: return replacementCharacter;
+        }
+    }
+
+    // input[position] から続く ASCII を output に複写し、position と output を進める
+    // x86 では 16 バイト単位で書き込むため、output には入力の残り以上の余裕が必要。
+    void CopyAsciiRun(const uint8_t* input, size_t size, size_t& position, char*& output)
+    {
+#ifdef NSYS_HAS_X86_SIMD
+        while (position + 16 <= size)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + position));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(output), chunk);
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(chunk));
+            if (mask != 0)
+            {
+                size_t ascii = 0;
+                while ((mask & (1u << ascii)) == 0)
+                {
+                    ++ascii;
+                }
+                position += ascii;
+                output += ascii;
+                return;
+            }
+            position += 16;
+            output += 16;
+        }
+#endif
+        while (position < size && input[position] < 0x80)
+        {
+            *output++ = static_cast<char>(input[position++]);
+        }
+    }
+
+    // UTF-8 として正しい 2〜4 バイト文字の数と不正なバイト数を数える（末尾で切れたシーケンスは数えない）
+    void CountUtf8Sequences(const uint8_t* data, size_t size, size_t& multibyte, size_t& errors)
+    {
+        multibyte = 0;
+        errors = 0;
+        size_t i = 0;
+        while (i < size)
+        {
+            i += AsciiPrefixLength(data + i, size - i);
+            if (i >= size)
+            {
+                break;
+            }
+            size_t length = Utf8SequenceLength(data + i, size - i);
+            if (length == 0)
+            {
+                if (size - i < 4 && data[i] >= 0xC2 && data[i] < 0xF5)
+                {
+                    break;
+                }
+                ++errors;
+                length = 1;
+            }
+            else
+            {
+                ++multibyte;
+            }
+            i += length;
+        }
+    }
+
+    // CP932 として不正・未定義の文字数（末尾で切れた 2 バイト文字は数えない）
+    size_t CountCp932Errors(const uint8_t* data, size_t size)
+    {
+        size_t errors = 0;
+        size_t i = 0;
+        while (i < size)
+        {
+            i += AsciiPrefixLength(data + i, size - i);
+            if (i >= size)
+            {
+                break;
+            }
+            int leadIndex = Cp932LeadIndex(data[i]);
+            if (leadIndex < 0)
+            {
+                // 半角カナ以外の 1 バイト文字は通常のテキストには現れない
+                if (Cp932SingleByte(data[i]) < 0xFF61)
+                {
+                    ++errors;
+                }
+                ++i;
+                continue;
+            }
+            if (i + 1 >= size)
+            {
+                break;
+            }
+            if (!IsCp932Trail(data[i + 1]) ||
+                cp932DoubleByteTable[leadIndex * cp932TrailCount + (data[i + 1] - 0x40)] == 0)
+            {
+                ++errors;
+                ++i;
+                continue;
+            }
+            i += 2;
+        }
+        return errors;
+    }
+
+    // CP932 の 2 バイト文字を UTF-8 に符号化済みの表（下位 3 バイトに UTF-8、最上位バイトに長さ）
+    // 先頭バイトは 256 通りすべてを引けるようにし、2 バイト文字の先頭でない行は 0 とする。
+    struct Cp932Utf8Table
+    {
+        std::vector<uint32_t> entries;
+
+        Cp932Utf8Table()
+            : entries(256 * 256, 0)
+        {
+            for (int lead = 0; lead < 256; ++lead)
+            {
+                int leadIndex = Cp932LeadIndex(static_cast<uint8_t>(lead));
+                if (leadIndex < 0)
+                {
+                    continue;
+                }
+                for (int trail = 0; trail < 256; ++trail)
+                {
+                    uint32_t codePoint = replacementCharacter;
+                    if (IsCp932Trail(static_cast<uint8_t>(trail)))
+                    {
+                        uint16_t mapped = cp932DoubleByteTable[leadIndex * cp932TrailCount + (trail - 0x40)];
+                        codePoint = mapped != 0 ? mapped : replacementCharacter;
+                    }
+                    char encoded[4] = {};
+                    size_t length = WriteCodePoint(encoded, codePoint) - encoded;
+                    uint32_t entry = static_cast<uint32_t>(length) << 24;
+                    for (size_t b = 0; b < length; ++b)
+                    {
+                        entry |= static_cast<uint32_t>(static_cast<uint8_t>(encoded[b])) << (8 * b);
+                    }
+                    entries[lead * 256 + trail] = entry;
+                }
+            }
+        }
+    };
+
+#ifdef NSYS_HAS_X86_SIMD
+
+    bool HasSsse3()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 9)) != 0;
+#else
+        unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+        return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSSE3) != 0;
+#endif
+    }
+
+    const bool ssse3Available = HasSsse3();
+
+    // 16 バイトずつ、直前 3 バイトとの組み合わせを表引きで検証する
+    // （Keiser・Lemire "Validating UTF-8 In Less Than One Instruction Per Byte" の lookup 方式）
+    NSYS_TARGET_SSSE3 bool IsValidUtf8Ssse3(const uint8_t* data, size_t size)
+    {
+        const int8_t tooShort = 1 << 0;
+        const int8_t tooLong = 1 << 1;
+        const int8_t overlong3 = 1 << 2;
+        const int8_t tooLarge = 1 << 3;
+        const int8_t surrogate = 1 << 4;
+        const int8_t overlong2 = 1 << 5;
+        const int8_t tooLarge1000 = 1 << 6;
+        const int8_t overlong4 = 1 << 6;
+        const int8_t twoConts = static_cast<int8_t>(1 << 7);
+        const int8_t carry = tooShort | tooLong | twoConts;
+
+        // 1 バイト目の上位 4 ビット
+        const __m128i byte1HighTable = _mm_setr_epi8(
+            tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong, tooLong,
+            twoConts, twoConts, twoConts, twoConts,
+            tooShort | overlong2,
+            tooShort,
+            tooShort | overlong3 | surrogate,
+            tooShort | tooLarge | tooLarge1000 | overlong4);
+        // 1 バイト目の下位 4 ビット
+        const __m128i byte1LowTable = _mm_setr_epi8(
+            carry | overlong3 | overlong2 | overlong4,
+            carry | overlong2,
+            carry,
+            carry,
+            carry | tooLarge,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000 | surrogate,
+            carry | tooLarge | tooLarge1000,
+            carry | tooLarge | tooLarge1000);
+        // 2 バイト目の上位 4 ビット
+        const __m128i byte2HighTable = _mm_setr_epi8(
+            tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort, tooShort,
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge1000 | overlong4,
+            tooLong | overlong2 | twoConts | overlong3 | tooLarge,
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooLong | overlong2 | twoConts | surrogate | tooLarge,
+            tooShort, tooShort, tooShort, tooShort);
+        // ブロック末尾で 2〜4 バイト文字が途中になっているかの判定用
+        const __m128i incompleteLimit = _mm_setr_epi8(
+            -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+            static_cast<int8_t>(0xF0 - 1), static_cast<int8_t>(0xE0 - 1), static_cast<int8_t>(0xC0 - 1));
+        const __m128i lowNibble = _mm_set1_epi8(0x0F);
+
+        __m128i error = _mm_setzero_si128();
+        __m128i previous = _mm_setzero_si128();
+        __m128i previousIncomplete = _mm_setzero_si128();
+        for (size_t i = 0; i < size; i += 16)
+        {
+            __m128i input;
+            if (size - i >= 16)
+            {
+                input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            }
+            else
+            {
+                // 末尾は 0（ASCII）で埋めて検証する
+                alignas(16) uint8_t tail[16] = {};
+                std::memcpy(tail, data + i, size - i);
+                input = _mm_load_si128(reinterpret_cast<const __m128i*>(tail));
+            }
+
+            if (_mm_movemask_epi8(input) == 0)
+            {
+                error = _mm_or_si128(error, previousIncomplete);
+            }
+            else
+            {
+                __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+                __m128i byte1High = _mm_shuffle_epi8(byte1HighTable, _mm_and_si128(_mm_srli_epi16(prev1, 4), lowNibble));
+                __m128i byte1Low = _mm_shuffle_epi8(byte1LowTable, _mm_and_si128(prev1, lowNibble));
+                __m128i byte2High = _mm_shuffle_epi8(byte2HighTable, _mm_and_si128(_mm_srli_epi16(input, 4), lowNibble));
+                __m128i specialCases = _mm_and_si128(_mm_and_si128(byte1High, byte1Low), byte2High);
+
+                // 3・4 バイト文字の 3・4 バイト目は継続バイトでなければならない
+                __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+                __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+                __m128i isThirdByte = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<int8_t>(0xE0 - 0x80)));
+                __m128i isFourthByte = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<int8_t>(0xF0 - 0x80)));
+                __m128i mustBeContinuation = _mm_and_si128(_mm_or_si128(isThirdByte, isFourthByte),
+                    _mm_set1_epi8(static_cast<int8_t>(0x80)));
+                error = _mm_or_si128(error, _mm_xor_si128(mustBeContinuation, specialCases));
+                previousIncomplete = _mm_subs_epu8(input, incompleteLimit);
+            }
+            previous = input;
+        }
+        error = _mm_or_si128(error, previousIncomplete);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) == 0xFFFF;
+    }
+
+#endif
+}
+
+TextEncoding DetectTextEncoding(const char* data, size_t size, size_t& bomLength)
+{
+    bomLength = 0;
+    if (size >= 3 && static_cast<uint8_t>(data[0]) == 0xEF && static_cast<uint8_t>(data[1]) == 0xBB &&
+        static_cast<uint8_t>(data[2]) == 0xBF)
+    {
+        bomLength = 3;
+        return TextEncoding::Utf8;
+    }
+
+    // 日本語の CP932 は先頭バイトの多くが UTF-8 の継続バイトと重なるため、UTF-8 としてはすぐに不正になる。
+    // 逆に UTF-8 の文字列は半角カナ混じりの CP932 としても読めてしまうことが多いため、
+    // UTF-8 としてほぼ正しければ（不正なバイトが 2〜4 バイト文字の 1/16 未満なら）UTF-8 を優先する。
+    const uint8_t* sample = reinterpret_cast<const uint8_t*>(data);
+    const size_t sampleSize = std::min(size, detectionSampleSize);
+    size_t utf8Multibyte = 0;
+    size_t utf8Errors = 0;
+    CountUtf8Sequences(sample, sampleSize, utf8Multibyte, utf8Errors);
+    if (utf8Errors == 0 || utf8Errors * 16 < utf8Multibyte)
+    {
+        return TextEncoding::Utf8;
+    }
+    const size_t cp932Errors = CountCp932Errors(sample, sampleSize);
+    return cp932Errors < utf8Errors ? TextEncoding::Cp932 : TextEncoding::Utf8;
+}
+
+bool IsValidUtf8(const char* data, size_t size)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+#ifdef NSYS_HAS_X86_SIMD
+    if (ssse3Available)
+    {
+        return IsValidUtf8Ssse3(bytes, size);
+    }
+#endif
+    return IsValidUtf8Scalar(bytes, size);
+}
+
+void AppendSanitizedUtf8(std::string& output, const char* data, size_t size)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    while (i < size)
+    {
+        size_t ascii = AsciiPrefixLength(bytes + i, size - i);
+        output.append(data + i, ascii);
+        i += ascii;
+        if (i >= size)
+        {
+            break;
+        }
+        size_t length = Utf8SequenceLength(bytes + i, size - i);
+        if (length == 0)
+        {
+            AppendCodePoint(output, replacementCharacter);
+            ++i;
+            continue;
+        }
+        output.append(data + i, length);
+        i += length;
+    }
+}
+
+void AppendCp932AsUtf8(std::string& output, const char* data, size_t size)
+{
+    static const Cp932Utf8Table table;
+
+    // CP932 の 1 文字（1〜2 バイト）は UTF-8 で最大 3 バイトになるため、先に確保して直接書き込む
+    // （表の値は 4 バイト単位で書き込むため 1 バイト余分に確保する）
+    const size_t start = output.size();
+    output.resize(start + size * 3 + 1);
+    char* out = &output[start];
+
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    size_t i = 0;
+    while (i < size)
+    {
+        CopyAsciiRun(bytes, size, i, out);
+        if (i >= size)
+        {
+            break;
+        }
+
+        const uint8_t lead = bytes[i];
+        if (i + 1 < size && Cp932LeadIndex(lead) >= 0 && IsCp932Trail(bytes[i + 1]))
+        {
+            uint32_t entry = table.entries[lead * 256 + bytes[i + 1]];
+            uint32_t encoded = entry & 0xFFFFFF;
+            std::memcpy(out, &encoded, sizeof(encoded));
+            out += entry >> 24;
+            i += 2;
+            continue;
+        }
+
+        // 1 バイト文字、または後続バイトが無い・不正な 2 バイト文字の先頭（次のバイトは改めて解釈する）
+        out = WriteCodePoint(out, Cp932LeadIndex(lead) >= 0 ? replacementCharacter : Cp932SingleByte(lead));
+        ++i;
+    }
+    output.resize(out - output.data());
+}
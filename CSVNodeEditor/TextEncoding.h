@@ -0,0 +1,26 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <string>
+
+// 入力ファイルの文字コード
+enum class TextEncoding
+{
+    Utf8,
+    Cp932       // Shift_JIS（Windows の CP932）
+};
+
+// BOM と先頭部分の統計から文字コードを推定する
+// UTF-8 の BOM があれば bomLength に 3 を設定する。BOM が無い場合は先頭 64KiB を
+// UTF-8・CP932 として解釈したときの不正なバイト列の数を比べ、UTF-8 としてほぼ正しければ UTF-8 とする。
+TextEncoding DetectTextEncoding(const char* data, size_t size, size_t& bomLength);
+
+// 有効な UTF-8 か（x86 では SSSE3 の表引きで 16 バイトずつ検証する）
+bool IsValidUtf8(const char* data, size_t size);
+
+// 不正な UTF-8 のバイトを U+FFFD に置き換えて追記する
+void AppendSanitizedUtf8(std::string& output, const char* data, size_t size);
+
+// CP932 を UTF-8 に変換して追記する（未定義の文字は U+FFFD）
+// ASCII の連続部分はまとめて複写し、2 バイト文字は対応表で変換する。
+void AppendCp932AsUtf8(std::string& output, const char* data, size_t size);
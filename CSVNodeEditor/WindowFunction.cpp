@@ -0,0 +1,282 @@
+﻿#include "WindowFunction.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+    std::string_view CellAt(const CSVRow& row, int columnIndex)
+    {
+        return columnIndex < 0 ? std::string_view() : row[static_cast<size_t>(columnIndex)];
+    }
+
+    int FindColumn(const std::vector<std::string>& headers, const std::string& column)
+    {
+        for (size_t i = 0; i < headers.size(); ++i)
+        {
+            if (headers[i] == column)
+            {
+                return static_cast<int>(i);
+            }
+        }
+        return -1;
+    }
+
+    // 数値でないセルは NaN として扱う
+    double ParseNumber(std::string_view value)
+    {
+        double result = 0.0;
+        if (!ParseDouble(value, result))
+        {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+        return result;
+    }
+
+    std::string FormatNumber(double value)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+        return buffer;
+    }
+
+    bool IsRollingFunction(const std::string& function)
+    {
+        return function == "rolling_sum" || function == "rolling_mean"
+            || function == "rolling_min" || function == "rolling_max";
+    }
+
+    // 累積和によるフレーム合計・平均（ウィンドウ幅に依存しない）
+    void ComputeRollingSum(const std::vector<double>& values, size_t windowSize, bool mean, std::vector<std::string>& results)
+    {
+        const size_t n = values.size();
+        std::vector<double> prefixSum(n + 1, 0.0);
+        std::vector<size_t> prefixCount(n + 1, 0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            bool valid = !std::isnan(values[i]);
+            prefixSum[i + 1] = prefixSum[i] + (valid ? values[i] : 0.0);
+            prefixCount[i + 1] = prefixCount[i] + (valid ? 1 : 0);
+        }
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            size_t begin = (i + 1 > windowSize) ? i + 1 - windowSize : 0;
+            size_t count = prefixCount[i + 1] - prefixCount[begin];
+            if (count == 0)
+            {
+                continue;
+            }
+            double sum = prefixSum[i + 1] - prefixSum[begin];
+            results[i] = FormatNumber(mean ? sum / static_cast<double>(count) : sum);
+        }
+    }
+
+    // 単調デックによるフレーム最小・最大（各要素の出し入れは1回のみ）
+    void ComputeRollingExtreme(const std::vector<double>& values, size_t windowSize, bool minimum, std::vector<std::string>& results)
+    {
+        std::deque<size_t> candidates;
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            if (!std::isnan(values[i]))
+            {
+                while (!candidates.empty()
+                    && (minimum ? values[candidates.back()] >= values[i] : values[candidates.back()] <= values[i]))
+                {
+                    candidates.pop_back();
+                }
+                candidates.push_back(i);
+            }
+
+            size_t begin = (i + 1 > windowSize) ? i + 1 - windowSize : 0;
+            while (!candidates.empty() && candidates.front() < begin)
+            {
+                candidates.pop_front();
+            }
+
+            if (!candidates.empty())
+            {
+                results[i] = FormatNumber(values[candidates.front()]);
+            }
+        }
+    }
+}
+
+bool ComputeWindow(const CSVData& input, const WindowSpec& spec, CSVData& output)
+{
+    const auto& headers = input.GetHeaders();
+    const auto& rows = input.GetRows();
+    const std::string& function = spec.function;
+
+    int partitionIndex = spec.partitionColumn.empty() ? -1 : FindColumn(headers, spec.partitionColumn);
+    int orderIndex = spec.orderColumn.empty() ? -1 : FindColumn(headers, spec.orderColumn);
+    int valueIndex = spec.valueColumn.empty() ? -1 : FindColumn(headers, spec.valueColumn);
+
+    if ((!spec.partitionColumn.empty() && partitionIndex < 0) || (!spec.orderColumn.empty() && orderIndex < 0))
+    {
+        return false;
+    }
+
+    bool needsValue = function != "row_number" && function != "rank";
+    bool knownFunction = !needsValue || function == "running_sum" || function == "lag" || function == "lead"
+        || IsRollingFunction(function);
+    if (!knownFunction || (needsValue && valueIndex < 0))
+    {
+        return false;
+    }
+    if (IsRollingFunction(function) && spec.windowSize == 0)
+    {
+        return false;
+    }
+
+    // パーティション分割（1パス）。出現順を維持する
+    std::unordered_map<std::string_view, size_t> partitionLookup;
+    std::vector<std::vector<size_t>> partitions;
+    for (size_t r = 0; r < rows.size(); ++r)
+    {
+        std::string_view key = CellAt(rows[r], partitionIndex);
+        auto inserted = partitionLookup.emplace(key, partitions.size());
+        if (inserted.second)
+        {
+            partitions.emplace_back();
+        }
+        partitions[inserted.first->second].push_back(r);
+    }
+
+    // 並べ替えキーは全セルが数値であれば数値として比較する
+    std::vector<double> orderNumbers;
+    bool orderIsNumeric = false;
+    if (orderIndex >= 0)
+    {
+        orderNumbers.resize(rows.size());
+        orderIsNumeric = true;
+        for (size_t r = 0; r < rows.size(); ++r)
+        {
+            orderNumbers[r] = ParseNumber(CellAt(rows[r], orderIndex));
+            if (std::isnan(orderNumbers[r]))
+            {
+                orderIsNumeric = false;
+                break;
+            }
+        }
+    }
+
+    auto orderLess = [&](size_t a, size_t b) {
+        if (orderIsNumeric)
+        {
+            return spec.ascending ? orderNumbers[a] < orderNumbers[b] : orderNumbers[a] > orderNumbers[b];
+        }
+        std::string_view left = CellAt(rows[a], orderIndex);
+        std::string_view right = CellAt(rows[b], orderIndex);
+        return spec.ascending ? left < right : left > right;
+    };
+    auto orderEqual = [&](size_t a, size_t b) {
+        if (orderIndex < 0)
+        {
+            return false;
+        }
+        if (orderIsNumeric)
+        {
+            return orderNumbers[a] == orderNumbers[b];
+        }
+        return CellAt(rows[a], orderIndex) == CellAt(rows[b], orderIndex);
+    };
+
+    // パーティションごとの結果（パーティション内の並び順に対応）
+    std::vector<std::vector<std::string>> partitionResults(partitions.size());
+
+    ParallelFor(partitions.size(), [&](size_t p) {
+        auto& members = partitions[p];
+        if (orderIndex >= 0)
+        {
+            std::stable_sort(members.begin(), members.end(), orderLess);
+        }
+
+        const size_t n = members.size();
+        auto& results = partitionResults[p];
+        results.assign(n, std::string());
+
+        if (function == "row_number")
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                results[i] = std::to_string(i + 1);
+            }
+        }
+        else if (function == "rank")
+        {
+            size_t rank = 1;
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (i > 0 && !orderEqual(members[i - 1], members[i]))
+                {
+                    rank = i + 1;
+                }
+                results[i] = std::to_string(rank);
+            }
+        }
+        else if (function == "lag" || function == "lead")
+        {
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (function == "lag" && i >= spec.offset)
+                {
+                    results[i] = CellAt(rows[members[i - spec.offset]], valueIndex);
+                }
+                else if (function == "lead" && i + spec.offset < n)
+                {
+                    results[i] = CellAt(rows[members[i + spec.offset]], valueIndex);
+                }
+            }
+        }
+        else
+        {
+            std::vector<double> values(n);
+            for (size_t i = 0; i < n; ++i)
+            {
+                values[i] = ParseNumber(CellAt(rows[members[i]], valueIndex));
+            }
+
+            if (function == "running_sum")
+            {
+                ComputeRollingSum(values, n, false, results);
+            }
+            else if (function == "rolling_sum" || function == "rolling_mean")
+            {
+                ComputeRollingSum(values, spec.windowSize, function == "rolling_mean", results);
+            }
+            else
+            {
+                ComputeRollingExtreme(values, spec.windowSize, function == "rolling_min", results);
+            }
+        }
+    });
+
+    // 出力テーブルを構築（パーティション順・並べ替え順）
+    std::vector<std::string> outputHeaders = headers;
+    outputHeaders.push_back(spec.outputColumn.empty()
+        ? function + (spec.valueColumn.empty() ? "" : "_" + spec.valueColumn)
+        : spec.outputColumn);
+
+    output.Clear();
+    output.SetHeaders(outputHeaders);
+    std::vector<std::string_view> row;
+    for (size_t p = 0; p < partitions.size(); ++p)
+    {
+        for (size_t i = 0; i < partitions[p].size(); ++i)
+        {
+            const CSVRow source = rows[partitions[p][i]];
+            row.assign(source.begin(), source.end());
+            row.resize(headers.size());
+            row.push_back(partitionResults[p][i]);
+            output.AddRow(row);
+        }
+    }
+
+    return true;
+}
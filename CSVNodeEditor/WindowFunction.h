@@ -0,0 +1,23 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <string>
+
+// ウィンドウ関数の設定
+struct WindowSpec
+{
+    std::string partitionColumn;   // 空の場合はテーブル全体を1つのパーティションとして扱う
+    std::string orderColumn;       // 空の場合は入力順を維持
+    bool ascending = true;
+    std::string function = "rolling_mean"; // "row_number", "rank", "running_sum", "rolling_sum", "rolling_mean", "rolling_min", "rolling_max", "lag", "lead"
+    std::string valueColumn;       // row_number / rank 以外で使用
+    size_t windowSize = 3;         // rolling_* のフレーム幅（現在行を含む直前 windowSize 行）
+    size_t offset = 1;             // lag / lead のオフセット
+    std::string outputColumn;      // 空の場合は関数名から生成
+};
+
+// ウィンドウ関数を計算し、結果列を追加したテーブルを output に書き込む
+// パーティション分割と並べ替えは1回だけ行い、各フレームは
+// 累積和（sum / mean）と単調デック（min / max）で O(n) に計算する。
+// パーティションごとの計算は並列に実行される。
+bool ComputeWindow(const CSVData& input, const WindowSpec& spec, CSVData& output);
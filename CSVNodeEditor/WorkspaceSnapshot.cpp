@@ -0,0 +1,519 @@
+﻿#include "WorkspaceSnapshot.h"
+#include "AsyncFileIO.h"
+#include "BinaryIO.h"
+#include "ColumnarCache.h"
+#include "MappedFile.h"
+#include "ZoneMap.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+
+namespace
+{
+    const char snapshotMagic[8] = { 'N', 'S', 'W', 'S', 'P', 'A', 'C', 'E' };
+    const uint32_t snapshotFormatVersion = 1;
+
+    // セル参照の配列の境界（マップした領域をそのまま CellRef の配列として使う）
+    const uint64_t cellSectionAlignment = 4096;
+
+    // セル参照を書き出す単位（行数）
+    const size_t cellBatchRows = 16384;
+
+    // スロット番号の上限（CellRef の位置は 40 ビット、1 スロット 1MiB）
+    const uint64_t maxSlotCount = uint64_t(1) << (CellRef::offsetBits - CellArena::chunkBits);
+
+    struct SnapshotHeader
+    {
+        char magic[8];
+        uint32_t formatVersion;
+        uint32_t reserved;
+    };
+
+    // 末尾の目次の位置（最後に書くため、これが揃っていれば書き出しは完了している）
+    struct SnapshotTrailer
+    {
+        uint64_t directoryOffset;
+        uint64_t directorySize;
+        uint64_t sequence;
+        char magic[8];
+    };
+
+    // 書き出した位置を数えながら順に書く
+    class SectionWriter
+    {
+    public:
+        bool Open(const std::string& path) { return file.Open(path); }
+        bool Close() { return file.Close(); }
+        uint64_t GetOffset() const { return offset; }
+
+        bool Write(const void* data, size_t size)
+        {
+            offset += size;
+            return file.Write(static_cast<const char*>(data), size);
+        }
+
+        bool Align(uint64_t alignment)
+        {
+            static const char zeros[cellSectionAlignment] = {};
+            const size_t padding = static_cast<size_t>((alignment - offset % alignment) % alignment);
+            return padding == 0 || Write(zeros, padding);
+        }
+
+    private:
+        AsyncFileWriter file;
+        uint64_t offset = 0;
+    };
+
+    // 表のデータ部（アリーナのチャンク・セル参照・行ごとのセル数）を書き、目次に配置を記録する
+    bool WriteTable(SectionWriter& out, BinaryWriter& directory, const CSVData& data)
+    {
+        const auto& headers = data.GetHeaders();
+        const CSVRowRange rows = data.GetRows();
+
+        // 行の幅を揃えて書く。幅と異なる行があるときだけ行ごとのセル数も書く
+        size_t width = 0;
+        size_t narrowest = SIZE_MAX;
+        for (const CSVRow& row : rows)
+        {
+            width = std::max(width, row.size());
+            narrowest = std::min(narrowest, row.size());
+        }
+        const bool ragged = rows.size() > 0 && narrowest != width;
+
+        // アリーナのチャンクは位置空間を保ったまま書くため、セル参照は書き換えない
+        const auto chunks = data.GetArena().GetChunks();
+        std::vector<uint64_t> chunkOffsets(chunks.size());
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            if (!out.Align(sizeof(uint64_t)))
+            {
+                return false;
+            }
+            chunkOffsets[i] = out.GetOffset();
+            if (!out.Write(chunks[i].data, chunks[i].size))
+            {
+                return false;
+            }
+        }
+
+        if (!out.Align(cellSectionAlignment))
+        {
+            return false;
+        }
+        const uint64_t cellsOffset = out.GetOffset();
+        std::vector<CellRef> batch;
+        batch.reserve(cellBatchRows * width);
+        for (const CSVRow& row : rows)
+        {
+            batch.insert(batch.end(), row.GetRefs(), row.GetRefs() + row.size());
+            batch.resize(batch.size() + (width - row.size()));
+            if (batch.size() >= cellBatchRows * width)
+            {
+                if (!out.Write(batch.data(), batch.size() * sizeof(CellRef)))
+                {
+                    return false;
+                }
+                batch.clear();
+            }
+        }
+        if (!batch.empty() && !out.Write(batch.data(), batch.size() * sizeof(CellRef)))
+        {
+            return false;
+        }
+
+        uint64_t countsOffset = 0;
+        if (ragged)
+        {
+            if (!out.Align(sizeof(uint64_t)))
+            {
+                return false;
+            }
+            countsOffset = out.GetOffset();
+            std::vector<uint32_t> counts;
+            counts.reserve(cellBatchRows);
+            for (const CSVRow& row : rows)
+            {
+                counts.push_back(static_cast<uint32_t>(row.size()));
+                if (counts.size() == cellBatchRows)
+                {
+                    if (!out.Write(counts.data(), counts.size() * sizeof(uint32_t)))
+                    {
+                        return false;
+                    }
+                    counts.clear();
+                }
+            }
+            if (!counts.empty() && !out.Write(counts.data(), counts.size() * sizeof(uint32_t)))
+            {
+                return false;
+            }
+        }
+
+        directory.Write(static_cast<uint32_t>(headers.size()));
+        for (const auto& header : headers)
+        {
+            directory.WriteString(header);
+        }
+        directory.Write(static_cast<uint64_t>(rows.size()));
+        directory.Write(static_cast<uint32_t>(width));
+        directory.Write(cellsOffset);
+        directory.Write(countsOffset);
+        directory.Write(static_cast<uint32_t>(chunks.size()));
+        for (size_t i = 0; i < chunks.size(); ++i)
+        {
+            directory.Write(static_cast<uint64_t>(chunks[i].slot));
+            directory.Write(chunkOffsets[i]);
+            directory.Write(static_cast<uint64_t>(chunks[i].size));
+        }
+
+        // 列統計とゾーンマップは計算済みのものを書き、復元時に全セルを読み直さずに済むようにする
+        const auto& statistics = data.GetStatistics();
+        directory.Write(static_cast<uint32_t>(statistics.size()));
+        for (const auto& stats : statistics)
+        {
+            WriteColumnStatistics(directory, stats);
+        }
+        auto zoneMap = data.GetZoneMap();
+        directory.Write(static_cast<uint64_t>(zoneMap ? zoneMap->blockRows : 0));
+        if (zoneMap)
+        {
+            directory.Write(static_cast<uint64_t>(zoneMap->rowCount));
+            directory.Write(static_cast<uint32_t>(zoneMap->columns.size()));
+            for (const auto& zones : zoneMap->columns)
+            {
+                WriteColumnZones(directory, &zones);
+            }
+        }
+        return true;
+    }
+
+    bool ReadNodes(BinaryReader& reader, std::vector<WorkspaceNode>& nodes)
+    {
+        uint32_t count = 0;
+        if (!reader.Read(count) || count > reader.GetRemaining() / (sizeof(int32_t) + 2 * sizeof(float) + 2 * sizeof(uint32_t)))
+        {
+            return false;
+        }
+        nodes.resize(count);
+        for (WorkspaceNode& node : nodes)
+        {
+            int32_t id = 0;
+            if (!reader.Read(id) || !reader.ReadString(node.type) || !reader.Read(node.x) || !reader.Read(node.y)
+                || !reader.ReadString(node.settings))
+            {
+                return false;
+            }
+            node.id = id;
+        }
+        return true;
+    }
+
+    // セル参照がすべて登録したチャンクの範囲内を指すこと（壊れたファイルで範囲外を読まないようにする）
+    // chunkData と chunkSizes はスロット番号で引き、チャンクの先頭でないスロットは nullptr とする。
+    bool ValidateCellRefs(const CellRef* refs, uint64_t count, const std::vector<const char*>& chunkData,
+        const std::vector<uint64_t>& chunkSizes)
+    {
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            const uint64_t length = refs[i].bits >> CellRef::offsetBits;
+            if (length == 0)
+            {
+                continue;
+            }
+            const uint64_t offset = refs[i].bits & CellRef::offsetMask;
+            const uint64_t slot = offset >> CellArena::chunkBits;
+            const uint64_t position = offset & (CellArena::chunkSize - 1);
+            if (slot >= chunkData.size() || !chunkData[slot] || position > chunkSizes[slot])
+            {
+                return false;
+            }
+            const uint64_t available = chunkSizes[slot] - position;
+            if (length == CellRef::lengthEscape)
+            {
+                uint64_t actual = 0;
+                if (available < sizeof(actual))
+                {
+                    return false;
+                }
+                std::memcpy(&actual, chunkData[slot] + position, sizeof(actual));
+                if (actual > available - sizeof(actual))
+                {
+                    return false;
+                }
+            }
+            else if (length > available)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // 目次から表を組み立てる（データ部はマップした領域をそのまま使う）
+    bool ReadTable(BinaryReader& reader, const char* base, uint64_t dataEnd, const std::shared_ptr<const void>& owner,
+        CSVData& data)
+    {
+        uint32_t headerCount = 0;
+        if (!reader.Read(headerCount) || headerCount > reader.GetRemaining() / sizeof(uint32_t))
+        {
+            return false;
+        }
+        std::vector<std::string> headers(headerCount);
+        for (auto& header : headers)
+        {
+            if (!reader.ReadString(header))
+            {
+                return false;
+            }
+        }
+
+        uint64_t rowCount = 0, cellsOffset = 0, countsOffset = 0;
+        uint32_t width = 0, chunkCount = 0;
+        if (!reader.Read(rowCount) || !reader.Read(width) || !reader.Read(cellsOffset) || !reader.Read(countsOffset)
+            || !reader.Read(chunkCount) || chunkCount > reader.GetRemaining() / (3 * sizeof(uint64_t)))
+        {
+            return false;
+        }
+
+        // セル参照と行ごとのセル数がデータ部に収まり、境界が揃っていること
+        if (cellsOffset % alignof(CellRef) != 0 || cellsOffset > dataEnd
+            || (width > 0 && rowCount > (dataEnd - cellsOffset) / sizeof(CellRef) / width)
+            || (width == 0 && rowCount > 0))
+        {
+            return false;
+        }
+        if (countsOffset != 0
+            && (countsOffset % alignof(uint32_t) != 0 || countsOffset > dataEnd || rowCount > (dataEnd - countsOffset) / sizeof(uint32_t)))
+        {
+            return false;
+        }
+
+        // チャンクは昇順で重ならないこと
+        CellArena arena;
+        std::vector<const char*> chunkData;
+        std::vector<uint64_t> chunkSizes;
+        uint64_t nextSlot = 0;
+        for (uint32_t i = 0; i < chunkCount; ++i)
+        {
+            uint64_t slot = 0, offset = 0, size = 0;
+            if (!reader.Read(slot) || !reader.Read(offset) || !reader.Read(size))
+            {
+                return false;
+            }
+            const uint64_t slotCount = std::max<uint64_t>(1, (size + CellArena::chunkSize - 1) / CellArena::chunkSize);
+            if (slot < nextSlot || slot + slotCount > maxSlotCount || offset > dataEnd || size > dataEnd - offset)
+            {
+                return false;
+            }
+            arena.AttachChunk(static_cast<size_t>(slot), base + offset, static_cast<size_t>(size), owner);
+            nextSlot = slot + slotCount;
+            chunkData.resize(static_cast<size_t>(nextSlot), nullptr);
+            chunkSizes.resize(static_cast<size_t>(nextSlot), 0);
+            chunkData[static_cast<size_t>(slot)] = base + offset;
+            chunkSizes[static_cast<size_t>(slot)] = size;
+        }
+
+        uint32_t statisticsCount = 0;
+        if (!reader.Read(statisticsCount) || statisticsCount > reader.GetRemaining())
+        {
+            return false;
+        }
+        std::vector<DataStatistics> statistics(statisticsCount);
+        for (auto& stats : statistics)
+        {
+            if (!ReadColumnStatistics(reader, stats))
+            {
+                return false;
+            }
+        }
+
+        uint64_t zoneBlockRows = 0;
+        ZoneMap zoneMap;
+        if (!reader.Read(zoneBlockRows))
+        {
+            return false;
+        }
+        if (zoneBlockRows > 0)
+        {
+            uint64_t zoneRowCount = 0;
+            uint32_t zoneColumnCount = 0;
+            if (!reader.Read(zoneRowCount) || !reader.Read(zoneColumnCount) || zoneRowCount != rowCount
+                || zoneColumnCount > reader.GetRemaining() / sizeof(uint32_t))
+            {
+                return false;
+            }
+            zoneMap.blockRows = static_cast<size_t>(zoneBlockRows);
+            zoneMap.rowCount = static_cast<size_t>(zoneRowCount);
+            zoneMap.columns.resize(zoneColumnCount);
+            for (auto& zones : zoneMap.columns)
+            {
+                if (!ReadColumnZones(reader, zones) || zones.size() != zoneMap.GetBlockCount())
+                {
+                    return false;
+                }
+            }
+        }
+
+        // セル参照と行ごとのセル数は表がそのまま使うため、範囲外を指すものがあれば読み込まない
+        const CellRef* refs = reinterpret_cast<const CellRef*>(base + cellsOffset);
+        if (!ValidateCellRefs(refs, rowCount * width, chunkData, chunkSizes))
+        {
+            return false;
+        }
+        if (countsOffset != 0)
+        {
+            const uint32_t* counts = reinterpret_cast<const uint32_t*>(base + countsOffset);
+            if (std::any_of(counts, counts + rowCount, [width](uint32_t count) { return count > width; }))
+            {
+                return false;
+            }
+        }
+
+        data.SetHeaders(headers);
+        data.AttachCells(std::move(arena), refs,
+            countsOffset != 0 ? reinterpret_cast<const uint32_t*>(base + countsOffset) : nullptr,
+            static_cast<size_t>(rowCount), width, owner);
+        if (statisticsCount == headerCount)
+        {
+            data.SetStatistics(std::move(statistics));
+        }
+        if (zoneBlockRows > 0)
+        {
+            data.SetZoneMap(std::move(zoneMap));
+        }
+        return true;
+    }
+
+    // ヘッダーと末尾の目次を検証する
+    bool ReadTrailer(const MappedFile& file, SnapshotTrailer& trailer)
+    {
+        if (file.GetSize() < sizeof(SnapshotHeader) + sizeof(SnapshotTrailer))
+        {
+            return false;
+        }
+        SnapshotHeader header;
+        std::memcpy(&header, file.GetData(), sizeof(header));
+        std::memcpy(&trailer, file.GetData() + file.GetSize() - sizeof(trailer), sizeof(trailer));
+        const uint64_t dataEnd = file.GetSize() - sizeof(trailer);
+        return std::memcmp(header.magic, snapshotMagic, sizeof(snapshotMagic)) == 0
+            && header.formatVersion == snapshotFormatVersion
+            && std::memcmp(trailer.magic, snapshotMagic, sizeof(snapshotMagic)) == 0
+            && trailer.directoryOffset >= sizeof(SnapshotHeader) && trailer.directoryOffset <= dataEnd
+            && trailer.directorySize == dataEnd - trailer.directoryOffset;
+    }
+}
+
+bool WriteWorkspaceSnapshot(const std::string& path, uint64_t sequence, const std::vector<WorkspaceTab>& tabs)
+{
+    const std::string temporaryPath = path + ".tmp";
+    SectionWriter out;
+    if (!out.Open(temporaryPath))
+    {
+        return false;
+    }
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, snapshotMagic, sizeof(snapshotMagic));
+    header.formatVersion = snapshotFormatVersion;
+    bool succeeded = out.Write(&header, sizeof(header));
+
+    std::string directoryBuffer;
+    BinaryWriter directory(directoryBuffer);
+    directory.Write(static_cast<uint32_t>(tabs.size()));
+    for (const WorkspaceTab& tab : tabs)
+    {
+        if (!succeeded)
+        {
+            break;
+        }
+        directory.WriteString(tab.name);
+        directory.Write(static_cast<uint32_t>(tab.nodes.size()));
+        for (const WorkspaceNode& node : tab.nodes)
+        {
+            directory.Write(static_cast<int32_t>(node.id));
+            directory.WriteString(node.type);
+            directory.Write(node.x);
+            directory.Write(node.y);
+            directory.WriteString(node.settings);
+        }
+        CSVData empty;
+        succeeded = WriteTable(out, directory, tab.data ? *tab.data : empty);
+    }
+
+    if (succeeded)
+    {
+        SnapshotTrailer trailer = {};
+        trailer.directoryOffset = out.GetOffset();
+        trailer.directorySize = directoryBuffer.size();
+        trailer.sequence = sequence;
+        std::memcpy(trailer.magic, snapshotMagic, sizeof(snapshotMagic));
+        succeeded = out.Write(directoryBuffer.data(), directoryBuffer.size()) && out.Write(&trailer, sizeof(trailer));
+    }
+    succeeded = out.Close() && succeeded;
+
+    std::error_code error;
+    if (succeeded)
+    {
+        std::filesystem::rename(temporaryPath, path, error);
+        if (!error)
+        {
+            return true;
+        }
+    }
+    std::filesystem::remove(temporaryPath, error);
+    return false;
+}
+
+WorkspaceLoadResult LoadWorkspaceSnapshot(const std::string& path, RestoredWorkspace& workspace)
+{
+    auto file = std::make_shared<MappedFile>();
+    if (!file->Open(path))
+    {
+        return WorkspaceLoadResult::Missing;
+    }
+
+    SnapshotTrailer trailer;
+    if (!ReadTrailer(*file, trailer))
+    {
+        return WorkspaceLoadResult::Invalid;
+    }
+
+    // 表はマップを所有者として共有し、最後の参照が無くなったときにマップを閉じる
+    std::shared_ptr<const void> owner = file;
+    const char* base = file->GetData();
+    BinaryReader reader(base + trailer.directoryOffset, static_cast<size_t>(trailer.directorySize));
+    uint32_t tabCount = 0;
+    if (!reader.Read(tabCount) || tabCount > reader.GetRemaining())
+    {
+        return WorkspaceLoadResult::Invalid;
+    }
+
+    std::vector<RestoredWorkspaceTab> tabs(tabCount);
+    for (RestoredWorkspaceTab& tab : tabs)
+    {
+        tab.data = std::make_unique<CSVData>();
+        if (!reader.ReadString(tab.name) || !ReadNodes(reader, tab.nodes)
+            || !ReadTable(reader, base, trailer.directoryOffset, owner, *tab.data))
+        {
+            return WorkspaceLoadResult::Invalid;
+        }
+    }
+
+    workspace.sequence = trailer.sequence;
+    workspace.tabs = std::move(tabs);
+    workspace.mapping = owner;
+    return WorkspaceLoadResult::Loaded;
+}
+
+bool PeekWorkspaceSnapshot(const std::string& path, uint64_t& sequence)
+{
+    MappedFile file;
+    SnapshotTrailer trailer;
+    if (!file.Open(path) || !ReadTrailer(file, trailer))
+    {
+        return false;
+    }
+    sequence = trailer.sequence;
+    return true;
+}
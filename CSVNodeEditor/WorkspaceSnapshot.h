@@ -0,0 +1,65 @@
+﻿#pragma once
+
+#include "CSVData.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// ワークスペースに保存するノード（種類・キャンバス上の位置・BaseNode::SaveState で書き出した設定）
+struct WorkspaceNode
+{
+    int id = 0;
+    std::string type;      // ノード名（CreateNodeByName に渡す）
+    float x = 0.0f;
+    float y = 0.0f;
+    std::string settings;
+};
+
+// 書き出すタブ（data は書き出しが終わるまで変更しない）
+struct WorkspaceTab
+{
+    std::string name;
+    std::vector<WorkspaceNode> nodes;
+    const CSVData* data = nullptr;
+};
+
+// 復元したタブ
+struct RestoredWorkspaceTab
+{
+    std::string name;
+    std::vector<WorkspaceNode> nodes;
+    std::unique_ptr<CSVData> data;
+};
+
+// 復元したワークスペース
+struct RestoredWorkspace
+{
+    uint64_t sequence = 0;                  // 書き出すたびに呼び出し側が増やす番号（新しいスナップショットの判定に使う）
+    std::vector<RestoredWorkspaceTab> tabs;
+
+    // スナップショットのマップ（復元した表と履歴がセルを参照する間は有効）
+    // Windows ではマップしている間ファイルを置き換えられないため、書き出し先の選択に使う。
+    std::weak_ptr<const void> mapping;
+};
+
+// スナップショット読み込み結果
+enum class WorkspaceLoadResult
+{
+    Loaded,  // 復元した
+    Missing, // ファイルが存在しない
+    Invalid  // 形式が不正、または書き出しが完了していない
+};
+
+// ワークスペース（タブごとのノードと表）をスナップショットとして書き出す（一時ファイルに書いてから置き換える）
+// 表はセル文字列のアリーナのチャンクとセル参照をメモリ上の配置のまま書き、列統計とゾーンマップも含める。
+bool WriteWorkspaceSnapshot(const std::string& path, uint64_t sequence, const std::vector<WorkspaceTab>& tabs);
+
+// スナップショットをメモリマップして復元する
+// チャンクとセル参照はマップした領域をそのまま表に登録するため、解析も複写も行わず、ページは参照したときに読まれる。
+// セルの内容は検証しない（ファイルの構造と範囲、セル参照がチャンク内を指すことだけを検証する）。
+// 壊れたファイルは Invalid を返し、範囲外を指す参照を表に登録しない。
+WorkspaceLoadResult LoadWorkspaceSnapshot(const std::string& path, RestoredWorkspace& workspace);
+
+// 末尾の目次だけを読み、書き出しが完了したスナップショットならその番号を返す
+bool PeekWorkspaceSnapshot(const std::string& path, uint64_t& sequence);
@@ -0,0 +1,75 @@
+﻿#include "ZoneMap.h"
+#include "CSVData.h"
+#include "NumberParser.h"
+#include "Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string_view>
+
+ZoneMap ComputeZoneMap(const CSVData& data, size_t blockRows)
+{
+    ZoneMap zoneMap;
+    zoneMap.blockRows = std::max<size_t>(1, blockRows);
+    zoneMap.rowCount = data.GetRowCount();
+
+    const size_t columnCount = data.GetColumnCount();
+    const size_t blockCount = zoneMap.GetBlockCount();
+    zoneMap.columns.assign(columnCount, std::vector<ColumnZone>(blockCount));
+
+    const auto rows = data.GetRows();
+    ParallelFor(blockCount, [&](size_t b) {
+        size_t begin = b * zoneMap.blockRows;
+        size_t end = std::min(zoneMap.rowCount, begin + zoneMap.blockRows);
+
+        // 最小・最大のセルは走査中は表のアリーナを指し、最後に複写する
+        std::vector<std::string_view> textMin(columnCount);
+        std::vector<std::string_view> textMax(columnCount);
+        std::vector<double> numericMin(columnCount, std::numeric_limits<double>::infinity());
+        std::vector<double> numericMax(columnCount, -std::numeric_limits<double>::infinity());
+        for (size_t c = 0; c < columnCount; ++c)
+        {
+            zoneMap.columns[c][b].rowCount = static_cast<uint32_t>(end - begin);
+        }
+
+        for (size_t r = begin; r < end; ++r)
+        {
+            const CSVRow row = rows[r];
+            for (size_t c = 0; c < columnCount; ++c)
+            {
+                std::string_view cell = row[c];
+                ColumnZone& zone = zoneMap.columns[c][b];
+                if (cell.empty())
+                {
+                    ++zone.nullCount;
+                    continue;
+                }
+                if (textMin[c].empty() || cell < textMin[c]) textMin[c] = cell;
+                if (textMax[c].empty() || cell > textMax[c]) textMax[c] = cell;
+
+                // 順序付けできない値は数値の範囲に入れない（文字列として比較されるセルと同じ扱い）
+                double value = 0.0;
+                if (ParseDouble(cell, value) && std::isfinite(value))
+                {
+                    ++zone.numericCount;
+                    numericMin[c] = std::min(numericMin[c], value);
+                    numericMax[c] = std::max(numericMax[c], value);
+                }
+            }
+        }
+
+        for (size_t c = 0; c < columnCount; ++c)
+        {
+            ColumnZone& zone = zoneMap.columns[c][b];
+            zone.textMin = std::string(textMin[c]);
+            zone.textMax = std::string(textMax[c]);
+            if (zone.numericCount > 0)
+            {
+                zone.numericMin = numericMin[c];
+                zone.numericMax = numericMax[c];
+            }
+        }
+    });
+
+    return zoneMap;
+}
@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CSVData;
+
+// 行ブロック内の 1 列の要約
+struct ColumnZone
+{
+    uint32_t rowCount = 0;
+    uint32_t nullCount = 0;        // 空セル・欠損セルの数
+    uint32_t numericCount = 0;     // 数値として解釈できる（有限の）セルの数
+    double numericMin = 0.0;       // 数値セルの最小・最大（numericCount が 0 なら未使用）
+    double numericMax = 0.0;
+    std::string textMin;           // 空でないセルを文字列として比較した最小・最大
+    std::string textMax;
+};
+
+// 表を blockRows 行ごとのブロックに分けた、列ごとの要約（ゾーンマップ）
+// 時系列順に並んだ列では値の範囲がブロックごとに狭くなるため、条件に一致し得ないブロックを丸ごと読み飛ばせる。
+struct ZoneMap
+{
+    static constexpr size_t defaultBlockRows = 65536;
+
+    size_t blockRows = defaultBlockRows;
+    size_t rowCount = 0;
+    std::vector<std::vector<ColumnZone>> columns;  // [列][ブロック]
+
+    size_t GetBlockCount() const { return blockRows > 0 ? (rowCount + blockRows - 1) / blockRows : 0; }
+};
+
+// ブロックごとに並列に全列の要約を計算する
+ZoneMap ComputeZoneMap(const CSVData& data, size_t blockRows = ZoneMap::defaultBlockRows);
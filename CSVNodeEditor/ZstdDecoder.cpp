@@ -0,0 +1,1176 @@
+﻿#include "ZstdDecoder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    const uint32_t frameMagic = 0xFD2FB528;
+    const uint32_t skippableMagicMask = 0xFFFFFFF0;
+    const uint32_t skippableMagic = 0x184D2A50;
+    const size_t maxBlockSize = 128 * 1024;
+    const uint64_t maxWindowSize = uint64_t(1) << 31;
+
+    // リテラル長・一致長の符号ごとの基準値と追加ビット数
+    const uint32_t literalLengthBase[36] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        16, 18, 20, 22, 24, 28, 32, 40, 48, 64, 128, 256, 512, 1024, 2048, 4096, 8192, 16384, 32768, 65536 };
+    const uint8_t literalLengthExtra[36] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        1, 1, 1, 1, 2, 2, 3, 3, 4, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+    const uint32_t matchLengthBase[53] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18,
+        19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 37, 39, 41, 43, 47, 51, 59,
+        67, 83, 99, 131, 259, 515, 1027, 2051, 4099, 8195, 16387, 32771, 65539 };
+    const uint8_t matchLengthExtra[53] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 3, 3,
+        4, 4, 5, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 };
+
+    // 既定の分布
+    const int16_t defaultLiteralLengths[36] = { 4, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 1, 1, 1,
+        2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 1, 1, 1, 1, 1, -1, -1, -1, -1 };
+    const int16_t defaultMatchLengths[53] = { 1, 4, 3, 2, 2, 2, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1, -1, -1 };
+    const int16_t defaultOffsets[29] = { 1, 1, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1, 1, 1, 1, 1,
+        1, 1, 1, 1, 1, 1, 1, 1, -1, -1, -1, -1, -1 };
+
+    int HighestBit(uint64_t value)
+    {
+        int bit = -1;
+        while (value != 0)
+        {
+            ++bit;
+            value >>= 1;
+        }
+        return bit;
+    }
+
+    uint32_t LoadLittleEndian(const uint8_t* bytes, size_t count)
+    {
+        uint32_t value = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+        }
+        return value;
+    }
+
+    // 先頭から LSB 順に読むビット入力（FSE テーブル記述用）
+    class ForwardBits
+    {
+    public:
+        ForwardBits(const uint8_t* data, size_t size)
+            : data(data)
+            , size(size)
+            , position(0)
+        {
+        }
+
+        uint32_t Read(int count)
+        {
+            uint32_t value = 0;
+            for (int i = 0; i < count; ++i, ++position)
+            {
+                size_t byte = position / 8;
+                uint32_t bit = byte < size ? (data[byte] >> (position % 8)) & 1 : 0;
+                value |= bit << i;
+            }
+            return value;
+        }
+
+        void Rewind(int count) { position -= static_cast<size_t>(count); }
+        size_t GetConsumedBytes() const { return (position + 7) / 8; }
+        bool IsOverrun() const { return position > size * 8; }
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        size_t position;
+    };
+
+    // 末尾から先頭へ向かって読むビット入力（ハフマン・FSE のビット列用）
+    // 最終バイトの最上位の 1 が開始位置の目印で、先頭を越えた分は 0 として読む。
+    class BackwardBits
+    {
+    public:
+        bool Init(const uint8_t* source, size_t sourceSize)
+        {
+            data = source;
+            size = sourceSize;
+            if (size == 0 || data[size - 1] == 0)
+            {
+                return false;
+            }
+            offset = static_cast<int64_t>(size - 1) * 8 + HighestBit(data[size - 1]);
+            return true;
+        }
+
+        uint64_t Read(int count)
+        {
+            offset -= count;
+            return BitsAt(offset, count);
+        }
+
+        uint64_t Peek(int count) const { return BitsAt(offset - count, count); }
+        void Consume(int count) { offset -= count; }
+        int64_t GetOffset() const { return offset; }
+
+    private:
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        int64_t offset = 0;
+
+        uint64_t BitsAt(int64_t at, int count) const
+        {
+            if (count == 0)
+            {
+                return 0;
+            }
+            if (at < 0)
+            {
+                int shift = static_cast<int>(std::min<int64_t>(-at, 64));
+                return shift >= count ? 0 : BitsAt(0, count - shift) << shift;
+            }
+            size_t byte = static_cast<size_t>(at / 8);
+            uint64_t value = 0;
+            std::memcpy(&value, data + byte, std::min<size_t>(8, size - byte));
+            value >>= at % 8;
+            return count >= 64 ? value : value & ((uint64_t(1) << count) - 1);
+        }
+    };
+
+    uint64_t RotateLeft(uint64_t value, int bits)
+    {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    const uint64_t prime1 = 11400714785074694791ULL;
+    const uint64_t prime2 = 14029467366897019727ULL;
+    const uint64_t prime3 = 1609587929392839161ULL;
+    const uint64_t prime4 = 9650029242287828579ULL;
+    const uint64_t prime5 = 2870177450012600261ULL;
+
+    uint64_t HashRound(uint64_t accumulator, uint64_t input)
+    {
+        accumulator += input * prime2;
+        accumulator = RotateLeft(accumulator, 31);
+        return accumulator * prime1;
+    }
+
+    uint64_t HashMerge(uint64_t accumulator, uint64_t lane)
+    {
+        accumulator ^= HashRound(0, lane);
+        return accumulator * prime1 + prime4;
+    }
+}
+
+// FSE テーブル記述を読み、復号テーブルを構築する
+static bool BuildFseTable(const int16_t* counts, size_t symbolCount, int accuracyLog,
+    std::vector<uint8_t>& symbols, std::vector<uint8_t>& bits, std::vector<uint16_t>& base)
+{
+    const size_t tableSize = size_t(1) << accuracyLog;
+    symbols.assign(tableSize, 0);
+    bits.assign(tableSize, 0);
+    base.assign(tableSize, 0);
+    std::vector<uint16_t> next(symbolCount, 0);
+
+    // 確率 "1 未満" の記号は末尾から 1 セルずつ割り当てる
+    size_t highThreshold = tableSize;
+    for (size_t s = 0; s < symbolCount; ++s)
+    {
+        if (counts[s] == -1)
+        {
+            if (highThreshold == 0)
+            {
+                return false;
+            }
+            symbols[--highThreshold] = static_cast<uint8_t>(s);
+            next[s] = 1;
+        }
+    }
+
+    const size_t step = (tableSize >> 1) + (tableSize >> 3) + 3;
+    const size_t mask = tableSize - 1;
+    size_t position = 0;
+    for (size_t s = 0; s < symbolCount; ++s)
+    {
+        if (counts[s] <= 0)
+        {
+            continue;
+        }
+        next[s] = static_cast<uint16_t>(counts[s]);
+        for (int i = 0; i < counts[s]; ++i)
+        {
+            symbols[position] = static_cast<uint8_t>(s);
+            do
+            {
+                position = (position + step) & mask;
+            } while (position >= highThreshold);
+        }
+    }
+    if (position != 0)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < tableSize; ++i)
+    {
+        uint16_t state = next[symbols[i]]++;
+        bits[i] = static_cast<uint8_t>(accuracyLog - HighestBit(state));
+        base[i] = static_cast<uint16_t>((state << bits[i]) - tableSize);
+    }
+    return true;
+}
+
+static bool ReadFseDescription(const uint8_t* source, size_t sourceSize, int maxAccuracyLog, size_t maxSymbol,
+    std::vector<uint8_t>& symbols, std::vector<uint8_t>& bits, std::vector<uint16_t>& base, int& accuracyLog, size_t& consumed)
+{
+    ForwardBits input(source, sourceSize);
+    accuracyLog = 5 + static_cast<int>(input.Read(4));
+    if (accuracyLog > maxAccuracyLog)
+    {
+        return false;
+    }
+
+    int16_t counts[256] = {};
+    int32_t remaining = 1 << accuracyLog;
+    size_t symbol = 0;
+    while (remaining > 0 && symbol <= maxSymbol)
+    {
+        const int bitCount = HighestBit(static_cast<uint64_t>(remaining) + 1) + 1;
+        uint32_t value = input.Read(bitCount);
+        const uint32_t lowerMask = (uint32_t(1) << (bitCount - 1)) - 1;
+        const uint32_t threshold = (uint32_t(1) << bitCount) - 1 - (static_cast<uint32_t>(remaining) + 1);
+        if ((value & lowerMask) < threshold)
+        {
+            input.Rewind(1);
+            value &= lowerMask;
+        }
+        else if (value > lowerMask)
+        {
+            value -= threshold;
+        }
+
+        const int16_t probability = static_cast<int16_t>(static_cast<int32_t>(value) - 1);
+        remaining -= probability < 0 ? -probability : probability;
+        counts[symbol++] = probability;
+
+        // 確率 0 の後には 2 ビットの繰り返し数が続く
+        if (probability == 0)
+        {
+            uint32_t repeat = input.Read(2);
+            while (true)
+            {
+                for (uint32_t i = 0; i < repeat && symbol <= maxSymbol; ++i)
+                {
+                    counts[symbol++] = 0;
+                }
+                if (repeat != 3 || input.IsOverrun())
+                {
+                    break;
+                }
+                repeat = input.Read(2);
+            }
+        }
+        if (input.IsOverrun())
+        {
+            return false;
+        }
+    }
+    if (remaining != 0)
+    {
+        return false;
+    }
+    consumed = input.GetConsumedBytes();
+    return BuildFseTable(counts, symbol, accuracyLog, symbols, bits, base);
+}
+
+void ZstdDecoder::Checksum::Reset()
+{
+    lanes[0] = prime1 + prime2;
+    lanes[1] = prime2;
+    lanes[2] = 0;
+    lanes[3] = 0 - prime1;
+    pendingSize = 0;
+    totalSize = 0;
+}
+
+void ZstdDecoder::Checksum::Update(const char* input, size_t inputSize)
+{
+    totalSize += inputSize;
+    while (inputSize > 0)
+    {
+        size_t take = std::min(inputSize, sizeof(pending) - pendingSize);
+        std::memcpy(pending + pendingSize, input, take);
+        pendingSize += take;
+        input += take;
+        inputSize -= take;
+        if (pendingSize == sizeof(pending))
+        {
+            for (int lane = 0; lane < 4; ++lane)
+            {
+                uint64_t value;
+                std::memcpy(&value, pending + lane * 8, sizeof(uint64_t));
+                lanes[lane] = HashRound(lanes[lane], value);
+            }
+            pendingSize = 0;
+        }
+    }
+}
+
+uint64_t ZstdDecoder::Checksum::Digest() const
+{
+    uint64_t hash;
+    if (totalSize >= 32)
+    {
+        hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            hash = HashMerge(hash, lanes[lane]);
+        }
+    }
+    else
+    {
+        hash = prime5;
+    }
+    hash += totalSize;
+
+    size_t i = 0;
+    for (; i + 8 <= pendingSize; i += 8)
+    {
+        uint64_t value;
+        std::memcpy(&value, pending + i, sizeof(uint64_t));
+        hash ^= HashRound(0, value);
+        hash = RotateLeft(hash, 27) * prime1 + prime4;
+    }
+    if (i + 4 <= pendingSize)
+    {
+        uint32_t value;
+        std::memcpy(&value, pending + i, sizeof(uint32_t));
+        hash ^= static_cast<uint64_t>(value) * prime1;
+        hash = RotateLeft(hash, 23) * prime2 + prime3;
+        i += 4;
+    }
+    for (; i < pendingSize; ++i)
+    {
+        hash ^= pending[i] * prime5;
+        hash = RotateLeft(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+ZstdDecoder::ZstdDecoder(const char* data, size_t size)
+    : data(reinterpret_cast<const uint8_t*>(data))
+    , size(size)
+    , position(0)
+    , state(State::FrameHeader)
+    , failed(false)
+    , emitted(0)
+    , windowLimit(0)
+    , frameProduced(0)
+    , blockStart(0)
+    , hasChecksum(false)
+    , repeatOffsets{ 1, 4, 8 }
+{
+    checksum.Reset();
+}
+
+bool ZstdDecoder::FindFrames(const char* data, size_t size, std::vector<std::pair<size_t, size_t>>& frames)
+{
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    frames.clear();
+    size_t position = 0;
+    while (position < size)
+    {
+        if (size - position < 8)
+        {
+            return false;
+        }
+        const uint32_t magic = LoadLittleEndian(bytes + position, 4);
+        if ((magic & skippableMagicMask) == skippableMagic)
+        {
+            const uint32_t skipSize = LoadLittleEndian(bytes + position + 4, 4);
+            if (skipSize > size - position - 8)
+            {
+                return false;
+            }
+            position += 8 + skipSize;
+            continue;
+        }
+        if (magic != frameMagic)
+        {
+            return false;
+        }
+
+        const size_t start = position;
+        const uint8_t descriptor = bytes[position + 4];
+        const bool singleSegment = (descriptor >> 5) & 1;
+        const size_t dictionarySizes[4] = { 0, 1, 2, 4 };
+        const size_t contentSizes[4] = { singleSegment ? 1u : 0u, 2, 4, 8 };
+        position += 5 + (singleSegment ? 0 : 1) + dictionarySizes[descriptor & 3] + contentSizes[descriptor >> 6];
+
+        bool lastBlock = false;
+        while (!lastBlock)
+        {
+            if (position > size || size - position < 3)
+            {
+                return false;
+            }
+            const uint32_t header = LoadLittleEndian(bytes + position, 3);
+            lastBlock = header & 1;
+            const uint32_t type = (header >> 1) & 3;
+            const size_t blockSize = type == 1 ? 1 : header >> 3;
+            position += 3 + blockSize;
+        }
+        if ((descriptor >> 2) & 1)
+        {
+            position += 4;
+        }
+        if (position > size)
+        {
+            return false;
+        }
+        frames.emplace_back(start, position - start);
+    }
+    return !frames.empty();
+}
+
+bool ZstdDecoder::Decode(std::string& output, size_t minimumBytes)
+{
+    while (!failed && state != State::Done && window.size() - emitted < minimumBytes)
+    {
+        Step();
+    }
+    if (failed || window.size() == emitted)
+    {
+        return false;
+    }
+
+    output.append(window, emitted, std::string::npos);
+
+    // 以降の一致参照に必要なウィンドウ分だけを残す
+    if (window.size() > windowLimit)
+    {
+        window.erase(0, window.size() - static_cast<size_t>(windowLimit));
+    }
+    emitted = window.size();
+    return true;
+}
+
+void ZstdDecoder::Step()
+{
+    switch (state)
+    {
+    case State::FrameHeader:
+        failed = !ReadFrameHeader();
+        break;
+    case State::Blocks:
+        failed = !ReadBlock();
+        break;
+    case State::Checksum:
+        failed = !ReadChecksum();
+        break;
+    case State::Done:
+        break;
+    }
+}
+
+bool ZstdDecoder::ReadFrameHeader()
+{
+    while (true)
+    {
+        if (position == size)
+        {
+            state = State::Done;
+            return true;
+        }
+        if (size - position < 5)
+        {
+            return false;
+        }
+        const uint32_t magic = LoadLittleEndian(data + position, 4);
+        if ((magic & skippableMagicMask) != skippableMagic)
+        {
+            if (magic != frameMagic)
+            {
+                return false;
+            }
+            break;
+        }
+        if (size - position < 8)
+        {
+            return false;
+        }
+        const uint32_t skipSize = LoadLittleEndian(data + position + 4, 4);
+        if (skipSize > size - position - 8)
+        {
+            return false;
+        }
+        position += 8 + skipSize;
+    }
+
+    const uint8_t descriptor = data[position + 4];
+    position += 5;
+    const bool singleSegment = (descriptor >> 5) & 1;
+    if (descriptor & 0x08)
+    {
+        return false; // 予約ビット
+    }
+    hasChecksum = (descriptor >> 2) & 1;
+
+    if (!singleSegment)
+    {
+        if (position >= size)
+        {
+            return false;
+        }
+        const uint8_t windowDescriptor = data[position++];
+        const int windowLog = 10 + (windowDescriptor >> 3);
+        const uint64_t windowBase = uint64_t(1) << windowLog;
+        windowLimit = windowBase + (windowBase / 8) * (windowDescriptor & 7);
+    }
+
+    const size_t dictionarySizes[4] = { 0, 1, 2, 4 };
+    const size_t dictionarySize = dictionarySizes[descriptor & 3];
+    const size_t contentSizes[4] = { singleSegment ? 1u : 0u, 2, 4, 8 };
+    const size_t contentSize = contentSizes[descriptor >> 6];
+    if (size - position < dictionarySize + contentSize)
+    {
+        return false;
+    }
+    if (LoadLittleEndian(data + position, dictionarySize) != 0)
+    {
+        return false; // 辞書付きフレームは未対応
+    }
+    position += dictionarySize;
+
+    uint64_t frameContentSize = 0;
+    for (size_t i = 0; i < contentSize; ++i)
+    {
+        frameContentSize |= static_cast<uint64_t>(data[position + i]) << (8 * i);
+    }
+    if (contentSize == 2)
+    {
+        frameContentSize += 256;
+    }
+    position += contentSize;
+    if (singleSegment)
+    {
+        windowLimit = frameContentSize;
+    }
+    if (windowLimit > maxWindowSize)
+    {
+        return false;
+    }
+
+    // フレームごとに繰り返しオフセットとエントロピーテーブルを初期化する
+    frameProduced = 0;
+    repeatOffsets[0] = 1;
+    repeatOffsets[1] = 4;
+    repeatOffsets[2] = 8;
+    huffman = HuffmanTable();
+    literalLengthTable = FseTable();
+    offsetTable = FseTable();
+    matchLengthTable = FseTable();
+    checksum.Reset();
+    state = State::Blocks;
+    return true;
+}
+
+bool ZstdDecoder::ReadBlock()
+{
+    if (size - position < 3)
+    {
+        return false;
+    }
+    const uint32_t header = LoadLittleEndian(data + position, 3);
+    position += 3;
+    const bool lastBlock = header & 1;
+    const uint32_t type = (header >> 1) & 3;
+    const size_t blockSize = header >> 3;
+    if (blockSize > maxBlockSize)
+    {
+        return false;
+    }
+
+    const size_t before = window.size();
+    blockStart = before;
+    switch (type)
+    {
+    case 0: // 非圧縮ブロック
+        if (size - position < blockSize)
+        {
+            return false;
+        }
+        window.append(reinterpret_cast<const char*>(data + position), blockSize);
+        position += blockSize;
+        break;
+    case 1: // 1 バイトの繰り返し
+        if (size - position < 1)
+        {
+            return false;
+        }
+        window.append(blockSize, static_cast<char>(data[position]));
+        position += 1;
+        break;
+    case 2:
+        if (size - position < blockSize || !DecodeCompressedBlock(data + position, blockSize))
+        {
+            return false;
+        }
+        position += blockSize;
+        break;
+    default:
+        return false;
+    }
+
+    const size_t produced = window.size() - before;
+    frameProduced += produced;
+    if (hasChecksum)
+    {
+        checksum.Update(window.data() + before, produced);
+    }
+    if (lastBlock)
+    {
+        state = hasChecksum ? State::Checksum : State::FrameHeader;
+    }
+    return true;
+}
+
+bool ZstdDecoder::ReadChecksum()
+{
+    if (size - position < 4)
+    {
+        return false;
+    }
+    const uint32_t expected = LoadLittleEndian(data + position, 4);
+    position += 4;
+    state = State::FrameHeader;
+    return expected == static_cast<uint32_t>(checksum.Digest());
+}
+
+bool ZstdDecoder::DecodeCompressedBlock(const uint8_t* block, size_t blockSize)
+{
+    size_t consumed = 0;
+    if (!DecodeLiterals(block, blockSize, consumed))
+    {
+        return false;
+    }
+    return DecodeSequences(block + consumed, blockSize - consumed);
+}
+
+bool ZstdDecoder::DecodeLiterals(const uint8_t* block, size_t blockSize, size_t& consumed)
+{
+    if (blockSize < 1)
+    {
+        return false;
+    }
+    const uint8_t type = block[0] & 3;
+    const uint8_t sizeFormat = (block[0] >> 2) & 3;
+
+    if (type == 0 || type == 1)
+    {
+        // 非圧縮・繰り返しリテラル
+        size_t headerSize = 1;
+        size_t regeneratedSize = block[0] >> 3;
+        if (sizeFormat == 1)
+        {
+            headerSize = 2;
+        }
+        else if (sizeFormat == 3)
+        {
+            headerSize = 3;
+        }
+        if (blockSize < headerSize)
+        {
+            return false;
+        }
+        if (headerSize > 1)
+        {
+            regeneratedSize = LoadLittleEndian(block, headerSize) >> 4;
+        }
+
+        if (type == 0)
+        {
+            if (blockSize - headerSize < regeneratedSize)
+            {
+                return false;
+            }
+            literals.assign(reinterpret_cast<const char*>(block + headerSize), regeneratedSize);
+            consumed = headerSize + regeneratedSize;
+        }
+        else
+        {
+            if (blockSize - headerSize < 1)
+            {
+                return false;
+            }
+            literals.assign(regeneratedSize, static_cast<char>(block[headerSize]));
+            consumed = headerSize + 1;
+        }
+        return regeneratedSize <= maxBlockSize;
+    }
+
+    // ハフマン符号化リテラル（type 3 は直前のハフマン表を再利用する）
+    size_t headerSize = 3;
+    size_t regeneratedSize = 0;
+    size_t compressedSize = 0;
+    const size_t streamCount = sizeFormat == 0 ? 1 : 4;
+    if (sizeFormat <= 1)
+    {
+        if (blockSize < 3)
+        {
+            return false;
+        }
+        uint32_t value = LoadLittleEndian(block, 3);
+        regeneratedSize = (value >> 4) & 0x3FF;
+        compressedSize = (value >> 14) & 0x3FF;
+    }
+    else if (sizeFormat == 2)
+    {
+        headerSize = 4;
+        if (blockSize < 4)
+        {
+            return false;
+        }
+        uint32_t value = LoadLittleEndian(block, 4);
+        regeneratedSize = (value >> 4) & 0x3FFF;
+        compressedSize = (value >> 18) & 0x3FFF;
+    }
+    else
+    {
+        headerSize = 5;
+        if (blockSize < 5)
+        {
+            return false;
+        }
+        uint64_t value = LoadLittleEndian(block, 4) | (static_cast<uint64_t>(block[4]) << 32);
+        regeneratedSize = static_cast<size_t>((value >> 4) & 0x3FFFF);
+        compressedSize = static_cast<size_t>((value >> 22) & 0x3FFFF);
+    }
+    if (regeneratedSize > maxBlockSize || blockSize - headerSize < compressedSize)
+    {
+        return false;
+    }
+
+    const uint8_t* source = block + headerSize;
+    size_t sourceSize = compressedSize;
+    if (type == 2)
+    {
+        size_t tableSize = 0;
+        if (!ReadHuffmanTable(source, sourceSize, tableSize))
+        {
+            return false;
+        }
+        source += tableSize;
+        sourceSize -= tableSize;
+    }
+    else if (huffman.IsEmpty())
+    {
+        return false;
+    }
+
+    // 各ストリームの範囲（4 ストリームの場合は先頭 6 バイトがジャンプテーブル）
+    const uint8_t* streams[4] = { source };
+    size_t streamSizes[4] = { sourceSize };
+    size_t regenerated[4] = { regeneratedSize };
+    if (streamCount == 4)
+    {
+        if (sourceSize < 6)
+        {
+            return false;
+        }
+        size_t total = 6;
+        for (int i = 0; i < 3; ++i)
+        {
+            streamSizes[i] = LoadLittleEndian(source + i * 2, 2);
+            total += streamSizes[i];
+        }
+        if (total > sourceSize)
+        {
+            return false;
+        }
+        streamSizes[3] = sourceSize - total;
+        streams[0] = source + 6;
+        for (int i = 1; i < 4; ++i)
+        {
+            streams[i] = streams[i - 1] + streamSizes[i - 1];
+        }
+        const size_t perStream = (regeneratedSize + 3) / 4;
+        if (perStream * 3 > regeneratedSize)
+        {
+            return false;
+        }
+        for (int i = 0; i < 3; ++i)
+        {
+            regenerated[i] = perStream;
+        }
+        regenerated[3] = regeneratedSize - perStream * 3;
+    }
+
+    literals.resize(regeneratedSize);
+    size_t outputPosition = 0;
+    for (size_t s = 0; s < streamCount; ++s)
+    {
+        BackwardBits bits;
+        if (!bits.Init(streams[s], streamSizes[s]))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < regenerated[s]; ++i)
+        {
+            const size_t index = static_cast<size_t>(bits.Peek(huffman.maxBits));
+            literals[outputPosition++] = static_cast<char>(huffman.symbols[index]);
+            bits.Consume(huffman.bits[index]);
+        }
+        if (bits.GetOffset() != 0)
+        {
+            return false;
+        }
+    }
+    consumed = headerSize + compressedSize;
+    return true;
+}
+
+bool ZstdDecoder::ReadHuffmanTable(const uint8_t* source, size_t sourceSize, size_t& consumed)
+{
+    if (sourceSize < 1)
+    {
+        return false;
+    }
+    uint8_t weights[256] = {};
+    size_t weightCount = 0;
+    const uint8_t header = source[0];
+
+    if (header < 128)
+    {
+        // 重みは 2 状態を交互に使う FSE で符号化されている
+        const size_t compressedSize = header;
+        if (sourceSize - 1 < compressedSize)
+        {
+            return false;
+        }
+        FseTable table;
+        size_t descriptionSize = 0;
+        if (!ReadFseDescription(source + 1, compressedSize, 6, 255, table.symbols, table.bits, table.base,
+            table.accuracyLog, descriptionSize) || descriptionSize > compressedSize)
+        {
+            return false;
+        }
+
+        BackwardBits bits;
+        if (!bits.Init(source + 1 + descriptionSize, compressedSize - descriptionSize))
+        {
+            return false;
+        }
+        size_t states[2];
+        states[0] = static_cast<size_t>(bits.Read(table.accuracyLog));
+        states[1] = static_cast<size_t>(bits.Read(table.accuracyLog));
+        for (int current = 0;; current ^= 1)
+        {
+            if (weightCount >= 255)
+            {
+                return false;
+            }
+            size_t& stateValue = states[current];
+            weights[weightCount++] = table.symbols[stateValue];
+            stateValue = table.base[stateValue] + static_cast<size_t>(bits.Read(table.bits[stateValue]));
+            if (bits.GetOffset() < 0)
+            {
+                // ビット列を読み切ったら、もう一方の状態の記号で終える
+                if (weightCount >= 255)
+                {
+                    return false;
+                }
+                weights[weightCount++] = table.symbols[states[current ^ 1]];
+                break;
+            }
+        }
+        consumed = 1 + compressedSize;
+    }
+    else
+    {
+        // 4 ビットずつ直接格納された重み
+        weightCount = header - 127;
+        const size_t byteCount = (weightCount + 1) / 2;
+        if (sourceSize - 1 < byteCount)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < weightCount; ++i)
+        {
+            const uint8_t packed = source[1 + i / 2];
+            weights[i] = (i % 2 == 0) ? packed >> 4 : packed & 0xF;
+        }
+        consumed = 1 + byteCount;
+    }
+
+    // 最後の記号の重みは合計が 2 のべき乗になるよう暗黙に決まる
+    uint64_t weightSum = 0;
+    for (size_t i = 0; i < weightCount; ++i)
+    {
+        if (weights[i] > 11)
+        {
+            return false;
+        }
+        if (weights[i] > 0)
+        {
+            weightSum += uint64_t(1) << (weights[i] - 1);
+        }
+    }
+    if (weightSum == 0)
+    {
+        return false;
+    }
+    const int maxBits = HighestBit(weightSum) + 1;
+    const uint64_t remainder = (uint64_t(1) << maxBits) - weightSum;
+    if (maxBits > 11 || (remainder & (remainder - 1)) != 0)
+    {
+        return false;
+    }
+    weights[weightCount++] = static_cast<uint8_t>(HighestBit(remainder) + 1);
+
+    // 重みの小さい（符号の長い）記号から順にテーブルへ並べる
+    const size_t tableSize = size_t(1) << maxBits;
+    huffman.maxBits = maxBits;
+    huffman.symbols.assign(tableSize, 0);
+    huffman.bits.assign(tableSize, 0);
+    size_t rankStart[13] = {};
+    size_t rankCount[13] = {};
+    for (size_t i = 0; i < weightCount; ++i)
+    {
+        ++rankCount[weights[i]];
+    }
+    size_t next = 0;
+    for (int weight = 1; weight <= maxBits; ++weight)
+    {
+        rankStart[weight] = next;
+        next += rankCount[weight] << (weight - 1);
+    }
+    if (next != tableSize)
+    {
+        return false;
+    }
+    for (size_t symbol = 0; symbol < weightCount; ++symbol)
+    {
+        const int weight = weights[symbol];
+        if (weight == 0)
+        {
+            continue;
+        }
+        const size_t length = size_t(1) << (weight - 1);
+        std::fill_n(huffman.symbols.begin() + rankStart[weight], length, static_cast<uint8_t>(symbol));
+        std::fill_n(huffman.bits.begin() + rankStart[weight], length, static_cast<uint8_t>(maxBits + 1 - weight));
+        rankStart[weight] += length;
+    }
+    return true;
+}
+
+bool ZstdDecoder::DecodeSequences(const uint8_t* source, size_t sourceSize)
+{
+    if (sourceSize < 1)
+    {
+        return false;
+    }
+    size_t sequenceCount = source[0];
+    size_t headerSize = 1;
+    if (sequenceCount >= 128)
+    {
+        if (sequenceCount < 255)
+        {
+            if (sourceSize < 2)
+            {
+                return false;
+            }
+            sequenceCount = ((sequenceCount - 128) << 8) + source[1];
+            headerSize = 2;
+        }
+        else
+        {
+            if (sourceSize < 3)
+            {
+                return false;
+            }
+            sequenceCount = source[1] + (static_cast<size_t>(source[2]) << 8) + 0x7F00;
+            headerSize = 3;
+        }
+    }
+
+    if (sequenceCount == 0)
+    {
+        // シーケンスの無いブロックはリテラルのみ
+        window.append(literals);
+        return true;
+    }
+
+    if (sourceSize - headerSize < 1)
+    {
+        return false;
+    }
+    const uint8_t modes = source[headerSize];
+    if (modes & 3)
+    {
+        return false;
+    }
+    size_t position = headerSize + 1;
+
+    struct TableSpec
+    {
+        FseTable* table;
+        int mode;
+        const int16_t* defaults;
+        size_t defaultCount;
+        int defaultLog;
+        int maxLog;
+        size_t maxSymbol;
+    };
+    TableSpec specs[3] = {
+        { &literalLengthTable, (modes >> 6) & 3, defaultLiteralLengths, 36, 6, 9, 35 },
+        { &offsetTable, (modes >> 4) & 3, defaultOffsets, 29, 5, 8, 31 },
+        { &matchLengthTable, (modes >> 2) & 3, defaultMatchLengths, 53, 6, 9, 52 },
+    };
+    for (auto& spec : specs)
+    {
+        FseTable& table = *spec.table;
+        switch (spec.mode)
+        {
+        case 0: // 既定の分布
+            table.accuracyLog = spec.defaultLog;
+            if (!BuildFseTable(spec.defaults, spec.defaultCount, spec.defaultLog, table.symbols, table.bits, table.base))
+            {
+                return false;
+            }
+            break;
+        case 1: // 単一記号の繰り返し
+            if (position >= sourceSize || source[position] > spec.maxSymbol)
+            {
+                return false;
+            }
+            table.accuracyLog = 0;
+            table.symbols.assign(1, source[position]);
+            table.bits.assign(1, 0);
+            table.base.assign(1, 0);
+            ++position;
+            break;
+        case 2: // FSE テーブル記述
+        {
+            size_t descriptionSize = 0;
+            if (position >= sourceSize || !ReadFseDescription(source + position, sourceSize - position, spec.maxLog,
+                spec.maxSymbol, table.symbols, table.bits, table.base, table.accuracyLog, descriptionSize)
+                || descriptionSize > sourceSize - position)
+            {
+                return false;
+            }
+            position += descriptionSize;
+            break;
+        }
+        default: // 直前のテーブルを再利用
+            if (table.IsEmpty())
+            {
+                return false;
+            }
+            break;
+        }
+    }
+
+    BackwardBits bits;
+    if (!bits.Init(source + position, sourceSize - position))
+    {
+        return false;
+    }
+    size_t literalLengthState = static_cast<size_t>(bits.Read(literalLengthTable.accuracyLog));
+    size_t offsetState = static_cast<size_t>(bits.Read(offsetTable.accuracyLog));
+    size_t matchLengthState = static_cast<size_t>(bits.Read(matchLengthTable.accuracyLog));
+
+    size_t literalPosition = 0;
+    for (size_t sequence = 0; sequence < sequenceCount; ++sequence)
+    {
+        const uint8_t offsetCode = offsetTable.symbols[offsetState];
+        const uint8_t literalLengthCode = literalLengthTable.symbols[literalLengthState];
+        const uint8_t matchLengthCode = matchLengthTable.symbols[matchLengthState];
+        if (offsetCode > 31 || literalLengthCode > 35 || matchLengthCode > 52)
+        {
+            return false;
+        }
+
+        // 追加ビットはオフセット、一致長、リテラル長の順に並ぶ
+        const uint64_t offsetValue = (uint64_t(1) << offsetCode) + bits.Read(offsetCode);
+        const size_t matchLength = matchLengthBase[matchLengthCode] + static_cast<size_t>(bits.Read(matchLengthExtra[matchLengthCode]));
+        const size_t literalLength = literalLengthBase[literalLengthCode] + static_cast<size_t>(bits.Read(literalLengthExtra[literalLengthCode]));
+
+        uint64_t offset = 0;
+        if (offsetValue > 3)
+        {
+            offset = offsetValue - 3;
+            repeatOffsets[2] = repeatOffsets[1];
+            repeatOffsets[1] = repeatOffsets[0];
+            repeatOffsets[0] = offset;
+        }
+        else
+        {
+            // 繰り返しオフセット（リテラル長 0 のときは 1 つずれる）
+            size_t index = static_cast<size_t>(offsetValue - 1) + (literalLength == 0 ? 1 : 0);
+            if (index == 0)
+            {
+                offset = repeatOffsets[0];
+            }
+            else
+            {
+                offset = index < 3 ? repeatOffsets[index] : repeatOffsets[0] - 1;
+                if (index > 1)
+                {
+                    repeatOffsets[2] = repeatOffsets[1];
+                }
+                repeatOffsets[1] = repeatOffsets[0];
+                repeatOffsets[0] = offset;
+            }
+        }
+
+        if (sequence + 1 < sequenceCount)
+        {
+            literalLengthState = literalLengthTable.base[literalLengthState] + static_cast<size_t>(bits.Read(literalLengthTable.bits[literalLengthState]));
+            matchLengthState = matchLengthTable.base[matchLengthState] + static_cast<size_t>(bits.Read(matchLengthTable.bits[matchLengthState]));
+            offsetState = offsetTable.base[offsetState] + static_cast<size_t>(bits.Read(offsetTable.bits[offsetState]));
+        }
+
+        // リテラルを複写してから一致を複写する
+        if (literalLength > literals.size() - literalPosition)
+        {
+            return false;
+        }
+        window.append(literals, literalPosition, literalLength);
+        literalPosition += literalLength;
+
+        // 参照できるのは現在のフレームの出力のうちウィンドウに残っている範囲
+        const uint64_t available = std::min<uint64_t>(frameProduced + (window.size() - blockStart), window.size());
+        if (offset == 0 || offset > available || bits.GetOffset() < 0)
+        {
+            return false;
+        }
+        const size_t start = window.size();
+        window.resize(start + matchLength);
+        char* destination = &window[start];
+        const char* from = destination - offset;
+        if (offset >= matchLength)
+        {
+            std::memcpy(destination, from, matchLength);
+        }
+        else
+        {
+            for (size_t i = 0; i < matchLength; ++i)
+            {
+                destination[i] = from[i];
+            }
+        }
+    }
+    if (bits.GetOffset() != 0)
+    {
+        return false;
+    }
+
+    window.append(literals, literalPosition, std::string::npos);
+    return true;
+}
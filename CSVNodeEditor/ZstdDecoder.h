@@ -0,0 +1,97 @@
+﻿#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Zstandard 形式の伸長器（RFC 8878）
+// 入力全体を受け取り、伸長結果を呼び出しごとに少しずつ取り出す。複数フレームの連結と
+// スキップ可能フレームに対応し、フレームにチェックサムがあれば検証する。辞書付きフレームは未対応。
+class ZstdDecoder
+{
+public:
+    ZstdDecoder(const char* data, size_t size);
+
+    // 伸長結果を output に追記する（minimumBytes 以上たまるか入力の終端で戻る）
+    // 何も追記できなかった場合は false を返す。終端と失敗は HasError で区別する。
+    bool Decode(std::string& output, size_t minimumBytes);
+    bool HasError() const { return failed; }
+
+    // ブロックヘッダーだけをたどってフレームの範囲を列挙する（スキップ可能フレームは除く）
+    static bool FindFrames(const char* data, size_t size, std::vector<std::pair<size_t, size_t>>& frames);
+
+private:
+    enum class State
+    {
+        FrameHeader,
+        Blocks,
+        Checksum,
+        Done
+    };
+
+    // FSE 復号テーブル
+    struct FseTable
+    {
+        std::vector<uint8_t> symbols;
+        std::vector<uint8_t> bits;
+        std::vector<uint16_t> base;
+        int accuracyLog = 0;
+
+        bool IsEmpty() const { return symbols.empty(); }
+    };
+
+    // ハフマン復号テーブル（最大符号長ビットを先読みして引く）
+    struct HuffmanTable
+    {
+        std::vector<uint8_t> symbols;
+        std::vector<uint8_t> bits;
+        int maxBits = 0;
+
+        bool IsEmpty() const { return symbols.empty(); }
+    };
+
+    // フレームのチェックサム（XXH64 の下位 32 ビット）を逐次計算する
+    struct Checksum
+    {
+        uint64_t lanes[4];
+        uint8_t pending[32];
+        size_t pendingSize;
+        uint64_t totalSize;
+
+        void Reset();
+        void Update(const char* data, size_t size);
+        uint64_t Digest() const;
+    };
+
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+    State state;
+    bool failed;
+    std::string window;
+    size_t emitted;
+
+    // フレームごとの状態
+    uint64_t windowLimit;
+    uint64_t frameProduced;
+    size_t blockStart;
+    bool hasChecksum;
+    Checksum checksum;
+    uint64_t repeatOffsets[3];
+    HuffmanTable huffman;
+    FseTable literalLengthTable;
+    FseTable offsetTable;
+    FseTable matchLengthTable;
+    std::string literals;
+
+    void Step();
+    bool ReadFrameHeader();
+    bool ReadBlock();
+    bool ReadChecksum();
+    bool DecodeCompressedBlock(const uint8_t* block, size_t blockSize);
+    bool DecodeLiterals(const uint8_t* block, size_t blockSize, size_t& consumed);
+    bool ReadHuffmanTable(const uint8_t* source, size_t sourceSize, size_t& consumed);
+    bool DecodeSequences(const uint8_t* source, size_t sourceSize);
+};
@@ -0,0 +1,182 @@
+#include "test_csv_common.h"
+#include "ArrowIpc.h"
+#include "FlatBuffer.h"
+#include <cstring>
+#include <memory>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== FlatBuffer ====================
+
+struct TestBlock {
+    int64_t offset;
+    int64_t length;
+};
+
+// 書き込みヘルパーで組み立てたテーブル・文字列・ベクターを読み取り側で同じ値として読めること
+TEST(FlatBufferTest, BuilderOutputReadsBack) {
+    FlatBufferBuilder builder;
+
+    std::vector<FlatBufferBuilder::Offset> children;
+    for (int i = 0; i < 3; ++i) {
+        const FlatBufferBuilder::Offset name = builder.CreateString("child" + std::to_string(i));
+        builder.StartTable();
+        builder.AddOffsetField(0, name);
+        builder.AddField<int32_t>(1, i * 10);
+        children.push_back(builder.EndTable());
+    }
+    const FlatBufferBuilder::Offset childVector = builder.CreateOffsetVector(children);
+    const FlatBufferBuilder::Offset blocks = builder.CreateStructVector(std::vector<TestBlock>{ { 8, 100 }, { 112, 64 } });
+    const FlatBufferBuilder::Offset title = builder.CreateString("日本語の名前");
+
+    builder.StartTable();
+    builder.AddField<int16_t>(0, 4);
+    builder.AddOffsetField(1, title);
+    builder.AddOffsetField(2, childVector);
+    builder.AddField<int64_t>(4, int64_t(1) << 40);
+    builder.AddOffsetField(5, blocks);
+    const std::string buffer = builder.Finish(builder.EndTable());
+
+    const FlatBufferTable root = FlatBufferTable::Root(buffer.data(), buffer.size());
+    ASSERT_TRUE(root.IsValid());
+    EXPECT_EQ(4, root.GetField<int16_t>(0, 0));
+    EXPECT_EQ(int64_t(1) << 40, root.GetField<int64_t>(4, 0));
+    EXPECT_EQ(-1, root.GetField<int32_t>(3, -1)) << "absent fields fall back to the default";
+
+    std::string text;
+    ASSERT_TRUE(root.GetString(1, text));
+    EXPECT_EQ("日本語の名前", text);
+
+    size_t count = 0;
+    size_t elements = 0;
+    ASSERT_TRUE(root.GetVector(2, sizeof(uint32_t), count, elements));
+    ASSERT_EQ(3u, count);
+    for (size_t i = 0; i < count; ++i) {
+        const FlatBufferTable child = root.GetVectorTable(elements, i);
+        ASSERT_TRUE(child.IsValid());
+        ASSERT_TRUE(child.GetString(0, text));
+        EXPECT_EQ("child" + std::to_string(i), text);
+        EXPECT_EQ(static_cast<int32_t>(i * 10), child.GetField<int32_t>(1, -1));
+    }
+
+    ASSERT_TRUE(root.GetVector(5, sizeof(TestBlock), count, elements));
+    ASSERT_EQ(2u, count);
+    int64_t value = 0;
+    ASSERT_TRUE(root.ReadAt(elements + sizeof(TestBlock) + sizeof(int64_t), value));
+    EXPECT_EQ(64, value);
+}
+
+// 途中で切れたバッファでは範囲外を読まず、読めた値は元の値と一致すること
+// （末尾の詰め物だけが切れた場合は読めてよい。切り出した長さちょうどの領域で読むため、範囲外の読み出しは ASan が検出する）
+TEST(FlatBufferTest, TruncatedBufferIsRejected) {
+    const std::string value = "a fairly long string value";
+    FlatBufferBuilder builder;
+    const FlatBufferBuilder::Offset name = builder.CreateString(value);
+    builder.StartTable();
+    builder.AddOffsetField(0, name);
+    const std::string buffer = builder.Finish(builder.EndTable());
+
+    size_t readable = 0;
+    for (size_t size = 0; size < buffer.size(); ++size) {
+        const std::unique_ptr<char[]> truncated(new char[size]);
+        std::memcpy(truncated.get(), buffer.data(), size);
+        const FlatBufferTable root = FlatBufferTable::Root(truncated.get(), size);
+        std::string text;
+        if (root.IsValid() && root.GetString(0, text)) {
+            EXPECT_EQ(value, text) << size;
+            ++readable;
+        }
+    }
+    EXPECT_LT(readable, sizeof(uint32_t)) << "only the trailing terminator and padding may be cut";
+}
+
+// ==================== Arrow IPC ====================
+
+class ArrowIpcTest : public CsvEngineTestBase {
+protected:
+    static void FillMixedTable(CSVData& data, size_t rowCount) {
+        data.SetHeaders({ "id", "price", "name", "flag" });
+        for (size_t r = 0; r < rowCount; ++r) {
+            data.AddRow(std::vector<std::string>{
+                r % 10 == 3 ? std::string() : std::to_string(static_cast<int64_t>(r) * 1000003 - 5000000),
+                r % 7 == 1 ? std::string() : std::to_string(r) + ".125",
+                r % 5 == 0 ? std::string() : "名前" + std::to_string(r % 40),
+                r % 2 == 0 ? "yes" : "no" });
+        }
+    }
+};
+
+// ファイル形式とストリーム形式のどちらでも、型付きの列と欠損を保ったまま往復すること
+TEST_F(ArrowIpcTest, RoundTripFileAndStream) {
+    CSVData data;
+    FillMixedTable(data, 5000);
+    ArrowTable table;
+    BuildArrowTable(data, table, 1024);
+    ASSERT_EQ(4u, table.schema.size());
+    EXPECT_EQ(ArrowType::Int64, table.schema[0].type);
+    EXPECT_EQ(ArrowType::Float64, table.schema[1].type);
+    EXPECT_EQ(ArrowType::Utf8, table.schema[2].type);
+    EXPECT_EQ(5u, table.batches.size());
+
+    for (const char* name : { "table.arrow", "table.arrows" }) {
+        const std::string path = TempPath(name);
+        ASSERT_TRUE(std::string(name).back() == 's' ? WriteArrowIpcStream(path, table) : WriteArrowIpcFile(path, table));
+
+        ArrowTable loaded;
+        ASSERT_TRUE(ReadArrowIpc(path, loaded)) << name;
+        ASSERT_EQ(table.schema.size(), loaded.schema.size());
+        for (size_t c = 0; c < table.schema.size(); ++c) {
+            EXPECT_EQ(table.schema[c].name, loaded.schema[c].name);
+            EXPECT_EQ(table.schema[c].type, loaded.schema[c].type);
+        }
+        EXPECT_EQ(table.GetRowCount(), loaded.GetRowCount());
+
+        CSVData restored;
+        ArrowTableToCSVData(loaded, restored);
+        EXPECT_EQ(data.GetHeaders(), restored.GetHeaders());
+        EXPECT_EQ(ToRows(data), ToRows(restored)) << name;
+    }
+}
+
+// 空の表も往復すること
+TEST_F(ArrowIpcTest, RoundTripEmptyTable) {
+    CSVData data;
+    data.SetHeaders({ "a", "b" });
+    ArrowTable table;
+    BuildArrowTable(data, table);
+
+    const std::string path = TempPath("empty.arrow");
+    ASSERT_TRUE(WriteArrowIpcFile(path, table));
+    ArrowTable loaded;
+    ASSERT_TRUE(ReadArrowIpc(path, loaded));
+    EXPECT_EQ(2u, loaded.schema.size());
+    EXPECT_EQ(0, loaded.GetRowCount());
+}
+
+// 途中で切れたファイルや Arrow 以外のファイルは読み込まないこと
+TEST_F(ArrowIpcTest, RejectsTruncatedFiles) {
+    CSVData data;
+    FillMixedTable(data, 500);
+    ArrowTable table;
+    BuildArrowTable(data, table);
+
+    const std::string path = TempPath("truncated.arrow");
+    ASSERT_TRUE(WriteArrowIpcFile(path, table));
+    std::ifstream file(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+
+    for (size_t keep : { size_t(0), size_t(6), size_t(64), bytes.size() / 2, bytes.size() - 1 }) {
+        WriteTextFile(path, bytes.substr(0, keep));
+        ArrowTable loaded;
+        EXPECT_FALSE(ReadArrowIpc(path, loaded)) << keep;
+    }
+
+    WriteTextFile(path, "id,name\n1,a\n");
+    ArrowTable loaded;
+    EXPECT_FALSE(ReadArrowIpc(path, loaded));
+}
+
+} // namespace Testing
+} // namespace NSys
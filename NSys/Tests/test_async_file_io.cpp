@@ -0,0 +1,168 @@
+#include "test_csv_common.h"
+#include "AsyncFileIO.h"
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== AsyncFileIO ====================
+
+class AsyncFileIOTest : public CsvEngineTestBase {
+protected:
+    static std::string RandomBytes(size_t size, uint32_t seed) {
+        std::mt19937 random(seed);
+        std::string bytes(size, '\0');
+        for (auto& byte : bytes) {
+            byte = static_cast<char>(random() & 0xFF);
+        }
+        return bytes;
+    }
+
+    static bool WriteAsync(const std::string& path, const std::string& bytes, const AsyncIoOptions& options,
+        size_t pieceSize) {
+        AsyncFileWriter writer;
+        if (!writer.Open(path, options)) {
+            return false;
+        }
+        for (size_t offset = 0; offset < bytes.size(); offset += pieceSize) {
+            if (!writer.Write(bytes.data() + offset, std::min(pieceSize, bytes.size() - offset))) {
+                return false;
+            }
+        }
+        return writer.Close();
+    }
+
+    static std::string ReadAsync(const std::string& path, const AsyncIoOptions& options) {
+        AsyncFileReader reader;
+        EXPECT_TRUE(reader.Open(path, options));
+        std::string bytes;
+        const char* data = nullptr;
+        size_t size = 0;
+        while (reader.ReadBlock(data, size)) {
+            bytes.append(data, size);
+        }
+        EXPECT_FALSE(reader.HasError());
+        return bytes;
+    }
+
+    // CSV らしい行を size バイト程度書く
+    void WriteCsvFile(const std::string& path, size_t size) const {
+        std::string line;
+        std::string content;
+        content.reserve(size + 128);
+        for (size_t r = 0; content.size() < size; ++r) {
+            line = std::to_string(r) + ",name" + std::to_string(r % 1000) + "," + std::to_string(r * 0.25) + ",2024-01-01\n";
+            content += line;
+        }
+        WriteTextFile(path, content);
+    }
+
+    static size_t CountLines(const char* data, size_t size) {
+        size_t lines = 0;
+        for (const char* end = data + size; (data = static_cast<const char*>(std::memchr(data, '\n', end - data))) != nullptr; ++data) {
+            ++lines;
+        }
+        return lines;
+    }
+};
+
+// 両方のバックエンドで、ブロックの大きさや書き込みの区切りによらずバイト列をそのまま読み書きすること
+TEST_F(AsyncFileIOTest, RoundTripOnBothBackends) {
+    const std::string bytes = RandomBytes(3 * 1024 * 1024 + 12345, 1);
+    const std::string path = TempPath("roundtrip.bin");
+
+    for (bool useIoUring : { true, false }) {
+        for (size_t blockSize : { size_t(4096), size_t(65536), size_t(1) << 20 }) {
+            for (size_t queueDepth : { size_t(1), size_t(4) }) {
+                AsyncIoOptions options;
+                options.blockSize = blockSize;
+                options.queueDepth = queueDepth;
+                options.useIoUring = useIoUring;
+                ASSERT_TRUE(WriteAsync(path, bytes, options, 7777));
+                EXPECT_EQ(bytes.size(), std::filesystem::file_size(path));
+                EXPECT_TRUE(bytes == ReadAsync(path, options))
+                    << "io_uring=" << useIoUring << " block=" << blockSize << " depth=" << queueDepth;
+            }
+        }
+    }
+}
+
+// 空のファイルを書き出し、読み込みはブロックを返さずに終わること
+TEST_F(AsyncFileIOTest, EmptyFile) {
+    const std::string path = TempPath("empty.bin");
+    ASSERT_TRUE(WriteAsync(path, std::string(), AsyncIoOptions(), 1));
+    EXPECT_EQ(0u, std::filesystem::file_size(path));
+    EXPECT_TRUE(ReadAsync(path, AsyncIoOptions()).empty());
+
+    AsyncFileReader reader;
+    EXPECT_FALSE(reader.Open(TempPath("missing.bin")));
+}
+
+// 先読みしながら行を数える経路は、ifstream で同じ大きさのブロックを読む経路より大きく遅くならないこと（既定では実行しない）
+// （ページキャッシュに載った状態の比較。NVMe のコールドキャッシュでは先読みの差がさらに大きくなる）
+TEST_F(AsyncFileIOTest, DISABLED_Timing_ReadAheadVsIfstream) {
+    const std::string path = TempPath("timing.csv");
+    WriteCsvFile(path, 64 * 1024 * 1024);
+    const size_t blockSize = 256 * 1024;
+
+    size_t ifstreamLines = 0;
+    const double ifstreamTime = MeasureMilliseconds([&]() {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<char> buffer(blockSize);
+        while (file) {
+            file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+            ifstreamLines += CountLines(buffer.data(), static_cast<size_t>(file.gcount()));
+        }
+    });
+
+    size_t asyncLines = 0;
+    AsyncIoBackend backend = AsyncIoBackend::ThreadPool;
+    const double asyncTime = MeasureMilliseconds([&]() {
+        AsyncIoOptions options;
+        options.blockSize = blockSize;
+        options.queueDepth = 8;
+        AsyncFileReader reader;
+        ASSERT_TRUE(reader.Open(path, options));
+        backend = reader.GetBackend();
+        const char* data = nullptr;
+        size_t size = 0;
+        while (reader.ReadBlock(data, size)) {
+            asyncLines += CountLines(data, size);
+        }
+    });
+
+    EXPECT_EQ(ifstreamLines, asyncLines);
+    std::printf("[ timing   ] 読み込み 64MiB: ifstream %.1f ms, AsyncFileReader(%s) %.1f ms\n", ifstreamTime,
+        backend == AsyncIoBackend::IoUring ? "io_uring" : "thread pool", asyncTime);
+    EXPECT_LT(asyncTime, ifstreamTime * 1.5) << "read-ahead should not be slower than the ifstream path";
+}
+
+// 書き出しを重ねる経路は、ofstream で同じ内容を書く経路より大きく遅くならないこと（既定では実行しない）
+TEST_F(AsyncFileIOTest, DISABLED_Timing_WriteBehindVsOfstream) {
+    const std::string bytes = RandomBytes(64 * 1024 * 1024, 3);
+    const size_t pieceSize = 4096;
+
+    const std::string ofstreamPath = TempPath("ofstream.bin");
+    const double ofstreamTime = MeasureMilliseconds([&]() {
+        std::ofstream file(ofstreamPath, std::ios::binary);
+        for (size_t offset = 0; offset < bytes.size(); offset += pieceSize) {
+            file.write(bytes.data() + offset, static_cast<std::streamsize>(std::min(pieceSize, bytes.size() - offset)));
+        }
+    });
+
+    const std::string asyncPath = TempPath("async.bin");
+    bool written = false;
+    const double asyncTime = MeasureMilliseconds([&]() {
+        written = WriteAsync(asyncPath, bytes, AsyncIoOptions(), pieceSize);
+    });
+
+    ASSERT_TRUE(written);
+    EXPECT_EQ(std::filesystem::file_size(ofstreamPath), std::filesystem::file_size(asyncPath));
+    std::printf("[ timing   ] 書き出し 64MiB: ofstream %.1f ms, AsyncFileWriter %.1f ms\n", ofstreamTime, asyncTime);
+    EXPECT_LT(asyncTime, ofstreamTime * 1.5) << "write-behind should not be slower than the ofstream path";
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,78 @@
+#include "test_csv_common.h"
+#include "ColumnIndex.h"
+#include "Predicate.h"
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== ColumnIndex ====================
+
+class ColumnIndexTest : public ::testing::Test {
+protected:
+    // 全行に Matches を適用した結果（索引・ゾーンマップを使わない基準）
+    static std::vector<uint32_t> ScanRows(const CSVData& data, const CompiledPredicate& predicate) {
+        std::vector<uint32_t> rows;
+        for (size_t r = 0; r < data.GetRowCount(); ++r) {
+            if (predicate.Matches(data.GetCell(r, static_cast<size_t>(predicate.columnIndex)))) {
+                rows.push_back(static_cast<uint32_t>(r));
+            }
+        }
+        return rows;
+    }
+
+    // ハッシュ索引・整列済み索引を使った SelectRows が全行の走査と一致することを確かめる
+    static void ExpectIndexMatchesScan(const std::vector<std::string>& cells, const std::vector<std::string>& values) {
+        CSVData plain;
+        CSVData hashed;
+        CSVData sorted;
+        for (CSVData* data : { &plain, &hashed, &sorted }) {
+            data->SetHeaders({ "v" });
+            for (const auto& cell : cells) {
+                data->AddRow(std::vector<std::string>{ cell });
+            }
+        }
+        hashed.BuildHashIndex(0);
+        sorted.BuildSortedIndex(0);
+
+        const char* const ops[] = { "==", "!=", ">", "<", ">=", "<=" };
+        for (const auto& value : values) {
+            for (const char* op : ops) {
+                CompiledPredicate predicate;
+                ASSERT_TRUE(CompilePredicate(ScanPredicate{ "v", op, value }, plain.GetHeaders(), predicate));
+                const std::vector<uint32_t> expected = ScanRows(plain, predicate);
+
+                SelectStats stats;
+                EXPECT_EQ(expected, SelectRows(sorted, predicate, &stats)) << "sorted: v " << op << " " << value;
+                EXPECT_TRUE(stats.usedIndex);
+                if (std::string(op) == "==" || std::string(op) == "!=") {
+                    EXPECT_EQ(expected, SelectRows(hashed, predicate, &stats)) << "hash: v " << op << " " << value;
+                    EXPECT_TRUE(stats.usedIndex);
+                }
+            }
+        }
+    }
+};
+
+TEST_F(ColumnIndexTest, NonFiniteCellsAgreeWithScan) {
+    ExpectIndexMatchesScan({ "5", "nan", "1", "3", "nan", "7", "2" }, { "3", "nan", "0" });
+    ExpectIndexMatchesScan({ "inf", "-inf", "1e308", "-1e308", "infinity", "NaN", "" }, { "0", "inf", "1e308" });
+}
+
+TEST_F(ColumnIndexTest, RandomMixedColumnAgreesWithScan) {
+    std::mt19937 random(3);
+    const char* const specials[] = { "", "nan", "inf", "-0", "0", "1.0", "1", "abc", "ABC", "10", "9" };
+    std::vector<std::string> cells;
+    for (int i = 0; i < 5000; ++i) {
+        switch (random() % 4) {
+        case 0: cells.push_back(std::to_string(static_cast<int>(random() % 200) - 100)); break;
+        case 1: cells.push_back(std::to_string(random() % 100) + "." + std::to_string(random() % 10)); break;
+        case 2: cells.push_back(std::string(1, static_cast<char>('a' + random() % 26)) + std::to_string(random() % 10)); break;
+        default: cells.push_back(specials[random() % (sizeof(specials) / sizeof(specials[0]))]); break;
+        }
+    }
+    ExpectIndexMatchesScan(cells, { "0", "-0", "1", "50.5", "-101", "abc", "m", "", "nan", "inf" });
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,85 @@
+#include "test_csv_common.h"
+#include "ColumnarCache.h"
+
+namespace NSys {
+namespace Testing {
+
+// ==================== ColumnarCache ====================
+
+class ColumnarCacheTest : public CsvEngineTestBase {
+protected:
+    // CSV を書いて読み込み、キャッシュを書き出してから復元した表と元の表を返す
+    void LoadThroughCache(const std::string& name, const std::string& csv, CSVData& parsed, CSVData& cached) {
+        const std::string path = TempPath(name);
+        WriteTextFile(path, csv);
+        ASSERT_TRUE(parsed.LoadFromFile(path));
+
+        SourceFingerprint fingerprint;
+        ASSERT_TRUE(ComputeSourceFingerprint(path, fingerprint));
+        ASSERT_TRUE(WriteColumnarCache(path, fingerprint, parsed));
+        ASSERT_EQ(CacheLoadResult::Loaded, LoadColumnarCache(path, fingerprint, cached));
+    }
+};
+
+// 整数・実数・辞書・文字列の各セグメントと空セルを、解析した表と同じ内容に復元すること
+TEST_F(ColumnarCacheTest, RoundTripAllSegmentTypes) {
+    std::string csv = "int,real,category,text\n";
+    for (int r = 0; r < 5000; ++r) {
+        csv += (r % 11 == 0 ? std::string() : std::to_string(r * 37 - 90000)) + ",";
+        csv += (r % 13 == 0 ? std::string() : std::to_string(r) + ".25") + ",";
+        csv += std::string(r % 3 == 0 ? "東京" : r % 3 == 1 ? "大阪" : "") + ",";
+        csv += "row " + std::to_string(r) + (r % 5 == 0 ? " \"quoted\"" : "") + "\n";
+    }
+
+    CSVData parsed;
+    CSVData cached;
+    LoadThroughCache("types.csv", csv, parsed, cached);
+    EXPECT_EQ(parsed.GetHeaders(), cached.GetHeaders());
+    EXPECT_EQ(ToRows(parsed), ToRows(cached));
+    EXPECT_EQ(parsed.GetStatistics().size(), cached.GetStatistics().size());
+}
+
+// 行ごとのセル数が揃っていない表も、行ごとのセル数を保ったまま復元すること
+TEST_F(ColumnarCacheTest, RoundTripKeepsRaggedRows) {
+    const std::string csv = "a,b,c\n1,2,3\n4\n5,6,7,8,9\n\"x\",,\n10,11\n";
+
+    CSVData parsed;
+    CSVData cached;
+    LoadThroughCache("ragged.csv", csv, parsed, cached);
+    EXPECT_EQ(parsed.GetHeaders(), cached.GetHeaders());
+    EXPECT_EQ(ToRows(parsed), ToRows(cached));
+    ASSERT_EQ(5u, cached.GetRowCount());
+    EXPECT_EQ(1u, cached.GetRows()[1].size());
+    EXPECT_EQ(5u, cached.GetRows()[2].size());
+}
+
+// 元ファイルが変われば Stale、キャッシュが無ければ Missing、壊れていれば Invalid を返すこと
+TEST_F(ColumnarCacheTest, DetectsStaleMissingAndCorruptCaches) {
+    const std::string path = TempPath("state.csv");
+    WriteTextFile(path, "v\n1\n2\n3\n");
+    SourceFingerprint fingerprint;
+    ASSERT_TRUE(ComputeSourceFingerprint(path, fingerprint));
+
+    CSVData data;
+    EXPECT_EQ(CacheLoadResult::Missing, LoadColumnarCache(path, fingerprint, data));
+
+    ASSERT_TRUE(data.LoadFromFile(path));
+    ASSERT_TRUE(WriteColumnarCache(path, fingerprint, data));
+
+    SourceFingerprint changed = fingerprint;
+    changed.contentHash ^= 1;
+    CSVData restored;
+    EXPECT_EQ(CacheLoadResult::Stale, LoadColumnarCache(path, changed, restored));
+
+    const std::string cachePath = GetColumnarCachePath(path);
+    std::ifstream file(cachePath, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    for (size_t keep : { size_t(4), size_t(40), bytes.size() - 3 }) {
+        WriteTextFile(cachePath, bytes.substr(0, keep));
+        EXPECT_EQ(CacheLoadResult::Invalid, LoadColumnarCache(path, fingerprint, restored)) << keep;
+    }
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,152 @@
+#include "test_csv_common.h"
+#include "ColumnarFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== ColumnarFile (.nscol) ====================
+
+class ColumnarFileTest : public CsvEngineTestBase {
+protected:
+    // 各符号化（FOR・ランレングス・実数・辞書・辞書ランレングス・文字列）が選ばれる列と欠損を含む表
+    static void FillMixedTable(CSVData& data, size_t rowCount) {
+        data.SetHeaders({ "id", "constant", "group", "real", "step", "category", "sorted", "text", "extreme" });
+        const char* const categories[] = { "東京", "大阪", "名古屋", "福岡" };
+        for (size_t r = 0; r < rowCount; ++r) {
+            std::string extreme;
+            switch (r % 4) {
+            case 0: extreme = std::to_string(std::numeric_limits<int64_t>::min()); break;
+            case 1: extreme = std::to_string(std::numeric_limits<int64_t>::max()); break;
+            case 2: extreme = "-1"; break;
+            default: break;
+            }
+            data.AddRow(std::vector<std::string>{
+                std::to_string(r),
+                "7",
+                std::to_string(r / 700),
+                r % 17 == 0 ? std::string() : std::to_string(r) + ".5",
+                std::to_string(r / 500) + ".25",
+                r % 9 == 0 ? std::string() : categories[(r * 7) % 4],
+                std::string("k") + std::to_string(r / 300),
+                "text-" + std::to_string(r * 31),
+                extreme });
+        }
+    }
+
+    static std::vector<std::vector<std::string>> ScanRows(const CSVData& data, const std::vector<ScanPredicate>& predicates) {
+        std::vector<CompiledPredicate> compiled(predicates.size());
+        std::vector<size_t> columns(predicates.size());
+        for (size_t i = 0; i < predicates.size(); ++i) {
+            EXPECT_TRUE(CompilePredicate(predicates[i], data.GetHeaders(), compiled[i]));
+            columns[i] = static_cast<size_t>(std::find(data.GetHeaders().begin(), data.GetHeaders().end(),
+                predicates[i].column) - data.GetHeaders().begin());
+        }
+        std::vector<std::vector<std::string>> rows;
+        for (const auto& row : ToRows(data)) {
+            bool matches = true;
+            for (size_t i = 0; i < predicates.size() && matches; ++i) {
+                matches = compiled[i].Matches(row[columns[i]]);
+            }
+            if (matches) {
+                rows.push_back(row);
+            }
+        }
+        return rows;
+    }
+};
+
+// 条件なしで読み込むと、書き出した表と同じ内容に戻ること
+TEST_F(ColumnarFileTest, RoundTripAllEncodings) {
+    CSVData data;
+    FillMixedTable(data, 10000);
+    const std::string path = TempPath("mixed.nscol");
+    ColumnarWriteOptions options;
+    options.rowGroupSize = 1000;
+    ASSERT_TRUE(WriteColumnarFile(path, data, options));
+
+    CSVData restored;
+    ColumnarScanStats stats;
+    ASSERT_TRUE(ReadColumnarFile(path, {}, restored, &stats));
+    EXPECT_EQ(10u, stats.rowGroupCount);
+    EXPECT_EQ(0u, stats.skippedRowGroups);
+    EXPECT_EQ(data.GetHeaders(), restored.GetHeaders());
+    EXPECT_EQ(ToRows(data), ToRows(restored));
+}
+
+// 空の表と端数の行グループも往復すること
+TEST_F(ColumnarFileTest, RoundTripEmptyAndPartialGroups) {
+    CSVData empty;
+    empty.SetHeaders({ "a", "b" });
+    const std::string emptyPath = TempPath("empty.nscol");
+    ASSERT_TRUE(WriteColumnarFile(emptyPath, empty));
+    CSVData restored;
+    ASSERT_TRUE(ReadColumnarFile(emptyPath, {}, restored));
+    EXPECT_EQ(empty.GetHeaders(), restored.GetHeaders());
+    EXPECT_EQ(0u, restored.GetRowCount());
+
+    CSVData data;
+    FillMixedTable(data, 2345);
+    const std::string path = TempPath("partial.nscol");
+    ColumnarWriteOptions options;
+    options.rowGroupSize = 1000;
+    ASSERT_TRUE(WriteColumnarFile(path, data, options));
+    ASSERT_TRUE(ReadColumnarFile(path, {}, restored));
+    EXPECT_EQ(ToRows(data), ToRows(restored));
+}
+
+// 統計で一致し得ない行グループを読み飛ばし、結果は全行に条件を適用した結果と一致すること
+TEST_F(ColumnarFileTest, PredicatesSkipRowGroupsAndMatchScan) {
+    CSVData data;
+    FillMixedTable(data, 10000);
+    const std::string path = TempPath("filtered.nscol");
+    ColumnarWriteOptions options;
+    options.rowGroupSize = 1000;
+    ASSERT_TRUE(WriteColumnarFile(path, data, options));
+
+    const std::vector<std::vector<ScanPredicate>> cases = {
+        { { "id", ">=", "8500" } },
+        { { "id", "<", "1200" }, { "category", "==", "大阪" } },
+        { { "sorted", "==", "k5" } },
+        { { "real", "<=", "2000" }, { "group", "!=", "1" } },
+        { { "text", "contains", "-99" } },
+        { { "id", ">", "100000" } },
+    };
+    for (const auto& predicates : cases) {
+        CSVData filtered;
+        ColumnarScanStats stats;
+        ASSERT_TRUE(ReadColumnarFile(path, predicates, filtered, &stats));
+        EXPECT_EQ(ScanRows(data, predicates), ToRows(filtered)) << predicates[0].column << " " << predicates[0].op;
+    }
+
+    CSVData filtered;
+    ColumnarScanStats stats;
+    ASSERT_TRUE(ReadColumnarFile(path, { { "id", ">=", "8500" } }, filtered, &stats));
+    EXPECT_EQ(8u, stats.skippedRowGroups);
+}
+
+// 途中で切れたファイルや形式の異なるファイルは読み込まないこと
+TEST_F(ColumnarFileTest, RejectsTruncatedFiles) {
+    CSVData data;
+    FillMixedTable(data, 3000);
+    const std::string path = TempPath("truncated.nscol");
+    ASSERT_TRUE(WriteColumnarFile(path, data));
+
+    std::ifstream file(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.close();
+    for (size_t keep : { size_t(0), size_t(8), bytes.size() / 2, bytes.size() - 1 }) {
+        WriteTextFile(path, bytes.substr(0, keep));
+        CSVData restored;
+        EXPECT_FALSE(ReadColumnarFile(path, {}, restored)) << keep;
+    }
+
+    WriteTextFile(path, "id,name\n1,a\n");
+    CSVData restored;
+    EXPECT_FALSE(ReadColumnarFile(path, {}, restored));
+}
+
+} // namespace Testing
+} // namespace NSys
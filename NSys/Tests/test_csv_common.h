@@ -0,0 +1,80 @@
+#pragma once
+
+#include <gtest/gtest.h>
+#include "CSVData.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// CSVNodeEditor のデータ処理エンジンのテスト
+// テストのビルドでは CSVNodeEditor/ をインクルードパスに加え、GUI に依存しない .cpp（NodeTypes / NodeEditor /
+// CSVNodeEditor / DataPreview / dllmain 以外）をリンクする。
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Helpers ====================
+
+// 見出しと行から表を作る
+inline void FillTable(CSVData& data, const std::vector<std::string>& headers,
+    const std::vector<std::vector<std::string>>& rows) {
+    data.SetHeaders(headers);
+    for (const auto& row : rows) {
+        data.AddRow(row);
+    }
+}
+
+// 表の全セルを行ごとに取り出す（行ごとのセル数もそのまま比べられるようにする）
+inline std::vector<std::vector<std::string>> ToRows(const CSVData& data) {
+    std::vector<std::vector<std::string>> rows;
+    for (const CSVRow& row : data.GetRows()) {
+        std::vector<std::string> cells;
+        for (size_t c = 0; c < row.size(); ++c) {
+            cells.emplace_back(row[c]);
+        }
+        rows.push_back(std::move(cells));
+    }
+    return rows;
+}
+
+// 処理にかかった時間（ミリ秒）
+// 時間を比べるテストは負荷の高い環境で結果が揺れるため、名前を DISABLED_Timing_ で始めて既定では実行しない
+// （--gtest_also_run_disabled_tests --gtest_filter=*Timing* で実行する）。
+template <typename Func>
+double MeasureMilliseconds(Func&& func) {
+    const auto start = std::chrono::steady_clock::now();
+    func();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// ==================== Test Fixtures ====================
+
+// 一時ファイルを test_data/csv_engine に作り、テストごとに片付ける
+class CsvEngineTestBase : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testDir = std::filesystem::current_path() / "test_data" / "csv_engine";
+        std::filesystem::create_directories(testDir);
+    }
+
+    void TearDown() override {
+        std::error_code error;
+        std::filesystem::remove_all(testDir, error);
+    }
+
+    std::string TempPath(const std::string& name) const {
+        return (testDir / name).string();
+    }
+
+    void WriteTextFile(const std::string& path, const std::string& content) const {
+        std::ofstream file(path, std::ios::binary);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    std::filesystem::path testDir;
+};
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,122 @@
+#include "test_csv_common.h"
+#include "CSVWriter.h"
+#include "Sampling.h"
+#include <algorithm>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== CSV Quoting ====================
+
+class CsvQuotingTest : public CsvEngineTestBase {
+protected:
+    // 区切り文字・二重引用符・改行・前後の空白・CP932 にない文字を含む値
+    static std::vector<std::vector<std::string>> TrickyRows() {
+        return {
+            { "1", "plain", "a,b", "say \"hi\"" },
+            { "2", "line1\nline2", "\"", "" },
+            { "3", " padded ", "crlf\r\ninside", ",,," },
+            { "4", "\"\"", "末尾の改行\n", "\t" },
+            { "5", "", "x", "東京, 大阪" },
+        };
+    }
+
+    // 行末の空のセルは読み込み時に列として数えないため、セルの値だけを比べる
+    static void ExpectSameCells(const CSVData& expected, const CSVData& actual) {
+        ASSERT_EQ(expected.GetRowCount(), actual.GetRowCount());
+        for (size_t r = 0; r < expected.GetRowCount(); ++r) {
+            for (size_t c = 0; c < expected.GetColumnCount(); ++c) {
+                EXPECT_EQ(expected.GetCell(r, c), actual.GetCell(r, c)) << "row " << r << " column " << c;
+            }
+        }
+    }
+};
+
+// 分割は囲みを外して "" を戻し、囲まれていないフィールドは従来どおり前後の空白を除くこと
+TEST_F(CsvQuotingTest, SplitUnquotesFields) {
+    std::vector<std::string_view> fields;
+    std::string unescaped;
+    CSVData::SplitCSVLine(" a , \"b,c\" ,\"d \"\"e\"\"\", \" f \",\"\",g\"h", fields, unescaped);
+    EXPECT_EQ((std::vector<std::string_view>{ "a", "b,c", "d \"e\"", " f ", "", "g\"h" }), fields);
+
+    // 閉じていない囲みは行末まで、閉じた後ろの文字は値に続ける
+    CSVData::SplitCSVLine("\"open,end", fields, unescaped);
+    EXPECT_EQ((std::vector<std::string_view>{ "open,end" }), fields);
+    CSVData::SplitCSVLine("\"ab\"cd,e", fields, unescaped);
+    EXPECT_EQ((std::vector<std::string_view>{ "abcd", "e" }), fields);
+
+    // 引用符を含まない行は従来どおり（行末の ',' の後ろは列として数えない）
+    CSVData::SplitCSVLine("1, 2 ,,3,", fields, unescaped);
+    EXPECT_EQ((std::vector<std::string_view>{ "1", "2", "", "3" }), fields);
+
+    EXPECT_EQ("x,y", CSVData::ParseCSVField("1,\"x,y\",z", 1));
+    EXPECT_EQ("z", CSVData::ParseCSVField("1,\"x,y\",z", 2));
+    EXPECT_EQ("", CSVData::ParseCSVField("1,\"x,y\",z", 5));
+    EXPECT_EQ("b", CSVData::ParseCSVField("a, b ,c", 1));
+}
+
+// SaveToFile で書き出した表を LoadFromFile で読み込むと、同じセルに戻ること（LF / CRLF の両方）
+TEST_F(CsvQuotingTest, SaveLoadRoundTrip) {
+    CSVData data;
+    FillTable(data, { "id", "a,b", "quote\"d", "last" }, TrickyRows());
+
+    const std::string path = TempPath("tricky.csv");
+    ASSERT_TRUE(data.SaveToFile(path));
+    CSVData loaded;
+    ASSERT_TRUE(loaded.LoadFromFile(path));
+    EXPECT_EQ(data.GetHeaders(), loaded.GetHeaders());
+    ExpectSameCells(data, loaded);
+
+    CSVWriteOptions options;
+    options.crlfLineEnding = false;
+    ASSERT_TRUE(WriteCSVFile(path, data.GetHeaders(), data.GetRows(), options));
+    ASSERT_TRUE(loaded.LoadFromFile(path));
+    ExpectSameCells(data, loaded);
+}
+
+// 読み込みのブロックをまたぐ長い複数行の値と多数の行も往復すること
+TEST_F(CsvQuotingTest, RoundTripAcrossReadBlocks) {
+    CSVData data;
+    data.SetHeaders({ "id", "text" });
+    std::string big;
+    for (int i = 0; i < 30000; ++i) {
+        big += "line " + std::to_string(i) + ", \"quoted\"\n";
+    }
+    for (int r = 0; r < 20000; ++r) {
+        data.AddRow(std::vector<std::string>{ std::to_string(r), r == 7777 ? big : r % 3 == 0 ? "a\n\"b\",c" : "v" + std::to_string(r) });
+    }
+
+    const std::string path = TempPath("blocks.csv");
+    ASSERT_TRUE(data.SaveToFile(path));
+    CSVData loaded;
+    ASSERT_TRUE(loaded.LoadFromFile(path));
+    ExpectSameCells(data, loaded);
+}
+
+// 標本抽出の読み込みも囲まれた改行で行を分けず、層の列の値は囲みを外して比べること
+TEST_F(CsvQuotingTest, SampledLoadHonoursQuotes) {
+    CSVData data;
+    data.SetHeaders({ "id", "group", "note" });
+    for (int r = 0; r < 300; ++r) {
+        data.AddRow(std::vector<std::string>{ std::to_string(r), r % 3 == 0 ? "x,y" : "z", "multi\nline " + std::to_string(r) });
+    }
+    const std::string path = TempPath("sampled.csv");
+    ASSERT_TRUE(data.SaveToFile(path));
+
+    SampleSpec spec;
+    spec.sampleSize = 1000;
+    spec.stratifyColumn = "group";
+    CSVData sampled;
+    ASSERT_TRUE(LoadSampledFile(path, spec, sampled));
+    ASSERT_EQ(300u, sampled.GetRowCount());
+    size_t groupXY = 0;
+    for (size_t r = 0; r < sampled.GetRowCount(); ++r) {
+        const int id = std::stoi(std::string(sampled.GetCell(r, 0)));
+        EXPECT_EQ("multi\nline " + std::to_string(id), sampled.GetCell(r, 2));
+        groupXY += sampled.GetCell(r, 1) == "x,y" ? 1 : 0;
+    }
+    EXPECT_EQ(100u, groupXY);
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,381 @@
+#include "test_csv_common.h"
+#include "CompressedInput.h"
+#include "GzipDecoder.h"
+#include "ZstdDecoder.h"
+#include <algorithm>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Fixtures ====================
+
+// FixtureText() を gzip -9 / zstd -19 --check で圧縮したもの（動的ハフマン・FSE・チェックサムの経路を通る）
+static const unsigned char gzipFixture[] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x5d, 0x96, 0xb1, 0xad, 0x24, 0x47,
+    0x0c, 0x44, 0x7d, 0xc5, 0x32, 0x10, 0x9a, 0xdd, 0x64, 0x93, 0x1d, 0x8e, 0x0c, 0x99, 0xa7, 0x8c,
+    0x94, 0xc1, 0x39, 0xe7, 0x5e, 0x3c, 0x07, 0xc5, 0xa1, 0x8f, 0xf9, 0x55, 0x7d, 0xc5, 0x6f, 0x2d,
+    0x50, 0xc0, 0x2b, 0xec, 0x16, 0x66, 0x39, 0x6f, 0x3c, 0xff, 0xfc, 0xf5, 0xed, 0xef, 0xf1, 0x8c,
+    0x3f, 0xe3, 0xf9, 0xef, 0xdf, 0x1f, 0xbf, 0x7e, 0x7e, 0xff, 0xc3, 0xde, 0xc8, 0x9e, 0x95, 0xbf,
+    0xb3, 0xf9, 0x66, 0xf3, 0x49, 0xff, 0x9d, 0xad, 0x37, 0x5b, 0x8f, 0x09, 0xeb, 0x6f, 0xe6, 0x8f,
+    0x0b, 0x1b, 0x6f, 0x16, 0x4f, 0x09, 0xbb, 0xdf, 0x6c, 0x3f, 0x53, 0xd8, 0x7c, 0xb3, 0x7c, 0x42,
+    0xd8, 0x7a, 0xb3, 0x7a, 0x8e, 0xb0, 0xe7, 0xcd, 0xce, 0xb3, 0xf4, 0x3b, 0x8f, 0xcf, 0x2f, 0x3d,
+    0x9e, 0x2d, 0xb4, 0xe1, 0xa7, 0x7c, 0xfc, 0x16, 0x09, 0x3f, 0x7f, 0xcb, 0xc7, 0x87, 0x6b, 0xc1,
+    0xc2, 0x10, 0xa9, 0xbc, 0x63, 0x0a, 0x53, 0x3e, 0xb0, 0x45, 0x28, 0xbe, 0x31, 0x46, 0x29, 0x9e,
+    0x58, 0x63, 0x2a, 0x5e, 0x98, 0x63, 0x2b, 0x7e, 0xb0, 0xc7, 0xd1, 0xcd, 0x07, 0x06, 0x59, 0x82,
+    0x4f, 0xc3, 0x22, 0x29, 0xf8, 0x9c, 0x98, 0x64, 0x4b, 0xb6, 0xb8, 0x88, 0x2b, 0xee, 0x5c, 0xa4,
+    0x94, 0x0f, 0x4e, 0x62, 0xda, 0xb0, 0x31, 0x49, 0x68, 0x41, 0x62, 0x92, 0xa3, 0x7c, 0x61, 0x92,
+    0xa9, 0xf8, 0xc1, 0x24, 0x5b, 0xf0, 0x35, 0x30, 0x89, 0x0d, 0xe1, 0x97, 0x61, 0x93, 0x25, 0xfc,
+    0x9a, 0xd8, 0x24, 0x95, 0x5f, 0xd8, 0xe4, 0x48, 0xe6, 0x98, 0xc4, 0x95, 0x0e, 0x4c, 0x52, 0x4a,
+    0x6f, 0x6e, 0x62, 0xca, 0x27, 0x37, 0x09, 0x2d, 0x28, 0x6e, 0x72, 0xb4, 0xe1, 0x60, 0x93, 0x29,
+    0x05, 0x8e, 0x87, 0xef, 0xd9, 0xc2, 0xbb, 0x71, 0x13, 0xc9, 0x26, 0x26, 0x59, 0x4a, 0x2f, 0x4c,
+    0x92, 0x4a, 0x3b, 0x16, 0x31, 0xc5, 0x03, 0x8b, 0xb8, 0xe2, 0x1b, 0x8b, 0x94, 0xe2, 0x89, 0x49,
+    0xa6, 0xe2, 0x85, 0x49, 0x42, 0xf1, 0xc3, 0x49, 0x8e, 0xf0, 0x31, 0xee, 0x1f, 0x47, 0x0a, 0xc2,
+    0x38, 0xc9, 0x96, 0x86, 0x98, 0x7c, 0x4c, 0x24, 0xc3, 0xc3, 0xf7, 0xb8, 0xe2, 0xce, 0x23, 0xa2,
+    0x74, 0xf0, 0x8a, 0x28, 0xbe, 0x31, 0x49, 0x28, 0x9e, 0xbc, 0x23, 0x8a, 0x17, 0x0f, 0x89, 0xe2,
+    0x07, 0x93, 0x6c, 0xc1, 0xf7, 0xe0, 0x29, 0x11, 0x7c, 0x1b, 0x6f, 0x89, 0xe0, 0x7b, 0x72, 0x92,
+    0x54, 0x7e, 0xdd, 0x7f, 0x8e, 0x84, 0x7e, 0x6f, 0x89, 0x16, 0x04, 0x16, 0x29, 0xe5, 0x37, 0x6f,
+    0x89, 0xf2, 0xc9, 0x5b, 0xa2, 0x78, 0x61, 0x92, 0xa3, 0xf8, 0xe1, 0x2d, 0x11, 0x3c, 0x07, 0x6f,
+    0x89, 0xe0, 0x69, 0x98, 0xc4, 0x24, 0x9b, 0x3c, 0x25, 0x4a, 0x2f, 0x9e, 0x12, 0xa5, 0x1d, 0x8b,
+    0x98, 0xe2, 0x71, 0x6f, 0x89, 0xf2, 0xfb, 0x2e, 0xa2, 0x05, 0xc9, 0x49, 0xa6, 0x36, 0x14, 0x1f,
+    0x12, 0x2d, 0x38, 0xbc, 0x25, 0xc2, 0xd7, 0xc0, 0x24, 0x4b, 0xf0, 0x32, 0xde, 0x12, 0xc1, 0x6b,
+    0xf2, 0x65, 0x23, 0xd9, 0xc2, 0x22, 0xae, 0xb4, 0xf3, 0x92, 0x28, 0x1d, 0x98, 0xc4, 0x14, 0xdf,
+    0x98, 0x24, 0x14, 0x4f, 0x9e, 0x12, 0xc5, 0x8b, 0x93, 0x4c, 0xe5, 0x0f, 0x27, 0xd9, 0x52, 0x70,
+    0xc6, 0x3d, 0x25, 0xd2, 0x70, 0x0c, 0x93, 0x2c, 0x7d, 0xb7, 0xe1, 0xd9, 0x7b, 0x52, 0xf9, 0xc5,
+    0x3f, 0x8e, 0x64, 0x8e, 0x45, 0x5c, 0xe9, 0xc0, 0x22, 0xa5, 0xf4, 0xe6, 0x29, 0x51, 0x3c, 0x31,
+    0x49, 0x28, 0x5e, 0x3c, 0xae, 0x8a, 0x1f, 0x9e, 0x12, 0x7d, 0xb3, 0x8d, 0xc1, 0x37, 0x8e, 0x6b,
+    0x6a, 0x1c, 0xa5, 0xbd, 0x9a, 0xe7, 0x3d, 0x26, 0xad, 0x62, 0x71, 0x95, 0x6c, 0x1d, 0x8e, 0x59,
+    0xac, 0x75, 0x04, 0x0f, 0x4a, 0xab, 0xd8, 0x18, 0xa6, 0x5a, 0x43, 0x62, 0x9a, 0xd9, 0x1a, 0x8a,
+    0x37, 0xa5, 0x35, 0x1c, 0x8c, 0xa3, 0x82, 0x61, 0xb0, 0x89, 0xdd, 0x15, 0x03, 0x36, 0x91, 0x5f,
+    0x14, 0x63, 0x62, 0x1f, 0x7d, 0xc7, 0xc3, 0x26, 0x4e, 0x57, 0x0c, 0xea, 0xc4, 0x17, 0xc9, 0x80,
+    0x50, 0xd8, 0x17, 0xcd, 0x80, 0x52, 0xd8, 0x17, 0xd1, 0x80, 0x54, 0x8c, 0x6e, 0x1a, 0xb0, 0x0a,
+    0xeb, 0xaa, 0x01, 0xad, 0x98, 0xdd, 0x35, 0xe0, 0x15, 0xab, 0xc9, 0x86, 0x41, 0x2c, 0xbc, 0xd9,
+    0x86, 0xc1, 0x2c, 0xa2, 0xe9, 0x86, 0xc1, 0x2d, 0xb6, 0xfa, 0x86, 0x41, 0x2d, 0xb2, 0xf9, 0x86,
+    0x41, 0x2d, 0xaa, 0xf9, 0x86, 0x41, 0x2d, 0x4e, 0xf3, 0x0d, 0xa3, 0x5b, 0x74, 0xe3, 0x30, 0xd8,
+    0x85, 0x75, 0xe7, 0x30, 0xf8, 0x85, 0x75, 0xeb, 0x30, 0x18, 0xc6, 0x68, 0xda, 0x61, 0x8b, 0x52,
+    0xdb, 0xbc, 0xc3, 0x16, 0xbd, 0x76, 0xb5, 0x0a, 0x9a, 0x6d, 0xb6, 0x0a, 0xba, 0xed, 0xd1, 0x90,
+    0x72, 0xeb, 0xad, 0x80, 0x7a, 0x5b, 0xad, 0x80, 0x82, 0x6b, 0xad, 0x81, 0x8a, 0x1b, 0xad, 0x81,
+    0x92, 0xab, 0xf2, 0x61, 0x7e, 0x2d, 0x57, 0xf5, 0xc3, 0xfc, 0x6a, 0xae, 0x0a, 0x88, 0xf9, 0x15,
+    0xdd, 0xa9, 0x29, 0x45, 0x77, 0xb5, 0x0a, 0x9a, 0x6e, 0xb6, 0x06, 0xaa, 0xae, 0xb5, 0x06, 0xba,
+    0xae, 0xb7, 0x06, 0xca, 0x6e, 0xb5, 0x06, 0xda, 0xee, 0x6c, 0x0d, 0xd4, 0x5d, 0x35, 0x11, 0x0b,
+    0xfa, 0xae, 0x9a, 0x88, 0x05, 0x85, 0x57, 0x4d, 0xc4, 0xe2, 0x1a, 0x6f, 0x6b, 0xb8, 0xce, 0x1b,
+    0x9a, 0x5e, 0xe7, 0xf5, 0x56, 0x71, 0xa5, 0x37, 0x5b, 0x07, 0xad, 0xd7, 0x5a, 0x07, 0xb5, 0x37,
+    0x5a, 0x05, 0xbd, 0xb7, 0x5a, 0x03, 0xc5, 0x57, 0x9d, 0xc4, 0x36, 0xcd, 0x57, 0xa5, 0xc4, 0x36,
+    0xcd, 0x57, 0xad, 0xc4, 0x36, 0xd5, 0x77, 0xb5, 0x06, 0xba, 0x6f, 0xb6, 0x06, 0xda, 0x6f, 0x69,
+    0x48, 0xfb, 0xf5, 0x56, 0x70, 0xf5, 0xb7, 0x5a, 0xc3, 0xf5, 0x5f, 0x6b, 0x1d, 0x57, 0x80, 0xa3,
+    0x95, 0xd0, 0x80, 0xd5, 0x4e, 0x2c, 0xa9, 0xc0, 0xaa, 0x27, 0x96, 0x74, 0x60, 0xf5, 0x13, 0x4b,
+    0x5a, 0xb0, 0x69, 0x48, 0x0b, 0x5e, 0xad, 0x80, 0x1a, 0x9c, 0xad, 0x80, 0x1e, 0x6c, 0xad, 0x81,
+    0x22, 0xec, 0xad, 0x81, 0x26, 0x5c, 0xad, 0x81, 0x2a, 0x3c, 0x5b, 0xc3, 0x75, 0x61, 0xb5, 0x14,
+    0xab, 0x2b, 0xc3, 0xea, 0x29, 0x56, 0xd7, 0x86, 0xd5, 0x54, 0xac, 0xa8, 0xc3, 0xbb, 0x75, 0x5c,
+    0x21, 0xd6, 0x90, 0x42, 0xec, 0xad, 0x80, 0x46, 0x9c, 0xad, 0x80, 0x4a, 0x6c, 0xad, 0x81, 0x4e,
+    0x1c, 0xad, 0x81, 0x52, 0x5c, 0xad, 0x81, 0x56, 0xac, 0xc2, 0x62, 0x87, 0x5a, 0xac, 0xc2, 0x62,
+    0x87, 0x5e, 0xac, 0xc2, 0x62, 0xe7, 0x8a, 0xf1, 0x6a, 0x15, 0xd7, 0x8c, 0xb3, 0x75, 0x5c, 0x37,
+    0xd6, 0xd7, 0xcc, 0xa1, 0x1b, 0x7b, 0xab, 0xa0, 0x1c, 0x57, 0x6b, 0xa0, 0x1d, 0x5b, 0x6b, 0xa0,
+    0x1e, 0x47, 0x6b, 0xa0, 0x1f, 0xab, 0xbb, 0xfc, 0x0f, 0x4f, 0x75, 0xfb, 0xe5, 0xdd, 0x10, 0x00,
+    0x00,
+};
+
+static const unsigned char zstdFixture[] = {
+    0x28, 0xb5, 0x2f, 0xfd, 0x64, 0xdd, 0x0f, 0x45, 0x19, 0x00, 0x3a, 0x46, 0x54, 0x08, 0x1b, 0xb0,
+    0xa5, 0x92, 0x0e, 0x1c, 0x46, 0x71, 0x39, 0x57, 0x69, 0x18, 0x85, 0xc4, 0x38, 0x18, 0x8a, 0xdb,
+    0x64, 0xef, 0xbd, 0xb7, 0xdc, 0x9a, 0x95, 0x02, 0x19, 0x04, 0x82, 0x00, 0x7a, 0x00, 0x7a, 0x00,
+    0xbd, 0xba, 0xac, 0x4c, 0x06, 0xdd, 0xc1, 0x3b, 0xfa, 0x42, 0x7b, 0xb0, 0x0a, 0x5b, 0xdd, 0x5c,
+    0x54, 0x4e, 0x53, 0xf6, 0xc8, 0xc9, 0xd2, 0x5e, 0x56, 0xcd, 0x98, 0xeb, 0x71, 0x72, 0x37, 0x14,
+    0x4d, 0x3b, 0x1e, 0x2c, 0x09, 0x1f, 0xd5, 0x1c, 0xe6, 0x36, 0x11, 0xbb, 0x5a, 0x32, 0x31, 0x82,
+    0x4f, 0x88, 0xd4, 0x72, 0xd5, 0x1b, 0xe2, 0xa6, 0x09, 0x1d, 0x55, 0xbc, 0x14, 0x61, 0x8e, 0xcc,
+    0x41, 0xa9, 0xaf, 0x61, 0x07, 0x8a, 0x6c, 0x51, 0xbb, 0xeb, 0xa2, 0xa6, 0x20, 0x7d, 0xcc, 0xc2,
+    0x52, 0x41, 0x97, 0x84, 0x73, 0xcc, 0x0e, 0x89, 0xb9, 0x95, 0x49, 0xab, 0x83, 0xc1, 0x90, 0xef,
+    0xe6, 0x0e, 0xc1, 0x68, 0xb3, 0xe8, 0x55, 0x13, 0x26, 0xb2, 0x79, 0x26, 0xb8, 0xc8, 0xd8, 0xad,
+    0xc9, 0x24, 0xc1, 0x80, 0x02, 0x06, 0x08, 0x08, 0x38, 0x30, 0x15, 0xc4, 0x71, 0x00, 0xc0, 0x20,
+    0xc0, 0x11, 0x11, 0x5d, 0x2c, 0x26, 0xdc, 0x0a, 0x9b, 0x49, 0x11, 0x3c, 0x26, 0xc6, 0xee, 0x12,
+    0x26, 0xf3, 0x46, 0x1c, 0x64, 0xcc, 0x11, 0xb4, 0x1e, 0x8e, 0xb7, 0x85, 0xa1, 0xcb, 0x8c, 0x53,
+    0x31, 0x3c, 0x34, 0xb3, 0x8c, 0x5d, 0xa1, 0xdd, 0x91, 0x83, 0xe1, 0x2e, 0xe3, 0x6a, 0xf2, 0x7a,
+    0x30, 0x84, 0xf0, 0x19, 0xe9, 0x50, 0xc3, 0x8d, 0x82, 0x5d, 0xc3, 0x99, 0x64, 0x9e, 0x86, 0x5a,
+    0x48, 0xb9, 0x11, 0xee, 0xa3, 0x23, 0xf4, 0xd2, 0xc2, 0x64, 0xcd, 0x41, 0x22, 0xbf, 0x21, 0x3b,
+    0x48, 0x90, 0xad, 0xbc, 0x48, 0x35, 0x85, 0x85, 0x3e, 0xd7, 0x5b, 0x02, 0xd1, 0x35, 0x5e, 0xe1,
+    0x20, 0x9a, 0x3b, 0x61, 0x8a, 0x1d, 0x2c, 0xc9, 0xc7, 0xbb, 0x43, 0x54, 0x6b, 0x3b, 0xea, 0x15,
+    0x2e, 0x4c, 0x56, 0x7a, 0x8a, 0xb8, 0xd0, 0xd9, 0x9d, 0xce, 0x42, 0x47, 0x74, 0x50, 0xe8, 0xea,
+    0x2b, 0x55, 0x0e, 0xa4, 0xba, 0x2d, 0xe8, 0xe8, 0xba, 0x69, 0xa7, 0x30, 0x15, 0x1e, 0x9b, 0x9b,
+    0xa5, 0xa6, 0xbc, 0x34, 0x65, 0x73, 0xe6, 0xe4, 0x90, 0xe9, 0xbd, 0x53, 0x35, 0xe7, 0x5c, 0x0f,
+    0xc6, 0xc8, 0x7d, 0x27, 0x45, 0x87, 0x20, 0xc7, 0xcd, 0x44, 0xc2, 0x55, 0x52, 0x33, 0x91, 0xdc,
+    0x33, 0x22, 0xb6, 0x88, 0x94, 0xdc, 0x4a, 0x04, 0x27, 0x45, 0xea, 0x08, 0xa9, 0xde, 0xaf, 0x71,
+    0xf3, 0x50, 0xa1, 0x83, 0xd6, 0xe2, 0x57, 0x8d, 0x70, 0xa0, 0xca, 0x6c, 0xd3, 0xba, 0xa4, 0x61,
+    0x53, 0x2b, 0xf2, 0xb0, 0x76, 0x4b, 0x34, 0xea, 0x1e, 0xa5, 0x33, 0xd0, 0xc2, 0x61, 0x0c, 0xba,
+    0x17, 0x85, 0x73, 0xa2, 0xd9, 0xc1, 0x61, 0xcc, 0x27, 0x94, 0x43, 0x69, 0xb5, 0x91, 0x21, 0x57,
+    0x70, 0x6e, 0xba, 0x30, 0x7a, 0x42, 0x73, 0x37, 0xb4, 0x84, 0x33, 0x5e, 0x3b, 0x86, 0x59, 0x37,
+    0x73, 0xd0, 0xd9, 0x7d, 0x8e, 0x36, 0x97, 0x1b, 0x39, 0xd8, 0x0b, 0xf7, 0xf1, 0x58, 0x87, 0xb8,
+    0xe9, 0x76, 0x21, 0x84, 0x2b, 0x04, 0xd2, 0x64, 0x61, 0xf8, 0x54, 0x08, 0xb6, 0x50, 0xe0, 0xdc,
+    0x09, 0x33, 0x25, 0x84, 0x3a, 0x1a, 0x28, 0x77, 0x06, 0xba, 0x79, 0x84, 0x40, 0x07, 0xcf, 0xd8,
+    0x2f, 0x18, 0x85, 0x83, 0x59, 0x98, 0xad, 0x8c, 0xbc, 0xc8, 0xc8, 0xa6, 0xb1, 0x20, 0x8f, 0x18,
+    0x97, 0x1a, 0xd5, 0xa5, 0x85, 0xce, 0xb0, 0xde, 0x71, 0x45, 0x74, 0x0f, 0x15, 0x38, 0xb7, 0x6a,
+    0x38, 0x58, 0x45, 0xf3, 0x51, 0x85, 0xc3, 0x54, 0x6d, 0x93, 0x22, 0xb9, 0x5a, 0x77, 0x13, 0xab,
+    0xf5, 0x44, 0x51, 0x97, 0xa3, 0x0b, 0x37, 0x50, 0x69, 0x1a, 0x11, 0x8f, 0xa2, 0xb3, 0x3b, 0x51,
+    0x67, 0x3e, 0x14, 0x81, 0x8e, 0xa8, 0x11, 0xf0, 0x40, 0x87, 0xaf, 0xdf, 0x01, 0x31, 0x6b, 0x5a,
+    0x98, 0x0e, 0x11, 0xe4, 0x0d, 0x11, 0x1a, 0xdd, 0x01, 0xbf, 0xc8, 0xd4, 0x65, 0x1c, 0x51, 0x3f,
+    0xdf, 0xc1, 0xef, 0x18, 0x8f, 0x87, 0x79, 0x68, 0x96, 0xe8, 0x3e, 0xe5, 0x98, 0xf3, 0x03, 0x7e,
+    0xe6, 0xe8, 0x38, 0xce, 0x64, 0xa8, 0xff, 0xe9, 0x50, 0xf1, 0x94, 0x1f, 0xd0, 0x77, 0xa1, 0xb5,
+    0xf8, 0xca, 0x62, 0x16, 0x4e, 0x43, 0x4b, 0x47, 0xeb, 0xec, 0xac, 0xe6, 0xe1, 0x34, 0x16, 0x07,
+    0xb3, 0x70, 0x64, 0xb4, 0xcf, 0xa8, 0x56, 0x5d, 0x59, 0x0c, 0x17, 0xd3, 0xdf, 0xd1, 0x24, 0xdb,
+    0xa5, 0xd4, 0x85, 0x27, 0x54, 0x5d, 0xbb, 0x44, 0x6d, 0xbf, 0x47, 0x39, 0x38, 0x0a, 0x2c, 0x1c,
+    0x3d, 0xa9, 0x2a, 0x65, 0x89, 0xe0, 0x54, 0x1e, 0xc3, 0xd1, 0x30, 0x0f, 0x69, 0x1a, 0xed, 0x7a,
+    0xf0, 0x97, 0x49, 0x45, 0xd7, 0xa9, 0xc2, 0x14, 0xd3, 0xf1, 0x24, 0x6b, 0x7d, 0x4b, 0xf0, 0x7f,
+    0x73, 0x3c, 0x82, 0x4d, 0xb2, 0x23, 0xb6, 0xae, 0x82, 0x4a, 0xab, 0x1e, 0x68, 0xa4, 0xef, 0xb2,
+    0x43, 0x3c, 0xf7, 0x19, 0x3f, 0x30, 0x09, 0x5f, 0x44, 0x03, 0x23, 0xaa, 0xb0, 0x05, 0xaa, 0x12,
+    0x62, 0xfd, 0x16, 0xb9, 0x87, 0xc4, 0xe9, 0x55, 0x69, 0x1f, 0x72, 0xbc, 0x8c, 0x64, 0x0c, 0xcd,
+    0x0f, 0xa4, 0x56, 0xb9, 0x42, 0x53, 0x1d, 0xd3, 0x89, 0xff, 0x2e, 0x7c, 0x43, 0x04, 0x9b, 0x2b,
+    0x6c, 0x98, 0x4c, 0xc7, 0xe3, 0x36, 0xba, 0x61, 0xed, 0x8b, 0xb1, 0x28, 0x48, 0x35, 0x94, 0xae,
+    0x2f, 0x3f, 0x93, 0xbf, 0xe4, 0xf1, 0x02, 0xae, 0xa8, 0x51, 0x09, 0x3d, 0x8c, 0x11, 0x4a, 0xd7,
+    0xa7, 0xb4, 0x87, 0x2b, 0x2a, 0x55, 0xed, 0x68, 0x4d, 0xe4, 0xc4, 0x18, 0xb9, 0x20, 0x49, 0x32,
+    0x2d, 0x06, 0x15, 0x59, 0xe4, 0x10, 0x43, 0x0e, 0x32, 0xe4, 0x21, 0x93, 0xc8, 0x4b, 0x1b, 0x86,
+    0xa4, 0x55, 0xcb, 0x80, 0xe3, 0x30,
+};
+
+// 圧縮前の内容（4317 バイト）
+static std::string FixtureText() {
+    std::string text;
+    for (int i = 0; i < 200; ++i) {
+        text += std::to_string(i) + ",name" + std::to_string(i % 13) + "," + std::to_string((i * 37) % 101) + ".5,東京\n";
+    }
+    return text;
+}
+
+static std::string FixtureBytes(const unsigned char* data, size_t size) {
+    return std::string(reinterpret_cast<const char*>(data), size);
+}
+
+// ==================== Helpers ====================
+
+static uint32_t Crc32(const std::string& data) {
+    static uint32_t table[256];
+    if (table[1] == 0) {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (unsigned char byte : data) {
+        crc = table[(crc ^ byte) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static void AppendLE(std::string& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out += static_cast<char>((value >> (8 * i)) & 0xFF);
+    }
+}
+
+// 無圧縮ブロックだけの gzip メンバー（bgzf なら BGZF の拡張フィールドにメンバーの大きさを書く）
+static std::string MakeStoredGzip(const std::string& content, bool bgzf) {
+    std::string deflate;
+    size_t offset = 0;
+    do {
+        const size_t length = std::min<size_t>(65535, content.size() - offset);
+        deflate += static_cast<char>(offset + length == content.size() ? 1 : 0);
+        AppendLE(deflate, length, 2);
+        AppendLE(deflate, ~length & 0xFFFF, 2);
+        deflate.append(content, offset, length);
+        offset += length;
+    } while (offset < content.size());
+
+    std::string member = { '\x1f', '\x8b', '\x08', static_cast<char>(bgzf ? 0x04 : 0x00), 0, 0, 0, 0, 0, '\xff' };
+    if (bgzf) {
+        AppendLE(member, 6, 2);
+        member += "BC";
+        AppendLE(member, 2, 2);
+        AppendLE(member, member.size() + 2 + deflate.size() + 8 - 1, 2);
+    }
+    member += deflate;
+    AppendLE(member, Crc32(content), 4);
+    AppendLE(member, content.size(), 4);
+    return member;
+}
+
+// 無圧縮ブロックと RLE ブロックだけの zstd フレーム（runs の各要素は RLE ブロックにする 1 バイトと長さ）
+static std::string MakeRawZstd(const std::string& content, const std::vector<std::pair<char, size_t>>& runs = {}) {
+    std::string frame = { '\x28', '\xb5', '\x2f', '\xfd', '\x00', static_cast<char>((20 - 10) << 3) };
+    std::vector<std::pair<int, std::string>> blocks;
+    for (size_t offset = 0; offset < content.size(); offset += 100000) {
+        blocks.emplace_back(0, content.substr(offset, 100000));
+    }
+    for (const auto& run : runs) {
+        blocks.emplace_back(1, std::string(run.second, run.first));
+    }
+    if (blocks.empty()) {
+        blocks.emplace_back(0, std::string());
+    }
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        const bool last = i + 1 == blocks.size();
+        const std::string& payload = blocks[i].second;
+        AppendLE(frame, (last ? 1 : 0) | (blocks[i].first << 1) | (payload.size() << 3), 3);
+        if (blocks[i].first == 0) {
+            frame += payload;
+        } else {
+            frame += payload[0];
+        }
+    }
+    return frame;
+}
+
+static std::string RandomText(size_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::string text(size, '\0');
+    for (auto& c : text) {
+        c = static_cast<char>(random() & 0xFF);
+    }
+    return text;
+}
+
+// 伸長器から少しずつ取り出してすべてを返す
+template <typename Decoder>
+static bool DecodeAll(const std::string& input, std::string& output, size_t minimumBytes = 1000) {
+    Decoder decoder(input.data(), input.size());
+    output.clear();
+    while (decoder.Decode(output, minimumBytes)) {
+    }
+    return !decoder.HasError();
+}
+
+// ==================== GzipDecoder ====================
+
+// 動的ハフマンで圧縮した実際の gzip と、その連結（複数メンバー）を伸長できること
+TEST(GzipDecoderTest, DecodesRealFixtureAndMultipleMembers) {
+    const std::string gzip = FixtureBytes(gzipFixture, sizeof(gzipFixture));
+    std::string output;
+    ASSERT_TRUE(DecodeAll<GzipDecoder>(gzip, output, 1));
+    EXPECT_EQ(FixtureText(), output);
+
+    ASSERT_TRUE(DecodeAll<GzipDecoder>(gzip + gzip, output));
+    EXPECT_EQ(FixtureText() + FixtureText(), output);
+
+    std::vector<std::pair<size_t, size_t>> members;
+    EXPECT_FALSE(GzipDecoder::FindBgzfMembers(gzip.data(), gzip.size(), members));
+}
+
+// 無圧縮ブロックの大きなメンバーと BGZF のメンバー境界を往復すること
+TEST(GzipDecoderTest, StoredBlocksAndBgzfMembers) {
+    const std::string content = RandomText(200000, 1);
+    std::string output;
+    ASSERT_TRUE(DecodeAll<GzipDecoder>(MakeStoredGzip(content, false), output));
+    EXPECT_TRUE(content == output);
+
+    std::string bgzf;
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (size_t offset = 0; offset < content.size(); offset += 60000) {
+        const std::string member = MakeStoredGzip(content.substr(offset, 60000), true);
+        expected.emplace_back(bgzf.size(), member.size());
+        bgzf += member;
+    }
+    std::vector<std::pair<size_t, size_t>> members;
+    ASSERT_TRUE(GzipDecoder::FindBgzfMembers(bgzf.data(), bgzf.size(), members));
+    EXPECT_EQ(expected, members);
+    ASSERT_TRUE(DecodeAll<GzipDecoder>(bgzf, output));
+    EXPECT_TRUE(content == output);
+}
+
+// CRC32・伸長後サイズの不一致や途中で切れた入力は失敗として扱うこと
+TEST(GzipDecoderTest, DetectsCorruption) {
+    const std::string gzip = FixtureBytes(gzipFixture, sizeof(gzipFixture));
+    std::string output;
+
+    std::string badCrc = gzip;
+    badCrc[badCrc.size() - 8] ^= 0x01;
+    EXPECT_FALSE(DecodeAll<GzipDecoder>(badCrc, output));
+
+    std::string badSize = gzip;
+    badSize[badSize.size() - 1] ^= 0x01;
+    EXPECT_FALSE(DecodeAll<GzipDecoder>(badSize, output));
+
+    for (size_t keep : { size_t(5), size_t(20), gzip.size() / 2, gzip.size() - 3 }) {
+        EXPECT_FALSE(DecodeAll<GzipDecoder>(gzip.substr(0, keep), output)) << keep;
+    }
+}
+
+// ==================== ZstdDecoder ====================
+
+// FSE・ハフマンで圧縮しチェックサムを持つ実際の zstd と、スキップ可能フレームを挟んだ複数フレームを伸長できること
+TEST(ZstdDecoderTest, DecodesRealFixtureAndMultipleFrames) {
+    const std::string zstd = FixtureBytes(zstdFixture, sizeof(zstdFixture));
+    std::string output;
+    ASSERT_TRUE(DecodeAll<ZstdDecoder>(zstd, output, 1));
+    EXPECT_EQ(FixtureText(), output);
+
+    std::string skippable = { '\x50', '\x2a', '\x4d', '\x18' };
+    AppendLE(skippable, 5, 4);
+    skippable += "skip!";
+    const std::string frames = zstd + skippable + zstd;
+    ASSERT_TRUE(DecodeAll<ZstdDecoder>(frames, output));
+    EXPECT_EQ(FixtureText() + FixtureText(), output);
+
+    std::vector<std::pair<size_t, size_t>> found;
+    ASSERT_TRUE(ZstdDecoder::FindFrames(frames.data(), frames.size(), found));
+    const std::vector<std::pair<size_t, size_t>> expected = {
+        { 0, zstd.size() }, { zstd.size() + skippable.size(), zstd.size() } };
+    EXPECT_EQ(expected, found);
+}
+
+// 無圧縮ブロック・RLE ブロックのフレームを往復すること
+TEST(ZstdDecoderTest, RawAndRleBlocks) {
+    const std::string content = RandomText(250000, 2);
+    std::string output;
+    ASSERT_TRUE(DecodeAll<ZstdDecoder>(MakeRawZstd(content, { { 'a', 70000 }, { '\n', 3 } }), output));
+    EXPECT_TRUE(content + std::string(70000, 'a') + "\n\n\n" == output);
+
+    ASSERT_TRUE(DecodeAll<ZstdDecoder>(MakeRawZstd(std::string()), output));
+    EXPECT_TRUE(output.empty());
+}
+
+// チェックサムの不一致や途中で切れた入力は失敗として扱うこと
+TEST(ZstdDecoderTest, DetectsCorruption) {
+    const std::string zstd = FixtureBytes(zstdFixture, sizeof(zstdFixture));
+    std::string output;
+
+    std::string badChecksum = zstd;
+    badChecksum[badChecksum.size() - 1] ^= 0x01;
+    EXPECT_FALSE(DecodeAll<ZstdDecoder>(badChecksum, output));
+
+    for (size_t keep : { size_t(3), size_t(10), zstd.size() / 2, zstd.size() - 2 }) {
+        EXPECT_FALSE(DecodeAll<ZstdDecoder>(zstd.substr(0, keep), output)) << keep;
+    }
+}
+
+// ==================== Compressed Load ====================
+
+class CompressedLoadTest : public CsvEngineTestBase {};
+
+// .csv.gz / .csv.zst を読み込んだ表は、同じ内容の CSV を読み込んだ表と一致すること
+TEST_F(CompressedLoadTest, CompressedFilesLoadLikePlainCsv) {
+    const std::string header = "id,name,value,city\n";
+    const std::string plainPath = TempPath("plain.csv");
+    WriteTextFile(plainPath, header + FixtureText());
+    CSVData plain;
+    ASSERT_TRUE(plain.LoadFromFile(plainPath));
+
+    const std::vector<std::pair<std::string, std::string>> files = {
+        { "fixture.csv.gz", MakeStoredGzip(header, false) + FixtureBytes(gzipFixture, sizeof(gzipFixture)) },
+        { "fixture.csv.zst", MakeRawZstd(header) + FixtureBytes(zstdFixture, sizeof(zstdFixture)) },
+    };
+    for (const auto& file : files) {
+        const std::string path = TempPath(file.first);
+        WriteTextFile(path, file.second);
+        CSVData loaded;
+        ASSERT_TRUE(loaded.LoadFromFile(path)) << file.first;
+        EXPECT_EQ(plain.GetHeaders(), loaded.GetHeaders()) << file.first;
+        EXPECT_EQ(ToRows(plain), ToRows(loaded)) << file.first;
+    }
+
+    // 壊れた圧縮ファイルは読み込みの失敗になる
+    std::string corrupt = files[0].second;
+    corrupt[corrupt.size() - 8] ^= 0x01;
+    const std::string corruptPath = TempPath("corrupt.csv.gz");
+    WriteTextFile(corruptPath, corrupt);
+    CSVData loaded;
+    EXPECT_FALSE(loaded.LoadFromFile(corruptPath));
+}
+
+} // namespace Testing
+} // namespace NSys
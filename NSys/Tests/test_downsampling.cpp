@@ -0,0 +1,134 @@
+#include "test_csv_common.h"
+#include "Downsampling.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Helpers ====================
+
+// 緩やかな波に乱数と所々の突出値を加えた系列（x は等間隔）
+static void MakeSeries(size_t count, std::vector<double>& x, std::vector<double>& y) {
+    std::mt19937 random(4);
+    std::uniform_real_distribution<double> noise(-1.0, 1.0);
+    x.resize(count);
+    y.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        x[i] = static_cast<double>(i) * 0.5;
+        y[i] = std::sin(static_cast<double>(i) / 5000.0) * 100.0 + noise(random);
+        if (i % 77777 == 1234) {
+            y[i] = (i / 77777) % 2 ? 1000.0 + static_cast<double>(i) : -1000.0 - static_cast<double>(i);
+        }
+    }
+}
+
+// 出力の各点が元の系列の点であり、x の昇順に並んでいること
+static void ExpectSubsequence(const std::vector<double>& x, const std::vector<double>& y,
+    const std::vector<double>& outX, const std::vector<double>& outY) {
+    ASSERT_EQ(outX.size(), outY.size());
+    for (size_t i = 0; i < outX.size(); ++i) {
+        const size_t index = static_cast<size_t>(std::lower_bound(x.begin(), x.end(), outX[i]) - x.begin());
+        ASSERT_LT(index, x.size());
+        ASSERT_EQ(x[index], outX[i]);
+        ASSERT_EQ(y[index], outY[i]) << "point " << i;
+        if (i > 0) {
+            ASSERT_LT(outX[i - 1], outX[i]);
+        }
+    }
+}
+
+// ==================== DownsampledSeries ====================
+
+// 最小・最大の間引きは、どの解像度のレベルを使っても表示範囲の最小値・最大値を落とさないこと
+TEST(DownsamplingTest, MinMaxKeepsRangeExtremes) {
+    std::vector<double> x;
+    std::vector<double> y;
+    MakeSeries(1000000, x, y);
+    DownsampledSeries series;
+    series.Build(x, y);
+    EXPECT_EQ(x.size(), series.GetPointCount());
+    EXPECT_EQ(*std::min_element(y.begin(), y.end()), series.GetMinY());
+    EXPECT_EQ(*std::max_element(y.begin(), y.end()), series.GetMaxY());
+
+    std::mt19937 random(6);
+    std::vector<double> outX;
+    std::vector<double> outY;
+    for (int trial = 0; trial < 200; ++trial) {
+        size_t first = random() % x.size();
+        size_t last = random() % x.size();
+        if (first > last) {
+            std::swap(first, last);
+        }
+        const int pixels = 1 + static_cast<int>(random() % 2000);
+        series.Query(x[first], x[last], pixels, DownsampleMode::MinMax, outX, outY);
+        ExpectSubsequence(x, y, outX, outY);
+
+        // 範囲の外側 1 点ずつまで含める。小さな範囲は元の点をそのまま返す
+        const size_t begin = first > 0 ? first - 1 : 0;
+        const size_t end = std::min(x.size(), last + 2);
+        const size_t visible = end - begin;
+        if (visible <= static_cast<size_t>(pixels) * 2) {
+            ASSERT_EQ(std::vector<double>(x.begin() + begin, x.begin() + end), outX);
+            continue;
+        }
+
+        // ピラミッドのバケットは範囲の端をまたぐことがあるが、バケット幅は表示範囲の点数を超えない
+        const double rangeMin = *std::min_element(y.begin() + begin, y.begin() + end);
+        const double rangeMax = *std::max_element(y.begin() + begin, y.begin() + end);
+        ASSERT_LE(*std::min_element(outY.begin(), outY.end()), rangeMin);
+        ASSERT_GE(*std::max_element(outY.begin(), outY.end()), rangeMax);
+        ASSERT_GE(outX.front(), x[begin >= visible ? begin - visible : 0]);
+        ASSERT_LE(outX.back(), x[std::min(x.size() - 1, end + visible)]);
+        ASSERT_LE(outX.size(), static_cast<size_t>(pixels) * 8 + 4) << "pixels " << pixels << " visible " << visible;
+    }
+}
+
+// LTTB は最小・最大の候補点からピクセル数ちょうどの点に絞ること
+TEST(DownsamplingTest, LttbQueryReducesToPixelCount) {
+    std::vector<double> x;
+    std::vector<double> y;
+    MakeSeries(200000, x, y);
+    DownsampledSeries series;
+    series.Build(x, y);
+
+    std::vector<double> outX;
+    std::vector<double> outY;
+    series.Query(x.front(), x.back(), 800, DownsampleMode::LTTB, outX, outY);
+    ExpectSubsequence(x, y, outX, outY);
+    EXPECT_EQ(800u, outX.size());
+
+    // 範囲外の問い合わせと空の系列
+    series.Query(x.back() + 10.0, x.back() + 20.0, 800, DownsampleMode::LTTB, outX, outY);
+    EXPECT_EQ(1u, outX.size());
+    series.Clear();
+    EXPECT_TRUE(series.IsEmpty());
+    EXPECT_EQ(0.0, series.GetMinY());
+    EXPECT_EQ(0.0, series.GetMaxY());
+    series.Query(0.0, 1.0, 800, DownsampleMode::MinMax, outX, outY);
+    EXPECT_TRUE(outX.empty());
+}
+
+// 1 点だけ突出した値は LTTB でも残ること。点数が閾値以下なら複写するだけ
+TEST(DownsamplingTest, LttbKeepsSpike) {
+    std::vector<double> x(1000);
+    std::vector<double> y(1000, 0.0);
+    for (size_t i = 0; i < x.size(); ++i) {
+        x[i] = static_cast<double>(i);
+    }
+    y[437] = 50.0;
+
+    std::vector<double> outX;
+    std::vector<double> outY;
+    DownsampleLTTB(x.data(), y.data(), x.size(), 20, outX, outY);
+    EXPECT_EQ(20u, outX.size());
+    EXPECT_NE(outY.end(), std::find(outY.begin(), outY.end(), 50.0));
+    ExpectSubsequence(x, y, outX, outY);
+
+    DownsampleLTTB(x.data(), y.data(), 10, 20, outX, outY);
+    EXPECT_EQ(std::vector<double>(x.begin(), x.begin() + 10), outX);
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,106 @@
+#include "test_csv_common.h"
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Edit history ====================
+
+class EditHistoryTest : public ::testing::Test {
+protected:
+    static std::vector<std::string> WideHeaders(const std::string& prefix) {
+        std::vector<std::string> headers;
+        for (int c = 0; c < 200; ++c) {
+            headers.push_back(prefix + "_a_fairly_long_column_name_" + std::to_string(c));
+        }
+        return headers;
+    }
+};
+
+// 見出しの変更とセルの編集を、記録した順に取り消し・やり直しできること
+TEST_F(EditHistoryTest, UndoRedoRestoresHeadersAndCells) {
+    CSVData data;
+    data.EnableHistory();
+    FillTable(data, { "a", "b" }, { { "1", "2" } });
+    data.SetHeaders({ "x", "y" });
+    data.SetCell(0, 1, "changed");
+    data.AddRow({ "3", "4" });
+
+    ASSERT_TRUE(data.Undo());
+    ASSERT_TRUE(data.Undo());
+    EXPECT_EQ((std::vector<std::string>{ "x", "y" }), data.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "2" } }), ToRows(data));
+    ASSERT_TRUE(data.Undo());
+    EXPECT_EQ((std::vector<std::string>{ "a", "b" }), data.GetHeaders());
+
+    ASSERT_TRUE(data.Redo());
+    ASSERT_TRUE(data.Redo());
+    EXPECT_EQ((std::vector<std::string>{ "x", "y" }), data.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "changed" } }), ToRows(data));
+
+    // 新しい編集でやり直しの履歴は消え、その使用量も数えなくなる
+    data.SetHeaders({ "p", "q" });
+    EXPECT_FALSE(data.CanRedo());
+    while (data.Undo()) {
+    }
+    EXPECT_TRUE(data.GetHeaders().empty());
+    EXPECT_EQ(0u, data.GetRowCount());
+    EXPECT_GT(data.GetHistoryMemoryUsage(), 0u);
+    data.DisableHistory();
+    EXPECT_EQ(0u, data.GetHistoryMemoryUsage());
+}
+
+// 見出しを変えない編集では、ステップごとに見出しを複製しない
+TEST_F(EditHistoryTest, StepsShareUnchangedHeaders) {
+    CSVData data;
+    data.EnableHistory();
+    const std::vector<std::string> headers = WideHeaders("wide");
+    data.SetHeaders(headers);
+    data.AddRow(std::vector<std::string>(headers.size(), "v"));
+
+    size_t headerBytes = 0;
+    for (const auto& header : headers) {
+        headerBytes += sizeof(std::string) + header.capacity();
+    }
+    const size_t before = data.GetHistoryMemoryUsage();
+    for (int i = 0; i < 1000; ++i) {
+        data.SetCell(0, static_cast<size_t>(i) % headers.size(), std::to_string(i));
+    }
+    EXPECT_LT(data.GetHistoryMemoryUsage() - before, 1000 * headerBytes / 2);
+
+    // 見出しを変えた時点の見出しは、取り消し後も正しく戻る
+    data.SetHeaders(WideHeaders("renamed"));
+    data.SetCell(0, 0, "after");
+    ASSERT_TRUE(data.Undo());
+    ASSERT_TRUE(data.Undo());
+    EXPECT_EQ(headers, data.GetHeaders());
+    ASSERT_TRUE(data.Redo());
+    EXPECT_EQ(WideHeaders("renamed"), data.GetHeaders());
+}
+
+// 使用量が上限を超えたら古いステップから破棄し、上限付近に収めること
+TEST_F(EditHistoryTest, TrimsOldestStepsOverLimit) {
+    CSVData data;
+    data.EnableHistory(1 << 20);
+    data.SetHeaders({ "a" });
+    for (int i = 0; i < 20000; ++i) {
+        data.AddRow({ "row" + std::to_string(i) });
+        data.SetCell(static_cast<size_t>(i) / 2, 0, "edited" + std::to_string(i));
+    }
+    EXPECT_LT(data.GetUndoCount(), 40000u);
+    EXPECT_LE(data.GetHistoryMemoryUsage(), data.GetHistoryMemoryLimit() * 2);
+
+    // 取り消しとやり直しを繰り返しても使用量の合計がずれないこと
+    const size_t usage = data.GetHistoryMemoryUsage();
+    const size_t steps = data.GetUndoCount();
+    ASSERT_GT(steps, 5u);
+    for (size_t i = 0; i < steps; ++i) {
+        ASSERT_TRUE(data.Undo());
+    }
+    for (size_t i = 0; i < steps; ++i) {
+        ASSERT_TRUE(data.Redo());
+    }
+    EXPECT_EQ(usage, data.GetHistoryMemoryUsage());
+}
+
+} // namespace Testing
+} // namespace NSys
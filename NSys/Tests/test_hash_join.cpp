@@ -0,0 +1,201 @@
+#include "test_csv_common.h"
+#include "BloomFilter.h"
+#include "ColumnIndex.h"
+#include "HashJoin.h"
+#include <algorithm>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== BloomFilter ====================
+
+// 登録したキーは必ず含まれると判定し、登録していないキーの偽陽性率は数 % 以下に収まること
+TEST(BloomFilterTest, NoFalseNegativesAndLowFalsePositiveRate) {
+    std::mt19937_64 random(1);
+    std::vector<uint64_t> inserted(100000);
+    BloomFilter bloom(inserted.size());
+    for (auto& hash : inserted) {
+        hash = random();
+        bloom.Insert(hash);
+    }
+    for (uint64_t hash : inserted) {
+        ASSERT_TRUE(bloom.MayContain(hash));
+    }
+
+    size_t falsePositives = 0;
+    const size_t trials = 200000;
+    for (size_t i = 0; i < trials; ++i) {
+        falsePositives += bloom.MayContain(random()) ? 1 : 0;
+    }
+    EXPECT_LT(static_cast<double>(falsePositives) / trials, 0.03);
+    EXPECT_FALSE(bloom.IsEmpty());
+}
+
+// ==================== HashJoin ====================
+
+class HashJoinTest : public ::testing::Test {
+protected:
+    // 数値として等しい表記（1 と 1.0、0 と -0）・文字列・空のセルが混ざったキー列を持つ表
+    static void FillKeyTable(CSVData& data, const std::string& prefix, size_t rowCount, size_t keyRange, uint32_t seed) {
+        std::mt19937 random(seed);
+        data.SetHeaders({ "key", prefix + "_value" });
+        for (size_t r = 0; r < rowCount; ++r) {
+            const size_t k = random() % keyRange;
+            std::string key;
+            switch (random() % 6) {
+            case 0: key = std::to_string(k); break;
+            case 1: key = std::to_string(k) + ".0"; break;
+            case 2: key = "k" + std::to_string(k); break;
+            case 3: key = k == 0 ? "-0" : std::to_string(k); break;
+            case 4: key = std::to_string(k) + ".5"; break;
+            default: key = random() % 4 == 0 ? std::string() : "k" + std::to_string(k); break;
+            }
+            data.AddRow(std::vector<std::string>{ key, prefix + std::to_string(r) });
+        }
+    }
+
+    // 全ての行の組を CellKey で比べる入れ子ループ結合（行の順は比べないため並べ替えて返す）
+    static std::vector<std::vector<std::string>> NestedLoopJoin(const CSVData& left, const CSVData& right, const std::string& type) {
+        const auto leftRows = ToRows(left);
+        const auto rightRows = ToRows(right);
+        const bool keepLeft = type == "left" || type == "outer";
+        const bool keepRight = type == "right" || type == "outer";
+        std::vector<char> rightMatched(rightRows.size(), 0);
+        std::vector<std::vector<std::string>> rows;
+        auto append = [&](const std::vector<std::string>* l, const std::vector<std::string>* r) {
+            std::vector<std::string> row;
+            for (size_t c = 0; c < left.GetColumnCount(); ++c) {
+                row.push_back(l ? (*l)[c] : std::string());
+            }
+            for (size_t c = 0; c < right.GetColumnCount(); ++c) {
+                row.push_back(r ? (*r)[c] : std::string());
+            }
+            rows.push_back(std::move(row));
+        };
+        for (const auto& l : leftRows) {
+            bool matched = false;
+            for (size_t j = 0; j < rightRows.size(); ++j) {
+                if (!l[0].empty() && !rightRows[j][0].empty()
+                    && CellKey::From(l[0]) == CellKey::From(rightRows[j][0])) {
+                    append(&l, &rightRows[j]);
+                    matched = true;
+                    rightMatched[j] = 1;
+                }
+            }
+            if (!matched && keepLeft) {
+                append(&l, nullptr);
+            }
+        }
+        for (size_t j = 0; j < rightRows.size(); ++j) {
+            if (!rightMatched[j] && keepRight) {
+                append(nullptr, &rightRows[j]);
+            }
+        }
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    static std::vector<std::vector<std::string>> SortedRows(const CSVData& data) {
+        auto rows = ToRows(data);
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+};
+
+// 結合の種類・Bloom フィルターの有無・作成済み索引の位置によらず、入れ子ループ結合と同じ行を返すこと
+TEST_F(HashJoinTest, MatchesNestedLoopJoin) {
+    for (int indexed = 0; indexed < 3; ++indexed) {
+        CSVData left;
+        CSVData right;
+        FillKeyTable(left, "l", 3000, 4000, 1);
+        FillKeyTable(right, "r", 700, 900, 2);
+        if (indexed == 1) {
+            right.BuildHashIndex(0);
+        } else if (indexed == 2) {
+            left.BuildHashIndex(0);
+        }
+
+        for (const char* type : { "inner", "left", "right", "outer" }) {
+            const auto expected = NestedLoopJoin(left, right, type);
+            for (const char* bloom : { "never", "always", "auto" }) {
+                JoinSpec spec;
+                spec.leftColumn = "key";
+                spec.rightColumn = "key";
+                spec.type = type;
+                spec.bloomFilter = bloom;
+                CSVData output;
+                JoinStats stats;
+                ASSERT_TRUE(JoinTables(left, right, spec, output, &stats));
+                EXPECT_EQ(std::string(bloom) == "always", stats.usedBloomFilter) << bloom;
+                EXPECT_EQ(indexed != 0, stats.usedIndex);
+                EXPECT_EQ(output.GetRowCount(), stats.outputRows);
+                EXPECT_EQ((std::vector<std::string>{ "key", "l_value", "key_右", "r_value" }), output.GetHeaders());
+                EXPECT_EQ(expected, SortedRows(output)) << "type=" << type << " bloom=" << bloom << " indexed=" << indexed;
+            }
+        }
+    }
+}
+
+// 一致率の低い大きな走査側では auto で Bloom フィルターを使い、使わない場合と同じ行を返すこと
+TEST_F(HashJoinTest, AutoBloomFilterOnSelectiveJoin) {
+    CSVData left;
+    CSVData right;
+    FillKeyTable(left, "l", 100000, 1000000, 3);
+    FillKeyTable(right, "r", 5000, 20000, 4);
+
+    for (const char* type : { "inner", "left", "outer" }) {
+        JoinSpec spec;
+        spec.leftColumn = "key";
+        spec.rightColumn = "key";
+        spec.type = type;
+
+        CSVData filtered;
+        JoinStats stats;
+        ASSERT_TRUE(JoinTables(left, right, spec, filtered, &stats));
+        EXPECT_TRUE(stats.usedBloomFilter) << "match rate " << stats.estimatedMatchRate;
+        EXPECT_LT(stats.estimatedMatchRate, 0.25);
+
+        spec.bloomFilter = "never";
+        CSVData plain;
+        JoinStats plainStats;
+        ASSERT_TRUE(JoinTables(left, right, spec, plain, &plainStats));
+        EXPECT_FALSE(plainStats.usedBloomFilter);
+        EXPECT_EQ(0u, plainStats.bloomRejectedRows);
+        EXPECT_EQ(SortedRows(plain), SortedRows(filtered)) << type;
+
+        // 捨てた行はどれも一致しない行で（偽陰性が無い）、一致しない行のほとんどを捨てている
+        const auto index = HashColumnIndex::Build(right, 0);
+        ASSERT_TRUE(index);
+        size_t unmatchedKeys = 0;
+        for (size_t r = 0; r < left.GetRowCount(); ++r) {
+            const std::string_view cell = left.GetCell(r, 0);
+            if (!cell.empty() && index->Find(right, CellKey::From(cell)).empty()) {
+                ++unmatchedKeys;
+            }
+        }
+        EXPECT_LE(stats.bloomRejectedRows, unmatchedKeys);
+        EXPECT_GT(stats.bloomRejectedRows, unmatchedKeys * 9 / 10);
+    }
+}
+
+// 存在しない列や未知の結合の種類は失敗すること
+TEST_F(HashJoinTest, RejectsInvalidSpec) {
+    CSVData left;
+    CSVData right;
+    FillKeyTable(left, "l", 10, 10, 5);
+    FillKeyTable(right, "r", 10, 10, 6);
+    CSVData output;
+
+    JoinSpec spec;
+    spec.leftColumn = "key";
+    spec.rightColumn = "missing";
+    EXPECT_FALSE(JoinTables(left, right, spec, output));
+
+    spec.rightColumn = "key";
+    spec.type = "cross";
+    EXPECT_FALSE(JoinTables(left, right, spec, output));
+}
+
+} // namespace Testing
+} // namespace NSys
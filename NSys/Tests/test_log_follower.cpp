@@ -0,0 +1,151 @@
+#include "test_csv_common.h"
+#include "LogFollower.h"
+#include <functional>
+#include <optional>
+#include <thread>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== LogFollower ====================
+
+class LogFollowerTest : public CsvEngineTestBase {
+protected:
+    void AppendTextFile(const std::string& path, const std::string& content) const {
+        std::ofstream file(path, std::ios::binary | std::ios::app);
+        file.write(content.data(), static_cast<std::streamsize>(content.size()));
+    }
+
+    // ワーカーが追いつくまで待つ（通知が届かない環境でもポーリングで拾える程度の時間）
+    static bool WaitFor(const std::function<bool()>& condition) {
+        for (int i = 0; i < 500; ++i) {
+            if (condition()) {
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return condition();
+    }
+
+    // rows 行を受け取るまで TakeRows を繰り返す
+    static bool TakeUntil(LogFollower& follower, CSVData& data, size_t rows) {
+        return WaitFor([&]() {
+            follower.TakeRows(data);
+            return data.GetRowCount() >= rows;
+        });
+    }
+};
+
+// 改行で終わっていない末尾の行は、続きが追記されるまで表に出さないこと
+TEST_F(LogFollowerTest, HoldsPartialLineUntilCompleted) {
+    const std::string path = TempPath("follow.csv");
+    const std::string complete = "time,level,message\r\n1,info,started\r\n";
+    WriteTextFile(path, complete + "2,warn,disk");
+
+    LogFollower follower;
+    ASSERT_TRUE(follower.Start(path));
+    CSVData data;
+    ASSERT_TRUE(TakeUntil(follower, data, 1));
+    EXPECT_EQ((std::vector<std::string>{ "time", "level", "message" }), data.GetHeaders());
+    EXPECT_TRUE(WaitFor([&]() { return follower.GetParsedOffset() == complete.size(); }));
+    follower.TakeRows(data);
+    EXPECT_EQ(1u, data.GetRowCount());
+
+    // 行の続きと、引用符で囲んだフィールドを含む次の行を追記する
+    AppendTextFile(path, " full\r\n3,error,\"a, b\"\r\n");
+    ASSERT_TRUE(TakeUntil(follower, data, 3));
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "1", "info", "started" }, { "2", "warn", "disk full" }, { "3", "error", "a, b" } }), ToRows(data));
+    EXPECT_FALSE(follower.WasTruncated());
+    follower.Stop();
+    EXPECT_FALSE(follower.IsRunning());
+}
+
+// TakeRows は maxRows ずつ移し、残りは次の呼び出しに回すこと
+TEST_F(LogFollowerTest, TakeRowsHonoursLimit) {
+    const std::string path = TempPath("many.csv");
+    std::string content = "n\n";
+    for (int i = 0; i < 1000; ++i) {
+        content += std::to_string(i) + "\n";
+    }
+    WriteTextFile(path, content);
+
+    LogFollower follower;
+    ASSERT_TRUE(follower.Start(path));
+    ASSERT_TRUE(WaitFor([&]() { return follower.GetParsedOffset() == content.size(); }));
+    CSVData data;
+    EXPECT_EQ(300u, follower.TakeRows(data, 300));
+    EXPECT_EQ(300u, follower.TakeRows(data, 300));
+    EXPECT_EQ(400u, follower.TakeRows(data, 1000));
+    EXPECT_EQ(0u, follower.TakeRows(data, 1000));
+    ASSERT_EQ(1000u, data.GetRowCount());
+    EXPECT_EQ("999", std::string(data.GetRows()[999][0]));
+}
+
+// ファイルが切り詰められたら読み直しが必要なことを知らせること
+TEST_F(LogFollowerTest, ReportsTruncation) {
+    const std::string path = TempPath("rotate.csv");
+    WriteTextFile(path, "a,b\n1,2\n3,4\n");
+
+    LogFollower follower;
+    ASSERT_TRUE(follower.Start(path));
+    CSVData data;
+    ASSERT_TRUE(TakeUntil(follower, data, 2));
+
+    WriteTextFile(path, "a\n");
+    EXPECT_TRUE(WaitFor([&]() { return follower.WasTruncated(); }));
+    follower.TakeRows(data);
+    EXPECT_EQ(2u, data.GetRowCount());
+}
+
+// CP932 のログは UTF-8 に変換し、圧縮ファイルは追いかけないこと
+TEST_F(LogFollowerTest, ConvertsCp932AndRejectsCompressed) {
+    const std::string path = TempPath("sjis.csv");
+    WriteTextFile(path, "\x96\xBC\x91\x4F\n\x93\x8C\x8B\x9E\n");
+    LogFollower follower;
+    ASSERT_TRUE(follower.Start(path));
+    CSVData data;
+    ASSERT_TRUE(TakeUntil(follower, data, 1));
+    EXPECT_EQ((std::vector<std::string>{ "名前" }), data.GetHeaders());
+    EXPECT_EQ("東京", std::string(data.GetRows()[0][0]));
+
+    const std::string gzipPath = TempPath("log.csv.gz");
+    WriteTextFile(gzipPath, std::string("\x1F\x8B\x08\x00", 4));
+    LogFollower compressed;
+    EXPECT_FALSE(compressed.Start(gzipPath));
+    EXPECT_FALSE(compressed.IsRunning());
+    EXPECT_FALSE(compressed.Start(TempPath("missing.csv")));
+}
+
+// 差分の適用は同じ表に行が追加された場合だけで、同じアドレスに作り直された表や複製には適用しないこと
+TEST(TableDeltaCursorTest, KeysOnTableIdentity) {
+    std::optional<CSVData> table;
+    table.emplace();
+    FillTable(*table, { "a" }, { { "1" } });
+    const CSVData* address = &*table;
+    TableDeltaCursor cursor;
+    EXPECT_FALSE(cursor.CanApplyDelta(*table, "s"));
+    cursor.MarkProcessed(*table, "s");
+    table->AddRow({ "2" });
+    EXPECT_TRUE(cursor.HasPendingRows(*table, "s"));
+    EXPECT_FALSE(cursor.CanApplyDelta(*table, "other settings"));
+
+    const CSVData copy = *table;
+    EXPECT_NE(table->GetTableId(), copy.GetTableId());
+    EXPECT_FALSE(cursor.CanApplyDelta(copy, "s"));
+
+    // 破棄した表と同じアドレスに、版数も同じ新しい表を作る
+    table.reset();
+    table.emplace();
+    FillTable(*table, { "a" }, { { "1" }, { "2" } });
+    ASSERT_EQ(address, &*table);
+    EXPECT_FALSE(cursor.CanApplyDelta(*table, "s"));
+
+    cursor.MarkProcessed(*table, "s");
+    EXPECT_TRUE(cursor.CanApplyDelta(*table, "s"));
+    cursor.Reset();
+    EXPECT_FALSE(cursor.CanApplyDelta(*table, "s"));
+}
+
+} // namespace Testing
+} // namespace NSys
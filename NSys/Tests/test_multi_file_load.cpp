@@ -0,0 +1,99 @@
+#include "test_csv_common.h"
+#include "MultiFileLoad.h"
+
+namespace NSys {
+namespace Testing {
+
+// ==================== MultiFileLoad ====================
+
+class MultiFileLoadTest : public CsvEngineTestBase {
+protected:
+    void SetUp() override {
+        CsvEngineTestBase::SetUp();
+        // 列の並び・有無・型が年ごとに異なるファイル（2026 年だけ統合後と同じ並び）
+        WriteTextFile(TempPath("sales_2023.csv"), "id,amount,code\n1,10,7\n2,20,8\n");
+        WriteTextFile(TempPath("sales_2024.csv"), "id,amount,region\r\n3,1.5,east\r\n");
+        WriteTextFile(TempPath("sales_2025.csv"), "amount,id,code\n2.5,4,A1\n");
+        WriteTextFile(TempPath("sales_2026.csv"), "id,amount,code,region\n5,6,7,west\n");
+        WriteTextFile(TempPath("notes.txt"), "not,a,table\n");
+    }
+};
+
+// 列名で統合し、型は 整数 → 実数 → 文字列 の順に広げ、無い列は空にすること
+TEST_F(MultiFileLoadTest, WidensSchemaByColumnName) {
+    MultiFileOptions options;
+    options.virtualSource = VirtualColumnSource::PartitionValue;
+    options.virtualColumn = "year";
+    CSVData data;
+    MultiFileLoadResult result;
+    ASSERT_TRUE(LoadMultipleFiles(TempPath("sales_*.csv"), options, data, &result));
+
+    EXPECT_EQ(4u, result.matchedFiles);
+    EXPECT_EQ(0u, result.prunedFiles);
+    EXPECT_EQ(4u, result.loadedFiles.size());
+    EXPECT_TRUE(result.failedFiles.empty());
+    EXPECT_EQ(3u, result.remappedFiles);
+
+    EXPECT_EQ((std::vector<std::string>{ "id", "amount", "code", "region", "year" }), data.GetHeaders());
+    ASSERT_EQ(5u, result.columns.size());
+    const std::vector<std::pair<ReconciledType, size_t>> expected = {
+        { ReconciledType::Integer, 4 }, { ReconciledType::Real, 4 }, { ReconciledType::Text, 3 },
+        { ReconciledType::Text, 2 }, { ReconciledType::Text, 4 } };
+    for (size_t c = 0; c < expected.size(); ++c) {
+        EXPECT_EQ(expected[c].first, result.columns[c].type) << result.columns[c].name;
+        EXPECT_EQ(expected[c].second, result.columns[c].fileCount) << result.columns[c].name;
+    }
+
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "1", "10", "7", "", "2023" },
+        { "2", "20", "8", "", "2023" },
+        { "3", "1.5", "", "east", "2024" },
+        { "4", "2.5", "A1", "", "2025" },
+        { "5", "6", "7", "west", "2026" } }), ToRows(data));
+}
+
+// 仮想列の条件に一致しないファイルは解析せずに除外すること
+TEST_F(MultiFileLoadTest, PrunesFilesByVirtualColumn) {
+    MultiFileOptions options;
+    options.virtualSource = VirtualColumnSource::PartitionValue;
+    options.partitionFilters.push_back({ "_partition", ">=", "2025" });
+    options.partitionFilters.push_back({ "id", "==", "1" });   // 仮想列以外の条件はファイルの除外に使わない
+    CSVData data;
+    MultiFileLoadResult result;
+    ASSERT_TRUE(LoadMultipleFiles(TempPath("sales_*.csv"), options, data, &result));
+
+    EXPECT_EQ(4u, result.matchedFiles);
+    EXPECT_EQ(2u, result.prunedFiles);
+    EXPECT_EQ((std::vector<std::string>{ TempPath("sales_2025.csv"), TempPath("sales_2026.csv") }), result.loadedFiles);
+    EXPECT_EQ((std::vector<std::string>{ "amount", "id", "code", "region", "_partition" }), data.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "2.5", "4", "A1", "", "2025" },
+        { "6", "5", "7", "west", "2026" } }), ToRows(data));
+
+    // すべて除外されたら失敗にする
+    options.partitionFilters = { { "_partition", "==", "1999" } };
+    EXPECT_FALSE(LoadMultipleFiles(TempPath("sales_*.csv"), options, data, &result));
+    EXPECT_EQ(4u, result.prunedFiles);
+}
+
+// ディレクトリ指定は直下の CSV だけを対象にし、ファイル名を仮想列にできること
+TEST_F(MultiFileLoadTest, DirectoryAndFileNameColumn) {
+    std::vector<std::string> files;
+    std::vector<std::string> partitions;
+    ASSERT_TRUE(ExpandFilePattern(testDir.string(), files, &partitions));
+    EXPECT_EQ(4u, files.size());
+    EXPECT_EQ((std::vector<std::string>{ "sales_2023", "sales_2024", "sales_2025", "sales_2026" }), partitions);
+    EXPECT_TRUE(IsMultiFilePattern(testDir.string()));
+    EXPECT_FALSE(IsMultiFilePattern(TempPath("sales_2023.csv")));
+
+    MultiFileOptions options;
+    options.virtualSource = VirtualColumnSource::FileName;
+    options.virtualColumn = "file";
+    options.partitionFilters.push_back({ "file", "contains", "2024" });
+    CSVData data;
+    ASSERT_TRUE(LoadMultipleFiles(testDir.string(), options, data));
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "3", "1.5", "east", "sales_2024.csv" } }), ToRows(data));
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,78 @@
+#include "test_csv_common.h"
+#include "Reshape.h"
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Pivot ====================
+
+// first は空の値も最初の値として残し、後から現れた値で上書きしないこと
+TEST(PivotTest, FirstKeepsEmptyFirstValue) {
+    CSVData data;
+    FillTable(data, { "id", "key", "value" }, {
+        { "1", "a", "" }, { "1", "a", "late" }, { "1", "b", "x" }, { "2", "b", "" }, { "2", "a", "y" }, { "2", "b", "z" } });
+
+    PivotSpec spec;
+    spec.indexColumns = { "id" };
+    spec.pivotColumn = "key";
+    spec.valueColumn = "value";
+    CSVData output;
+    ASSERT_TRUE(ComputePivot(data, spec, output));
+    EXPECT_EQ((std::vector<std::string>{ "id", "a", "b" }), output.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "", "x" }, { "2", "y", "" } }), ToRows(output));
+}
+
+// 集計の種類ごとの値と、インデックス列名と重なるピボット値の列名の区別
+TEST(PivotTest, AggregatesAndDistinctHeaders) {
+    CSVData data;
+    FillTable(data, { "id", "key", "value" }, {
+        { "1", "id", "2" }, { "1", "id", "4" }, { "1", "id_key", "7" }, { "2", "n", "x" }, { "2", "n", "1.5" } });
+
+    PivotSpec spec;
+    spec.indexColumns = { "id" };
+    spec.pivotColumn = "key";
+    spec.valueColumn = "value";
+    CSVData output;
+
+    spec.aggregate = "sum";
+    ASSERT_TRUE(ComputePivot(data, spec, output));
+    EXPECT_EQ((std::vector<std::string>{ "id", "id_key_key", "id_key", "n" }), output.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "6", "7", "" }, { "2", "", "", "1.5" } }), ToRows(output));
+
+    spec.aggregate = "count";
+    ASSERT_TRUE(ComputePivot(data, spec, output));
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "2", "1", "0" }, { "2", "0", "0", "2" } }), ToRows(output));
+
+    spec.aggregate = "mean";
+    ASSERT_TRUE(ComputePivot(data, spec, output));
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "3", "7", "" }, { "2", "", "", "1.5" } }), ToRows(output));
+
+    spec.aggregate = "median";
+    EXPECT_FALSE(ComputePivot(data, spec, output));
+}
+
+// ==================== Unpivot ====================
+
+// 入力のセルを複写せずに縦持ちにし、入力を変更・破棄しても出力は変わらないこと
+TEST(UnpivotTest, SharesInputCells) {
+    auto data = std::make_unique<CSVData>();
+    FillTable(*data, { "id", "x", "y" }, { { "1", "10", "" }, { "2" }, { "3", "30", "31" } });
+
+    UnpivotSpec spec;
+    spec.idColumns = { "id" };
+    CSVData output;
+    ASSERT_TRUE(ComputeUnpivot(*data, spec, output));
+    const std::vector<std::vector<std::string>> expected = {
+        { "1", "x", "10" }, { "1", "y", "" }, { "2", "x", "" }, { "2", "y", "" }, { "3", "x", "30" }, { "3", "y", "31" } };
+    EXPECT_EQ((std::vector<std::string>{ "id", "variable", "value" }), output.GetHeaders());
+    EXPECT_EQ(expected, ToRows(output));
+    EXPECT_EQ(data->GetCell(2, 2).data(), output.GetCell(5, 2).data()) << "value cells point into the input arena";
+
+    data->SetCell(0, 1, "changed");
+    data->AddRow({ "4", "40", "41" });
+    data.reset();
+    EXPECT_EQ(expected, ToRows(output));
+}
+
+} // namespace Testing
+} // namespace NSys
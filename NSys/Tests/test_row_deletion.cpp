@@ -0,0 +1,200 @@
+#include "test_csv_common.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Row Deletion ====================
+
+class RowDeletionTest : public ::testing::Test {
+protected:
+    // id 列に行番号を持つ表をセル参照から直接組み立てる（大きな表でも AddRow を繰り返さずに済む）
+    static CSVData MakeTable(size_t rowCount) {
+        std::vector<CellBlock> blocks(1);
+        const CellRef filler = blocks[0].arena.Append("x");
+        blocks[0].cells.reserve(rowCount * 2);
+        for (size_t r = 0; r < rowCount; ++r) {
+            blocks[0].cells.push_back(blocks[0].arena.Append(std::to_string(r)));
+            blocks[0].cells.push_back(filler);
+        }
+        CSVData data;
+        data.SetHeaders({ "id", "v" });
+        data.SetCellBlocks(std::move(blocks), 2);
+        return data;
+    }
+
+    static std::vector<std::string> Ids(const CSVData& data) {
+        std::vector<std::string> ids;
+        ids.reserve(data.GetRowCount());
+        for (const CSVRow& row : data.GetRows()) {
+            ids.emplace_back(row[0]);
+        }
+        return ids;
+    }
+
+    // vector::erase で同じ削除を行う参照モデル
+    static void EraseFromModel(std::vector<std::string>& model, const std::vector<uint32_t>& rowIndices) {
+        std::vector<char> drop(model.size(), 0);
+        for (uint32_t row : rowIndices) {
+            if (row < model.size()) {
+                drop[row] = 1;
+            }
+        }
+        size_t kept = 0;
+        for (size_t r = 0; r < model.size(); ++r) {
+            if (!drop[r]) {
+                if (kept != r) {
+                    model[kept] = std::move(model[r]);
+                }
+                ++kept;
+            }
+        }
+        model.resize(kept);
+    }
+};
+
+// 順序・重複・範囲外を含む削除を繰り返しても、参照モデルと同じ行が残り、元に戻せること
+TEST_F(RowDeletionTest, RandomBatchesMatchModel) {
+    std::mt19937 random(3);
+    for (int trial = 0; trial < 20; ++trial) {
+        const size_t rowCount = 1 + random() % 30000;
+        CSVData data = MakeTable(rowCount);
+        data.EnableHistory();
+        std::vector<std::string> model = Ids(data);
+
+        for (int step = 0; step < 8 && !model.empty(); ++step) {
+            std::vector<uint32_t> rowIndices;
+            const size_t count = random() % 4 == 0 ? random() % (model.size() + 5) : random() % 50;
+            const bool clustered = random() % 2 == 0;
+            const size_t base = random() % model.size();
+            for (size_t i = 0; i < count; ++i) {
+                rowIndices.push_back(static_cast<uint32_t>(clustered ? base + i : random() % (model.size() + 10)));
+            }
+            data.RemoveRows(rowIndices);
+            EraseFromModel(model, rowIndices);
+            ASSERT_EQ(model, Ids(data)) << "trial " << trial << " step " << step;
+        }
+
+        while (data.CanUndo()) {
+            data.Undo();
+        }
+        EXPECT_EQ(rowCount, data.GetRowCount());
+        EXPECT_EQ("0", data.GetCell(0, 0));
+        EXPECT_EQ(std::to_string(rowCount - 1), data.GetCell(rowCount - 1, 0));
+    }
+}
+
+// 小さな削除を繰り返して断片化しても、詰め直した後の行と元に戻した行が正しいこと
+TEST_F(RowDeletionTest, RepeatedSmallBatchesCompact) {
+    CSVData data = MakeTable(200000);
+    data.EnableHistory();
+    std::vector<std::string> model = Ids(data);
+    std::mt19937 random(11);
+
+    for (int step = 0; step < 300; ++step) {
+        std::vector<uint32_t> rowIndices;
+        const uint32_t base = static_cast<uint32_t>(random() % (model.size() - 400));
+        for (uint32_t i = 0; i < 40; ++i) {
+            rowIndices.push_back(base + i * 7);
+        }
+        data.RemoveRows(rowIndices);
+        EraseFromModel(model, rowIndices);
+        if (step % 50 == 0) {
+            data.AddRow(std::vector<std::string>{ "a" + std::to_string(step), "x" });
+            model.push_back("a" + std::to_string(step));
+        }
+    }
+    EXPECT_EQ(model, Ids(data));
+
+    while (data.CanUndo()) {
+        data.Undo();
+    }
+    EXPECT_EQ(200000u, data.GetRowCount());
+}
+
+// 一括削除は、同じ行を後ろから 1 行ずつ削除した結果と同じ行を残すこと
+TEST_F(RowDeletionTest, BatchedMatchesRowByRow) {
+    const CSVData original = MakeTable(100000);
+    std::vector<uint32_t> rowIndices;
+    std::mt19937 random(9);
+    for (int i = 0; i < 2000; ++i) {
+        rowIndices.push_back(static_cast<uint32_t>(random() % original.GetRowCount()));
+    }
+
+    CSVData batched = original;
+    batched.RemoveRows(rowIndices);
+
+    CSVData single = original;
+    std::vector<uint32_t> descending = rowIndices;
+    std::sort(descending.rbegin(), descending.rend());
+    descending.erase(std::unique(descending.begin(), descending.end()), descending.end());
+    for (uint32_t row : descending) {
+        single.RemoveRow(row);
+    }
+    EXPECT_EQ(Ids(single), Ids(batched));
+}
+
+// 1000 万行から 10 万行を削除する: 一括削除は vector::erase による削除よりはるかに速いこと（既定では実行しない）
+TEST_F(RowDeletionTest, DISABLED_Timing_Delete100kOf10M) {
+    const size_t rowCount = 10000000;
+    const CSVData original = MakeTable(rowCount);
+
+    std::vector<uint32_t> rowIndices;
+    std::vector<char> chosen(rowCount, 0);
+    std::mt19937 random(5);
+    while (rowIndices.size() < 100000) {
+        const uint32_t row = static_cast<uint32_t>(random() % rowCount);
+        if (!chosen[row]) {
+            chosen[row] = 1;
+            rowIndices.push_back(row);
+        }
+    }
+
+    CSVData batched = original;
+    const double batchedTime = MeasureMilliseconds([&]() { batched.RemoveRows(rowIndices); });
+
+    // 1 行ずつ削除する経路（後ろから消して番号をずらさない）
+    CSVData single = original;
+    std::vector<uint32_t> descending = rowIndices;
+    std::sort(descending.rbegin(), descending.rend());
+    const double singleTime = MeasureMilliseconds([&]() {
+        for (uint32_t row : descending) {
+            single.RemoveRow(row);
+        }
+    });
+
+    // 以前の vector::erase による削除（行ごとに後ろを詰めるため O(n) かかる）は、50 回分を測って 10 万回分に換算する
+    std::vector<uint64_t> flatRows(rowCount);
+    for (size_t r = 0; r < rowCount; ++r) {
+        flatRows[r] = r;
+    }
+    const size_t eraseSamples = 50;
+    const double eraseTime = MeasureMilliseconds([&]() {
+        for (size_t i = 0; i < eraseSamples; ++i) {
+            flatRows.erase(flatRows.begin() + std::min<size_t>(rowIndices[i], flatRows.size() - 1));
+        }
+    }) * static_cast<double>(rowIndices.size() / eraseSamples);
+
+    size_t checksum = 0;
+    const double scanTime = MeasureMilliseconds([&]() {
+        for (const CSVRow& row : batched.GetRows()) {
+            checksum += row[0].size();
+        }
+    });
+
+    ASSERT_EQ(rowCount - rowIndices.size(), batched.GetRowCount());
+    EXPECT_EQ(single.GetRowCount(), batched.GetRowCount());
+    for (size_t r = 0; r < batched.GetRowCount(); r += 9973) {
+        EXPECT_EQ(single.GetCell(r, 0), batched.GetCell(r, 0));
+    }
+    EXPECT_GT(checksum, 0u);
+    std::printf("[ timing   ] 1000万行から10万行を削除: RemoveRows %.1f ms, RemoveRow x 10万 %.1f ms, "
+        "vector::erase x 10万 (換算) %.0f ms, 削除後の走査 %.1f ms\n", batchedTime, singleTime, eraseTime, scanTime);
+    EXPECT_LT(batchedTime, singleTime * 1.5) << "batched deletion should not fall behind deleting row by row";
+    EXPECT_LT(batchedTime * 100.0, eraseTime) << "batched deletion should be far ahead of vector::erase";
+}
+
+} // namespace Testing
+} // namespace NSys
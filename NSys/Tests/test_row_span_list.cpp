@@ -0,0 +1,195 @@
+#include "test_csv_common.h"
+#include "RowStorage.h"
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== RowSpanList ====================
+
+class RowSpanListTest : public ::testing::Test {
+protected:
+    // 行の識別に cellCount を使う（cells は参照しない）
+    static RowSpan Span(uint32_t id) {
+        return RowSpan{ nullptr, id };
+    }
+
+    // 添字・Locate による順の走査・ToVector のどれで読んでも model と同じ並びであること
+    static void ExpectSame(const std::vector<uint32_t>& model, const RowSpanList& list, const std::string& where) {
+        ASSERT_EQ(model.size(), list.size()) << where;
+        std::vector<uint32_t> indexed(list.size());
+        for (size_t r = 0; r < list.size(); ++r) {
+            indexed[r] = list[r].cellCount;
+        }
+        ASSERT_EQ(model, indexed) << where;
+
+        std::vector<uint32_t> scanned;
+        scanned.reserve(list.size());
+        for (size_t r = 0; r < list.size(); ) {
+            const RowSpan* runEnd = nullptr;
+            for (const RowSpan* span = list.Locate(r, runEnd); span != runEnd; ++span, ++r) {
+                scanned.push_back(span->cellCount);
+            }
+        }
+        ASSERT_EQ(model, scanned) << where;
+
+        const std::vector<RowSpan> spans = list.ToVector();
+        ASSERT_EQ(model.size(), spans.size()) << where;
+        for (size_t r = 0; r < spans.size(); ++r) {
+            ASSERT_EQ(model[r], spans[r].cellCount) << where << " row " << r;
+        }
+    }
+
+    static RowSpanList Generate(size_t count, std::vector<uint32_t>& model) {
+        RowSpanList list;
+        list.Generate(count, [](size_t i) { return Span(static_cast<uint32_t>(i)); });
+        model.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            model[i] = static_cast<uint32_t>(i);
+        }
+        return list;
+    }
+
+    // 無作為に選んだ行をまとめて取り除く（model からも同じ行を取り除く）
+    static void EraseRandomMarked(RowSpanList& list, std::vector<uint32_t>& model, std::mt19937& random, size_t oneIn) {
+        std::vector<uint64_t> mask((model.size() + 63) / 64, 0);
+        std::vector<uint32_t> kept;
+        kept.reserve(model.size());
+        const bool clustered = random() % 2 == 0;
+        const size_t clusterBegin = model.empty() ? 0 : random() % model.size();
+        for (size_t r = 0; r < model.size(); ++r) {
+            const bool drop = clustered ? r >= clusterBegin && r < clusterBegin + model.size() / oneIn : random() % oneIn == 0;
+            if (drop) {
+                mask[r / 64] |= uint64_t(1) << (r % 64);
+            } else {
+                kept.push_back(model[r]);
+            }
+        }
+        list.EraseMarked(mask);
+        model.swap(kept);
+    }
+};
+
+// 空の並びへの追加・挿入・削除・置き換えを繰り返しても vector と同じ並びになること
+TEST_F(RowSpanListTest, RandomEditsMatchVector) {
+    std::mt19937 random(7);
+    RowSpanList list;
+    std::vector<uint32_t> model;
+    uint32_t nextId = 0;
+
+    for (int step = 0; step < 40000; ++step) {
+        const uint32_t op = random() % 10;
+        if (op < 3 || model.empty()) {
+            list.push_back(Span(nextId));
+            model.push_back(nextId++);
+        } else if (op < 6) {
+            const size_t row = random() % (model.size() + 1);
+            list.insert(row, Span(nextId));
+            model.insert(model.begin() + row, nextId++);
+        } else if (op < 9) {
+            const size_t row = random() % model.size();
+            list.erase(row);
+            model.erase(model.begin() + row);
+        } else {
+            const size_t row = random() % model.size();
+            list.set(row, Span(nextId));
+            model[row] = nextId++;
+        }
+        if (step % 2000 == 0) {
+            ExpectSame(model, list, "step " + std::to_string(step));
+        }
+    }
+    ExpectSame(model, list, "end");
+
+    while (!model.empty()) {
+        const size_t row = random() % model.size();
+        list.erase(row);
+        model.erase(model.begin() + row);
+    }
+    EXPECT_TRUE(list.empty());
+    list.push_back(Span(1));
+    ExpectSame({ 1 }, list, "after emptying");
+}
+
+// 内部ノードが 2 段以上ある大きな並びで、挿入・削除・まとめての削除・詰め直しが vector と同じ並びになること
+TEST_F(RowSpanListTest, DeepTreeEditsMatchVector) {
+    std::mt19937 random(13);
+    std::vector<uint32_t> model;
+    RowSpanList list = Generate(RowSpanList::chunkRows * RowSpanList::nodeFanout * 2 + 123, model);
+    ExpectSame(model, list, "generated");
+    uint32_t nextId = static_cast<uint32_t>(model.size());
+
+    for (int round = 0; round < 6; ++round) {
+        for (int step = 0; step < 300; ++step) {
+            if (random() % 2 == 0) {
+                const size_t row = random() % (model.size() + 1);
+                list.insert(row, Span(nextId));
+                model.insert(model.begin() + row, nextId++);
+            } else {
+                const size_t row = random() % model.size();
+                list.erase(row);
+                model.erase(model.begin() + row);
+            }
+        }
+        ExpectSame(model, list, "edits round " + std::to_string(round));
+
+        EraseRandomMarked(list, model, random, round % 2 == 0 ? 3 : 200);
+        ExpectSame(model, list, "marked round " + std::to_string(round));
+
+        if (list.IsFragmented() || round == 3) {
+            list.Compact();
+            EXPECT_FALSE(list.IsFragmented());
+            ExpectSame(model, list, "compacted round " + std::to_string(round));
+        }
+    }
+
+    // すべてを印付けして取り除くと空になる
+    list.EraseMarked(std::vector<uint64_t>((model.size() + 63) / 64, ~uint64_t(0)));
+    EXPECT_TRUE(list.empty());
+}
+
+// 複製は変更を共有せず、どちらを変更しても他方は元の並びのままであること
+TEST_F(RowSpanListTest, CopiesAreIndependent) {
+    std::mt19937 random(21);
+    std::vector<uint32_t> model;
+    RowSpanList list = Generate(RowSpanList::chunkRows * 5 + 17, model);
+    uint32_t nextId = static_cast<uint32_t>(model.size());
+
+    std::vector<std::pair<RowSpanList, std::vector<uint32_t>>> snapshots;
+    for (int step = 0; step < 60; ++step) {
+        snapshots.emplace_back(list, model);
+        switch (step % 4) {
+        case 0: {
+            const size_t row = random() % (model.size() + 1);
+            list.insert(row, Span(nextId));
+            model.insert(model.begin() + row, nextId++);
+            break;
+        }
+        case 1: {
+            const size_t row = random() % model.size();
+            list.erase(row);
+            model.erase(model.begin() + row);
+            break;
+        }
+        case 2:
+            EraseRandomMarked(list, model, random, 50);
+            break;
+        default:
+            list.push_back(Span(nextId));
+            model.push_back(nextId++);
+            break;
+        }
+        // 複製側にも追記して、共有しているチャンクの追記先が分かれることを確かめる
+        RowSpanList& copy = snapshots.back().first;
+        copy.push_back(Span(0xFFFFFFFFu));
+        snapshots.back().second.push_back(0xFFFFFFFFu);
+        EXPECT_GT(list.GetBytesNotSharedWith(copy), 0u);
+    }
+    ExpectSame(model, list, "edited");
+    for (size_t i = 0; i < snapshots.size(); ++i) {
+        ExpectSame(snapshots[i].second, snapshots[i].first, "snapshot " + std::to_string(i));
+    }
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,147 @@
+#include "test_csv_common.h"
+#include "Sampling.h"
+#include <map>
+#include <sstream>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Sampling ====================
+
+class SamplingTest : public CsvEngineTestBase {
+protected:
+    // 層の大きさを並べた順に、各層の行を交互に混ぜた表を作る（列: id, group）
+    static void FillStrata(CSVData& data, const std::vector<size_t>& sizes) {
+        data.SetHeaders({ "id", "group" });
+        std::vector<size_t> emitted(sizes.size(), 0);
+        size_t id = 0;
+        for (bool more = true; more;) {
+            more = false;
+            for (size_t g = 0; g < sizes.size(); ++g) {
+                if (emitted[g] < sizes[g]) {
+                    data.AddRow(std::vector<std::string>{ std::to_string(id++), "g" + std::to_string(g) });
+                    ++emitted[g];
+                    more = true;
+                }
+            }
+        }
+    }
+
+    static std::map<std::string, size_t> CountByGroup(const CSVData& data) {
+        std::map<std::string, size_t> counts;
+        for (size_t r = 0; r < data.GetRowCount(); ++r) {
+            ++counts[std::string(data.GetCell(r, 1))];
+        }
+        return counts;
+    }
+
+    static SampleSpec Stratified(size_t sampleSize, bool perStratum = false) {
+        SampleSpec spec;
+        spec.sampleSize = sampleSize;
+        spec.seed = 7;
+        spec.stratifyColumn = "group";
+        spec.perStratum = perStratum;
+        return spec;
+    }
+};
+
+// 層が標本サイズより多くても、比例割り当ての合計は標本サイズちょうどになること
+TEST_F(SamplingTest, ManyStrataStillYieldSampleSize) {
+    CSVData input;
+    FillStrata(input, std::vector<size_t>(1000, 10));
+
+    CSVData output;
+    ASSERT_TRUE(SampleRows(input, Stratified(100), output));
+    EXPECT_EQ(100u, output.GetRowCount());
+    for (const auto& count : CountByGroup(output)) {
+        EXPECT_EQ(1u, count.second) << count.first;
+    }
+}
+
+// 割り当ては層の大きさに比例し、合計は標本サイズに一致すること
+TEST_F(SamplingTest, QuotasAreProportionalAndSumExactly) {
+    CSVData input;
+    FillStrata(input, { 9000, 900, 100 });
+
+    CSVData output;
+    ASSERT_TRUE(SampleRows(input, Stratified(1000), output));
+    EXPECT_EQ(1000u, output.GetRowCount());
+    const auto counts = CountByGroup(output);
+    EXPECT_EQ(900u, counts.at("g0"));
+    EXPECT_EQ(90u, counts.at("g1"));
+    EXPECT_EQ(10u, counts.at("g2"));
+
+    // 端数が出る割り当てでも合計は変わらない
+    for (size_t sampleSize : { 7u, 33u, 101u, 999u }) {
+        ASSERT_TRUE(SampleRows(input, Stratified(sampleSize), output));
+        EXPECT_EQ(sampleSize, output.GetRowCount());
+    }
+}
+
+// 層が標本サイズに収まる場合は、小さな層からも 1 行以上を抽出すること
+TEST_F(SamplingTest, EveryStratumRepresentedWhenStrataFit) {
+    std::vector<size_t> sizes(20, 1);
+    sizes.insert(sizes.begin(), 50000);
+    CSVData input;
+    FillStrata(input, sizes);
+
+    CSVData output;
+    ASSERT_TRUE(SampleRows(input, Stratified(50), output));
+    EXPECT_EQ(50u, output.GetRowCount());
+    const auto counts = CountByGroup(output);
+    EXPECT_EQ(sizes.size(), counts.size());
+    EXPECT_EQ(30u, counts.at("g0"));
+}
+
+// 各層抽出では層ごとに min(層の大きさ, 標本サイズ) 行を抽出すること
+TEST_F(SamplingTest, PerStratumTakesSampleSizeFromEachStratum) {
+    CSVData input;
+    FillStrata(input, { 500, 40, 3 });
+
+    CSVData output;
+    ASSERT_TRUE(SampleRows(input, Stratified(50, true), output));
+    const auto counts = CountByGroup(output);
+    EXPECT_EQ(50u, counts.at("g0"));
+    EXPECT_EQ(40u, counts.at("g1"));
+    EXPECT_EQ(3u, counts.at("g2"));
+}
+
+// 同じシードからは同じ標本を元の行順で得ること
+TEST_F(SamplingTest, DeterministicAndInSourceOrder) {
+    CSVData input;
+    FillStrata(input, { 3000, 700, 300, 20 });
+
+    CSVData first;
+    CSVData second;
+    ASSERT_TRUE(SampleRows(input, Stratified(200), first));
+    ASSERT_TRUE(SampleRows(input, Stratified(200), second));
+    EXPECT_EQ(ToRows(first), ToRows(second));
+    for (size_t r = 1; r < first.GetRowCount(); ++r) {
+        EXPECT_LT(std::stoul(std::string(first.GetCell(r - 1, 0))), std::stoul(std::string(first.GetCell(r, 0))));
+    }
+}
+
+// ファイルからの抽出は、同じ内容の表からの抽出と同じ行を返すこと
+TEST_F(SamplingTest, LoadSampledFileMatchesSampleRows) {
+    CSVData input;
+    FillStrata(input, std::vector<size_t>(300, 7));
+    std::ostringstream csv;
+    csv << "id,group\n";
+    for (size_t r = 0; r < input.GetRowCount(); ++r) {
+        csv << input.GetCell(r, 0) << "," << input.GetCell(r, 1) << "\n";
+    }
+    const std::string path = TempPath("sample.csv");
+    WriteTextFile(path, csv.str());
+
+    for (const SampleSpec& spec : { Stratified(100), Stratified(500), Stratified(5, true) }) {
+        CSVData fromTable;
+        CSVData fromFile;
+        ASSERT_TRUE(SampleRows(input, spec, fromTable));
+        ASSERT_TRUE(LoadSampledFile(path, spec, fromFile));
+        EXPECT_EQ(fromTable.GetHeaders(), fromFile.GetHeaders());
+        EXPECT_EQ(ToRows(fromTable), ToRows(fromFile));
+    }
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,200 @@
+#include "test_csv_common.h"
+#include "SqlQuery.h"
+#include <algorithm>
+#include <map>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== SqlQuery ====================
+
+class SqlQueryTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        const char* const regions[] = { "east", "west", "north", "south" };
+        customers.SetHeaders({ "id", "name", "region" });
+        for (int c = 0; c < 300; ++c) {
+            customers.AddRow(std::vector<std::string>{ std::to_string(c), "customer" + std::to_string(c), regions[c % 4] });
+        }
+
+        // 注文の無い顧客（id 250 以上）と、顧客の無い注文・顧客が空の注文を含む
+        std::mt19937 random(17);
+        orders.SetHeaders({ "id", "customer", "amount" });
+        for (int o = 0; o < 5000; ++o) {
+            const uint32_t pick = random() % 270;
+            const std::string customer = pick >= 260 ? std::string() : std::to_string(pick < 250 ? pick : pick + 1000);
+            orders.AddRow(std::vector<std::string>{ std::to_string(o), customer, std::to_string(random() % 1000) });
+        }
+    }
+
+    bool Run(const std::string& query, CSVData& output, SqlQueryStats* stats = nullptr) {
+        std::string error;
+        const bool ok = ExecuteSqlQuery(query, { { "orders", &orders }, { "customers", &customers } }, output, error, stats);
+        EXPECT_TRUE(ok) << query << ": " << error;
+        return ok;
+    }
+
+    static std::vector<std::vector<std::string>> Sorted(std::vector<std::vector<std::string>> rows) {
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    }
+
+    // 計画の行のうち prefix で始まる最初の行の深さ（字下げ 2 文字で 1 段。見つからなければ -1）
+    static int PlanDepth(const SqlQueryStats& stats, const std::string& prefix) {
+        for (const std::string& line : stats.plan) {
+            const size_t indent = line.find_first_not_of(' ');
+            if (indent != std::string::npos && line.compare(indent, prefix.size(), prefix) == 0) {
+                return static_cast<int>(indent / 2);
+            }
+        }
+        return -1;
+    }
+
+    CSVData customers;
+    CSVData orders;
+};
+
+// 条件付きの内部結合は、行の組ごとに条件を確かめた結果と同じ行を返し、単一表の条件を結合の前に評価すること
+TEST_F(SqlQueryTest, FilteredJoinMatchesManualResult) {
+    CSVData output;
+    SqlQueryStats stats;
+    ASSERT_TRUE(Run("SELECT o.id, c.name, o.amount FROM orders o JOIN customers c ON o.customer = c.id "
+        "WHERE o.amount >= 500 AND c.region = 'east'", output, &stats));
+
+    std::vector<std::vector<std::string>> expected;
+    for (size_t o = 0; o < orders.GetRowCount(); ++o) {
+        for (size_t c = 0; c < customers.GetRowCount(); ++c) {
+            if (!orders.GetCell(o, 1).empty() && orders.GetCell(o, 1) == customers.GetCell(c, 0)
+                && std::stoi(std::string(orders.GetCell(o, 2))) >= 500 && customers.GetCell(c, 2) == "east") {
+                expected.push_back({ std::string(orders.GetCell(o, 0)), std::string(customers.GetCell(c, 1)),
+                    std::string(orders.GetCell(o, 2)) });
+            }
+        }
+    }
+    ASSERT_FALSE(expected.empty());
+    EXPECT_EQ(Sorted(expected), Sorted(ToRows(output)));
+    EXPECT_EQ(expected.size(), stats.outputRows);
+
+    const int join = PlanDepth(stats, "ハッシュ結合 inner");
+    ASSERT_GE(join, 0);
+    EXPECT_GT(PlanDepth(stats, "選択 o.amount"), join) << "predicates on one table are evaluated before the join";
+    EXPECT_GT(PlanDepth(stats, "選択 c.region"), join);
+    EXPECT_GT(PlanDepth(stats, "列の刈り込み"), join) << "unused columns are dropped before the join";
+
+    // カンマ区切りの FROM と WHERE の結合条件でも同じ結果になる
+    CSVData comma;
+    ASSERT_TRUE(Run("SELECT orders.id, customers.name, orders.amount FROM customers, orders "
+        "WHERE customers.region = 'east' AND orders.customer = customers.id AND orders.amount >= 500", comma));
+    EXPECT_EQ(Sorted(expected), Sorted(ToRows(comma)));
+}
+
+// 外部結合で NULL が補われる側の WHERE 条件は結合の後で評価し、注文の無い顧客だけを返すこと
+TEST_F(SqlQueryTest, OuterJoinKeepsNullSideConditionAboveJoin) {
+    CSVData output;
+    SqlQueryStats stats;
+    ASSERT_TRUE(Run("SELECT c.id FROM customers c LEFT JOIN orders o ON c.id = o.customer WHERE o.id IS NULL", output, &stats));
+
+    std::vector<std::vector<std::string>> expected;
+    for (size_t c = 0; c < customers.GetRowCount(); ++c) {
+        bool hasOrder = false;
+        for (size_t o = 0; o < orders.GetRowCount() && !hasOrder; ++o) {
+            hasOrder = orders.GetCell(o, 1) == customers.GetCell(c, 0);
+        }
+        if (!hasOrder) {
+            expected.push_back({ std::string(customers.GetCell(c, 0)) });
+        }
+    }
+    EXPECT_EQ(50u, expected.size());
+    EXPECT_EQ(Sorted(expected), Sorted(ToRows(output)));
+
+    const int join = PlanDepth(stats, "ハッシュ結合");
+    ASSERT_GE(join, 0);
+    EXPECT_LT(PlanDepth(stats, "選択 o.id"), join);
+
+    // 顧客の無い注文は FULL OUTER JOIN で右側だけの行として残る
+    CSVData full;
+    ASSERT_TRUE(Run("SELECT o.id FROM customers c FULL OUTER JOIN orders o ON c.id = o.customer WHERE c.id IS NULL", full));
+    size_t orphans = 0;
+    for (size_t o = 0; o < orders.GetRowCount(); ++o) {
+        const std::string customer(orders.GetCell(o, 1));
+        orphans += customer.empty() || std::stoi(customer) >= 300 ? 1 : 0;
+    }
+    EXPECT_EQ(orphans, full.GetRowCount());
+}
+
+// GROUP BY の集計は、行を数えて足し合わせた結果と一致すること
+TEST_F(SqlQueryTest, GroupByAggregatesMatchManualResult) {
+    CSVData output;
+    ASSERT_TRUE(Run("SELECT c.region, COUNT(*) AS orders, SUM(o.amount) AS total, MIN(o.amount), MAX(o.amount) "
+        "FROM orders o JOIN customers c ON o.customer = c.id GROUP BY c.region ORDER BY total DESC", output));
+    EXPECT_EQ((std::vector<std::string>{ "region", "orders", "total", "MIN(o.amount)", "MAX(o.amount)" }), output.GetHeaders());
+
+    struct Group { long long count = 0, total = 0, minimum = 1000, maximum = -1; };
+    std::map<std::string, Group> groups;
+    for (size_t o = 0; o < orders.GetRowCount(); ++o) {
+        const std::string customer(orders.GetCell(o, 1));
+        if (customer.empty() || std::stoi(customer) >= 300) {
+            continue;
+        }
+        Group& group = groups[std::string(customers.GetCell(std::stoi(customer), 2))];
+        const long long amount = std::stoll(std::string(orders.GetCell(o, 2)));
+        ++group.count;
+        group.total += amount;
+        group.minimum = std::min(group.minimum, amount);
+        group.maximum = std::max(group.maximum, amount);
+    }
+    std::vector<std::vector<std::string>> expected;
+    for (const auto& entry : groups) {
+        const Group& g = entry.second;
+        expected.push_back({ entry.first, std::to_string(g.count), std::to_string(g.total),
+            std::to_string(g.minimum), std::to_string(g.maximum) });
+    }
+    std::sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) { return std::stoll(a[2]) > std::stoll(b[2]); });
+    EXPECT_EQ(expected, ToRows(output));
+}
+
+// ORDER BY と LIMIT / OFFSET は、全行を安定に並べ替えてから切り出した結果と一致すること
+TEST_F(SqlQueryTest, OrderByLimitMatchesFullSort) {
+    std::vector<std::vector<std::string>> rows = ToRows(orders);
+    std::stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+        const int left = std::stoi(a[2]);
+        const int right = std::stoi(b[2]);
+        return left != right ? left > right : std::stoi(a[0]) < std::stoi(b[0]);
+    });
+
+    CSVData output;
+    SqlQueryStats stats;
+    ASSERT_TRUE(Run("SELECT id, amount FROM orders ORDER BY amount DESC, id LIMIT 25 OFFSET 10", output, &stats));
+    std::vector<std::vector<std::string>> expected;
+    for (size_t r = 10; r < 35; ++r) {
+        expected.push_back({ rows[r][0], rows[r][2] });
+    }
+    EXPECT_EQ(expected, ToRows(output));
+    EXPECT_GE(PlanDepth(stats, "並べ替え（上位 35 行）"), 0) << "only the leading rows are sorted";
+
+    // OFFSET が行数を超えれば空になる
+    ASSERT_TRUE(Run("SELECT id FROM orders ORDER BY id LIMIT 5 OFFSET 100000", output));
+    EXPECT_EQ(0u, output.GetRowCount());
+}
+
+// 解釈できない問い合わせや存在しない表・列は理由を設定して失敗し、出力を変更しないこと
+TEST_F(SqlQueryTest, InvalidQueriesFailWithoutTouchingOutput) {
+    CSVData output;
+    FillTable(output, { "keep" }, { { "1" } });
+    for (const char* query : {
+        "SELECT missing FROM orders",
+        "SELECT id FROM nowhere",
+        "SELECT id FROM orders WHERE",
+        "SELECT id, FROM orders",
+        "SELECT id FROM orders ORDER BY 3",
+        "SELECT 'unterminated FROM orders" }) {
+        std::string error;
+        EXPECT_FALSE(ExecuteSqlQuery(query, { { "orders", &orders } }, output, error)) << query;
+        EXPECT_FALSE(error.empty()) << query;
+        EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1" } }), ToRows(output)) << query;
+    }
+}
+
+} // namespace Testing
+} // namespace NSys
@@ -0,0 +1,215 @@
+#include "test_csv_common.h"
+#include "TextEncoding.h"
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Helpers ====================
+
+static std::string Utf8(uint32_t codePoint) {
+    std::string out;
+    if (codePoint < 0x80) {
+        out += static_cast<char>(codePoint);
+    } else if (codePoint < 0x800) {
+        out += static_cast<char>(0xC0 | (codePoint >> 6));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += static_cast<char>(0xE0 | (codePoint >> 12));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (codePoint >> 18));
+        out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (codePoint & 0x3F));
+    }
+    return out;
+}
+
+// Unicode の規則どおりに 1 文字ずつ復号する参照実装（過長表現・サロゲート・U+10FFFF 超は不正）
+static bool ReferenceIsValidUtf8(const std::string& text) {
+    const auto* bytes = reinterpret_cast<const uint8_t*>(text.data());
+    size_t i = 0;
+    while (i < text.size()) {
+        const uint8_t lead = bytes[i];
+        size_t length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+        if (length == 0 || i + length > text.size()) {
+            return false;
+        }
+        uint32_t codePoint = length == 1 ? lead : lead & (0x7F >> length);
+        for (size_t k = 1; k < length; ++k) {
+            if ((bytes[i + k] & 0xC0) != 0x80) {
+                return false;
+            }
+            codePoint = (codePoint << 6) | (bytes[i + k] & 0x3F);
+        }
+        const uint32_t minimum[] = { 0, 0, 0x80, 0x800, 0x10000 };
+        if (codePoint < minimum[length] || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF)) {
+            return false;
+        }
+        i += length;
+    }
+    return true;
+}
+
+// 正しい文字・壊れた文字・ASCII の連続を混ぜ、16 バイト境界をまたぐ長さの文字列を作る
+static std::string RandomUtf8Like(std::mt19937& random) {
+    std::string text;
+    const size_t pieces = random() % 24;
+    for (size_t p = 0; p < pieces; ++p) {
+        switch (random() % 8) {
+        case 0: text.append(random() % 20, 'a'); break;
+        case 1: text += Utf8(0x80 + random() % 0x780); break;
+        case 2: text += Utf8(0x800 + random() % 0xD000); break;
+        case 3: text += Utf8(0x10000 + random() % 0x100000); break;
+        case 4: text += static_cast<char>(random() & 0xFF); break;
+        case 5: {
+            // 3・4 バイト文字の途中で切る
+            const std::string whole = Utf8(random() % 2 ? 0x3042 : 0x1F600);
+            text += whole.substr(0, 1 + random() % (whole.size() - 1));
+            break;
+        }
+        case 6: {
+            // 過長表現・サロゲート・範囲外
+            const char* const invalid[] = { "\xC0\xAF", "\xE0\x80\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xF8\x88\x80\x80\x80", "\xC1\xBF" };
+            text += invalid[random() % 6];
+            break;
+        }
+        default: text += "東京"; break;
+        }
+    }
+    return text;
+}
+
+// ==================== UTF-8 ====================
+
+// SIMD の検証は、参照実装と、1 バイトずつ調べる置き換え（AppendSanitizedUtf8）の結果と一致すること
+TEST(TextEncodingTest, Utf8ValidationMatchesScalarReference) {
+    std::mt19937 random(5);
+    size_t invalid = 0;
+    for (int trial = 0; trial < 200000; ++trial) {
+        const std::string text = RandomUtf8Like(random);
+        const bool expected = ReferenceIsValidUtf8(text);
+        ASSERT_EQ(expected, IsValidUtf8(text.data(), text.size())) << "trial " << trial;
+
+        std::string sanitized;
+        AppendSanitizedUtf8(sanitized, text.data(), text.size());
+        ASSERT_EQ(expected, sanitized == text) << "trial " << trial;
+        ASSERT_TRUE(ReferenceIsValidUtf8(sanitized));
+        invalid += expected ? 0 : 1;
+    }
+    EXPECT_GT(invalid, 10000u);
+    EXPECT_LT(invalid, 190000u);
+}
+
+// 境界の文字と、長い文字列の末尾・先頭だけが壊れている場合
+TEST(TextEncodingTest, Utf8Boundaries) {
+    for (uint32_t codePoint : { 0x7Fu, 0x80u, 0x7FFu, 0x800u, 0xD7FFu, 0xE000u, 0xFFFFu, 0x10000u, 0x10FFFFu }) {
+        const std::string text = std::string(31, 'x') + Utf8(codePoint);
+        EXPECT_TRUE(IsValidUtf8(text.data(), text.size())) << std::hex << codePoint;
+    }
+
+    const std::string valid = std::string(100, 'a') + "日本語のテキスト" + std::string(37, 'b');
+    EXPECT_TRUE(IsValidUtf8(valid.data(), valid.size()));
+    const std::string truncated = valid + "\xE6\x97";
+    EXPECT_FALSE(IsValidUtf8(truncated.data(), truncated.size()));
+    const std::string badFirst = "\x80" + valid;
+    EXPECT_FALSE(IsValidUtf8(badFirst.data(), badFirst.size()));
+
+    std::string sanitized;
+    AppendSanitizedUtf8(sanitized, "a\xFF" "b", 3);
+    EXPECT_EQ("a" + Utf8(0xFFFD) + "b", sanitized);
+}
+
+// ==================== CP932 ====================
+
+// Windows の CP932 の対応表と同じ文字に変換すること（NEC 特殊文字・IBM 拡張・CP932 固有の記号を含む）
+TEST(TextEncodingTest, Cp932SpotChecks) {
+    const std::vector<std::pair<std::string, std::vector<uint32_t>>> cases = {
+        { "\x82\xA0", { 0x3042 } },             // あ
+        { "\x81\x40", { 0x3000 } },             // 全角空白
+        { "\x93\xFA\x96\x7B", { 0x65E5, 0x672C } }, // 日本
+        { "\x88\x9F", { 0x4E9C } },             // 亜（第一水準の先頭）
+        { "\x81\x5F", { 0xFF3C } },             // ＼
+        { "\x81\x60", { 0xFF5E } },             // ～
+        { "\x81\x7C", { 0xFF0D } },             // －
+        { "\x81\x91", { 0xFFE0 } },             // ￠
+        { "\x87\x40", { 0x2460 } },             // ①（NEC 特殊文字）
+        { "\xED\x40", { 0x7E8A } },             // NEC 選定 IBM 拡張
+        { "\xFA\x40", { 0x2170 } },             // ⅰ（IBM 拡張）
+        { "\\", { 0x5C } },
+        { "\xB1", { 0xFF71 } },                 // 半角カナ
+        { "\x85\x40", { 0xFFFD } },             // 未定義
+        { "a\x82", { 0x61, 0xFFFD } },          // 末尾で切れた 2 バイト文字
+    };
+    for (const auto& entry : cases) {
+        std::string expected;
+        for (uint32_t codePoint : entry.second) {
+            expected += Utf8(codePoint);
+        }
+        std::string converted;
+        AppendCp932AsUtf8(converted, entry.first.data(), entry.first.size());
+        EXPECT_EQ(expected, converted) << std::hex << static_cast<int>(static_cast<uint8_t>(entry.first[0]));
+    }
+
+    // ASCII の連続部分（16 バイト単位の複写）と 2 バイト文字が交互に続いても崩れないこと
+    std::string input;
+    std::string expected;
+    for (int i = 0; i < 50; ++i) {
+        input += std::string(i % 19, 'z') + "\x82\xA0";
+        expected += std::string(i % 19, 'z') + Utf8(0x3042);
+    }
+    std::string converted = "prefix:";
+    AppendCp932AsUtf8(converted, input.data(), input.size());
+    EXPECT_EQ("prefix:" + expected, converted);
+}
+
+// ==================== Detection ====================
+
+// BOM・UTF-8・CP932 の判定と、UTF-8 として少しだけ壊れている場合の閾値
+TEST(TextEncodingTest, DetectsEncoding) {
+    size_t bomLength = 0;
+    const std::string bom = "\xEF\xBB\xBFid,名前\n";
+    EXPECT_EQ(TextEncoding::Utf8, DetectTextEncoding(bom.data(), bom.size(), bomLength));
+    EXPECT_EQ(3u, bomLength);
+
+    std::string utf8;
+    std::string cp932;
+    for (int i = 0; i < 40; ++i) {
+        utf8 += std::to_string(i) + ",日本語,東京\n";
+        cp932 += std::to_string(i) + ",\x93\xFA\x96\x7B\x8C\xEA,\x93\x8C\x8B\x9E\n";
+    }
+    EXPECT_EQ(TextEncoding::Utf8, DetectTextEncoding(utf8.data(), utf8.size(), bomLength));
+    EXPECT_EQ(0u, bomLength);
+    EXPECT_EQ(TextEncoding::Cp932, DetectTextEncoding(cp932.data(), cp932.size(), bomLength));
+    EXPECT_EQ(TextEncoding::Utf8, DetectTextEncoding("plain,ascii\n", 12, bomLength));
+
+    // 不正なバイトが 2〜4 バイト文字の 1/16 未満なら UTF-8 のまま（200 文字に 12 個）
+    std::string mostlyUtf8;
+    for (int i = 0; i < 200; ++i) {
+        mostlyUtf8 += Utf8(0x3042) + (i % 16 == 0 && i < 192 ? "\xFF" : "");
+    }
+    EXPECT_EQ(TextEncoding::Utf8, DetectTextEncoding(mostlyUtf8.data(), mostlyUtf8.size(), bomLength));
+
+    // 判定は先頭 64KiB だけで行う
+    const std::string lateCp932 = std::string(64 << 10, 'a') + cp932;
+    EXPECT_EQ(TextEncoding::Utf8, DetectTextEncoding(lateCp932.data(), lateCp932.size(), bomLength));
+    const std::string earlyCp932 = cp932 + std::string(64 << 10, 'a');
+    EXPECT_EQ(TextEncoding::Cp932, DetectTextEncoding(earlyCp932.data(), earlyCp932.size(), bomLength));
+}
+
+// CP932 のファイルは読み込み時に UTF-8 に変換されること
+class TextEncodingLoadTest : public CsvEngineTestBase {};
+
+TEST_F(TextEncodingLoadTest, LoadsCp932File) {
+    const std::string path = TempPath("sjis.csv");
+    WriteTextFile(path, "id,\x96\xBC\x91\x4F\r\n1,\x93\x8C\x8B\x9E\r\n2,\xB1\xB2\r\n");
+    CSVData data;
+    ASSERT_TRUE(data.LoadFromFile(path));
+    EXPECT_EQ((std::vector<std::string>{ "id", "名前" }), data.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{ { "1", "東京" }, { "2", "ｱｲ" } }), ToRows(data));
+}
+
+} // namespace Testing
+} // namespace NSys
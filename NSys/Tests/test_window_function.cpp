@@ -0,0 +1,176 @@
+#include "test_csv_common.h"
+#include "WindowFunction.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== Helpers ====================
+
+static std::string FormatReference(double value) {
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+// 各フレームを毎回数え直す参照実装（値はすべて整数なので和は誤差なく一致する）
+static std::string ReferenceFrame(const std::vector<std::string>& values, size_t end, size_t windowSize, const std::string& function) {
+    const size_t begin = end + 1 > windowSize ? end + 1 - windowSize : 0;
+    double sum = 0.0;
+    double minimum = 0.0;
+    double maximum = 0.0;
+    size_t count = 0;
+    for (size_t i = begin; i <= end; ++i) {
+        if (values[i].empty() || values[i] == "n/a") {
+            continue;
+        }
+        const double value = std::stod(values[i]);
+        minimum = count == 0 ? value : std::min(minimum, value);
+        maximum = count == 0 ? value : std::max(maximum, value);
+        sum += value;
+        ++count;
+    }
+    if (count == 0) {
+        return std::string();
+    }
+    if (function == "rolling_min") {
+        return FormatReference(minimum);
+    }
+    if (function == "rolling_max") {
+        return FormatReference(maximum);
+    }
+    return FormatReference(function == "rolling_mean" ? sum / static_cast<double>(count) : sum);
+}
+
+// ==================== WindowFunction ====================
+
+// 累積和・単調デックによる計算が、フレームごとに数え直した結果と一致すること
+TEST(WindowFunctionTest, RollingMatchesBruteForce) {
+    std::mt19937 random(3);
+    CSVData input;
+    input.SetHeaders({ "group", "t", "value" });
+    for (int i = 0; i < 3000; ++i) {
+        const int roll = static_cast<int>(random() % 20);
+        const std::string value = roll == 0 ? "" : roll == 1 ? "n/a" : std::to_string(static_cast<int>(random() % 2001) - 1000);
+        input.AddRow(std::vector<std::string>{ "g" + std::to_string(random() % 7), std::to_string(random() % 500), value });
+    }
+
+    for (const char* function : { "rolling_sum", "rolling_mean", "rolling_min", "rolling_max", "running_sum" }) {
+        for (size_t windowSize : { 1u, 4u, 50u }) {
+            WindowSpec spec;
+            spec.partitionColumn = "group";
+            spec.orderColumn = "t";
+            spec.function = function;
+            spec.valueColumn = "value";
+            spec.windowSize = windowSize;
+            CSVData output;
+            ASSERT_TRUE(ComputeWindow(input, spec, output)) << function;
+            ASSERT_EQ(input.GetRowCount(), output.GetRowCount());
+
+            // 出力はパーティションの出現順・並べ替え順に並ぶ
+            const auto rows = ToRows(output);
+            size_t start = 0;
+            while (start < rows.size()) {
+                size_t end = start;
+                std::vector<std::string> values;
+                while (end < rows.size() && rows[end][0] == rows[start][0]) {
+                    if (end > start) {
+                        ASSERT_LE(std::stoi(rows[end - 1][1]), std::stoi(rows[end][1]));
+                    }
+                    values.push_back(rows[end][2]);
+                    ++end;
+                }
+                const size_t frame = std::string(function) == "running_sum" ? values.size() : windowSize;
+                const std::string reference = std::string(function) == "running_sum" ? "rolling_sum" : function;
+                for (size_t i = 0; i < values.size(); ++i) {
+                    ASSERT_EQ(ReferenceFrame(values, i, frame, reference), rows[start + i][3])
+                        << function << " window " << windowSize << " row " << start + i;
+                }
+                start = end;
+            }
+        }
+    }
+}
+
+// 同順位は同じ順位になり、次の順位は飛ぶこと。並べ替えは安定で、数値の列は数値として比べる
+TEST(WindowFunctionTest, RankAndRowNumber) {
+    CSVData input;
+    FillTable(input, { "name", "score" }, { { "a", "10" }, { "b", "9" }, { "c", "10" }, { "d", "100" }, { "e", "9" } });
+
+    WindowSpec spec;
+    spec.orderColumn = "score";
+    spec.ascending = false;
+    spec.function = "rank";
+    CSVData output;
+    ASSERT_TRUE(ComputeWindow(input, spec, output));
+    EXPECT_EQ((std::vector<std::string>{ "name", "score", "rank" }), output.GetHeaders());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "d", "100", "1" }, { "a", "10", "2" }, { "c", "10", "2" }, { "b", "9", "4" }, { "e", "9", "4" } }), ToRows(output));
+
+    spec.function = "row_number";
+    spec.outputColumn = "n";
+    ASSERT_TRUE(ComputeWindow(input, spec, output));
+    EXPECT_EQ("n", output.GetHeaders().back());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "d", "100", "1" }, { "a", "10", "2" }, { "c", "10", "3" }, { "b", "9", "4" }, { "e", "9", "5" } }), ToRows(output));
+
+    // 数値でない値が混じる列は文字列として比べる
+    input.AddRow(std::vector<std::string>{ "f", "x" });
+    spec.ascending = true;
+    ASSERT_TRUE(ComputeWindow(input, spec, output));
+    std::vector<std::string> names;
+    for (const auto& row : ToRows(output)) {
+        names.push_back(row[0]);
+    }
+    EXPECT_EQ((std::vector<std::string>{ "a", "c", "d", "b", "e", "f" }), names);
+}
+
+// lag / lead はパーティションの中でだけずらし、範囲外は空にする
+TEST(WindowFunctionTest, LagLeadStayInsidePartition) {
+    CSVData input;
+    FillTable(input, { "k", "v" }, { { "x", "1" }, { "y", "a" }, { "x", "2" }, { "y", "b" }, { "x", "3" } });
+
+    WindowSpec spec;
+    spec.partitionColumn = "k";
+    spec.function = "lag";
+    spec.valueColumn = "v";
+    CSVData output;
+    ASSERT_TRUE(ComputeWindow(input, spec, output));
+    EXPECT_EQ("lag_v", output.GetHeaders().back());
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "x", "1", "" }, { "x", "2", "1" }, { "x", "3", "2" }, { "y", "a", "" }, { "y", "b", "a" } }), ToRows(output));
+
+    spec.function = "lead";
+    spec.offset = 2;
+    ASSERT_TRUE(ComputeWindow(input, spec, output));
+    EXPECT_EQ((std::vector<std::vector<std::string>>{
+        { "x", "1", "3" }, { "x", "2", "" }, { "x", "3", "" }, { "y", "a", "" }, { "y", "b", "" } }), ToRows(output));
+}
+
+// 存在しない列・未知の関数・幅 0 のフレームは失敗にする
+TEST(WindowFunctionTest, RejectsInvalidSpecs) {
+    CSVData input;
+    FillTable(input, { "k", "v" }, { { "x", "1" } });
+    CSVData output;
+
+    WindowSpec spec;
+    spec.valueColumn = "v";
+    spec.partitionColumn = "missing";
+    EXPECT_FALSE(ComputeWindow(input, spec, output));
+    spec.partitionColumn.clear();
+    spec.function = "median";
+    EXPECT_FALSE(ComputeWindow(input, spec, output));
+    spec.function = "rolling_sum";
+    spec.windowSize = 0;
+    EXPECT_FALSE(ComputeWindow(input, spec, output));
+    spec.windowSize = 2;
+    spec.valueColumn = "missing";
+    EXPECT_FALSE(ComputeWindow(input, spec, output));
+    spec.valueColumn = "v";
+    EXPECT_TRUE(ComputeWindow(input, spec, output));
+}
+
+} // namespace Testing
+} // namespace NSys
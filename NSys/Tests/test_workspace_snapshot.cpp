@@ -0,0 +1,135 @@
+#include "test_csv_common.h"
+#include "WorkspaceSnapshot.h"
+#include "ZoneMap.h"
+#include <cstring>
+
+namespace NSys {
+namespace Testing {
+
+// ==================== WorkspaceSnapshot ====================
+
+class WorkspaceSnapshotTest : public CsvEngineTestBase {
+protected:
+    static std::string ReadFileBytes(const std::string& path) {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    // 書き出した表のセル参照を探し、別の値に書き換える（セル参照の配列は 4096 バイト境界から始まる）
+    static bool ReplaceCellRef(std::string& bytes, uint64_t from, uint64_t to) {
+        for (size_t offset = 4096; offset + sizeof(uint64_t) <= bytes.size(); offset += sizeof(uint64_t)) {
+            uint64_t bits = 0;
+            std::memcpy(&bits, bytes.data() + offset, sizeof(bits));
+            if (bits == from) {
+                std::memcpy(&bytes[offset], &to, sizeof(to));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void WriteSingleTab(const std::string& path, const CSVData& data, uint64_t sequence = 1) {
+        WorkspaceTab tab;
+        tab.name = "tab";
+        tab.nodes.push_back(WorkspaceNode{ 3, "CSV読み込み", 10.0f, 20.0f, "file=a.csv" });
+        tab.data = &data;
+        ASSERT_TRUE(WriteWorkspaceSnapshot(path, sequence, { tab }));
+    }
+};
+
+// 表・ノード・列統計・ゾーンマップを書き出したまま復元すること
+TEST_F(WorkspaceSnapshotTest, RoundTripRestoresTabs) {
+    CSVData data;
+    data.SetHeaders({ "id", "name" });
+    for (size_t r = 0; r < 50000; ++r) {
+        data.AddRow(std::vector<std::string>{ std::to_string(r), r % 7 == 0 ? "" : "name" + std::to_string(r % 100) });
+    }
+    data.BuildZoneMap();
+
+    const std::string path = TempPath("workspace.nsws");
+    WriteSingleTab(path, data, 5);
+
+    uint64_t sequence = 0;
+    EXPECT_TRUE(PeekWorkspaceSnapshot(path, sequence));
+    EXPECT_EQ(5u, sequence);
+
+    RestoredWorkspace workspace;
+    ASSERT_EQ(WorkspaceLoadResult::Loaded, LoadWorkspaceSnapshot(path, workspace));
+    EXPECT_EQ(5u, workspace.sequence);
+    ASSERT_EQ(1u, workspace.tabs.size());
+    const RestoredWorkspaceTab& tab = workspace.tabs[0];
+    EXPECT_EQ("tab", tab.name);
+    ASSERT_EQ(1u, tab.nodes.size());
+    EXPECT_EQ(3, tab.nodes[0].id);
+    EXPECT_EQ("CSV読み込み", tab.nodes[0].type);
+    EXPECT_EQ(20.0f, tab.nodes[0].y);
+    EXPECT_EQ("file=a.csv", tab.nodes[0].settings);
+
+    ASSERT_NE(nullptr, tab.data);
+    EXPECT_EQ(data.GetHeaders(), tab.data->GetHeaders());
+    EXPECT_EQ(ToRows(data), ToRows(*tab.data));
+    ASSERT_NE(nullptr, tab.data->GetZoneMap());
+    EXPECT_EQ(data.GetZoneMap()->GetBlockCount(), tab.data->GetZoneMap()->GetBlockCount());
+}
+
+// 行ごとのセル数が異なる表もセル数を保ったまま復元すること
+TEST_F(WorkspaceSnapshotTest, RoundTripKeepsRaggedRows) {
+    CSVData data;
+    FillTable(data, { "a", "b", "c" }, { { "1", "2", "3" }, { "4" }, {}, { "5", "6" }, { "7", "8", "9" } });
+
+    const std::string path = TempPath("ragged.nsws");
+    WriteSingleTab(path, data);
+
+    RestoredWorkspace workspace;
+    ASSERT_EQ(WorkspaceLoadResult::Loaded, LoadWorkspaceSnapshot(path, workspace));
+    ASSERT_EQ(1u, workspace.tabs.size());
+    EXPECT_EQ(ToRows(data), ToRows(*workspace.tabs[0].data));
+}
+
+// 範囲外を指すセル参照を含むファイルは、読み込まずに Invalid を返すこと
+TEST_F(WorkspaceSnapshotTest, CorruptCellRefIsInvalid) {
+    CSVData data;
+    FillTable(data, { "v" }, { { "marker-value" }, { "other" } });
+    const uint64_t original = data.GetRows()[0].GetRefs()[0].bits;
+
+    const std::string path = TempPath("corrupt.nsws");
+    WriteSingleTab(path, data);
+    const std::string bytes = ReadFileBytes(path);
+
+    const uint64_t offset = original & CellRef::offsetMask;
+    const uint64_t length = original >> CellRef::offsetBits;
+    const uint64_t corruptions[] = {
+        (length << CellRef::offsetBits) | (offset + (uint64_t(100) << CellArena::chunkBits)), // 登録していないスロット
+        (length << CellRef::offsetBits) | (offset + CellArena::chunkSize - 4),                  // チャンクの末尾を越える
+        (uint64_t(1000000) << CellRef::offsetBits) | offset,                                   // 長さがチャンクを越える
+        (CellRef::lengthEscape << CellRef::offsetBits) | offset,                                // 長さの前置がチャンクを越える
+    };
+    for (uint64_t corrupted : corruptions) {
+        std::string damaged = bytes;
+        ASSERT_TRUE(ReplaceCellRef(damaged, original, corrupted));
+        WriteTextFile(path, damaged);
+
+        RestoredWorkspace workspace;
+        EXPECT_EQ(WorkspaceLoadResult::Invalid, LoadWorkspaceSnapshot(path, workspace)) << std::hex << corrupted;
+    }
+}
+
+// 存在しないファイルは Missing、途中で切れたファイルは Invalid を返すこと
+TEST_F(WorkspaceSnapshotTest, MissingAndTruncatedFiles) {
+    RestoredWorkspace workspace;
+    EXPECT_EQ(WorkspaceLoadResult::Missing, LoadWorkspaceSnapshot(TempPath("none.nsws"), workspace));
+
+    CSVData data;
+    FillTable(data, { "v" }, { { "1" }, { "2" } });
+    const std::string path = TempPath("truncated.nsws");
+    WriteSingleTab(path, data);
+    const std::string bytes = ReadFileBytes(path);
+    WriteTextFile(path, bytes.substr(0, bytes.size() - 5));
+
+    uint64_t sequence = 0;
+    EXPECT_FALSE(PeekWorkspaceSnapshot(path, sequence));
+    EXPECT_EQ(WorkspaceLoadResult::Invalid, LoadWorkspaceSnapshot(path, workspace));
+}
+
+} // namespace Testing
+} // namespace NSys